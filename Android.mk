@@ -84,6 +84,9 @@ LOCAL_SRC_FILES += \
 	src/KeyStore.cc \
 	src/LocalTransport.cc \
 	src/Message.cc \
+	src/MessageBufferPool.cc \
+	src/MessageTrace.cc \
+	src/MicroTimestamp.cc \
 	src/Message_Gen.cc \
 	src/Message_Parse.cc \
 	src/MethodTable.cc \
@@ -165,16 +168,21 @@ LOCAL_SRC_FILES := \
 	daemon/BTTransport.cc \
 	daemon/Bus.cc \
 	daemon/BusController.cc \
+	daemon/CongestionControl.cc \
+	daemon/Crc32.cc \
 	daemon/DBusObj.cc \
 	daemon/DaemonConfig.cc \
 	daemon/DaemonRouter.cc \
 	daemon/DaemonTransport.cc \
+	daemon/EpochGuard.cc \
+	daemon/LatencyHistogram.cc \
 	daemon/NameTable.cc \
 	daemon/NetworkInterface.cc \
 	daemon/Packet.cc \
 	daemon/PacketEngine.cc \
 	daemon/PacketEngineStream.cc \
 	daemon/PacketPool.cc \
+	daemon/PolicyEngine.cc \
 	daemon/RuleTable.cc \
 	daemon/TCPTransport.cc \
 	daemon/UDPPacketStream.cc \
@@ -217,11 +225,15 @@ LOCAL_SRC_FILES := \
 	daemon/ice/StunAttributeXorMappedAddress.cc \
 	daemon/ice/StunCredential.cc \
 	daemon/ice/StunMessage.cc \
+	daemon/ice/StunMessageBuilder.cc \
+	daemon/ice/StunMessageView.cc \
 	daemon/ice/StunRetry.cc \
 	daemon/ice/StunTransactionID.cc \
+	daemon/JSON/json_arena_reader.cc \
 	daemon/JSON/json_reader.cc \
 	daemon/JSON/json_value.cc \
 	daemon/JSON/json_writer.cc \
+	daemon/ns/InterfaceMonitor.cc \
 	daemon/ns/IpNameService.cc \
 	daemon/ns/IpNameServiceImpl.cc \
 	daemon/ns/IpNsProtocol.cc \
@@ -220,6 +220,13 @@ void AllJoynDebugObj::SetDebugLevel(const InterfaceDescription::Member* member,
 
 void AllJoynDebugObj::GenericMethodHandler(const InterfaceDescription::Member* member, Message& msg)
 {
+    const qcc::String guid(bus.GetInternal().GetGlobalGUID().ToShortString());
+    qcc::String sender(msg->GetSender());
+    // Only allow local connections to call add-on methods
+    if (sender.substr(1, guid.size()) != guid) {
+        return; // someone off-device is trying to control our debug add-ons, punish them by not responding.
+    }
+
     AddonMethodHandlerMap::iterator it = methodHandlerMap.find(member);
     if (it != methodHandlerMap.end()) {
         // Call the addon's method handler
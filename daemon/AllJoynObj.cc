@@ -2083,6 +2083,22 @@ void AllJoynObj::GetSessionFd(const InterfaceDescription::Member* member, Messag
     }
 }
 
+void AllJoynObj::GetSessionCounts(uint32_t& sessions, uint32_t& members)
+{
+    set<SessionId> ids;
+    members = 0;
+    AcquireLocks();
+    for (SessionMapType::const_iterator it = sessionMap.begin(); it != sessionMap.end(); ++it) {
+        /* Entries with a session id of 0 are bound session ports rather than sessions */
+        if (it->first.second != 0) {
+            ids.insert(it->first.second);
+            ++members;
+        }
+    }
+    ReleaseLocks();
+    sessions = ids.size();
+}
+
 AllJoynObj::SessionMapEntry* AllJoynObj::SessionMapFind(const qcc::String& name, SessionId session)
 {
     pair<String, SessionId> key(name, session);
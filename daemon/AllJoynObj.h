@@ -260,6 +260,14 @@ class AllJoynObj : public BusObject, public NameListener, public TransportListen
      */
     void RemoveBusToBusEndpoint(RemoteEndpoint& endpoint);
 
+    /**
+     * Get the number of sessions this daemon knows about.
+     *
+     * @param[out] sessions  Number of distinct session ids.
+     * @param[out] members   Number of (endpoint, session) entries across all sessions.
+     */
+    void GetSessionCounts(uint32_t& sessions, uint32_t& members);
+
     /**
      * Respond to a remote daemon request to attach a session through this daemon.
      *
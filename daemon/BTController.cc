@@ -269,7 +269,7 @@ BTController::~BTController()
 
 void BTController::ObjectRegistered() {
     // Set our unique name now that we know it.
-    self->SetUniqueName(bus.GetUniqueName());
+    nodeDB.SetNodeUniqueName(self, bus.GetUniqueName());
 }
 
 
@@ -757,7 +757,9 @@ void BTController::PostConnect(QStatus status, BTNodeInfo& node, const String& r
         QCC_DEBUG_ONLY(connectTimer.RecordTime(node->GetBusAddress().addr, connectStartTimes[node->GetBusAddress().addr]));
         assert(!remoteName.empty());
         if (node->GetUniqueName().empty() || (node->GetUniqueName() != remoteName)) {
-            node->SetUniqueName(remoteName);
+            // Keep the unique name indexes current in whichever DB holds the node.
+            nodeDB.SetNodeUniqueName(node, remoteName);
+            foundNodeDB.SetNodeUniqueName(node, remoteName);
         }
 
         bool inNodeDB = nodeDB.FindNode(node->GetBusAddress())->IsValid();
@@ -1303,7 +1305,7 @@ void BTController::HandleSetState(const InterfaceDescription::Member* member, Me
     BTNodeInfo connectingNode = foundNodeDB.FindNode(addr);
 
     if (connectingNode->IsValid()) {
-        connectingNode->SetUniqueName(sender);
+        foundNodeDB.SetNodeUniqueName(connectingNode, sender);
         if (connectingNode != connectingNode->GetConnectNode()) {
             foundNodeDB.RemoveNode(connectingNode);
             connectingNode->SetConnectNode(connectingNode);
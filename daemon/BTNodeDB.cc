@@ -22,7 +22,9 @@
 
 #include <qcc/platform.h>
 
+#include <limits>
 #include <list>
+#include <map>
 #include <set>
 #include <vector>
 
@@ -43,61 +45,13 @@ using namespace qcc;
 namespace ajn {
 
 
-static set<BTNodeInfo>::const_iterator findNode(const set<BTNodeInfo>& nodes, const BTBusAddress& addr)
-{
-    set<BTNodeInfo>::const_iterator it;
-    for (it = nodes.begin(); it != nodes.end(); ++it) {
-        if ((*it)->GetBusAddress() == addr) {
-            break;
-        }
-    }
-    return it;
-}
-
-
-static set<BTNodeInfo>::iterator findNode(set<BTNodeInfo>& nodes, const BTBusAddress& addr)
-{
-    set<BTNodeInfo>::iterator it;
-    for (it = nodes.begin(); it != nodes.end(); ++it) {
-        if ((*it)->GetBusAddress() == addr) {
-            break;
-        }
-    }
-    return it;
-}
-
-
-static set<BTNodeInfo>::const_iterator findNode(const set<BTNodeInfo>& nodes, const BDAddress& addr)
-{
-    set<BTNodeInfo>::const_iterator it;
-    for (it = nodes.begin(); it != nodes.end(); ++it) {
-        if ((*it)->GetBusAddress().addr == addr) {
-            break;
-        }
-    }
-    return it;
-}
-
-
-static set<BTNodeInfo>::const_iterator findNode(const set<BTNodeInfo>& nodes, const String& uniqueName)
-{
-    set<BTNodeInfo>::const_iterator it;
-    for (it = nodes.begin(); it != nodes.end(); ++it) {
-        if (!(*it)->GetUniqueName().empty() && ((*it)->GetUniqueName() == uniqueName)) {
-            break;
-        }
-    }
-    return it;
-}
-
-
 const BTNodeInfo BTNodeDB::FindNode(const BTBusAddress& addr) const
 {
     BTNodeInfo node;
     Lock(MUTEX_CONTEXT);
-    set<BTNodeInfo>::const_iterator it = findNode(nodes, addr);
-    if (it != nodes.end()) {
-        node = *it;
+    const BTNodeInfo* found = Lookup(addr);
+    if (found) {
+        node = *found;
     }
     Unlock(MUTEX_CONTEXT);
     return node;
@@ -108,9 +62,16 @@ const BTNodeInfo BTNodeDB::FindNode(const BDAddress& addr) const
 {
     BTNodeInfo node;
     Lock(MUTEX_CONTEXT);
-    set<BTNodeInfo>::const_iterator it = findNode(nodes, addr);
-    if (it != nodes.end()) {
-        node = *it;
+    // Return the node with the lowest PSM to match the iteration order of the node set.
+    pair<BDAddrIndex::const_iterator, BDAddrIndex::const_iterator> range = bdAddrIndex.equal_range(addr.GetRaw());
+    const BTBusAddress* lowest = NULL;
+    for (BDAddrIndex::const_iterator it = range.first; it != range.second; ++it) {
+        if (!lowest || (it->second < *lowest)) {
+            lowest = &it->second;
+        }
+    }
+    if (lowest) {
+        node = *Lookup(*lowest);
     }
     Unlock(MUTEX_CONTEXT);
     return node;
@@ -120,10 +81,21 @@ const BTNodeInfo BTNodeDB::FindNode(const BDAddress& addr) const
 const BTNodeInfo BTNodeDB::FindNode(const String& uniqueName) const
 {
     BTNodeInfo node;
+    if (uniqueName.empty()) {
+        return node;
+    }
     Lock(MUTEX_CONTEXT);
-    set<BTNodeInfo>::const_iterator it = findNode(nodes, uniqueName);
-    if (it != nodes.end()) {
-        node = *it;
+    pair<NameIndex::const_iterator, NameIndex::const_iterator> range = nameIndex.equal_range(uniqueName);
+    const BTNodeInfo* lowest = NULL;
+    for (NameIndex::const_iterator it = range.first; it != range.second; ++it) {
+        const BTNodeInfo* found = Lookup(it->second);
+        // Skip entries made stale by a name change that bypassed SetNodeUniqueName().
+        if (found && ((*found)->GetUniqueName() == uniqueName) && (!lowest || (*found < *lowest))) {
+            lowest = found;
+        }
+    }
+    if (lowest) {
+        node = *lowest;
     }
     Unlock(MUTEX_CONTEXT);
     return node;
@@ -171,8 +143,7 @@ void BTNodeDB::AddNode(const BTNodeInfo& node)
     assert(node->IsValid());
     RemoveNode(node);  // remove the old one (if it exists) before adding the new one with updated info
 
-    // Add to the master set
-    nodes.insert(node);
+    IndexNode(node);
 
     Unlock(MUTEX_CONTEXT);
 }
@@ -181,12 +152,122 @@ void BTNodeDB::AddNode(const BTNodeInfo& node)
 void BTNodeDB::RemoveNode(const BTNodeInfo& node)
 {
     Lock(MUTEX_CONTEXT);
-    set<BTNodeInfo>::iterator it = findNode(nodes, node->GetBusAddress());
-    if (it != nodes.end()) {
-        // Remove from the master set
-        nodes.erase(it);
+    AddrIndex::iterator it = addrIndex.find(node->GetBusAddress());
+    if (it != addrIndex.end()) {
+        UnindexNode(it);
+    }
+
+    Unlock(MUTEX_CONTEXT);
+}
+
+
+void BTNodeDB::IndexNode(const BTNodeInfo& node)
+{
+    const BTBusAddress& addr = node->GetBusAddress();
+
+    // Add to the master set
+    nodes.insert(node);
+
+    ExpireIndex::iterator expireIt = expireIndex.insert(pair<uint64_t, BTBusAddress>(node->GetExpireTime(), addr));
+    addrIndex.insert(AddrIndex::value_type(addr, IndexEntry(node, expireIt)));
+    bdAddrIndex.insert(pair<uint64_t, BTBusAddress>(addr.addr.GetRaw(), addr));
+    if (!node->GetUniqueName().empty()) {
+        nameIndex.insert(pair<String, BTBusAddress>(node->GetUniqueName(), addr));
+    }
+}
+
+
+void BTNodeDB::UnindexNode(AddrIndex::iterator it)
+{
+    const BTBusAddress addr = it->first;
+    IndexEntry& entry = it->second;
+
+    if (!entry.uniqueName.empty()) {
+        pair<NameIndex::iterator, NameIndex::iterator> range = nameIndex.equal_range(entry.uniqueName);
+        for (NameIndex::iterator nit = range.first; nit != range.second; ++nit) {
+            if (nit->second == addr) {
+                nameIndex.erase(nit);
+                break;
+            }
+        }
+    }
+
+    pair<BDAddrIndex::iterator, BDAddrIndex::iterator> range = bdAddrIndex.equal_range(addr.addr.GetRaw());
+    for (BDAddrIndex::iterator bit = range.first; bit != range.second; ++bit) {
+        if (bit->second == addr) {
+            bdAddrIndex.erase(bit);
+            break;
+        }
+    }
+
+    expireIndex.erase(entry.expireIt);
+
+    // Remove from the master set
+    nodes.erase(entry.node);
+
+    addrIndex.erase(it);
+}
+
+
+void BTNodeDB::UpdateIndexKeys(IndexEntry& entry)
+{
+    const BTBusAddress& addr = entry.node->GetBusAddress();
+    const String& uniqueName = entry.node->GetUniqueName();
+
+    if (uniqueName != entry.uniqueName) {
+        if (!entry.uniqueName.empty()) {
+            pair<NameIndex::iterator, NameIndex::iterator> range = nameIndex.equal_range(entry.uniqueName);
+            for (NameIndex::iterator nit = range.first; nit != range.second; ++nit) {
+                if (nit->second == addr) {
+                    nameIndex.erase(nit);
+                    break;
+                }
+            }
+        }
+        entry.uniqueName = uniqueName;
+        if (!uniqueName.empty()) {
+            nameIndex.insert(pair<String, BTBusAddress>(uniqueName, addr));
+        }
     }
 
+    if (entry.node->GetExpireTime() != entry.expireIt->first) {
+        expireIndex.erase(entry.expireIt);
+        entry.expireIt = expireIndex.insert(pair<uint64_t, BTBusAddress>(entry.node->GetExpireTime(), addr));
+    }
+}
+
+
+void BTNodeDB::SetNodeUniqueName(const BTNodeInfo& node, const String& uniqueName)
+{
+    Lock(MUTEX_CONTEXT);
+    BTNodeInfo lnode = node;
+    lnode->SetUniqueName(uniqueName);
+    AddrIndex::iterator it = addrIndex.find(node->GetBusAddress());
+    if (it != addrIndex.end()) {
+        UpdateIndexKeys(it->second);
+    }
+    Unlock(MUTEX_CONTEXT);
+}
+
+
+void BTNodeDB::PopExpiredNodes(BTNodeDB& expiredDB)
+{
+    Lock(MUTEX_CONTEXT);
+    Timespec now;
+    GetTimeNow(&now);
+    uint64_t nowMillis = now.GetAbsoluteMillis();
+    while (!expireIndex.empty() && (expireIndex.begin()->first <= nowMillis)) {
+        AddrIndex::iterator it = addrIndex.find(expireIndex.begin()->second);
+        assert(it != addrIndex.end());
+        BTNodeInfo node = it->second.node;
+        if (node->GetExpireTime() > nowMillis) {
+            // The expiration time was extended without going through the DB.
+            UpdateIndexKeys(it->second);
+        } else {
+            UnindexNode(it);
+            expiredDB.AddNode(node);
+        }
+    }
     Unlock(MUTEX_CONTEXT);
 }
 
@@ -203,19 +284,19 @@ void BTNodeDB::Diff(const BTNodeDB& other, BTNodeDB* added, BTNodeDB* removed) c
     }
 
     const_iterator nodeit;
-    set<BTNodeInfo>::const_iterator addrit;
+    const BTNodeInfo* found;
 
     // Find removed names/nodes
     if (removed) {
         for (nodeit = Begin(); nodeit != End(); ++nodeit) {
             const BTNodeInfo& node = *nodeit;
-            addrit = findNode(other.nodes, node->GetBusAddress());
-            if (addrit == other.nodes.end()) {
+            found = other.Lookup(node->GetBusAddress());
+            if (!found) {
                 removed->AddNode(node);
             } else {
                 BTNodeInfo diffNode = node->Clone();
                 bool include = false;
-                const BTNodeInfo& onode = *addrit;
+                const BTNodeInfo& onode = *found;
                 NameSet::const_iterator nameit;
                 NameSet::const_iterator onameit;
                 for (nameit = node->GetAdvertiseNamesBegin(); nameit != node->GetAdvertiseNamesEnd(); ++nameit) {
@@ -237,13 +318,13 @@ void BTNodeDB::Diff(const BTNodeDB& other, BTNodeDB* added, BTNodeDB* removed) c
     if (added) {
         for (nodeit = other.Begin(); nodeit != other.End(); ++nodeit) {
             const BTNodeInfo& onode = *nodeit;
-            addrit = findNode(nodes, onode->GetBusAddress());
-            if (addrit == nodes.end()) {
+            found = Lookup(onode->GetBusAddress());
+            if (!found) {
                 added->AddNode(onode);
             } else {
                 BTNodeInfo diffNode = onode->Clone();
                 bool include = false;
-                const BTNodeInfo& node = *addrit;
+                const BTNodeInfo& node = *found;
                 NameSet::const_iterator nameit;
                 NameSet::const_iterator onameit;
                 for (onameit = onode->GetAdvertiseNamesBegin(); onameit != onode->GetAdvertiseNamesEnd(); ++onameit) {
@@ -284,14 +365,12 @@ void BTNodeDB::NodeDiff(const BTNodeDB& other, BTNodeDB* added, BTNodeDB* remove
     }
 
     const_iterator nodeit;
-    set<BTNodeInfo>::const_iterator addrit;
 
     // Find removed names/nodes
     if (removed) {
         for (nodeit = Begin(); nodeit != End(); ++nodeit) {
             const BTNodeInfo& node = *nodeit;
-            addrit = findNode(other.nodes, node->GetBusAddress());
-            if (addrit == other.nodes.end()) {
+            if (!other.Lookup(node->GetBusAddress())) {
                 removed->AddNode(node);
             }
         }
@@ -301,8 +380,7 @@ void BTNodeDB::NodeDiff(const BTNodeDB& other, BTNodeDB* added, BTNodeDB* remove
     if (added) {
         for (nodeit = other.Begin(); nodeit != other.End(); ++nodeit) {
             const BTNodeInfo& onode = *nodeit;
-            addrit = findNode(nodes, onode->GetBusAddress());
-            if (addrit == nodes.end()) {
+            if (!Lookup(onode->GetBusAddress())) {
                 added->AddNode(onode);
             }
         }
@@ -327,10 +405,10 @@ void BTNodeDB::UpdateDB(const BTNodeDB* added, const BTNodeDB* removed, bool rem
         const_iterator rit;
         for (rit = removed->Begin(); rit != removed->End(); ++rit) {
             BTNodeInfo rnode = *rit;
-            set<BTNodeInfo>::const_iterator it = findNode(nodes, rnode->GetBusAddress());
-            if (it != nodes.end()) {
+            const BTNodeInfo* found = Lookup(rnode->GetBusAddress());
+            if (found) {
                 // Remove names from node
-                BTNodeInfo node = *it;
+                BTNodeInfo node = *found;
                 if (&(*node) == &(*rnode)) {
                     // The exact same instance of node is in the removed DB so
                     // just remove the node so that the names don't get
@@ -359,8 +437,8 @@ void BTNodeDB::UpdateDB(const BTNodeDB* added, const BTNodeDB* removed, bool rem
         const_iterator ait;
         for (ait = added->Begin(); ait != added->End(); ++ait) {
             BTNodeInfo anode = *ait;
-            set<BTNodeInfo>::const_iterator it = findNode(nodes, anode->GetBusAddress());
-            if (it == nodes.end()) {
+            AddrIndex::iterator it = addrIndex.find(anode->GetBusAddress());
+            if (it == addrIndex.end()) {
                 // New node
                 BTNodeInfo connNode = FindNode(anode->GetConnectNode()->GetBusAddress());
                 if (connNode->IsValid()) {
@@ -370,7 +448,7 @@ void BTNodeDB::UpdateDB(const BTNodeDB* added, const BTNodeDB* removed, bool rem
                 AddNode(anode);
             } else {
                 // Add names to existing node
-                BTNodeInfo node = *it;
+                BTNodeInfo node = it->second.node;
                 NameSet::const_iterator anameit;
                 for (anameit = anode->GetAdvertiseNamesBegin(); anameit != anode->GetAdvertiseNamesEnd(); ++anameit) {
                     const String& aname = *anameit;
@@ -391,6 +469,7 @@ void BTNodeDB::UpdateDB(const BTNodeDB* added, const BTNodeDB* removed, bool rem
                 if ((node->GetUniqueName() != anode->GetUniqueName()) && !anode->GetUniqueName().empty()) {
                     node->SetUniqueName(anode->GetUniqueName());
                 }
+                UpdateIndexKeys(it->second);
             }
         }
     }
@@ -399,17 +478,22 @@ void BTNodeDB::UpdateDB(const BTNodeDB* added, const BTNodeDB* removed, bool rem
 }
 
 
+void BTNodeDB::SetAllExpireTimes(uint64_t expireTime)
+{
+    // Every node gets the same key so the expiration index is rebuilt rather than updated.
+    expireIndex.clear();
+    for (AddrIndex::iterator it = addrIndex.begin(); it != addrIndex.end(); ++it) {
+        it->second.node->SetExpireTime(expireTime);
+        it->second.expireIt = expireIndex.insert(expireIndex.end(), pair<uint64_t, BTBusAddress>(expireTime, it->first));
+    }
+}
+
+
 void BTNodeDB::RemoveExpiration()
 {
     if (useExpirations) {
         Lock(MUTEX_CONTEXT);
-        uint64_t expireTime = numeric_limits<uint64_t>::max();
-        iterator it = nodes.begin();
-        while (it != nodes.end()) {
-            BTNodeInfo node = *it;
-            node->SetExpireTime(expireTime);
-            ++it;
-        }
+        SetAllExpireTimes(numeric_limits<uint64_t>::max());
         Unlock(MUTEX_CONTEXT);
     } else {
         QCC_LogError(ER_FAIL, ("Called RemoveExpiration on BTNodeDB instance initialized without expiration support."));
@@ -424,13 +508,7 @@ void BTNodeDB::RefreshExpiration(uint32_t expireDelta)
         Lock(MUTEX_CONTEXT);
         Timespec now;
         GetTimeNow(&now);
-        uint64_t expireTime = now.GetAbsoluteMillis() + expireDelta;
-        iterator it = nodes.begin();
-        while (it != nodes.end()) {
-            BTNodeInfo node = *it;
-            node->SetExpireTime(expireTime);
-            ++it;
-        }
+        SetAllExpireTimes(now.GetAbsoluteMillis() + expireDelta);
         Unlock(MUTEX_CONTEXT);
     } else {
         QCC_LogError(ER_FAIL, ("Called RefreshExpiration on BTNodeDB instance initialized without expiration support."));
@@ -448,11 +526,12 @@ void BTNodeDB::RefreshExpiration(const BTNodeInfo& connNode, uint32_t expireDelt
         GetTimeNow(&now);
         uint64_t expireTime = now.GetAbsoluteMillis() + expireDelta;
 
-        for (set<BTNodeInfo>::const_iterator it = nodes.begin(); it != nodes.end(); ++it) {
-            if ((*it)->GetConnectNode() == connNode) {
-                BTNodeInfo node = *it;
+        for (AddrIndex::iterator it = addrIndex.begin(); it != addrIndex.end(); ++it) {
+            BTNodeInfo& node = it->second.node;
+            if (node->GetConnectNode() == connNode) {
                 node->SetExpireTime(expireTime);
                 node->SetUUIDRev(connNode->GetUUIDRev());
+                UpdateIndexKeys(it->second);
             }
         }
 
@@ -486,9 +565,9 @@ void BTNodeDB::NodeSessionLost(SessionId sessionID)
 void BTNodeDB::UpdateNodeSessionID(SessionId sessionID, const BTNodeInfo& node)
 {
     Lock(MUTEX_CONTEXT);
-    set<BTNodeInfo>::const_iterator it = findNode(nodes, node->GetBusAddress());
-    if (it != nodes.end()) {
-        BTNodeInfo lnode = *it;
+    const BTNodeInfo* found = Lookup(node->GetBusAddress());
+    if (found) {
+        BTNodeInfo lnode = *found;
 
         lnode->SetSessionID(sessionID);
         lnode->SetSessionState(_BTNodeInfo::SESSION_UP);
@@ -24,12 +24,14 @@
 #include <qcc/platform.h>
 
 #include <limits>
+#include <map>
 #include <set>
 #include <vector>
 
 #include <qcc/ManagedObj.h>
 #include <qcc/Mutex.h>
 #include <qcc/String.h>
+#include <qcc/StringMapKey.h>
 #include <qcc/StringUtil.h>
 #include <qcc/time.h>
 
@@ -37,10 +39,21 @@
 #include "BTBusAddress.h"
 #include "BTNodeInfo.h"
 
+#include <qcc/STLContainer.h>
+
 
 namespace ajn {
 
-/** Bluetooth Node Database */
+/**
+ * Bluetooth Node Database
+ *
+ * Nodes are kept in a set ordered by bus address for iteration along with
+ * hash indexes on the bus address, the Bluetooth device address and the
+ * unique name, and an index ordered by expiration time.  The unique name and
+ * expiration time of a node are mutable so changes to them must go through
+ * the DB (SetNodeUniqueName(), RefreshExpiration(), UpdateDB(), etc.) or the
+ * node must be removed and re-added for the indexes to stay current.
+ */
 class BTNodeDB {
   public:
     /** Convenience iterator typedef. */
@@ -92,6 +105,13 @@ class BTNodeDB {
      */
     const BTNodeInfo FindNode(const BDAddress& addr) const;
 
+    /**
+     * Find the range of nodes with the given Bluetooth device address.
+     *
+     * @param addr      Bluetooth device address
+     * @param begin     [out] First node with the device address
+     * @param end       [out] One past the last node with the device address
+     */
     void FindNodes(const BDAddress& addr, const_iterator& begin, const_iterator& end)
     {
         BTBusAddress lower(addr, 0x0000);
@@ -218,37 +238,37 @@ class BTNodeDB {
         Unlock(MUTEX_CONTEXT);
     }
 
-    void PopExpiredNodes(BTNodeDB& expiredDB)
+    /**
+     * Move all nodes whose expiration time has passed into another DB.  Only
+     * the expired nodes are visited.
+     *
+     * @param expiredDB     DB to receive the expired nodes.
+     */
+    void PopExpiredNodes(BTNodeDB& expiredDB);
+
+    /**
+     * Get the earliest expiration time of the nodes in the DB.
+     *
+     * @return  Absolute expiration time in milliseconds of the node that will
+     *          expire first (numeric_limits<uint64_t>::max() if none).
+     */
+    uint64_t NextNodeExpiration() const
     {
         Lock(MUTEX_CONTEXT);
-        qcc::Timespec now;
-        qcc::GetTimeNow(&now);
-        std::set<BTNodeInfo>::iterator it = nodes.begin();
-        while (it != nodes.end()) {
-            BTNodeInfo node = *it;
-            if (node->GetExpireTime() <= now.GetAbsoluteMillis()) {
-                nodes.erase(node);
-                expiredDB.AddNode(node);
-                it = nodes.begin();
-            } else {
-                ++it;
-            }
-        }
+        uint64_t next = expireIndex.empty() ? std::numeric_limits<uint64_t>::max() : expireIndex.begin()->first;
         Unlock(MUTEX_CONTEXT);
-    }
-
-    uint64_t NextNodeExpiration()
-    {
-        uint64_t next = std::numeric_limits<uint64_t>::max();
-        for (std::set<BTNodeInfo>::iterator it = nodes.begin(); it != nodes.end(); ++it) {
-            BTNodeInfo node = *it;
-            if (node->GetExpireTime() < next) {
-                next = node->GetExpireTime();
-            }
-        }
         return next;
     }
 
+    /**
+     * Set the unique name of a node and update the unique name index if the
+     * node is contained by the DB.
+     *
+     * @param node          Node to update.
+     * @param uniqueName    New unique name of the daemon running on the node.
+     */
+    void SetNodeUniqueName(const BTNodeInfo& node, const qcc::String& uniqueName);
+
 
     void NodeSessionLost(SessionId sessionID);
     void UpdateNodeSessionID(SessionId sessionID, const BTNodeInfo& node);
@@ -295,7 +315,16 @@ class BTNodeDB {
     /**
      * Clear out the DB.
      */
-    void Clear() { nodes.clear(); }
+    void Clear()
+    {
+        Lock(MUTEX_CONTEXT);
+        nodes.clear();
+        addrIndex.clear();
+        bdAddrIndex.clear();
+        nameIndex.clear();
+        expireIndex.clear();
+        Unlock(MUTEX_CONTEXT);
+    }
 
 #ifndef NDEBUG
     void DumpTable(const char* info) const;
@@ -306,10 +335,79 @@ class BTNodeDB {
 
   private:
 
+    /** Hash functor for bus addresses. */
+    struct BusAddrHash {
+        size_t operator()(const BTBusAddress& addr) const
+        {
+            uint64_t key = (addr.addr.GetRaw() << 16) ^ addr.psm;
+            return static_cast<size_t>(key ^ (key >> 32));
+        }
+    };
+
+    /** Hash functor for raw Bluetooth device addresses. */
+    struct BDAddrHash {
+        size_t operator()(uint64_t addr) const { return static_cast<size_t>(addr ^ (addr >> 32)); }
+    };
+
+    /** Hash functor for unique names. */
+    struct NameHash {
+        size_t operator()(const qcc::String& s) const { return qcc::hash_string(s.c_str()); }
+    };
+
+    /** Index ordered by expiration time. */
+    typedef std::multimap<uint64_t, BTBusAddress> ExpireIndex;
+
+    /**
+     * Entry in the bus address index.  The keys the node was indexed under
+     * are kept with it so that the node can be unindexed even if its unique
+     * name or expiration time was changed outside of the DB.
+     */
+    struct IndexEntry {
+        BTNodeInfo node;                    /**< The node. */
+        qcc::String uniqueName;             /**< Key in nameIndex (not indexed if empty). */
+        ExpireIndex::iterator expireIt;     /**< Entry in expireIndex. */
+
+        IndexEntry(const BTNodeInfo& node, ExpireIndex::iterator expireIt) :
+            node(node), uniqueName(node->GetUniqueName()), expireIt(expireIt) { }
+    };
+
+    typedef STL_NAMESPACE_PREFIX::unordered_map<BTBusAddress, IndexEntry, BusAddrHash> AddrIndex;
+    typedef STL_NAMESPACE_PREFIX::unordered_multimap<uint64_t, BTBusAddress, BDAddrHash> BDAddrIndex;
+    typedef STL_NAMESPACE_PREFIX::unordered_multimap<qcc::String, BTBusAddress, NameHash> NameIndex;
+
     BTNodeDB(const BTNodeDB& other) : useExpirations(false) { }
     BTNodeDB& operator=(const BTNodeDB& other) { return *this; }
 
-    std::set<BTNodeInfo> nodes;     /**< The node DB storage. */
+    /**
+     * Look up a node by bus address.
+     *
+     * @param addr  Bus address of the node.
+     *
+     * @return  Pointer to the node in the DB or NULL if not found.
+     */
+    const BTNodeInfo* Lookup(const BTBusAddress& addr) const
+    {
+        AddrIndex::const_iterator it = addrIndex.find(addr);
+        return (it == addrIndex.end()) ? NULL : &it->second.node;
+    }
+
+    /** Add a node to the set and all of the indexes.  The node must not already be in the DB. */
+    void IndexNode(const BTNodeInfo& node);
+
+    /** Remove a node from the set and all of the indexes. */
+    void UnindexNode(AddrIndex::iterator it);
+
+    /** Bring the unique name and expiration indexes up to date with the node. */
+    void UpdateIndexKeys(IndexEntry& entry);
+
+    /** Set the expiration time of every node and rebuild the expiration index. */
+    void SetAllExpireTimes(uint64_t expireTime);
+
+    std::set<BTNodeInfo> nodes;     /**< The node DB storage ordered by bus address. */
+    AddrIndex addrIndex;            /**< Bus address index. */
+    BDAddrIndex bdAddrIndex;        /**< Bluetooth device address index. */
+    NameIndex nameIndex;            /**< Unique name index. */
+    ExpireIndex expireIndex;        /**< Expiration time index. */
 
     mutable qcc::Mutex lock;        /**< Mutext to protect the DB. */
 
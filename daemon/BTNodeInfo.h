@@ -345,7 +345,7 @@ class _BTNodeInfo {
      * Set the unique name of the AllJoyn controller object.  Care must be
      * taken when setting this.  It is used as a lookup key in BTNodeDB and
      * setting this for a node contained by BTNodeDB will _NOT_ update that
-     * index.
+     * index.  Use BTNodeDB::SetNodeUniqueName() for such nodes.
      *
      * @param name  The unique name of the AllJoyn controller object.
      */
@@ -452,7 +452,8 @@ class _BTNodeInfo {
     /**
      * Set the expiration time.  Care must be taken when setting this.  It is
      * used as a lookup key in BTNodeDB and setting this for a node contained
-     * by BTNodeDB will _NOT_ update that index.
+     * by BTNodeDB will _NOT_ update that index.  Remove the node from the DB
+     * before changing it and add it back afterwards.
      *
      * @param expireTime    Absolute expiration time in milliseconds
      */
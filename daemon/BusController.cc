@@ -26,6 +26,7 @@
 #include <qcc/platform.h>
 
 #include "BusController.h"
+#include "DaemonConfig.h"
 #include "DaemonRouter.h"
 #include "BusInternal.h"
 
@@ -41,6 +42,7 @@ BusController::BusController(Bus& alljoynBus) :
     alljoynObj(bus, this),
 #ifndef NDEBUG
     alljoynDebugObj(bus, this),
+    metricsDebugObj(reinterpret_cast<DaemonRouter&>(bus.GetInternal().GetRouter()), alljoynObj),
 #endif
     initComplete(NULL)
 
@@ -64,6 +66,13 @@ QStatus BusController::Init(const qcc::String& listenSpecs)
 
     initComplete = &initEvent;
 
+    /*
+     * A malformed policy is logged but does not stop the daemon, the rules compiled before the
+     * error are enforced.
+     */
+    DaemonRouter& router(reinterpret_cast<DaemonRouter&>(bus.GetInternal().GetRouter()));
+    router.LoadPolicy(*DaemonConfig::Access());
+
     /*
      * Start the object initialization chain (see ObjectRegistered callback below)
      */
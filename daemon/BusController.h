@@ -34,6 +34,7 @@
 #include "DBusObj.h"
 #include "AllJoynObj.h"
 #include "AllJoynDebugObj.h"
+#include "MetricsDebug.h"
 
 namespace ajn {
 
@@ -109,6 +110,9 @@ class BusController {
 #ifndef NDEBUG
     /** Bus object responsible for org.alljoyn.Debug */
     debug::AllJoynDebugObj alljoynDebugObj;
+
+    /** Add-on to org.alljoyn.Debug responsible for org.alljoyn.Bus.Debug.Metrics */
+    debug::MetricsDebugObj metricsDebugObj;
 #endif
 
     /** Event to wait on while initialization completes */
@@ -0,0 +1,209 @@
+/**
+ * @file
+ * Congestion control algorithms used by PacketEngine.
+ */
+
+/******************************************************************************
+ * Copyright 2012, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#include <qcc/platform.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include "CongestionControl.h"
+
+#define QCC_MODULE "PACKET"
+
+using namespace std;
+
+namespace ajn {
+
+/* CUBIC scaling constant and multiplicative decrease factor (RFC 8312) */
+static const double CUBIC_C = 0.4;
+static const double CUBIC_BETA = 0.7;
+
+/* Delay based control keeps between DELAY_ALPHA and DELAY_BETA packets queued in the network */
+static const double DELAY_ALPHA = 2.0;
+static const double DELAY_BETA = 4.0;
+
+/* Smallest window after a loss */
+static const double MIN_LOSS_WINDOW = 2.0;
+
+static inline uint16_t WindowToPackets(double cwnd, double maxWindow)
+{
+    double w = (std::min)(cwnd, maxWindow);
+    return (w < 1.0) ? 1 : static_cast<uint16_t>(w);
+}
+
+CongestionControl* CongestionControl::Create(Type type, uint16_t maxWindow)
+{
+    switch (type) {
+    case DELAY:
+        return new DelayCongestionControl(maxWindow);
+
+    case CUBIC:
+    default:
+        return new CubicCongestionControl(maxWindow);
+    }
+}
+
+CubicCongestionControl::CubicCongestionControl(uint16_t maxWindow) :
+    maxWindow(maxWindow),
+    cwnd(1.0),
+    ssThresh(maxWindow),
+    wMax(0.0),
+    k(0.0),
+    wEst(0.0),
+    epochStart(0),
+    minRttMs(0)
+{
+}
+
+uint16_t CubicCongestionControl::GetWindow() const
+{
+    return WindowToPackets(cwnd, maxWindow);
+}
+
+void CubicCongestionControl::SetMaxWindow(uint16_t maxWindow)
+{
+    this->maxWindow = maxWindow;
+    cwnd = (std::min)(cwnd, this->maxWindow);
+    ssThresh = (std::min)(ssThresh, this->maxWindow);
+}
+
+void CubicCongestionControl::OnAck(uint16_t ackedPackets, uint32_t rttMs, uint64_t now)
+{
+    if (rttMs && (!minRttMs || (rttMs < minRttMs))) {
+        minRttMs = rttMs;
+    }
+
+    if (cwnd < ssThresh) {
+        /* Slow start */
+        cwnd = (std::min)(cwnd + ackedPackets, maxWindow);
+        return;
+    }
+
+    /* Start a new congestion avoidance epoch */
+    if (epochStart == 0) {
+        epochStart = now;
+        if (cwnd < wMax) {
+            k = pow((wMax - cwnd) / CUBIC_C, 1.0 / 3.0);
+        } else {
+            k = 0.0;
+            wMax = cwnd;
+        }
+        wEst = cwnd;
+    }
+
+    /* Window the cubic function wants one round trip from now */
+    double t = (static_cast<double>(now - epochStart) + minRttMs) / 1000.0;
+    double target = CUBIC_C * (t - k) * (t - k) * (t - k) + wMax;
+    target = (std::min)(target, 1.5 * cwnd);
+
+    if (target > cwnd) {
+        cwnd += ((target - cwnd) / cwnd) * ackedPackets;
+    } else {
+        cwnd += (0.01 / cwnd) * ackedPackets;
+    }
+
+    /* Never grow slower than Reno would in the same conditions */
+    wEst += ((3.0 * (1.0 - CUBIC_BETA)) / (1.0 + CUBIC_BETA)) * ackedPackets / cwnd;
+    cwnd = (std::max)(cwnd, wEst);
+    cwnd = (std::min)(cwnd, maxWindow);
+}
+
+void CubicCongestionControl::OnLoss(uint64_t now)
+{
+    /* Fast convergence: release bandwidth to new flows if the window is shrinking */
+    wMax = (cwnd < wMax) ? (cwnd * (1.0 + CUBIC_BETA) / 2.0) : cwnd;
+    cwnd = (std::max)(cwnd * CUBIC_BETA, MIN_LOSS_WINDOW);
+    ssThresh = cwnd;
+    epochStart = 0;
+}
+
+void CubicCongestionControl::OnTimeout(uint64_t now)
+{
+    wMax = cwnd;
+    ssThresh = (std::max)(cwnd * CUBIC_BETA, MIN_LOSS_WINDOW);
+    cwnd = 1.0;
+    epochStart = 0;
+}
+
+DelayCongestionControl::DelayCongestionControl(uint16_t maxWindow) :
+    maxWindow(maxWindow),
+    cwnd(1.0),
+    ssThresh(maxWindow),
+    baseRttMs(0),
+    rttMs(0)
+{
+}
+
+uint16_t DelayCongestionControl::GetWindow() const
+{
+    return WindowToPackets(cwnd, maxWindow);
+}
+
+void DelayCongestionControl::SetMaxWindow(uint16_t maxWindow)
+{
+    this->maxWindow = maxWindow;
+    cwnd = (std::min)(cwnd, this->maxWindow);
+    ssThresh = (std::min)(ssThresh, this->maxWindow);
+}
+
+void DelayCongestionControl::OnAck(uint16_t ackedPackets, uint32_t sampleMs, uint64_t now)
+{
+    if (sampleMs) {
+        if (!baseRttMs || (sampleMs < baseRttMs)) {
+            baseRttMs = sampleMs;
+        }
+        rttMs = rttMs ? ((7 * rttMs + sampleMs) >> 3) : sampleMs;
+    }
+
+    /* Estimated number of this channel's packets sitting in network queues */
+    double queued = 0.0;
+    if (rttMs > baseRttMs) {
+        queued = cwnd * static_cast<double>(rttMs - baseRttMs) / rttMs;
+    }
+
+    if (cwnd < ssThresh) {
+        /* Leave slow start as soon as a queue starts to build */
+        if (queued > 1.0) {
+            ssThresh = cwnd;
+        } else {
+            cwnd += ackedPackets;
+        }
+    } else if (queued < DELAY_ALPHA) {
+        cwnd += static_cast<double>(ackedPackets) / cwnd;
+    } else if (queued > DELAY_BETA) {
+        cwnd = (std::max)(cwnd - static_cast<double>(ackedPackets) / cwnd, MIN_LOSS_WINDOW);
+    }
+    cwnd = (std::min)(cwnd, maxWindow);
+}
+
+void DelayCongestionControl::OnLoss(uint64_t now)
+{
+    cwnd = (std::max)(cwnd * 0.75, MIN_LOSS_WINDOW);
+    ssThresh = cwnd;
+}
+
+void DelayCongestionControl::OnTimeout(uint64_t now)
+{
+    ssThresh = (std::max)(cwnd / 2.0, MIN_LOSS_WINDOW);
+    cwnd = 1.0;
+}
+
+}
@@ -0,0 +1,161 @@
+/**
+ * @file
+ * Congestion control algorithms used by PacketEngine.
+ */
+
+/******************************************************************************
+ * Copyright 2012, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#ifndef _ALLJOYN_CONGESTIONCONTROL_H
+#define _ALLJOYN_CONGESTIONCONTROL_H
+
+#include <qcc/platform.h>
+
+namespace ajn {
+
+/**
+ * CongestionControl decides how many unacknowledged packets a PacketEngine channel may have
+ * in flight. Congestion control only affects the transmitter so the algorithm can be chosen
+ * independently on each side of a channel.
+ *
+ * All methods are called with the channel's txLock held.
+ */
+class CongestionControl {
+  public:
+
+    /** Available congestion control algorithms */
+    enum Type {
+        CUBIC,   /**< Loss based, cubic window growth (default) */
+        DELAY    /**< Delay based, backs off as queueing delay builds up */
+    };
+
+    /**
+     * Create a congestion controller.
+     *
+     * @param type       Algorithm to use.
+     * @param maxWindow  Largest congestion window (in packets) the controller will allow.
+     * @return  A new congestion controller. Caller must delete it.
+     */
+    static CongestionControl* Create(Type type, uint16_t maxWindow);
+
+    /** Destructor */
+    virtual ~CongestionControl() { }
+
+    /**
+     * Get the type of this controller.
+     */
+    virtual Type GetType() const = 0;
+
+    /**
+     * Get the congestion window in packets. Always at least 1.
+     */
+    virtual uint16_t GetWindow() const = 0;
+
+    /**
+     * Return true while the controller is in slow start.
+     */
+    virtual bool InSlowStart() const = 0;
+
+    /**
+     * Limit the congestion window. Called when the channel's window size is negotiated.
+     *
+     * @param maxWindow  Largest congestion window (in packets) the controller will allow.
+     */
+    virtual void SetMaxWindow(uint16_t maxWindow) = 0;
+
+    /**
+     * Called when previously unacknowledged packets are acknowledged.
+     *
+     * @param ackedPackets  Number of packets newly acknowledged.
+     * @param rttMs         Round trip time sample in milliseconds or 0 if there was no valid sample.
+     * @param now           Current timestamp in milliseconds.
+     */
+    virtual void OnAck(uint16_t ackedPackets, uint32_t rttMs, uint64_t now) = 0;
+
+    /**
+     * Called once per loss event detected through duplicate or selective acks.
+     *
+     * @param now  Current timestamp in milliseconds.
+     */
+    virtual void OnLoss(uint64_t now) = 0;
+
+    /**
+     * Called once per loss event detected through a retransmit timeout.
+     *
+     * @param now  Current timestamp in milliseconds.
+     */
+    virtual void OnTimeout(uint64_t now) = 0;
+};
+
+/**
+ * CUBIC (RFC 8312) congestion control. After a loss the window grows along a cubic function of
+ * the time since the loss which makes recovery quick and independent of the round trip time.
+ */
+class CubicCongestionControl : public CongestionControl {
+  public:
+
+    /** Constructor */
+    CubicCongestionControl(uint16_t maxWindow);
+
+    Type GetType() const { return CUBIC; }
+    uint16_t GetWindow() const;
+    bool InSlowStart() const { return cwnd < ssThresh; }
+    void SetMaxWindow(uint16_t maxWindow);
+    void OnAck(uint16_t ackedPackets, uint32_t rttMs, uint64_t now);
+    void OnLoss(uint64_t now);
+    void OnTimeout(uint64_t now);
+
+  private:
+    double maxWindow;     /**< Upper limit for cwnd */
+    double cwnd;          /**< Congestion window */
+    double ssThresh;      /**< Slow start threshold */
+    double wMax;          /**< Window size just before the last reduction */
+    double k;             /**< Seconds the cubic function takes to grow back to wMax */
+    double wEst;          /**< Reno-friendly window estimate */
+    uint64_t epochStart;  /**< Start of the current congestion avoidance epoch (0 if none) */
+    uint32_t minRttMs;    /**< Smallest observed round trip time */
+};
+
+/**
+ * Delay based (Vegas style) congestion control. The number of packets queued in the network is
+ * estimated from the difference between the current and the minimum round trip time and the
+ * window is adjusted to keep that number between two thresholds. This keeps queues short on
+ * links where loss is not a reliable congestion signal.
+ */
+class DelayCongestionControl : public CongestionControl {
+  public:
+
+    /** Constructor */
+    DelayCongestionControl(uint16_t maxWindow);
+
+    Type GetType() const { return DELAY; }
+    uint16_t GetWindow() const;
+    bool InSlowStart() const { return cwnd < ssThresh; }
+    void SetMaxWindow(uint16_t maxWindow);
+    void OnAck(uint16_t ackedPackets, uint32_t rttMs, uint64_t now);
+    void OnLoss(uint64_t now);
+    void OnTimeout(uint64_t now);
+
+  private:
+    double maxWindow;     /**< Upper limit for cwnd */
+    double cwnd;          /**< Congestion window */
+    double ssThresh;      /**< Slow start threshold */
+    uint32_t baseRttMs;   /**< Smallest observed round trip time */
+    uint32_t rttMs;       /**< Smoothed round trip time */
+};
+
+}
+
+#endif
@@ -0,0 +1,167 @@
+/**
+ * @file
+ * Table driven and hardware accelerated CRC-32 checksums.
+ */
+
+/******************************************************************************
+ * Copyright 2012, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#include <qcc/platform.h>
+
+#include <cstring>
+
+#include "Crc32.h"
+
+/*
+ * The crc32 instruction is used through the target attribute so that the rest of the daemon does
+ * not have to be built with -msse4.2. Support is checked at run time.
+ */
+#if (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__clang__) || (defined(__GNUC__) && ((__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 9)))))
+#define CRC32C_HW_SUPPORT 1
+#include <cpuid.h>
+#include <nmmintrin.h>
+#endif
+
+#define QCC_MODULE "PACKET"
+
+namespace ajn {
+
+/* Bit reflected generator polynomials */
+#define CRC32_POLY   0xEDB88320U     /* IEEE 802.3 */
+#define CRC32C_POLY  0x82F63B78U     /* Castagnoli */
+
+/*
+ * Slicing-by-8 lookup tables. table[0] is the classic byte at a time table. table[k][b] is the
+ * CRC of byte b followed by k zero bytes which lets 8 table lookups consume 8 bytes at once.
+ */
+class Crc32Tables {
+  public:
+    uint32_t crc32[8][256];
+    uint32_t crc32c[8][256];
+    bool hasHw;
+
+    Crc32Tables() : hasHw(false)
+    {
+        Fill(crc32, CRC32_POLY);
+        Fill(crc32c, CRC32C_POLY);
+#ifdef CRC32C_HW_SUPPORT
+        unsigned int eax, ebx, ecx, edx;
+        if (__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+            hasHw = (ecx & bit_SSE4_2) != 0;
+        }
+#endif
+    }
+
+  private:
+    static void Fill(uint32_t table[8][256], uint32_t poly)
+    {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t crc = i;
+            for (int j = 0; j < 8; ++j) {
+                crc = (crc & 1) ? ((crc >> 1) ^ poly) : (crc >> 1);
+            }
+            table[0][i] = crc;
+        }
+        for (uint32_t i = 0; i < 256; ++i) {
+            for (int k = 1; k < 8; ++k) {
+                table[k][i] = (table[k - 1][i] >> 8) ^ table[0][table[k - 1][i] & 0xFF];
+            }
+        }
+    }
+};
+
+/* Built during static initialization before any thread can compute a checksum */
+static const Crc32Tables tables;
+
+/* Update a pre-inverted crc. Bytes are loaded individually so the result is endian independent */
+static uint32_t SliceBy8(const uint32_t table[8][256], const uint8_t* p, size_t len, uint32_t crc)
+{
+    while (len >= 8) {
+        crc ^= static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+               (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+        crc = table[7][crc & 0xFF] ^ table[6][(crc >> 8) & 0xFF] ^
+              table[5][(crc >> 16) & 0xFF] ^ table[4][crc >> 24] ^
+              table[3][p[4]] ^ table[2][p[5]] ^ table[1][p[6]] ^ table[0][p[7]];
+        p += 8;
+        len -= 8;
+    }
+    while (len--) {
+        crc = (crc >> 8) ^ table[0][(crc ^ *p++) & 0xFF];
+    }
+    return crc;
+}
+
+#ifdef CRC32C_HW_SUPPORT
+__attribute__((target("sse4.2")))
+static uint32_t HwCrc32c(const uint8_t* p, size_t len, uint32_t crc)
+{
+    /* Align to 8 bytes so the wide loads do not straddle cache lines */
+    while (len && (reinterpret_cast<uintptr_t>(p) & 7)) {
+        crc = _mm_crc32_u8(crc, *p++);
+        --len;
+    }
+#if defined(__x86_64__)
+    uint64_t crc64 = crc;
+    while (len >= 8) {
+        uint64_t v;
+        ::memcpy(&v, p, sizeof(v));
+        crc64 = _mm_crc32_u64(crc64, v);
+        p += 8;
+        len -= 8;
+    }
+    crc = static_cast<uint32_t>(crc64);
+#endif
+    while (len >= 4) {
+        uint32_t v;
+        ::memcpy(&v, p, sizeof(v));
+        crc = _mm_crc32_u32(crc, v);
+        p += 4;
+        len -= 4;
+    }
+    while (len--) {
+        crc = _mm_crc32_u8(crc, *p++);
+    }
+    return crc;
+}
+#endif
+
+uint32_t CRC32_Compute(const void* buf, size_t len, uint32_t crc)
+{
+    return ~SliceBy8(tables.crc32, static_cast<const uint8_t*>(buf), len, ~crc);
+}
+
+uint32_t CRC32C_Compute(const void* buf, size_t len, uint32_t crc)
+{
+#ifdef CRC32C_HW_SUPPORT
+    if (tables.hasHw) {
+        return ~HwCrc32c(static_cast<const uint8_t*>(buf), len, ~crc);
+    }
+#endif
+    return ~SliceBy8(tables.crc32c, static_cast<const uint8_t*>(buf), len, ~crc);
+}
+
+uint32_t CRC32C_ComputeSoftware(const void* buf, size_t len, uint32_t crc)
+{
+    return ~SliceBy8(tables.crc32c, static_cast<const uint8_t*>(buf), len, ~crc);
+}
+
+bool CRC32C_IsHardwareAccelerated()
+{
+    return tables.hasHw;
+}
+
+}
@@ -0,0 +1,68 @@
+/**
+ * @file
+ * Table driven and hardware accelerated CRC-32 checksums.
+ */
+
+/******************************************************************************
+ * Copyright 2012, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#ifndef _ALLJOYN_CRC32_H
+#define _ALLJOYN_CRC32_H
+
+#include <qcc/platform.h>
+
+namespace ajn {
+
+/**
+ * Compute the CRC-32 (IEEE 802.3 polynomial, as used by the STUN FINGERPRINT attribute) of a
+ * buffer. The table driven implementation consumes 8 bytes per step (slicing-by-8).
+ *
+ * @param buf   Buffer to compute the CRC over.
+ * @param len   Length of the buffer.
+ * @param crc   Result of a previous call when the CRC spans several buffers, otherwise 0.
+ * @return  The CRC-32 of the data.
+ */
+uint32_t CRC32_Compute(const void* buf, size_t len, uint32_t crc = 0);
+
+/**
+ * Compute the CRC-32C (Castagnoli polynomial) of a buffer. The SSE4.2 crc32 instruction is used
+ * when the processor supports it, otherwise the slicing-by-8 implementation is used.
+ *
+ * @param buf   Buffer to compute the CRC over.
+ * @param len   Length of the buffer.
+ * @param crc   Result of a previous call when the CRC spans several buffers, otherwise 0.
+ * @return  The CRC-32C of the data.
+ */
+uint32_t CRC32C_Compute(const void* buf, size_t len, uint32_t crc = 0);
+
+/**
+ * Compute the CRC-32C of a buffer with the slicing-by-8 implementation regardless of processor
+ * support for the crc32 instruction.
+ *
+ * @param buf   Buffer to compute the CRC over.
+ * @param len   Length of the buffer.
+ * @param crc   Result of a previous call when the CRC spans several buffers, otherwise 0.
+ * @return  The CRC-32C of the data.
+ */
+uint32_t CRC32C_ComputeSoftware(const void* buf, size_t len, uint32_t crc = 0);
+
+/**
+ * Return true if CRC32C_Compute uses the SSE4.2 crc32 instruction.
+ */
+bool CRC32C_IsHardwareAccelerated();
+
+}
+
+#endif
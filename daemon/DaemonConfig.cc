@@ -106,6 +106,11 @@ std::vector<qcc::String> DaemonConfig::GetList(const char* key)
     return result;
 }
 
+std::vector<const XmlElement*> DaemonConfig::GetElements(const char* key)
+{
+    return config->GetPath(key);
+}
+
 bool DaemonConfig::Has(const char* key)
 {
     String path = key;
@@ -100,6 +100,15 @@ class DaemonConfig {
      */
     std::vector<qcc::String> GetList(const char* key);
 
+    /**
+     * Get the XML elements that share the same key, for sections of the configuration that have
+     * more structure than a list of values.  The elements belong to the configuration and are only
+     * valid until it is released.
+     *
+     * @param key   The key is a dotted path to the elements in the XML
+     */
+    std::vector<const qcc::XmlElement*> GetElements(const char* key);
+
     /**
      * Check if the configuration has a specific key.
      */
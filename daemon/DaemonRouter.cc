@@ -34,7 +34,9 @@
 
 #include "BusController.h"
 #include "BusEndpoint.h"
+#include "DaemonConfig.h"
 #include "DaemonRouter.h"
+#include "MessageTrace.h"
 
 #define QCC_MODULE "ALLJOYN"
 
@@ -47,10 +49,12 @@ namespace ajn {
 
 DaemonRouter::DaemonRouter() : endpointRefs(0), localEndpoint(NULL), closing(false), ruleTable(), nameTable(), busController(NULL)
 {
+    nameTable.AddListener(&policy);
 }
 
 DaemonRouter::~DaemonRouter()
 {
+    nameTable.RemoveListener(&policy);
     closing = true;
     while (endpointRefs) {
         qcc::Sleep(1);
@@ -60,6 +64,7 @@ DaemonRouter::~DaemonRouter()
 static inline QStatus SendThroughEndpoint(Message& msg, BusEndpoint& ep, SessionId sessionId)
 {
     QStatus status;
+    MessageTrace::Trace(msg, MessageTrace::ROUTED);
     if ((sessionId != 0) && (ep.GetEndpointType() == BusEndpoint::ENDPOINT_TYPE_VIRTUAL)) {
         status = static_cast<VirtualEndpoint&>(ep).PushMessage(msg, sessionId);
     } else {
@@ -83,6 +88,9 @@ QStatus DaemonRouter::PushMessage(Message& msg, BusEndpoint& origSender)
     }
     assert(localEndpoint);
 
+#ifndef NDEBUG
+    uint64_t routeStart = GetMicroTimestamp();
+#endif
     QStatus status = ER_OK;
     BusEndpoint* sender = &origSender;
     bool replyExpected = (msg->GetType() == MESSAGE_METHOD_CALL) && ((msg->GetFlags() & ALLJOYN_FLAG_NO_REPLY_EXPECTED) == 0);
@@ -116,6 +124,18 @@ QStatus DaemonRouter::PushMessage(Message& msg, BusEndpoint& origSender)
                                    msg->GetCallSerial()));
                     msg->ErrorMsg(msg, "org.alljoyn.Bus.Blocked", "Method reply would be blocked because caller does not allow remote messages");
                     PushMessage(msg, *localEndpoint);
+                } else if (!OKToDeliver(msg, *sender, *destEndpoint)) {
+                    QCC_DbgPrintf(("Policy denies %s from %s to %s",
+                                   msg->Description().c_str(),
+                                   msg->GetSender(),
+                                   destEndpoint->GetUniqueName().c_str()));
+                    status = ER_BUS_POLICY_VIOLATION;
+                    if (replyExpected) {
+                        qcc::String description("Rejected by policy: ");
+                        description += msg->Description();
+                        msg->ErrorMsg(msg, "org.freedesktop.DBus.Error.AccessDenied", description.c_str());
+                        PushMessage(msg, *localEndpoint);
+                    }
                 } else {
                     destEndpoint->IncrementPushCount();
                     nameTable.Unlock();
@@ -136,7 +156,7 @@ QStatus DaemonRouter::PushMessage(Message& msg, BusEndpoint& origSender)
                     PushMessage(msg, *localEndpoint);
                 }
             }
-            if ((ER_OK != status) && (ER_BUS_ENDPOINT_CLOSING != status)) {
+            if ((ER_OK != status) && (ER_BUS_ENDPOINT_CLOSING != status) && (ER_BUS_POLICY_VIOLATION != status)) {
                 QCC_LogError(status, ("BusEndpoint::PushMessage failed"));
             }
             nameTable.Unlock();
@@ -179,7 +199,8 @@ QStatus DaemonRouter::PushMessage(Message& msg, BusEndpoint& origSender)
                  * If the message originated locally or the destination allows remote messages
                  * forward the message, otherwise silently ignore it.
                  */
-                if (!((sender->GetEndpointType() == BusEndpoint::ENDPOINT_TYPE_BUS2BUS) && !dest->AllowRemoteMessages())) {
+                if (!((sender->GetEndpointType() == BusEndpoint::ENDPOINT_TYPE_BUS2BUS) && !dest->AllowRemoteMessages()) &&
+                    OKToDeliver(msg, *sender, *dest)) {
                     dest->IncrementPushCount();
                     ruleTable.Unlock();
                     nameTable.Unlock();
@@ -229,7 +250,7 @@ QStatus DaemonRouter::PushMessage(Message& msg, BusEndpoint& origSender)
         SessionCastEntry sce(sessionId, msg->GetSender(), NULL, NULL);
         set<SessionCastEntry>::iterator sit = sessionCastSet.lower_bound(sce);
         while ((sit != sessionCastSet.end()) && (sit->id == sce.id) && (sit->src == sce.src)) {
-            if (!sit->b2bEp || (sit->b2bEp != lastB2b)) {
+            if ((!sit->b2bEp || (sit->b2bEp != lastB2b)) && OKToDeliver(msg, *sender, *sit->destEp)) {
                 lastB2b = sit->b2bEp;
                 SessionCastEntry entry = *sit;
                 BusEndpoint*ep = sit->destEp;
@@ -248,10 +269,32 @@ QStatus DaemonRouter::PushMessage(Message& msg, BusEndpoint& origSender)
         sessionCastSetLock.Unlock(MUTEX_CONTEXT);
     }
 
+#ifndef NDEBUG
+    routeLatency.Record(&origSender, routeStart);
+#endif
     DecrementAndFetch(&endpointRefs);
     return status;
 }
 
+QStatus DaemonRouter::LoadPolicy(DaemonConfig& config)
+{
+    QStatus status = policy.Compile(config.GetElements("policy"));
+
+    /* Tell the policy who owns the names that were claimed before it was compiled */
+    vector<qcc::String> names;
+    nameTable.GetBusNames(names);
+    for (size_t i = 0; i < names.size(); ++i) {
+        nameTable.Lock();
+        BusEndpoint* ep = nameTable.FindEndpoint(names[i]);
+        qcc::String owner = ep ? ep->GetUniqueName() : "";
+        nameTable.Unlock();
+        if (!owner.empty() && (names[i] != owner)) {
+            policy.NameOwnerChanged(names[i], NULL, &owner);
+        }
+    }
+    return status;
+}
+
 void DaemonRouter::GetBusNames(vector<qcc::String>& names) const
 {
     nameTable.GetBusNames(names);
@@ -322,6 +365,19 @@ void DaemonRouter::UnregisterEndpoint(BusEndpoint& endpoint)
 {
     QCC_DbgTrace(("UnregisterEndpoint: %s (type=%d)", endpoint.GetUniqueName().c_str(), endpoint.GetEndpointType()));
 
+#ifndef NDEBUG
+    /* Keep the traffic counters of remote endpoints in the totals for their transport */
+    if ((BusEndpoint::ENDPOINT_TYPE_BUS2BUS == endpoint.GetEndpointType()) || (BusEndpoint::ENDPOINT_TYPE_REMOTE == endpoint.GetEndpointType())) {
+        RemoteEndpoint& rep = static_cast<RemoteEndpoint&>(endpoint);
+        RemoteEndpoint::Stats stats;
+        rep.GetStats(stats);
+        stats.txQueueDepth = 0;
+        retiredStatsLock.Lock(MUTEX_CONTEXT);
+        retiredStats[rep.GetTransportName()].Add(stats);
+        retiredStatsLock.Unlock(MUTEX_CONTEXT);
+    }
+#endif
+
     if (BusEndpoint::ENDPOINT_TYPE_BUS2BUS == endpoint.GetEndpointType()) {
         /* Inform bus controller of bus-to-bus endpoint removal */
         RemoteEndpoint* busToBusEndpoint = static_cast<RemoteEndpoint*>(&endpoint);
@@ -494,4 +550,67 @@ void DaemonRouter::RemoveSessionRoutes(const char* src, SessionId id)
     sessionCastSetLock.Unlock(MUTEX_CONTEXT);
 }
 
+size_t DaemonRouter::GetNumSessionCastRoutes()
+{
+    sessionCastSetLock.Lock(MUTEX_CONTEXT);
+    size_t numRoutes = sessionCastSet.size();
+    sessionCastSetLock.Unlock(MUTEX_CONTEXT);
+    return numRoutes;
+}
+
+#ifndef NDEBUG
+void DaemonRouter::GetEndpointMetrics(vector<EndpointMetrics>& metrics)
+{
+    /*
+     * Endpoints are removed from the name table and the bus-to-bus set before they are destroyed
+     * so holding the locks keeps them alive while their counters are read.
+     */
+    vector<qcc::String> names;
+    nameTable.Lock();
+    nameTable.GetBusNames(names);
+    for (vector<qcc::String>::const_iterator it = names.begin(); it != names.end(); ++it) {
+        if ((*it)[0] != ':') {
+            continue;
+        }
+        BusEndpoint* ep = nameTable.FindEndpoint(*it);
+        if (ep && (ep->GetEndpointType() == BusEndpoint::ENDPOINT_TYPE_REMOTE)) {
+            RemoteEndpoint* rep = static_cast<RemoteEndpoint*>(ep);
+            EndpointMetrics m;
+            m.uniqueName = *it;
+            m.transportName = rep->GetTransportName();
+            rep->GetStats(m.stats);
+            metrics.push_back(m);
+        }
+    }
+    nameTable.Unlock();
+
+    m_b2bEndpointsLock.Lock(MUTEX_CONTEXT);
+    for (set<RemoteEndpoint*>::const_iterator it = m_b2bEndpoints.begin(); it != m_b2bEndpoints.end(); ++it) {
+        EndpointMetrics m;
+        m.uniqueName = (*it)->GetUniqueName();
+        m.transportName = (*it)->GetTransportName();
+        (*it)->GetStats(m.stats);
+        metrics.push_back(m);
+    }
+    m_b2bEndpointsLock.Unlock(MUTEX_CONTEXT);
+}
+
+void DaemonRouter::GetTransportMetrics(map<qcc::String, TransportMetrics>& metrics)
+{
+    retiredStatsLock.Lock(MUTEX_CONTEXT);
+    for (map<qcc::String, RemoteEndpoint::Stats>::const_iterator it = retiredStats.begin(); it != retiredStats.end(); ++it) {
+        metrics[it->first].stats.Add(it->second);
+    }
+    retiredStatsLock.Unlock(MUTEX_CONTEXT);
+
+    vector<EndpointMetrics> endpoints;
+    GetEndpointMetrics(endpoints);
+    for (vector<EndpointMetrics>::const_iterator it = endpoints.begin(); it != endpoints.end(); ++it) {
+        TransportMetrics& tm = metrics[it->transportName];
+        tm.numEndpoints++;
+        tm.stats.Add(it->stats);
+    }
+}
+#endif
+
 }
@@ -24,6 +24,9 @@
 
 #include <qcc/platform.h>
 
+#include <map>
+#include <vector>
+
 #include <qcc/Thread.h>
 
 #include "Transport.h"
@@ -34,6 +37,9 @@
 #include "Router.h"
 #include "NameTable.h"
 #include "RuleTable.h"
+#include "RemoteEndpoint.h"
+#include "LatencyHistogram.h"
+#include "PolicyEngine.h"
 
 namespace ajn {
 
@@ -41,6 +47,7 @@ namespace ajn {
  * @internal Forward delcarations
  */
 class BusController;
+class DaemonConfig;
 
 /**
  * DaemonRouter is a "full-featured" router responsible for routing Bus messages
@@ -84,6 +91,24 @@ class DaemonRouter : public Router {
      */
     void RemoveBusNameListener(NameListener* listener) { nameTable.RemoveListener(listener); }
 
+    /**
+     * Compile the <policy> sections of the daemon configuration.  Messages between connections to
+     * this daemon are only checked against the policy if the configuration has send or receive
+     * rules.
+     *
+     * @param config   The daemon configuration.
+     *
+     * @return  ER_OK if the policy was compiled, ER_BUS_BAD_XML if it is malformed.
+     */
+    QStatus LoadPolicy(DaemonConfig& config);
+
+    /**
+     * Get the policy engine.
+     *
+     * @return  The policy engine.
+     */
+    PolicyEngine& GetPolicy() { return policy; }
+
     /**
      * Set GUID of the bus.
      *
@@ -310,13 +335,99 @@ class DaemonRouter : public Router {
      */
     void RemoveSessionRoutes(const char* uniqueName, SessionId id);
 
+#ifndef NDEBUG
+    /**
+     * Traffic counters of a remote or bus-to-bus endpoint.  The counters and the route latency
+     * are only kept in debug builds where the debug object reports them.
+     */
+    struct EndpointMetrics {
+        qcc::String uniqueName;         /**< Unique name of the endpoint */
+        qcc::String transportName;      /**< Transport the endpoint belongs to */
+        RemoteEndpoint::Stats stats;    /**< Counters */
+    };
+
+    /**
+     * Traffic counters summed over the endpoints of a transport.
+     */
+    struct TransportMetrics {
+        uint32_t numEndpoints;          /**< Number of endpoints currently connected */
+        RemoteEndpoint::Stats stats;    /**< Counters including endpoints that have gone away */
+        TransportMetrics() : numEndpoints(0) { }
+    };
+
+    /**
+     * Get the traffic counters of the remote and bus-to-bus endpoints that are currently registered.
+     *
+     * @param[out] metrics   Counters for each endpoint.
+     */
+    void GetEndpointMetrics(std::vector<EndpointMetrics>& metrics);
+
+    /**
+     * Get the traffic counters of each transport.
+     *
+     * @param[out] metrics   Map of transport name to counters.
+     */
+    void GetTransportMetrics(std::map<qcc::String, TransportMetrics>& metrics);
+
+    /**
+     * Get the histogram of the time taken to route each message pushed to the router.
+     *
+     * @return  The histogram.
+     */
+    LatencyHistogram& GetRouteLatency() { return routeLatency; }
+#endif
+
+    /**
+     * Get the number of rules in the rule table.
+     */
+    size_t GetNumRules() { return ruleTable.GetNumRules(); }
+
+    /**
+     * Get the number of unique names in the name table.
+     */
+    size_t GetNumUniqueNames() const { return nameTable.GetNumUniqueNames(); }
+
+    /**
+     * Get the number of alias (well-known) names in the name table.
+     */
+    size_t GetNumAliasNames() const { return nameTable.GetNumAliasNames(); }
+
+    /**
+     * Get the number of session multicast routes.
+     */
+    size_t GetNumSessionCastRoutes();
+
   private:
+
+    /**
+     * Check the policy for a message about to be pushed to an endpoint.  Only messages between two
+     * connections to this daemon are checked: the policy knows nothing of the names owned by
+     * connections to other daemons and messages from the daemon itself are always allowed.
+     *
+     * @param msg      The message.
+     * @param sender   The endpoint the message came from.
+     * @param dest     The endpoint the message is for.
+     *
+     * @return  true if the message may be delivered.
+     */
+    bool OKToDeliver(Message& msg, BusEndpoint& sender, BusEndpoint& dest)
+    {
+        if (!policy.IsEnabled() || (&sender == localEndpoint) ||
+            (sender.GetEndpointType() == BusEndpoint::ENDPOINT_TYPE_BUS2BUS) ||
+            (dest.GetEndpointType() == BusEndpoint::ENDPOINT_TYPE_BUS2BUS) ||
+            (dest.GetEndpointType() == BusEndpoint::ENDPOINT_TYPE_VIRTUAL)) {
+            return true;
+        }
+        return policy.OKToDeliver(msg, dest.GetUniqueName());
+    }
+
     int32_t endpointRefs;           /**< Reference count tracking endpoints in use */
     LocalEndpoint* localEndpoint;   /**< The local endpoint */
     bool closing;                   /**< Indicates router is closing */
     RuleTable ruleTable;            /**< Routing rule table */
     NameTable nameTable;            /**< BusName to transport lookupl table */
     BusController* busController;   /**< The bus controller used with this router */
+    PolicyEngine policy;            /**< Send and receive rules from the daemon configuration */
 
     std::set<RemoteEndpoint*> m_b2bEndpoints;  /**< Collection of Bus-to-bus endpoints */
     qcc::Mutex m_b2bEndpointsLock;       /**< Lock that protects m_b2bEndpoints */
@@ -341,6 +452,12 @@ class DaemonRouter : public Router {
     };
     std::set<SessionCastEntry> sessionCastSet;
     qcc::Mutex sessionCastSetLock;      /**< Lock that protects sessionCastSet */
+
+#ifndef NDEBUG
+    LatencyHistogram routeLatency;      /**< Time spent in PushMessage */
+    std::map<qcc::String, RemoteEndpoint::Stats> retiredStats;  /**< Counters of unregistered endpoints by transport */
+    qcc::Mutex retiredStatsLock;        /**< Lock that protects retiredStats */
+#endif
 };
 
 }
@@ -0,0 +1,86 @@
+/**
+ * @file
+ * EpochGuard tells a writer when an object it has unpublished can no longer be reached by
+ * lookups that run without a lock.
+ */
+
+/******************************************************************************
+ * Copyright 2012, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#include <qcc/platform.h>
+
+#include <qcc/atomic.h>
+
+#include "EpochGuard.h"
+
+using namespace qcc;
+
+namespace ajn {
+
+EpochGuard::EpochGuard() : lookupEpoch(0)
+{
+    lookupCount[0] = 0;
+    lookupCount[1] = 0;
+}
+
+int32_t EpochGuard::EnterLookup()
+{
+    /*
+     * Count this lookup against the current epoch.  If the epoch changed before the count was
+     * visible, the writer may already have seen that counter at zero so count it again.
+     */
+    while (true) {
+        int32_t epoch = lookupEpoch;
+        IncrementAndFetch(&lookupCount[epoch & 1]);
+        if (epoch == lookupEpoch) {
+            return epoch;
+        }
+        DecrementAndFetch(&lookupCount[epoch & 1]);
+    }
+}
+
+void EpochGuard::ExitLookup(int32_t epoch)
+{
+    DecrementAndFetch(&lookupCount[epoch & 1]);
+}
+
+void EpochGuard::Retire(Ticket& ticket)
+{
+    /*
+     * The increment is a full barrier so the counters are only read by Reclaimable() after the
+     * object was unpublished.  New lookups go to the other counter and can't find the object.
+     */
+    IncrementAndFetch(&lookupEpoch);
+    ticket.drained[0] = false;
+    ticket.drained[1] = false;
+}
+
+bool EpochGuard::Reclaimable(Ticket& ticket)
+{
+    for (int32_t i = 0; i < 2; ++i) {
+        if (!ticket.drained[i] && (lookupCount[i] == 0)) {
+            ticket.drained[i] = true;
+        }
+    }
+    return ticket.drained[0] && ticket.drained[1];
+}
+
+void EpochGuard::Advance()
+{
+    IncrementAndFetch(&lookupEpoch);
+}
+
+}
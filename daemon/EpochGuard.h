@@ -0,0 +1,108 @@
+/**
+ * @file
+ * EpochGuard tells a writer when an object it has unpublished can no longer be reached by
+ * lookups that run without a lock.
+ */
+
+/******************************************************************************
+ * Copyright 2012, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#ifndef _ALLJOYN_EPOCHGUARD_H
+#define _ALLJOYN_EPOCHGUARD_H
+
+#include <qcc/platform.h>
+
+namespace ajn {
+
+/**
+ * Lookups without a lock are counted against the parity of the current epoch.  A writer
+ * unpublishes an object under its own lock and retires it, which starts a new epoch so that new
+ * lookups are counted against the other parity.  A lookup that can still see the object started
+ * before it was retired and so is counted in one of the two counters, depending on how many
+ * epochs ago it started.  The object may therefore be freed once each of the two counters has
+ * been seen at zero after the object was retired.  Checking only the counter of the parity the
+ * object was retired in is not enough: after two more retirements a lookup of that epoch is
+ * counted against the other parity.
+ *
+ * Retire(), Reclaimable() and Advance() must be serialized by the writer, normally with the lock
+ * that protects updates to the published objects.  EnterLookup() and ExitLookup() take no lock.
+ */
+class EpochGuard {
+  public:
+
+    /**
+     * Tracks the grace period of one retired object.
+     */
+    struct Ticket {
+        bool drained[2];    /**< The lookup counter of each parity has been seen at zero */
+    };
+
+    /**
+     * Constructor
+     */
+    EpochGuard();
+
+    /**
+     * Start a lookup without the writer lock.  Anything loaded after this returns stays valid
+     * until ExitLookup().
+     *
+     * @return  The epoch to pass to ExitLookup().
+     */
+    int32_t EnterLookup();
+
+    /**
+     * End a lookup started with EnterLookup().
+     *
+     * @param epoch  The epoch returned by EnterLookup().
+     */
+    void ExitLookup(int32_t epoch);
+
+    /**
+     * Retire an object that has just been unpublished.  Called by the writer.
+     *
+     * @param ticket  Returns the ticket to pass to Reclaimable() for the object.
+     */
+    void Retire(Ticket& ticket);
+
+    /**
+     * Check whether a retired object can be freed.  Called by the writer.
+     *
+     * @param ticket  The ticket of the object, updated with the counters seen at zero.
+     *
+     * @return  true if no lookup can still be using the object.
+     */
+    bool Reclaimable(Ticket& ticket);
+
+    /**
+     * Start a new epoch so that a counter that busy lookups keep above zero can drain.  Called by
+     * the writer after a pass over its retired objects left some of them waiting.
+     */
+    void Advance();
+
+  private:
+
+    volatile int32_t lookupEpoch;       /**< Low bit selects lookupCount for new lookups */
+    volatile int32_t lookupCount[2];    /**< Lookups in progress for each epoch parity */
+
+    /* Private copy constructor */
+    EpochGuard(const EpochGuard&);
+
+    /* Private assignment operator */
+    EpochGuard& operator=(const EpochGuard&);
+};
+
+}
+
+#endif
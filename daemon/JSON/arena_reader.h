@@ -0,0 +1,224 @@
+/**
+ * @file
+ * arena_reader.h
+ */
+
+/******************************************************************************
+ * Copyright 2012, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#ifndef JSON_ARENA_READER_H_INCLUDED
+# define JSON_ARENA_READER_H_INCLUDED
+
+# include "value.h"
+# include <stddef.h>
+# include <string>
+# include <vector>
+
+namespace Json {
+
+/** \brief Memory arena that values are allocated from.
+ *
+ * Memory is taken from pages obtained with malloc. Individual allocations
+ * cannot be released; all the memory is released at once when the arena is
+ * cleared or destroyed. Allocations larger than half a page get a page of
+ * their own.
+ *
+ * Like json_batchallocator.h, nothing allocated from the arena is ever
+ * destructed, so only POD types may be placed in it.
+ */
+class JSON_API Arena {
+  public:
+    /** \brief Constructs an empty arena.
+     * \param pageSize Size of the pages memory is taken from.
+     */
+    Arena(size_t pageSize = 4096);
+
+    ~Arena();
+
+    /** \brief Allocate memory aligned for any scalar type.
+     * \return Pointer to the memory or 0 if malloc failed.
+     */
+    void*allocate(size_t size);
+
+    /** \brief Release everything allocated from the arena.
+     *
+     * The most recently used page is kept for reuse so that an arena that is
+     * cleared and refilled with a similar amount of data does not go back to
+     * malloc.
+     */
+    void clear();
+
+  private:
+    struct Page {
+        Page*next_;
+        size_t size_;
+        size_t used_;
+    };
+
+    // disabled copy constructor and assignement operator.
+    Arena(const Arena&);
+    void operator =(const Arena&);
+
+    Page*allocatePage(size_t size);
+
+    Page*pages_;
+    size_t pageSize_;
+};
+
+/** \brief Read-only JSON value produced by ArenaReader.
+ *
+ * ArenaValue supports the subset of the Value interface used to extract data
+ * from a parsed document. Strings point into the parsed document and
+ * array/object members live in the Arena passed to ArenaReader::parse(), so a
+ * value is only valid while both are.
+ *
+ * Looking up a missing member or index returns ArenaValue::null, and the as*()
+ * conversions never assert: a value of the wrong type converts to 0, false or
+ * the empty string.
+ */
+class JSON_API ArenaValue {
+  public:
+    static const ArenaValue null;
+
+    ArenaValue() : type_(nullValue), size_(0), name_(0) { value_.children_ = 0; }
+
+    ValueType type() const { return type_; }
+
+    /// Member name if this value is a member of an object, otherwise 0.
+    const char*name() const { return name_; }
+
+    bool isNull() const { return type_ == nullValue; }
+    bool isBool() const { return type_ == booleanValue; }
+    bool isInt() const { return type_ == intValue; }
+    bool isUInt() const { return type_ == uintValue; }
+    bool isIntegral() const { return type_ == intValue || type_ == uintValue || type_ == booleanValue; }
+    bool isDouble() const { return type_ == realValue; }
+    bool isNumeric() const { return isIntegral() || isDouble(); }
+    bool isString() const { return type_ == stringValue; }
+    bool isArray() const { return type_ == arrayValue; }
+    bool isObject() const { return type_ == objectValue; }
+
+    const char*asCString() const;
+    Int asInt() const;
+    UInt asUInt() const;
+    double asDouble() const;
+    bool asBool() const;
+
+    /// Return true if this is a string equal to str.
+    bool operator==(const char*str) const;
+    bool operator!=(const char*str) const { return !(*this == str); }
+
+    /// Number of values in array or object
+    UInt size() const { return (isArray() || isObject()) ? size_ : 0; }
+
+    /// \brief Return true if empty array, empty object, or null;
+    /// otherwise, false.
+    bool empty() const { return isNull() || size() == 0; }
+
+    /// Access an array element (zero based index). Returns null if out of range.
+    const ArenaValue& operator[](UInt index) const;
+
+    /// Access the values of an array or object in document order. Returns null if out of range.
+    const ArenaValue& member(UInt index) const;
+
+    /// Access an object member. Returns null if there is no such member.
+    const ArenaValue& operator[](const char*key) const;
+
+    /// Return true if the object has a member named key.
+    bool isMember(const char*key) const { return find(key) != 0; }
+
+    /// Return the member named key or 0. If the name is repeated the last one wins, as with Value.
+    const ArenaValue*find(const char*key) const;
+
+  private:
+    friend class ArenaReader;
+
+    ValueType type_;
+    UInt size_;                     ///< String length or number of members
+    const char*name_;
+    union {
+        Int int_;
+        UInt uint_;
+        double real_;
+        bool bool_;
+        const char*string_;
+        const ArenaValue*children_;
+    } value_;
+};
+
+/** \brief Single pass <a HREF="http://www.json.org">JSON</a> reader that parses a
+ * document in place.
+ *
+ * Unlike Reader, which builds a tree of Value with one allocation per node,
+ * string and member, ArenaReader decodes strings within the document buffer
+ * and allocates the members of each array and object as one block from an
+ * Arena. The parse is iterative, so deeply nested documents cannot overflow
+ * the stack.
+ *
+ * Numbers and escapes are decoded the same way Reader decodes them, and any
+ * value is accepted as the root. Comments are not supported and nothing but
+ * whitespace may follow the root value.
+ */
+class JSON_API ArenaReader {
+  public:
+    ArenaReader();
+
+    /** \brief Read a value from a JSON document, decoding it in place.
+     * \param beginDoc Pointer on the beginning of the UTF-8 encoded document.
+     *                 The document is modified: strings are unescaped and
+     *                 NUL terminated where they lie.
+     * \param endDoc Pointer on the end of the document.
+     * \param arena Arena the arrays and objects are allocated from.
+     * \param root [out] Contains the root value of the document if it was
+     *             successfully parsed.
+     * \return \c true if the document was successfully parsed, \c false if an error occurred.
+     */
+    bool parse(char*beginDoc, char*endDoc, Arena& arena, const ArenaValue*& root);
+
+    /** \brief Returns a user friendly string that describes the error of the last parse.
+     * \return Formatted error message with the offset in the document at which the
+     *         error was found.
+     */
+    std::string getFormatedErrorMessages() const;
+
+  private:
+    struct Frame {
+        ValueType type_;
+        size_t first_;              ///< Index of the first member in values_
+        const char*name_;           ///< Name of the container in its parent object
+    };
+
+    bool readScalar(ArenaValue& value);
+    bool readString(const char*& str, UInt& len);
+    bool readNumber(ArenaValue& value);
+    bool readName(const char*& name);
+    bool closeContainer(Arena& arena, ArenaValue& value);
+    bool decodeUnicodeEscape(unsigned int& unicode);
+    void skipSpaces();
+    bool addError(const char*message);
+
+    std::vector<ArenaValue> values_;    ///< Members of the containers being read
+    std::vector<Frame> frames_;         ///< Containers being read
+    char*begin_;
+    char*end_;
+    char*current_;
+    const char*error_;
+    size_t errorOffset_;
+};
+
+} // namespace Json
+
+#endif // JSON_ARENA_READER_H_INCLUDED
@@ -18,5 +18,6 @@
 # include "reader.h"
 # include "writer.h"
 # include "json_features.h"
+# include "arena_reader.h"
 
 #endif // JSON_JSON_H_INCLUDED
@@ -0,0 +1,646 @@
+/**
+ * @file
+ * json_arena_reader.cc
+ */
+
+/******************************************************************************
+ * Copyright 2012, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#include "arena_reader.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace Json {
+
+// Implementation of class Arena
+// ////////////////////////////////
+
+// Size of the page header rounded up so that the data that follows is aligned.
+static const size_t pageHeaderSize = (sizeof(void*) + 2 * sizeof(size_t) + sizeof(double) - 1) & ~(sizeof(double) - 1);
+
+Arena::Arena(size_t pageSize)
+    : pages_(0)
+    , pageSize_(pageSize)
+{
+}
+
+
+Arena::~Arena()
+{
+    while (pages_) {
+        Page*next = pages_->next_;
+        free(pages_);
+        pages_ = next;
+    }
+}
+
+
+Arena::Page*Arena::allocatePage(size_t size)
+{
+    Page*page = static_cast<Page*>(malloc(pageHeaderSize + size));
+    if (page) {
+        page->next_ = 0;
+        page->size_ = size;
+        page->used_ = 0;
+    }
+    return page;
+}
+
+
+void*Arena::allocate(size_t size)
+{
+    size = (size + sizeof(double) - 1) & ~(sizeof(double) - 1);
+
+    if (pages_  &&  size <= pages_->size_ - pages_->used_) {
+        void*allocated = reinterpret_cast<char*>(pages_) + pageHeaderSize + pages_->used_;
+        pages_->used_ += size;
+        return allocated;
+    }
+
+    Page*page;
+    if (size > pageSize_ / 2) {
+        // Large blocks get a page of their own, behind the current page so
+        // that what is left of the current page is not wasted.
+        page = allocatePage(size);
+        if (!page)
+            return 0;
+        if (pages_) {
+            page->next_ = pages_->next_;
+            pages_->next_ = page;
+        } else {
+            pages_ = page;
+        }
+    } else {
+        page = allocatePage(pageSize_);
+        if (!page)
+            return 0;
+        page->next_ = pages_;
+        pages_ = page;
+    }
+    page->used_ = size;
+    return reinterpret_cast<char*>(page) + pageHeaderSize;
+}
+
+
+void Arena::clear()
+{
+    if (pages_) {
+        Page*page = pages_->next_;
+        while (page) {
+            Page*next = page->next_;
+            free(page);
+            page = next;
+        }
+        pages_->next_ = 0;
+        pages_->used_ = 0;
+    }
+}
+
+
+// Implementation of class ArenaValue
+// ////////////////////////////////
+
+const ArenaValue ArenaValue::null;
+
+
+const char*ArenaValue::asCString() const
+{
+    return (type_ == stringValue) ? value_.string_ : "";
+}
+
+
+Int ArenaValue::asInt() const
+{
+    switch (type_) {
+    case intValue:
+        return value_.int_;
+
+    case uintValue:
+        return Int(value_.uint_);
+
+    case realValue:
+        return Int(value_.real_);
+
+    case booleanValue:
+        return value_.bool_ ? 1 : 0;
+
+    default:
+        return 0;
+    }
+}
+
+
+UInt ArenaValue::asUInt() const
+{
+    switch (type_) {
+    case intValue:
+        return UInt(value_.int_);
+
+    case uintValue:
+        return value_.uint_;
+
+    case realValue:
+        return UInt(value_.real_);
+
+    case booleanValue:
+        return value_.bool_ ? 1 : 0;
+
+    default:
+        return 0;
+    }
+}
+
+
+double ArenaValue::asDouble() const
+{
+    switch (type_) {
+    case intValue:
+        return value_.int_;
+
+    case uintValue:
+        return value_.uint_;
+
+    case realValue:
+        return value_.real_;
+
+    case booleanValue:
+        return value_.bool_ ? 1.0 : 0.0;
+
+    default:
+        return 0.0;
+    }
+}
+
+
+bool ArenaValue::asBool() const
+{
+    switch (type_) {
+    case intValue:
+        return value_.int_ != 0;
+
+    case uintValue:
+        return value_.uint_ != 0;
+
+    case realValue:
+        return value_.real_ != 0.0;
+
+    case booleanValue:
+        return value_.bool_;
+
+    default:
+        return false;
+    }
+}
+
+
+bool ArenaValue::operator==(const char*str) const
+{
+    return type_ == stringValue  &&  strcmp(value_.string_, str) == 0;
+}
+
+
+const ArenaValue& ArenaValue::operator[](UInt index) const
+{
+    if (type_ != arrayValue  ||  index >= size_)
+        return null;
+    return value_.children_[index];
+}
+
+
+const ArenaValue& ArenaValue::member(UInt index) const
+{
+    if ((type_ != arrayValue  &&  type_ != objectValue)  ||  index >= size_)
+        return null;
+    return value_.children_[index];
+}
+
+
+const ArenaValue& ArenaValue::operator[](const char*key) const
+{
+    const ArenaValue*member = find(key);
+    return member ? *member : null;
+}
+
+
+const ArenaValue*ArenaValue::find(const char*key) const
+{
+    if (type_ != objectValue)
+        return 0;
+    for (UInt index = size_; index > 0; --index) {
+        const ArenaValue& member = value_.children_[index - 1];
+        if (strcmp(member.name_, key) == 0)
+            return &member;
+    }
+    return 0;
+}
+
+
+// Implementation of class ArenaReader
+// ////////////////////////////////
+
+ArenaReader::ArenaReader()
+    : begin_(0)
+    , end_(0)
+    , current_(0)
+    , error_(0)
+    , errorOffset_(0)
+{
+}
+
+
+bool ArenaReader::parse(char*beginDoc, char*endDoc, Arena& arena, const ArenaValue*& root)
+{
+    begin_ = beginDoc;
+    end_ = endDoc;
+    current_ = beginDoc;
+    error_ = 0;
+    errorOffset_ = 0;
+    values_.clear();
+    frames_.clear();
+
+    const char*name = 0;
+    ArenaValue value;
+
+    while (true) {
+        skipSpaces();
+        if (current_ == end_)
+            return addError("Syntax error: value, object or array expected.");
+
+        char c = *current_;
+        if (c == '{'  ||  c == '[') {
+            Frame frame;
+            frame.type_ = (c == '{') ? objectValue : arrayValue;
+            frame.first_ = values_.size();
+            frame.name_ = name;
+            frames_.push_back(frame);
+            ++current_;
+            skipSpaces();
+            if (current_ != end_  &&  *current_ == (c == '{' ? '}' : ']')) {
+                ++current_;
+                if (!closeContainer(arena, value))
+                    return false;
+            } else if (frame.type_ == objectValue) {
+                if (!readName(name))
+                    return false;
+                continue;
+            } else {
+                name = 0;
+                continue;
+            }
+        } else {
+            if (!readScalar(value))
+                return false;
+            value.name_ = name;
+        }
+
+        // A value is complete: add it to the enclosing container and close
+        // every container that ends after it.
+        while (true) {
+            if (frames_.empty()) {
+                skipSpaces();
+                if (current_ != end_)
+                    return addError("Extra characters after the root value.");
+                ArenaValue*rootValue = static_cast<ArenaValue*>(arena.allocate(sizeof(ArenaValue)));
+                if (!rootValue)
+                    return addError("Out of memory.");
+                *rootValue = value;
+                root = rootValue;
+                return true;
+            }
+
+            values_.push_back(value);
+            skipSpaces();
+            if (current_ == end_)
+                return addError("Missing ',' or end of array/object.");
+
+            const Frame& frame = frames_.back();
+            c = *current_++;
+            if (c == ',') {
+                if (frame.type_ == objectValue) {
+                    if (!readName(name))
+                        return false;
+                } else {
+                    name = 0;
+                }
+                break;
+            } else if (c == (frame.type_ == objectValue ? '}' : ']')) {
+                if (!closeContainer(arena, value))
+                    return false;
+            } else {
+                return addError(frame.type_ == objectValue ? "Missing ',' or '}' in object declaration" :
+                                "Missing ',' or ']' in array declaration");
+            }
+        }
+    }
+}
+
+
+std::string ArenaReader::getFormatedErrorMessages() const
+{
+    if (!error_)
+        return std::string();
+    char offset[32];
+    snprintf(offset, sizeof(offset), "* Offset %u: ", static_cast<unsigned int>(errorOffset_));
+    return std::string(offset) + error_ + "\n";
+}
+
+
+void ArenaReader::skipSpaces()
+{
+    while (current_ != end_) {
+        char c = *current_;
+        if (c == ' '  ||  c == '\t'  ||  c == '\r'  ||  c == '\n')
+            ++current_;
+        else
+            break;
+    }
+}
+
+
+bool ArenaReader::addError(const char*message)
+{
+    error_ = message;
+    errorOffset_ = current_ - begin_;
+    return false;
+}
+
+
+bool ArenaReader::closeContainer(Arena& arena, ArenaValue& value)
+{
+    const Frame frame = frames_.back();
+    frames_.pop_back();
+
+    size_t count = values_.size() - frame.first_;
+    ArenaValue*children = 0;
+    if (count) {
+        children = static_cast<ArenaValue*>(arena.allocate(count * sizeof(ArenaValue)));
+        if (!children)
+            return addError("Out of memory.");
+        memcpy(children, &values_[frame.first_], count * sizeof(ArenaValue));
+        values_.resize(frame.first_);
+    }
+
+    value.type_ = frame.type_;
+    value.size_ = UInt(count);
+    value.name_ = frame.name_;
+    value.value_.children_ = children;
+    return true;
+}
+
+
+bool ArenaReader::readName(const char*& name)
+{
+    skipSpaces();
+    if (current_ == end_  ||  *current_ != '"')
+        return addError("Missing '}' or object member name");
+    UInt len;
+    if (!readString(name, len))
+        return false;
+    skipSpaces();
+    if (current_ == end_  ||  *current_ != ':')
+        return addError("Missing ':' after object member name");
+    ++current_;
+    return true;
+}
+
+
+bool ArenaReader::readScalar(ArenaValue& value)
+{
+    char c = *current_;
+    size_t left = end_ - current_;
+
+    value.size_ = 0;
+    switch (c) {
+    case '"':
+        value.type_ = stringValue;
+        return readString(value.value_.string_, value.size_);
+
+    case 't':
+        if (left < 4  ||  memcmp(current_, "true", 4) != 0)
+            break;
+        current_ += 4;
+        value.type_ = booleanValue;
+        value.value_.bool_ = true;
+        return true;
+
+    case 'f':
+        if (left < 5  ||  memcmp(current_, "false", 5) != 0)
+            break;
+        current_ += 5;
+        value.type_ = booleanValue;
+        value.value_.bool_ = false;
+        return true;
+
+    case 'n':
+        if (left < 4  ||  memcmp(current_, "null", 4) != 0)
+            break;
+        current_ += 4;
+        value.type_ = nullValue;
+        value.value_.children_ = 0;
+        return true;
+
+    default:
+        if (c == '-'  ||  (c >= '0'  &&  c <= '9'))
+            return readNumber(value);
+        break;
+    }
+    return addError("Syntax error: value, object or array expected.");
+}
+
+
+static inline char*codePointToUTF8(unsigned int cp, char*out)
+{
+    // based on description from http://en.wikipedia.org/wiki/UTF-8
+
+    if (cp <= 0x7f) {
+        *out++ = static_cast<char>(cp);
+    } else if (cp <= 0x7FF) {
+        *out++ = static_cast<char>(0xC0 | (0x1f & (cp >> 6)));
+        *out++ = static_cast<char>(0x80 | (0x3f & cp));
+    } else if (cp <= 0xFFFF) {
+        *out++ = static_cast<char>(0xE0 | (0xf & (cp >> 12)));
+        *out++ = static_cast<char>(0x80 | (0x3f & (cp >> 6)));
+        *out++ = static_cast<char>(0x80 | (0x3f & cp));
+    } else if (cp <= 0x10FFFF) {
+        *out++ = static_cast<char>(0xF0 | (0x7 & (cp >> 18)));
+        *out++ = static_cast<char>(0x80 | (0x3f & (cp >> 12)));
+        *out++ = static_cast<char>(0x80 | (0x3f & (cp >> 6)));
+        *out++ = static_cast<char>(0x80 | (0x3f & cp));
+    }
+    return out;
+}
+
+
+bool ArenaReader::readString(const char*& str, UInt& len)
+{
+    // The decoded string is never longer than the escaped one, so it is
+    // written over the document as it is read and the NUL terminator takes
+    // at most the place of the closing quote.
+    char*out = ++current_;
+    str = out;
+    while (true) {
+        if (current_ == end_)
+            return addError("Missing '\"' at end of string");
+        char c = *current_++;
+        if (c == '"') {
+            break;
+        } else if (c == '\\') {
+            if (current_ == end_)
+                return addError("Empty escape sequence in string");
+            char escape = *current_++;
+            switch (escape) {
+            case '"': *out++ = '"'; break;
+
+            case '/': *out++ = '/'; break;
+
+            case '\\': *out++ = '\\'; break;
+
+            case 'b': *out++ = '\b'; break;
+
+            case 'f': *out++ = '\f'; break;
+
+            case 'n': *out++ = '\n'; break;
+
+            case 'r': *out++ = '\r'; break;
+
+            case 't': *out++ = '\t'; break;
+
+            case 'u':
+            {
+                unsigned int unicode;
+                if (!decodeUnicodeEscape(unicode))
+                    return false;
+                if (unicode >= 0xD800  &&  unicode <= 0xDBFF) {
+                    // surrogate pairs
+                    if (end_ - current_ < 6)
+                        return addError("additional six characters expected to parse unicode surrogate pair.");
+                    if (current_[0] != '\\'  ||  current_[1] != 'u')
+                        return addError("expecting another \\u token to begin the second half of a unicode surrogate pair");
+                    current_ += 2;
+                    unsigned int surrogatePair;
+                    if (!decodeUnicodeEscape(surrogatePair))
+                        return false;
+                    unicode = 0x10000 + ((unicode & 0x3FF) << 10) + (surrogatePair & 0x3FF);
+                }
+                out = codePointToUTF8(unicode, out);
+            }
+            break;
+
+            default:
+                return addError("Bad escape sequence in string");
+            }
+        } else {
+            *out++ = c;
+        }
+    }
+    *out = '\0';
+    len = UInt(out - str);
+    return true;
+}
+
+
+bool ArenaReader::decodeUnicodeEscape(unsigned int& unicode)
+{
+    if (end_ - current_ < 4)
+        return addError("Bad unicode escape sequence in string: four digits expected.");
+    unicode = 0;
+    for (int index = 0; index < 4; ++index) {
+        char c = *current_++;
+        unicode *= 16;
+        if (c >= '0'  &&  c <= '9')
+            unicode += c - '0';
+        else if (c >= 'a'  &&  c <= 'f')
+            unicode += c - 'a' + 10;
+        else if (c >= 'A'  &&  c <= 'F')
+            unicode += c - 'A' + 10;
+        else
+            return addError("Bad unicode escape sequence in string: hexadecimal digit expected.");
+    }
+    return true;
+}
+
+
+bool ArenaReader::readNumber(ArenaValue& value)
+{
+    // Same token and conversion rules as Reader::readNumber() and Reader::decodeNumber().
+    char*start = current_;
+    bool isDouble = false;
+    while (current_ != end_) {
+        char c = *current_;
+        if (c >= '0'  &&  c <= '9') {
+            ++current_;
+        } else if (c == '.'  ||  c == 'e'  ||  c == 'E'  ||  c == '+'  ||  c == '-') {
+            isDouble = isDouble  ||  current_ != start;
+            ++current_;
+        } else {
+            break;
+        }
+    }
+
+    if (!isDouble) {
+        char*current = start;
+        bool isNegative = *current == '-';
+        if (isNegative)
+            ++current;
+        UInt threshold = (isNegative ? UInt(Value::maxInt) + 1 : Value::maxUInt) / 10;
+        UInt number = 0;
+        while (current < current_) {
+            char c = *current++;
+            if (number >= threshold) {
+                isDouble = true;
+                break;
+            }
+            number = number * 10 + UInt(c - '0');
+        }
+        if (!isDouble) {
+            if (start == current_  ||  (isNegative  &&  start + 1 == current_)) {
+                return addError("Syntax error: value, object or array expected.");
+            } else if (isNegative) {
+                value.type_ = intValue;
+                value.value_.int_ = -Int(number);
+            } else if (number <= UInt(Value::maxInt)) {
+                value.type_ = intValue;
+                value.value_.int_ = Int(number);
+            } else {
+                value.type_ = uintValue;
+                value.value_.uint_ = number;
+            }
+            return true;
+        }
+    }
+
+    // Copy the token so that it can be NUL terminated for the conversion.
+    char buffer[32];
+    std::string longToken;
+    const char*token = buffer;
+    size_t length = current_ - start;
+    if (length < sizeof(buffer)) {
+        memcpy(buffer, start, length);
+        buffer[length] = '\0';
+    } else {
+        longToken.assign(start, length);
+        token = longToken.c_str();
+    }
+    double number = 0;
+    if (sscanf(token, "%lf", &number) != 1)
+        return addError("Number could not be converted.");
+    value.type_ = realValue;
+    value.value_.real_ = number;
+    return true;
+}
+
+} // namespace Json
@@ -0,0 +1,51 @@
+/**
+ * @file
+ * Histogram of latencies recorded concurrently by many threads.
+ */
+
+/******************************************************************************
+ * Copyright 2012, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#include <qcc/platform.h>
+
+#include "LatencyHistogram.h"
+
+#define QCC_MODULE "ALLJOYN"
+
+namespace ajn {
+
+void LatencyHistogram::GetCounts(uint32_t counts[NUM_BUCKETS]) const
+{
+    for (size_t b = 0; b < NUM_BUCKETS; ++b) {
+        counts[b] = 0;
+    }
+    for (size_t s = 0; s < NUM_SLOTS; ++s) {
+        for (size_t b = 0; b < NUM_BUCKETS; ++b) {
+            counts[b] += static_cast<uint32_t>(slots[s].counts[b]);
+        }
+    }
+}
+
+void LatencyHistogram::Clear()
+{
+    for (size_t s = 0; s < NUM_SLOTS; ++s) {
+        for (size_t b = 0; b < NUM_BUCKETS; ++b) {
+            slots[s].counts[b] = 0;
+        }
+    }
+}
+
+}
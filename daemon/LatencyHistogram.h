@@ -0,0 +1,119 @@
+/**
+ * @file
+ * Histogram of latencies recorded concurrently by many threads.
+ */
+
+/******************************************************************************
+ * Copyright 2012, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#ifndef _ALLJOYN_LATENCYHISTOGRAM_H
+#define _ALLJOYN_LATENCYHISTOGRAM_H
+
+#include <qcc/platform.h>
+
+#include <qcc/atomic.h>
+
+#include "MicroTimestamp.h"
+
+namespace ajn {
+
+/**
+ * Histogram of latencies in microseconds with power of two buckets.
+ *
+ * The counts are spread over a number of slots chosen by a key supplied by the caller, normally
+ * something owned by the recording thread such as the endpoint it is receiving from.  Threads
+ * with different keys rarely touch the same cache line so recording is an atomic increment
+ * without contention.  The slots are summed when the histogram is read.
+ */
+class LatencyHistogram {
+  public:
+
+    static const size_t NUM_BUCKETS = 16;   /**< Bucket i < NUM_BUCKETS - 1 counts latencies below 2^i us */
+    static const size_t NUM_SLOTS = 16;     /**< Number of slots the counts are spread over */
+
+    /**
+     * Constructor
+     */
+    LatencyHistogram() { Clear(); }
+
+    /**
+     * Record the time elapsed since a timestamp.
+     *
+     * @param key     Value identifying the recording thread.
+     * @param start   Timestamp obtained from GetMicroTimestamp().
+     */
+    void Record(const void* key, uint64_t start)
+    {
+        size_t slot = ((reinterpret_cast<uintptr_t>(key) >> 4) ^ (reinterpret_cast<uintptr_t>(key) >> 12)) % NUM_SLOTS;
+        qcc::IncrementAndFetch(&slots[slot].counts[GetBucket(GetMicroTimestamp() - start)]);
+    }
+
+    /**
+     * Get the counts summed over all slots.
+     *
+     * @param[out] counts  Number of latencies recorded in each bucket.
+     */
+    void GetCounts(uint32_t counts[NUM_BUCKETS]) const;
+
+    /**
+     * Get the upper limit of a bucket.
+     *
+     * @param bucket  Bucket index.
+     *
+     * @return  The bucket counts latencies below this many microseconds.  0xFFFFFFFF for the last
+     *          bucket which counts everything else.
+     */
+    static uint32_t GetBucketLimit(size_t bucket)
+    {
+        return (bucket < (NUM_BUCKETS - 1)) ? (1 << bucket) : 0xFFFFFFFF;
+    }
+
+    /**
+     * Get the bucket a latency falls in.
+     *
+     * @param micros  Latency in microseconds.
+     *
+     * @return  Bucket index.
+     */
+    static size_t GetBucket(uint64_t micros)
+    {
+        size_t bucket = 0;
+        while ((micros > 0) && (bucket < (NUM_BUCKETS - 1))) {
+            micros >>= 1;
+            ++bucket;
+        }
+        return bucket;
+    }
+
+    /**
+     * Reset all counts to zero.  Latencies recorded while this runs may be lost.
+     */
+    void Clear();
+
+  private:
+
+    /**
+     * Counts recorded through one slot.  A slot is one cache line on most processors.
+     */
+    struct Slot {
+        volatile int32_t counts[NUM_BUCKETS];
+    };
+
+    Slot slots[NUM_SLOTS];
+};
+
+}
+
+#endif
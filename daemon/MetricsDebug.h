@@ -0,0 +1,287 @@
+/**
+ * @file
+ *
+ * This file defines the org.alljoyn.Bus.Debug.Metrics add-on for the AllJoyn debug object.
+ */
+
+/******************************************************************************
+ * Copyright 2012, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#ifndef _ALLJOYN_METRICSDEBUG_H
+#define _ALLJOYN_METRICSDEBUG_H
+
+// Include contents in debug builds only.
+#ifndef NDEBUG
+
+#include <qcc/platform.h>
+
+#include <ctype.h>
+#include <string.h>
+
+#include <map>
+#include <vector>
+
+#include <qcc/FileStream.h>
+#include <qcc/String.h>
+
+#include <alljoyn/MsgArg.h>
+
+#include "AllJoynDebugObj.h"
+#include "AllJoynObj.h"
+#include "DaemonRouter.h"
+#include "LatencyHistogram.h"
+#include "MessageTrace.h"
+
+
+namespace ajn {
+
+namespace debug {
+
+/**
+ * BusObject add-on responsible for implementing org.alljoyn.Bus.Debug.Metrics which reports
+ * traffic counters for each endpoint and transport, the time taken to route messages and the
+ * sizes of the routing tables.  It also controls message tracing (see MessageTrace) and returns
+ * the traced events or writes them to a file in the .alljoyn_trace directory of the daemon's home
+ * directory.
+ *
+ * The counters are kept by the endpoints and the router as messages flow through them; this
+ * object only collects them when a property is read.
+ *
+ * @cond ALLJOYN_DEV
+ *
+ * This is implemented entirely in the header file for the following reasons:
+ *
+ * - It is only instantiated in one place in debug builds only.
+ * - It is easily excluded from release builds by conditionally including it.
+ *
+ * @endcond
+ */
+class MetricsDebugObj : public AllJoynDebugObjAddon {
+  public:
+    class MetricsProperties : public AllJoynDebugObj::Properties {
+      public:
+        MetricsProperties(DaemonRouter& router, AllJoynObj& alljoynObj) : router(router), alljoynObj(alljoynObj) { }
+
+        QStatus Get(const char* propName, MsgArg& val) const
+        {
+            QStatus status = ER_OK;
+            if (::strcmp(propName, "Endpoints") == 0) {
+                std::vector<DaemonRouter::EndpointMetrics> endpoints;
+                router.GetEndpointMetrics(endpoints);
+                std::vector<MsgArg> elements;
+                elements.reserve(endpoints.size());
+                std::vector<DaemonRouter::EndpointMetrics>::const_iterator it;
+                for (it = endpoints.begin(); it != endpoints.end(); ++it) {
+                    const RemoteEndpoint::Stats& s = it->stats;
+                    elements.push_back(MsgArg("(ssttttuuutu)", it->uniqueName.c_str(), it->transportName.c_str(),
+                                              s.rxMsgs, s.rxBytes, s.txMsgs, s.txBytes,
+                                              s.txQueueDepth, s.txQueueMax, s.txBlocked, s.txBlockedMs, s.drops));
+                }
+                status = val.Set("a(ssttttuuutu)", elements.size(), elements.empty() ? NULL : &elements.front());
+                val.Stabilize();
+            } else if (::strcmp(propName, "Transports") == 0) {
+                std::map<qcc::String, DaemonRouter::TransportMetrics> transports;
+                router.GetTransportMetrics(transports);
+                std::vector<MsgArg> elements;
+                elements.reserve(transports.size());
+                std::map<qcc::String, DaemonRouter::TransportMetrics>::const_iterator it;
+                for (it = transports.begin(); it != transports.end(); ++it) {
+                    const RemoteEndpoint::Stats& s = it->second.stats;
+                    elements.push_back(MsgArg("(suttttuuutu)", it->first.c_str(), it->second.numEndpoints,
+                                              s.rxMsgs, s.rxBytes, s.txMsgs, s.txBytes,
+                                              s.txQueueDepth, s.txQueueMax, s.txBlocked, s.txBlockedMs, s.drops));
+                }
+                status = val.Set("a(suttttuuutu)", elements.size(), elements.empty() ? NULL : &elements.front());
+                val.Stabilize();
+            } else if (::strcmp(propName, "RouteLatency") == 0) {
+                uint32_t counts[LatencyHistogram::NUM_BUCKETS];
+                router.GetRouteLatency().GetCounts(counts);
+                MsgArg elements[LatencyHistogram::NUM_BUCKETS];
+                for (size_t i = 0; i < LatencyHistogram::NUM_BUCKETS; ++i) {
+                    elements[i].Set("(uu)", LatencyHistogram::GetBucketLimit(i), counts[i]);
+                }
+                status = val.Set("a(uu)", LatencyHistogram::NUM_BUCKETS, elements);
+                val.Stabilize();
+            } else if (::strcmp(propName, "TraceSampleInterval") == 0) {
+                status = val.Set("u", MessageTrace::GetSampleInterval());
+            } else if (::strcmp(propName, "Trace") == 0) {
+                std::vector<MessageTrace::Record> records;
+                MessageTrace::Collect(records);
+                std::vector<MsgArg> elements;
+                elements.reserve(records.size());
+                std::vector<MessageTrace::Record>::const_iterator it;
+                for (it = records.begin(); it != records.end(); ++it) {
+                    elements.push_back(MsgArg("(usts)", it->traceId, MessageTrace::StageText(it->stage),
+                                              it->timestamp, it->thread.c_str()));
+                }
+                status = val.Set("a(usts)", elements.size(), elements.empty() ? NULL : &elements.front());
+                val.Stabilize();
+            } else if (::strcmp(propName, "Rules") == 0) {
+                status = val.Set("u", static_cast<uint32_t>(router.GetNumRules()));
+            } else if (::strcmp(propName, "UniqueNames") == 0) {
+                status = val.Set("u", static_cast<uint32_t>(router.GetNumUniqueNames()));
+            } else if (::strcmp(propName, "AliasNames") == 0) {
+                status = val.Set("u", static_cast<uint32_t>(router.GetNumAliasNames()));
+            } else if (::strcmp(propName, "SessionCastRoutes") == 0) {
+                status = val.Set("u", static_cast<uint32_t>(router.GetNumSessionCastRoutes()));
+            } else if (::strcmp(propName, "Sessions") == 0) {
+                uint32_t sessions;
+                uint32_t members;
+                alljoynObj.GetSessionCounts(sessions, members);
+                status = val.Set("u", sessions);
+            } else if (::strcmp(propName, "SessionMembers") == 0) {
+                uint32_t sessions;
+                uint32_t members;
+                alljoynObj.GetSessionCounts(sessions, members);
+                status = val.Set("u", members);
+            } else {
+                status = ER_BUS_NO_SUCH_PROPERTY;
+            }
+            return status;
+        }
+
+        QStatus Set(const char* propName, MsgArg& val)
+        {
+            const AllJoynDebugObj::Properties::Info* info;
+            size_t infoSize;
+            GetProperyInfo(info, infoSize);
+            for (size_t i = 0; i < infoSize; ++i) {
+                if (::strcmp(propName, info[i].name) == 0) {
+                    return ER_BUS_PROPERTY_ACCESS_DENIED;
+                }
+            }
+            return ER_BUS_NO_SUCH_PROPERTY;
+        }
+
+        void GetProperyInfo(const AllJoynDebugObj::Properties::Info*& info, size_t& infoSize)
+        {
+            static const AllJoynDebugObj::Properties::Info ourInfo[] = {
+                { "Endpoints",            "a(ssttttuuutu)", PROP_ACCESS_READ },
+                { "Transports",           "a(suttttuuutu)", PROP_ACCESS_READ },
+                { "RouteLatency",         "a(uu)",          PROP_ACCESS_READ },
+                { "TraceSampleInterval",  "u",              PROP_ACCESS_READ },
+                { "Trace",                "a(usts)",        PROP_ACCESS_READ },
+                { "Rules",                "u",              PROP_ACCESS_READ },
+                { "UniqueNames",          "u",              PROP_ACCESS_READ },
+                { "AliasNames",           "u",              PROP_ACCESS_READ },
+                { "Sessions",             "u",              PROP_ACCESS_READ },
+                { "SessionMembers",       "u",              PROP_ACCESS_READ },
+                { "SessionCastRoutes",    "u",              PROP_ACCESS_READ },
+            };
+            info = ourInfo;
+            infoSize = ArraySize(ourInfo);
+        }
+
+      private:
+        DaemonRouter& router;
+        AllJoynObj& alljoynObj;
+    };
+
+    MetricsDebugObj(DaemonRouter& router, AllJoynObj& alljoynObj) : router(router), properties(router, alljoynObj)
+    {
+        AllJoynDebugObj* dbg = AllJoynDebugObj::GetAllJoynDebugObj();
+
+#define _MethodHandler(_a) static_cast<AllJoynDebugObjAddon::MethodHandler>(_a)
+        AllJoynDebugObj::MethodInfo methodInfo[] = {
+            { "ResetRouteLatency",      NULL,   NULL, NULL,
+              _MethodHandler(&MetricsDebugObj::ResetRouteLatencyHandler) },
+            { "SetTraceSampleInterval", "u",    NULL, "interval",
+              _MethodHandler(&MetricsDebugObj::SetTraceSampleIntervalHandler) },
+            { "ClearTrace",             NULL,   NULL, NULL,
+              _MethodHandler(&MetricsDebugObj::ClearTraceHandler) },
+            { "WriteTrace",             "s",    NULL, "fileName",
+              _MethodHandler(&MetricsDebugObj::WriteTraceHandler) },
+        };
+#undef _MethodHandler
+
+        dbg->AddDebugInterface(this,
+                               "org.alljoyn.Bus.Debug.Metrics",
+                               methodInfo, ArraySize(methodInfo),
+                               properties);
+    }
+
+  private:
+
+    QStatus ResetRouteLatencyHandler(Message& msg, std::vector<MsgArg>& replyArgs)
+    {
+        router.GetRouteLatency().Clear();
+        return ER_OK;
+    }
+
+    QStatus SetTraceSampleIntervalHandler(Message& msg, std::vector<MsgArg>& replyArgs)
+    {
+        uint32_t interval;
+        QStatus status = msg->GetArgs("u", &interval);
+        if (status == ER_OK) {
+            MessageTrace::SetSampleInterval(interval);
+        }
+        return status;
+    }
+
+    QStatus ClearTraceHandler(Message& msg, std::vector<MsgArg>& replyArgs)
+    {
+        MessageTrace::Clear();
+        return ER_OK;
+    }
+
+    /**
+     * Check that a trace file name names a file directly in the trace directory.  Only letters,
+     * digits, '_', '-' and '.' are allowed and the name must not start with a '.'.
+     */
+    static bool IsTraceFileName(const char* fileName)
+    {
+        static const size_t MAX_NAME_LEN = 64;
+        size_t len = ::strlen(fileName);
+        if ((len == 0) || (len > MAX_NAME_LEN) || (fileName[0] == '.')) {
+            return false;
+        }
+        for (size_t i = 0; i < len; ++i) {
+            char c = fileName[i];
+            if (!isalnum(static_cast<unsigned char>(c)) && (c != '_') && (c != '-') && (c != '.')) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /*
+     * Traces are only written to the trace directory of the daemon's home directory so a caller
+     * cannot overwrite any other file the daemon has access to.
+     */
+    QStatus WriteTraceHandler(Message& msg, std::vector<MsgArg>& replyArgs)
+    {
+        const char* fileName;
+        QStatus status = msg->GetArgs("s", &fileName);
+        if (status == ER_OK) {
+            if (IsTraceFileName(fileName)) {
+                status = MessageTrace::WriteFile((qcc::GetHomeDir() + "/.alljoyn_trace/" + fileName).c_str());
+            } else {
+                status = ER_BAD_ARG_1;
+            }
+        }
+        return status;
+    }
+
+    DaemonRouter& router;
+    MetricsProperties properties;
+};
+
+
+
+} // namespace debug
+} // namespace ajn
+
+#endif
+#endif
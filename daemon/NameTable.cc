@@ -293,6 +293,22 @@ void NameTable::GetBusNames(vector<qcc::String>& names) const
     lock.Unlock(MUTEX_CONTEXT);
 }
 
+size_t NameTable::GetNumUniqueNames() const
+{
+    lock.Lock(MUTEX_CONTEXT);
+    size_t numNames = uniqueNames.size();
+    lock.Unlock(MUTEX_CONTEXT);
+    return numNames;
+}
+
+size_t NameTable::GetNumAliasNames() const
+{
+    lock.Lock(MUTEX_CONTEXT);
+    size_t numNames = aliasNames.size() + virtualAliasNames.size();
+    lock.Unlock(MUTEX_CONTEXT);
+    return numNames;
+}
+
 void NameTable::GetUniqueNamesAndAliases(vector<pair<qcc::String, vector<qcc::String> > >& names) const
 {
 
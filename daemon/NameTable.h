@@ -199,6 +199,20 @@ class NameTable {
      */
     void GetQueuedNames(const qcc::String& busName, std::vector<qcc::String>& names);
 
+    /**
+     * Get the number of unique names in the name table.
+     *
+     * @return  Number of unique names.
+     */
+    size_t GetNumUniqueNames() const;
+
+    /**
+     * Get the number of alias (well-known) names in the name table including virtual aliases.
+     *
+     * @return  Number of alias names.
+     */
+    size_t GetNumAliasNames() const;
+
     /**
      * Lock table.
      */
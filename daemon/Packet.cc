@@ -28,6 +28,7 @@
 #include <qcc/Util.h>
 #include <qcc/time.h>
 
+#include "Crc32.h"
 #include "Packet.h"
 #include "PacketStream.h"
 
@@ -58,10 +59,10 @@ namespace ajn {
 #define CRC_OFFSET         10
 #define TTL_OFFSET         12
 #define PAYLOAD_OFFSET     16     /* Must be 4-byte aligned */
-
-#define PACKET_ENGINE_VERSION 1
+#define CRC32C_LEN          4     /* PACKET_FORMAT_CRC32C trailer */
 
 const size_t Packet::payloadOffset = PAYLOAD_OFFSET;
+const size_t Packet::maxOverhead = PAYLOAD_OFFSET + CRC32C_LEN;
 
 Packet::Packet(size_t _mtu) :
     chanId(0),
@@ -75,6 +76,8 @@ Packet::Packet(size_t _mtu) :
     sendTs(0),
     sendAttempts(0),
     fastRetransmit(false),
+    refCount(1),
+    format(PACKET_FORMAT_CRC16),
     mtu(_mtu),
     crc16(0),
     version(0)
@@ -93,6 +96,8 @@ Packet::Packet(const Packet& other) :
     sendTs(other.sendTs),
     sendAttempts(other.sendAttempts),
     fastRetransmit(other.fastRetransmit),
+    refCount(1),
+    format(other.format),
     mtu(other.mtu),
     crc16(other.crc16),
     version(other.version)
@@ -116,6 +121,7 @@ Packet& Packet::operator=(const Packet& other)
         sendTs = other.sendTs;
         sendAttempts = other.sendAttempts;
         fastRetransmit = other.fastRetransmit;
+        format = other.format;
         mtu = other.mtu;
         crc16 = other.crc16;
         version = other.version;
@@ -133,7 +139,7 @@ size_t Packet::SetPayload(const void* _payload, size_t _payloadLen)
     if (!_payload) {
         _payloadLen = 0;
     }
-    payloadLen = std::min(_payloadLen, mtu - PAYLOAD_OFFSET);
+    payloadLen = std::min(_payloadLen, mtu - PAYLOAD_OFFSET - CRC32C_LEN);
     if (_payload) {
         payload = buffer + (PAYLOAD_OFFSET / sizeof(uint32_t));
         if (payload != _payload) {
@@ -146,9 +152,22 @@ size_t Packet::SetPayload(const void* _payload, size_t _payloadLen)
 QStatus Packet::Unmarshal(PacketSource& source)
 {
     /* Get bytes from source */
-    size_t actBytes;
-    QStatus status = source.PullPacketBytes(buffer, mtu, actBytes, sender, 3000);
+    size_t actBytes = 0;
+    PacketDest from;
+    QStatus status = source.PullPacketBytes(buffer, mtu, actBytes, from, 3000);
+    if (status == ER_OK) {
+        status = Unmarshal(from, actBytes);
+    } else {
+        Unmarshal(from, 0);
+    }
+    return status;
+}
+
+QStatus Packet::Unmarshal(const PacketDest& from, size_t actBytes)
+{
+    QStatus status = ER_OK;
     uint8_t* tBuf = reinterpret_cast<uint8_t*>(buffer);
+    sender = from;
 
     if (actBytes < PAYLOAD_OFFSET) {
         status = ER_PACKET_BAD_FORMAT;
@@ -156,18 +175,31 @@ QStatus Packet::Unmarshal(PacketSource& source)
 
     if (status == ER_OK) {
         /* Crc check */
-        uint16_t crc = 0;
-        uint16_t packetCrc = letoh16(*reinterpret_cast<uint16_t*>(tBuf + CRC_OFFSET));
-        CRC16_Compute(tBuf, CRC_OFFSET, &crc);
-        CRC16_Compute(tBuf + PAYLOAD_OFFSET, actBytes - PAYLOAD_OFFSET, &crc);
-        status = (crc == packetCrc) ? ER_OK : ER_PACKET_BAD_CRC;
+        version = tBuf[VERSION_OFFSET];
+        if (version == PACKET_FORMAT_CRC32C) {
+            if (actBytes < (PAYLOAD_OFFSET + CRC32C_LEN)) {
+                status = ER_PACKET_BAD_FORMAT;
+            } else {
+                actBytes -= CRC32C_LEN;
+                uint32_t packetCrc;
+                ::memcpy(&packetCrc, tBuf + actBytes, sizeof(packetCrc));
+                status = (CRC32C_Compute(tBuf, actBytes) == letoh32(packetCrc)) ? ER_OK : ER_PACKET_BAD_CRC;
+                format = PACKET_FORMAT_CRC32C;
+            }
+        } else {
+            uint16_t crc = 0;
+            uint16_t packetCrc = letoh16(*reinterpret_cast<uint16_t*>(tBuf + CRC_OFFSET));
+            CRC16_Compute(tBuf, CRC_OFFSET, &crc);
+            CRC16_Compute(tBuf + PAYLOAD_OFFSET, actBytes - PAYLOAD_OFFSET, &crc);
+            status = (crc == packetCrc) ? ER_OK : ER_PACKET_BAD_CRC;
+            format = PACKET_FORMAT_CRC16;
+        }
     }
 
     if (status == ER_OK) {
         chanId = letoh32(*reinterpret_cast<uint32_t*>(tBuf + CHAN_ID_OFFSET));
         seqNum = letoh16(*reinterpret_cast<uint16_t*>(tBuf + SEQ_NUM_OFFSET));
         gap = letoh16(*reinterpret_cast<uint16_t*>(tBuf + GAP_OFFSET));
-        version = tBuf[VERSION_OFFSET];
         flags = tBuf[FLAGS_OFFSET];
         uint32_t ttl = letoh32(*reinterpret_cast<uint32_t*>(tBuf + TTL_OFFSET));
         payload = reinterpret_cast<uint32_t*>(tBuf + PAYLOAD_OFFSET);
@@ -189,13 +221,13 @@ QStatus Packet::Unmarshal(PacketSource& source)
 
 void Packet::Marshal()
 {
-    assert(payloadLen <= (mtu - PAYLOAD_OFFSET));
+    assert(payloadLen <= (mtu - PAYLOAD_OFFSET - CRC32C_LEN));
 
     uint8_t* tBuf = reinterpret_cast<uint8_t*>(buffer);
     *reinterpret_cast<uint32_t*>(tBuf + CHAN_ID_OFFSET) = htole32(chanId);
     *reinterpret_cast<uint16_t*>(tBuf + SEQ_NUM_OFFSET) = htole16(seqNum);
     *reinterpret_cast<uint16_t*>(tBuf + GAP_OFFSET) = htole16(gap);
-    *(tBuf + VERSION_OFFSET) = PACKET_ENGINE_VERSION;
+    *(tBuf + VERSION_OFFSET) = format;
     *(tBuf + FLAGS_OFFSET) = flags;
     uint64_t now = GetTimestamp64();
     uint32_t ttl = 0;
@@ -212,12 +244,19 @@ void Packet::Marshal()
     if ((tBuf + PAYLOAD_OFFSET) != reinterpret_cast<uint8_t*>(payload)) {
         ::memmove(tBuf + PAYLOAD_OFFSET, payload, payloadLen);
     }
-    uint16_t crc = 0;
-    CRC16_Compute(tBuf, CRC_OFFSET, &crc);
-    if (payloadLen) {
-        CRC16_Compute(tBuf + PAYLOAD_OFFSET, payloadLen, &crc);
+    if (format == PACKET_FORMAT_CRC32C) {
+        /* The CRC32C covers the whole header (with a zero CRC16 field) and the payload */
+        *reinterpret_cast<uint16_t*>(tBuf + CRC_OFFSET) = 0;
+        uint32_t crc = htole32(CRC32C_Compute(tBuf, PAYLOAD_OFFSET + payloadLen));
+        ::memcpy(tBuf + PAYLOAD_OFFSET + payloadLen, &crc, sizeof(crc));
+    } else {
+        uint16_t crc = 0;
+        CRC16_Compute(tBuf, CRC_OFFSET, &crc);
+        if (payloadLen) {
+            CRC16_Compute(tBuf + PAYLOAD_OFFSET, payloadLen, &crc);
+        }
+        *reinterpret_cast<uint16_t*>(tBuf + CRC_OFFSET) = htole16(crc);
     }
-    *reinterpret_cast<uint16_t*>(tBuf + CRC_OFFSET) = htole16(crc);
 }
 
 void Packet::Clean()
@@ -232,6 +271,7 @@ void Packet::Clean()
     sendTs = 0;
     sendAttempts = 0;
     fastRetransmit = false;
+    format = PACKET_FORMAT_CRC16;
     crc16 = 0;
     version = 0;
 }
@@ -35,6 +35,10 @@ namespace ajn {
 #define PACKET_FLAG_DELAY_ACK  0x08     /* Data packet may be acked by the receiver in a delayed manner */
 #define PACKET_FLAG_FLOW_OFF   0x10     /* Transmitter is XOFF (and will be expecting XON) */
 
+/* Packet wire formats (carried in the version byte of the packet header) */
+#define PACKET_FORMAT_CRC16    1        /* CRC16 of header and payload stored in the header */
+#define PACKET_FORMAT_CRC32C   2        /* CRC32C of header and payload appended to the payload */
+
 /* Control packet command types (payload offset = 0, size = BYTE) */
 #define PACKET_COMMAND_CONNECT_REQ         0x01
 #define PACKET_COMMAND_CONNECT_RSP         0x02
@@ -68,6 +72,7 @@ void GetAddressAndPort(const PacketDest& dest, qcc::IPAddress& addr, uint16_t& p
 class Packet {
   public:
     static const size_t payloadOffset;
+    static const size_t maxOverhead;   /* Largest number of non-payload bytes in a packet of any format */
 
     uint32_t chanId;       /* Channel Id */
     uint16_t seqNum;       /* Incrementing packet sequence number */
@@ -80,6 +85,8 @@ class Packet {
     uint64_t sendTs;       /* Timestampe when packet was last sent */
     uint16_t sendAttempts; /* Number of times this packet has been sent */
     bool fastRetransmit;   /* true iff packet has been fast retransmitted */
+    volatile int32_t refCount; /* References to a pooled packet (see PacketPool::AddRef) */
+    uint8_t format;        /* Wire format (PACKET_FORMAT_xxx) used by Marshal or found by Unmarshal */
 
     /** Constructor */
     Packet(size_t mtu);
@@ -94,6 +101,7 @@ class Packet {
     ~Packet();
 
     size_t SetPayload(const void* payload, size_t payloadLen);
+    size_t GetWireSize() const { return payloadOffset + payloadLen + ((format == PACKET_FORMAT_CRC32C) ? sizeof(uint32_t) : 0); }
     void SetSender(const PacketDest& sender) { this->sender = sender; }
     const PacketDest& GetSender() const { return sender; }
 
@@ -105,6 +113,15 @@ class Packet {
      */
     QStatus Unmarshal(PacketSource& source);
 
+    /**
+     * Unmarshal packet bytes that have already been received into this packet's buffer.
+     *
+     * @param sender    Sender of the packet bytes.
+     * @param numBytes  Number of bytes in buffer.
+     * @return ER_OK if successful.
+     */
+    QStatus Unmarshal(const PacketDest& sender, size_t numBytes);
+
     /**
      * Marshal packet state into serialized form.
      * After calling this method, the packet's object state will be serialized into the buffer member.
@@ -23,9 +23,12 @@
 
 #include <algorithm>
 #include <limits>
+#include <cstring>
 
 #include <qcc/Crypto.h>
+#include <qcc/StringUtil.h>
 #include <qcc/Util.h>
+#include <qcc/atomic.h>
 #include "PacketEngine.h"
 
 #if defined(QCC_OS_DARWIN)
@@ -119,16 +122,52 @@ static uint32_t GetValidWindowSize(uint32_t inWinSize)
     return allowedSize;
 }
 
-PacketEngine::PacketEngine(const qcc::String& name, uint32_t maxWindowSize) :
-    name(name),
-    rxPacketThread(name),
-    txPacketThread(name),
+/* Initial number of channel table slots (power of 2) */
+#define CHANNEL_TABLE_MIN_SLOTS 64
+
+/* Marks a channel table slot whose channel has been removed */
+static uint8_t channelTombstone;
+#define TOMBSTONE reinterpret_cast<ChannelInfo*>(&channelTombstone)
+
+/*
+ * Full memory barrier (the qcc atomics are the only portable one available). Orders the writes
+ * that initialize a channel or table before the write that makes it visible to lookups.
+ */
+static volatile int32_t publishBarrier = 0;
+static inline void PublishBarrier()
+{
+    IncrementAndFetch(&publishBarrier);
+}
+
+/* Spread channel ids across the channel table */
+static inline uint32_t ChannelHash(uint32_t chanId)
+{
+    return chanId * 2654435761U;
+}
+
+PacketEngine::Worker::Worker(const qcc::String& engineName, uint32_t index) :
+    index(index),
+    rxPacketThread(engineName + "-rx" + U32ToString(index), *this),
+    txPacketThread(engineName + "-tx" + U32ToString(index), *this),
     timer("PacketEngineTimer"),
+    rxReload(false)
+{
+}
+
+PacketEngine::PacketEngine(const qcc::String& name, uint32_t maxWindowSize, uint32_t numWorkers) :
+    name(name),
+    channelTable(NULL),
     maxWindowSize(maxWindowSize),
     isRunning(false),
-    rxPacketThreadReload(false)
+    ccType(CongestionControl::CUBIC)
 {
-    QCC_DbgTrace(("PacketEngine::PacketEngine(%p)", this));
+    QCC_DbgTrace(("PacketEngine::PacketEngine(%p, numWorkers=%u)", this, numWorkers));
+
+    ResizeChannelTable(CHANNEL_TABLE_MIN_SLOTS);
+
+    for (uint32_t i = 0; i < ::max(numWorkers, (uint32_t)1); ++i) {
+        workers.push_back(new Worker(name, i));
+    }
 
     /* Check that window size is a power of 2 */
 #ifndef NDEBUG
@@ -147,33 +186,59 @@ PacketEngine::PacketEngine(const qcc::String& name, uint32_t maxWindowSize) :
 PacketEngine::~PacketEngine()
 {
     QCC_DbgTrace(("~PacketEngine(%p)", this));
-    rxPacketThreadReload = true;
+    for (size_t i = 0; i < workers.size(); ++i) {
+        workers[i]->rxReload = true;
+    }
     Stop();
     Join();
+
+    /* Delete the remaining channels. The workers are still needed by the ChannelInfo destructor */
+    isRunning = false;
+    ReclaimRetired();
+    ChannelTable* table = channelTable;
+    for (uint32_t i = 0; i <= table->mask; ++i) {
+        ChannelInfo* ci = table->slots[i];
+        if (ci && (ci != TOMBSTONE)) {
+            table->slots[i] = NULL;
+            delete ci;
+        }
+    }
+    delete [] table->slots;
+    delete table;
+
+    for (size_t i = 0; i < workers.size(); ++i) {
+        delete workers[i];
+    }
 }
 
 QStatus PacketEngine::Start(uint32_t mtu) {
     QCC_DbgTrace(("PacketEngine::Start()"));
     isRunning = true;
     QStatus status = pool.Start(mtu);
-    QStatus tStatus = rxPacketThread.Start(this);
-    status = (status == ER_OK) ? tStatus : status;
-    tStatus = txPacketThread.Start(this);
-    status = (status == ER_OK) ? tStatus : status;
-    tStatus = timer.Start();
-    status = (status == ER_OK) ? tStatus : status;
+    for (size_t i = 0; i < workers.size(); ++i) {
+        QStatus tStatus = workers[i]->rxPacketThread.Start(this);
+        status = (status == ER_OK) ? tStatus : status;
+        tStatus = workers[i]->txPacketThread.Start(this);
+        status = (status == ER_OK) ? tStatus : status;
+        tStatus = workers[i]->timer.Start();
+        status = (status == ER_OK) ? tStatus : status;
+    }
     isRunning = (status == ER_OK);
     return status;
 }
 
 QStatus PacketEngine::Stop() {
     QCC_DbgTrace(("PacketEngine::Stop()"));
-    QStatus status = timer.Stop();
-    QStatus tStatus = txPacketThread.Stop();
-    status = (status == ER_OK) ? tStatus : status;
-    tStatus = rxPacketThread.Stop();
-    status = (status == ER_OK) ? tStatus : status;
-    tStatus = pool.Stop();
+    QStatus status = ER_OK;
+    for (size_t i = 0; i < workers.size(); ++i) {
+        QStatus tStatus = workers[i]->timer.Stop();
+        status = (status == ER_OK) ? tStatus : status;
+        tStatus = workers[i]->txPacketThread.Stop();
+        status = (status == ER_OK) ? tStatus : status;
+        tStatus = workers[i]->rxPacketThread.Stop();
+        status = (status == ER_OK) ? tStatus : status;
+    }
+    QStatus tStatus = pool.Stop();
     isRunning = false;
     return (status == ER_OK) ? tStatus : status;
 }
@@ -181,21 +246,31 @@ QStatus PacketEngine::Stop() {
 QStatus PacketEngine::Join() {
     QCC_DbgTrace(("PacketEngine::Join()"));
 
-    QStatus status = rxPacketThread.Join();
-    QStatus tStatus = txPacketThread.Join();
-    status = (status == ER_OK) ? tStatus : status;
-    tStatus = timer.Join();
-    return (status == ER_OK) ? tStatus : status;
+    QStatus status = ER_OK;
+    for (size_t i = 0; i < workers.size(); ++i) {
+        QStatus tStatus = workers[i]->rxPacketThread.Join();
+        status = (status == ER_OK) ? tStatus : status;
+        tStatus = workers[i]->txPacketThread.Join();
+        status = (status == ER_OK) ? tStatus : status;
+        tStatus = workers[i]->timer.Join();
+        status = (status == ER_OK) ? tStatus : status;
+    }
+    return status;
 }
 
 QStatus PacketEngine::AddPacketStream(PacketStream& stream, PacketEngineListener& listener)
 {
     QCC_DbgTrace(("PacketEngine::AddPacketStream(%p)", &stream));
 
+    /* Spread the work of pulling from PacketStreams across the workers */
     channelInfoLock.Lock();
-    packetStreams[&stream.GetSourceEvent()] = pair<PacketStream*, PacketEngineListener*>(&stream, &listener);
+    StreamInfo& info = packetStreams[&stream.GetSourceEvent()];
+    info.stream = &stream;
+    info.listener = &listener;
+    info.rxWorker = static_cast<uint32_t>((packetStreams.size() - 1) % workers.size());
+    Worker& w = *workers[info.rxWorker];
     channelInfoLock.Unlock();
-    rxPacketThread.Alert();
+    w.rxPacketThread.Alert();
     return ER_OK;
 }
 
@@ -205,10 +280,22 @@ QStatus PacketEngine::RemovePacketStream(PacketStream& pktStream)
 
     QStatus status = ER_OK;
 
-    /* Abruptly disconnect any channels that are still using pktStream */
-    ChannelInfo* ci = NULL;
-    while ((ci = AcquireNextChannelInfo(ci)) != NULL) {
-        if (&ci->packetStream == &pktStream) {
+    /* Find the channels that are still using pktStream */
+    vector<uint32_t> chanIds;
+    channelInfoLock.Lock();
+    ChannelTable* table = channelTable;
+    for (uint32_t i = 0; i <= table->mask; ++i) {
+        ChannelInfo* ci = table->slots[i];
+        if (ci && (ci != TOMBSTONE) && (&ci->packetStream == &pktStream)) {
+            chanIds.push_back(ci->id);
+        }
+    }
+    channelInfoLock.Unlock();
+
+    /* Abruptly disconnect them */
+    for (size_t i = 0; i < chanIds.size(); ++i) {
+        ChannelInfo* ci = AcquireChannelInfo(chanIds[i]);
+        if (ci) {
             QCC_DbgPrintf(("PacketEngine: Disconnecting PacketEngineStream %p because its PacketStream (%p) has been removed", &ci->stream, &ci->packetStream));
             Disconnect(ci->stream);
             /* Wait for ci to be closed */
@@ -218,19 +305,28 @@ QStatus PacketEngine::RemovePacketStream(PacketStream& pktStream)
                 qcc::Sleep(10);
                 ci = AcquireChannelInfo(chanId);
             }
+            if (ci) {
+                ReleaseChannelInfo(*ci);
+            }
         }
     }
 
-    /* Remove packetStream itself */
+    /* Remove packetStream itself and wait for every rx thread to stop using it */
     channelInfoLock.Lock();
-    map<Event*, pair<PacketStream*, PacketEngineListener*> >::iterator it = packetStreams.find(&pktStream.GetSourceEvent());
+    map<Event*, StreamInfo>::iterator it = packetStreams.find(&pktStream.GetSourceEvent());
     if (it != packetStreams.end()) {
         packetStreams.erase(it);
-        rxPacketThreadReload = false;
+        for (size_t i = 0; i < workers.size(); ++i) {
+            workers[i]->rxReload = false;
+        }
         channelInfoLock.Unlock();
-        rxPacketThread.Alert();
-        while (isRunning && !rxPacketThreadReload) {
-            qcc::Sleep(20);
+        for (size_t i = 0; i < workers.size(); ++i) {
+            workers[i]->rxPacketThread.Alert();
+        }
+        for (size_t i = 0; isRunning && (i < workers.size()); ++i) {
+            while (isRunning && !workers[i]->rxReload) {
+                qcc::Sleep(20);
+            }
         }
     } else {
         channelInfoLock.Unlock();
@@ -265,7 +361,7 @@ QStatus PacketEngine::Connect(const PacketDest& dest, PacketStream& packetStream
         uint32_t timeout = CONNECT_RETRY_TIMEOUT;
         qcc::AlarmListener* packetEngineListener = this;
         ci->connectReqAlarm = Alarm(timeout, packetEngineListener, cctx, zero);
-        status = timer.AddAlarm(ci->connectReqAlarm);
+        status = ci->worker.timer.AddAlarm(ci->connectReqAlarm);
         if (status == ER_OK) {
             /* Send connect request */
             status = DeliverControlMsg(*ci, cctx->connReq, sizeof(cctx->connReq));
@@ -309,7 +405,7 @@ void PacketEngine::CloseChannel(ChannelInfo& ci)
     ci.state = ChannelInfo::CLOSING;
     QStatus status = DeliverControlMsg(ci, ctx->disconnReq, sizeof(ctx->disconnReq));
     if (status == ER_OK) {
-        status = timer.AddAlarm(ci.disconnectReqAlarm);
+        status = ci.worker.timer.AddAlarm(ci.disconnectReqAlarm);
     }
 
     if (status != ER_OK) {
@@ -334,7 +430,7 @@ void PacketEngine::Disconnect(PacketEngineStream& stream)
 QStatus PacketEngine::DeliverControlMsg(PacketEngine::ChannelInfo& ci, const void* buf, size_t len, uint16_t seqNum)
 {
     /* Check size of caller's message */
-    size_t maxPayload = pool.GetMTU() - Packet::payloadOffset;
+    size_t maxPayload = pool.GetMTU() - Packet::maxOverhead;
     if (len > maxPayload) {
         return ER_PACKET_TOO_LARGE;
     }
@@ -347,10 +443,26 @@ QStatus PacketEngine::DeliverControlMsg(PacketEngine::ChannelInfo& ci, const voi
     p->flags = PACKET_FLAG_CONTROL;
     p->expireTs = static_cast<uint64_t>(-1);
     ci.txLock.Lock();
+    p->format = ci.packetFormat;
     ci.txControlQueue.push_back(p);
     ci.txLock.Unlock();
-    QStatus status = txPacketThread.Alert();
-    return status;
+    ScheduleTx(ci);
+    return ER_OK;
+}
+
+void PacketEngine::ScheduleTx(ChannelInfo& ci)
+{
+    Worker& w = ci.worker;
+    w.txReadyLock.Lock();
+    bool wasScheduled = ci.txScheduled;
+    if (!wasScheduled) {
+        ci.txScheduled = true;
+        w.txReady.push_back(ci.id);
+    }
+    w.txReadyLock.Unlock();
+    if (!wasScheduled) {
+        w.txPacketThread.Alert();
+    }
 }
 
 void PacketEngine::AlarmTriggered(const Alarm& alarm, QStatus reason)
@@ -375,7 +487,7 @@ void PacketEngine::AlarmTriggered(const Alarm& alarm, QStatus reason)
                     uint32_t zero = 0;
                     qcc::AlarmListener* packetEngineListener = this;
                     ci->disconnectReqAlarm = Alarm(timeout, packetEngineListener, ctx, zero);
-                    status = timer.AddAlarm(ci->disconnectReqAlarm);
+                    status = ci->worker.timer.AddAlarm(ci->disconnectReqAlarm);
                 }
             }
             if (status != ER_OK) {
@@ -414,7 +526,7 @@ void PacketEngine::AlarmTriggered(const Alarm& alarm, QStatus reason)
                     uint32_t zero = 0;
                     qcc::AlarmListener* packetEngineListener = this;
                     ci->connectReqAlarm = Alarm(timeout, packetEngineListener, ctx, zero);
-                    status = timer.AddAlarm(ci->connectReqAlarm);
+                    status = ci->worker.timer.AddAlarm(ci->connectReqAlarm);
                 }
             }
             if (status != ER_OK) {
@@ -442,7 +554,7 @@ void PacketEngine::AlarmTriggered(const Alarm& alarm, QStatus reason)
                     uint32_t timeout = CONNECT_RETRY_TIMEOUT * cctx->retries;
                     qcc::AlarmListener* packetEngineListener = this;
                     ci->connectRspAlarm = Alarm(timeout, packetEngineListener, ctx, zero);
-                    status = timer.AddAlarm(ci->connectRspAlarm);
+                    status = ci->worker.timer.AddAlarm(ci->connectRspAlarm);
                 }
             }
             if (status != ER_OK) {
@@ -474,7 +586,7 @@ void PacketEngine::AlarmTriggered(const Alarm& alarm, QStatus reason)
                 uint32_t zero = 0;
                 qcc::AlarmListener* packetEngineListener = this;
                 ci->xOnAlarm = Alarm(nextTime, packetEngineListener, ctx, zero);
-                status = timer.AddAlarm(ci->xOnAlarm);
+                status = ci->worker.timer.AddAlarm(ci->xOnAlarm);
                 //printf("rx(%d): xon retry=%d rxD=0x%x, next=%d\n", (GetTimestamp() / 100) % 100000, cctx->retries + 1, ci->rxDrain, nextTime);
             }
             ci->rxLock.Unlock();
@@ -526,6 +638,7 @@ void PacketEngine::AlarmTriggered(const Alarm& alarm, QStatus reason)
 PacketEngine::ChannelInfo::ChannelInfo(PacketEngine& engine, uint32_t id, const PacketDest& dest, PacketStream& packetStream,
                                        PacketEngineListener& listener, uint16_t windowSize) :
     engine(engine),
+    worker(engine.GetWorker(id)),
     id(id),
     state(OPENING),
     dest(dest),
@@ -535,12 +648,14 @@ PacketEngine::ChannelInfo::ChannelInfo(PacketEngine& engine, uint32_t id, const
     packetStream(packetStream),
     listener(listener),
     useCount(0),
+    isUnlinked(false),
     connectReqAlarm(),
     connectRspAlarm(),
     disconnectReqAlarm(),
     disconnectRspAlarm(),
     xOnAlarm(),
     ackAlarmContext(new DelayAckAlarmContext(id)),
+    closingAlarmContext(NULL),
     isAckAlarmArmed(false),
     rxFill(0),
     rxDrain(0),
@@ -557,11 +672,17 @@ PacketEngine::ChannelInfo::ChannelInfo(PacketEngine& engine, uint32_t id, const
     txRttMean(0),
     txRttMeanVar(0),
     txRttInit(false),
-    txCongestionWindow(1),
-    txSlowStartThresh(windowSize),
-    txConsecutiveAcks(0),
+    txCongestion(CongestionControl::Create(engine.ccType, windowSize)),
+    txDupAcks(0),
+    txLastRemoteRxAck(0),
+    txInRecovery(false),
+    txRecoverySeqNum(0),
     txLastMarshalSeqNum(numeric_limits<uint16_t>::max()),
+    txScheduled(false),
+    txRetryArmed(false),
+    txRetryIt(),
     protocolVersion(0),
+    packetFormat(PACKET_FORMAT_CRC16),
     windowSize(windowSize),
     wasOpen(false)
 {
@@ -578,69 +699,8 @@ PacketEngine::ChannelInfo::ChannelInfo(PacketEngine& engine, uint32_t id, const
     rxMask = new uint32_t[rxMaskSize / sizeof(uint32_t)];
     ::memset(rxMask, 0, rxMaskSize);
 
-    /* create ack response buffer */
-    ackResp = new uint32_t[3 + rxMaskSize / sizeof(uint32_t)];
-
-    /* Initialize sink Event */
-    sinkEvent.SetEvent();
-}
-
-PacketEngine::ChannelInfo::ChannelInfo(const ChannelInfo& other) :
-    engine(other.engine),
-    id(other.id),
-    state(other.state),
-    dest(other.dest),
-    sourceEvent(),
-    sinkEvent(),
-    stream(*other.stream.engine, other.id, sourceEvent, sinkEvent),
-    packetStream(other.packetStream),
-    listener(other.listener),
-    useCount(other.useCount),
-    connectReqAlarm(other.connectReqAlarm),
-    connectRspAlarm(other.connectRspAlarm),
-    disconnectReqAlarm(other.disconnectReqAlarm),
-    disconnectRspAlarm(other.disconnectRspAlarm),
-    xOnAlarm(other.xOnAlarm),
-    ackAlarmContext(new DelayAckAlarmContext(other.id)),
-    isAckAlarmArmed(false),
-    rxFill(other.rxFill),
-    rxDrain(other.rxDrain),
-    rxAck(other.rxAck),
-    rxPayloadOffset(other.rxPayloadOffset),
-    rxAdvancedSeqNum(other.rxAdvancedSeqNum),
-    rxFlowOff(other.rxFlowOff),
-    rxFlowSeqNum(other.rxFlowSeqNum),
-    rxIsMidMessage(other.rxIsMidMessage),
-    txFill(other.txFill),
-    txDrain(other.txDrain),
-    remoteRxDrain(other.remoteRxDrain),
-    txControlQueue(),
-    txRttMean(other.txRttMean),
-    txRttMeanVar(other.txRttMeanVar),
-    txRttInit(other.txRttInit),
-    txCongestionWindow(other.txCongestionWindow),
-    txSlowStartThresh(other.txSlowStartThresh),
-    txConsecutiveAcks(other.txConsecutiveAcks),
-    txLastMarshalSeqNum(other.txLastMarshalSeqNum),
-    protocolVersion(other.protocolVersion),
-    windowSize(other.windowSize),
-    wasOpen(other.wasOpen)
-{
-    /* Initialize rxPackets, txPackets and rxMask */
-    rxPackets = new Packet *[windowSize];
-    for (size_t i = 0; i < windowSize; ++i) {
-        rxPackets[i] = NULL;
-    }
-    txPackets = new Packet *[windowSize];
-    for (size_t i = 0; i < windowSize; ++i) {
-        txPackets[i] = NULL;
-    }
-    rxMaskSize = windowSize / 8;
-    rxMask = new uint32_t[rxMaskSize / sizeof(uint32_t)];
-    ::memset(rxMask, 0, rxMaskSize - (rxMaskSize % sizeof(uint32_t)));
-
-    /* create ack response buffer */
-    ackResp = new uint32_t[3 + rxMaskSize / sizeof(uint32_t)];
+    /* create ack response buffer (large enough for either ack format) */
+    ackResp = new uint32_t[::max(3 + rxMaskSize / sizeof(uint32_t), (size_t)(4 + MAX_SACK_RANGES))];
 
     /* Initialize sink Event */
     sinkEvent.SetEvent();
@@ -665,27 +725,27 @@ PacketEngine::ChannelInfo::~ChannelInfo()
 
     AlarmContext* ac = static_cast<AlarmContext*>(connectReqAlarm->GetContext());
     if (ac) {
-        engine.timer.RemoveAlarm(connectReqAlarm);
+        worker.timer.RemoveAlarm(connectReqAlarm);
         delete ac;
     }
     ac = static_cast<AlarmContext*>(connectRspAlarm->GetContext());
     if (ac) {
-        engine.timer.RemoveAlarm(connectRspAlarm);
+        worker.timer.RemoveAlarm(connectRspAlarm);
         delete ac;
     }
     ac = static_cast<AlarmContext*>(disconnectReqAlarm->GetContext());
     if (ac) {
-        engine.timer.RemoveAlarm(disconnectReqAlarm);
+        worker.timer.RemoveAlarm(disconnectReqAlarm);
         delete ac;
     }
     ac = static_cast<AlarmContext*>(disconnectRspAlarm->GetContext());
     if (ac) {
-        engine.timer.RemoveAlarm(disconnectRspAlarm);
+        worker.timer.RemoveAlarm(disconnectRspAlarm);
         delete ac;
     }
     ac = static_cast<AlarmContext*>(xOnAlarm->GetContext());
     if (ac) {
-        engine.timer.RemoveAlarm(xOnAlarm);
+        worker.timer.RemoveAlarm(xOnAlarm);
         delete ac;
     }
 
@@ -701,19 +761,123 @@ PacketEngine::ChannelInfo::~ChannelInfo()
     delete[] txPackets;
     delete[] rxMask;
     delete[] ackResp;
+    delete txCongestion;
+}
+
+void PacketEngine::Retire(ChannelTable* table, ChannelInfo* channel)
+{
+    /*
+     * Called with channelInfoLock held after a channel or table has been unpublished. Lookups
+     * that start after this cannot find it. ReclaimRetired frees it on the next release or
+     * resize that finds the earlier lookups done, or when the engine is destroyed.
+     */
+    Retired r;
+    lookupGuard.Retire(r.ticket);
+    r.table = table;
+    r.channel = channel;
+    retired.push_back(r);
+}
+
+void PacketEngine::ReclaimRetired()
+{
+    vector<Retired> ready;
+    channelInfoLock.Lock();
+    size_t i = 0;
+    while (i < retired.size()) {
+        if (lookupGuard.Reclaimable(retired[i].ticket)) {
+            ready.push_back(retired[i]);
+            retired[i] = retired.back();
+            retired.pop_back();
+        } else {
+            ++i;
+        }
+    }
+    /* Move new lookups to the other counter so the one that is still busy can drain */
+    if (!retired.empty()) {
+        lookupGuard.Advance();
+    }
+    channelInfoLock.Unlock();
+
+    /* The ChannelInfo destructor removes alarms so it must not run with channelInfoLock held */
+    for (i = 0; i < ready.size(); ++i) {
+        if (ready[i].table) {
+            delete [] ready[i].table->slots;
+            delete ready[i].table;
+        }
+        delete ready[i].channel;
+    }
+}
+
+void PacketEngine::ResizeChannelTable(uint32_t numSlots)
+{
+    ChannelTable* table = new ChannelTable;
+    table->mask = numSlots - 1;
+    table->used = 0;
+    table->slots = new ChannelInfo* volatile[numSlots];
+    for (uint32_t i = 0; i < numSlots; ++i) {
+        table->slots[i] = NULL;
+    }
+
+    /* Move the live channels. Tombstones are dropped */
+    ChannelTable* oldTable = channelTable;
+    if (oldTable) {
+        for (uint32_t i = 0; i <= oldTable->mask; ++i) {
+            ChannelInfo* ci = oldTable->slots[i];
+            if (ci && (ci != TOMBSTONE)) {
+                uint32_t idx = ChannelHash(ci->id) & table->mask;
+                while (table->slots[idx]) {
+                    idx = (idx + 1) & table->mask;
+                }
+                table->slots[idx] = ci;
+                table->used++;
+            }
+        }
+    }
+
+    /* Publish the new table */
+    PublishBarrier();
+    channelTable = table;
+    if (oldTable) {
+        Retire(oldTable, NULL);
+    }
 }
 
 PacketEngine::ChannelInfo* PacketEngine::CreateChannelInfo(uint32_t chanId, const PacketDest& dest, PacketStream& packetStream,
                                                            PacketEngineListener& listener, uint16_t windowSize)
 {
     ChannelInfo* ret = NULL;
+    bool resized = false;
     channelInfoLock.Lock();
-    if (channelInfos.find(chanId) == channelInfos.end()) {
-        /* Make sure packetStream is still on the list while holding channelInfos lock */
+
+    /* Make sure chanId is not in use and find the slot for it */
+    ChannelTable* table = channelTable;
+    uint32_t idx = ChannelHash(chanId) & table->mask;
+    uint32_t freeIdx = table->mask + 1;
+    bool exists = false;
+    for (uint32_t i = 0; i <= table->mask; ++i) {
+        ChannelInfo* ci = table->slots[idx];
+        if (!ci) {
+            if (freeIdx > table->mask) {
+                freeIdx = idx;
+            }
+            break;
+        } else if (ci == TOMBSTONE) {
+            if (freeIdx > table->mask) {
+                freeIdx = idx;
+            }
+        } else if (ci->id == chanId) {
+            exists = true;
+            break;
+        }
+        idx = (idx + 1) & table->mask;
+    }
+
+    if (!exists) {
+        /* Make sure packetStream is still on the list while holding channelInfoLock */
         bool found = false;
-        map<Event*, pair<PacketStream*, PacketEngineListener*> >::iterator it = packetStreams.begin();
+        map<Event*, StreamInfo>::iterator it = packetStreams.begin();
         while (it != packetStreams.end()) {
-            if (it->second.first == &packetStream) {
+            if (it->second.stream == &packetStream) {
                 found = true;
                 break;
             }
@@ -722,65 +886,108 @@ PacketEngine::ChannelInfo* PacketEngine::CreateChannelInfo(uint32_t chanId, cons
 
         /* Add ChannelInfo if packetStream was valid */
         if (found) {
-            ret = &(channelInfos.insert(pair<uint32_t, ChannelInfo>(chanId, ChannelInfo(*this, chanId, dest, packetStream, listener, windowSize))).first->second);
-            ret->useCount = 1;
+            ret = new ChannelInfo(*this, chanId, dest, packetStream, listener, windowSize);
+            /* One reference for the table and one for the caller */
+            ret->useCount = 2;
+
+            /* Keep the table at most 3/4 full (counting tombstones) so probe sequences stay short */
+            if ((freeIdx > table->mask) || (table->slots[freeIdx] == NULL)) {
+                if (((table->used + 1) * 4) > ((table->mask + 1) * 3)) {
+                    uint32_t live = 0;
+                    for (uint32_t i = 0; i <= table->mask; ++i) {
+                        if (table->slots[i] && (table->slots[i] != TOMBSTONE)) {
+                            ++live;
+                        }
+                    }
+                    uint32_t numSlots = CHANNEL_TABLE_MIN_SLOTS;
+                    while ((numSlots * 3) < ((live + 1) * 8)) {
+                        numSlots <<= 1;
+                    }
+                    ResizeChannelTable(numSlots);
+                    resized = true;
+                    table = channelTable;
+                    freeIdx = ChannelHash(chanId) & table->mask;
+                    while (table->slots[freeIdx]) {
+                        freeIdx = (freeIdx + 1) & table->mask;
+                    }
+                }
+                table->used++;
+            }
+
+            /* Publish the channel */
+            PublishBarrier();
+            table->slots[freeIdx] = ret;
         }
     }
     channelInfoLock.Unlock();
+    if (resized) {
+        ReclaimRetired();
+    }
     return ret;
 }
 
 PacketEngine::ChannelInfo* PacketEngine::AcquireChannelInfo(uint32_t chanId)
 {
     ChannelInfo* ret = NULL;
-    channelInfoLock.Lock();
-    map<uint32_t, ChannelInfo>::iterator it = channelInfos.find(chanId);
-    if (it != channelInfos.end()) {
-        ret = &(it->second);
-        ret->useCount++;
+    int32_t epoch = lookupGuard.EnterLookup();
+    ChannelTable* table = channelTable;
+    uint32_t idx = ChannelHash(chanId) & table->mask;
+    for (uint32_t i = 0; i <= table->mask; ++i) {
+        ChannelInfo* ci = table->slots[idx];
+        if (!ci) {
+            break;
+        } else if ((ci != TOMBSTONE) && (ci->id == chanId)) {
+            /*
+             * A zero useCount means the channel was unlinked and is waiting to be deleted. Back off
+             * without touching it again once the lookup ends.
+             */
+            if (IncrementAndFetch(&ci->useCount) > 1) {
+                ret = ci;
+            } else {
+                DecrementAndFetch(&ci->useCount);
+            }
+            break;
+        }
+        idx = (idx + 1) & table->mask;
     }
-    channelInfoLock.Unlock();
+    lookupGuard.ExitLookup(epoch);
     return ret;
 }
 
-PacketEngine::ChannelInfo* PacketEngine::AcquireNextChannelInfo(PacketEngine::ChannelInfo* inCi)
+void PacketEngine::ReleaseChannelInfo(ChannelInfo& ci)
 {
-    ChannelInfo* ret = NULL;
-    channelInfoLock.Lock();
-    map<uint32_t, ChannelInfo>::iterator it = channelInfos.begin();
-    if (inCi) {
-        it = channelInfos.find(inCi->id);
-        if (it != channelInfos.end()) {
-            ++it;
+    /* Drop the table's reference the first time a CLOSED channel is released */
+    if (ci.state == ChannelInfo::CLOSED) {
+        channelInfoLock.Lock();
+        if (!ci.isUnlinked) {
+            ChannelTable* table = channelTable;
+            uint32_t idx = ChannelHash(ci.id) & table->mask;
+            for (uint32_t i = 0; i <= table->mask; ++i) {
+                if (table->slots[idx] == &ci) {
+                    table->slots[idx] = TOMBSTONE;
+                    break;
+                }
+                idx = (idx + 1) & table->mask;
+            }
+            ci.isUnlinked = true;
+            DecrementAndFetch(&ci.useCount);
         }
+        channelInfoLock.Unlock();
     }
-    if (it != channelInfos.end()) {
-        ret = &(it->second);
-        ret->useCount++;
-    }
-    channelInfoLock.Unlock();
-    if (inCi) {
-        ReleaseChannelInfo(*inCi);
-    }
-    return ret;
-}
 
-void PacketEngine::ReleaseChannelInfo(ChannelInfo& ci)
-{
-    channelInfoLock.Lock();
-    if ((--ci.useCount == 0) && (ci.state == ChannelInfo::CLOSED)) {
+    if (DecrementAndFetch(&ci.useCount) == 0) {
         PacketEngineStream stream = ci.stream;
         PacketEngineListener& listener = ci.listener;
         PacketDest dest = ci.dest;
 
-        /* Erase entry in channelInfos */
-        channelInfos.erase(ci.id);
+        /* Lookups may have found ci before it was unlinked so it is freed once they are done */
+        channelInfoLock.Lock();
+        Retire(NULL, &ci);
+        channelInfoLock.Unlock();
+        ReclaimRetired();
 
         /* Notify disconnect cb (Must be done without holding channelInfoLock) */
-        channelInfoLock.Unlock();
         listener.PacketEngineDisconnectCB(*this, stream, dest);
-    } else {
-        channelInfoLock.Unlock();
     }
 }
 
@@ -797,7 +1004,7 @@ void PacketEngine::SendAck(ChannelInfo& ci, uint16_t seqNum, bool allowDelay)
             uint32_t timeout = ACK_DELAY_MS;
             qcc::AlarmListener* packetEngineListener = this;
             Alarm a(timeout, packetEngineListener, ci.ackAlarmContext, zero);
-            QStatus status = timer.AddAlarm(a);
+            QStatus status = ci.worker.timer.AddAlarm(a);
             ci.isAckAlarmArmed = (status == ER_OK);
             if (status != ER_OK) {
                 QCC_LogError(status, ("SendAck failed to add alarm"));
@@ -813,15 +1020,45 @@ void PacketEngine::SendAck(ChannelInfo& ci, uint16_t seqNum, bool allowDelay)
 void PacketEngine::SendAckNow(ChannelInfo& ci, uint16_t seqNum)
 {
     QCC_DbgTrace(("SendAckNow(dst=%s, seqNum=0x%x, rxDrain=0x%x, rxAck=0x%x)", ToString(ci.packetStream, ci.dest).c_str(), seqNum, ci.rxDrain, ci.rxAck));
+    size_t ackLen;
     ci.rxLock.Lock();
     ci.ackResp[0] = htole32(PACKET_COMMAND_ACK);
     ci.ackResp[1] = htole32(ci.rxAck);
     ci.ackResp[2] = htole32(ci.rxDrain);
-    for (size_t i = 0; i < (ci.rxMaskSize / sizeof(uint32_t)); ++i) {
-        ci.ackResp[3 + i] = htole32(ci.rxMask[i]);
+    if (ci.protocolVersion >= PACKET_ENGINE_SACK_VERSION) {
+        /*
+         * Describe the packets received beyond rxAck as [start, end) seqNum ranges.
+         * Each range is packed into one word as start | (end << 16).
+         */
+        uint32_t numRanges = 0;
+        uint16_t end = ci.rxAdvancedSeqNum + 1;
+        uint16_t start = 0;
+        bool inRange = false;
+        uint16_t s = ci.rxAck;
+        for (uint16_t n = 0; (s != end) && (n < ci.windowSize) && (numRanges < MAX_SACK_RANGES); ++n, ++s) {
+            uint16_t idx = s % ci.windowSize;
+            bool received = (ci.rxMask[idx / 32] & (0x01 << (idx % 32))) != 0;
+            if (received && !inRange) {
+                start = s;
+                inRange = true;
+            } else if (!received && inRange) {
+                ci.ackResp[4 + numRanges++] = htole32(start | (s << 16));
+                inRange = false;
+            }
+        }
+        if (inRange && (numRanges < MAX_SACK_RANGES)) {
+            ci.ackResp[4 + numRanges++] = htole32(start | (s << 16));
+        }
+        ci.ackResp[3] = htole32(numRanges);
+        ackLen = (4 + numRanges) * sizeof(uint32_t);
+    } else {
+        for (size_t i = 0; i < (ci.rxMaskSize / sizeof(uint32_t)); ++i) {
+            ci.ackResp[3 + i] = htole32(ci.rxMask[i]);
+        }
+        ackLen = 3 * sizeof(uint32_t) + ci.rxMaskSize;
     }
     ci.rxLock.Unlock();
-    QStatus status = DeliverControlMsg(ci, ci.ackResp, 3 * sizeof(uint32_t) + ci.rxMaskSize, seqNum);
+    QStatus status = DeliverControlMsg(ci, ci.ackResp, ackLen, seqNum);
     if (status != ER_OK) {
         QCC_LogError(status, ("SendAckNow failed"));
     }
@@ -852,7 +1089,7 @@ void PacketEngine::SendXOn(ChannelInfo& ci)
         uint32_t timeout = GetRetryMs(ci, ++cctx->retries);
         qcc::AlarmListener* packetEngineListener = this;
         ci.xOnAlarm = Alarm(timeout, packetEngineListener, cctx, zero);
-        QStatus status = timer.AddAlarm(ci.xOnAlarm);
+        QStatus status = ci.worker.timer.AddAlarm(ci.xOnAlarm);
         if (status == ER_OK) {
             status = DeliverControlMsg(ci, cctx->xon, sizeof(cctx->xon));
         } else {
@@ -864,7 +1101,10 @@ void PacketEngine::SendXOn(ChannelInfo& ci)
     ci.rxLock.Unlock();
 }
 
-PacketEngine::RxPacketThread::RxPacketThread(const qcc::String& engineName) : Thread(engineName + "-rx"), engine(NULL)
+PacketEngine::RxPacketThread::RxPacketThread(const qcc::String& threadName, Worker& worker) :
+    Thread(threadName),
+    engine(NULL),
+    worker(worker)
 {
 }
 
@@ -874,42 +1114,69 @@ qcc::ThreadReturn STDCALL PacketEngine::RxPacketThread::Run(void* arg)
     vector<Event*> checkEvents, sigEvents;
     QStatus status = ER_OK;
     Event& stopEvent = GetStopEvent();
+
+    /*
+     * Packets are pulled in batches. Slots [0, refill) of the batch have been handed off to the
+     * packet handlers and must be replenished from the pool before the next pull.
+     */
+    Packet* batch[PACKET_IO_BATCH];
+    PacketBuffer bufs[PACKET_IO_BATCH];
+    size_t refill = PACKET_IO_BATCH;
     while (!IsStopping() && (status == ER_OK)) {
         checkEvents.clear();
         sigEvents.clear();
         checkEvents.push_back(&stopEvent);
-        engine->rxPacketThreadReload = true;
+        checkEvents.push_back(&worker.handoffEvent);
+        worker.rxReload = true;
         engine->channelInfoLock.Lock();
-        map<Event*, pair<PacketStream*, PacketEngineListener*> >::iterator sit = engine->packetStreams.begin();
+        map<Event*, StreamInfo>::iterator sit = engine->packetStreams.begin();
         while (sit != engine->packetStreams.end()) {
-            checkEvents.push_back(sit->first);
+            if (sit->second.rxWorker == worker.index) {
+                checkEvents.push_back(sit->first);
+            }
             sit++;
         }
         engine->channelInfoLock.Unlock();
         status = Event::Wait(checkEvents, sigEvents, Event::WAIT_FOREVER);
         if (status == ER_OK) {
             while (!sigEvents.empty()) {
+                if (sigEvents.back() == &worker.handoffEvent) {
+                    HandleHandoffs();
+                    sigEvents.pop_back();
+                    continue;
+                }
                 engine->channelInfoLock.Lock();
-                map<Event*, pair<PacketStream*, PacketEngineListener*> >::const_iterator it = engine->packetStreams.find(sigEvents.back());
+                map<Event*, StreamInfo>::const_iterator it = engine->packetStreams.find(sigEvents.back());
                 if (it != engine->packetStreams.end()) {
-                    PacketStream& stream = *(it->second.first);
-                    PacketEngineListener& listener = *(it->second.second);
-                    Packet* p = engine->pool.GetPacket();
-                    status = p->Unmarshal(stream);
+                    PacketStream& stream = *(it->second.stream);
+                    PacketEngineListener& listener = *(it->second.listener);
+                    engine->pool.GetPackets(batch, refill);
+                    for (size_t i = 0; i < PACKET_IO_BATCH; ++i) {
+                        bufs[i].buf = batch[i]->buffer;
+                        bufs[i].len = engine->pool.GetMTU();
+                    }
+                    /* The source event is signaled so don't wait while holding channelInfoLock */
+                    size_t numPulled = 0;
+                    status = stream.PullPacketBatch(bufs, PACKET_IO_BATCH, numPulled, 0);
                     engine->channelInfoLock.Unlock();
-                    if (status == ER_OK) {
-                        /* Handle control or data packet */
-                        if (p->flags & PACKET_FLAG_CONTROL) {
-                            HandleControlPacket(p, stream, listener);
+                    if (status != ER_OK) {
+                        /* Failing to pull packets is not fatal */
+                        QCC_DbgPrintf(("PullPacketBatch failed with %s", QCC_StatusText(status)));
+                        status = ER_OK;
+                    }
+                    for (size_t i = 0; i < numPulled; ++i) {
+                        Packet* p = batch[i];
+                        status = p->Unmarshal(bufs[i].dest, bufs[i].len);
+                        if (status == ER_OK) {
+                            DispatchPacket(p, stream, listener);
                         } else {
-                            HandleDataPacket(p);
+                            /* Failed to unmarshal a single packet. This is not fatal */
+                            QCC_DbgPrintf(("Packet::Unmarshal failed with %s", QCC_StatusText(status)));
+                            engine->pool.ReturnPacket(p);
+                            status = ER_OK;
                         }
-                    } else {
-                        /* Failed to unmarshal a single packet. This is not fatal */
-                        QCC_DbgPrintf(("Packet::Unmarshal failed with %s", QCC_StatusText(status)));
-                        engine->pool.ReturnPacket(p);
-                        status = ER_OK;
                     }
+                    refill = numPulled;
                 } else {
                     engine->channelInfoLock.Unlock();
                     if (sigEvents.back() == &stopEvent) {
@@ -920,12 +1187,82 @@ qcc::ThreadReturn STDCALL PacketEngine::RxPacketThread::Run(void* arg)
             }
         }
     }
+    /* Return the unused part of the batch and any packets that were never handled */
+    for (size_t i = refill; i < PACKET_IO_BATCH; ++i) {
+        engine->pool.ReturnPacket(batch[i]);
+    }
+    worker.handoffLock.Lock();
+    while (!worker.handoffQueue.empty()) {
+        engine->pool.ReturnPacket(worker.handoffQueue.front().packet);
+        worker.handoffQueue.pop_front();
+    }
+    worker.handoffLock.Unlock();
     if (status != ER_STOPPING_THREAD) {
         QCC_DbgPrintf(("RxPacketThread::Run() exiting with %s", QCC_StatusText(status)));
     }
     return (qcc::ThreadReturn) status;
 }
 
+void PacketEngine::RxPacketThread::DispatchPacket(Packet* p, PacketStream& packetStream, PacketEngineListener& listener)
+{
+    Worker& owner = engine->GetWorker(p->chanId);
+    if (&owner == &worker) {
+        /* Handle control or data packet */
+        if (p->flags & PACKET_FLAG_CONTROL) {
+            HandleControlPacket(p, packetStream, listener);
+        } else {
+            HandleDataPacket(p);
+        }
+    } else {
+        /* Only the owning worker touches a channel's receive state */
+        RxHandoff handoff;
+        handoff.packet = p;
+        handoff.stream = &packetStream;
+        handoff.listener = &listener;
+        owner.handoffLock.Lock();
+        owner.handoffQueue.push_back(handoff);
+        owner.handoffEvent.SetEvent();
+        owner.handoffLock.Unlock();
+    }
+}
+
+void PacketEngine::RxPacketThread::HandleHandoffs()
+{
+    worker.handoffLock.Lock();
+    deque<RxHandoff> handoffs;
+    handoffs.swap(worker.handoffQueue);
+    worker.handoffEvent.ResetEvent();
+    worker.handoffLock.Unlock();
+
+    while (!handoffs.empty()) {
+        RxHandoff& h = handoffs.front();
+
+        /* The stream may have been removed while the packet was queued */
+        bool isValid = false;
+        engine->channelInfoLock.Lock();
+        map<Event*, StreamInfo>::const_iterator it = engine->packetStreams.begin();
+        while (it != engine->packetStreams.end()) {
+            if (it->second.stream == h.stream) {
+                isValid = true;
+                break;
+            }
+            ++it;
+        }
+        engine->channelInfoLock.Unlock();
+
+        if (isValid) {
+            if (h.packet->flags & PACKET_FLAG_CONTROL) {
+                HandleControlPacket(h.packet, *h.stream, *h.listener);
+            } else {
+                HandleDataPacket(h.packet);
+            }
+        } else {
+            engine->pool.ReturnPacket(h.packet);
+        }
+        handoffs.pop_front();
+    }
+}
+
 void PacketEngine::RxPacketThread::HandleControlPacket(Packet* p, PacketStream& packetStream, PacketEngineListener& listener)
 {
     uint32_t cmd = letoh32(p->payload[0]);
@@ -1139,6 +1476,9 @@ void PacketEngine::RxPacketThread::HandleConnectReq(Packet* p, PacketStream& pac
 
         /* Update protocol version for this channel */
         ci->protocolVersion = ::min(reqProtoVersion, (uint32_t)PACKET_ENGINE_VERSION);
+        ci->txLock.Lock();
+        ci->packetFormat = (ci->protocolVersion >= PACKET_ENGINE_CRC32C_VERSION) ? PACKET_FORMAT_CRC32C : PACKET_FORMAT_CRC16;
+        ci->txLock.Unlock();
 
         /* Create the connect response */
         ConnectRspAlarmContext* cctx = new ConnectRspAlarmContext(ci->id, ci->dest);
@@ -1151,7 +1491,7 @@ void PacketEngine::RxPacketThread::HandleConnectReq(Packet* p, PacketStream& pac
         uint32_t timeout = CONNECT_RETRY_TIMEOUT;
         uint32_t zero = 0;
         ci->connectRspAlarm = Alarm(timeout, engine, cctx, zero);
-        QStatus status = engine->timer.AddAlarm(ci->connectRspAlarm);
+        QStatus status = ci->worker.timer.AddAlarm(ci->connectRspAlarm);
 
         if (status == ER_OK) {
             ci->state = ChannelInfo::OPENING;
@@ -1186,7 +1526,7 @@ void PacketEngine::RxPacketThread::HandleConnectRsp(Packet* p)
         ConnectReqAlarmContext* ctx = static_cast<ConnectReqAlarmContext*>(ci->connectReqAlarm->GetContext());
         if (ctx) {
             /* Disable any connectReqAlarm retry timer */
-            engine->timer.RemoveAlarm(ci->connectReqAlarm);
+            ci->worker.timer.RemoveAlarm(ci->connectReqAlarm);
 
             /* Call user callback (once) */
             if (ci->state == ChannelInfo::OPENING) {
@@ -1204,6 +1544,11 @@ void PacketEngine::RxPacketThread::HandleConnectRsp(Packet* p)
                 /* Update channelInfo and call the user's callback */
                 ci->state = (rspStatus == ER_OK) ? ChannelInfo::OPEN : ChannelInfo::CLOSING;
                 ci->windowSize = reqWindowSize;
+                ci->protocolVersion = reqProtoVersion;
+                ci->txLock.Lock();
+                ci->packetFormat = (ci->protocolVersion >= PACKET_ENGINE_CRC32C_VERSION) ? PACKET_FORMAT_CRC32C : PACKET_FORMAT_CRC16;
+                ci->txCongestion->SetMaxWindow(ci->windowSize);
+                ci->txLock.Unlock();
                 ci->wasOpen = (ci->state == ChannelInfo::OPEN);
                 ci->listener.PacketEngineConnectCB(*engine, rspStatus, &ci->stream, ci->dest, ctx->context);
 
@@ -1212,7 +1557,7 @@ void PacketEngine::RxPacketThread::HandleConnectRsp(Packet* p)
                     ci->closingAlarmContext = new ClosingAlarmContext(ci->id);
                     uint32_t timeout = CLOSING_TIMEOUT;
                     uint32_t zero = 0;
-                    engine->timer.AddAlarm(Alarm(timeout, engine, ci->closingAlarmContext, zero));
+                    ci->worker.timer.AddAlarm(Alarm(timeout, engine, ci->closingAlarmContext, zero));
                 }
             } else if ((ci->state != ChannelInfo::OPEN) && (ci->state != ChannelInfo::CLOSING)) {
                 /* Only allow retry of ack if state OPEN or CLOSING */
@@ -1243,7 +1588,7 @@ void PacketEngine::RxPacketThread::HandleConnectRspAck(Packet* p)
     QCC_DbgTrace(("PacketEngine::HandleConnectRspAck(%s)", ci ? engine->ToString(ci->packetStream, p->GetSender()).c_str() : ""));
     if (ci && ctx) {
         /* Disable any connect(Rsp)Alarm retry timer */
-        engine->timer.RemoveAlarm(ci->connectRspAlarm);
+        ci->worker.timer.RemoveAlarm(ci->connectRspAlarm);
         ci->connectRspAlarm = Alarm();
         delete ctx;
         if (ci->state == ChannelInfo::OPENING) {
@@ -1267,7 +1612,7 @@ void PacketEngine::RxPacketThread::HandleDisconnectReq(Packet* p)
             uint32_t timeout = DISCONNECT_TIMEOUT;
             uint32_t zero = 0;
             ci->disconnectRspAlarm = Alarm(timeout, engine, ctx, zero);
-            engine->timer.AddAlarm(ci->disconnectRspAlarm);
+            ci->worker.timer.AddAlarm(ci->disconnectRspAlarm);
             ci->state = ChannelInfo::CLOSING;
         }
         /* Send disconnect response */
@@ -1285,7 +1630,7 @@ void PacketEngine::RxPacketThread::HandleDisconnectRsp(Packet* p)
     DisconnectReqAlarmContext* ctx = static_cast<DisconnectReqAlarmContext*>(ci ? ci->disconnectReqAlarm->GetContext() : NULL);
     if (ci && ctx) {
         /* Ignore disconnect rsp that has already timed out */
-        engine->timer.RemoveAlarm(ci->disconnectReqAlarm);
+        ci->worker.timer.RemoveAlarm(ci->disconnectReqAlarm);
         ci->disconnectReqAlarm = Alarm();
         delete ctx;
         QCC_DbgPrintf(("PacketEngine::HandleDisconnectRsp: Closing id=0x%x", ci->id));
@@ -1309,6 +1654,9 @@ void PacketEngine::RxPacketThread::HandleAck(Packet* controlPacket)
         uint16_t remoteRxDrain = letoh32(controlPacket->payload[2]);
         uint16_t delta = remoteRxAck - remoteRxDrain;
         uint16_t ackedPackets = 0;
+        uint16_t lostPackets = 0;
+        uint32_t rttMs = 0;
+        uint64_t now = GetTimestamp64();
 
         if (delta >= ci->windowSize) {
             delta += ci->windowSize;
@@ -1329,7 +1677,6 @@ void PacketEngine::RxPacketThread::HandleAck(Packet* controlPacket)
                  * txRttMeanDev = txRttMeanDev + ((|err| - txRttMeanDev) / 4)
                  */
                 if (p->sendAttempts == 1) {
-                    uint64_t now = GetTimestamp64();
                     int32_t rtt = static_cast<int32_t>((now - p->sendTs + 1) << 10);
                     if (ci->txRttInit) {
                         int32_t err = (rtt - ci->txRttMean);
@@ -1339,6 +1686,7 @@ void PacketEngine::RxPacketThread::HandleAck(Packet* controlPacket)
                         ci->txRttMean = rtt;
                         ci->txRttInit = true;
                     }
+                    rttMs = static_cast<uint32_t>(now - p->sendTs + 1);
                 }
                 /* Remove packet from tx queue */
                 //printf("tx(%d): clr0 s=0x%x, txD=0x%x, idx=0x%x\n", (GetTimestamp() / 100) % 100000, p->seqNum, ci->txDrain, controlPacket->seqNum % ci->windowSize);
@@ -1349,55 +1697,48 @@ void PacketEngine::RxPacketThread::HandleAck(Packet* controlPacket)
             /* Advance txDrain to remoteRxAck */
             AdvanceTxDrain(*ci, remoteRxAck, ackedPackets);
 
-            /* Clear acked packets (set bits in mask) between remoteRxAck and txDrain */
-            uint16_t ackIdx = controlPacket->seqNum % ci->windowSize;
-            uint16_t drainIdx = ci->txDrain % ci->windowSize;
-            while (ackIdx != drainIdx) {
-                /* If bit is set in mask, then packet is acked and can be cleared */
-                uint32_t m = letoh32(controlPacket->payload[3 + (drainIdx / 32)]);
-                if (m & (0x01 << (drainIdx % 32))) {
-                    if (ci->txPackets[drainIdx]) {
-                        //printf("tx(%d): ack clr2 s=0x%x, txD=0x%x, idx=0x%x, txF=0x%x\n", (GetTimestamp() / 100) % 100000, ci->txPackets[drainIdx]->seqNum, ci->txDrain, drainIdx, ci->txFill);
-                        engine->pool.ReturnPacket(ci->txPackets[drainIdx]);
-                        ci->txPackets[drainIdx] = NULL;
-                        ackedPackets++;
-                    }
-                }
-                drainIdx = (drainIdx == (ci->windowSize - 1)) ? 0 : (drainIdx + 1);
+            /* Clear selectively acked packets and mark lost packets for fast retransmit */
+            if (ci->protocolVersion >= PACKET_ENGINE_SACK_VERSION) {
+                HandleAckRanges(*ci, controlPacket, remoteRxAck, ackedPackets, lostPackets);
+            } else {
+                HandleAckMask(*ci, controlPacket, remoteRxAck, ackedPackets, lostPackets);
             }
 
             /*
-             * Check for fast retransmit by examining packets between remoteRxAck and current packet's seqNum.
-             * Fast retransmit occurs if there is a hole in acked packets that is 3 or more back from the packet
-             * seqNum which hasn't already been fast retransmitted.
+             * Count duplicate acks (acks that don't move remoteRxAck while packets are outstanding).
+             * The packet at remoteRxAck is fast retransmitted on the DUP_ACK_THRESHOLD'th duplicate
+             * even if the acks did not carry enough selective ack information to find the hole.
              */
-            uint32_t idx = controlPacket->seqNum % ci->windowSize;
-            ackIdx = ((remoteRxAck == 0) ? (ci->windowSize - 1) : (remoteRxAck - 1)) % ci->windowSize;
-            uint16_t ackCount = 0;
-            while (idx != ackIdx) {
-                uint32_t m = letoh32(controlPacket->payload[3 + (idx / 32)]);
-                if (m & (0x01 << (idx % 32))) {
-                    ++ackCount;
-                } else if ((ackCount >= 3) && ci->txPackets[idx] && (ci->txPackets[idx]->sendAttempts > 0) && !ci->txPackets[idx]->fastRetransmit) {
-                    ci->txPackets[idx]->fastRetransmit = true;
-                    ci->txPackets[idx]->sendTs = 0;
-                    //printf("tx(%d): fast retrans s=0x%x\n", (GetTimestamp() / 100) % 100000, ci->txPackets[idx]->seqNum);
+            if ((remoteRxAck == ci->txLastRemoteRxAck) && (ci->txDrain != ci->txFill)) {
+                if (++ci->txDupAcks == DUP_ACK_THRESHOLD) {
+                    Packet* tp = ci->txPackets[ci->txDrain % ci->windowSize];
+                    if (tp && (tp->seqNum == ci->txDrain) && (tp->sendAttempts > 0) && !tp->fastRetransmit) {
+                        tp->fastRetransmit = true;
+                        tp->sendTs = 0;
+                        ++lostPackets;
+                    }
                 }
-                idx = (idx == 0) ? (ci->windowSize - 1) : (idx - 1);
+            } else {
+                ci->txLastRemoteRxAck = remoteRxAck;
+                ci->txDupAcks = 0;
             }
 
-            /* Receiving ack indicates no/reduced congestion. Increase window */
-            while (ackedPackets && (ci->txCongestionWindow < ci->windowSize)) {
-                if ((ci->txCongestionWindow < ci->txSlowStartThresh) || (ci->txConsecutiveAcks >= ci->txCongestionWindow)) {
-                    ++ci->txCongestionWindow;
-                    ci->txConsecutiveAcks = 0;
-                    QCC_DbgPrintf(("Increasing congestion window of %s to %d", engine->ToString(ci->packetStream, ci->dest).c_str(), ci->txCongestionWindow));
-                } else {
-                    ci->txConsecutiveAcks++;
-                }
-                ackedPackets--;
+            /* Recovery ends once everything that was outstanding when it started has been acked */
+            if (ci->txInRecovery && IN_WINDOW(uint16_t, ci->txRecoverySeqNum, ci->windowSize, ci->txDrain)) {
+                ci->txInRecovery = false;
             }
-            engine->txPacketThread.Alert();
+
+            /* Reduce the congestion window once per loss event. Otherwise grow it. */
+            if (lostPackets && !ci->txInRecovery) {
+                ci->txCongestion->OnLoss(now);
+                ci->txInRecovery = true;
+                ci->txRecoverySeqNum = ci->txFill;
+                QCC_DbgPrintf(("Decreasing congestion window of %s to %d (fast retransmit)", engine->ToString(ci->packetStream, ci->dest).c_str(), ci->txCongestion->GetWindow()));
+            } else if (ackedPackets && !ci->txInRecovery) {
+                ci->txCongestion->OnAck(ackedPackets, rttMs, now);
+                QCC_DbgPrintf(("Congestion window of %s is %d", engine->ToString(ci->packetStream, ci->dest).c_str(), ci->txCongestion->GetWindow()));
+            }
+            engine->ScheduleTx(*ci);
         } else {
             QCC_DbgPrintf(("Invalid ack window: seqNum=0x%x, drain=0x%x, ack=0x%x", controlPacket->seqNum, ci->remoteRxDrain, remoteRxAck));
         }
@@ -1406,6 +1747,106 @@ void PacketEngine::RxPacketThread::HandleAck(Packet* controlPacket)
     }
 }
 
+void PacketEngine::RxPacketThread::HandleAckMask(ChannelInfo& ci, Packet* controlPacket, uint16_t remoteRxAck, uint16_t& ackedPackets, uint16_t& lostPackets)
+{
+    /* Clear acked packets (set bits in mask) between remoteRxAck and txDrain */
+    uint16_t ackIdx = controlPacket->seqNum % ci.windowSize;
+    uint16_t drainIdx = ci.txDrain % ci.windowSize;
+    while (ackIdx != drainIdx) {
+        /* If bit is set in mask, then packet is acked and can be cleared */
+        uint32_t m = letoh32(controlPacket->payload[3 + (drainIdx / 32)]);
+        if (m & (0x01 << (drainIdx % 32))) {
+            if (ci.txPackets[drainIdx]) {
+                //printf("tx(%d): ack clr2 s=0x%x, txD=0x%x, idx=0x%x, txF=0x%x\n", (GetTimestamp() / 100) % 100000, ci.txPackets[drainIdx]->seqNum, ci.txDrain, drainIdx, ci.txFill);
+                engine->pool.ReturnPacket(ci.txPackets[drainIdx]);
+                ci.txPackets[drainIdx] = NULL;
+                ackedPackets++;
+            }
+        }
+        drainIdx = (drainIdx == (ci.windowSize - 1)) ? 0 : (drainIdx + 1);
+    }
+
+    /*
+     * Check for fast retransmit by examining packets between remoteRxAck and current packet's seqNum.
+     * Fast retransmit occurs if there is a hole in acked packets that is 3 or more back from the packet
+     * seqNum which hasn't already been fast retransmitted.
+     */
+    uint32_t idx = controlPacket->seqNum % ci.windowSize;
+    ackIdx = ((remoteRxAck == 0) ? (ci.windowSize - 1) : (remoteRxAck - 1)) % ci.windowSize;
+    uint16_t ackCount = 0;
+    while (idx != ackIdx) {
+        uint32_t m = letoh32(controlPacket->payload[3 + (idx / 32)]);
+        if (m & (0x01 << (idx % 32))) {
+            ++ackCount;
+        } else if ((ackCount >= DUP_ACK_THRESHOLD) && ci.txPackets[idx] && (ci.txPackets[idx]->sendAttempts > 0) && !ci.txPackets[idx]->fastRetransmit) {
+            ci.txPackets[idx]->fastRetransmit = true;
+            ci.txPackets[idx]->sendTs = 0;
+            ++lostPackets;
+            //printf("tx(%d): fast retrans s=0x%x\n", (GetTimestamp() / 100) % 100000, ci.txPackets[idx]->seqNum);
+        }
+        idx = (idx == 0) ? (ci.windowSize - 1) : (idx - 1);
+    }
+}
+
+void PacketEngine::RxPacketThread::HandleAckRanges(ChannelInfo& ci, Packet* controlPacket, uint16_t remoteRxAck, uint16_t& ackedPackets, uint16_t& lostPackets)
+{
+    /* Validate the ranges. They must be ascending, non-empty and inside the tx window */
+    uint32_t numRanges = (controlPacket->payloadLen >= (4 * sizeof(uint32_t))) ? letoh32(controlPacket->payload[3]) : 0;
+    if ((numRanges > MAX_SACK_RANGES) || ((4 + numRanges) * sizeof(uint32_t) > controlPacket->payloadLen)) {
+        QCC_DbgPrintf(("Ignoring malformed SACK ranges from %s", engine->ToString(ci.packetStream, ci.dest).c_str()));
+        return;
+    }
+    uint16_t starts[MAX_SACK_RANGES];
+    uint16_t ends[MAX_SACK_RANGES];
+    uint16_t prev = remoteRxAck;
+    for (uint32_t i = 0; i < numRanges; ++i) {
+        uint32_t r = letoh32(controlPacket->payload[4 + i]);
+        starts[i] = static_cast<uint16_t>(r & 0xFFFF);
+        ends[i] = static_cast<uint16_t>(r >> 16);
+        if (!IN_WINDOW(uint16_t, prev, ci.windowSize, starts[i]) || (starts[i] == ends[i]) ||
+            !IN_WINDOW(uint16_t, starts[i], ci.windowSize, static_cast<uint16_t>(ends[i] - 1)) ||
+            !IN_WINDOW(uint16_t, ci.txDrain, ci.windowSize, static_cast<uint16_t>(ends[i] - 1))) {
+            numRanges = i;
+            break;
+        }
+        prev = ends[i];
+    }
+
+    /* Clear selectively acked packets */
+    for (uint32_t i = 0; i < numRanges; ++i) {
+        for (uint16_t s = starts[i]; s != ends[i]; ++s) {
+            Packet*& tp = ci.txPackets[s % ci.windowSize];
+            if (tp && (tp->seqNum == s)) {
+                engine->pool.ReturnPacket(tp);
+                tp = NULL;
+                ackedPackets++;
+            }
+        }
+    }
+
+    /*
+     * A hole is considered lost once DUP_ACK_THRESHOLD or more packets beyond it have been
+     * selectively acked. Walk the holes from the highest range down while counting acked packets.
+     */
+    uint16_t sackedAbove = 0;
+    for (uint32_t i = numRanges; i > 0; --i) {
+        sackedAbove += ends[i - 1] - starts[i - 1];
+        if (sackedAbove < DUP_ACK_THRESHOLD) {
+            continue;
+        }
+        uint16_t holeStart = (i > 1) ? ends[i - 2] : remoteRxAck;
+        for (uint16_t s = holeStart; s != starts[i - 1]; ++s) {
+            Packet* tp = ci.txPackets[s % ci.windowSize];
+            if (tp && (tp->seqNum == s) && (tp->sendAttempts > 0) && !tp->fastRetransmit) {
+                tp->fastRetransmit = true;
+                tp->sendTs = 0;
+                ++lostPackets;
+                //printf("tx(%d): fast retrans s=0x%x\n", (GetTimestamp() / 100) % 100000, s);
+            }
+        }
+    }
+}
+
 void PacketEngine::RxPacketThread::AdvanceTxDrain(ChannelInfo& ci, uint16_t newTxDrain, uint16_t& advCount)
 {
     /* Advance txDrain to newTxDrain */
@@ -1447,7 +1888,7 @@ void PacketEngine::RxPacketThread::HandleXOn(Packet* controlPacket)
             sendXonAck = true;
         }
         ci->txLock.Unlock();
-        engine->txPacketThread.Alert();
+        engine->ScheduleTx(*ci);
 
         /* Send XON_ACK */
         if (sendXonAck) {
@@ -1470,7 +1911,7 @@ void PacketEngine::RxPacketThread::HandleXOnAck(Packet* controlPacket)
         ci->rxLock.Lock();
         XOnAlarmContext* cctx = static_cast<XOnAlarmContext*>(ci->xOnAlarm->GetContext());
         if (cctx) {
-            engine->timer.RemoveAlarm(ci->xOnAlarm);
+            ci->worker.timer.RemoveAlarm(ci->xOnAlarm);
             ci->xOnAlarm = Alarm();
             delete cctx;
         }
@@ -1479,22 +1920,203 @@ void PacketEngine::RxPacketThread::HandleXOnAck(Packet* controlPacket)
     }
 }
 
-PacketEngine::TxPacketThread::TxPacketThread(const qcc::String& engineName) : Thread(engineName + "-tx"), engine(NULL)
+PacketEngine::TxPacketThread::TxPacketThread(const qcc::String& threadName, Worker& worker) :
+    Thread(threadName),
+    engine(NULL),
+    worker(worker),
+    batchStream(NULL),
+    batchCount(0)
 {
 }
 
+void PacketEngine::TxPacketThread::QueuePacket(ChannelInfo& ci, Packet& p)
+{
+    /* A batch is pushed to a single PacketStream */
+    if ((batchCount == PACKET_IO_BATCH) || (batchStream && (batchStream != &ci.packetStream))) {
+        FlushBatch();
+    }
+
+    /* Keep ci alive until the batch is released. Packets for a channel are queued consecutively */
+    if (batchChannels.empty() || (batchChannels.back() != &ci)) {
+        ChannelInfo* ref = engine->AcquireChannelInfo(ci.id);
+        if (ref) {
+            batchChannels.push_back(ref);
+        }
+    }
+
+    /*
+     * The packet is pushed straight from the channel's tx queue. Only this thread marshals data
+     * packets but the rx thread may return p to the pool (ack) as soon as ci.txLock is released
+     * so the batch holds its own reference until the batch has been pushed.
+     */
+    engine->pool.AddRef(&p);
+    batchPackets[batchCount] = &p;
+    batchBufs[batchCount].buf = p.buffer;
+    batchBufs[batchCount].len = p.GetWireSize();
+    batchBufs[batchCount].dest = ci.dest;
+    batchOwners[batchCount] = &ci;
+    batchStream = &ci.packetStream;
+    ++batchCount;
+}
+
+void PacketEngine::TxPacketThread::FlushBatch()
+{
+    size_t pushed = 0;
+    while (pushed < batchCount) {
+        size_t numPushed = 0;
+        QStatus status = batchStream->PushPacketBatch(batchBufs + pushed, batchCount - pushed, numPushed);
+        pushed += numPushed;
+        if ((status != ER_OK) && (pushed < batchCount)) {
+            /* Skip the packet that could not be pushed. Its channel is closed when the batch is released */
+            QCC_LogError(status, ("TxPacketThread: PushPacketBatch(%s) failed. Closing channel", engine->ToString(*batchStream, batchBufs[pushed].dest).c_str()));
+            failedChannels.push_back(batchOwners[pushed]);
+            ++pushed;
+        }
+    }
+    for (size_t i = 0; i < batchCount; ++i) {
+        engine->pool.ReturnPacket(batchPackets[i]);
+    }
+    batchCount = 0;
+    batchStream = NULL;
+}
+
+void PacketEngine::TxPacketThread::ReleaseBatch()
+{
+    FlushBatch();
+
+    /* Close channels that failed to send */
+    vector<ChannelInfo*>::iterator it = failedChannels.begin();
+    while (it != failedChannels.end()) {
+        (*it)->txLock.Lock();
+        (*it)->state = ChannelInfo::CLOSED;
+        (*it)->txLock.Unlock();
+        ++it;
+    }
+    failedChannels.clear();
+
+    /* Drop the references taken by QueuePacket */
+    it = batchChannels.begin();
+    while (it != batchChannels.end()) {
+        engine->ReleaseChannelInfo(**it);
+        ++it;
+    }
+    batchChannels.clear();
+}
+
+uint32_t PacketEngine::TxPacketThread::SendChannel(ChannelInfo& ci)
+{
+    uint32_t waitMs = Event::WAIT_FOREVER;
+    ci.txLock.Lock();
+    /* Send all control messages */
+    while (!ci.txControlQueue.empty()) {
+        Packet* p = ci.txControlQueue.front();
+        ci.txControlQueue.pop_front();
+        p->Marshal();
+        QueuePacket(ci, *p);
+        /* Closedown if control message was a disconnectRsp */
+        if (letoh32(p->payload[0]) == PACKET_COMMAND_DISCONNECT_RSP) {
+            QCC_DbgPrintf(("PacketEngine::TxThread: Send DisconnectRsp. Closing id=0x%x", ci.id));
+            ci.state = ChannelInfo::CLOSED;
+            engine->pool.ReturnPacket(p);
+            break;
+        }
+        engine->pool.ReturnPacket(p);
+    }
+    /* Walk from [txDrain, min(txFill,congestion_window,remoteRxDrain+window)) and (re)send any user packets */
+    if (ci.state == ChannelInfo::OPEN) {
+        uint16_t nonExpiredPackets = 0;
+        uint16_t drain = ci.txDrain;
+        uint16_t congestionWindow = ci.txCongestion->GetWindow();
+        while ((drain != ci.txFill) && IN_WINDOW(uint16_t, ci.remoteRxDrain, ci.windowSize - 1, drain) && (nonExpiredPackets < congestionWindow)) {
+            Packet*& p = ci.txPackets[drain % ci.windowSize];
+            if (p) {
+                uint64_t now = GetTimestamp64();
+                /*
+                 * Send the packet if it:
+                 *  a) hasn't expired
+                 *  b) has already been sent at least once
+                 *     or
+                 *  c) packet has expired but is needed to trigger XOFF
+                 */
+                uint16_t xOffSeqNum = ci.remoteRxDrain + ci.windowSize - 2;
+                if (((p->expireTs > now) || (p->sendAttempts >= 1) || (p->seqNum == xOffSeqNum) || (drain == (ci.txFill - 1))) && (p->sendAttempts <= MAX_PACKET_SEND_ATTEMPTS)) {
+                    ++nonExpiredPackets;
+                    uint32_t retryMs = engine->GetRetryMs(ci, p->sendAttempts);
+                    bool needMarshal = false;
+                    if ((p->sendTs == 0) || ((now - p->sendTs) > retryMs)) {
+                        /* sendTs is only zero here for first sends and fast retransmits */
+                        bool timedOut = (p->sendTs != 0);
+                        ++p->sendAttempts;
+                        /* Set the header fields that are fixed by the first send attempt */
+                        if (p->sendAttempts == 1) {
+                            if (!ci.txCongestion->InSlowStart()) {
+                                p->flags |= PACKET_FLAG_DELAY_ACK;
+                            }
+                            uint16_t gap = p->seqNum - ci.txLastMarshalSeqNum - 1;
+                            if (gap > (ci.windowSize - 2)) {
+                                gap = numeric_limits<uint16_t>::max();
+                            }
+                            p->gap = gap;
+                            ci.txLastMarshalSeqNum = p->seqNum;
+                            needMarshal = true;
+                        }
+                        /* Indicate flow off if we have reached the receiver's drain limit */
+                        if ((p->seqNum == xOffSeqNum) && ((p->flags & PACKET_FLAG_FLOW_OFF) == 0)) {
+                            p->flags |= PACKET_FLAG_FLOW_OFF;
+                            needMarshal = true;
+                        } else if ((p->seqNum != xOffSeqNum) && (p->flags & PACKET_FLAG_FLOW_OFF)) {
+                            p->flags &= ~PACKET_FLAG_FLOW_OFF;
+                            needMarshal = true;
+                        }
+                        if (needMarshal) {
+                            p->Marshal();
+                        }
+                        QueuePacket(ci, *p);
+                        //printf("tx(%d): s=0x%x, len=%d, gap=%d, retry=%d txFill=0x%x, txDrain=0x%x, drain=0x%x, retryMs=%d, actMs=%d, xoff=%s\n", (GetTimestamp() / 100) % 100000, p->seqNum, (int) p->payloadLen, p->gap, p->sendAttempts, ci.txFill, ci.txDrain, drain, retryMs, (int) (now - p->sendTs), (p->flags & PACKET_FLAG_FLOW_OFF) ? "off" : "nc");
+                        QCC_DbgPrintf(("TxPacketThread queued seqNum=0x%x to %s (try=%d, gap=%d, drain=0x%x)", p->seqNum, engine->ToString(ci.packetStream, ci.dest).c_str(), p->sendAttempts, p->gap, drain));
+
+                        /* Update sendTs and update (next) wait time */
+                        p->sendTs = GetTimestamp64();
+                        waitMs = ::min(waitMs, engine->GetRetryMs(ci, p->sendAttempts));
+                        /* Reduce congestion window (once per loss event) if this was a retry timeout */
+                        if (timedOut && !ci.txInRecovery) {
+                            ci.txCongestion->OnTimeout(now);
+                            ci.txInRecovery = true;
+                            ci.txRecoverySeqNum = ci.txFill;
+                            congestionWindow = ci.txCongestion->GetWindow();
+                            QCC_DbgPrintf(("Decreasing congestion window of %s to %d (timeout)", engine->ToString(ci.packetStream, ci.dest).c_str(), congestionWindow));
+                        }
+                    } else {
+                        /* Calcualte next retry time */
+                        waitMs = ::min(waitMs, retryMs);
+                    }
+                } else {
+                    /* packet has expired or retries are exhausted */
+                    //printf("tx(%d): expire pkt s=0x%x (r=%d)\n", (GetTimestamp() / 100) % 100000, p->seqNum, p->sendAttempts);
+                    QCC_DbgPrintf(("TxPacketThread: Expiring tx packet seqNum=0x%x to %s (sendAttempts=%d)", p->seqNum, engine->ToString(ci.packetStream, ci.dest).c_str(), p->sendAttempts));
+                    engine->pool.ReturnPacket(p);
+                    p = NULL;
+                }
+            }
+            ++drain;
+        }
+        //printf("tx(%d): while exited d=0x%x, tD=0x%x, tF=0x%x, rrD=0x%x, nep=%d, cw=%d\n", (GetTimestamp() / 100) % 100000, drain, ci.txDrain, ci.txFill, ci.remoteRxDrain, nonExpiredPackets, congestionWindow);
+    }
+    ci.txLock.Unlock();
+    return waitMs;
+}
+
 qcc::ThreadReturn STDCALL PacketEngine::TxPacketThread::Run(void* arg)
 {
     uint32_t waitMs = Event::WAIT_FOREVER;
     engine = reinterpret_cast<PacketEngine*>(arg);
+    deque<uint32_t> ready;
     while (!IsStopping()) {
         QStatus status = ER_OK;
         if (waitMs > 0) {
             /* Wait for waitTs - now  milliseconds */
             Event evt(waitMs);
-            //printf("tx(%d): wait(%d)\n", (GetTimestamp() / 100) % 100000, waitMs);
             status = Event::Wait(evt);
-            //printf("tx(%d): wake %s\n", (GetTimestamp() / 100) % 100000, QCC_StatusText(status));
             if (status == ER_ALERTED_THREAD) {
                 GetStopEvent().ResetEvent();
                 status = ER_OK;
@@ -1502,109 +2124,75 @@ qcc::ThreadReturn STDCALL PacketEngine::TxPacketThread::Run(void* arg)
         }
         waitMs = Event::WAIT_FOREVER;
         if (!IsStopping() && (status == ER_OK)) {
-            /* Iterate over tx queue and send, resend or expire */
-            ChannelInfo* ci = NULL;
-            while ((ci = engine->AcquireNextChannelInfo(ci)) != NULL) {
-                ci->txLock.Lock();
-                /* Send all control messages */
-                while (!ci->txControlQueue.empty()) {
-                    Packet* p = ci->txControlQueue.front();
-                    ci->txControlQueue.pop_front();
-                    p->Marshal();
-                    status = ci->packetStream.PushPacketBytes(p->buffer, p->payloadLen + Packet::payloadOffset, ci->dest);
-                    /* Closedown if control message was a disconnectRsp */
-                    if (letoh32(p->payload[0]) == PACKET_COMMAND_DISCONNECT_RSP) {
-                        QCC_DbgPrintf(("PacketEngine::TxThread: Send DisconnectRsp. Closing id=0x%x", ci->id));
-                        ci->state = ChannelInfo::CLOSED;
-                        engine->pool.ReturnPacket(p);
-                        break;
+            /* Channels that have been scheduled since the last pass */
+            worker.txReadyLock.Lock();
+            ready.swap(worker.txReady);
+            worker.txReadyLock.Unlock();
+            while (!ready.empty()) {
+                ChannelInfo* ci = engine->AcquireChannelInfo(ready.front());
+                ready.pop_front();
+                if (ci) {
+                    worker.txReadyLock.Lock();
+                    ci->txScheduled = false;
+                    worker.txReadyLock.Unlock();
+                    if (ci->txRetryArmed) {
+                        retrySchedule.erase(ci->txRetryIt);
+                        ci->txRetryArmed = false;
                     }
-                    engine->pool.ReturnPacket(p);
+                    dueChannels.push_back(ci);
                 }
-                /* Walk from [txDrain, min(txFill,congestion_window,remoteRxDrain+window)) and (re)send any user packets */
-                if (ci && ci->state == ChannelInfo::OPEN) {
-                    uint16_t nonExpiredPackets = 0;
-                    uint16_t drain = ci->txDrain;
-                    while ((drain != ci->txFill) && IN_WINDOW(uint16_t, ci->remoteRxDrain, ci->windowSize - 1, drain) && (nonExpiredPackets < ci->txCongestionWindow)) {
-                        Packet*& p = ci->txPackets[drain % ci->windowSize];
-                        if (p) {
-                            uint64_t now = GetTimestamp64();
-                            /*
-                             * Send the packet if it:
-                             *  a) hasn't expired
-                             *  b) has already been sent at least once
-                             *     or
-                             *  c) packet has expired but is needed to trigger XOFF
-                             */
-                            uint16_t xOffSeqNum = ci->remoteRxDrain + ci->windowSize - 2;
-                            if (((p->expireTs > now) || (p->sendAttempts >= 1) || (p->seqNum == xOffSeqNum) || (drain == (ci->txFill - 1))) && (p->sendAttempts <= MAX_PACKET_SEND_ATTEMPTS)) {
-                                ++nonExpiredPackets;
-                                uint32_t retryMs = engine->GetRetryMs(*ci, p->sendAttempts);
-                                bool needMarshal = false;
-                                if ((p->sendTs == 0) || ((now - p->sendTs) > retryMs)) {
-                                    ++p->sendAttempts;
-                                    /* Marshal if this is the first send attempt */
-                                    if (p->sendAttempts == 1) {
-                                        if (ci->txCongestionWindow > ci->txSlowStartThresh) {
-                                            p->flags |= PACKET_FLAG_DELAY_ACK;
-                                        }
-                                        uint16_t gap = p->seqNum - ci->txLastMarshalSeqNum - 1;
-                                        if (gap > (ci->windowSize - 2)) {
-                                            gap = numeric_limits<uint16_t>::max();
-                                        }
-                                        p->gap = gap;
-                                        p->Marshal();
-                                        ci->txLastMarshalSeqNum = p->seqNum;
-                                        needMarshal = true;
-                                    }
-                                    /* Indicate flow off if we have reached the receiver's drain limit */
-                                    if ((p->seqNum == xOffSeqNum) && ((p->flags & PACKET_FLAG_FLOW_OFF) == 0)) {
-                                        p->flags |= PACKET_FLAG_FLOW_OFF;
-                                        needMarshal = true;
-                                    } else if ((p->seqNum != xOffSeqNum) && (p->flags & PACKET_FLAG_FLOW_OFF)) {
-                                        p->flags &= ~PACKET_FLAG_FLOW_OFF;
-                                        needMarshal = true;
-                                    }
-                                    if (needMarshal) {
-                                        p->Marshal();
-                                    }
-                                    status = ci->packetStream.PushPacketBytes(p->buffer, p->payloadLen + Packet::payloadOffset, ci->dest);
-                                    //printf("tx(%d): s=0x%x, len=%d, gap=%d, retry=%d txFill=0x%x, txDrain=0x%x, drain=0x%x, retryMs=%d, actMs=%d, xoff=%s\n", (GetTimestamp() / 100) % 100000, p->seqNum, (int) p->payloadLen, p->gap, p->sendAttempts, ci->txFill, ci->txDrain, drain, retryMs, (int) (now - p->sendTs), (p->flags & PACKET_FLAG_FLOW_OFF) ? "off" : "nc");
-                                    QCC_DbgPrintf(("TxPacketThread sent seqNum=0x%x to %s (try=%d, gap=%d, drain=0x%x) %s", p->seqNum, engine->ToString(ci->packetStream, ci->dest).c_str(), p->sendAttempts, p->gap, drain, QCC_StatusText(status)));
-                                    if (status == ER_OK) {
-                                        /* Update sendTs and update (next) wait time */
-                                        p->sendTs = GetTimestamp64();
-                                        waitMs = ::min(waitMs, engine->GetRetryMs(*ci, p->sendAttempts));
-                                    } else {
-                                        /* Return packet and close this channel */
-                                        QCC_LogError(status, ("TxPacketThread: PushPacketBytes(%s) failed. Closing channel", engine->ToString(ci->packetStream, ci->dest).c_str()));
-                                        ci->state = ChannelInfo::CLOSED;
-                                        status = ER_OK;
-                                        break;
-                                    }
-                                    /* Adjust congestion window down (by factor of 2) if this was a retry */
-                                    if ((p->sendAttempts > 1) && (ci->txCongestionWindow > 1)) {
-                                        ci->txCongestionWindow = ci->txCongestionWindow >> 1;
-                                        ci->txSlowStartThresh = ::max(ci->txCongestionWindow, (uint16_t)2);
-                                        QCC_DbgPrintf(("Decreasing congestion window of %s to %d (ssThresh=%d)", engine->ToString(ci->packetStream, ci->dest).c_str(), ci->txCongestionWindow, ci->txSlowStartThresh));
-                                    }
-                                } else {
-                                    /* Calcualte next retry time */
-                                    waitMs = ::min(waitMs, retryMs);
-                                }
-                            } else {
-                                /* packet has expired or retries are exhausted */
-                                //printf("tx(%d): expire pkt s=0x%x (r=%d)\n", (GetTimestamp() / 100) % 100000, p->seqNum, p->sendAttempts);
-                                QCC_DbgPrintf(("TxPacketThread: Expiring tx packet seqNum=0x%x to %s (sendAttempts=%d)", p->seqNum, engine->ToString(ci->packetStream, ci->dest).c_str(), p->sendAttempts));
-                                engine->pool.ReturnPacket(p);
-                                p = NULL;
-                            }
-                        }
-                        ++drain;
+            }
+
+            /* Channels whose retry time has been reached */
+            uint64_t now = GetTimestamp64();
+            while (!retrySchedule.empty() && (retrySchedule.begin()->first <= now)) {
+                RetrySchedule::iterator rit = retrySchedule.begin();
+                ChannelInfo* ci = engine->AcquireChannelInfo(rit->second);
+                if (ci) {
+                    /* The entry may belong to an earlier channel that used the same id */
+                    if (ci->txRetryArmed && (ci->txRetryIt == rit)) {
+                        ci->txRetryArmed = false;
                     }
-                    //printf("tx(%d): while exited d=0x%x, tD=0x%x, tF=0x%x, rrD=0x%x, nep=%d, cw=%d\n", (GetTimestamp() / 100) % 100000, drain, ci->txDrain, ci->txFill, ci->remoteRxDrain, nonExpiredPackets, ci->txCongestionWindow);
+                    dueChannels.push_back(ci);
                 }
-                ci->txLock.Unlock();
+                retrySchedule.erase(rit);
+            }
+
+            /* Send, resend or expire and arm the next retry of each channel */
+            vector<ChannelInfo*>::iterator it = dueChannels.begin();
+            while (it != dueChannels.end()) {
+                ChannelInfo& ci = **it;
+                uint32_t retryMs = SendChannel(ci);
+                if (ci.txRetryArmed) {
+                    retrySchedule.erase(ci.txRetryIt);
+                    ci.txRetryArmed = false;
+                }
+                if (retryMs != Event::WAIT_FOREVER) {
+                    ci.txRetryIt = retrySchedule.insert(pair<uint64_t, uint32_t>(GetTimestamp64() + retryMs, ci.id));
+                    ci.txRetryArmed = true;
+                }
+                ++it;
+            }
+
+            /* Push everything queued on this pass */
+            ReleaseBatch();
+            it = dueChannels.begin();
+            while (it != dueChannels.end()) {
+                engine->ReleaseChannelInfo(**it);
+                ++it;
+            }
+            dueChannels.clear();
+
+            /* Go around again immediately if more work was scheduled during the pass */
+            worker.txReadyLock.Lock();
+            bool isReady = !worker.txReady.empty();
+            worker.txReadyLock.Unlock();
+            if (isReady) {
+                waitMs = 0;
+            } else if (!retrySchedule.empty()) {
+                now = GetTimestamp64();
+                uint64_t nextTs = retrySchedule.begin()->first;
+                waitMs = (nextTs > now) ? static_cast<uint32_t>(nextTs - now) : 0;
             }
         }
         if ((status != ER_OK) && (status != ER_STOPPING_THREAD)) {
@@ -1618,13 +2206,13 @@ PacketStream* PacketEngine::GetPacketStream(const PacketEngineStream& stream)
 {
     PacketStream* ret = NULL;
     channelInfoLock.Lock();
-    map<uint32_t, ChannelInfo>::iterator it = channelInfos.begin();
-    while (it != channelInfos.end()) {
-        if (&(it->second.stream) == &stream) {
-            ret = &(it->second.packetStream);
+    ChannelTable* table = channelTable;
+    for (uint32_t i = 0; i <= table->mask; ++i) {
+        ChannelInfo* ci = table->slots[i];
+        if (ci && (ci != TOMBSTONE) && (&(ci->stream) == &stream)) {
+            ret = &(ci->packetStream);
             break;
         }
-        ++it;
     }
     channelInfoLock.Unlock();
     return ret;
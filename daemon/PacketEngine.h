@@ -24,6 +24,7 @@
 #include <qcc/platform.h>
 #include <map>
 #include <deque>
+#include <vector>
 
 #include <qcc/Stream.h>
 #include <qcc/SocketStream.h>
@@ -35,6 +36,8 @@
 #include "PacketStream.h"
 #include "PacketPool.h"
 #include "PacketEngineStream.h"
+#include "CongestionControl.h"
+#include "EpochGuard.h"
 
 /**
  * Inside window calculation.
@@ -46,7 +49,9 @@
 
 
 /* Constants */
-#define PACKET_ENGINE_VERSION     1          /**<  PacketEngine compatibility level */
+#define PACKET_ENGINE_VERSION     3          /**<  PacketEngine compatibility level */
+#define PACKET_ENGINE_SACK_VERSION 2         /**<  First compatibility level that uses SACK ranges in acks */
+#define PACKET_ENGINE_CRC32C_VERSION 3       /**<  First compatibility level that uses PACKET_FORMAT_CRC32C packets */
 #define CONNECT_RETRIES           6          /**<  Number of ConnectReq and/or ConnectRsp retries */
 #define DISCONNECT_RETRIES        4          /**<  Number of DisconectReq retries */
 #define CONNECT_RETRY_TIMEOUT     500        /**<  MS to wait befroe retrying ConnectReq and ConnectRsp */
@@ -57,6 +62,9 @@
 #define ACK_DELAY_MS              10         /**<  Ms of delay before sending acks */
 #define XON_THRESHOLD             4          /**<  Min number of empty slots in rx buffer necessary to send XON */
 #define CLOSING_TIMEOUT           4000       /**< Max num of ms to wait for channel to stay in CLOSING state before being forced to CLOSED */
+#define DUP_ACK_THRESHOLD         3          /**< Num of packets acked beyond a hole (or duplicate acks) before the hole is fast retransmitted */
+#define MAX_SACK_RANGES           8          /**< Max num of SACK ranges in an ack */
+#define PACKET_IO_BATCH           32         /**< Max num of packets pulled from or pushed to a PacketStream in one batch */
 
 namespace ajn {
 
@@ -88,6 +96,11 @@ class PacketEngine : public qcc::AlarmListener {
     friend class PacketEngineStream;
 
   private:
+    struct Worker;
+
+    /** Retry times of channels with unacked packets, ordered by time. Owned by a worker's tx thread */
+    typedef std::multimap<uint64_t, uint32_t> RetrySchedule;
+
     struct ChannelInfo {
 
         enum State {
@@ -102,19 +115,11 @@ class PacketEngine : public qcc::AlarmListener {
         ChannelInfo(PacketEngine& engine, uint32_t id, const PacketDest& dest, PacketStream& packetStream,
                     PacketEngineListener& listener, uint16_t windowSize);
 
-        /**
-         * Copy constructor.
-         * Creates a "detached" copy with new events.
-         * This constructor should ONLY be used to copy ChannelInfos that are in their
-         * initialized state since internal state such as events and stream are not
-         * transferred to the new ChannelInfo.
-         */
-        ChannelInfo(const ChannelInfo& other);
-
         /* Destructor */
         ~ChannelInfo();
 
         PacketEngine& engine;
+        Worker& worker;
         uint32_t id;
         State state;
         PacketDest dest;
@@ -123,7 +128,8 @@ class PacketEngine : public qcc::AlarmListener {
         PacketEngineStream stream;
         PacketStream& packetStream;
         PacketEngineListener& listener;
-        int useCount;
+        volatile int32_t useCount;      /**< References including one held by the channel table until the channel is unlinked */
+        bool isUnlinked;                /**< true once the channel has been removed from the channel table */
         qcc::Alarm connectReqAlarm;
         qcc::Alarm connectRspAlarm;
         qcc::Alarm disconnectReqAlarm;
@@ -152,31 +158,75 @@ class PacketEngine : public qcc::AlarmListener {
         int32_t txRttMeanVar;
         bool txRttInit;
         uint32_t* ackResp;
-        uint16_t txCongestionWindow;
-        uint16_t txSlowStartThresh;
-        uint16_t txConsecutiveAcks;
+        CongestionControl* txCongestion;
+        uint16_t txDupAcks;
+        uint16_t txLastRemoteRxAck;
+        bool txInRecovery;
+        uint16_t txRecoverySeqNum;
         uint16_t txLastMarshalSeqNum;
         qcc::Mutex txLock;
+        bool txScheduled;               /**< Channel is on its worker's txReady list (protected by txReadyLock) */
+        bool txRetryArmed;              /**< txRetryIt is valid (only used by the worker's tx thread) */
+        RetrySchedule::iterator txRetryIt;
 
         uint32_t protocolVersion;
+        uint8_t packetFormat;           /**< Wire format of packets sent on this channel (set from protocolVersion) */
         uint16_t windowSize;
         bool wasOpen;
 
       private:
+        /** Private copy constructor */
+        ChannelInfo(const ChannelInfo& other);
+
         /** Private assignment operator */
         ChannelInfo& operator=(const ChannelInfo& other);
     };
 
+    /** A packet pulled by one worker that belongs to a channel owned by another worker */
+    struct RxHandoff {
+        Packet* packet;
+        PacketStream* stream;
+        PacketEngineListener* listener;
+    };
+
+    /** A PacketStream and the worker whose rx thread pulls from it */
+    struct StreamInfo {
+        PacketStream* stream;
+        PacketEngineListener* listener;
+        uint32_t rxWorker;
+    };
+
+    /**
+     * Open addressed channel table. Lookups are lock-free. Updates are made with channelInfoLock
+     * held and a replaced table or removed channel is retired and only freed once the lookups that
+     * may still see it are done.
+     */
+    struct ChannelTable {
+        uint32_t mask;            /**< Number of slots - 1 */
+        uint32_t used;            /**< Slots holding a channel or a tombstone */
+        ChannelInfo* volatile* slots;
+    };
+
+    /** A table or channel waiting for the lookups that may still see it */
+    struct Retired {
+        EpochGuard::Ticket ticket;
+        ChannelTable* table;
+        ChannelInfo* channel;
+    };
+
     class RxPacketThread : public qcc::Thread {
       public:
-        RxPacketThread(const qcc::String& engineName);
+        RxPacketThread(const qcc::String& threadName, Worker& worker);
 
       protected:
         qcc::ThreadReturn STDCALL Run(void* arg);
 
       private:
         PacketEngine* engine;
+        Worker& worker;
 
+        void DispatchPacket(Packet* p, PacketStream& packetStream, PacketEngineListener& listener);
+        void HandleHandoffs();
         void HandleControlPacket(Packet* p, PacketStream& packetStream, PacketEngineListener& listener);
         void HandleDataPacket(Packet* p);
 
@@ -191,24 +241,77 @@ class PacketEngine : public qcc::AlarmListener {
         void HandleXOnAck(Packet* p);
 
         void AdvanceTxDrain(ChannelInfo& ci, uint16_t newTxDrain, uint16_t& advanceCount);
+
+        void HandleAckMask(ChannelInfo& ci, Packet* controlPacket, uint16_t remoteRxAck, uint16_t& ackedPackets, uint16_t& lostPackets);
+        void HandleAckRanges(ChannelInfo& ci, Packet* controlPacket, uint16_t remoteRxAck, uint16_t& ackedPackets, uint16_t& lostPackets);
     };
 
     class TxPacketThread : public qcc::Thread {
       public:
-        TxPacketThread(const qcc::String& engineName);
+        TxPacketThread(const qcc::String& threadName, Worker& worker);
 
       protected:
         qcc::ThreadReturn STDCALL Run(void* arg);
 
       private:
         PacketEngine* engine;
+        Worker& worker;
+        RetrySchedule retrySchedule;                /**< Channels waiting for a retry timeout */
+        std::vector<ChannelInfo*> dueChannels;      /**< Channels to service on the current pass */
+        PacketStream* batchStream;                  /**< PacketStream that the batched packets will be pushed to */
+        size_t batchCount;                          /**< Number of packets in the batch */
+        Packet* batchPackets[PACKET_IO_BATCH];      /**< Batched packets. The batch holds a pool reference on each */
+        ChannelInfo* batchOwners[PACKET_IO_BATCH];  /**< Channel of each batched packet */
+        PacketBuffer batchBufs[PACKET_IO_BATCH];    /**< Batched packets in the form expected by PushPacketBatch */
+        std::vector<ChannelInfo*> batchChannels;    /**< Channels referenced by the batch until ReleaseBatch */
+        std::vector<ChannelInfo*> failedChannels;   /**< Channels whose packets could not be pushed */
+
+        void QueuePacket(ChannelInfo& ci, Packet& p);
+        void FlushBatch();
+        void ReleaseBatch();
+        uint32_t SendChannel(ChannelInfo& ci);
+    };
+
+    /**
+     * A shard of the engine. A channel is owned by the worker selected by its channel id. The
+     * owner's rx thread handles every packet for the channel, its tx thread is the only thread
+     * that sends the channel's packets and its timer runs the channel's alarms.
+     */
+    struct Worker {
+        Worker(const qcc::String& engineName, uint32_t index);
+
+        uint32_t index;
+        RxPacketThread rxPacketThread;
+        TxPacketThread txPacketThread;
+        qcc::Timer timer;
+        volatile bool rxReload;                /**< Set by rxPacketThread each time it reloads packetStreams */
+        qcc::Mutex handoffLock;
+        std::deque<RxHandoff> handoffQueue;    /**< Packets pulled by other workers for channels owned by this one */
+        qcc::Event handoffEvent;
+        qcc::Mutex txReadyLock;
+        std::deque<uint32_t> txReady;          /**< Channels that have something new to send */
+
+      private:
+        /* Private copy constructor */
+        Worker(const Worker&);
+
+        /* Private assignment operator */
+        Worker& operator=(const Worker&);
     };
 
     void CloseChannel(ChannelInfo& ci);
 
   public:
 
-    PacketEngine(const qcc::String& name, uint32_t maxWindowSize = 128);
+    /**
+     * Constructor
+     *
+     * @param name           Engine name used to name its threads.
+     * @param maxWindowSize  Largest window (power of 2) offered or accepted for a channel.
+     * @param numWorkers     Number of workers that channels are sharded across. Each worker has
+     *                       its own rx thread, tx thread and timer.
+     */
+    PacketEngine(const qcc::String& name, uint32_t maxWindowSize = 128, uint32_t numWorkers = 1);
 
     virtual ~PacketEngine();
 
@@ -226,6 +329,13 @@ class PacketEngine : public qcc::AlarmListener {
 
     PacketStream* GetPacketStream(const PacketEngineStream& stream);
 
+    /**
+     * Set the congestion control algorithm used by channels created after this call.
+     *
+     * @param type   Congestion control algorithm.
+     */
+    void SetCongestionControl(CongestionControl::Type type) { ccType = type; }
+
     /**
      * Request graceful disconnect of stream.
      * Note taht stream is not actually disconnected until PacketEngineDisconnectCB is called.
@@ -246,24 +356,32 @@ class PacketEngine : public qcc::AlarmListener {
 
     qcc::String name;
     PacketPool pool;
-    RxPacketThread rxPacketThread;
-    TxPacketThread txPacketThread;
-    std::map<qcc::Event*, std::pair<PacketStream*, PacketEngineListener*> > packetStreams;
-    qcc::Timer timer;
+    std::vector<Worker*> workers;
+    std::map<qcc::Event*, StreamInfo> packetStreams;
     qcc::Mutex channelInfoLock;
-    std::map<uint32_t, ChannelInfo> channelInfos;
+    ChannelTable* volatile channelTable;
+    EpochGuard lookupGuard;                /**< Tracks the lock-free lookups of channelTable */
+    std::vector<Retired> retired;          /**< Unpublished tables and channels. Protected by channelInfoLock */
     uint32_t maxWindowSize;
     bool isRunning;
-    bool rxPacketThreadReload;
+    CongestionControl::Type ccType;
+
+    Worker& GetWorker(uint32_t chanId) { return *workers[chanId % workers.size()]; }
 
     ChannelInfo* CreateChannelInfo(uint32_t chanId, const PacketDest& dest, PacketStream& packetStream, PacketEngineListener& listener, uint16_t windowSize);
 
     ChannelInfo* AcquireChannelInfo(uint32_t chanId);
 
-    ChannelInfo* AcquireNextChannelInfo(ChannelInfo* inCi);
-
     void ReleaseChannelInfo(ChannelInfo& ci);
 
+    void Retire(ChannelTable* table, ChannelInfo* channel);
+
+    void ReclaimRetired();
+
+    void ResizeChannelTable(uint32_t numSlots);
+
+    void ScheduleTx(ChannelInfo& ci);
+
     void SendAck(ChannelInfo& ci, uint16_t seqNum, bool allowDelay);
 
     void SendAckNow(ChannelInfo& ci, uint16_t seqNum);
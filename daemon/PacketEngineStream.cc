@@ -149,7 +149,7 @@ QStatus PacketEngineStream::PullBytes(void* buf, size_t reqBytes, size_t& actual
         if (ci->rxFlowOff && ((ci->rxDrain == ci->rxAck) || IN_WINDOW(uint16_t, ci->rxDrain, ci->windowSize - 2 - XON_THRESHOLD, ci->rxFlowSeqNum))) {
             ci->rxFlowOff = false;
             engine->SendXOn(*ci);
-            engine->txPacketThread.Alert();
+            engine->ScheduleTx(*ci);
         }
     }
 
@@ -192,7 +192,7 @@ QStatus PacketEngineStream::PullBytes(void* buf, size_t reqBytes, size_t& actual
     if (ci->rxFlowOff && ((ci->rxDrain == ci->rxAck) || IN_WINDOW(uint16_t, ci->rxDrain, ci->windowSize - 2 - XON_THRESHOLD, ci->rxFlowSeqNum))) {
         ci->rxFlowOff = false;
         engine->SendXOn(*ci);
-        engine->txPacketThread.Alert();
+        engine->ScheduleTx(*ci);
     }
     ci->rxLock.Unlock();
     engine->ReleaseChannelInfo(*ci);
@@ -218,7 +218,7 @@ QStatus PacketEngineStream::PushBytes(const void* buf, size_t numBytes, size_t&
     numSent = 0;
 
     /* Check size of caller's message */
-    size_t maxPayload = ::min(ci->packetStream.GetSinkMTU(), (size_t)engine->pool.GetMTU()) - Packet::payloadOffset;
+    size_t maxPayload = ::min(ci->packetStream.GetSinkMTU(), (size_t)engine->pool.GetMTU()) - Packet::maxOverhead;
     size_t numPackets = (numBytes + maxPayload - 1) / maxPayload;
     if (numPackets >= ci->windowSize) {
         return ER_PACKET_TOO_LARGE;
@@ -264,6 +264,7 @@ QStatus PacketEngineStream::PushBytes(const void* buf, size_t numBytes, size_t&
         p->SetPayload(reinterpret_cast<const uint8_t*>(buf) + numSent, pLen);
         p->chanId = ci->id;
         p->seqNum = ci->txFill;
+        p->format = ci->packetFormat;
         p->flags = isFirst ? PACKET_FLAG_BOM : 0;
         p->flags |= (numBytes - numSent) <= maxPayload ? PACKET_FLAG_EOM : 0;
         p->expireTs = (ttl == 0) ? numeric_limits<uint64_t>::max() : now + ttl;
@@ -273,7 +274,7 @@ QStatus PacketEngineStream::PushBytes(const void* buf, size_t numBytes, size_t&
         isFirst = false;
     }
     if (status == ER_OK) {
-        engine->txPacketThread.Alert();
+        engine->ScheduleTx(*ci);
     }
     ci->txLock.Unlock();
     engine->ReleaseChannelInfo(*ci);
@@ -20,6 +20,7 @@
  ******************************************************************************/
 #include <qcc/platform.h>
 #include <qcc/Mutex.h>
+#include <qcc/atomic.h>
 
 #include "PacketPool.h"
 
@@ -68,6 +69,7 @@ Packet* PacketPool::GetPacket() {
         p = freeList.back();
         freeList.pop_back();
         lock.Unlock();
+        p->refCount = 1;
     } else {
         lock.Unlock();
         p = new Packet(mtu);
@@ -76,7 +78,32 @@ Packet* PacketPool::GetPacket() {
     return p;
 }
 
+void PacketPool::GetPackets(Packet** packets, size_t count) {
+#ifdef PACKET_LEAK_DEBUG
+    for (size_t i = 0; i < count; ++i) {
+        packets[i] = new Packet(mtu);
+    }
+#else
+    /* Take as many packets as possible from the free list under a single lock */
+    lock.Lock();
+    usedCount += count;
+    size_t i = 0;
+    while ((i < count) && (freeList.size() > 0)) {
+        packets[i] = freeList.back();
+        packets[i++]->refCount = 1;
+        freeList.pop_back();
+    }
+    lock.Unlock();
+    while (i < count) {
+        packets[i++] = new Packet(mtu);
+    }
+#endif
+}
+
 void PacketPool::ReturnPacket(Packet* p) {
+    if (DecrementAndFetch(&p->refCount) > 0) {
+        return;
+    }
 #ifdef PACKET_LEAK_DEBUG
     delete p;
 #else
@@ -93,4 +120,8 @@ void PacketPool::ReturnPacket(Packet* p) {
 #endif
 }
 
+void PacketPool::AddRef(Packet* p) {
+    IncrementAndFetch(&p->refCount);
+}
+
 }
@@ -41,8 +41,20 @@ class PacketPool {
 
     Packet* GetPacket();
 
+    void GetPackets(Packet** packets, size_t count);
+
+    /**
+     * Drop a reference to a packet. The packet goes back to the pool when the last reference
+     * is dropped.
+     */
     void ReturnPacket(Packet* p);
 
+    /**
+     * Take an additional reference to a packet so that it can be read (for instance handed to a
+     * PacketSink) after its owner has returned it. Each AddRef must be matched by a ReturnPacket.
+     */
+    void AddRef(Packet* p);
+
     uint32_t GetMTU() const { return mtu; }
 
   private:
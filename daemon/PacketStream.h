@@ -28,6 +28,15 @@
 
 namespace ajn {
 
+/**
+ * A single datagram in a batched PacketSource or PacketSink operation.
+ */
+struct PacketBuffer {
+    void* buf;        /**< Packet bytes */
+    size_t len;       /**< Size of buf on input to a pull. Number of packet bytes otherwise */
+    PacketDest dest;  /**< Sender of a pulled packet or destination of a pushed packet */
+};
+
 /**
  * PacketSource defines a standard interface for packet providers.
  */
@@ -64,6 +73,26 @@ class PacketSource {
      */
     virtual QStatus PullPacketBytes(void* buf, size_t reqBytes, size_t& actualBytes, PacketDest& sender, uint32_t timeout = qcc::Event::WAIT_FOREVER) = 0;
 
+    /**
+     * Pull up to numBufs packets from the source.
+     * Sources that can receive more than one packet per system call should override this method.
+     * The default implementation pulls a single packet.
+     *
+     * @param bufs       Packet buffers to fill. On return bufs[0..numPulled) hold the pulled packets.
+     * @param numBufs    Number of entries in bufs.
+     * @param numPulled  Number of packets pulled.
+     * @param timeout    Time to wait for the first packet, 0 to only pull packets that are already available.
+     * @return   ER_OK if at least one packet was pulled, ER_TIMEOUT or ER_WOULDBLOCK if there was none. Otherwise an error.
+     */
+    virtual QStatus PullPacketBatch(PacketBuffer* bufs, size_t numBufs, size_t& numPulled, uint32_t timeout = qcc::Event::WAIT_FOREVER)
+    {
+        size_t actualBytes = 0;
+        QStatus status = PullPacketBytes(bufs[0].buf, bufs[0].len, actualBytes, bufs[0].dest, timeout);
+        bufs[0].len = actualBytes;
+        numPulled = (status == ER_OK) ? 1 : 0;
+        return status;
+    }
+
     /**
      * Get the Event indicating that data is available when signaled.
      *
@@ -98,6 +127,29 @@ class PacketSink {
      */
     virtual QStatus PushPacketBytes(const void* buf, size_t numBytes, PacketDest& dest) = 0;
 
+    /**
+     * Push a batch of packets into the sink.
+     * Sinks that can send more than one packet per system call should override this method.
+     * The default implementation pushes the packets one at a time.
+     *
+     * @param bufs       Packets to push.
+     * @param numBufs    Number of entries in bufs.
+     * @param numPushed  Number of packets (starting from bufs[0]) that were pushed.
+     * @return   ER_OK if all packets were pushed. Otherwise the error for packet bufs[numPushed].
+     */
+    virtual QStatus PushPacketBatch(PacketBuffer* bufs, size_t numBufs, size_t& numPushed)
+    {
+        QStatus status = ER_OK;
+        numPushed = 0;
+        while ((status == ER_OK) && (numPushed < numBufs)) {
+            status = PushPacketBytes(bufs[numPushed].buf, bufs[numPushed].len, bufs[numPushed].dest);
+            if (status == ER_OK) {
+                ++numPushed;
+            }
+        }
+        return status;
+    }
+
     /**
      * Get the Event that indicates when data can be pushed to sink.
      *
@@ -0,0 +1,547 @@
+/**
+ * @file
+ * PolicyEngine decides whether messages may pass between two bus connections according to the
+ * <policy> sections of the daemon configuration.
+ */
+
+/******************************************************************************
+ * Copyright 2012, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#include <qcc/platform.h>
+
+#include <string.h>
+#include <algorithm>
+
+#include <qcc/Debug.h>
+
+#include "PolicyEngine.h"
+
+#define QCC_MODULE "ALLJOYN"
+
+using namespace std;
+using namespace qcc;
+
+namespace ajn {
+
+static bool ParseMessageType(const char* str, AllJoynMessageType& type)
+{
+    if (::strcmp(str, "method_call") == 0) {
+        type = MESSAGE_METHOD_CALL;
+    } else if (::strcmp(str, "method_return") == 0) {
+        type = MESSAGE_METHOD_RET;
+    } else if (::strcmp(str, "signal") == 0) {
+        type = MESSAGE_SIGNAL;
+    } else if (::strcmp(str, "error") == 0) {
+        type = MESSAGE_ERROR;
+    } else if (::strcmp(str, "*") == 0) {
+        type = MESSAGE_INVALID;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/*
+ * FNV-1a over the string followed by a separator so that ("ab", "c") and ("a", "bc") differ.
+ */
+static inline uint32_t HashString(uint32_t hash, const char* str)
+{
+    while (*str) {
+        hash = (hash ^ static_cast<uint8_t>(*str++)) * 16777619;
+    }
+    return (hash ^ 0xff) * 16777619;
+}
+
+/*
+ * The decision made when no rule of a direction matches a message.
+ */
+static inline bool NoMatchDecision(AllJoynMessageType type)
+{
+    return type != MESSAGE_METHOD_CALL;
+}
+
+PolicyEngine::PolicyEngine() :
+    enabled(false),
+    pathRules(false),
+    cache(new CacheEntry*[CACHE_SIZE]),
+    generation(1),
+    cacheEnabled(true),
+    cacheHits(0),
+    cacheMisses(0)
+{
+    for (size_t i = 0; i < CACHE_SIZE; ++i) {
+        cache[i] = NULL;
+    }
+}
+
+PolicyEngine::~PolicyEngine()
+{
+    /* The router is gone so nothing is looking up entries any more */
+    for (size_t i = 0; i < CACHE_SIZE; ++i) {
+        delete cache[i];
+    }
+    delete [] cache;
+    for (size_t i = 0; i < retired.size(); ++i) {
+        delete retired[i].entry;
+    }
+}
+
+void PolicyEngine::RuleSet::Add(const Rule& rule)
+{
+    uint32_t n = rules.size();
+    rules.push_back(rule);
+    index[(static_cast<uint64_t>(rule.name) << 32) | rule.member].push_back(n);
+}
+
+uint32_t PolicyEngine::AddString(const qcc::String& str)
+{
+    if (str.empty() || (str == "*")) {
+        return WILDCARD;
+    }
+    StringIdMap::const_iterator it = stringIds.find(StringMapKey(str.c_str()));
+    if (it != stringIds.end()) {
+        return it->second;
+    }
+    /* The key is constructed from a qcc::String so the map keeps its own copy */
+    uint32_t id = stringIds.size() + 1;
+    stringIds[StringMapKey(str)] = id;
+    return id;
+}
+
+uint32_t PolicyEngine::LookupString(const char* str) const
+{
+    if (!str || (str[0] == '\0')) {
+        return WILDCARD;
+    }
+    StringIdMap::const_iterator it = stringIds.find(StringMapKey(str));
+    return (it == stringIds.end()) ? ID_NOT_FOUND : it->second;
+}
+
+QStatus PolicyEngine::CompileRule(const XmlElement& elem, RuleSet& send, RuleSet& receive)
+{
+    QStatus status = ER_OK;
+    Rule rule(elem.GetName() == "allow");
+    bool isSend = false;
+    bool isReceive = false;
+    bool eavesdrop = false;
+    bool ignore = false;
+
+    const map<qcc::String, qcc::String>& attrs = elem.GetAttributes();
+    map<qcc::String, qcc::String>::const_iterator it;
+    for (it = attrs.begin(); (status == ER_OK) && (it != attrs.end()); ++it) {
+        const char* attr = it->first.c_str();
+        const qcc::String& val = it->second;
+        bool isSendAttr = (::strncmp(attr, "send_", 5) == 0);
+        bool isReceiveAttr = (::strncmp(attr, "receive_", 8) == 0);
+        if (isSendAttr || isReceiveAttr) {
+            const char* field = attr + (isSendAttr ? 5 : 8);
+            isSend |= isSendAttr;
+            isReceive |= isReceiveAttr;
+            if (::strcmp(field, "interface") == 0) {
+                rule.interface = AddString(val);
+            } else if (::strcmp(field, "member") == 0) {
+                rule.member = AddString(val);
+            } else if (::strcmp(field, "path") == 0) {
+                rule.path = AddString(val);
+                pathRules |= (rule.path != WILDCARD);
+            } else if (::strcmp(field, "error") == 0) {
+                rule.error = AddString(val);
+            } else if (::strcmp(field, "type") == 0) {
+                if (!ParseMessageType(val.c_str(), rule.type)) {
+                    status = ER_BUS_BAD_XML;
+                }
+            } else if (::strcmp(field, isSendAttr ? "destination" : "sender") == 0) {
+                rule.name = AddString(val);
+                if ((rule.name != WILDCARD) && (val[0] != ':')) {
+                    ruleNames[val] = rule.name;
+                }
+            } else if (::strcmp(field, "requested_reply") == 0) {
+                /* Replies are not checked */
+                ignore = true;
+            } else {
+                status = ER_BUS_BAD_XML;
+            }
+        } else if (::strcmp(attr, "eavesdrop") == 0) {
+            eavesdrop = (val == "true");
+        } else if ((::strcmp(attr, "own") == 0) || (::strcmp(attr, "user") == 0) || (::strcmp(attr, "group") == 0)) {
+            /* Not a message rule */
+            ignore = true;
+        } else {
+            status = ER_BUS_BAD_XML;
+        }
+    }
+    if ((status == ER_OK) && isSend && isReceive) {
+        status = ER_BUS_BAD_XML;
+    }
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Invalid attributes in <%s> policy rule", elem.GetName().c_str()));
+        return status;
+    }
+
+    /*
+     * A deny rule that sets eavesdrop only applies to eavesdroppers and the router does not
+     * support eavesdropping.
+     */
+    if (ignore || (!rule.allow && eavesdrop)) {
+        return ER_OK;
+    }
+    if (isSend || !isReceive) {
+        send.Add(rule);
+    }
+    if (isReceive || !isSend) {
+        receive.Add(rule);
+    }
+    return ER_OK;
+}
+
+QStatus PolicyEngine::Compile(const vector<const XmlElement*>& policies)
+{
+    QStatus status = ER_OK;
+
+    lock.Lock(MUTEX_CONTEXT);
+    defaultSend.Clear();
+    defaultReceive.Clear();
+    mandatorySend.Clear();
+    mandatoryReceive.Clear();
+    stringIds.clear();
+    ruleNames.clear();
+    ownedNames.clear();
+    pathRules = false;
+
+    for (size_t i = 0; (status == ER_OK) && (i < policies.size()); ++i) {
+        const XmlElement* policy = policies[i];
+        qcc::String context = policy->GetAttribute("context");
+        RuleSet* send;
+        RuleSet* receive;
+        if (context == "default") {
+            send = &defaultSend;
+            receive = &defaultReceive;
+        } else if (context == "mandatory") {
+            send = &mandatorySend;
+            receive = &mandatoryReceive;
+        } else if (context.empty() && !policy->GetAttributes().empty()) {
+            QCC_DbgPrintf(("Ignoring <policy %s=\"%s\">", policy->GetAttributes().begin()->first.c_str(), policy->GetAttributes().begin()->second.c_str()));
+            continue;
+        } else {
+            status = ER_BUS_BAD_XML;
+            QCC_LogError(status, ("Invalid policy context \"%s\"", context.c_str()));
+            break;
+        }
+
+        const vector<XmlElement*>& rules = policy->GetChildren();
+        for (size_t r = 0; (status == ER_OK) && (r < rules.size()); ++r) {
+            if ((rules[r]->GetName() == "allow") || (rules[r]->GetName() == "deny")) {
+                status = CompileRule(*rules[r], *send, *receive);
+            } else {
+                status = ER_BUS_BAD_XML;
+                QCC_LogError(status, ("Unknown policy rule <%s>", rules[r]->GetName().c_str()));
+            }
+        }
+    }
+
+    bool hasRules = !(defaultSend.rules.empty() && defaultReceive.rules.empty() && mandatorySend.rules.empty() && mandatoryReceive.rules.empty());
+    bool allowsAll = AllowsAll(mandatorySend, defaultSend) && AllowsAll(mandatoryReceive, defaultReceive);
+    if (hasRules && allowsAll) {
+        QCC_DbgPrintf(("Policy rules allow every message"));
+    }
+    enabled = hasRules && !allowsAll;
+    InvalidateCache();
+    QCC_DbgPrintf(("Compiled %u send and %u receive policy rules mentioning %u strings",
+                   static_cast<uint32_t>(defaultSend.rules.size() + mandatorySend.rules.size()),
+                   static_cast<uint32_t>(defaultReceive.rules.size() + mandatoryReceive.rules.size()),
+                   static_cast<uint32_t>(stringIds.size())));
+    lock.Unlock(MUTEX_CONTEXT);
+    return status;
+}
+
+void PolicyEngine::GetNameIds(const char* uniqueName, vector<uint32_t>& ids) const
+{
+    if (!uniqueName || (uniqueName[0] == '\0')) {
+        return;
+    }
+    uint32_t id = LookupString(uniqueName);
+    if (id != ID_NOT_FOUND) {
+        ids.push_back(id);
+    }
+    OwnedNameMap::const_iterator it = ownedNames.find(StringMapKey(uniqueName));
+    if (it != ownedNames.end()) {
+        ids.insert(ids.end(), it->second.begin(), it->second.end());
+    }
+}
+
+const PolicyEngine::Rule* PolicyEngine::Match(const RuleSet& table, const NormalizedHdr& hdr, const vector<uint32_t>& names) const
+{
+    const Rule* match = NULL;
+    uint32_t best = 0;   /* One more than the number of the matching rule */
+
+    if (table.rules.empty()) {
+        return NULL;
+    }
+
+    /*
+     * Only the lists of rules for the names of the connection and any name, and for the member of
+     * the message and any member, can contain a matching rule.  Each list is in rule order so
+     * the last match in a list is the first one found walking backwards.
+     */
+    uint32_t members[2] = { WILDCARD, hdr.member };
+    size_t numMembers = (hdr.member == WILDCARD) ? 1 : 2;
+    for (size_t n = 0; n <= names.size(); ++n) {
+        uint64_t name = (n < names.size()) ? names[n] : WILDCARD;
+        for (size_t m = 0; m < numMembers; ++m) {
+            STL_NAMESPACE_PREFIX::unordered_map<uint64_t, vector<uint32_t> >::const_iterator it = table.index.find((name << 32) | members[m]);
+            if (it == table.index.end()) {
+                continue;
+            }
+            vector<uint32_t>::const_reverse_iterator r;
+            for (r = it->second.rbegin(); (r != it->second.rend()) && (*r >= best); ++r) {
+                const Rule& rule = table.rules[*r];
+                /* A message without an interface matches any interface */
+                if (((rule.type == MESSAGE_INVALID) || (rule.type == hdr.type)) &&
+                    ((rule.interface == WILDCARD) || (hdr.interface == WILDCARD) || (rule.interface == hdr.interface)) &&
+                    ((rule.path == WILDCARD) || (rule.path == hdr.path)) &&
+                    ((rule.error == WILDCARD) || (rule.error == hdr.error))) {
+                    best = *r + 1;
+                    match = &rule;
+                    break;
+                }
+            }
+        }
+    }
+    return match;
+}
+
+bool PolicyEngine::Evaluate(const NormalizedHdr& hdr, const char* sender, const char* destination) const
+{
+    vector<uint32_t> names;
+
+    /* Send rules match the names of the destination */
+    GetNameIds(destination, names);
+    const Rule* rule = Match(mandatorySend, hdr, names);
+    if (!rule) {
+        rule = Match(defaultSend, hdr, names);
+    }
+    bool allow = rule ? rule->allow : NoMatchDecision(hdr.type);
+
+    /* Receive rules match the names of the sender */
+    if (allow) {
+        names.clear();
+        GetNameIds(sender, names);
+        rule = Match(mandatoryReceive, hdr, names);
+        if (!rule) {
+            rule = Match(defaultReceive, hdr, names);
+        }
+        allow = rule ? rule->allow : NoMatchDecision(hdr.type);
+    }
+    return allow;
+}
+
+bool PolicyEngine::AllowsAll(const RuleSet& mandatory, const RuleSet& dflt)
+{
+    bool catchAll = false;
+    const RuleSet* sets[2] = { &mandatory, &dflt };
+    for (size_t s = 0; s < ArraySize(sets); ++s) {
+        vector<Rule>::const_iterator it;
+        for (it = sets[s]->rules.begin(); it != sets[s]->rules.end(); ++it) {
+            if (!it->allow) {
+                return false;
+            }
+            catchAll |= (it->type == MESSAGE_INVALID) && (it->interface == WILDCARD) && (it->member == WILDCARD) &&
+                        (it->path == WILDCARD) && (it->error == WILDCARD) && (it->name == WILDCARD);
+        }
+    }
+    return catchAll;
+}
+
+uint32_t PolicyEngine::HashKey(AllJoynMessageType type, const char* sender, const char* destination, const char* interface, const char* member, const char* path)
+{
+    uint32_t hash = 2166136261U ^ static_cast<uint32_t>(type);
+    hash = HashString(hash, sender);
+    hash = HashString(hash, destination);
+    hash = HashString(hash, interface);
+    hash = HashString(hash, member);
+    return HashString(hash, path);
+}
+
+bool PolicyEngine::KeyMatches(const qcc::String& key, const char* const* fields, size_t numFields)
+{
+    const char* k = key.c_str();
+    const char* end = k + key.size();
+    for (size_t i = 0; i < numFields; ++i) {
+        size_t len = ::strlen(fields[i]) + 1;
+        if ((static_cast<size_t>(end - k) < len) || (::memcmp(k, fields[i], len) != 0)) {
+            return false;
+        }
+        k += len;
+    }
+    return k == end;
+}
+
+bool PolicyEngine::OKToDeliver(AllJoynMessageType type, const char* sender, const char* destination,
+                               const char* interface, const char* member, const char* path, const char* error)
+{
+    if ((type != MESSAGE_METHOD_CALL) && (type != MESSAGE_SIGNAL)) {
+        return true;
+    }
+    sender = sender ? sender : "";
+    destination = destination ? destination : "";
+    interface = interface ? interface : "";
+    member = member ? member : "";
+
+    /* The path is only part of the key when a rule could depend on it */
+    const char* keyPath = (pathRules && path) ? path : "";
+    const char* const fields[] = { sender, destination, interface, member, keyPath };
+    uint32_t hash = HashKey(type, sender, destination, interface, member, keyPath);
+    uint32_t slot = hash & (CACHE_SIZE - 1);
+
+    if (cacheEnabled) {
+        bool found = false;
+        bool allow = false;
+        int32_t epoch = lookupGuard.EnterLookup();
+        const CacheEntry* entry = cache[slot];
+        if (entry && (entry->generation == generation) && (entry->hash == hash) && (entry->type == type) &&
+            KeyMatches(entry->key, fields, ArraySize(fields))) {
+            allow = entry->allow;
+            found = true;
+        }
+        lookupGuard.ExitLookup(epoch);
+        if (found) {
+            ++cacheHits;
+            return allow;
+        }
+    }
+
+    lock.Lock(MUTEX_CONTEXT);
+    NormalizedHdr hdr;
+    hdr.type = type;
+    hdr.interface = LookupString(interface);
+    hdr.member = LookupString(member);
+    hdr.path = LookupString(path);
+    hdr.error = LookupString(error);
+    bool allow = Evaluate(hdr, sender, destination);
+    ++cacheMisses;
+    if (cacheEnabled) {
+        CacheEntry* entry = new CacheEntry;
+        entry->generation = generation;
+        entry->hash = hash;
+        entry->type = type;
+        entry->allow = allow;
+        size_t len = 0;
+        for (size_t i = 0; i < ArraySize(fields); ++i) {
+            len += ::strlen(fields[i]) + 1;
+        }
+        entry->key.reserve(len);
+        for (size_t i = 0; i < ArraySize(fields); ++i) {
+            entry->key.append(fields[i], ::strlen(fields[i]) + 1);
+        }
+        Retire(slot);
+        cache[slot] = entry;
+        ReclaimRetired();
+    }
+    lock.Unlock(MUTEX_CONTEXT);
+    return allow;
+}
+
+void PolicyEngine::Retire(uint32_t slot)
+{
+    if (cache[slot]) {
+        Retired r;
+        r.entry = cache[slot];
+        cache[slot] = NULL;
+        lookupGuard.Retire(r.ticket);
+        retired.push_back(r);
+    }
+}
+
+void PolicyEngine::ReclaimRetired()
+{
+    size_t i = 0;
+    while (i < retired.size()) {
+        if (lookupGuard.Reclaimable(retired[i].ticket)) {
+            delete retired[i].entry;
+            retired[i] = retired.back();
+            retired.pop_back();
+        } else {
+            ++i;
+        }
+    }
+    /* Move new lookups to the other counter so the one that is still busy can drain */
+    if (!retired.empty()) {
+        lookupGuard.Advance();
+    }
+}
+
+void PolicyEngine::InvalidateCache()
+{
+    if (++generation == 0) {
+        /* Entries from the previous use of generation 1 must not come back to life */
+        for (uint32_t i = 0; i < CACHE_SIZE; ++i) {
+            Retire(i);
+        }
+        ReclaimRetired();
+        generation = 1;
+    }
+}
+
+void PolicyEngine::EnableCache(bool enable)
+{
+    lock.Lock(MUTEX_CONTEXT);
+    cacheEnabled = enable;
+    InvalidateCache();
+    lock.Unlock(MUTEX_CONTEXT);
+}
+
+void PolicyEngine::NameOwnerChanged(const qcc::String& alias, const qcc::String* oldOwner, const qcc::String* newOwner)
+{
+    lock.Lock(MUTEX_CONTEXT);
+    if (alias[0] == ':') {
+        /* Unique names are never reused so decisions about one that has gone can stay cached */
+        if (!newOwner) {
+            OwnedNameMap::iterator it = ownedNames.find(StringMapKey(alias.c_str()));
+            if (it != ownedNames.end()) {
+                ownedNames.erase(it);
+            }
+        }
+    } else {
+        /* A change of owner of a name no rule mentions cannot change any decision */
+        map<qcc::String, uint32_t>::const_iterator rit = ruleNames.find(alias);
+        if (rit != ruleNames.end()) {
+            uint32_t id = rit->second;
+            if (oldOwner) {
+                OwnedNameMap::iterator it = ownedNames.find(StringMapKey(oldOwner->c_str()));
+                if (it != ownedNames.end()) {
+                    vector<uint32_t>::iterator idIt = find(it->second.begin(), it->second.end(), id);
+                    if (idIt != it->second.end()) {
+                        it->second.erase(idIt);
+                    }
+                    if (it->second.empty()) {
+                        ownedNames.erase(it);
+                    }
+                }
+            }
+            if (newOwner) {
+                /* The router reports names owned before the rules were compiled, maybe twice */
+                vector<uint32_t>& ids = ownedNames[StringMapKey(*newOwner)];
+                if (find(ids.begin(), ids.end(), id) == ids.end()) {
+                    ids.push_back(id);
+                }
+            }
+            InvalidateCache();
+        }
+    }
+    lock.Unlock(MUTEX_CONTEXT);
+}
+
+}
@@ -0,0 +1,327 @@
+/**
+ * @file
+ * PolicyEngine decides whether messages may pass between two bus connections according to the
+ * <policy> sections of the daemon configuration.
+ */
+
+/******************************************************************************
+ * Copyright 2012, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#ifndef _ALLJOYN_POLICYENGINE_H
+#define _ALLJOYN_POLICYENGINE_H
+
+#include <qcc/platform.h>
+
+#include <string.h>
+#include <map>
+#include <vector>
+
+#include <qcc/Mutex.h>
+#include <qcc/String.h>
+#include <qcc/StringMapKey.h>
+#include <qcc/Util.h>
+#include <qcc/XmlElement.h>
+
+#include <alljoyn/Message.h>
+
+#include <Status.h>
+
+#include "EpochGuard.h"
+#include "NameTable.h"
+
+#include <qcc/STLContainer.h>
+
+namespace ajn {
+
+/**
+ * PolicyEngine enforces the send and receive rules of the <policy context="default"> and
+ * <policy context="mandatory"> sections of the daemon configuration.  As with the D-Bus daemon
+ * the last rule that matches a message wins and a matching mandatory rule overrides the default
+ * rules.  When no send rule or no receive rule matches, a method call is denied and any other
+ * message is allowed.  The same default applies to both directions so that a configuration
+ * only needs send rules, or only receive rules, to open up method calls in that direction.
+ *
+ * The rules are compiled when the configuration is loaded.  A configuration in which every
+ * message is allowed in both directions, such as the usual <allow send_interface="*"/> and
+ * <allow receive_interface="*"/> with no deny rules, leaves the engine disabled so the router
+ * does not consult it.  The strings the rules mention are replaced by small integer ids and the
+ * rules are indexed by the bus name and member they match so a decision only examines the few
+ * rules that could apply.
+ *
+ * Decisions are cached by the (sender, destination, interface, member) tuple of the message, and
+ * by the object path too if any rule mentions one.  The bus names a connection owns are tracked
+ * through the NameListener interface and any change in the owner of a name used in a rule
+ * invalidates the cache.  Cache entries are never changed once they are published so a decision
+ * found in the cache is made without taking the lock.  A replaced entry is freed when the lookups
+ * that might still be reading it are done, as with the channel table of PacketEngine.
+ *
+ * Replies and errors are not checked; the router only delivers them to the sender of the method
+ * call.  Rules for owning names and connecting, and the user, group and at_console policy
+ * sections, are not supported by the router and are ignored.
+ */
+class PolicyEngine : public NameListener {
+  public:
+
+    static const size_t CACHE_SIZE = 4096;   /**< Number of decisions cached, a power of two */
+
+    /**
+     * Constructor
+     */
+    PolicyEngine();
+
+    /**
+     * Destructor
+     */
+    ~PolicyEngine();
+
+    /**
+     * Compile the rules of the <policy> sections of a configuration replacing any rules compiled
+     * before.  Ownership of the bus names mentioned by the rules is only tracked from this point
+     * on; names owned before the rules were compiled must be reported with NameOwnerChanged().
+     *
+     * @param policies   The <policy> elements of the configuration.
+     *
+     * @return  ER_OK if all the rules were compiled, ER_BUS_BAD_XML if a section or rule is
+     *          malformed.  Rules that were compiled before the error are in effect.
+     */
+    QStatus Compile(const std::vector<const qcc::XmlElement*>& policies);
+
+    /**
+     * Check if the compiled rules can deny a message.  The router only consults the engine if
+     * they can.
+     *
+     * @return  true if there are rules and they do not allow every message.
+     */
+    bool IsEnabled() const { return enabled; }
+
+    /**
+     * Check if a message may be delivered to a connection.  The send rules are checked with the
+     * names owned by the destination and the receive rules with the names owned by the sender.
+     *
+     * @param msg           The message.
+     * @param destination   Unique name of the connection the message is being delivered to.
+     *
+     * @return  true if the message may be delivered.
+     */
+    bool OKToDeliver(const Message& msg, const qcc::String& destination)
+    {
+        return OKToDeliver(msg->GetType(), msg->GetSender(), destination.c_str(), msg->GetInterface(),
+                           msg->GetMemberName(), msg->GetObjectPath(), msg->GetErrorName());
+    }
+
+    /**
+     * Check if a message described by its header fields may be delivered to a connection.
+     *
+     * @param type          Message type.
+     * @param sender        Unique name of the sender.
+     * @param destination   Unique name of the connection the message is being delivered to.
+     * @param interface     Interface name or NULL.
+     * @param member        Member name or NULL.
+     * @param path          Object path or NULL.
+     * @param error         Error name or NULL.
+     *
+     * @return  true if the message may be delivered.
+     */
+    bool OKToDeliver(AllJoynMessageType type, const char* sender, const char* destination,
+                     const char* interface, const char* member, const char* path, const char* error);
+
+    /**
+     * Get the number of decisions made from the cache and the number that were not.  The counts
+     * are not exact while decisions are made on several threads at once.
+     *
+     * @param[out] hits     Decisions found in the cache.
+     * @param[out] misses   Decisions evaluated from the rules.
+     */
+    void GetCacheStats(uint32_t& hits, uint32_t& misses) const { hits = cacheHits; misses = cacheMisses; }
+
+    /**
+     * Turn the decision cache on or off.  Used to measure the cost of evaluating the rules.
+     *
+     * @param enable   true to use the cache (the default).
+     */
+    void EnableCache(bool enable);
+
+    /**
+     * NameListener implementation that tracks the names owned by each connection.
+     */
+    void NameOwnerChanged(const qcc::String& alias, const qcc::String* oldOwner, const qcc::String* newOwner);
+
+  private:
+
+    static const uint32_t WILDCARD = 0;             /**< Id of an unspecified or "*" string, matches any */
+    static const uint32_t ID_NOT_FOUND = 0xffffffff; /**< Id of a string no rule mentions */
+
+    /**
+     * A compiled send or receive rule.
+     */
+    struct Rule {
+        bool allow;                     /**< Allow or deny rule */
+        AllJoynMessageType type;        /**< Message type or MESSAGE_INVALID for any */
+        uint32_t interface;             /**< Interface name id */
+        uint32_t member;                /**< Member name id */
+        uint32_t path;                  /**< Object path id */
+        uint32_t error;                 /**< Error name id */
+        uint32_t name;                  /**< Destination (send) or sender (receive) bus name id */
+
+        Rule(bool allow) : allow(allow), type(MESSAGE_INVALID), interface(WILDCARD), member(WILDCARD), path(WILDCARD), error(WILDCARD), name(WILDCARD) { }
+    };
+
+    /**
+     * The send or receive rules of one policy context.  Rules are numbered in the order they
+     * appear and indexed by the pair (name, member) they match.
+     */
+    struct RuleSet {
+        std::vector<Rule> rules;
+        STL_NAMESPACE_PREFIX::unordered_map<uint64_t, std::vector<uint32_t> > index;
+
+        void Add(const Rule& rule);
+        void Clear() { rules.clear(); index.clear(); }
+    };
+
+    /**
+     * A message header with its strings replaced by ids.
+     */
+    struct NormalizedHdr {
+        AllJoynMessageType type;
+        uint32_t interface;
+        uint32_t member;
+        uint32_t path;
+        uint32_t error;
+    };
+
+    /**
+     * An entry of the decision cache.  Entries are not modified once published.
+     */
+    struct CacheEntry {
+        uint32_t generation;            /**< Cache generation the entry was made in */
+        uint32_t hash;                  /**< Hash of the key */
+        AllJoynMessageType type;
+        bool allow;
+        qcc::String key;                /**< Sender, destination, interface, member and path each followed by a NUL */
+    };
+
+    /** A cache entry waiting for the lookups that may still be reading it */
+    struct Retired {
+        EpochGuard::Ticket ticket;
+        CacheEntry* entry;
+    };
+
+    struct Hash {
+        inline size_t operator()(const qcc::StringMapKey& k) const { return qcc::hash_string(k.c_str()); }
+    };
+
+    struct Equal {
+        inline bool operator()(const qcc::StringMapKey& k1, const qcc::StringMapKey& k2) const { return ::strcmp(k1.c_str(), k2.c_str()) == 0; }
+    };
+
+    typedef STL_NAMESPACE_PREFIX::unordered_map<qcc::StringMapKey, uint32_t, Hash, Equal> StringIdMap;
+    typedef STL_NAMESPACE_PREFIX::unordered_map<qcc::StringMapKey, std::vector<uint32_t>, Hash, Equal> OwnedNameMap;
+
+    /**
+     * Compile one <allow> or <deny> element into the send and receive tables.
+     */
+    QStatus CompileRule(const qcc::XmlElement& elem, RuleSet& send, RuleSet& receive);
+
+    /**
+     * Get the id of a string mentioned by a rule, assigning one if needed.
+     */
+    uint32_t AddString(const qcc::String& str);
+
+    /**
+     * Get the id of a string in a message header.
+     */
+    uint32_t LookupString(const char* str) const;
+
+    /**
+     * Get the ids of the bus names a connection is known by.
+     */
+    void GetNameIds(const char* uniqueName, std::vector<uint32_t>& ids) const;
+
+    /**
+     * Find the last rule of a table that matches a message.
+     *
+     * @param table      The rules.
+     * @param hdr        The normalized message header.
+     * @param names      Ids of the names of the connection the rules are checked against.
+     *
+     * @return  The matching rule or NULL if none matched.
+     */
+    const Rule* Match(const RuleSet& table, const NormalizedHdr& hdr, const std::vector<uint32_t>& names) const;
+
+    /**
+     * Decide from the rules whether a message may be delivered.
+     */
+    bool Evaluate(const NormalizedHdr& hdr, const char* sender, const char* destination) const;
+
+    /**
+     * Check if the rules for one direction allow every message.  They do if none of them denies
+     * anything and one of them matches every message.
+     */
+    static bool AllowsAll(const RuleSet& mandatory, const RuleSet& dflt);
+
+    /**
+     * Hash the fields of a message that make up the cache key.
+     */
+    static uint32_t HashKey(AllJoynMessageType type, const char* sender, const char* destination, const char* interface, const char* member, const char* path);
+
+    /**
+     * Check if the key of a cache entry is made up of the given fields.
+     */
+    static bool KeyMatches(const qcc::String& key, const char* const* fields, size_t numFields);
+
+    /**
+     * Invalidate all the cached decisions.  Must be called with the lock held.
+     */
+    void InvalidateCache();
+
+    /**
+     * Unpublish a cache entry.  Must be called with the lock held.
+     */
+    void Retire(uint32_t slot);
+
+    /**
+     * Free the retired entries that no lookup can still be reading.  Must be called with the lock
+     * held.
+     */
+    void ReclaimRetired();
+
+    /** Lock protecting everything below except where noted */
+    mutable qcc::Mutex lock;
+
+    bool enabled;                       /**< True if the rules can deny a message */
+    bool pathRules;                     /**< True if any rule mentions an object path */
+
+    RuleSet defaultSend;                /**< Send rules of the default context */
+    RuleSet defaultReceive;             /**< Receive rules of the default context */
+    RuleSet mandatorySend;              /**< Send rules of the mandatory context */
+    RuleSet mandatoryReceive;           /**< Receive rules of the mandatory context */
+
+    StringIdMap stringIds;              /**< Ids of the strings mentioned by the rules */
+    std::map<qcc::String, uint32_t> ruleNames;  /**< Ids of the bus names mentioned by the rules */
+    OwnedNameMap ownedNames;            /**< Ids of the rule names owned by each connection */
+
+    CacheEntry* volatile* cache;        /**< Direct mapped decision cache.  Read without the lock */
+    volatile uint32_t generation;       /**< Entries from older generations are invalid.  Read without the lock */
+    volatile bool cacheEnabled;         /**< Decisions are only cached if true.  Read without the lock */
+    uint32_t cacheHits;                 /**< Decisions found in the cache.  Updated without the lock */
+    uint32_t cacheMisses;               /**< Decisions evaluated from the rules */
+
+    EpochGuard lookupGuard;             /**< Tracks the cache lookups made without the lock */
+    std::vector<Retired> retired;       /**< Entries that have been replaced but may still be read */
+};
+
+}
+
+#endif
@@ -156,6 +156,19 @@ class RuleTable {
         return ER_OK;
     }
 
+    /**
+     * Get the number of rules in the rule table.
+     *
+     * @return  Number of rules.
+     */
+    size_t GetNumRules()
+    {
+        Lock();
+        size_t numRules = rules.size();
+        Unlock();
+        return numRules;
+    }
+
     /**
      * Obtain exclusive access to rule table.
      * This method only needs to be called before using methods that return or use
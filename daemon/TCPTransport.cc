@@ -278,35 +278,46 @@
  * When an inbound connection request is received, the accept loop will wake up
  * and create a TCPEndpoint for the *proposed* new connection.  Recall
  * that an endpoint is not brought up immediately, but an authentication step
- * must be performed.  The server accept loop starts this process by placing the
- * new TCPEndpoint on an authList, or list of authenticating endpoints.
- * It then calls the endpoint Authenticate() method which spins up an
- * authentication thread and returns immediately.  This process transfers the
- * responsibility for the connection and its resources to the authentication
- * thread.  Authentication can succeed, fail, or take to long and be aborted.
- *
- * If authentication succeeds, the authentication thread calls back into the
- * TCPTransport's Authenticated() method.  Along with indicating that
- * authentication has completed successfully, this transfers ownership of the
- * TCPEndpoint back to the TCPTransport from the authentication
- * thread.  At this time, the TCPEndpoint is Start()ed which spins up
- * the transmit and receive threads and enables Message routing across the
- * transport.
- *
- * If the authentication fails, the authentication thread simply sets a the
- * TCPEndpoint state to FAILED and exits.  The server accept loop looks at
- * authenticating endpoints (those on the authList)each time through its loop.
- * If an endpoint has failed authentication, and its thread has actually gone
- * away (or more precisely is at least going away in such a way that it will
- * never touch the endpoint data structure again).  This means that the endpoint
- * can be deleted.
+ * must be performed.  Before anything is allocated, the accept loop checks a
+ * token bucket kept for the remote address, so a single source reconnecting
+ * in a tight loop is dropped rather than crowding out everyone else.  The
+ * accept loop then places the new TCPEndpoint on an authList, or list of
+ * authenticating endpoints, and adds its socketFd to the events it waits on.
+ *
+ * Authentication is not run on a thread per connection.  During reconnect
+ * storms that meant creating and destroying a thread for every connection
+ * attempt.  Instead the transport keeps a small pool of authentication
+ * workers which is grown on demand up to the limit on authenticating
+ * connections and never shrunk.  When the first byte of a connection arrives,
+ * the accept loop puts the endpoint on the authQueue.  This process transfers
+ * the responsibility for the connection and its resources to the
+ * authentication workers.  A connection that never sends anything never ties
+ * up a worker.  The worker takes the endpoint off the queue and runs its
+ * Authenticate() method.  Authentication can succeed, fail, or take to long and
+ * be aborted.
+ *
+ * If authentication succeeds, the worker calls back into the TCPTransport's
+ * Authenticated() method.  Along with indicating that authentication has
+ * completed successfully, this transfers ownership of the TCPEndpoint back to
+ * the TCPTransport from the worker.  At this time, the TCPEndpoint is
+ * Start()ed which spins up the transmit and receive threads and enables
+ * Message routing across the transport.
+ *
+ * If the authentication fails, the worker simply sets a the TCPEndpoint state
+ * to FAILED and goes on to the next connection.  In either case the worker
+ * Alert()s the accept loop, which looks at authenticating endpoints (those on
+ * the authList) each time through its loop.  If an endpoint has failed
+ * authentication, the worker will never touch the endpoint data structure
+ * again.  This means that the endpoint can be deleted.
  *
  * If the authentication takes "too long" we assume that a denial of service
- * attack in in progress.  We call AuthStop() on such an endpoint which will most
- * likely induce a failure (unless we happen to call abort just as the endpoint
- * actually finishes the authentication which is highly unlikely but okay).
- * This AuthStop() will cause the endpoint to be scavenged using the above mechanism
- * the next time through the accept loop.
+ * attack in in progress.  We call AuthStop() on such an endpoint which shuts
+ * down its socket and will most likely induce a failure (unless we happen to
+ * call abort just as the endpoint actually finishes the authentication which is
+ * highly unlikely but okay).  This AuthStop() will cause the endpoint to be
+ * scavenged using the above mechanism the next time through the accept loop.
+ * The accept loop wakes up periodically to check while any connection is
+ * authenticating.
  *
  * A daemon transport can accept incoming connections, and it can make outgoing
  * connections to another daemon.  This case is simpler than the accept case
@@ -347,17 +358,17 @@
  *
  *   1) Threads that may be running in the server accept loop with associated Events
  *      and their dependent socketFds stored in the listenFds list.
- *   2) Threads that may be running authentication with associated endpoint objects,
- *      streams and SocketFds.  These threads are accessible through endpoint objects
- *      stored on the authList.
+ *   2) Authentication workers that may be running authentication with associated
+ *      endpoint objects, streams and SocketFds.  The endpoints are stored on the
+ *      authList and the workers on the list of authentication workers.
  *   3) Threads that may be running the rx and tx loops in endpoints which are up and
  *      running, transporting routable Messages through the system.
  *
- * Note that we also have to understand and deal with the fact that threads
- * running in state (2) above, will exit and depend on the server accept loop to
- * scavenge the associated objects off of the authList and delete them.  This
- * means that the server accept loop cannot be Stop()ped until the authList is
- * empty.  We further have to understand that threads running in state (3) above
+ * Note that we also have to understand and deal with the fact that workers
+ * running in state (2) above, depend on the server accept loop to scavenge the
+ * associated objects off of the authList and delete them.  This means that the
+ * workers must be Join()ed before the endpoints left on the authList are
+ * deleted.  We further have to understand that threads running in state (3) above
  * will depend on the hooked EndpointExit function to dispose of associated
  * resources.  This will happen in the context of either the transmit or receive
  * thread (the last to go).  We can't delete the transport until all of its
@@ -387,6 +398,10 @@ const uint32_t TCP_LINK_TIMEOUT_PROBE_ATTEMPTS       = 1;
 const uint32_t TCP_LINK_TIMEOUT_PROBE_RESPONSE_DELAY = 10;
 const uint32_t TCP_LINK_TIMEOUT_MIN_LINK_TIMEOUT     = 40;
 
+const uint32_t TCP_AUTH_SCAVENGE_INTERVAL            = 1000;
+const size_t TCP_MAX_CONNECTION_BUCKETS              = 1024;
+const uint32_t TCP_AUTH_READ_TIMEOUT                 = 5000;
+
 namespace ajn {
 
 /**
@@ -394,6 +409,27 @@ namespace ajn {
  */
 const char* TCPTransport::TransportName = "tcp";
 
+/*
+ * A socket stream whose reads give up after a while without data.  The SASL and
+ * Hello exchange is written as blocking reads on the stream, so this is what
+ * frees an authentication worker from a peer that stops sending part way
+ * through.  Once the connection is authenticated the reads block as usual.
+ */
+class TCPAuthStream : public qcc::SocketStream {
+  public:
+    TCPAuthStream(qcc::SocketFd sock) : qcc::SocketStream(sock), m_readTimeout(Event::WAIT_FOREVER) { }
+
+    void SetReadTimeout(uint32_t timeout) { m_readTimeout = timeout; }
+
+    QStatus PullBytes(void* buf, size_t reqBytes, size_t& actualBytes, uint32_t timeout = Event::WAIT_FOREVER)
+    {
+        return qcc::SocketStream::PullBytes(buf, reqBytes, actualBytes, min(timeout, static_cast<uint32_t>(m_readTimeout)));
+    }
+
+  private:
+    volatile uint32_t m_readTimeout;  /**< Longest a single read may wait for data */
+};
+
 /*
  * An endpoint class to handle the details of authenticating a connection in a
  * way that avoids denial of service attacks.
@@ -402,21 +438,24 @@ class TCPEndpoint : public RemoteEndpoint {
   public:
     /**
      * There are three threads that can be running around in this data
-     * structure.  An auth thread is run before the endpoint is started in order
-     * to handle the security stuff that must be taken care of before messages
-     * can start passing.  This enum reflects the states of the authentication
-     * process and the state can be found in m_authState.  Once authentication
-     * is complete, the auth thread must go away, but it must also be joined,
-     * which is indicated by the AUTH_DONE state.  The other threads are the
-     * endpoint RX and TX threads, which are dealt with by the EndpointState.
+     * structure.  Before the endpoint is started the security stuff that must
+     * be taken care of before messages can start passing is handled by one of
+     * the authentication workers of the transport.  This enum reflects the
+     * states of the authentication process and the state can be found in
+     * m_authState.  A new connection waits in the server accept loop until the
+     * first byte arrives and is then queued for a worker.  Once authentication
+     * is complete the worker lets go of the endpoint, which is indicated by the
+     * AUTH_DONE state.  The other threads are the endpoint RX and TX threads,
+     * which are dealt with by the EndpointState.
      */
     enum AuthState {
         AUTH_ILLEGAL = 0,
-        AUTH_INITIALIZED,    /**< This endpoint structure has been allocated but no auth thread has been run */
-        AUTH_AUTHENTICATING, /**< We have spun up an authentication thread and it has begun running our user function */
-        AUTH_FAILED,         /**< The authentication has failed and the authentication thread is exiting immidiately */
+        AUTH_INITIALIZED,    /**< This endpoint structure has been allocated and is waiting for the first byte */
+        AUTH_QUEUED,         /**< The first byte has arrived and the endpoint is waiting for an authentication worker */
+        AUTH_AUTHENTICATING, /**< An authentication worker has begun running the authentication */
+        AUTH_FAILED,         /**< The authentication has failed and the worker is done with the endpoint */
         AUTH_SUCCEEDED,      /**< The auth process (Establish) has succeeded and the connection is ready to be started */
-        AUTH_DONE,           /**< The auth thread has been successfully shut down and joined */
+        AUTH_DONE,           /**< The server accept loop has seen the successful authentication */
     };
 
     /**
@@ -464,7 +503,6 @@ class TCPEndpoint : public RemoteEndpoint {
         m_authState(AUTH_INITIALIZED),
         m_epState(EP_INITIALIZED),
         m_tStart(qcc::Timespec(0)),
-        m_authThread(this, transport),
         m_stream(sock),
         m_ipAddr(ipAddr),
         m_port(port),
@@ -474,9 +512,9 @@ class TCPEndpoint : public RemoteEndpoint {
 
     void SetStartTime(qcc::Timespec tStart) { m_tStart = tStart; }
     qcc::Timespec GetStartTime(void) { return m_tStart; }
-    QStatus Authenticate(void);
+    void Authenticate(void);
     void AuthStop(void);
-    void AuthJoin(void);
+    qcc::SocketFd GetSocketFd() { return m_stream.GetSocketFd(); }
     const qcc::IPAddress& GetIPAddress() { return m_ipAddr; }
     uint16_t GetPort() { return m_port; }
 
@@ -500,11 +538,22 @@ class TCPEndpoint : public RemoteEndpoint {
         m_authState = AUTH_DONE;
     }
 
+    void SetAuthQueued(void)
+    {
+        m_authState = AUTH_QUEUED;
+    }
+
     void SetAuthenticating(void)
     {
         m_authState = AUTH_AUTHENTICATING;
     }
 
+    void SetAuthFailed(void)
+    {
+        m_stream.Close();
+        m_authState = AUTH_FAILED;
+    }
+
     EndpointState GetEpState(void) { return m_epState; }
 
     void SetEpFailed(void)
@@ -549,228 +598,214 @@ class TCPEndpoint : public RemoteEndpoint {
         return status;
     }
 
-    /*
-     * Return true if the auth thread is STARTED, RUNNING or STOPPING.  A true
-     * response means the authentication thread is in a state that indicates
-     * a possibility it might touch the endpoint data structure.  This means
-     * don't delete the endpoint if this method returns true.  This method
-     * indicates nothing about endpoint rx and tx thread state.
-     */
-    bool IsAuthThreadRunning(void)
-    {
-        return m_authThread.IsRunning();
-    }
-
   private:
-    class AuthThread : public qcc::Thread {
-      public:
-        AuthThread(TCPEndpoint* conn, TCPTransport* trans) : Thread("auth"), m_transport(trans) { }
-      private:
-        virtual qcc::ThreadReturn STDCALL Run(void* arg);
-
-        TCPTransport* m_transport;
-    };
-
     TCPTransport* m_transport;  /**< The server holding the connection */
     volatile SideState m_sideState;   /**< Is this an active or passive connection */
     volatile AuthState m_authState;   /**< The state of the endpoint authentication process */
     volatile EndpointState m_epState; /**< The state of the endpoint authentication process */
     qcc::Timespec m_tStart;           /**< Timestamp indicating when the authentication process started */
-    AuthThread m_authThread;          /**< Thread used to do blocking calls during startup */
-    qcc::SocketStream m_stream;       /**< Stream used by authentication code */
+    TCPAuthStream m_stream;           /**< Stream used by authentication code */
     qcc::IPAddress m_ipAddr;          /**< Remote IP address. */
     uint16_t m_port;                  /**< Remote port. */
     bool m_wasSuddenDisconnect;       /**< If true, assumption is that any disconnect is unexpected due to lower level error */
 };
 
-QStatus TCPEndpoint::Authenticate(void)
-{
-    QCC_DbgTrace(("TCPEndpoint::Authenticate()"));
-    /*
-     * Start the authentication thread.
-     */
-    QStatus status = m_authThread.Start(this);
-    if (status != ER_OK) {
-        m_authState = AUTH_FAILED;
-    }
-    return status;
-}
-
 void TCPEndpoint::AuthStop(void)
 {
     QCC_DbgTrace(("TCPEndpoint::AuthStop()"));
 
     /*
-     * Ask the auth thread to stop executing.  The only ways out of the thread
-     * run function will set the state to either AUTH_SUCCEEDED or AUTH_FAILED.
-     * There is a very small chance that we will send a stop to the thread after
-     * it has successfully authenticated, but we expect that this will result in
-     * an AUTH_FAILED state for the vast majority of cases.  In this case, we
-     * notice that the thread failed the next time through the main server run
-     * loop, join the thread via AuthJoin below and delete the endpoint.  Note
-     * that this is a lazy cleanup of the endpoint.
-     */
-    m_authThread.Stop();
-}
-
-void TCPEndpoint::AuthJoin(void)
-{
-    QCC_DbgTrace(("TCPEndpoint::AuthJoin()"));
-
-    /*
-     * Join the auth thread to stop executing.  All threads must be joined in
-     * order to communicate their return status.  The auth thread is no exception.
-     * This is done in a lazy fashion from the main server accept loop, where we
-     * cleanup every time through the loop.
-     */
-    m_authThread.Join();
+     * Ask the authentication to stop.  The endpoint may be waiting for a
+     * worker or a worker may be blocked reading from the socket, so we can't
+     * stop a thread; we shut the socket down instead.  Any read that is or will
+     * be made by the worker then fails and the only ways out of Authenticate()
+     * will set the state to either AUTH_SUCCEEDED or AUTH_FAILED.  There is a
+     * very small chance that we will shut the socket down just after the
+     * connection has successfully authenticated, but we expect that this will
+     * result in an AUTH_FAILED state for the vast majority of cases.  In this
+     * case, we notice that the authentication failed the next time through the
+     * main server run loop and delete the endpoint.  Note that this is a lazy
+     * cleanup of the endpoint.  Unlike a Close(), a Shutdown() leaves the file
+     * descriptor valid so it cannot be reused while a worker is using it.
+     */
+    qcc::Shutdown(m_stream.GetSocketFd());
 }
 
-void* TCPEndpoint::AuthThread::Run(void* arg)
+void TCPEndpoint::Authenticate(void)
 {
-    QCC_DbgTrace(("TCPEndpoint::AuthThread::Run()"));
-
-    TCPEndpoint* conn = reinterpret_cast<TCPEndpoint*>(arg);
+    QCC_DbgTrace(("TCPEndpoint::Authenticate()"));
 
-    conn->m_authState = AUTH_AUTHENTICATING;
+    m_authState = AUTH_AUTHENTICATING;
 
     /*
-     * We're running an authentication process here and we are cooperating with
-     * the main server thread.  This thread is running in an object that is
-     * allocated on the heap, and the server is managing these objects so we
-     * need to coordinate getting all of this cleaned up.
+     * We're running an authentication process here on an authentication worker
+     * and we are cooperating with the main server thread.  The server is
+     * managing the endpoint objects so we need to coordinate getting all of
+     * this cleaned up.
      *
-     * There is a state variable that only we write.  The server thread only
-     * reads this variable, so there are no data sharing issues.  If there is an
-     * authentication failure, this thread sets that state variable to
-     * AUTH_FAILED and then exits.  The server holds a list of currently
+     * There is a state variable that only we write while we have the endpoint.
+     * The server thread only reads this variable, so there are no data sharing
+     * issues.  If there is an authentication failure, we set that state
+     * variable to AUTH_FAILED and return.  The server holds a list of currently
      * authenticating connections and will look for AUTH_FAILED connections when
-     * it runs its Accept loop.  If it finds one, it will AuthJoin() this
-     * thread.  Since we set AUTH_FAILED immediately before exiting, there will
-     * be no problem having the server block waiting for the Join() to complete.
-     * We fail authentication here and let the server clean up after us, lazily.
+     * it runs its Accept loop.  If it finds one it deletes it.  We fail
+     * authentication here and let the server clean up after us, lazily.
      *
-     * If we succeed in the authentication process, we set the state variable
-     * to AUTH_SUCEEDED and then call back into the server telling it that we are
-     * up and running.  It needs to take us off of the list of authenticating
-     * connections and put us on the list of running connections.  This thread
-     * will quickly go away and will be replaced by the RX and TX threads of
-     * the running RemoteEndpoint.
+     * If we succeed in the authentication process, we call back into the server
+     * telling it that we are up and running and set the state variable to
+     * AUTH_SUCEEDED.  It needs to take us off of the list of authenticating
+     * connections and put us on the list of running connections.  The worker
+     * will go on to the next connection and the endpoint is now served by the
+     * RX and TX threads of the running RemoteEndpoint.
      *
      * If we are running an authentication process, we are probably ultimately
-     * blocked on a socket.  We expect that if the server is asked to shut
-     * down, it will run through its list of authenticating connections and
-     * AuthStop() each one.  That will cause a thread Stop() which should unblock
-     * all of the reads and return an error which will eventually pop out here
-     * with an authentication failure.
+     * blocked on a socket.  We expect that if the server is asked to shut down,
+     * it will Stop() the workers and run through its list of authenticating
+     * connections and AuthStop() each one.  That will unblock all of the reads
+     * and return an error which will eventually pop out here with an
+     * authentication failure.
      *
      * Finally, if the server decides we've spent too much time here and we are
      * actually a denial of service attack, it can close us down by doing an
-     * AuthStop() on the authenticating endpoint.  This will do a thread Stop()
-     * on the auth thread of the endpoint which will pop out of here as an
-     * authentication failure as well.  The only ways out of this method must be
-     * with state = AUTH_FAILED or state = AUTH_SUCCEEDED.
+     * AuthStop() on the authenticating endpoint.  This will shut down the socket
+     * which will pop out of here as an authentication failure as well.  The
+     * only ways out of this method must be with state = AUTH_FAILED or state =
+     * AUTH_SUCCEEDED.
+     *
+     * A peer that stops sending in the middle of the exchange would otherwise
+     * hold this worker until the auth timeout, so while we authenticate every
+     * read fails if no data arrives for TCP_AUTH_READ_TIMEOUT.
      */
+    m_stream.SetReadTimeout(TCP_AUTH_READ_TIMEOUT);
+
     uint8_t byte;
     size_t nbytes;
 
     /*
      * Eat the first byte of the stream.  This is required to be zero by the
      * DBus protocol.  It is used in the Unix socket implementation to carry
-     * out-of-band capabilities, but is discarded here.  We do this here since
-     * it involves a read that can block.
+     * out-of-band capabilities, but is discarded here.  The server accept loop
+     * only queues the endpoint once the socket is readable so this read does
+     * not block.
      */
-    QStatus status = conn->m_stream.PullBytes(&byte, 1, nbytes);
+    QStatus status = m_stream.PullBytes(&byte, 1, nbytes);
     if ((status != ER_OK) || (nbytes != 1) || (byte != 0)) {
-        conn->m_stream.Close();
+        m_stream.Close();
         QCC_LogError(status, ("Failed to read first byte from stream"));
 
         /*
-         * Management of the resources used by the authentication thread is done
-         * in one place, by the server Accept loop.  The authentication thread
-         * writes its state into the connection and the server Accept loop reads
-         * this state.  As soon as we set this state to AUTH_FAILED, we are
-         * telling the Accept loop that we are done with the conn data
-         * structure.  That thread is then free to do anything it wants with the
-         * connection, including deleting it, so we are not allowed to touch
-         * conn after setting this state.
-         *
-         * In addition to releasing responsibility for the conn data structure,
-         * when we set the state to AUTH_SUCCEEDED we are telling the server
-         * accept loop that we are exiting now and so it can Join() on us (the
-         * authentication thread) without being worried about blocking since the
-         * next thing we do is exit.
+         * Management of the resources used by the authentication is done in
+         * one place, by the server Accept loop.  The worker writes the state
+         * into the connection and the server Accept loop reads this state.  As
+         * soon as we set this state to AUTH_FAILED, we are telling the Accept
+         * loop that we are done with the conn data structure.  That thread is
+         * then free to do anything it wants with the connection, including
+         * deleting it, so we are not allowed to touch conn after setting this
+         * state.
          */
-        conn->m_authState = AUTH_FAILED;
-        return (void*)ER_FAIL;
+        m_authState = AUTH_FAILED;
+        return;
     }
 
     /* Initialized the features for this endpoint */
-    conn->GetFeatures().isBusToBus = false;
-    conn->GetFeatures().isBusToBus = false;
-    conn->GetFeatures().handlePassing = false;
+    GetFeatures().isBusToBus = false;
+    GetFeatures().handlePassing = false;
 
     /* Run the actual connection authentication code. */
     qcc::String authName;
     qcc::String redirection;
-    status = conn->Establish("ANONYMOUS", authName, redirection);
+    status = Establish("ANONYMOUS", authName, redirection);
     if (status != ER_OK) {
-        conn->m_stream.Close();
+        m_stream.Close();
         QCC_LogError(status, ("Failed to establish TCP endpoint"));
 
         /*
-         * Management of the resources used by the authentication thread is done
-         * in one place, by the server Accept loop.  The authentication thread
-         * writes its state into the connection and the server Accept loop reads
-         * this state.  As soon as we set this state to AUTH_FAILED, we are
-         * telling the Accept loop that we are done with the conn data
-         * structure.  That thread is then free to do anything it wants with the
-         * connection, including deleting it, so we are not allowed to touch
-         * conn after setting this state.
-         *
-         * In addition to releasing responsibility for the conn data structure,
-         * when we set the state to AUTH_SUCCEEDED we are telling the server
-         * accept loop that we are exiting now and so it can Join() on us (the
-         * authentication thread) without being worried about blocking since the
-         * next thing we do is exit.
+         * As above, as soon as we set this state to AUTH_FAILED the server
+         * Accept loop is free to delete the connection.
          */
-        conn->m_authState = AUTH_FAILED;
-        return (void*)status;
+        m_authState = AUTH_FAILED;
+        return;
     }
 
     /*
      * Tell the transport that the authentication has succeeded and that it can
-     * now bring the connection up.
+     * now bring the connection up.  The RX thread must be free to wait for
+     * messages as long as it likes.
      */
-    conn->m_transport->Authenticated(conn);
+    m_stream.SetReadTimeout(Event::WAIT_FOREVER);
+    m_transport->Authenticated(this);
 
-    QCC_DbgTrace(("TCPEndpoint::AuthThread::Run(): Returning"));
+    QCC_DbgTrace(("TCPEndpoint::Authenticate(): Returning"));
 
     /*
      * We are now done with the authentication process.  We have succeeded doing
      * the authentication and we may or may not have succeeded in starting the
      * endpoint TX and RX threads depending on what happened down in
-     * Authenticated().  What concerns us here is that we are done with this
-     * thread (the authentication thread) and we are about to exit.  Before
-     * exiting, we must tell server accept loop that we are done with this data
-     * structure.  As soon as we set this state to AUTH_SUCCEEDED that thread is
-     * then free to do anything it wants with the connection, including deleting
-     * it, so we are not allowed to touch conn after setting this state.
-     *
-     * In addition to releasing responsibility for the conn data structure, when
-     * we set the state to AUTH_SUCCEEDED we are telling the server accept loop
-     * that we are exiting now and so it can Join() the authentication thread
-     * without being worried about blocking since the next thing we do is exit.
+     * Authenticated().  What concerns us here is that the worker is done with
+     * this data structure.  As soon as we set this state to AUTH_SUCCEEDED the
+     * server accept loop is free to do anything it wants with the connection,
+     * including deleting it, so we are not allowed to touch conn after setting
+     * this state.
+     */
+    m_authState = AUTH_SUCCEEDED;
+}
+
+void* TCPTransport::AuthWorker::Run(void* arg)
+{
+    QCC_DbgTrace(("TCPTransport::AuthWorker::Run()"));
+
+    /*
+     * An authentication worker takes connections that are ready to be
+     * authenticated off of the auth queue one at a time and runs the
+     * authentication.  The workers live as long as the server accept loop so
+     * that a storm of incoming connections does not mean a storm of threads
+     * being created and destroyed.
      */
-    conn->m_authState = AUTH_SUCCEEDED;
-    return (void*)status;
+    while (!IsStopping()) {
+        m_transport->m_authQueueLock.Lock(MUTEX_CONTEXT);
+        if (m_transport->m_authQueue.empty()) {
+            /*
+             * The queue event is set under the lock whenever a connection is
+             * queued, so resetting it here under the same lock can't lose a
+             * connection.
+             */
+            m_transport->m_authQueueEvent.ResetEvent();
+            ++m_transport->m_authIdle;
+            m_transport->m_authQueueLock.Unlock(MUTEX_CONTEXT);
+
+            QStatus status = Event::Wait(m_transport->m_authQueueEvent);
+
+            m_transport->m_authQueueLock.Lock(MUTEX_CONTEXT);
+            --m_transport->m_authIdle;
+            m_transport->m_authQueueLock.Unlock(MUTEX_CONTEXT);
+
+            if (status == ER_ALERTED_THREAD) {
+                stopEvent.ResetEvent();
+            }
+            continue;
+        }
+        TCPEndpoint* conn = m_transport->m_authQueue.front();
+        m_transport->m_authQueue.pop_front();
+        m_transport->m_authQueueLock.Unlock(MUTEX_CONTEXT);
+
+        conn->Authenticate();
+
+        /*
+         * The server accept loop scavenges the endpoint and may have a slot
+         * for a new connection, so wake it up.  We must not touch conn now.
+         */
+        m_transport->Alert();
+    }
+
+    QCC_DbgTrace(("TCPTransport::AuthWorker::Run(): Exiting"));
+    return 0;
 }
 
 TCPTransport::TCPTransport(BusAttachment& bus)
     : Thread("TCPTransport"), m_bus(bus), m_stopping(false), m_listener(0),
     m_foundCallback(m_listener),
     m_isAdvertising(false), m_isDiscovering(false), m_isListening(false), m_isNsEnabled(false),
-    m_listenPort(0), m_nsReleaseCount(0)
+    m_authIdle(0), m_listenPort(0), m_nsReleaseCount(0)
 {
     QCC_DbgTrace(("TCPTransport::TCPTransport()"));
     /*
@@ -954,16 +989,27 @@ QStatus TCPTransport::Stop(void)
     }
 
     /*
-     * Ask any authenticating endpoints to shut down and exit their threads.  By its
-     * presence on the m_authList, we know that the endpoint is authenticating and
-     * the authentication thread has responsibility for dealing with the endpoint
-     * data structure.  We call Stop() to stop that thread from running.  The
-     * endpoint Rx and Tx threads will not be running yet.
+     * Ask any authenticating endpoints to shut down.  By its presence on the
+     * m_authList, we know that the endpoint is waiting to authenticate or that
+     * an authentication worker has responsibility for dealing with the
+     * endpoint data structure.  We call AuthStop() to make any worker using it
+     * pop out of its blocking calls.  The endpoint Rx and Tx threads will not
+     * be running yet.
      */
     for (set<TCPEndpoint*>::iterator i = m_authList.begin(); i != m_authList.end(); ++i) {
         (*i)->AuthStop();
     }
 
+    /*
+     * Ask the authentication workers to exit their threads.  They are joined
+     * in Join() before the endpoints left on the m_authList are deleted.
+     */
+    m_authQueueLock.Lock(MUTEX_CONTEXT);
+    for (vector<AuthWorker*>::iterator i = m_authWorkers.begin(); i != m_authWorkers.end(); ++i) {
+        (*i)->Stop();
+    }
+    m_authQueueLock.Unlock(MUTEX_CONTEXT);
+
     /*
      * Ask any running endpoints to shut down and exit their threads.  By its
      * presence on the m_endpointList, we know that authentication is compete and
@@ -1023,19 +1069,33 @@ QStatus TCPTransport::Join(void)
      * make sure we wait for all of the connections on the m_authList to go away
      * before we look for the connections on the m_endpointlist.
      */
+    /*
+     * The authentication workers have been asked to exit in a previously
+     * required Stop().  We need to Join() them here, before we look at the
+     * m_authList, since a worker is responsible for the endpoint it is
+     * authenticating.  The server accept loop has been joined so no new
+     * workers can be started.
+     */
+    for (vector<AuthWorker*>::iterator i = m_authWorkers.begin(); i != m_authWorkers.end(); ++i) {
+        (*i)->Join();
+        delete *i;
+    }
+    m_authWorkers.clear();
+    m_authQueue.clear();
+    m_authIdle = 0;
+
     m_endpointListLock.Lock(MUTEX_CONTEXT);
 
     /*
-     * Any authenticating endpoints have been asked to shut down and exit their
-     * authentication threads in a previously required Stop().  We need to
-     * Join() all of these auth threads here.
+     * Any authenticating endpoints have been asked to shut down in a previously
+     * required Stop() and no worker is using them anymore, so we can simply
+     * delete them here.
      */
     set<TCPEndpoint*>::iterator it = m_authList.begin();
     while (it != m_authList.end()) {
         TCPEndpoint* ep = *it;
         m_authList.erase(it);
         m_endpointListLock.Unlock(MUTEX_CONTEXT);
-        ep->AuthJoin();
         delete ep;
         m_endpointListLock.Lock(MUTEX_CONTEXT);
         it = m_authList.upper_bound(ep);
@@ -1046,7 +1106,7 @@ QStatus TCPTransport::Join(void)
      * Any running endpoints have been asked it their threads in a previously
      * required Stop().  We need to Join() all of thesse threads here.  This
      * Join() will wait on the endpoint rx and tx threads to exit as opposed to
-     * the joining of the auth thread we did above.
+     * the joining of the auth workers we did above.
      */
     it = m_endpointList.begin();
     while (it != m_endpointList.end()) {
@@ -1339,15 +1399,13 @@ void TCPTransport::ManageEndpoints(Timespec tTimeout)
 
         if (authState == TCPEndpoint::AUTH_FAILED) {
             /*
-             * The endpoint has failed authentication and the auth thread is
-             * gone or is going away.  Since it has failed there is no way this
-             * endpoint is going to be started so we can get rid of it as soon
-             * as we Join() the (failed) authentication thread.
+             * The endpoint has failed authentication and the worker is done
+             * with it.  Since it has failed there is no way this endpoint is
+             * going to be started so we can get rid of it.
              */
             QCC_DbgHLPrintf(("TCPTransport::ManageEndpoints(): Scavenging failed authenticator"));
             m_authList.erase(i);
             m_endpointListLock.Unlock(MUTEX_CONTEXT);
-            ep->AuthJoin();
             delete ep;
             m_endpointListLock.Lock(MUTEX_CONTEXT);
             i = m_authList.upper_bound(ep);
@@ -1358,19 +1416,30 @@ void TCPTransport::ManageEndpoints(Timespec tTimeout)
         GetTimeNow(&tNow);
 
         if (ep->GetStartTime() + tTimeout < tNow) {
+            QCC_DbgHLPrintf(("TCPTransport::ManageEndpoints(): Scavenging slow authenticator"));
+            if (authState == TCPEndpoint::AUTH_INITIALIZED) {
+                /*
+                 * This endpoint never sent its first byte so it was never
+                 * handed to a worker and belongs to this thread.  We can get
+                 * rid of it right away.
+                 */
+                m_authList.erase(i);
+                m_endpointListLock.Unlock(MUTEX_CONTEXT);
+                delete ep;
+                m_endpointListLock.Lock(MUTEX_CONTEXT);
+                i = m_authList.upper_bound(ep);
+                continue;
+            }
+
             /*
              * This endpoint is taking too long to authenticate.  Stop the
-             * authentication process.  The auth thread is still running, so we
-             * can't just delete the connection, we need to let it stop in its
-             * own time.  What that thread will do is to set AUTH_FAILED and
-             * exit.  we will then clean it up the next time through this loop.
-             * In the hope that the thread can exit and we can catch its exit
-             * here and now, we take our thread off the OS ready list (Sleep)
-             * and let the other thread run before looping back.
+             * authentication process.  The endpoint is queued for or in use by
+             * a worker, so we can't just delete the connection, we need to let
+             * the worker fail it in its own time.  What the worker will do is
+             * to set AUTH_FAILED and the server accept loop, which the worker
+             * wakes up, will then clean it up the next time through this loop.
              */
-            QCC_DbgHLPrintf(("TCPTransport::ManageEndpoints(): Scavenging slow authenticator"));
             ep->AuthStop();
-            qcc::Sleep(1);
         }
         ++i;
     }
@@ -1399,20 +1468,26 @@ void TCPTransport::ManageEndpoints(Timespec tTimeout)
 
         if (authState == TCPEndpoint::AUTH_SUCCEEDED) {
             /*
-             * The endpoint has succeeded authentication and the auth thread is
-             * gone or is going away.  Take this opportunity to join the auth
-             * thread.  Since the auth thread promised not to touch the state
-             * after setting AUTH_SUCCEEEDED, we can safely change the state
-             * here since we now own the conn.  We do this through a method call
-             * to enable this single special case where we are allowed to set
-             * the state.
+             * The endpoint has succeeded authentication and the worker is done
+             * with it.  Since the worker promised not to touch the state after
+             * setting AUTH_SUCCEEEDED, we can safely change the state here
+             * since we now own the conn.  We do this through a method call to
+             * enable this single special case where we are allowed to set the
+             * state.
              */
-            QCC_DbgHLPrintf(("TCPTransport::ManageEndpoints(): Scavenging failed authenticator"));
-            m_endpointListLock.Unlock(MUTEX_CONTEXT);
-            ep->AuthJoin();
             ep->SetAuthDone();
-            m_endpointListLock.Lock(MUTEX_CONTEXT);
-            i = m_endpointList.upper_bound(ep);
+            ++i;
+            continue;
+        }
+
+        /*
+         * Authenticated() moves the endpoint to the endpointList and starts it
+         * before the worker sets AUTH_SUCCEEDED, so a worker may still be about
+         * to touch an endpoint that is not yet AUTH_DONE.  Leave it alone until
+         * then.
+         */
+        if (authState != TCPEndpoint::AUTH_DONE) {
+            ++i;
             continue;
         }
 
@@ -1442,8 +1517,7 @@ void TCPTransport::ManageEndpoints(Timespec tTimeout)
          * EndpointExit function.  If we find this, we need to Join
          * the endpoint threads, remove the endpoint from the
          * endpoint list and delete it.  Note that we are calling
-         * the endpoint Join() to join the TX and RX threads and not
-         * the endpoint AuthJoin() to join the auth thread.
+         * the endpoint Join() to join the TX and RX threads.
          */
         if (endpointState == TCPEndpoint::EP_STOPPING) {
             m_endpointList.erase(i);
@@ -1459,6 +1533,100 @@ void TCPTransport::ManageEndpoints(Timespec tTimeout)
     m_endpointListLock.Unlock(MUTEX_CONTEXT);
 }
 
+QStatus TCPTransport::StartAuthWorker(void)
+{
+    /*
+     * Called with the m_authQueueLock held.  Stop() stops the workers under
+     * the same lock after stopping this thread, so a worker started here is
+     * either seen by Stop() or is never started at all.
+     */
+    if (IsStopping()) {
+        return ER_BUS_TRANSPORT_NOT_STARTED;
+    }
+    AuthWorker* worker = new AuthWorker(this);
+    QStatus status = worker->Start();
+    if (status != ER_OK) {
+        QCC_LogError(status, ("TCPTransport::StartAuthWorker(): Failed to start authentication worker"));
+        delete worker;
+        return status;
+    }
+    m_authWorkers.push_back(worker);
+    return ER_OK;
+}
+
+void TCPTransport::QueueAuthentication(TCPEndpoint* conn, uint32_t maxAuth)
+{
+    QCC_DbgTrace(("TCPTransport::QueueAuthentication()"));
+
+    /*
+     * By putting the connection on the m_authQueue, we are transferring
+     * responsibility for the connection to the authentication workers.  If no
+     * worker is idle to take it we start another one, up to the number of
+     * connections that may be authenticating at once.  If we can't, the
+     * connection waits for the next worker to become free.  If there is no
+     * worker at all the connection would wait forever, so we fail it instead
+     * and ManageEndpoints() scavenges it.
+     */
+    conn->SetAuthQueued();
+    m_authQueueLock.Lock(MUTEX_CONTEXT);
+    m_authQueue.push_back(conn);
+    m_authQueueEvent.SetEvent();
+    if ((m_authQueue.size() > m_authIdle) && (m_authWorkers.size() < maxAuth)) {
+        StartAuthWorker();
+    }
+    if (m_authWorkers.empty()) {
+        QCC_LogError(ER_FAIL, ("TCPTransport::QueueAuthentication(): No authentication worker to take the connection"));
+        m_authQueue.pop_back();
+        conn->SetAuthFailed();
+    }
+    m_authQueueLock.Unlock(MUTEX_CONTEXT);
+}
+
+bool TCPTransport::AdmitConnection(const IPAddress& addr, uint32_t rate, uint32_t burst)
+{
+    if (rate == 0) {
+        return true;
+    }
+
+    /*
+     * Each remote address has a token bucket holding up to burst connections
+     * which refills at rate connections per second.  Tokens are kept in
+     * thousandths so that a millisecond adds exactly rate of them.
+     */
+    uint32_t full = max(burst, static_cast<uint32_t>(1)) * 1000;
+    uint32_t now = GetTimestamp();
+
+    /*
+     * A bucket that has refilled is the same as no bucket at all, so forget
+     * those addresses before the map grows large.
+     */
+    if (m_connectionBuckets.size() >= TCP_MAX_CONNECTION_BUCKETS) {
+        map<qcc::String, ConnectionBucket>::iterator it = m_connectionBuckets.begin();
+        while (it != m_connectionBuckets.end()) {
+            if (it->second.tokens + static_cast<uint64_t>(now - it->second.lastFill) * rate >= full) {
+                m_connectionBuckets.erase(it++);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    pair<map<qcc::String, ConnectionBucket>::iterator, bool> ins = m_connectionBuckets.insert(pair<qcc::String, ConnectionBucket>(addr.ToString(), ConnectionBucket()));
+    ConnectionBucket& bucket = ins.first->second;
+    if (ins.second) {
+        bucket.tokens = full;
+    } else {
+        bucket.tokens = static_cast<uint32_t>(min(static_cast<uint64_t>(full), bucket.tokens + static_cast<uint64_t>(now - bucket.lastFill) * rate));
+    }
+    bucket.lastFill = now;
+
+    if (bucket.tokens < 1000) {
+        return false;
+    }
+    bucket.tokens -= 1000;
+    return true;
+}
+
 void* TCPTransport::Run(void* arg)
 {
     QCC_DbgTrace(("TCPTransport::Run()"));
@@ -1492,8 +1660,40 @@ void* TCPTransport::Run(void* arg)
      */
     uint32_t maxConn = config->Get("limit@max_completed_connections", ALLJOYN_MAX_COMPLETED_CONNECTIONS_TCP_DEFAULT);
 
+    /*
+     * authThreads is the number of authentication workers we start up front.
+     * More are started as needed, up to maxAuth, and all of them are kept
+     * until we stop.
+     */
+    uint32_t authThreads = config->Get("limit@auth_threads", ALLJOYN_AUTH_THREADS_TCP_DEFAULT);
+
+    /*
+     * maxRate and maxBurst limit how fast new connections can come in from a
+     * single remote address.  A connection that would exceed the rate is
+     * dropped before anything is allocated for it.  There is no limit unless
+     * one is configured.
+     */
+    uint32_t maxRate = config->Get("limit@max_connection_rate", ALLJOYN_MAX_CONNECTION_RATE_TCP_DEFAULT);
+    uint32_t maxBurst = config->Get("limit@max_connection_burst", ALLJOYN_MAX_CONNECTION_BURST_TCP_DEFAULT);
+
+    /*
+     * maxAuthPerAddr is the maximum number of incoming connections from a
+     * single remote address that can be in the process of authenticating.  If
+     * it is configured it is kept well below maxAuth so that one address
+     * can't take every slot.
+     */
+    uint32_t maxAuthPerAddr = config->Get("limit@max_incomplete_connections_per_address", ALLJOYN_MAX_INCOMPLETE_CONNECTIONS_PER_ADDRESS_TCP_DEFAULT);
+    if (maxAuthPerAddr) {
+        maxAuthPerAddr = min(maxAuthPerAddr, max(maxAuth / 2, static_cast<uint32_t>(1)));
+    }
+
     QStatus status = ER_OK;
 
+    m_authQueueLock.Lock(MUTEX_CONTEXT);
+    while ((m_authWorkers.size() < min(authThreads, maxAuth)) && (StartAuthWorker() == ER_OK)) {
+    }
+    m_authQueueLock.Unlock(MUTEX_CONTEXT);
+
     while (!IsStopping()) {
 
         /*
@@ -1528,38 +1728,81 @@ void* TCPTransport::Run(void* arg)
         }
         m_listenFdsLock.Unlock(MUTEX_CONTEXT);
 
+        /*
+         * We also wait on the SocketFds of the connections we have accepted
+         * but whose first byte has not arrived.  A connection is only handed
+         * to an authentication worker once there is something to read, so a
+         * client that connects and then sits there never ties up a worker.
+         * Only this thread changes the state of, or deletes, an endpoint in
+         * the AUTH_INITIALIZED state.  While any connection is authenticating
+         * we wake up periodically to scavenge the ones that take too long.
+         */
+        map<Event*, TCPEndpoint*> pendingEvents;
+        m_endpointListLock.Lock(MUTEX_CONTEXT);
+        for (set<TCPEndpoint*>::iterator i = m_authList.begin(); i != m_authList.end(); ++i) {
+            if ((*i)->GetAuthState() == TCPEndpoint::AUTH_INITIALIZED) {
+                Event* event = new Event((*i)->GetSocketFd(), Event::IO_READ, false);
+                checkEvents.push_back(event);
+                pendingEvents[event] = *i;
+            }
+        }
+        uint32_t waitMs = Event::WAIT_FOREVER;
+        if (!m_authList.empty()) {
+            waitMs = TCP_AUTH_SCAVENGE_INTERVAL;
+        }
+        m_endpointListLock.Unlock(MUTEX_CONTEXT);
+
         /*
          * We have our list of events, so now wait for something to happen
          * on that list (or get alerted).
          */
         signaledEvents.clear();
 
-        status = Event::Wait(checkEvents, signaledEvents);
+        status = Event::Wait(checkEvents, signaledEvents, waitMs);
+        if (ER_TIMEOUT == status) {
+            status = ER_OK;
+        }
         if (ER_OK != status) {
             QCC_LogError(status, ("Event::Wait failed"));
             break;
         }
 
         /*
-         * We're back from our Wait() so one of three things has happened.  Our
-         * thread has been asked to Stop(), our thread has been Alert()ed, or
-         * one of the socketFds we are listening on for connecte events has
-         * becomed signalled.
+         * Hand the connections whose first byte has arrived to the
+         * authentication workers.  A connection that has been closed by the
+         * other side is readable too; the worker will fail it right away.
+         */
+        for (vector<Event*>::iterator i = signaledEvents.begin(); i != signaledEvents.end(); ++i) {
+            map<Event*, TCPEndpoint*>::iterator pending = pendingEvents.find(*i);
+            if (pending != pendingEvents.end()) {
+                QueueAuthentication(pending->second, maxAuth);
+            }
+        }
+
+        /*
+         * In order to rationalize management of resources, we manage the
+         * various lists in one place on one thread.  This thread is a
+         * convenient victim, so we do it here.  The authentication workers
+         * Alert() us when they are done with a connection so failed
+         * connections are scavenged promptly.
+         */
+        ManageEndpoints(tTimeout);
+
+        /*
+         * We're back from our Wait() so one of four things has happened.  Our
+         * thread has been asked to Stop(), our thread has been Alert()ed, one
+         * of the connections waiting for its first byte has become readable
+         * (handled above) or one of the socketFds we are listening on for
+         * connect events has becomed signalled.
          *
          * If we have been asked to Stop(), or our thread has been Alert()ed,
          * the stopEvent will be on the list of signalled events.  The
          * difference can be found by a call to IsStopping() which is found
          * above.  An alert means that a request to start or stop listening
-         * on a given address and port has been queued up for us.
+         * on a given address and port has been queued up for us, or that an
+         * authentication worker is done with a connection.
          */
         for (vector<Event*>::iterator i = signaledEvents.begin(); i != signaledEvents.end(); ++i) {
-            /*
-             * In order to rationalize management of resources, we manage the
-             * various lists in one place on one thread.  This thread is a
-             * convenient victim, so we do it here.
-             */
-            ManageEndpoints(tTimeout);
-
             /*
              * Reset an existing Alert() or Stop().  If it's an alert, we
              * will deal with looking for the incoming listen requests at
@@ -1571,6 +1814,10 @@ void* TCPTransport::Run(void* arg)
                 continue;
             }
 
+            if (pendingEvents.find(*i) != pendingEvents.end()) {
+                continue;
+            }
+
             /*
              * Since the current event is not the stop event, it must reflect at
              * least one of the SocketFds we are waiting on for incoming
@@ -1595,11 +1842,45 @@ void* TCPTransport::Run(void* arg)
                 QCC_DbgPrintf(("TCPTransport::Run(): mEndpointList.size() == %d", m_endpointList.size()));
                 assert(m_authList.size() + m_endpointList.size() <= maxConn);
 
+                /*
+                 * Is this address connecting too fast?  If so, drop the
+                 * connection before it costs us anything more.
+                 */
+                if (!AdmitConnection(remoteAddr, maxRate, maxBurst)) {
+                    qcc::Shutdown(newSock);
+                    qcc::Close(newSock);
+                    status = ER_AUTH_FAIL;
+                    QCC_DbgPrintf(("TCPTransport::Run(): Connection rate from %s exceeded", remoteAddr.ToString().c_str()));
+                    continue;
+                }
+
+                /*
+                 * Is this address already authenticating as many connections
+                 * as it may?  Like the rate limit above this is what a flood
+                 * looks like, so it is not worth an error per connection.
+                 */
+                m_endpointListLock.Lock(MUTEX_CONTEXT);
+                if (maxAuthPerAddr) {
+                    uint32_t fromAddr = 0;
+                    for (set<TCPEndpoint*>::iterator j = m_authList.begin(); j != m_authList.end(); ++j) {
+                        if ((*j)->GetIPAddress() == remoteAddr) {
+                            ++fromAddr;
+                        }
+                    }
+                    if (fromAddr >= maxAuthPerAddr) {
+                        m_endpointListLock.Unlock(MUTEX_CONTEXT);
+                        qcc::Shutdown(newSock);
+                        qcc::Close(newSock);
+                        status = ER_AUTH_FAIL;
+                        QCC_DbgPrintf(("TCPTransport::Run(): Too many authenticating connections from %s", remoteAddr.ToString().c_str()));
+                        continue;
+                    }
+                }
+
                 /*
                  * Do we have a slot available for a new connection?  If so, use
                  * it.
                  */
-                m_endpointListLock.Lock(MUTEX_CONTEXT);
                 if ((m_authList.size() < maxAuth) && (m_authList.size() + m_endpointList.size() < maxConn)) {
                     TCPEndpoint* conn = new TCPEndpoint(this, m_bus, true, "", newSock, remoteAddr, remotePort);
                     conn->SetPassive();
@@ -1607,21 +1888,12 @@ void* TCPTransport::Run(void* arg)
                     GetTimeNow(&tNow);
                     conn->SetStartTime(tNow);
                     /*
-                     * By putting the connection on the m_authList, we are
-                     * transferring responsibility for the connection to the
-                     * Authentication thread.  Therefore, we must check that the
-                     * thread actually started running to ensure the handoff
-                     * worked.  If it didn't we need to deal with the connection
-                     * here.  Since there are no threads running we can just
-                     * pitch the connection.
+                     * The connection waits on the m_authList in the
+                     * AUTH_INITIALIZED state until its first byte arrives.  The
+                     * next time through the loop we start waiting on its
+                     * SocketFd and then queue it for an authentication worker.
                      */
-                    std::pair<std::set<TCPEndpoint*>::iterator, bool> ins = m_authList.insert(conn);
-                    status = conn->Authenticate();
-                    if (status != ER_OK) {
-                        m_authList.erase(ins.first);
-                        delete conn;
-                    }
-                    conn = NULL;
+                    m_authList.insert(conn);
                     m_endpointListLock.Unlock(MUTEX_CONTEXT);
                 } else {
                     m_endpointListLock.Unlock(MUTEX_CONTEXT);
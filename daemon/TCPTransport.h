@@ -27,12 +27,17 @@
 #error Only include TCPTransport.h in C++ code.
 #endif
 
+#include <deque>
 #include <list>
+#include <map>
 #include <queue>
+#include <vector>
 #include <Status.h>
 
 #include <qcc/platform.h>
 #include <qcc/String.h>
+#include <qcc/Event.h>
+#include <qcc/IPAddress.h>
 #include <qcc/Mutex.h>
 #include <qcc/Thread.h>
 #include <qcc/Socket.h>
@@ -293,6 +298,42 @@ class TCPTransport : public Transport, public RemoteEndpoint::EndpointListener,
     std::set<Thread*> m_activeEndpointsThreadList;                 /**< List of threads starting up active endpoints */
     qcc::Mutex m_endpointListLock;                                 /**< Mutex that protects the endpoint and auth lists */
 
+    /**
+     * @internal
+     * @brief A thread that authenticates incoming connections.
+     *
+     * The workers take connections that are ready to authenticate off of
+     * m_authQueue.  They are started by the server accept loop as they are
+     * needed, up to the limit on authenticating connections, and then live as
+     * long as the server accept loop does.
+     */
+    class AuthWorker : public qcc::Thread {
+      public:
+        AuthWorker(TCPTransport* transport) : qcc::Thread("auth"), m_transport(transport) { }
+      private:
+        virtual qcc::ThreadReturn STDCALL Run(void* arg);
+
+        TCPTransport* m_transport;
+    };
+
+    std::vector<AuthWorker*> m_authWorkers;                        /**< The authentication workers */
+    std::deque<TCPEndpoint*> m_authQueue;                          /**< Endpoints on m_authList waiting for a worker */
+    uint32_t m_authIdle;                                           /**< Number of workers waiting for a connection */
+    qcc::Event m_authQueueEvent;                                   /**< Set when an endpoint is put on m_authQueue */
+    qcc::Mutex m_authQueueLock;                                    /**< Mutex that protects the auth queue and workers */
+
+    /**
+     * @internal
+     * @brief Token bucket limiting the rate of new connections from one
+     * remote address.
+     */
+    struct ConnectionBucket {
+        uint32_t tokens;     /**< New connections allowed, in thousandths */
+        uint32_t lastFill;   /**< Timestamp in milliseconds of the last refill */
+    };
+
+    std::map<qcc::String, ConnectionBucket> m_connectionBuckets;  /**< Buckets by remote address, only used by the server accept loop */
+
     std::list<std::pair<qcc::String, qcc::SocketFd> > m_listenFds; /**< File descriptors the transport is listening on */
     qcc::Mutex m_listenFdsLock;                                    /**< Mutex that protects m_listenFds */
 
@@ -338,6 +379,37 @@ class TCPTransport : public Transport, public RemoteEndpoint::EndpointListener,
      */
     void ManageEndpoints(qcc::Timespec tTimeout);
 
+    /**
+     * @internal
+     * @brief Queue an endpoint whose first byte has arrived for an
+     * authentication worker, starting a new worker if none is idle.
+     *
+     * @param conn      The endpoint, which must be on the m_authList.
+     * @param maxAuth   The maximum number of authenticating connections.
+     */
+    void QueueAuthentication(TCPEndpoint* conn, uint32_t maxAuth);
+
+    /**
+     * @internal
+     * @brief Start another authentication worker.  Must be called with the
+     * m_authQueueLock held.
+     *
+     * @return ER_OK if the worker was started.
+     */
+    QStatus StartAuthWorker(void);
+
+    /**
+     * @internal
+     * @brief Check the rate of new connections from a remote address.
+     *
+     * @param addr    The remote address of the new connection.
+     * @param rate    New connections allowed per second, 0 for no limit.
+     * @param burst   New connections allowed at once.
+     *
+     * @return true if the connection may be accepted.
+     */
+    bool AdmitConnection(const qcc::IPAddress& addr, uint32_t rate, uint32_t burst);
+
     /**
      * @internal
      * @brief Thread entry point.
@@ -517,6 +589,52 @@ class TCPTransport : public Transport, public RemoteEndpoint::EndpointListener,
      */
     static const uint32_t ALLJOYN_MAX_COMPLETED_CONNECTIONS_TCP_DEFAULT = 50;
 
+    /**
+     * @brief The default number of authentication workers started with the
+     * transport.
+     *
+     * Incoming connections are authenticated by a pool of workers rather than
+     * a thread per connection.  This many workers are kept from the start and
+     * more are started when none is idle, up to the maximum number of
+     * authenticating connections.  To override this value, change the limit,
+     * "auth_threads".
+     */
+    static const uint32_t ALLJOYN_AUTH_THREADS_TCP_DEFAULT = 2;
+
+    /**
+     * @brief The default value for the maximum rate of new connections from
+     * one remote address, in connections per second.
+     *
+     * A client that reconnects in a tight loop can crowd out everyone else, so
+     * each remote address may be given a token bucket by setting the limit,
+     * "max_connection_rate".  The default of zero turns the limit off.
+     */
+    static const uint32_t ALLJOYN_MAX_CONNECTION_RATE_TCP_DEFAULT = 0;
+
+    /**
+     * @brief The default value for the number of new connections one remote
+     * address may make at once before the connection rate applies.
+     *
+     * To override this value, change the limit, "max_connection_burst".  It
+     * only applies if "max_connection_rate" is set.  The burst only limits how
+     * fast connections come in; how many of them may be authenticating at once
+     * is limited separately below.
+     */
+    static const uint32_t ALLJOYN_MAX_CONNECTION_BURST_TCP_DEFAULT = 8;
+
+    /**
+     * @brief The default value for the maximum number of authenticating
+     * connections from one remote address.
+     *
+     * Without this limit a single address can hold every authenticating slot,
+     * and every authentication worker, by opening connections and stalling
+     * them.  To set a limit, change the limit,
+     * "max_incomplete_connections_per_address".  The default of zero turns the
+     * limit off.  A limit is always kept to at most half of the maximum number
+     * of authenticating connections.
+     */
+    static const uint32_t ALLJOYN_MAX_INCOMPLETE_CONNECTIONS_PER_ADDRESS_TCP_DEFAULT = 0;
+
     /*
      * The Android Compatibility Test Suite (CTS) is used by Google to enforce a
      * common idea of what it means to be Android.  One of their tests is to
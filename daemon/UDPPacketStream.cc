@@ -23,6 +23,10 @@
 #include <qcc/Util.h>
 #include <errno.h>
 #include <assert.h>
+#include <string.h>
+#if defined(QCC_OS_LINUX)
+#include <sys/socket.h>
+#endif
 
 #include <qcc/Event.h>
 #include <qcc/Debug.h>
@@ -35,8 +39,18 @@
 using namespace std;
 using namespace qcc;
 
+#if defined(QCC_OS_LINUX)
+namespace qcc {
+extern QStatus MakeSockAddr(const IPAddress& addr, uint16_t port, struct sockaddr_storage* addrBuf, socklen_t& addrSize);
+extern QStatus GetSockAddr(const sockaddr_storage* addrBuf, socklen_t addrSize, IPAddress& addr, uint16_t& port);
+}
+#endif
+
 namespace ajn {
 
+/* Max number of datagrams moved by a single recvmmsg or sendmmsg call */
+static const size_t MAX_MMSG_BATCH = 32;
+
 UDPPacketStream::UDPPacketStream(const char* ifaceName, uint16_t port) :
     ipAddr(),
     port(port),
@@ -200,6 +214,134 @@ QStatus UDPPacketStream::PullPacketBytes(void* buf, size_t reqBytes, size_t& act
     return status;
 }
 
+QStatus UDPPacketStream::PullPacketBatch(PacketBuffer* bufs, size_t numBufs, size_t& numPulled, uint32_t timeout)
+{
+    numPulled = 0;
+    /* The socket is non-blocking, wait for the first packet unless the caller already knows it is there */
+    if (timeout != 0) {
+        QStatus status = Event::Wait(*sourceEvent, timeout);
+        if (status != ER_OK) {
+            return status;
+        }
+    }
+    return RecvBatch(sock, bufs, numBufs, numPulled);
+}
+
+QStatus UDPPacketStream::PushPacketBatch(PacketBuffer* bufs, size_t numBufs, size_t& numPushed)
+{
+    return SendBatch(sock, bufs, numBufs, numPushed);
+}
+
+QStatus UDPPacketStream::RecvBatch(SocketFd sock, PacketBuffer* bufs, size_t numBufs, size_t& numRecvd)
+{
+    QStatus status = ER_OK;
+    numRecvd = 0;
+#if defined(QCC_OS_LINUX)
+    struct mmsghdr msgs[MAX_MMSG_BATCH];
+    struct iovec iovs[MAX_MMSG_BATCH];
+    struct sockaddr_storage addrs[MAX_MMSG_BATCH];
+    size_t cnt = min(numBufs, MAX_MMSG_BATCH);
+
+    for (size_t i = 0; i < cnt; ++i) {
+        iovs[i].iov_base = bufs[i].buf;
+        iovs[i].iov_len = bufs[i].len;
+        memset(&msgs[i].msg_hdr, 0, sizeof(msgs[i].msg_hdr));
+        msgs[i].msg_hdr.msg_name = &addrs[i];
+        msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_len = 0;
+    }
+    int ret = recvmmsg(static_cast<int>(sock), msgs, cnt, MSG_DONTWAIT, NULL);
+    if (ret < 0) {
+        status = ((errno == EAGAIN) || (errno == EWOULDBLOCK)) ? ER_WOULDBLOCK : ER_OS_ERROR;
+        if (status == ER_OS_ERROR) {
+            QCC_LogError(status, ("recvmmsg failed: %s", ::strerror(errno)));
+        }
+    } else {
+        for (int i = 0; i < ret; ++i) {
+            IPAddress ipAddr;
+            uint16_t port = 0;
+            GetSockAddr(&addrs[i], msgs[i].msg_hdr.msg_namelen, ipAddr, port);
+            ipAddr.RenderIPBinary(bufs[i].dest.ip, IPAddress::IPv6_SIZE);
+            bufs[i].dest.addrSize = ipAddr.Size();
+            bufs[i].dest.port = port;
+            bufs[i].len = msgs[i].msg_len;
+        }
+        numRecvd = static_cast<size_t>(ret);
+    }
+#else
+    /* Without recvmmsg only the datagram that signaled the source event is known to be available */
+    IPAddress ipAddr;
+    uint16_t port = 0;
+    size_t actualBytes = 0;
+    status = qcc::RecvFrom(sock, ipAddr, port, bufs[0].buf, bufs[0].len, actualBytes);
+    if (status == ER_OK) {
+        ipAddr.RenderIPBinary(bufs[0].dest.ip, IPAddress::IPv6_SIZE);
+        bufs[0].dest.addrSize = ipAddr.Size();
+        bufs[0].dest.port = port;
+        bufs[0].len = actualBytes;
+        numRecvd = 1;
+    } else if (status != ER_WOULDBLOCK) {
+        QCC_LogError(status, ("recvfrom failed: %s", ::strerror(errno)));
+    }
+#endif
+    return status;
+}
+
+QStatus UDPPacketStream::SendBatch(SocketFd sock, PacketBuffer* bufs, size_t numBufs, size_t& numSent)
+{
+    QStatus status = ER_OK;
+    numSent = 0;
+#if defined(QCC_OS_LINUX)
+    struct mmsghdr msgs[MAX_MMSG_BATCH];
+    struct iovec iovs[MAX_MMSG_BATCH];
+    struct sockaddr_storage addrs[MAX_MMSG_BATCH];
+
+    while ((status == ER_OK) && (numSent < numBufs)) {
+        size_t cnt = min(numBufs - numSent, MAX_MMSG_BATCH);
+        for (size_t i = 0; (status == ER_OK) && (i < cnt); ++i) {
+            PacketBuffer& b = bufs[numSent + i];
+            socklen_t addrLen = sizeof(addrs[i]);
+            status = MakeSockAddr(IPAddress(b.dest.ip, b.dest.addrSize), b.dest.port, &addrs[i], addrLen);
+            iovs[i].iov_base = b.buf;
+            iovs[i].iov_len = b.len;
+            memset(&msgs[i].msg_hdr, 0, sizeof(msgs[i].msg_hdr));
+            msgs[i].msg_hdr.msg_name = &addrs[i];
+            msgs[i].msg_hdr.msg_namelen = addrLen;
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_len = 0;
+        }
+        if (status == ER_OK) {
+            int ret = sendmmsg(static_cast<int>(sock), msgs, cnt, MSG_NOSIGNAL);
+            if (ret <= 0) {
+                status = ER_OS_ERROR;
+                QCC_LogError(status, ("sendmmsg failed: %s (%d)", ::strerror(errno), errno));
+            } else {
+                /* A datagram is either sent whole or not at all */
+                numSent += static_cast<size_t>(ret);
+            }
+        }
+    }
+#else
+    while ((status == ER_OK) && (numSent < numBufs)) {
+        PacketBuffer& b = bufs[numSent];
+        IPAddress ipAddr(b.dest.ip, b.dest.addrSize);
+        size_t sent = 0;
+        status = qcc::SendTo(sock, ipAddr, b.dest.port, b.buf, b.len, sent);
+        if ((status == ER_OK) && (sent != b.len)) {
+            status = ER_OS_ERROR;
+            QCC_LogError(status, ("Short udp send: exp=%d, act=%d", b.len, sent));
+        }
+        if (status == ER_OK) {
+            ++numSent;
+        }
+    }
+#endif
+    return status;
+}
+
 String UDPPacketStream::ToString(const PacketDest& dest) const
 {
     IPAddress ipAddr(dest.ip, dest.addrSize);
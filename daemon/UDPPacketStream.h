@@ -86,6 +86,17 @@ class UDPPacketStream : public PacketStream {
      */
     QStatus PullPacketBytes(void* buf, size_t reqBytes, size_t& actualBytes, PacketDest& sender, uint32_t timeout = qcc::Event::WAIT_FOREVER);
 
+    /**
+     * Pull up to numBufs packets from the source using a single system call where supported.
+     *
+     * @param bufs       Packet buffers to fill. On return bufs[0..numPulled) hold the pulled packets.
+     * @param numBufs    Number of entries in bufs.
+     * @param numPulled  Number of packets pulled.
+     * @param timeout    Time to wait for the first packet, 0 to only pull packets that are already available.
+     * @return   ER_OK if at least one packet was pulled, ER_TIMEOUT or ER_WOULDBLOCK if there was none. Otherwise an error.
+     */
+    QStatus PullPacketBatch(PacketBuffer* bufs, size_t numBufs, size_t& numPulled, uint32_t timeout = qcc::Event::WAIT_FOREVER);
+
     /**
      * Get the Event indicating that data is available when signaled.
      *
@@ -109,6 +120,16 @@ class UDPPacketStream : public PacketStream {
      */
     QStatus PushPacketBytes(const void* buf, size_t numBytes, PacketDest& dest);
 
+    /**
+     * Push a batch of packets into the sink using a single system call where supported.
+     *
+     * @param bufs       Packets to push.
+     * @param numBufs    Number of entries in bufs.
+     * @param numPushed  Number of packets (starting from bufs[0]) that were pushed.
+     * @return   ER_OK if all packets were pushed.
+     */
+    QStatus PushPacketBatch(PacketBuffer* bufs, size_t numBufs, size_t& numPushed);
+
     /**
      * Get the Event that indicates when data can be pushed to sink.
      *
@@ -128,6 +149,30 @@ class UDPPacketStream : public PacketStream {
      */
     qcc::String ToString(const PacketDest& dest) const;
 
+    /**
+     * Receive up to numBufs datagrams from a non-blocking UDP socket.
+     * Uses recvmmsg where available. Otherwise a single datagram is received.
+     *
+     * @param sock       Socket to receive from.
+     * @param bufs       Packet buffers to fill.
+     * @param numBufs    Number of entries in bufs.
+     * @param numRecvd   Number of datagrams received.
+     * @return   ER_OK if at least one datagram was received.
+     */
+    static QStatus RecvBatch(qcc::SocketFd sock, PacketBuffer* bufs, size_t numBufs, size_t& numRecvd);
+
+    /**
+     * Send a batch of datagrams on a UDP socket.
+     * Uses sendmmsg where available. Otherwise the datagrams are sent one at a time.
+     *
+     * @param sock       Socket to send on.
+     * @param bufs       Datagrams to send.
+     * @param numBufs    Number of entries in bufs.
+     * @param numSent    Number of datagrams sent.
+     * @return   ER_OK if all datagrams were sent.
+     */
+    static QStatus SendBatch(qcc::SocketFd sock, PacketBuffer* bufs, size_t numBufs, size_t& numSent);
+
   private:
 
     UDPPacketStream(const UDPPacketStream& other);
@@ -369,6 +369,8 @@ DiscoveryManager::~DiscoveryManager()
         LastOnDemandMessageSent = NULL;
     }
 
+    ClearPipelinedOnDemandMessages();
+
     ClearOutboundMessageQueue();
 
     DiscoveryManagerState = IMPL_SHUTDOWN;
@@ -388,6 +390,7 @@ void DiscoveryManager::Disconnect(void)
         delete LastOnDemandMessageSent;
         LastOnDemandMessageSent = NULL;
     }
+    ClearPipelinedOnDemandMessages();
 
     /* Send LostAdvertisedName for all discovered services because we'll ensure to send a Search
      * Message again on a re-connect and get the latest set of advertisements. Also delete all
@@ -1121,7 +1124,9 @@ void* DiscoveryManager::Run(void* arg)
                 QCC_DbgPrintf(("DiscoveryManager::Run(): OutboundMessageQueue.size()=%d currentAdvertiseList.empty()=%d currentSearchList.empty()=%d\n",
                                OutboundMessageQueue.size(), currentAdvertiseList.empty(), currentSearchList.empty()));
 
-                if (ForceInterfaceUpdateFlag || (!Connection)) {
+                /* Also set up again a connection that the Server has closed after a response */
+                if (ForceInterfaceUpdateFlag || (!Connection) ||
+                    (!Connection->IsOnDemandConnUp()) || (!Connection->IsPersistentConnUp())) {
 
                     QCC_DbgPrintf(("DiscoveryManager::Run(): ForceInterfaceUpdateFlag(%d)\n", ForceInterfaceUpdateFlag));
 
@@ -1161,6 +1166,9 @@ void* DiscoveryManager::Run(void* arg)
                          * and add it to checkEvents */
                         if (Connection->GetOnDemandConnectionChanged()) {
 
+                            /* Messages that were pipelined on the old connection will not be answered, send them again */
+                            RequeueUnansweredOnDemandMessages();
+
                             if (LastOnDemandMessageSent) {
                                 delete LastOnDemandMessageSent;
                                 LastOnDemandMessageSent = NULL;
@@ -1449,6 +1457,31 @@ void* DiscoveryManager::Run(void* arg)
                             }
                         }
                     }
+
+                    /* Send the queued messages that can follow the ones awaiting a response on the On Demand connection */
+                    if ((Connection) && (SentMessageOverOnDemandConnection)) {
+
+                        status = PipelineOutboundMessages();
+
+                        if (status != ER_OK) {
+                            QCC_DbgPrintf(("DiscoveryManager::Run(): PipelineOutboundMessages was unsuccessful"));
+
+                            /* Disconnect from the Server */
+                            Disconnect();
+
+#ifdef ENABLE_PROXIMITY_FRAMEWORK
+                            /* Release and acquire back the DiscoveryManagerMutex before call to StopScan
+                             * to ensure that there is no deadlock between the ProximityScanEngine
+                             * and DiscoveryManager*/
+                            DiscoveryManagerMutex.Unlock(MUTEX_CONTEXT);
+                            if (ProximityScanner) {
+                                /* Stop the proximity scan before start to rule out any race conditions */
+                                ProximityScanner->StopScan();
+                            }
+                            DiscoveryManagerMutex.Lock(MUTEX_CONTEXT);
+#endif
+                        }
+                    }
                 }
             }
 
@@ -1802,12 +1835,17 @@ QStatus DiscoveryManager::SendMessage(InterfaceMessage& message)
                      * the message that was just sent and also update the appropriate time stamp to indicate when
                      * a message was sent to the Server*/
                     if (!sendMessageOverPersistentConnection) {
-                        if (LastOnDemandMessageSent) {
-                            delete LastOnDemandMessageSent;
+                        if (SentMessageOverOnDemandConnection) {
+                            /* The message has been pipelined behind LastOnDemandMessageSent */
+                            PipelinedOnDemandMessages.push_back(message.Clone());
+                        } else {
+                            if (LastOnDemandMessageSent) {
+                                delete LastOnDemandMessageSent;
+                            }
+                            LastOnDemandMessageSent = message.Clone();
+                            OnDemandMessageSentTimeStamp = GetTimestamp();
+                            SentMessageOverOnDemandConnection = true;
                         }
-                        LastOnDemandMessageSent = message.Clone();
-                        OnDemandMessageSentTimeStamp = GetTimestamp();
-                        SentMessageOverOnDemandConnection = true;
                     } else {
                         PersistentMessageSentTimeStamp = GetTimestamp();
                     }
@@ -1833,6 +1871,89 @@ QStatus DiscoveryManager::SendMessage(InterfaceMessage& message)
     return status;
 }
 
+bool DiscoveryManager::IsPipelinable(const InterfaceMessage& message)
+{
+    /* The responses to the Client Login, Token Refresh and Daemon Registration messages change the state
+     * the following messages are sent with. The GET messages go over the Persistent connection */
+    switch (message.messageType) {
+    case ADVERTISEMENT:
+    case SEARCH:
+    case ADDRESS_CANDIDATES:
+    case PROXIMITY:
+    case RENDEZVOUS_SESSION_DELETE:
+        return (message.httpMethod != HttpConnection::METHOD_GET);
+
+    default:
+        return false;
+    }
+}
+
+QStatus DiscoveryManager::PipelineOutboundMessages(void)
+{
+    QStatus status = ER_OK;
+
+    /* Only the messages from the OutboundMessageQueue are pipelined. The client login, daemon registration and the
+     * update sequence each wait for the response to the previous message */
+    if ((PeerID.empty()) || (ClientAuthenticationRequiredFlag) || (RegisterDaemonWithServer) || (UpdateInformationOnServerFlag)) {
+        return status;
+    }
+
+    if (!LastOnDemandMessageSent || !IsPipelinable(*LastOnDemandMessageSent)) {
+        return status;
+    }
+
+    while ((status == ER_OK) && (OutboundMessageQueue.size()) && (Connection->CanPipelineOnDemandMessage())) {
+
+        InterfaceMessage* message = OutboundMessageQueue.front();
+
+        if (message->messageType == INVALID_MESSAGE) {
+            OutboundMessageQueue.pop_front();
+            delete message;
+            continue;
+        }
+
+        if (!IsPipelinable(*message)) {
+            break;
+        }
+
+        QCC_DbgPrintf(("DiscoveryManager::PipelineOutboundMessages(): Pipelining %s message behind %d others\n",
+                       PrintMessageType(message->messageType).c_str(), PipelinedOnDemandMessages.size() + 1));
+
+        status = SendMessage(*message);
+
+        if (status == ER_OK) {
+            OutboundMessageQueue.pop_front();
+            delete message;
+        }
+    }
+
+    return status;
+}
+
+void DiscoveryManager::RequeueUnansweredOnDemandMessages(void)
+{
+    QCC_DbgPrintf(("DiscoveryManager::RequeueUnansweredOnDemandMessages(): %d pipelined messages", PipelinedOnDemandMessages.size()));
+
+    while (!PipelinedOnDemandMessages.empty()) {
+        OutboundMessageQueue.push_front(PipelinedOnDemandMessages.back());
+        PipelinedOnDemandMessages.pop_back();
+    }
+
+    /* The Client Login and Token Refresh messages are not queued, they are sent again by Run() */
+    if (SentMessageOverOnDemandConnection && LastOnDemandMessageSent && IsPipelinable(*LastOnDemandMessageSent)) {
+        OutboundMessageQueue.push_front(LastOnDemandMessageSent);
+        LastOnDemandMessageSent = NULL;
+    }
+}
+
+void DiscoveryManager::ClearPipelinedOnDemandMessages(void)
+{
+    while (!PipelinedOnDemandMessages.empty()) {
+        delete PipelinedOnDemandMessages.front();
+        PipelinedOnDemandMessages.pop_front();
+    }
+}
+
 QStatus DiscoveryManager::HandleSearchMatchResponse(SearchMatchResponse response)
 {
     QCC_DbgPrintf(("DiscoveryManager::HandleSearchMatchResponse(): Trying to invoke found callback for service %s on Daemon with GUID %s which is a response to the search %s\n",
@@ -2188,7 +2309,7 @@ QStatus DiscoveryManager::HandleAddressCandidatesResponse(AddressCandidatesRespo
     return status;
 }
 
-QStatus DiscoveryManager::HandlePersistentMessageResponse(Json::Value payload)
+QStatus DiscoveryManager::HandlePersistentMessageResponse(const Json::ArenaValue& payload)
 {
     QCC_DbgPrintf(("DiscoveryManager::HandlePersistentMessageResponse()\n"));
     QStatus status = ER_OK;
@@ -2314,7 +2435,7 @@ void DiscoveryManager::HandlePersistentConnectionResponse(HttpConnection::HTTPRe
         /* Handle the response */
         if (response.payloadPresent) {
 
-            status = HandlePersistentMessageResponse(response.payload);
+            status = HandlePersistentMessageResponse(*response.payload);
 
             if (status != ER_OK) {
                 Disconnect();
@@ -2565,7 +2686,7 @@ QStatus DiscoveryManager::UpdateInformationOnServer(MessageType messageType, boo
     return status;
 }
 
-QStatus DiscoveryManager::HandleOnDemandMessageResponse(Json::Value payload)
+QStatus DiscoveryManager::HandleOnDemandMessageResponse(const Json::ArenaValue& payload)
 {
     QStatus status = ER_OK;
 
@@ -2646,7 +2767,7 @@ void DiscoveryManager::HandleOnDemandConnectionResponse(HttpConnection::HTTPResp
 
             /* If the sent message was the the Client Login message, handle it accordingly */
             if (LastOnDemandMessageSent && (LastOnDemandMessageSent->messageType == CLIENT_LOGIN)) {
-                status = HandleClientLoginResponse(response.payload);
+                status = HandleClientLoginResponse(*response.payload);
 
                 if (status != ER_OK) {
                     Disconnect();
@@ -2659,7 +2780,7 @@ void DiscoveryManager::HandleOnDemandConnectionResponse(HttpConnection::HTTPResp
 #endif
                 }
             } else if (LastOnDemandMessageSent && (LastOnDemandMessageSent->messageType == TOKEN_REFRESH)) {
-                status = HandleTokenRefreshResponse(response.payload);
+                status = HandleTokenRefreshResponse(*response.payload);
 
                 if (status != ER_OK) {
                     Disconnect();
@@ -2673,7 +2794,7 @@ void DiscoveryManager::HandleOnDemandConnectionResponse(HttpConnection::HTTPResp
                 }
             } else {
 
-                status = HandleOnDemandMessageResponse(response.payload);
+                status = HandleOnDemandMessageResponse(*response.payload);
 
                 if (status != ER_OK) {
                     Disconnect();
@@ -2746,8 +2867,18 @@ void DiscoveryManager::HandleOnDemandConnectionResponse(HttpConnection::HTTPResp
 #endif
     }
 
-    /* Reset SentMessageOverOnDemandConnection to indicate that we received a response */
-    SentMessageOverOnDemandConnection = false;
+    if (!PipelinedOnDemandMessages.empty()) {
+        /* The next response answers the oldest pipelined message */
+        if (LastOnDemandMessageSent) {
+            delete LastOnDemandMessageSent;
+        }
+        LastOnDemandMessageSent = PipelinedOnDemandMessages.front();
+        PipelinedOnDemandMessages.pop_front();
+        OnDemandMessageSentTimeStamp = GetTimestamp();
+    } else {
+        /* Reset SentMessageOverOnDemandConnection to indicate that we received a response */
+        SentMessageOverOnDemandConnection = false;
+    }
 }
 
 QStatus DiscoveryManager::SendClientLoginFirstRequest(void)
@@ -2897,7 +3028,7 @@ void DiscoveryManager::HandleSuccessfulClientAuthentication(ClientLoginFinalResp
     SetTKeepAlive(response.configData.Tkeepalive);
 }
 
-QStatus DiscoveryManager::HandleClientLoginResponse(Json::Value payload)
+QStatus DiscoveryManager::HandleClientLoginResponse(const Json::ArenaValue& payload)
 {
     QStatus status = ER_OK;
 
@@ -2965,7 +3096,7 @@ QStatus DiscoveryManager::HandleClientLoginResponse(Json::Value payload)
     return status;
 }
 
-QStatus DiscoveryManager::HandleTokenRefreshResponse(Json::Value payload)
+QStatus DiscoveryManager::HandleTokenRefreshResponse(const Json::ArenaValue& payload)
 {
     QStatus status = ER_OK;
 
@@ -405,7 +405,7 @@ class DiscoveryManager : public Thread, public AlarmListener {
      *
      * Ensure that the function invoking this function locks the DiscoveryManagerMutex.
      */
-    QStatus HandleOnDemandMessageResponse(Json::Value payload);
+    QStatus HandleOnDemandMessageResponse(const Json::ArenaValue& payload);
 
     /**
      * @internal
@@ -463,7 +463,7 @@ class DiscoveryManager : public Thread, public AlarmListener {
      *
      * Ensure that the function invoking this function locks the DiscoveryManagerMutex.
      */
-    QStatus HandleClientLoginResponse(Json::Value payload);
+    QStatus HandleClientLoginResponse(const Json::ArenaValue& payload);
 
     /**
      * @internal
@@ -471,7 +471,7 @@ class DiscoveryManager : public Thread, public AlarmListener {
      *
      * Ensure that the function invoking this function locks the DiscoveryManagerMutex.
      */
-    QStatus HandleTokenRefreshResponse(Json::Value payload);
+    QStatus HandleTokenRefreshResponse(const Json::ArenaValue& payload);
 
     /**
      * Main thread entry point.
@@ -501,6 +501,39 @@ class DiscoveryManager : public Thread, public AlarmListener {
      */
     QStatus SendMessage(InterfaceMessage& message);
 
+    /**
+     * @internal
+     * @brief Send the queued messages that may follow the ones awaiting a
+     * response on the On Demand connection without waiting for those
+     * responses.
+     *
+     * Ensure that the function invoking this function locks the DiscoveryManagerMutex.
+     *
+     * @return  ER_OK if successful.
+     */
+    QStatus PipelineOutboundMessages(void);
+
+    /**
+     * @internal
+     * @brief Returns true if a message may be sent over the On Demand connection
+     * before the response to the previous message has been received, that is if
+     * handling its response does not depend on any other response.
+     */
+    bool IsPipelinable(const InterfaceMessage& message);
+
+    /**
+     * @internal
+     * @brief Move the messages that were sent over the On Demand connection but
+     * never answered back to the front of the OutboundMessageQueue.
+     */
+    void RequeueUnansweredOnDemandMessages(void);
+
+    /**
+     * @internal
+     * @brief Delete the messages in PipelinedOnDemandMessages.
+     */
+    void ClearPipelinedOnDemandMessages(void);
+
     /**
      * @internal
      * @brief Handle the Search Match Response message.
@@ -536,7 +569,7 @@ class DiscoveryManager : public Thread, public AlarmListener {
      * @internal
      * @brief Handle the response received over the Persistent connection.
      */
-    QStatus HandlePersistentMessageResponse(Json::Value payload);
+    QStatus HandlePersistentMessageResponse(const Json::ArenaValue& payload);
 
     /**
      * @internal
@@ -1089,6 +1122,14 @@ class DiscoveryManager : public Thread, public AlarmListener {
      */
     bool SentMessageOverOnDemandConnection;
 
+    /**
+     * @internal
+     * @brief Messages sent over the On Demand connection after LastOnDemandMessageSent,
+     * oldest first, whose responses have not been received yet. The Server answers
+     * them in the order they were sent.
+     */
+    list<InterfaceMessage*> PipelinedOnDemandMessages;
+
     /**
      * @internal
      * @brief Indicates the last message type (Advertisement/Search/Proximity) that was
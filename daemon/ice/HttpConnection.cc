@@ -21,7 +21,10 @@
  *    limitations under the License.
  ******************************************************************************/
 
+#include <ctype.h>
 #include <map>
+#include <stdlib.h>
+#include <string.h>
 #include <string>
 #include <vector>
 #include <qcc/platform.h>
@@ -61,12 +64,17 @@ static String urlEncode(String str)
     return outStr;
 }
 
-static QStatus getLine(Source* source, String& str) {
-
+/*
+ * Read a line into buf without the CR LF and NUL terminate it.  The part of a
+ * line that does not fit in buf is read and dropped.
+ */
+static QStatus getLine(Source* source, char* buf, size_t bufSize, size_t& len)
+{
     char c;
     QStatus status = ER_OK;
     size_t received;
 
+    len = 0;
     while (ER_OK == status) {
         status = source->PullBytes(&c, 1, received);
         if ((ER_OK == status) && (1 == received)) {
@@ -74,15 +82,50 @@ static QStatus getLine(Source* source, String& str) {
                 continue;
             } else if ('\n' == c) {
                 break;
-            } else {
-                str.push_back(c);
+            } else if (len < (bufSize - 1)) {
+                buf[len++] = c;
             }
         }
     }
+    buf[len] = '\0';
 
     return status;
 }
 
+/*
+ * Check the name of a "name: value" header line (header names are case
+ * insensitive) and return the value with leading white space skipped.
+ */
+static const char* getHeaderValue(const char* line, const char* name)
+{
+    while (*name) {
+        if (tolower(static_cast<unsigned char>(*line++)) != tolower(static_cast<unsigned char>(*name++))) {
+            return NULL;
+        }
+    }
+    if (*line++ != ':') {
+        return NULL;
+    }
+    while ((*line == ' ') || (*line == '\t')) {
+        ++line;
+    }
+    return line;
+}
+
+/*
+ * Check whether a header value starts with the given token (tokens are case
+ * insensitive).
+ */
+static bool isToken(const char* value, const char* token)
+{
+    while (*token) {
+        if (tolower(static_cast<unsigned char>(*value++)) != tolower(static_cast<unsigned char>(*token++))) {
+            return false;
+        }
+    }
+    return (*value == '\0') || (*value == ',') || (*value == ' ') || (*value == '\t');
+}
+
 QStatus HttpResponseSource::PullBytes(void*buf, size_t reqBytes, size_t& actualBytes,  uint32_t timeout)
 {
     QStatus status = ER_NONE;
@@ -118,7 +161,6 @@ void HttpConnection::Clear(void)
     isMultipartForm = false;
     isApplicationJson = false;
     requestHeaders.clear();
-    responseHeaders.clear();
 
     /* Dump any remaining chars in response stream */
     if (stream) {
@@ -212,6 +254,9 @@ QStatus HttpConnection::Connect(SocketFd sock)
 
     /* Connect using the passed Socket */
     if (NULL == stream) {
+        keepAlive = true;
+        pendingResponses = 0;
+
         switch (protocol) {
         default:
         case PROTO_HTTP:
@@ -316,7 +361,9 @@ QStatus HttpConnection::Send(void)
         status = ER_WRITE_ERROR;
     }
 
-    if (ER_OK != status) {
+    if (ER_OK == status) {
+        ++pendingResponses;
+    } else {
         Close();
     }
 
@@ -336,43 +383,62 @@ void HttpConnection::Close()
         delete stream;
         stream = NULL;
     }
+    pendingResponses = 0;
 }
 
 QStatus HttpConnection::ParseResponse(HTTPResponse& response)
 {
     if (!stream) {
-        return ER_FAIL;
         QCC_LogError(ER_FAIL, ("HttpConnection::ParseResponse(): steam is NULL"));
+        return ER_FAIL;
     } else {
         QStatus status = ER_OK;
 
         httpSource.Reset(*stream);
 
-        /* Get HTTP response status line.*/
-        String statusLine;
-        status = getLine(stream, statusLine);
+        /*
+         * Get HTTP response status line. The status and header lines are
+         * parsed in a stack buffer; only Content-Length is of interest.
+         */
+        char line[MAX_LINE_SIZE];
+        size_t lineLen;
+        status = getLine(stream, line, sizeof(line), lineLen);
 
         if (ER_OK == status) {
-            size_t pos = statusLine.find(' ');
-            if (pos != String::npos) {
-                uint32_t s = StringToU32(statusLine.substr(pos + 1).c_str(), 10, 0);
+            /* This response answers the oldest outstanding request */
+            if (pendingResponses) {
+                --pendingResponses;
+            }
+
+            /* HTTP/1.1 connections persist unless the server says otherwise, HTTP/1.0 ones only if it asks to */
+            keepAlive = (strncmp(line, "HTTP/1.0", 8) != 0);
+
+            const char* pos = strchr(line, ' ');
+            if (pos != NULL) {
+                uint32_t s = strtoul(pos + 1, NULL, 10);
                 status = CheckHTTPResponseStatus(httpStatus, s);
                 if (ER_OK != status) {
                     QCC_LogError(status, ("HttpConnection::ParseResponse(): Unrecognized HTTP Status code received in response"));
                 } else {
                     response.statusCode = httpStatus;
+                    uint32_t contentLength = 0;
                     /* Get response headers */
                     while (1) {
-                        String line;
-                        status = getLine(stream, line);
+                        status = getLine(stream, line, sizeof(line), lineLen);
 
                         if (ER_OK == status) {
-                            if (line.empty()) {
+                            if (lineLen == 0) {
                                 break;
                             } else {
-                                size_t pos = line.find(':');
-                                if ((0 != pos) && (pos != String::npos)) {
-                                    responseHeaders[Trim(line.substr(0, pos))] = Trim(line.substr(pos + 1));
+                                const char* value = getHeaderValue(line, "Content-Length");
+                                if (value) {
+                                    contentLength = strtoul(value, NULL, 10);
+                                } else if ((value = getHeaderValue(line, "Connection")) != NULL) {
+                                    if (isToken(value, "close")) {
+                                        keepAlive = false;
+                                    } else if (isToken(value, "keep-alive")) {
+                                        keepAlive = true;
+                                    }
                                 }
                             }
                         } else {
@@ -382,35 +448,46 @@ QStatus HttpConnection::ParseResponse(HTTPResponse& response)
 
                     if (ER_OK == status) {
                         /* Setup response stream */
-                        httpSource.SetContentLength(StringToU32(responseHeaders["Content-Length"], 10, 0));
+                        httpSource.SetContentLength(contentLength);
 
                         /*We need to parse the payload only if we have a payload in the response*/
-                        if (httpSource.GetContentLength() != 0) {
-                            char* buf = (char*)malloc(httpSource.GetContentLength() + 1);
-                            size_t reqBytes = httpSource.GetContentLength();
-                            size_t actual;
-                            status = httpSource.PullBytes(buf, reqBytes, actual);
-
-                            if ((ER_OK == status) && (httpSource.GetContentLength() == actual)) {
-                                buf[actual] = '\0';
-                                string responseStr = string(buf);
+                        if (contentLength != 0) {
+                            /*
+                             * The payload is read into the response's arena and parsed in place,
+                             * so the parsed strings point into it.
+                             */
+                            char* buf = static_cast<char*>(response.arena.allocate(contentLength));
+                            size_t received = 0;
+
+                            if (!buf) {
+                                status = ER_OUT_OF_MEMORY;
+                            }
+                            while ((ER_OK == status) && (received < contentLength)) {
+                                size_t actual;
+                                status = httpSource.PullBytes(buf + received, contentLength - received, actual);
+                                if ((ER_OK == status) && (0 == actual)) {
+                                    status = ER_FAIL;
+                                }
+                                received += actual;
+                            }
 
+                            if (ER_OK == status) {
                                 // Parse the payload using the JSON parser only of the HTTP status code received is
                                 // HTTP_STATUS_OK.
                                 if (httpStatus == HTTP_STATUS_OK) {
-                                    Json::Reader reader;
-                                    if (!reader.parse(responseStr, response.payload)) {
+                                    const Json::ArenaValue* root;
+                                    if (!jsonReader.parse(buf, buf + contentLength, response.arena, root)) {
                                         status = ER_FAIL;
-                                        QCC_LogError(status, ("HttpConnection::ParseResponse(): JSON payload parsing failed"));
+                                        QCC_LogError(status, ("HttpConnection::ParseResponse(): JSON payload parsing failed: %s",
+                                                              jsonReader.getFormatedErrorMessages().c_str()));
                                     } else {
+                                        response.payload = root;
                                         response.payloadPresent = true;
                                     }
                                 }
                             } else {
-                                status = ER_FAIL;
                                 QCC_LogError(status, ("HttpConnection::ParseResponse(): Payload parsing failed"));
                             }
-                            free(buf);
                         } else {
                             QCC_DbgPrintf(("HttpConnection::ParseResponse(): Received a response with no payload"));
                         }
@@ -200,10 +200,18 @@ class HttpConnection {
         /* If set to true, valid payload is present */
         bool payloadPresent;
 
-        /* Received payload */
-        Json::Value payload;
+        /* Received payload. It lives in arena, so it is only valid as long as the response is */
+        const Json::ArenaValue* payload;
 
-        HTTPResponse() : payloadPresent(false) { }
+        /* Holds the payload text and the values parsed from it */
+        Json::Arena arena;
+
+        HTTPResponse() : statusCode(HTTP_STATUS_INVALID), payloadPresent(false), payload(&Json::ArenaValue::null) { }
+
+      private:
+        /* Private copy constructor and assignment operator: the payload points into arena */
+        HTTPResponse(const HTTPResponse& other);
+        HTTPResponse& operator=(const HTTPResponse& other);
     };
 
     /** Default Constructor */
@@ -214,7 +222,9 @@ class HttpConnection {
         protocol(PROTO_HTTP),
         httpStatus(HTTP_STATUS_INVALID),
         isMultipartForm(false),
-        isApplicationJson(false)
+        isApplicationJson(false),
+        keepAlive(true),
+        pendingResponses(0)
     {
     }
 
@@ -346,14 +356,6 @@ class HttpConnection {
      */
     QStatus GetStatusCode(HttpStatus& status);
 
-    /**
-     * Get the response headers.
-     * Response headers are only valid after calling GetStatusCode()
-     *
-     * @return Map of HTTP(s) response headers
-     */
-    std::map<String, String> GetResponseHeaders() { return responseHeaders; }
-
     /**
      * Get response byte stream.
      *
@@ -382,6 +384,23 @@ class HttpConnection {
         return (httpSource.GetContentLength() == 0);
     }
 
+    /**
+     * Indicate whether the connection may be reused after the last parsed response.
+     *
+     * @return false if the server answered with "Connection: close" or as an
+     *         HTTP/1.0 server that did not ask for keep-alive.
+     */
+    bool IsKeepAlive(void) { return keepAlive; }
+
+    /**
+     * Get the number of requests sent whose response has not been parsed yet.
+     * Requests are pipelined: responses come back in the order the requests
+     * were sent.
+     *
+     * @return Number of outstanding requests.
+     */
+    uint32_t GetPendingResponses(void) { return pendingResponses; }
+
     /** Returns the IPAddress of the local interface over which the HTTP connection exists */
     IPAddress GetLocalInterfaceAddress(void) { return localIPAddress; };
 
@@ -398,7 +417,9 @@ class HttpConnection {
         protocol(other.protocol),
         httpStatus(other.httpStatus),
         isMultipartForm(other.isMultipartForm),
-        isApplicationJson(other.isApplicationJson)
+        isApplicationJson(other.isApplicationJson),
+        keepAlive(other.keepAlive),
+        pendingResponses(0)
     {
         /* This constructor should never be invoked */
         assert(false);
@@ -417,6 +438,8 @@ class HttpConnection {
             httpStatus = other.httpStatus;
             isMultipartForm = other.isMultipartForm;
             isApplicationJson = other.isApplicationJson;
+            keepAlive = other.keepAlive;
+            pendingResponses = 0;
         }
 
         return *this;
@@ -430,6 +453,14 @@ class HttpConnection {
     /*PPN - Review duration*/
     static const uint32_t NAME_RESOLUTION_TIMEOUT_IN_MS = 5000;
 
+    /**
+     * @internal
+     *
+     * @brief Longest response status or header line that is parsed. The rest
+     * of a longer line is skipped.
+     */
+    static const size_t MAX_LINE_SIZE = 512;
+
     Stream* stream;                           /**< HTTP response stream */
     HttpResponseSource httpSource;            /**< Source wrapper */
     String host;                              /**< Destination host */
@@ -444,7 +475,9 @@ class HttpConnection {
     bool isMultipartForm;                     /**< true iff request is a multipart form post */
     bool isApplicationJson;                   /**< true iff request is a application/json format */
     std::map<String, String> requestHeaders;  /**< HTTP headers sent in request */
-    std::map<String, String> responseHeaders; /**< HTTP headers sent in response */
+    bool keepAlive;                           /**< false iff the server will close the connection */
+    uint32_t pendingResponses;                /**< Requests sent and not yet answered */
+    Json::ArenaReader jsonReader;             /**< Parser for response payloads (kept to reuse its buffers) */
     IPAddress localIPAddress;                 /**< IP address of the local interface to be used for connection*/
 };
 
@@ -25,6 +25,7 @@
 #include <ICECandidatePair.h>
 #include <Component.h>
 #include <StunAttribute.h>
+#include <StunMessageBuilder.h>
 #include <ICESession.h>
 
 using namespace qcc;
@@ -242,7 +243,8 @@ void ICECandidatePair::UpdateNominatedFlag(void)
 void ICECandidatePair::Check(void)
 {
     StunTransactionID tid;
-    StunMessage* msg;
+    ICESession* session = local->GetComponent()->GetICEStream()->GetSession();
+    uint8_t renderBuf[StunMessageBuilder::CHECK_BUF_SIZE];
 
     QCC_DbgTrace(("ICECandidatePair::Check: [local=%s:%d (%s)] [remote=%s:%d (%s)] priority=%ld",
                   local->GetEndpoint().addr.ToString().c_str(),
@@ -255,20 +257,13 @@ void ICECandidatePair::Check(void)
 
     if (!checkRetry->GetTransactionID(tid)) {
         // New transaction
-        msg = new StunMessage(STUN_MSG_REQUEST_CLASS,
-                              STUN_MSG_BINDING_METHOD,
-                              local->GetComponent()->GetICEStream()->GetSession()->GetLocalInitiatedCheckHmacKey(),
-                              local->GetComponent()->GetICEStream()->GetSession()->GetLocalInitiatedCheckHmacKeyLength());
-        msg->GetTransactionID(tid);
+        tid.SetValue();
         checkRetry->SetTransactionID(tid);
-    } else {
-        msg = new StunMessage(STUN_MSG_REQUEST_CLASS,
-                              STUN_MSG_BINDING_METHOD,
-                              local->GetComponent()->GetICEStream()->GetSession()->GetLocalInitiatedCheckHmacKey(),
-                              local->GetComponent()->GetICEStream()->GetSession()->GetLocalInitiatedCheckHmacKeyLength(),
-                              tid);
     }
 
+    // Checks are rendered straight into a stack buffer; see StunMessageBuilder.
+    StunMessageBuilder msg(renderBuf, sizeof(renderBuf), STUN_MSG_REQUEST_CLASS, STUN_MSG_BINDING_METHOD, tid);
+
     QCC_DbgPrintf(("SndChk TID %s from %s:%d remote %s:%d",
                    tid.ToString().c_str(),
                    local->GetEndpoint().addr.ToString().c_str(),
@@ -276,22 +271,36 @@ void ICECandidatePair::Check(void)
                    remote->GetEndpoint().addr.ToString().c_str(),
                    remote->GetEndpoint().port));
 
-    msg->AddAttribute(new StunAttributeUsername(local->GetComponent()->GetICEStream()->GetSession()->GetLocalInitiatedCheckUsername()));
-    msg->AddAttribute(new StunAttributePriority(bindRequestPriority));
-
-    if (local->GetComponent()->GetICEStream()->GetSession()->IsControllingAgent()) {
-        msg->AddAttribute(new StunAttributeIceControlling(controlTieBreaker));
+    QStatus status = msg.AddString(STUN_ATTR_USERNAME, session->GetLocalInitiatedCheckUsername());
+    if (status == ER_OK) {
+        status = msg.AddUint32(STUN_ATTR_PRIORITY, bindRequestPriority);
+    }
 
-        if (useAggressiveNomination || regularlyNominated) {
-            msg->AddAttribute(new StunAttributeUseCandidate());
+    if (session->IsControllingAgent()) {
+        if (status == ER_OK) {
+            status = msg.AddUint64(STUN_ATTR_ICE_CONTROLLING, controlTieBreaker);
         }
-    } else {
-        msg->AddAttribute(new StunAttributeIceControlled(controlTieBreaker));
+        if ((status == ER_OK) && (useAggressiveNomination || regularlyNominated)) {
+            status = msg.AddFlag(STUN_ATTR_USE_CANDIDATE);
+        }
+    } else if (status == ER_OK) {
+        status = msg.AddUint64(STUN_ATTR_ICE_CONTROLLED, controlTieBreaker);
     }
 
-    msg->AddAttribute(new StunAttributeRequestedTransport(REQUESTED_TRANSPORT_TYPE_UDP));
-    msg->AddAttribute(new StunAttributeMessageIntegrity(*msg));
-    msg->AddAttribute(new StunAttributeFingerprint(*msg));
+    if (status == ER_OK) {
+        status = msg.AddRequestedTransport(REQUESTED_TRANSPORT_TYPE_UDP);
+    }
+    if (status == ER_OK) {
+        status = msg.AddMessageIntegrity(session->GetLocalInitiatedCheckHmacKey(),
+                                         session->GetLocalInitiatedCheckHmacKeyLength());
+    }
+    if (status == ER_OK) {
+        status = msg.AddFingerprint();
+    }
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Rendering connectivity check"));
+        return;
+    }
 
     // immediately send our request (without enqueuing, because we have already paced ourselves
     // via the check dispatcher thread.)
@@ -299,19 +308,16 @@ void ICECandidatePair::Check(void)
     if (remote->GetType() == _ICECandidate::Relayed_Candidate) {
         local->GetStunActivity()->stun->SetTurnAddr(remote->GetEndpoint().addr);
         local->GetStunActivity()->stun->SetTurnPort(remote->GetEndpoint().port);
-        local->GetStunActivity()->stun->SendStunMessage(*msg,
+        local->GetStunActivity()->stun->SendStunMessage(msg,
                                                         remote->GetMappedAddress().addr,
                                                         remote->GetMappedAddress().port,
                                                         true);
     } else {
-        local->GetStunActivity()->stun->SendStunMessage(*msg,
+        local->GetStunActivity()->stun->SendStunMessage(msg,
                                                         remote->GetEndpoint().addr,
                                                         remote->GetEndpoint().port,
                                                         local->GetType() == _ICECandidate::Relayed_Candidate);
     }
-
-    delete msg;
-
 }
 
 
@@ -30,7 +30,10 @@
 #include "ScatterGatherList.h"
 #include "ICECandidatePair.h"
 #include "Stun.h"
+#include "StunMessageBuilder.h"
+#include "StunMessageView.h"
 #include "ICEPacketStream.h"
+#include "UDPPacketStream.h"
 
 #define QCC_MODULE "PACKET"
 
@@ -296,10 +299,10 @@ QStatus ICEPacketStream::PushPacketBytes(const void* buf, size_t numBytes, Packe
     } else {
         sendLock.Lock();
         if (usingTurn) {
-            ScatterGatherList sgList;
-            status = ComposeStunMessage(buf, numBytes, sgList);
+            size_t msgSize;
+            status = ComposeStunMessage(buf, numBytes, msgSize);
             if (status == ER_OK) {
-                status = SendToSG(sock, turnAddress, turnPort, sgList, sent);
+                status = qcc::SendTo(sock, turnAddress, turnPort, txRenderBuf, msgSize, sent);
             } else {
                 QCC_LogError(status, ("ComposeStunMessage failed"));
             }
@@ -381,6 +384,44 @@ QStatus ICEPacketStream::PullPacketBytes(void* buf, size_t reqBytes, size_t& act
     return status;
 }
 
+QStatus ICEPacketStream::PullPacketBatch(PacketBuffer* bufs, size_t numBufs, size_t& numPulled, uint32_t timeout)
+{
+    QCC_DbgTrace(("ICEPacketStream::PullPacketBatch numBufs=%d", numBufs));
+
+    /* TURN relayed packets must be stripped of their STUN framing one at a time */
+    if (usingTurn) {
+        return PacketStream::PullPacketBatch(bufs, numBufs, numPulled, timeout);
+    }
+    numPulled = 0;
+    if (timeout != 0) {
+        QStatus status = Event::Wait(GetSourceEvent(), timeout);
+        if (status != ER_OK) {
+            return status;
+        }
+    }
+    return UDPPacketStream::RecvBatch(sock, bufs, numBufs, numPulled);
+}
+
+QStatus ICEPacketStream::PushPacketBatch(PacketBuffer* bufs, size_t numBufs, size_t& numPushed)
+{
+    QCC_DbgTrace(("ICEPacketStream::PushPacketBatch numBufs=%d", numBufs));
+
+    /* TURN relayed packets must each be wrapped in a STUN send indication */
+    if (usingTurn) {
+        return PacketStream::PushPacketBatch(bufs, numBufs, numPushed);
+    }
+
+    QStatus status;
+    if (localHost && remoteHost) {
+        status = UDPPacketStream::SendBatch(sock, bufs, numBufs, numPushed);
+    } else {
+        sendLock.Lock();
+        status = UDPPacketStream::SendBatch(sock, bufs, numBufs, numPushed);
+        sendLock.Unlock();
+    }
+    return status;
+}
+
 String ICEPacketStream::ToString(const PacketDest& dest) const
 {
 
@@ -394,42 +435,31 @@ String ICEPacketStream::ToString(const PacketDest& dest) const
 
 QStatus ICEPacketStream::ComposeStunMessage(const void* buf,
                                             size_t numBytes,
-                                            ScatterGatherList& msgSG)
+                                            size_t& msgSize)
 {
     QCC_DbgPrintf(("ICEPacketStream::ComposeStunMessage()"));
 
     assert(buf != NULL);
 
-    QStatus status = ER_OK;
-
-    ScatterGatherList sg;
-    sg.AddBuffer(buf, numBytes);
-    sg.SetDataSize(numBytes);
+    StunMessageBuilder msg(txRenderBuf, maxPacketStreamMtu, STUN_MSG_INDICATION_CLASS, STUN_MSG_SEND_METHOD);
 
-    StunMessage msg(STUN_MSG_INDICATION_CLASS, STUN_MSG_SEND_METHOD, reinterpret_cast<const uint8_t*>(hmacKey.c_str()), hmacKey.size());
-
-    status = msg.AddAttribute(new StunAttributeUsername(turnUsername));
-    if (status == ER_OK) {
-        status = msg.AddAttribute(new StunAttributeXorPeerAddress(msg, remoteMappedAddress, remoteMappedPort));
-    }
+    QStatus status = msg.AddString(STUN_ATTR_USERNAME, turnUsername);
     if (status == ER_OK) {
-        status = msg.AddAttribute(new StunAttributeAllocatedXorServerReflexiveAddress(msg, localSrflxAddress, localSrflxPort));
+        status = msg.AddXorAddress(STUN_ATTR_XOR_PEER_ADDRESS, remoteMappedAddress, remoteMappedPort);
     }
     if (status == ER_OK) {
-        status = msg.AddAttribute(new StunAttributeData(sg));
+        status = msg.AddXorAddress(STUN_ATTR_ALLOCATED_XOR_SERVER_REFLEXIVE_ADDRESS, localSrflxAddress, localSrflxPort);
     }
     if (status == ER_OK) {
-        status = msg.AddAttribute(new StunAttributeMessageIntegrity(msg));
+        status = msg.AddAttribute(STUN_ATTR_DATA, buf, numBytes);
     }
     if (status == ER_OK) {
-        status = msg.AddAttribute(new StunAttributeFingerprint(msg));
+        status = msg.AddMessageIntegrity(reinterpret_cast<const uint8_t*>(hmacKey.c_str()), hmacKey.size());
     }
     if (status == ER_OK) {
-        size_t renderSize = msg.RenderSize();
-        assert(renderSize <= maxPacketStreamMtu);
-        uint8_t* _txRenderBuf = txRenderBuf;
-        status = msg.RenderBinary(_txRenderBuf, renderSize, msgSG);
+        status = msg.AddFingerprint();
     }
+    msgSize = msg.Size();
 
     return status;
 }
@@ -439,17 +469,10 @@ QStatus ICEPacketStream::SendNATKeepAlive(void)
     QCC_DbgTrace(("ICEPacketStream::SendNATKeepAlive()"));
 
     QStatus status = ER_OK;
-
-    StunMessage msg(STUN_MSG_INDICATION_CLASS, STUN_MSG_BINDING_METHOD, reinterpret_cast<const uint8_t*>(hmacKey.c_str()), hmacKey.size());
-
-    size_t renderSize = msg.RenderSize();
-    assert(renderSize <= maxPacketStreamMtu);
-    ScatterGatherList msgSG;
     size_t sent;
 
     sendLock.Lock();
-    uint8_t* _txRenderBuf = txRenderBuf;
-    status = msg.RenderBinary(_txRenderBuf, renderSize, msgSG);
+    StunMessageBuilder msg(txRenderBuf, maxPacketStreamMtu, STUN_MSG_INDICATION_CLASS, STUN_MSG_BINDING_METHOD);
 
     qcc::IPAddress destnAddress = remoteAddress;
     uint16_t destnPort = remotePort;
@@ -461,8 +484,8 @@ QStatus ICEPacketStream::SendNATKeepAlive(void)
         destnPort = turnPort;
     }
 
+    status = qcc::SendTo(sock, destnAddress, destnPort, msg.GetBuffer(), msg.Size(), sent);
     if (status == ER_OK) {
-        status = SendToSG(sock, destnAddress, destnPort, msgSG, sent);
         QCC_DbgPrintf(("ICEPacketStream::SendNATKeepAlive()(): Sent NAT keep-alive"));
     } else {
         QCC_LogError(status, ("ICEPacketStream::SendNATKeepAlive()(): Failed to send NAT keep-alive"));
@@ -478,49 +501,40 @@ QStatus ICEPacketStream::SendTURNRefresh(uint64_t time)
     QCC_DbgTrace(("ICEPacketStream::SendTURNRefresh()"));
 
     QStatus status = ER_OK;
+    size_t sent;
 
-    StunMessage msg(STUN_MSG_REQUEST_CLASS, STUN_MSG_REFRESH_METHOD, reinterpret_cast<const uint8_t*>(hmacKey.c_str()), hmacKey.size());
-
-    status = msg.AddAttribute(new StunAttributeUsername(turnUsername));
+    sendLock.Lock();
+    StunMessageBuilder msg(txRenderBuf, maxPacketStreamMtu, STUN_MSG_REQUEST_CLASS, STUN_MSG_REFRESH_METHOD);
 
+    status = msg.AddString(STUN_ATTR_USERNAME, turnUsername);
     if (status == ER_OK) {
-        status = msg.AddAttribute(new StunAttributeSoftware(String("AllJoyn ") + String(GetVersion())));
+        status = msg.AddString(STUN_ATTR_SOFTWARE, String("AllJoyn ") + String(GetVersion()));
     }
     if (status == ER_OK) {
-        status = msg.AddAttribute(new StunAttributeLifetime(ajn::TURN_PERMISSION_REFRESH_PERIOD_SECS));
+        status = msg.AddUint32(STUN_ATTR_LIFETIME, ajn::TURN_PERMISSION_REFRESH_PERIOD_SECS);
     }
     if (status == ER_OK) {
-        status = msg.AddAttribute(new StunAttributeRequestedTransport(ajn::REQUESTED_TRANSPORT_TYPE_UDP));
+        status = msg.AddRequestedTransport(ajn::REQUESTED_TRANSPORT_TYPE_UDP);
     }
     if (status == ER_OK) {
-        status = msg.AddAttribute(new StunAttributeMessageIntegrity(msg));
+        status = msg.AddMessageIntegrity(reinterpret_cast<const uint8_t*>(hmacKey.c_str()), hmacKey.size());
     }
     if (status == ER_OK) {
-        status = msg.AddAttribute(new StunAttributeFingerprint(msg));
+        status = msg.AddFingerprint();
     }
-    if (status == ER_OK) {
-        size_t renderSize = msg.RenderSize();
-        assert(renderSize <= maxPacketStreamMtu);
-        ScatterGatherList msgSG;
-        size_t sent;
-
-        sendLock.Lock();
-        uint8_t* _txRenderBuf = txRenderBuf;
-        status = msg.RenderBinary(_txRenderBuf, renderSize, msgSG);
-
-        if (status == ER_OK) {
-            status = SendToSG(sock, relayServerAddress, relayServerPort, msgSG, sent);
-            QCC_DbgPrintf(("ICEPacketStream::SendTURNRefresh(): Sent TURN refresh"));
 
-            // Set the TURN refresh time-stamp
-            turnRefreshTimestamp = time;
-        } else {
-            QCC_LogError(status, ("ICEPacketStream::SendTURNRefresh(): Failed to send TURN refresh"));
-        }
+    if (status == ER_OK) {
+        status = qcc::SendTo(sock, relayServerAddress, relayServerPort, msg.GetBuffer(), msg.Size(), sent);
+        QCC_DbgPrintf(("ICEPacketStream::SendTURNRefresh(): Sent TURN refresh"));
 
-        sendLock.Unlock();
+        // Set the TURN refresh time-stamp
+        turnRefreshTimestamp = time;
+    } else {
+        QCC_LogError(status, ("ICEPacketStream::SendTURNRefresh(): Failed to send TURN refresh"));
     }
 
+    sendLock.Unlock();
+
     return status;
 }
 
@@ -530,57 +544,25 @@ QStatus ICEPacketStream::StripStunOverhead(size_t rcvdBytes, void* dataBuf, size
 
     QStatus status = ER_OK;
 
-    size_t _rcvdBytes = rcvdBytes;
-    const uint8_t* _rxRenderBuf = rxRenderBuf;
-
-    if (((_rcvdBytes >= StunMessage::MIN_MSG_SIZE) && StunMessage::IsStunMessage(_rxRenderBuf, _rcvdBytes))) {
+    if (((rcvdBytes >= StunMessage::MIN_MSG_SIZE) && StunMessage::IsStunMessage(rxRenderBuf, rcvdBytes))) {
 
-        uint16_t rawMsgType = 0;
+        // Validate and index the message in place; nothing is allocated or copied except the DATA.
+        StunMessageView msg;
+        QStatus parseStatus = msg.Parse(rxRenderBuf, rcvdBytes);
 
-        _rcvdBytes = rcvdBytes;
-        _rxRenderBuf = rxRenderBuf;
-        StunIOInterface::ReadNetToHost(_rxRenderBuf, _rcvdBytes, rawMsgType);
-
-        if (StunMessage::ExtractMessageMethod(rawMsgType) == STUN_MSG_DATA_METHOD) {
+        if (parseStatus != ER_OK) {
+            QCC_DbgPrintf(("%s: Invalid STUN message: %s", __FUNCTION__, QCC_StatusText(parseStatus)));
+        } else if (msg.GetTypeMethod() == STUN_MSG_DATA_METHOD) {
 
             QCC_DbgPrintf(("%s: Received STUN_MSG_DATA_METHOD", __FUNCTION__));
 
-            // Parse message and extract DATA attribute contents.
-            size_t keyLen  = hmacKey.size();
-            uint8_t* dummyHmac = new uint8_t[keyLen];
-            StunMessage msg("", dummyHmac, keyLen);
-            QStatus status;
-
-            _rcvdBytes = rcvdBytes;
-            _rxRenderBuf = rxRenderBuf;
-            status = msg.Parse(_rxRenderBuf, _rcvdBytes);
-            if (status == ER_OK) {
-                StunMessage::const_iterator iter;
-
-                for (iter = msg.Begin(); iter != msg.End(); ++iter) {
-                    if ((*iter)->GetType() == STUN_ATTR_DATA) {
-                        StunAttributeData* data = reinterpret_cast<StunAttributeData*>(*iter);
-                        ScatterGatherList::const_iterator sgiter = data->GetData().Begin();
-
-                        /*
-                         * Because the message was parsed, the data
-                         * SG-List in the DATA attribute is guaranteed to
-                         * be have only a single element.  Furthermore,
-                         * that element will refer to a region of memory
-                         * that is fully contained within the space
-                         * allocated for the StunBuffer that was allocated
-                         * above.  Therefore, we just point the sb.buf to
-                         * the data region instead of performing a data
-                         * copy that will involve overlapping memory
-                         * regions.
-                         */
-                        assert(dataBufLen >= sgiter->len);
-                        actualBytes = (dataBufLen <= sgiter->len) ? dataBufLen : sgiter->len;
-                        ::memcpy(dataBuf, sgiter->buf, actualBytes);
-                    }
-                }
+            const uint8_t* data;
+            uint16_t dataLen;
+            if (msg.Find(STUN_ATTR_DATA, data, dataLen)) {
+                assert(dataBufLen >= dataLen);
+                actualBytes = (dataBufLen <= dataLen) ? dataBufLen : dataLen;
+                ::memcpy(dataBuf, data, actualBytes);
             }
-            delete [] dummyHmac;
         } else {
 
             QCC_DbgPrintf(("%s: Received NAT keepalive or TURN refresh response", __FUNCTION__));
@@ -592,64 +574,15 @@ QStatus ICEPacketStream::StripStunOverhead(size_t rcvdBytes, void* dataBuf, size
             // should be set to 0.
             actualBytes = 0;
 
-            uint16_t rawMsgType = 0;  // Initializer to make GCC 4.3.2 happy.
-            uint16_t rawMsgSize = 0;
-            uint32_t magicCookie = 0;
-
-            _rcvdBytes = rcvdBytes;
-            _rxRenderBuf = rxRenderBuf;
-
-            StunIOInterface::ReadNetToHost(_rxRenderBuf, _rcvdBytes, rawMsgType);
-            StunIOInterface::ReadNetToHost(_rxRenderBuf, _rcvdBytes, rawMsgSize);
-            StunIOInterface::ReadNetToHost(_rxRenderBuf, _rcvdBytes, magicCookie);
-
-            if (StunMessage::IsTypeOK(rawMsgType)) {
-                QCC_DbgPrintf(("%s: StunMessage::IsTypeOK() successful", __FUNCTION__));
-                // Check to ensure that we have indeed received a STUN response
-                if (StunMessage::ExtractMessageClass(rawMsgType) == STUN_MSG_RESPONSE_CLASS) {
-                    QCC_DbgPrintf(("%s: Received a STUN response message", __FUNCTION__));
-
-                    // Parse message and extract Lifetime attribute contents.
-                    size_t keyLen  = hmacKey.size();
-                    uint8_t* dummyHmac = new uint8_t[keyLen];
-                    StunMessage msg("", dummyHmac, keyLen);
-                    QStatus status;
-
-                    _rcvdBytes = rcvdBytes;
-                    _rxRenderBuf = rxRenderBuf;
-                    status = msg.Parse(_rxRenderBuf, _rcvdBytes);
-
-                    if (status == ER_OK) {
-                        StunMessage::const_iterator iter;
-
-                        for (iter = msg.Begin(); iter != msg.End(); ++iter) {
-                            if ((*iter)->GetType() == STUN_ATTR_LIFETIME) {
-                                const StunAttributeLifetime& sa = *reinterpret_cast<StunAttributeLifetime*>(*iter);
-
-                                turnRefreshPeriodUpdateLock.Lock();
-                                turnRefreshPeriod = ((sa.GetLifetime() - ajn::TURN_REFRESH_WARNING_PERIOD_SECS) * 1000);
-                                turnRefreshPeriodUpdateLock.Unlock();
-
-                                QCC_DbgPrintf(("%s: Found Lifetime attribute(%d) in the received STUN response", __FUNCTION__, sa.GetLifetime()));
-
-                                /* Break out of the for loop if we have found the Lifetime attribute as we are not interested
-                                 * in any other attribute in this section */
-                                break;
-                            }
-                        }
-                    }
-                    delete [] dummyHmac;
-                } else {
-                    QCC_DbgPrintf(("%s: Received message is not a STUN response", __FUNCTION__));
-                }
-            } else {
-                QCC_DbgPrintf(("%s: Invalid STUN message type: %04x (%s, %s)",
-                               __FUNCTION__,
-                               rawMsgType,
-                               StunMessage::MessageClassToString(StunMessage::ExtractMessageClass(rawMsgType)).c_str(),
-                               StunMessage::MessageMethodToString(StunMessage::ExtractMessageMethod(rawMsgType)).c_str()));
-            }
+            // Check to ensure that we have indeed received a STUN response
+            uint32_t lifetime;
+            if ((msg.GetTypeClass() == STUN_MSG_RESPONSE_CLASS) && msg.GetUint32(STUN_ATTR_LIFETIME, lifetime)) {
+                turnRefreshPeriodUpdateLock.Lock();
+                turnRefreshPeriod = ((lifetime - ajn::TURN_REFRESH_WARNING_PERIOD_SECS) * 1000);
+                turnRefreshPeriodUpdateLock.Unlock();
 
+                QCC_DbgPrintf(("%s: Found Lifetime attribute(%d) in the received STUN response", __FUNCTION__, lifetime));
+            }
         }
 
     } else {
@@ -119,6 +119,18 @@ class ICEPacketStream : public PacketStream {
      */
     QStatus PullPacketBytes(void* buf, size_t reqBytes, size_t& actualBytes, PacketDest& sender, uint32_t timeout = qcc::Event::WAIT_FOREVER);
 
+    /**
+     * Pull up to numBufs packets from the source.
+     * Packets relayed through a TURN server are pulled one at a time.
+     *
+     * @param bufs       Packet buffers to fill. On return bufs[0..numPulled) hold the pulled packets.
+     * @param numBufs    Number of entries in bufs.
+     * @param numPulled  Number of packets pulled.
+     * @param timeout    Time to wait for the first packet, 0 to only pull packets that are already available.
+     * @return   ER_OK if at least one packet was pulled, ER_TIMEOUT or ER_WOULDBLOCK if there was none. Otherwise an error.
+     */
+    QStatus PullPacketBatch(PacketBuffer* bufs, size_t numBufs, size_t& numPulled, uint32_t timeout = qcc::Event::WAIT_FOREVER);
+
     /**
      * Get the Event indicating that data is available when signaled.
      *
@@ -143,6 +155,17 @@ class ICEPacketStream : public PacketStream {
      */
     QStatus PushPacketBytes(const void* buf, size_t numBytes, PacketDest& dest);
 
+    /**
+     * Push a batch of packets into the sink.
+     * Packets relayed through a TURN server are pushed one at a time.
+     *
+     * @param bufs       Packets to push.
+     * @param numBufs    Number of entries in bufs.
+     * @param numPushed  Number of packets (starting from bufs[0]) that were pushed.
+     * @return   ER_OK if all packets were pushed.
+     */
+    QStatus PushPacketBatch(PacketBuffer* bufs, size_t numBufs, size_t& numPushed);
+
     /**
      * Get the Event that indicates when data can be pushed to sink.
      *
@@ -284,11 +307,11 @@ class ICEPacketStream : public PacketStream {
     qcc::Alarm timeoutAlarm;
 
     /**
-     * Compose a STUN message with the passed in data.
+     * Compose a STUN Send indication with the passed in data in txRenderBuf.
      */
     QStatus ComposeStunMessage(const void* buf,
                                size_t numBytes,
-                               qcc::ScatterGatherList& msgSG);
+                               size_t& msgSize);
 
     /**
      * Strip STUN overhead from a received message.
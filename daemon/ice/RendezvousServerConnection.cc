@@ -58,6 +58,7 @@ RendezvousServerConnection::RendezvousServerConnection(String rdvzServer, bool e
     networkInterface(NULL),
     RendezvousServer(rdvzServer),
     RendezvousServerIPAddress(),
+    RendezvousServerPort(0),
     EnableIPv6(enableIPv6),
     UseHTTP(useHttp)
 {
@@ -365,6 +366,10 @@ QStatus RendezvousServerConnection::SetupHTTPConn(SocketFd sockFd, HttpConnectio
             (*httpConn)->SetProtocol(HttpConnection::PROTO_HTTPS);
         }
 
+        if (RendezvousServerPort) {
+            (*httpConn)->SetPort(RendezvousServerPort);
+        }
+
         status = (*httpConn)->Connect(sockFd);
 
         if (status == ER_OK) {
@@ -410,6 +415,18 @@ QStatus RendezvousServerConnection::SetupSockForConn(SocketFd& sockFd)
 
     status = Socket(socketFamily, QCC_SOCK_STREAM, sockFd);
 
+    if (status == ER_OK) {
+        /* Turn off Nagle so that pipelined requests are not held back until the previous one is acknowledged */
+        status = SetNagle(sockFd, false);
+
+        if (status != ER_OK) {
+            QCC_LogError(status, ("RendezvousServerConnection::SetupSockForConn(): SetNagle() failed"));
+            Close(sockFd);
+            sockFd = -1;
+            return status;
+        }
+    }
+
     if (status != ER_OK) {
         QCC_LogError(status, ("RendezvousServerConnection::SetupSockForConn(): Socket() failed: %d - %s", errno, strerror(errno)));
     } else {
@@ -502,6 +519,20 @@ QStatus RendezvousServerConnection::FetchResponse(bool isOnDemandConnection, Htt
 
             if (status == ER_OK) {
                 QCC_DbgPrintf(("RendezvousServerConnection::FetchResponse(): Parsed the response successfully"));
+
+                /* The Server closes the connection after this response. Clean up just this connection so that
+                 * the next Connect() only sets it up again. Any responses still pending on it are lost */
+                if (!connection->IsKeepAlive()) {
+                    QCC_DbgPrintf(("RendezvousServerConnection::FetchResponse(): Server is closing the connection. %d responses pending",
+                                   connection->GetPendingResponses()));
+                    if (isOnDemandConnection) {
+                        CleanConnection(onDemandConn, &onDemandIsConnected);
+                        onDemandConn = NULL;
+                    } else {
+                        CleanConnection(persistentConn, &persistentIsConnected);
+                        persistentConn = NULL;
+                    }
+                }
             } else {
                 QCC_LogError(status, ("RendezvousServerConnection::FetchResponse(): Unable to parse the response successfully"));
                 if (status == ER_OS_ERROR) {
@@ -515,6 +546,15 @@ QStatus RendezvousServerConnection::FetchResponse(bool isOnDemandConnection, Htt
     return status;
 }
 
+bool RendezvousServerConnection::CanPipelineOnDemandMessage(void)
+{
+    if (!UseHTTP || !IsOnDemandConnUp() || !onDemandConn) {
+        return false;
+    }
+
+    return (onDemandConn->IsKeepAlive() && (onDemandConn->GetPendingResponses() < MAX_PIPELINED_MESSAGES));
+}
+
 void RendezvousServerConnection::GetRendezvousConnIPAddresses(IPAddress& onDemandAddress, IPAddress& persistentAddress)
 {
     QCC_DbgPrintf(("RendezvousServerConnection::GetRendezvousConnIPAddresses()"));
@@ -183,10 +183,26 @@ class RendezvousServerConnection {
 
     /**
      * @internal
-     * @brief Receive a response from the Server
+     * @brief Receive a response from the Server.
+     *
+     * If the Server indicates in the response that it is going to close the
+     * connection, the connection is cleaned up once the response has been
+     * read so that only that connection needs to be set up again.
      */
     QStatus FetchResponse(bool isOnDemandConnection, HttpConnection::HTTPResponse& response);
 
+    /**
+     * @internal
+     * @brief Returns true if another message may be sent over the on demand
+     * connection before the responses to the messages already sent over it
+     * have been received.
+     *
+     * Requests are only pipelined over plain HTTP: the SSL socket may hold
+     * more than one response in its buffer, which would not signal the
+     * response event.
+     */
+    bool CanPipelineOnDemandMessage(void);
+
     /**
      * @internal
      * @brief Reset the persistentConnectionChanged flag
@@ -247,6 +263,15 @@ class RendezvousServerConnection {
         RendezvousServerIPAddress = address;
     }
 
+    /**
+     * @internal
+     * @brief Set the port of the Rendezvous Server. 0, the default, selects
+     * the standard port of the protocol in use.
+     */
+    void SetRendezvousServerPort(uint16_t port) {
+        RendezvousServerPort = port;
+    }
+
     /**
      * @internal
      * @brief Returns true if the device has valid interfaces up for connection to the Server.
@@ -261,6 +286,13 @@ class RendezvousServerConnection {
 
   private:
 
+    /**
+     * @internal
+     * @brief Maximum number of messages awaiting a response on the on demand
+     * connection.
+     */
+    static const uint32_t MAX_PIPELINED_MESSAGES = 8;
+
     /* Default constructor */
     RendezvousServerConnection();
 
@@ -333,6 +365,12 @@ class RendezvousServerConnection {
      */
     String RendezvousServerIPAddress;
 
+    /**
+     * @internal
+     * @brief Rendezvous Server port or 0 for the default port.
+     */
+    uint16_t RendezvousServerPort;
+
     /**
      * @internal
      * @brief Boolean indicating if IPv6 addressing mode is supported.
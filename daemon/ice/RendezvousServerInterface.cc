@@ -391,7 +391,7 @@ String GenerateJSONCandidates(ICECandidatesMessage message)
 /**
  * Worker function used to parse a generic response
  */
-QStatus ParseGenericResponse(Json::Value receivedResponse, GenericResponse& parsedResponse)
+QStatus ParseGenericResponse(const Json::ArenaValue& receivedResponse, GenericResponse& parsedResponse)
 {
     QStatus status = ER_OK;
 
@@ -415,7 +415,7 @@ QStatus ParseGenericResponse(Json::Value receivedResponse, GenericResponse& pars
 /**
  * Worker function used to parse a refresh token response
  */
-QStatus ParseTokenRefreshResponse(Json::Value receivedResponse, TokenRefreshResponse& parsedResponse)
+QStatus ParseTokenRefreshResponse(const Json::ArenaValue& receivedResponse, TokenRefreshResponse& parsedResponse)
 {
     QStatus status = ER_OK;
 
@@ -550,7 +550,7 @@ void PrintMessageResponse(Response msg)
 /**
  * Worker function used to parse a message response
  */
-QStatus ParseMessagesResponse(Json::Value receivedResponse, ResponseMessage& parsedResponse)
+QStatus ParseMessagesResponse(const Json::ArenaValue& receivedResponse, ResponseMessage& parsedResponse)
 {
     QStatus status = ER_OK;
 
@@ -591,25 +591,25 @@ QStatus ParseMessagesResponse(Json::Value receivedResponse, ResponseMessage& par
         status = ER_FAIL;
         QCC_LogError(status, ("ParseMessagesResponse(): Message is empty"));
     } else if (receivedResponse.isMember(msgs)) {
-        Json::Value msgsObj = receivedResponse[msgs];
+        const Json::ArenaValue& msgsObj = receivedResponse[msgs];
         if (msgsObj.isArray()) {
             if (!msgsObj.empty()) {
                 for (Json::UInt j = 0; j < msgsObj.size(); j++) {
-                    Json::Value msgsObjArrayMember = msgsObj[j];
+                    const Json::ArenaValue& msgsObjArrayMember = msgsObj[j];
 
                     if (msgsObjArrayMember[type] == "match") {
                         QCC_DbgPrintf(("ParseMessagesResponse(): [%d] Match Message", j));
 
                         if (msgsObjArrayMember.isMember(match)) {
 
-                            Json::Value matchObj = msgsObjArrayMember[match];
+                            const Json::ArenaValue& matchObj = msgsObjArrayMember[match];
 
                             if (matchObj.isMember(searchedService)) {
                                 if (matchObj.isMember(service)) {
                                     if (matchObj.isMember(peerAddr)) {
                                         if (matchObj.isMember(STUNInfo)) {
 
-                                            Json::Value STUNInfoObj = matchObj[STUNInfo];
+                                            const Json::ArenaValue& STUNInfoObj = matchObj[STUNInfo];
 
                                             if (STUNInfoObj.isMember(address)) {
                                                 if (STUNInfoObj.isMember(acct)) {
@@ -639,7 +639,7 @@ QStatus ParseMessagesResponse(Json::Value receivedResponse, ResponseMessage& par
                                                             SearchMatch->STUNInfo.recvTime = GetTimestamp();
 
                                                             if (STUNInfoObj.isMember(relay)) {
-                                                                Json::Value relayObj = STUNInfoObj[relay];
+                                                                const Json::ArenaValue& relayObj = STUNInfoObj[relay];
 
                                                                 if (relayObj.isMember(address)) {
                                                                     if (relayObj.isMember(port)) {
@@ -709,7 +709,7 @@ QStatus ParseMessagesResponse(Json::Value receivedResponse, ResponseMessage& par
                         QCC_DbgPrintf(("ParseMessagesResponse(): [%d] Address Candidates Message", j));
 
                         if (msgsObjArrayMember.isMember(addressCandidates)) {
-                            Json::Value addressCandidatesObj = msgsObjArrayMember[addressCandidates];
+                            const Json::ArenaValue& addressCandidatesObj = msgsObjArrayMember[addressCandidates];
 
                             ICECandidates tempCandidateMsg;
 
@@ -723,13 +723,13 @@ QStatus ParseMessagesResponse(Json::Value receivedResponse, ResponseMessage& par
                                         AddressCandidates->ice_pwd = String(addressCandidatesObj[ice_pwd].asCString());
 
                                         if (addressCandidatesObj.isMember(candidates)) {
-                                            Json::Value candidatesObj = addressCandidatesObj[candidates];
+                                            const Json::ArenaValue& candidatesObj = addressCandidatesObj[candidates];
 
                                             if (candidatesObj.isArray()) {
                                                 if (!candidatesObj.empty()) {
                                                     for (Json::UInt k = 0; k < candidatesObj.size(); k++) {
 
-                                                        Json::Value candidatesObjArrayMember = candidatesObj[k];
+                                                        const Json::ArenaValue& candidatesObjArrayMember = candidatesObj[k];
 
                                                         if (candidatesObjArrayMember.isMember(type)) {
                                                             if (candidatesObjArrayMember.isMember(foundation)) {
@@ -805,7 +805,7 @@ QStatus ParseMessagesResponse(Json::Value receivedResponse, ResponseMessage& par
 
                                                     if (!AddressCandidates->candidates.empty()) {
                                                         if (addressCandidatesObj.isMember(STUNInfo)) {
-                                                            Json::Value STUNInfoObj = addressCandidatesObj[STUNInfo];
+                                                            const Json::ArenaValue& STUNInfoObj = addressCandidatesObj[STUNInfo];
 
                                                             if (STUNInfoObj.isMember(address)) {
                                                                 if (STUNInfoObj.isMember(acct)) {
@@ -835,7 +835,7 @@ QStatus ParseMessagesResponse(Json::Value receivedResponse, ResponseMessage& par
 
                                                                             if (STUNInfoObj.isMember(relay)) {
 
-                                                                                Json::Value relayObj = STUNInfoObj[relay];
+                                                                                const Json::ArenaValue& relayObj = STUNInfoObj[relay];
 
                                                                                 if (relayObj.isMember(address)) {
                                                                                     if (relayObj.isMember(port)) {
@@ -916,7 +916,7 @@ QStatus ParseMessagesResponse(Json::Value receivedResponse, ResponseMessage& par
                         QCC_DbgPrintf(("ParseMessagesResponse(): [%d] Match Revoked Message", j));
 
                         if (msgsObjArrayMember.isMember(matchRevoked)) {
-                            Json::Value revokeObj = msgsObjArrayMember[matchRevoked];
+                            const Json::ArenaValue& revokeObj = msgsObjArrayMember[matchRevoked];
 
                             if (revokeObj.isMember(peerAddr)) {
                                 tempMsg.type = MATCH_REVOKED_RESPONSE;
@@ -935,7 +935,7 @@ QStatus ParseMessagesResponse(Json::Value receivedResponse, ResponseMessage& par
 
                                 if ((!revokeObj.isMember(deleteAll)) || (!MatchRevoked->deleteAll)) {
                                     if (revokeObj.isMember(services)) {
-                                        Json::Value servicesObj = revokeObj[services];
+                                        const Json::ArenaValue& servicesObj = revokeObj[services];
 
                                         if (servicesObj.isArray()) {
                                             if (!servicesObj.empty()) {
@@ -968,7 +968,7 @@ QStatus ParseMessagesResponse(Json::Value receivedResponse, ResponseMessage& par
                         QCC_DbgPrintf(("ParseMessagesResponse(): [%d] Start ICE Checks Message", j));
 
                         if (msgsObjArrayMember.isMember(startICEChecks)) {
-                            Json::Value startICEChecksObj = msgsObjArrayMember[startICEChecks];
+                            const Json::ArenaValue& startICEChecksObj = msgsObjArrayMember[startICEChecks];
 
                             if (startICEChecksObj.isMember(peerAddr)) {
                                 tempMsg.type = START_ICE_CHECKS_RESPONSE;
@@ -1064,7 +1064,7 @@ String GenerateJSONClientLoginRequest(ClientLoginRequest request)
 /**
  * Worker function used to parse the client login first response
  */
-QStatus ParseClientLoginFirstResponse(Json::Value receivedResponse, ClientLoginFirstResponse& parsedResponse)
+QStatus ParseClientLoginFirstResponse(const Json::ArenaValue& receivedResponse, ClientLoginFirstResponse& parsedResponse)
 {
     QStatus status = ER_OK;
 
@@ -1088,7 +1088,7 @@ QStatus ParseClientLoginFirstResponse(Json::Value receivedResponse, ClientLoginF
 /**
  * Worker function used to parse a client login final response
  */
-QStatus ParseClientLoginFinalResponse(Json::Value receivedResponse, ClientLoginFinalResponse& parsedResponse)
+QStatus ParseClientLoginFinalResponse(const Json::ArenaValue& receivedResponse, ClientLoginFinalResponse& parsedResponse)
 {
     QStatus status = ER_OK;
 
@@ -1116,7 +1116,7 @@ QStatus ParseClientLoginFinalResponse(Json::Value receivedResponse, ClientLoginF
                     parsedResponse.SetpeerAddr(String(receivedResponse[peerAddr].asCString()));
                     QCC_DbgPrintf(("ParseClientLoginFinalResponse(): peerAddr = %s", receivedResponse[peerAddr].asCString()));
 
-                    Json::Value configDataObj = receivedResponse[configData];
+                    const Json::ArenaValue& configDataObj = receivedResponse[configData];
 
                     if (configDataObj.isMember(Tkeepalive)) {
 
@@ -1539,12 +1539,12 @@ String GenerateJSONCandidates(ICECandidatesMessage message);
 /**
  * Worker function used to parse a generic response
  */
-QStatus ParseGenericResponse(Json::Value receivedResponse, GenericResponse& parsedResponse);
+QStatus ParseGenericResponse(const Json::ArenaValue& receivedResponse, GenericResponse& parsedResponse);
 
 /**
  * Worker function used to parse a refresh token response
  */
-QStatus ParseTokenRefreshResponse(Json::Value receivedResponse, TokenRefreshResponse& parsedResponse);
+QStatus ParseTokenRefreshResponse(const Json::ArenaValue& receivedResponse, TokenRefreshResponse& parsedResponse);
 
 /**
  * Worker function used to print a parsed response
@@ -1554,7 +1554,7 @@ void PrintMessageResponse(Response response);
 /**
  * Worker function used to parse a messages response
  */
-QStatus ParseMessagesResponse(Json::Value receivedResponse, ResponseMessage& parsedResponse);
+QStatus ParseMessagesResponse(const Json::ArenaValue& receivedResponse, ResponseMessage& parsedResponse);
 
 /**
  * Worker function used to generate the string corresponding
@@ -1571,12 +1571,12 @@ String GenerateJSONClientLoginRequest(ClientLoginRequest request);
 /**
  * Worker function used to parse the client login first response
  */
-QStatus ParseClientLoginFirstResponse(Json::Value receivedResponse, ClientLoginFirstResponse& parsedResponse);
+QStatus ParseClientLoginFirstResponse(const Json::ArenaValue& receivedResponse, ClientLoginFirstResponse& parsedResponse);
 
 /**
  * Worker function used to parse the client login final response
  */
-QStatus ParseClientLoginFinalResponse(Json::Value receivedResponse, ClientLoginFinalResponse& parsedResponse);
+QStatus ParseClientLoginFinalResponse(const Json::ArenaValue& receivedResponse, ClientLoginFinalResponse& parsedResponse);
 
 /**
  * Worker function used to generate the enum corresponding
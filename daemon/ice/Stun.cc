@@ -31,6 +31,7 @@
 #include <StunAttribute.h>
 #include <StunIOInterface.h>
 #include <StunMessage.h>
+#include <StunMessageView.h>
 #include <StunTransactionID.h>
 
 using namespace qcc;
@@ -426,6 +427,82 @@ exit:
     return status;
 }
 
+QStatus Stun::SendStunMessage(const StunMessageBuilder& msg, IPAddress addr, uint16_t port, bool relayMsg)
+{
+    QCC_DbgTrace(("Stun::SendStunMessage(msg = <%u octets>, addr = %s, port = %u, relayMsg = %s) [sockfd = %d]",
+                  msg.Size(),
+                  addr.ToString().c_str(),
+                  port,
+                  relayMsg ? "YES" : "NO",
+                  sockfd));
+
+    QStatus status;
+    size_t sent = 0;
+    size_t expectedSent = 0;
+
+    if (!opened) {
+        return ER_STUN_SOCKET_NOT_OPEN;
+    }
+
+    if ((msg.GetTypeClass() == STUN_MSG_REQUEST_CLASS) && (msg.GetHMACKey() != NULL)) {
+        StunTransactionID t;
+        msg.GetTransactionID(t);
+        StunMessage::keyInfo keydata;
+        keydata.key = const_cast<uint8_t*>(msg.GetHMACKey());
+        keydata.keyLen = msg.GetHMACKeyLength();
+        expectedResponses[t] = keydata;
+    }
+
+    QCC_DbgPrintf(("TX: Sending %u byte STUN message", msg.Size()));
+    QCC_DbgLocalData(msg.GetBuffer(), msg.Size());
+
+    frameLock.Lock();
+    if (type == QCC_SOCK_STREAM) {
+        status = ER_NOT_IMPLEMENTED;
+        QCC_LogError(status, ("Sending STUN message"));
+    } else if (relayMsg) {
+        // Relayed UDP messages must be wrapped in a STUN message.
+        uint8_t rBuf[StunMessageBuilder::CHECK_BUF_SIZE];
+        StunMessageBuilder rMsg(rBuf, sizeof(rBuf), STUN_MSG_INDICATION_CLASS, STUN_MSG_SEND_METHOD);
+
+        status = rMsg.AddString(STUN_ATTR_USERNAME, STUNInfo.acct);
+        if (status == ER_OK) {
+            status = rMsg.AddXorAddress(STUN_ATTR_XOR_PEER_ADDRESS, addr, port);
+        }
+        if (status == ER_OK) {
+            status = rMsg.AddXorAddress(STUN_ATTR_ALLOCATED_XOR_SERVER_REFLEXIVE_ADDRESS,
+                                        localSrflxCandidate.addr, localSrflxCandidate.port);
+        }
+        if (status == ER_OK) {
+            status = rMsg.AddFlag(STUN_ATTR_ICE_CHECK_FLAG);
+        }
+        if (status == ER_OK) {
+            status = rMsg.AddAttribute(STUN_ATTR_DATA, msg.GetBuffer(), msg.Size());
+        }
+        if (status == ER_OK) {
+            status = rMsg.AddMessageIntegrity(hmacKey, hmacKeyLen);
+        }
+        if (status == ER_OK) {
+            status = rMsg.AddFingerprint();
+        }
+        if (status == ER_OK) {
+            expectedSent = rMsg.Size();
+            status = SendTo(sockfd, turnAddr, turnPort, rMsg.GetBuffer(), rMsg.Size(), sent);
+        }
+    } else {
+        expectedSent = msg.Size();
+        status = SendTo(sockfd, addr, port, msg.GetBuffer(), msg.Size(), sent);
+    }
+    frameLock.Unlock();
+
+    if ((status == ER_OK) && (sent != expectedSent)) {
+        status = ER_STUN_FAILED_TO_SEND_MSG;
+        QCC_LogError(status, ("Sent %u does not match expected (%u)", sent, expectedSent));
+    }
+
+    return status;
+}
+
 void Stun::ReceiveTCP()
 {
     // To be implemented...
@@ -456,48 +533,36 @@ void Stun::ReceiveUDP()
 
             if (StunMessage::ExtractMessageMethod(rawMsgType) == STUN_MSG_DATA_METHOD) {
                 // parse message and extract DATA attribute contents.
-                uint8_t* dummyHmac = new uint8_t[hmacKeyLen];
-                StunMessage msg("", dummyHmac, hmacKeyLen);
+                StunMessageView msg;
                 QStatus status;
 
                 status = msg.Parse(buf, bufSize);
                 if (status == ER_OK) {
-                    StunMessage::const_iterator iter;
-
-                    for (iter = msg.Begin(); iter != msg.End(); ++iter) {
-                        if ((*iter)->GetType() == STUN_ATTR_DATA) {
-                            StunAttributeData* data = reinterpret_cast<StunAttributeData*>(*iter);
-                            ScatterGatherList::const_iterator sgiter = data->GetData().Begin();
-
-                            /*
-                             * Because the message was parsed, the data
-                             * SG-List in the DATA attribute is guaranteed to
-                             * be have only a single element.  Furthermore,
-                             * that element will refer to a region of memory
-                             * that is fully contained within the space
-                             * allocated for the StunBuffer that was allocated
-                             * above.  Therefore, we just point the sb.buf to
-                             * the data region instead of performing a data
-                             * copy that will involve overlapping memory
-                             * regions.
-                             */
-                            sb.buf = reinterpret_cast<uint8_t*>(sgiter->buf);
-                            sb.len = sgiter->len;
-
-                            // Now that STUN wrapped relayed msg is extracted,
-                            // need to determine if wrapped message is a STUN
-                            // message for ICE or not.
-                            isStunMsg = ((sb.len >= StunMessage::MIN_MSG_SIZE) &&
-                                         StunMessage::IsStunMessage(sb.buf, sb.len));
-                        }
-                        if ((*iter)->GetType() == STUN_ATTR_XOR_PEER_ADDRESS) {
-                            StunAttributeXorPeerAddress* sa = reinterpret_cast<StunAttributeXorPeerAddress*>(*iter);
-                            sa->GetAddress(sb.addr, sb.port);
-                        }
+                    const uint8_t* data;
+                    uint16_t dataLen;
+
+                    if (msg.Find(STUN_ATTR_DATA, data, dataLen)) {
+                        /*
+                         * The DATA attribute refers to a region of memory
+                         * that is fully contained within the space
+                         * allocated for the StunBuffer that was allocated
+                         * above.  Therefore, we just point the sb.buf to
+                         * the data region instead of performing a data
+                         * copy that will involve overlapping memory
+                         * regions.
+                         */
+                        sb.buf = const_cast<uint8_t*>(data);
+                        sb.len = dataLen;
+
+                        // Now that STUN wrapped relayed msg is extracted,
+                        // need to determine if wrapped message is a STUN
+                        // message for ICE or not.
+                        isStunMsg = ((sb.len >= StunMessage::MIN_MSG_SIZE) &&
+                                     StunMessage::IsStunMessage(sb.buf, sb.len));
                     }
+                    msg.GetAddress(STUN_ATTR_XOR_PEER_ADDRESS, sb.addr, sb.port);
                     sb.relayed = true;
                 }
-                delete [] dummyHmac;
             }
         }
 
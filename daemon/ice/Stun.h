@@ -37,6 +37,7 @@
 #include <qcc/IPAddress.h>
 #include <qcc/Thread.h>
 #include <StunMessage.h>
+#include <StunMessageBuilder.h>
 #include "RendezvousServerInterface.h"
 
 using namespace qcc;
@@ -211,6 +212,20 @@ class Stun {
                             uint16_t destPort,
                             bool relayMsg);
 
+    /**
+     * Send a STUN message that was rendered with a StunMessageBuilder.
+     *
+     * @param msg       Rendered STUN message to be sent.
+     * @param destAddr  Destination IP address
+     * @param destPort  Destination IP port number
+     * @param RelayMsg  Set to "true" if message must be relayed via the TURN server.
+     * @return Indication of success or failure.
+     */
+    QStatus SendStunMessage(const StunMessageBuilder& msg,
+                            IPAddress destAddr,
+                            uint16_t destPort,
+                            bool relayMsg);
+
     /**
      * Receive a STUN message from any sender, and return the address of the sender.
      *
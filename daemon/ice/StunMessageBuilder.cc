@@ -0,0 +1,221 @@
+/**
+ * @file
+ *
+ * This file implements the STUN Message Builder class
+ */
+
+/******************************************************************************
+ * Copyright 2012, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#include <assert.h>
+#include <string.h>
+#include <qcc/platform.h>
+#include <qcc/Crypto.h>
+#include <qcc/Debug.h>
+#include <StunAttributeFingerprint.h>
+#include <StunMessage.h>
+#include <StunMessageBuilder.h>
+#include "Status.h"
+
+#define QCC_MODULE "STUN_MESSAGE"
+
+using namespace qcc;
+
+enum IPFamily {
+    IPV4 = 0x01,
+    IPV6 = 0x02
+};
+
+static inline void Put16(uint8_t* p, uint16_t v)
+{
+    p[0] = static_cast<uint8_t>(v >> 8);
+    p[1] = static_cast<uint8_t>(v);
+}
+
+static inline void Put32(uint8_t* p, uint32_t v)
+{
+    Put16(p, static_cast<uint16_t>(v >> 16));
+    Put16(p + sizeof(uint16_t), static_cast<uint16_t>(v));
+}
+
+StunMessageBuilder::StunMessageBuilder(uint8_t* buf, size_t bufSize,
+                                       StunMsgTypeClass msgClass, StunMsgTypeMethod msgMethod) :
+    buf(buf), bufSize(bufSize), pos(StunMessage::MIN_MSG_SIZE), msgClass(msgClass), hmacKey(NULL), hmacKeyLen(0)
+{
+    assert(msgClass == STUN_MSG_REQUEST_CLASS || msgClass == STUN_MSG_INDICATION_CLASS);
+    Init(msgClass, msgMethod);
+    Crypto_GetRandomBytes(buf + StunMessage::HEADER_SIZE, StunTransactionID::SIZE);
+}
+
+StunMessageBuilder::StunMessageBuilder(uint8_t* buf, size_t bufSize,
+                                       StunMsgTypeClass msgClass, StunMsgTypeMethod msgMethod,
+                                       const StunTransactionID& tid) :
+    buf(buf), bufSize(bufSize), pos(StunMessage::MIN_MSG_SIZE), msgClass(msgClass), hmacKey(NULL), hmacKeyLen(0)
+{
+    Init(msgClass, msgMethod);
+    memcpy(buf + StunMessage::HEADER_SIZE, tid.GetValue(), StunTransactionID::SIZE);
+}
+
+void StunMessageBuilder::Init(StunMsgTypeClass msgClass, StunMsgTypeMethod msgMethod)
+{
+    assert(bufSize >= StunMessage::MIN_MSG_SIZE);
+    Put16(buf, static_cast<uint16_t>(msgClass | msgMethod));
+    Put16(buf + sizeof(uint16_t), 0);
+    Put32(buf + 2 * sizeof(uint16_t), StunMessage::MAGIC_COOKIE);
+}
+
+void StunMessageBuilder::GetTransactionID(StunTransactionID& tid) const
+{
+    const uint8_t* tidBuf = buf + StunMessage::HEADER_SIZE;
+    size_t tidSize = StunTransactionID::SIZE;
+    tid.Parse(tidBuf, tidSize);
+}
+
+uint8_t* StunMessageBuilder::Reserve(StunAttrType type, size_t len)
+{
+    size_t padded = (len + 3) & ~static_cast<size_t>(0x3);
+    size_t attrSize = StunAttribute::ATTR_HEADER_SIZE + padded;
+
+    if ((len > 0xffff) || (attrSize > (bufSize - pos))) {
+        QCC_LogError(ER_BUFFER_TOO_SMALL, ("Adding attribute %04x (%u octets)", type, len));
+        return NULL;
+    }
+
+    uint8_t* attr = buf + pos;
+    Put16(attr, static_cast<uint16_t>(type));
+    Put16(attr + sizeof(uint16_t), static_cast<uint16_t>(len));
+
+    // Zero the padding so the message is the same as StunMessage::RenderBinary produces.
+    memset(attr + StunAttribute::ATTR_HEADER_SIZE + len, 0, padded - len);
+
+    pos += attrSize;
+    Put16(buf + sizeof(uint16_t), static_cast<uint16_t>(pos - StunMessage::MIN_MSG_SIZE));
+
+    return attr + StunAttribute::ATTR_HEADER_SIZE;
+}
+
+QStatus StunMessageBuilder::AddAttribute(StunAttrType type, const void* value, size_t len)
+{
+    uint8_t* attr = Reserve(type, len);
+    if (!attr) {
+        return ER_BUFFER_TOO_SMALL;
+    }
+    if (len) {
+        memcpy(attr, value, len);
+    }
+    return ER_OK;
+}
+
+QStatus StunMessageBuilder::AddUint32(StunAttrType type, uint32_t value)
+{
+    uint8_t* attr = Reserve(type, sizeof(value));
+    if (!attr) {
+        return ER_BUFFER_TOO_SMALL;
+    }
+    Put32(attr, value);
+    return ER_OK;
+}
+
+QStatus StunMessageBuilder::AddUint64(StunAttrType type, uint64_t value)
+{
+    uint8_t* attr = Reserve(type, sizeof(value));
+    if (!attr) {
+        return ER_BUFFER_TOO_SMALL;
+    }
+    Put32(attr, static_cast<uint32_t>(value >> 32));
+    Put32(attr + sizeof(uint32_t), static_cast<uint32_t>(value));
+    return ER_OK;
+}
+
+QStatus StunMessageBuilder::AddRequestedTransport(uint8_t protocol)
+{
+    // Protocol followed by 3 octets of RFFU (TURN draft-13 section 14.7).
+    uint8_t value[sizeof(uint32_t)] = { protocol, 0, 0, 0 };
+    return AddAttribute(STUN_ATTR_REQUESTED_TRANSPORT, value, sizeof(value));
+}
+
+QStatus StunMessageBuilder::AddXorAddress(StunAttrType type, const IPAddress& addr, uint16_t port)
+{
+    uint8_t rawAddr[IPAddress::IPv6_SIZE];
+    uint8_t family;
+
+    switch (addr.Size()) {
+    case IPAddress::IPv4_SIZE:
+        family = IPV4;
+        break;
+
+    case IPAddress::IPv6_SIZE:
+        family = IPV6;
+        break;
+
+    default:
+        QCC_LogError(ER_STUN_INVALID_ADDR_FAMILY, ("Adding attribute %04x", type));
+        return ER_STUN_INVALID_ADDR_FAMILY;
+    }
+
+    QStatus status = addr.RenderIPBinary(rawAddr, sizeof(rawAddr));
+    if (status != ER_OK) {
+        return status;
+    }
+
+    uint8_t* attr = Reserve(type, 2 * sizeof(uint16_t) + addr.Size());
+    if (!attr) {
+        return ER_BUFFER_TOO_SMALL;
+    }
+
+    // The address is XOR'd with the magic cookie and transaction ID that follow the length field.
+    attr[0] = 0;
+    attr[1] = family;
+    Put16(attr + sizeof(uint16_t), port ^ static_cast<uint16_t>(StunMessage::MAGIC_COOKIE >> 16));
+    for (size_t i = 0; i < addr.Size(); ++i) {
+        attr[2 * sizeof(uint16_t) + i] = rawAddr[i] ^ buf[2 * sizeof(uint16_t) + i];
+    }
+    return ER_OK;
+}
+
+QStatus StunMessageBuilder::AddMessageIntegrity(const uint8_t* hmacKey, size_t keyLen)
+{
+    assert(hmacKey != NULL);
+
+    // Reserving the attribute sets the length field to end just after
+    // MESSAGE-INTEGRITY, which is what the HMAC is computed over (RFC 5389
+    // section 15.4).
+    size_t hmacSize = pos;
+    uint8_t* attr = Reserve(STUN_ATTR_MESSAGE_INTEGRITY, Crypto_SHA1::DIGEST_SIZE);
+    if (!attr) {
+        return ER_BUFFER_TOO_SMALL;
+    }
+
+    Crypto_SHA1 sha1;
+    sha1.Init(hmacKey, keyLen);
+    sha1.Update(buf, hmacSize);
+    sha1.GetDigest(attr);
+
+    this->hmacKey = hmacKey;
+    this->hmacKeyLen = keyLen;
+    return ER_OK;
+}
+
+QStatus StunMessageBuilder::AddFingerprint(void)
+{
+    size_t crcSize = pos;
+    uint8_t* attr = Reserve(STUN_ATTR_FINGERPRINT, sizeof(uint32_t));
+    if (!attr) {
+        return ER_BUFFER_TOO_SMALL;
+    }
+    Put32(attr, StunAttributeFingerprint::ComputeCRC(buf, crcSize) ^ StunAttributeFingerprint::MAGIC_XOR);
+    return ER_OK;
+}
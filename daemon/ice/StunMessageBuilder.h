@@ -0,0 +1,194 @@
+#ifndef _STUNMESSAGEBUILDER_H
+#define _STUNMESSAGEBUILDER_H
+/**
+ * @file
+ *
+ * This file defines a STUN message builder that renders straight into a
+ * caller supplied buffer.
+ */
+
+/******************************************************************************
+ * Copyright 2012, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#ifndef __cplusplus
+#error Only include StunMessageBuilder.h in C++ code.
+#endif
+
+#include <qcc/platform.h>
+#include <qcc/IPAddress.h>
+#include <qcc/String.h>
+#include <StunMessage.h>
+#include <StunTransactionID.h>
+#include <types.h>
+#include "Status.h"
+
+using namespace qcc;
+
+/**
+ * The StunMessageBuilder class renders a STUN message attribute by attribute
+ * into a buffer owned by the caller, typically on the stack.  It produces the
+ * same octets as building a StunMessage and calling RenderBinary() but
+ * without allocating the attributes or a scatter-gather list.
+ *
+ * Attributes are written in the order they are added.  MESSAGE-INTEGRITY
+ * and FINGERPRINT are computed over what has been written so far, so they
+ * must be added last, in that order.
+ */
+class StunMessageBuilder {
+  public:
+
+    /// Size of a stack buffer big enough for any ICE connectivity check (the IPv6 minimum MTU).
+    static const size_t CHECK_BUF_SIZE = 1280;
+
+    /**
+     * Start a STUN Request or Indication with a new random transaction ID.
+     *
+     * @param buf       Buffer to render into.
+     * @param bufSize   Size of the buffer.
+     * @param msgClass  STUN message class.
+     * @param msgMethod STUN message method.
+     */
+    StunMessageBuilder(uint8_t* buf, size_t bufSize, StunMsgTypeClass msgClass, StunMsgTypeMethod msgMethod);
+
+    /**
+     * Start a STUN message using the given transaction ID (for responses and
+     * retransmits).
+     *
+     * @param buf       Buffer to render into.
+     * @param bufSize   Size of the buffer.
+     * @param msgClass  STUN message class.
+     * @param msgMethod STUN message method.
+     * @param tid       Use this Transaction ID.
+     */
+    StunMessageBuilder(uint8_t* buf, size_t bufSize, StunMsgTypeClass msgClass, StunMsgTypeMethod msgMethod,
+                       const StunTransactionID& tid);
+
+    /**
+     * Add an attribute with an opaque value, padding it to a 32-bit boundary.
+     *
+     * @param type      STUN attribute type.
+     * @param value     Attribute value (may be NULL if len is 0).
+     * @param len       Length of the value.
+     *
+     * @return ER_OK or ER_BUFFER_TOO_SMALL.
+     */
+    QStatus AddAttribute(StunAttrType type, const void* value, size_t len);
+
+    /**
+     * Add a string attribute such as USERNAME or SOFTWARE.
+     */
+    QStatus AddString(StunAttrType type, const qcc::String& str) { return AddAttribute(type, str.data(), str.size()); }
+
+    /**
+     * Add a 32-bit attribute such as PRIORITY or LIFETIME.
+     */
+    QStatus AddUint32(StunAttrType type, uint32_t value);
+
+    /**
+     * Add a 64-bit attribute such as ICE-CONTROLLING or ICE-CONTROLLED.
+     */
+    QStatus AddUint64(StunAttrType type, uint64_t value);
+
+    /**
+     * Add an attribute without a value such as USE-CANDIDATE.
+     */
+    QStatus AddFlag(StunAttrType type) { return AddAttribute(type, NULL, 0); }
+
+    /**
+     * Add a REQUESTED-TRANSPORT attribute.
+     */
+    QStatus AddRequestedTransport(uint8_t protocol);
+
+    /**
+     * Add an XOR address attribute such as XOR-PEER-ADDRESS.  The address
+     * and port are XOR'd with the magic cookie and transaction ID.
+     *
+     * @param type      STUN attribute type.
+     * @param addr      IP address.
+     * @param port      Port.
+     *
+     * @return ER_OK, ER_BUFFER_TOO_SMALL or ER_STUN_INVALID_ADDR_FAMILY.
+     */
+    QStatus AddXorAddress(StunAttrType type, const IPAddress& addr, uint16_t port);
+
+    /**
+     * Add the MESSAGE-INTEGRITY attribute.  The key is remembered so the
+     * response can be matched up with it (see GetHMACKey()).
+     *
+     * @param hmacKey   HMAC key used for computing the message integrity value.
+     * @param keyLen    Length of the key.
+     *
+     * @return ER_OK or ER_BUFFER_TOO_SMALL.
+     */
+    QStatus AddMessageIntegrity(const uint8_t* hmacKey, size_t keyLen);
+
+    /**
+     * Add the FINGERPRINT attribute.  This must be the last attribute.
+     *
+     * @return ER_OK or ER_BUFFER_TOO_SMALL.
+     */
+    QStatus AddFingerprint(void);
+
+    /**
+     * @return The rendered message.
+     */
+    const uint8_t* GetBuffer(void) const { return buf; }
+
+    /**
+     * @return Number of octets rendered so far.
+     */
+    size_t Size(void) const { return pos; }
+
+    StunMsgTypeClass GetTypeClass(void) const { return msgClass; }
+
+    /**
+     * Get a copy of the message transaction ID.
+     *
+     * @param tid OUT: Where the STUN Message Transaction ID should be copied.
+     */
+    void GetTransactionID(StunTransactionID& tid) const;
+
+    /**
+     * @return The HMAC key passed to AddMessageIntegrity() or NULL.
+     */
+    const uint8_t* GetHMACKey(void) const { return hmacKey; }
+
+    size_t GetHMACKeyLength(void) const { return hmacKeyLen; }
+
+  private:
+
+    StunMessageBuilder(const StunMessageBuilder& other);
+    StunMessageBuilder& operator=(const StunMessageBuilder& other);
+
+    uint8_t* buf;                   ///< Buffer being rendered into.
+    size_t bufSize;                 ///< Size of the buffer.
+    size_t pos;                     ///< Number of octets rendered.
+    StunMsgTypeClass msgClass;      ///< Message type class.
+    const uint8_t* hmacKey;         ///< Key used for MESSAGE-INTEGRITY.
+    size_t hmacKeyLen;              ///< Length of hmacKey.
+
+    void Init(StunMsgTypeClass msgClass, StunMsgTypeMethod msgMethod);
+
+    /**
+     * Write an attribute header and update the message length field to
+     * cover the attribute.
+     *
+     * @return Pointer to where the value goes or NULL if it does not fit.
+     */
+    uint8_t* Reserve(StunAttrType type, size_t len);
+};
+
+#endif
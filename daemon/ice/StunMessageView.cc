@@ -0,0 +1,372 @@
+/**
+ * @file
+ *
+ * This file implements the STUN Message View class
+ */
+
+/******************************************************************************
+ * Copyright 2012, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#include <assert.h>
+#include <string.h>
+#include <qcc/platform.h>
+#include <qcc/Crypto.h>
+#include <qcc/Debug.h>
+#include <StunAttributeFingerprint.h>
+#include <StunMessage.h>
+#include <StunMessageView.h>
+#include "Status.h"
+
+#define QCC_MODULE "STUN_MESSAGE"
+
+using namespace qcc;
+
+enum IPFamily {
+    IPV4 = 0x01,
+    IPV6 = 0x02
+};
+
+static inline uint16_t Get16(const uint8_t* p)
+{
+    return (static_cast<uint16_t>(p[0]) << 8) | p[1];
+}
+
+static inline uint32_t Get32(const uint8_t* p)
+{
+    return ((static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+            (static_cast<uint32_t>(p[2]) << 8) | p[3]);
+}
+
+QStatus StunMessageView::CheckAttribute(uint16_t type, const uint8_t* value, uint16_t len)
+{
+    size_t expected;
+
+    switch (static_cast<StunAttrType>(type)) {
+    case STUN_ATTR_MAPPED_ADDRESS:
+    case STUN_ATTR_ALTERNATE_SERVER:
+    case STUN_ATTR_XOR_MAPPED_ADDRESS:
+    case STUN_ATTR_XOR_PEER_ADDRESS:
+    case STUN_ATTR_XOR_RELAYED_ADDRESS:
+    case STUN_ATTR_ALLOCATED_XOR_SERVER_REFLEXIVE_ADDRESS:
+        if (len < 2) {
+            return ER_STUN_ATTR_SIZE_MISMATCH;
+        }
+        switch (value[1]) {
+        case IPV4:
+            expected = 2 * sizeof(uint16_t) + IPAddress::IPv4_SIZE;
+            break;
+
+        case IPV6:
+            expected = 2 * sizeof(uint16_t) + IPAddress::IPv6_SIZE;
+            break;
+
+        default:
+            return ER_STUN_INVALID_ADDR_FAMILY;
+        }
+        break;
+
+    case STUN_ATTR_ERROR_CODE:
+        if (len < sizeof(uint32_t)) {
+            return ER_STUN_ATTR_SIZE_MISMATCH;
+        }
+        // Same range checks as StunAttributeErrorCode::Parse.
+        if (((value[2] & 0x07) < 3) || ((value[2] & 0x07) > 6) || (value[3] > 99)) {
+            return ER_STUN_INVALID_ERROR_CODE;
+        }
+        return ER_OK;
+
+    case STUN_ATTR_UNKNOWN_ATTRIBUTES:
+        return ((len & 0x1) == 0) ? ER_OK : ER_STUN_ATTR_SIZE_MISMATCH;
+
+    case STUN_ATTR_MESSAGE_INTEGRITY:
+        expected = Crypto_SHA1::DIGEST_SIZE;
+        break;
+
+    case STUN_ATTR_FINGERPRINT:
+    case STUN_ATTR_PRIORITY:
+    case STUN_ATTR_LIFETIME:
+    case STUN_ATTR_CHANNEL_NUMBER:
+    case STUN_ATTR_REQUESTED_TRANSPORT:
+    case STUN_ATTR_EVEN_PORT:
+        expected = sizeof(uint32_t);
+        break;
+
+    case STUN_ATTR_ICE_CONTROLLED:
+    case STUN_ATTR_ICE_CONTROLLING:
+    case STUN_ATTR_RESERVATION_TOKEN:
+        expected = sizeof(uint64_t);
+        break;
+
+    case STUN_ATTR_USE_CANDIDATE:
+    case STUN_ATTR_ICE_CHECK_FLAG:
+    case STUN_ATTR_DONT_FRAGMENT:
+        expected = 0;
+        break;
+
+    default:
+        // USERNAME, SOFTWARE, DATA and unknown attributes may have any length.
+        return ER_OK;
+    }
+
+    return (len == expected) ? ER_OK : ER_STUN_ATTR_SIZE_MISMATCH;
+}
+
+QStatus StunMessageView::Parse(const uint8_t* buf, size_t bufSize)
+{
+    QStatus status = ER_OK;
+    uint16_t rawMsgType;
+    size_t end;
+    size_t pos;
+    bool hasUsername = false;
+    bool hasFingerprint = false;
+
+    QCC_DbgTrace(("StunMessageView::Parse(*buf, bufSize = %u)", bufSize));
+
+    assert(buf != NULL);
+
+    msg = buf;
+    msgSize = 0;
+    numAttrs = 0;
+    miIndex = MAX_ATTRS;
+
+    if (bufSize < StunMessage::MIN_MSG_SIZE) {
+        status = ER_BUFFER_TOO_SMALL;
+        QCC_DbgRemoteError(("Checking header size"));
+        goto exit;
+    }
+
+    rawMsgType = Get16(buf);
+    end = StunMessage::MIN_MSG_SIZE + Get16(buf + sizeof(uint16_t));
+
+    if (((rawMsgType & 0xc000) != 0) || ((end & 0x3) != 0) ||
+        (Get32(buf + 2 * sizeof(uint16_t)) != StunMessage::MAGIC_COOKIE) ||
+        !StunMessage::IsTypeOK(rawMsgType)) {
+        status = ER_STUN_INVALID_MSG_TYPE;
+        QCC_DbgRemoteError(("Invalid message type: %04x", rawMsgType));
+        goto exit;
+    }
+
+    if (end > bufSize) {
+        status = ER_BUFFER_TOO_SMALL;
+        QCC_DbgRemoteError(("Checking message size (missing %u bytes)", end - bufSize));
+        goto exit;
+    }
+
+    for (pos = StunMessage::MIN_MSG_SIZE; pos < end;) {
+        uint16_t type;
+        uint16_t len;
+        size_t valuePos;
+
+        if (hasFingerprint) {
+            // RFC 5389 section 15.5: FINGERPRINT is always the last attribute.
+            status = ER_STUN_INVALID_FINGERPRINT;
+            QCC_DbgRemoteError(("Attribute after FINGERPRINT"));
+            goto exit;
+        }
+
+        if ((end - pos) < StunAttribute::ATTR_HEADER_SIZE) {
+            status = ER_BUFFER_TOO_SMALL;
+            QCC_DbgRemoteError(("Parsing attribute header"));
+            goto exit;
+        }
+
+        type = Get16(buf + pos);
+        len = Get16(buf + pos + sizeof(uint16_t));
+        valuePos = pos + StunAttribute::ATTR_HEADER_SIZE;
+
+        if (((static_cast<size_t>(len) + 3) & ~static_cast<size_t>(0x3)) > (end - valuePos)) {
+            status = ER_BUFFER_TOO_SMALL;
+            QCC_DbgRemoteError(("Parsing attribute %04x", type));
+            goto exit;
+        }
+
+        status = CheckAttribute(type, buf + valuePos, len);
+        if (status != ER_OK) {
+            QCC_DbgRemoteError(("Parsing attribute %04x (%u octets)", type, len));
+            goto exit;
+        }
+
+        if (type == STUN_ATTR_FINGERPRINT) {
+            uint32_t fingerprint = Get32(buf + valuePos) ^ StunAttributeFingerprint::MAGIC_XOR;
+            if (fingerprint != StunAttributeFingerprint::ComputeCRC(buf, pos)) {
+                status = ER_STUN_INVALID_FINGERPRINT;
+                QCC_LogError(status, ("Verifying STUN message fingerprint."));
+                goto exit;
+            }
+            hasFingerprint = true;
+        }
+
+        // RFC 5389 section 15.4: attributes between MESSAGE-INTEGRITY and
+        // FINGERPRINT are not covered by the HMAC and are ignored.
+        if (!HasMessageIntegrity() || (type == STUN_ATTR_FINGERPRINT)) {
+            if (numAttrs == MAX_ATTRS) {
+                status = ER_STUN_TOO_MANY_ATTRIBUTES;
+                QCC_DbgRemoteError(("Indexing attribute %04x", type));
+                goto exit;
+            }
+            if (type == STUN_ATTR_MESSAGE_INTEGRITY) {
+                miIndex = numAttrs;
+            } else if (type == STUN_ATTR_USERNAME) {
+                hasUsername = true;
+            }
+            attrs[numAttrs].type = type;
+            attrs[numAttrs].offset = static_cast<uint16_t>(valuePos);
+            attrs[numAttrs].len = len;
+            ++numAttrs;
+        }
+
+        pos = valuePos + ((len + 3) & ~0x3);
+    }
+
+    // Section 10.1.2 checks, as done by StunMessage::Parse.
+    switch (StunMessage::ExtractMessageClass(rawMsgType)) {
+    case STUN_MSG_RESPONSE_CLASS:
+    case STUN_MSG_ERROR_CLASS:
+        if (hasUsername) {
+            status = ER_STUN_RESPONSE_WITH_USERNAME;
+            goto exit;
+        }
+        break;
+
+    case STUN_MSG_REQUEST_CLASS:
+        if (hasUsername != HasMessageIntegrity()) {
+            status = ER_STUN_ERR400_BAD_REQUEST;
+            goto exit;
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    msgSize = end;
+
+exit:
+    if (status != ER_OK) {
+        numAttrs = 0;
+        miIndex = MAX_ATTRS;
+    }
+    return status;
+}
+
+QStatus StunMessageView::CheckMessageIntegrity(const uint8_t* hmacKey, size_t keyLen) const
+{
+    uint8_t digest[Crypto_SHA1::DIGEST_SIZE];
+    Crypto_SHA1 sha1;
+
+    if (!HasMessageIntegrity() || (hmacKey == NULL)) {
+        return ER_STUN_INVALID_MESSAGE_INTEGRITY;
+    }
+
+    // The HMAC covers the message up to MESSAGE-INTEGRITY with the length
+    // field adjusted to end just after MESSAGE-INTEGRITY (RFC 5389 section 15.4).
+    size_t valuePos = attrs[miIndex].offset;
+    uint16_t fakeLen = static_cast<uint16_t>(valuePos + Crypto_SHA1::DIGEST_SIZE - StunMessage::MIN_MSG_SIZE);
+    uint8_t lengthBuf[] = { static_cast<uint8_t>(fakeLen >> 8),
+                            static_cast<uint8_t>(fakeLen & 0xff) };
+
+    sha1.Init(hmacKey, keyLen);
+    sha1.Update(msg, sizeof(uint16_t));
+    sha1.Update(lengthBuf, sizeof(lengthBuf));
+    sha1.Update(msg + 2 * sizeof(uint16_t),
+                valuePos - StunAttribute::ATTR_HEADER_SIZE - 2 * sizeof(uint16_t));
+    sha1.GetDigest(digest);
+
+    if (memcmp(digest, msg + valuePos, sizeof(digest)) != 0) {
+        return ER_STUN_INVALID_MESSAGE_INTEGRITY;
+    }
+    return ER_OK;
+}
+
+void StunMessageView::GetTransactionID(StunTransactionID& tid) const
+{
+    const uint8_t* buf = msg + StunMessage::HEADER_SIZE;
+    size_t bufSize = StunTransactionID::SIZE;
+    tid.Parse(buf, bufSize);
+}
+
+bool StunMessageView::Find(StunAttrType type, const uint8_t*& value, uint16_t& len) const
+{
+    for (size_t i = 0; i < numAttrs; ++i) {
+        if (attrs[i].type == type) {
+            value = msg + attrs[i].offset;
+            len = attrs[i].len;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool StunMessageView::GetUint32(StunAttrType type, uint32_t& value) const
+{
+    const uint8_t* buf;
+    uint16_t len;
+
+    if (!Find(type, buf, len) || (len != sizeof(uint32_t))) {
+        return false;
+    }
+    value = Get32(buf);
+    return true;
+}
+
+bool StunMessageView::GetUint64(StunAttrType type, uint64_t& value) const
+{
+    const uint8_t* buf;
+    uint16_t len;
+
+    if (!Find(type, buf, len) || (len != sizeof(uint64_t))) {
+        return false;
+    }
+    value = (static_cast<uint64_t>(Get32(buf)) << 32) | Get32(buf + sizeof(uint32_t));
+    return true;
+}
+
+bool StunMessageView::GetAddress(StunAttrType type, IPAddress& addr, uint16_t& port) const
+{
+    const uint8_t* buf;
+    uint16_t len;
+    uint8_t rawAddr[IPAddress::IPv6_SIZE];
+    size_t addrLen;
+
+    if (!Find(type, buf, len)) {
+        return false;
+    }
+
+    switch (type) {
+    case STUN_ATTR_MAPPED_ADDRESS:
+    case STUN_ATTR_ALTERNATE_SERVER:
+        port = Get16(buf + sizeof(uint16_t));
+        addrLen = len - 2 * sizeof(uint16_t);
+        addr = IPAddress(buf + 2 * sizeof(uint16_t), addrLen);
+        return true;
+
+    case STUN_ATTR_XOR_MAPPED_ADDRESS:
+    case STUN_ATTR_XOR_PEER_ADDRESS:
+    case STUN_ATTR_XOR_RELAYED_ADDRESS:
+    case STUN_ATTR_ALLOCATED_XOR_SERVER_REFLEXIVE_ADDRESS:
+        // The address is XOR'd with the magic cookie and transaction ID that follow the length field.
+        port = Get16(buf + sizeof(uint16_t)) ^ static_cast<uint16_t>(StunMessage::MAGIC_COOKIE >> 16);
+        addrLen = len - 2 * sizeof(uint16_t);
+        for (size_t i = 0; i < addrLen; ++i) {
+            rawAddr[i] = buf[2 * sizeof(uint16_t) + i] ^ msg[2 * sizeof(uint16_t) + i];
+        }
+        addr = IPAddress(rawAddr, addrLen);
+        return true;
+
+    default:
+        return false;
+    }
+}
@@ -0,0 +1,168 @@
+#ifndef _STUNMESSAGEVIEW_H
+#define _STUNMESSAGEVIEW_H
+/**
+ * @file
+ *
+ * This file defines a read-only view over a received STUN message.
+ */
+
+/******************************************************************************
+ * Copyright 2012, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#ifndef __cplusplus
+#error Only include StunMessageView.h in C++ code.
+#endif
+
+#include <qcc/platform.h>
+#include <qcc/IPAddress.h>
+#include <StunMessage.h>
+#include <StunTransactionID.h>
+#include <types.h>
+#include "Status.h"
+
+using namespace qcc;
+
+/**
+ * The StunMessageView class validates a STUN message in the buffer it was
+ * received into and indexes its attributes where they lie.  Nothing is
+ * copied or allocated, so the buffer must outlive the view.  Attribute values
+ * are decoded on request.
+ *
+ * Parse() accepts a subset of what StunMessage::Parse() accepts: the
+ * attributes StunMessage knows how to parse must have the sizes it expects,
+ * FINGERPRINT must be the last attribute and only FINGERPRINT may follow
+ * MESSAGE-INTEGRITY (RFC 5389 sections 15.4 and 15.5).
+ */
+class StunMessageView {
+  public:
+
+    /// Maximum number of attributes indexed in a single message.
+    static const size_t MAX_ATTRS = 32;
+
+    StunMessageView(void) : msg(NULL), msgSize(0), numAttrs(0), miIndex(MAX_ATTRS) { }
+
+    /**
+     * Validate a STUN message and index its attributes.  The FINGERPRINT
+     * attribute is verified if present.  MESSAGE-INTEGRITY is only located;
+     * use CheckMessageIntegrity() to verify it.
+     *
+     * @param buf       Buffer holding the message.
+     * @param bufSize   Number of octets in the buffer.  The buffer may hold
+     *                  more than one message.
+     *
+     * @return  Indication of success or failure.  On failure the view is empty.
+     */
+    QStatus Parse(const uint8_t* buf, size_t bufSize);
+
+    /**
+     * Verify the MESSAGE-INTEGRITY attribute against a key.
+     *
+     * @param hmacKey   HMAC key the sender should have used.
+     * @param keyLen    Length of the key.
+     *
+     * @return  ER_OK if the digest matches, ER_STUN_INVALID_MESSAGE_INTEGRITY
+     *          if it does not or the message has no MESSAGE-INTEGRITY.
+     */
+    QStatus CheckMessageIntegrity(const uint8_t* hmacKey, size_t keyLen) const;
+
+    StunMsgTypeClass GetTypeClass(void) const { return StunMessage::ExtractMessageClass(GetRawType()); }
+
+    StunMsgTypeMethod GetTypeMethod(void) const { return StunMessage::ExtractMessageMethod(GetRawType()); }
+
+    /**
+     * Get a copy of the message transaction ID.
+     *
+     * @param tid OUT: Where the STUN Message Transaction ID should be copied.
+     */
+    void GetTransactionID(StunTransactionID& tid) const;
+
+    /**
+     * Size of the whole message including the header.
+     *
+     * @return  Number of octets parsed from the buffer.
+     */
+    size_t Size(void) const { return msgSize; }
+
+    size_t GetNumAttributes(void) const { return numAttrs; }
+
+    StunAttrType GetAttributeType(size_t index) const { return static_cast<StunAttrType>(attrs[index].type); }
+
+    bool HasMessageIntegrity(void) const { return miIndex < numAttrs; }
+
+    /**
+     * Find the first attribute of the given type.
+     *
+     * @param type      STUN attribute type to look for.
+     * @param value     OUT: Pointer to the attribute value in the message buffer.
+     * @param len       OUT: Length of the attribute value without padding.
+     *
+     * @return  true if the message has such an attribute.
+     */
+    bool Find(StunAttrType type, const uint8_t*& value, uint16_t& len) const;
+
+    /**
+     * Get a 32-bit attribute such as PRIORITY or LIFETIME.
+     *
+     * @param type      STUN attribute type to look for.
+     * @param value     OUT: The attribute value in host byte order.
+     *
+     * @return  true if the message has a 32-bit attribute of that type.
+     */
+    bool GetUint32(StunAttrType type, uint32_t& value) const;
+
+    /**
+     * Get a 64-bit attribute such as ICE-CONTROLLING or ICE-CONTROLLED.
+     *
+     * @param type      STUN attribute type to look for.
+     * @param value     OUT: The attribute value in host byte order.
+     *
+     * @return  true if the message has a 64-bit attribute of that type.
+     */
+    bool GetUint64(StunAttrType type, uint64_t& value) const;
+
+    /**
+     * Get an address attribute.  The XOR address attributes are un-XOR'd
+     * with the magic cookie and transaction ID.
+     *
+     * @param type      STUN attribute type to look for.
+     * @param addr      OUT: The IP address.
+     * @param port      OUT: The port.
+     *
+     * @return  true if the message has an address attribute of that type.
+     */
+    bool GetAddress(StunAttrType type, IPAddress& addr, uint16_t& port) const;
+
+  private:
+
+    /// Location of an attribute value in the message buffer.
+    struct AttrRef {
+        uint16_t type;      ///< Attribute type.
+        uint16_t offset;    ///< Offset of the value from the start of the message.
+        uint16_t len;       ///< Length of the value without padding.
+    };
+
+    const uint8_t* msg;         ///< Start of the message in the receive buffer.
+    size_t msgSize;             ///< Message size including the header.
+    size_t numAttrs;            ///< Number of indexed attributes.
+    size_t miIndex;             ///< Index of MESSAGE-INTEGRITY (MAX_ATTRS if none).
+    AttrRef attrs[MAX_ATTRS];   ///< Attribute index.
+
+    uint16_t GetRawType(void) const { return (static_cast<uint16_t>(msg[0]) << 8) | msg[1]; }
+
+    static QStatus CheckAttribute(uint16_t type, const uint8_t* value, uint16_t len);
+};
+
+#endif
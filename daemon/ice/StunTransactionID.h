@@ -100,6 +100,13 @@ class StunTransactionID : public StunIOInterface {
      */
     void SetValue(StunTransactionID& other);
 
+    /**
+     * Get the raw transaction ID value.
+     *
+     * @return Pointer to the SIZE octets of the transaction ID.
+     */
+    const uint8_t* GetValue(void) const { return id; }
+
   private:
 
     uint8_t id[SIZE];      ///< The transaction ID
@@ -0,0 +1,169 @@
+/**
+ * @file
+ * @internal
+ * Sources of network interface change notifications for the IP name service.
+ */
+
+/******************************************************************************
+ * Copyright 2012, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#include <qcc/platform.h>
+
+#if defined(QCC_OS_LINUX) || defined(QCC_OS_ANDROID)
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#endif
+
+#include <qcc/Debug.h>
+
+#include "InterfaceMonitor.h"
+
+#define QCC_MODULE "IPNS"
+
+namespace ajn {
+
+InterfaceMonitor* InterfaceMonitor::Create()
+{
+#if defined(QCC_OS_LINUX) || defined(QCC_OS_ANDROID)
+    return new NetlinkInterfaceMonitor();
+#else
+    return new PollingInterfaceMonitor();
+#endif
+}
+
+#if defined(QCC_OS_LINUX) || defined(QCC_OS_ANDROID)
+
+QStatus NetlinkInterfaceMonitor::Start()
+{
+    QCC_DbgPrintf(("NetlinkInterfaceMonitor::Start()"));
+
+    if (m_sockFd != -1) {
+        return ER_OK;
+    }
+
+    int fd = socket(AF_NETLINK, SOCK_RAW, NETLINK_ROUTE);
+    if (fd < 0) {
+        QCC_LogError(ER_OS_ERROR, ("NetlinkInterfaceMonitor::Start(): socket() failed: %d - %s", errno, strerror(errno)));
+        return ER_OS_ERROR;
+    }
+
+    //
+    // The name service thread drains the socket whenever it becomes readable
+    // so we never want a read to block it.
+    //
+    int flags = fcntl(fd, F_GETFL, 0);
+    if ((flags < 0) || (fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0)) {
+        QCC_LogError(ER_OS_ERROR, ("NetlinkInterfaceMonitor::Start(): fcntl(O_NONBLOCK) failed: %d - %s", errno, strerror(errno)));
+        close(fd);
+        return ER_OS_ERROR;
+    }
+
+    //
+    // Link notifications tell us about interfaces coming and going and their
+    // flags changing; address notifications tell us about addresses being
+    // assigned and removed.  Those are the only things that can change the set
+    // of sockets the name service wants open.
+    //
+    struct sockaddr_nl addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR;
+    if (bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0) {
+        QCC_LogError(ER_OS_ERROR, ("NetlinkInterfaceMonitor::Start(): bind() failed: %d - %s", errno, strerror(errno)));
+        close(fd);
+        return ER_OS_ERROR;
+    }
+
+    m_sockFd = fd;
+    m_event = new qcc::Event(m_sockFd, qcc::Event::IO_READ, false);
+    return ER_OK;
+}
+
+void NetlinkInterfaceMonitor::Stop()
+{
+    QCC_DbgPrintf(("NetlinkInterfaceMonitor::Stop()"));
+
+    //
+    // Always delete the event before closing the socket it is monitoring.
+    //
+    delete m_event;
+    m_event = NULL;
+
+    if (m_sockFd != -1) {
+        close(m_sockFd);
+        m_sockFd = -1;
+    }
+}
+
+bool NetlinkInterfaceMonitor::CheckForChanges()
+{
+    if (m_sockFd == -1) {
+        return false;
+    }
+
+    bool changed = false;
+    uint8_t buffer[8192];
+
+    for (;;) {
+        ssize_t nbytes = recv(m_sockFd, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (nbytes < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            //
+            // ENOBUFS means the kernel dropped notifications because we were
+            // not reading fast enough.  We don't know what we missed, so we
+            // have to assume something changed.
+            //
+            if (errno == ENOBUFS) {
+                QCC_DbgPrintf(("NetlinkInterfaceMonitor::CheckForChanges(): Notifications overran"));
+                changed = true;
+                continue;
+            }
+            break;
+        }
+        if (nbytes == 0) {
+            break;
+        }
+
+        size_t len = static_cast<size_t>(nbytes);
+        for (struct nlmsghdr* nh = reinterpret_cast<struct nlmsghdr*>(buffer); NLMSG_OK(nh, len); nh = NLMSG_NEXT(nh, len)) {
+            switch (nh->nlmsg_type) {
+            case RTM_NEWLINK:
+            case RTM_DELLINK:
+            case RTM_NEWADDR:
+            case RTM_DELADDR:
+                changed = true;
+                break;
+
+            default:
+                break;
+            }
+        }
+    }
+
+    QCC_DbgPrintf(("NetlinkInterfaceMonitor::CheckForChanges(): %s", changed ? "changed" : "unchanged"));
+    return changed;
+}
+
+#endif
+
+} // namespace ajn
@@ -0,0 +1,151 @@
+/**
+ * @file
+ * @internal
+ * Sources of network interface change notifications for the IP name service.
+ */
+
+/******************************************************************************
+ * Copyright 2012, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#ifndef _INTERFACE_MONITOR_H
+#define _INTERFACE_MONITOR_H
+
+#ifndef __cplusplus
+#error Only include InterfaceMonitor.h in C++ code.
+#endif
+
+#include <vector>
+
+#include <qcc/Event.h>
+#include <qcc/IfConfig.h>
+
+#include <Status.h>
+
+namespace ajn {
+
+/**
+ * @internal
+ * @brief Tells the IP name service when the network interfaces or their
+ * addresses may have changed and provides the current interface list.
+ *
+ * The name service thread waits on GetEvent() together with its sockets and
+ * calls CheckForChanges() when it fires.  Monitors that cannot deliver
+ * notifications return NULL from GetEvent() and the name service falls back
+ * to periodically re-reading the interface list.  Tests can supply their own
+ * monitor to drive interface changes without touching the real network.
+ */
+class InterfaceMonitor {
+  public:
+    /**
+     * @internal
+     * @brief Create the preferred monitor for this platform.  This is a netlink
+     * monitor on Linux and Android and a polling monitor elsewhere.
+     *
+     * @return A new monitor which the caller must delete.
+     */
+    static InterfaceMonitor* Create();
+
+    /**
+     * @internal
+     * @brief Destructor.
+     */
+    virtual ~InterfaceMonitor() { }
+
+    /**
+     * @internal
+     * @brief Begin listening for change notifications.
+     *
+     * @return ER_OK if notifications will be delivered through GetEvent().
+     */
+    virtual QStatus Start() = 0;
+
+    /**
+     * @internal
+     * @brief Stop listening for change notifications.
+     */
+    virtual void Stop() = 0;
+
+    /**
+     * @internal
+     * @brief Get the event that is signaled when the interfaces may have
+     * changed.
+     *
+     * @return The event, or NULL if this monitor has to be polled.
+     */
+    virtual qcc::Event* GetEvent() = 0;
+
+    /**
+     * @internal
+     * @brief Consume any pending change notifications and reset the event.
+     *
+     * @return true if an interface or address was added, removed or changed.
+     */
+    virtual bool CheckForChanges() = 0;
+
+    /**
+     * @internal
+     * @brief Get the interfaces currently configured in the system.
+     *
+     * @param entries  Filled in with one entry per interface address.
+     *
+     * @return ER_OK if the interface list was read.
+     */
+    virtual QStatus GetInterfaces(std::vector<qcc::IfConfigEntry>& entries) { return qcc::IfConfig(entries); }
+};
+
+/**
+ * @internal
+ * @brief An InterfaceMonitor that delivers no notifications.  The name
+ * service polls the interface list on its lazy update schedule.
+ */
+class PollingInterfaceMonitor : public InterfaceMonitor {
+  public:
+    QStatus Start() { return ER_OK; }
+    void Stop() { }
+    qcc::Event* GetEvent() { return NULL; }
+    bool CheckForChanges() { return false; }
+};
+
+#if defined(QCC_OS_LINUX) || defined(QCC_OS_ANDROID)
+
+/**
+ * @internal
+ * @brief An InterfaceMonitor driven by rtnetlink link and address
+ * notifications.
+ */
+class NetlinkInterfaceMonitor : public InterfaceMonitor {
+  public:
+    NetlinkInterfaceMonitor() : m_sockFd(-1), m_event(NULL) { }
+    ~NetlinkInterfaceMonitor() { Stop(); }
+
+    QStatus Start();
+    void Stop();
+    qcc::Event* GetEvent() { return m_event; }
+    bool CheckForChanges();
+
+  private:
+    NetlinkInterfaceMonitor(const NetlinkInterfaceMonitor& other);
+    NetlinkInterfaceMonitor& operator=(const NetlinkInterfaceMonitor& other);
+
+    int m_sockFd;               /**< NETLINK_ROUTE socket subscribed to link and address groups */
+    qcc::Event* m_event;        /**< Read event on m_sockFd */
+};
+
+#endif
+
+} // namespace ajn
+
+#endif // _INTERFACE_MONITOR_H
@@ -24,6 +24,7 @@
 #include <assert.h>
 #include <ctype.h>
 #include <algorithm>
+#include <iterator>
 
 #if defined(QCC_OS_GROUP_WINDOWS)
 #define close closesocket
@@ -38,6 +39,7 @@
 #include <qcc/SocketTypes.h>
 #include <qcc/IfConfig.h>
 #include <qcc/time.h>
+#include <qcc/Util.h>
 
 #include <DaemonConfig.h>
 
@@ -347,12 +349,11 @@ const char* IpNameServiceImpl::IPV6_ALLJOYN_MULTICAST_GROUP = "ff02::13a";
 // We require an actual character match and do not consider an empty string
 // something that can match or be matched.
 //
-bool IpNameServiceImplWildcardMatch(qcc::String str, qcc::String pat)
+// The pattern usually comes straight out of a received WhoHas, so the core of
+// the match works on characters where they lie rather than on strings.
+//
+static bool WildcardMatch(const char* s, size_t strsize, const char* p, size_t patsize)
 {
-    size_t patsize = pat.size();
-    size_t strsize = str.size();
-    const char* p = pat.c_str();
-    const char* s = str.c_str();
     uint32_t pi, si;
 
     //
@@ -444,15 +445,24 @@ bool IpNameServiceImplWildcardMatch(qcc::String str, qcc::String pat)
     return true;
 }
 
+bool IpNameServiceImplWildcardMatch(qcc::String str, qcc::String pat)
+{
+    return WildcardMatch(str.c_str(), str.size(), pat.c_str(), pat.size());
+}
+
 IpNameServiceImpl::IpNameServiceImpl()
     : Thread("IpNameServiceImpl"), m_state(IMPL_SHUTDOWN), m_terminal(false),
     m_callback(0), m_port(0),
     m_reliableIPv4Port(0), m_unreliableIPv4Port(0), m_reliableIPv6Port(0), m_unreliableIPv6Port(0),
-    m_timer(0), m_tDuration(DEFAULT_DURATION),
+    m_timer(0), m_nextRecentQuestion(0),
+    m_generation(0), m_tLegacyUntil(0), m_tAnswerDue(0), m_answerLegacy(false), m_answerV2(false),
+    m_tLastAnswer(0), m_tResyncDue(0), m_tLastResync(0), m_numAnswered(0), m_numSuppressed(0),
+    m_tDuration(DEFAULT_DURATION),
     m_tRetransmit(RETRANSMIT_TIME), m_tQuestion(QUESTION_TIME),
     m_modulus(QUESTION_MODULUS), m_retries(NUMBER_RETRIES),
     m_loopback(false), m_enableIPv4(false), m_enableIPv6(false),
     m_any(false), m_wakeEvent(), m_forceLazyUpdate(false),
+    m_interfaceMonitor(InterfaceMonitor::Create()), m_socketsOpened(0), m_socketsClosed(0),
     m_enabled(false), m_doEnable(false), m_doDisable(false)
 {
     QCC_DbgPrintf(("IpNameServiceImpl::IpNameServiceImpl()"));
@@ -490,6 +500,41 @@ QStatus IpNameServiceImpl::Init(const qcc::String& guid, bool loopback)
     return ER_OK;
 }
 
+QStatus IpNameServiceImpl::SetInterfaceMonitor(InterfaceMonitor* monitor)
+{
+    QCC_DbgPrintf(("IpNameServiceImpl::SetInterfaceMonitor()"));
+
+    //
+    // The monitor belongs to the name service thread once it is running, so
+    // it can only be replaced before Start().
+    //
+    if (IsRunning()) {
+        delete monitor;
+        return ER_FAIL;
+    }
+
+    delete m_interfaceMonitor;
+    m_interfaceMonitor = monitor;
+    return ER_OK;
+}
+
+void IpNameServiceImpl::GetInterfaceStats(uint32_t& numLive, uint32_t& numOpened, uint32_t& numClosed)
+{
+    m_mutex.Lock();
+    numLive = m_liveInterfaces.size();
+    numOpened = m_socketsOpened;
+    numClosed = m_socketsClosed;
+    m_mutex.Unlock();
+}
+
+void IpNameServiceImpl::GetAnswerStats(uint32_t& numAnswered, uint32_t& numSuppressed)
+{
+    m_mutex.Lock();
+    numAnswered = m_numAnswered;
+    numSuppressed = m_numSuppressed;
+    m_mutex.Unlock();
+}
+
 //
 // When we moved the name service out of the TCP transport and promoted it to a
 // singleton, we opened a bit of a can of worms because of the C++ static
@@ -528,6 +573,9 @@ IpNameServiceImpl::~IpNameServiceImpl()
     ClearLiveInterfaces();
 #endif
 
+    delete m_interfaceMonitor;
+    m_interfaceMonitor = NULL;
+
     //
     // We can just blow away the requested interfaces without a care.
     //
@@ -737,58 +785,351 @@ QStatus IpNameServiceImpl::CloseInterface(const qcc::IPAddress& addr)
     return ER_OK;
 }
 
+void IpNameServiceImpl::CloseLiveInterface(LiveInterface& live)
+{
+    if (live.m_sockFd == -1) {
+        return;
+    }
+
+    QCC_DbgPrintf(("IpNameServiceImpl::CloseLiveInterface(): close interface %s", live.m_interfaceName.c_str()));
+
+    //
+    // If the multicast bit is set, we have done an IGMP join.  In this
+    // case, we must arrange an IGMP drop via the appropriate socket option
+    // (via the qcc absraction layer). Android doesn't bother to compile its
+    // kernel with CONFIG_IP_MULTICAST set.  This doesn't mean that there is
+    // no multicast code in the Android kernel, it means there is no IGMP
+    // code in the kernel.  What this means to us is that even through we
+    // are doing an IP_DROP_MEMBERSHIP request, which is ultimately an IGMP
+    // operation, the request will filter through the IP code before being
+    // ignored and will do useful things in the kernel even though
+    // CONFIG_IP_MULTICAST was not set for the Android build -- i.e., we
+    // have to do it anyway.
+    //
+    if (live.m_flags & qcc::IfConfigEntry::MULTICAST) {
+        if (live.m_address.IsIPv4()) {
+#if 1
+            qcc::LeaveMulticastGroup(live.m_sockFd, qcc::QCC_AF_INET, IPV4_ALLJOYN_MULTICAST_GROUP, live.m_interfaceName);
+#endif
+        } else if (live.m_address.IsIPv6()) {
+            qcc::LeaveMulticastGroup(live.m_sockFd, qcc::QCC_AF_INET6, IPV6_ALLJOYN_MULTICAST_GROUP, live.m_interfaceName);
+        }
+    }
+
+    //
+    // Always delete the event before closing the socket because the event
+    // is monitoring the socket state and therefore has a reference to the
+    // socket.  One the socket is closed the FD can be reused and our event
+    // can end up monitoring the wrong socket and interfere with the correct
+    // operation of other unrelated event/socket pairs.
+    //
+    delete live.m_event;
+    live.m_event = NULL;
+
+    qcc::Close(live.m_sockFd);
+    live.m_sockFd = -1;
+    ++m_socketsClosed;
+}
+
 void IpNameServiceImpl::ClearLiveInterfaces(void)
 {
     QCC_DbgPrintf(("IpNameServiceImpl::ClearLiveInterfaces()"));
 
     for (uint32_t i = 0; i < m_liveInterfaces.size(); ++i) {
-        if (m_liveInterfaces[i].m_sockFd == -1) {
-            continue;
+        CloseLiveInterface(m_liveInterfaces[i]);
+    }
+
+    QCC_DbgPrintf(("IpNameServiceImpl::ClearLiveInterfaces(): Clear interfaces"));
+    m_liveInterfaces.clear();
+
+    QCC_DbgPrintf(("IpNameServiceImpl::ClearLiveInterfaces(): Done"));
+}
+
+bool IpNameServiceImpl::UseInterface(const qcc::IfConfigEntry& entry)
+{
+    //
+    // We expect that every device in the system must have a name.
+    // It might be some crazy random GUID in Windows, but it will have
+    // a name.
+    //
+    assert(entry.m_name.size());
+    QCC_DbgPrintf(("IpNameServiceImpl::UseInterface(): Checking out interface %s", entry.m_name.c_str()));
+
+    //
+    // We are never interested in interfaces that are not UP or are LOOPBACK
+    // interfaces.  We don't allow loopbacks since sending messages to the
+    // local host is handled by the MULTICAST_LOOP socket option which is
+    // enabled by default.
+    //
+    if ((entry.m_flags & qcc::IfConfigEntry::UP) == 0 ||
+        (entry.m_flags & qcc::IfConfigEntry::LOOPBACK) != 0) {
+        QCC_DbgPrintf(("IpNameServiceImpl::UseInterface(): not UP or LOOPBACK"));
+        return false;
+    }
+
+    //
+    // When initializing the name service, the user can decide whether or
+    // not she wants to advertise and listen over IPv4 or IPv6.  We need
+    // to check for that configuration here.  Since the rest of the code
+    // just works with the live interfaces irrespective of address family,
+    // this is the only place we need to do this check.
+    //
+    if ((m_enableIPv4 == false && entry.m_family == qcc::QCC_AF_INET) ||
+        (m_enableIPv6 == false && entry.m_family == qcc::QCC_AF_INET6)) {
+        QCC_DbgPrintf(("IpNameServiceImpl::UseInterface(): family %d not enabled", entry.m_family));
+        return false;
+    }
+
+    //
+    // The current real interface entry is a candidate for use.  We need to
+    // decide if we are actually going to use it either based on the
+    // wildcard mode or the list of requestedInterfaces provided by our
+    // user.
+    //
+    bool useEntry = false;
+
+    if (m_any) {
+        QCC_DbgPrintf(("IpNameServiceImpl::UseInterface(): Use because wildcard mode"));
+        useEntry = true;
+    } else {
+        for (uint32_t j = 0; j < m_requestedInterfaces.size(); ++j) {
+            //
+            // If the current real interface name matches the name in the
+            // requestedInterface list, we will try to use it.
+            //
+            if (m_requestedInterfaces[j].m_interfaceName.size() != 0 &&
+                m_requestedInterfaces[j].m_interfaceName == entry.m_name) {
+                QCC_DbgPrintf(("IpNameServiceImpl::UseInterface(): Found matching requestedInterface name"));
+                useEntry = true;
+                break;
+            }
+
+            //
+            // If the current real interface IP Address matches the name in
+            // the requestedInterface list, we will try to use it.
+            //
+            if (m_requestedInterfaces[j].m_interfaceName.size() == 0 &&
+                m_requestedInterfaces[j].m_interfaceAddr == qcc::IPAddress(entry.m_addr)) {
+                QCC_DbgPrintf(("IpNameServiceImpl::UseInterface(): Found matching requestedInterface address"));
+                useEntry = true;
+                break;
+            }
         }
+    }
 
-        QCC_DbgPrintf(("IpNameServiceImpl::ClearLiveInterfaces(): clear interface %d", i));
+    //
+    // If we aren't configured to use this entry, or have no idea how to use
+    // this entry (not AF_INET or AF_INET6), try the next one.
+    //
+    if (useEntry == false || (entry.m_family != qcc::QCC_AF_INET && entry.m_family != qcc::QCC_AF_INET6)) {
+        QCC_DbgPrintf(("IpNameServiceImpl::UseInterface(): Won't use this IfConfig entry"));
+        return false;
+    }
+
+    //
+    // If we fall through to here, we have decided that the host configured
+    // entry describes an interface we want to use to send and receive our
+    // name service messages over.  We keep a list of "live" interfaces that
+    // reflect the interfaces we've previously made the decision to use, so
+    // OpenLiveInterface() will set up a socket and move it there.  It has to
+    // be careful about what kind of socket it is going to use for each entry
+    // (IPv4 or IPv6) and whether or not multicast is actually supported on
+    // the interface, so one last check is whether we can use it at all.
+    //
+    // This next condition may be a bit confusing, so we break it out a bit
+    // for clarity.  We can posibly use an interface if it supports either
+    // multicast or broadcast.  What we want to do is to detect the
+    // condition when we cannot use it, so we invert the logic.  That means
+    // !multicast && !broadcast.  Not being able to support broadcast is
+    // also true if we don't want to (i.e., m_broadcast is false).  This
+    // expression then looks like  !multicast && (!broadcast || !m_broadcast).
+    // broadcast really implies AF_INET since there is no broadcast in IPv6
+    // but we double-check this condition and come up with:
+    //
+    //   !multicast && (!broadcast || !m_broadcast || !AF_INET).
+    //
+    // To avoid a horribly complicated if statement, we make it look like
+    // the above explanation.  The resulting debug print is intimidating,
+    // but it says exactly the right thing for those in the know.
+    //
+    bool multicast = (entry.m_flags & qcc::IfConfigEntry::MULTICAST) != 0;
+    bool broadcast = (entry.m_flags & qcc::IfConfigEntry::BROADCAST) != 0;
+    bool af_inet = entry.m_family == qcc::QCC_AF_INET;
+
+    if (!multicast && (!broadcast || !m_broadcast || !af_inet)) {
+        QCC_DbgPrintf(("UseInterface: !multicast && (!broadcast || !m_broadcast || !af_inet).  Ignoring"));
+        return false;
+    }
+
+    return true;
+}
+
+void IpNameServiceImpl::OpenLiveInterface(const qcc::IfConfigEntry& entry)
+{
+    //
+    // We've decided the interface in question is interesting and we want to
+    // use it to send and receive name service messages.  Now we need to
+    // start the long process of convincing the network to do what we want.
+    // This is going to mostly be done by setting a series of socket
+    // options.  The small number of the ones we need are absracted in the
+    // qcc package.
+    //
+    qcc::SocketFd sockFd;
+    QStatus status;
+
+    if (entry.m_family == qcc::QCC_AF_INET) {
+        status = qcc::Socket(qcc::QCC_AF_INET, qcc::QCC_SOCK_DGRAM, sockFd);
+        if (status != ER_OK) {
+            QCC_LogError(status, ("OpenLiveInterface: qcc::Socket(AF_INET) failed: %d - %s",
+                                  qcc::GetLastError(), qcc::GetLastErrorString().c_str()));
+            return;
+        }
 
         //
-        // If the multicast bit is set, we have done an IGMP join.  In this
-        // case, we must arrange an IGMP drop via the appropriate socket option
-        // (via the qcc absraction layer). Android doesn't bother to compile its
-        // kernel with CONFIG_IP_MULTICAST set.  This doesn't mean that there is
-        // no multicast code in the Android kernel, it means there is no IGMP
-        // code in the kernel.  What this means to us is that even through we
-        // are doing an IP_DROP_MEMBERSHIP request, which is ultimately an IGMP
-        // operation, the request will filter through the IP code before being
-        // ignored and will do useful things in the kernel even though
-        // CONFIG_IP_MULTICAST was not set for the Android build -- i.e., we
-        // have to do it anyway.
+        // If we're going to send broadcasts, we have to ask for
+        // permission.
         //
-        if (m_liveInterfaces[i].m_flags & qcc::IfConfigEntry::MULTICAST) {
-            if (m_liveInterfaces[i].m_address.IsIPv4()) {
-#if 1
-                qcc::LeaveMulticastGroup(m_liveInterfaces[i].m_sockFd, qcc::QCC_AF_INET, IPV4_ALLJOYN_MULTICAST_GROUP, m_liveInterfaces[i].m_interfaceName);
-#endif
-            } else if (m_liveInterfaces[i].m_address.IsIPv6()) {
-                qcc::LeaveMulticastGroup(m_liveInterfaces[i].m_sockFd, qcc::QCC_AF_INET6, IPV6_ALLJOYN_MULTICAST_GROUP, m_liveInterfaces[i].m_interfaceName);
+        if (m_broadcast && entry.m_flags & qcc::IfConfigEntry::BROADCAST) {
+            status = qcc::SetBroadcast(sockFd, true);
+            if (status != ER_OK) {
+                QCC_LogError(status, ("OpenLiveInterface: enable broadcast failed"));
+                qcc::Close(sockFd);
+                return;
             }
         }
+    } else if (entry.m_family == qcc::QCC_AF_INET6) {
+        status = qcc::Socket(qcc::QCC_AF_INET6, qcc::QCC_SOCK_DGRAM, sockFd);
+        if (status != ER_OK) {
+            QCC_LogError(status, ("OpenLiveInterface: qcc::Socket(AF_INET6) failed: %d - %s",
+                                  qcc::GetLastError(), qcc::GetLastErrorString().c_str()));
+            return;
+        }
+    } else {
+        assert(!"IpNameServiceImpl::OpenLiveInterface(): Unexpected value in m_family (not AF_INET or AF_INET6");
+        return;
+    }
+
+    //
+    // We must be able to reuse the address/port combination so other
+    // AllJoyn daemon instances on the same host can listen in if desired.
+    // This will set the SO_REUSEPORT socket option if available or fall
+    // back onto SO_REUSEADDR if not.
+    //
+    status = qcc::SetReusePort(sockFd, true);
+    if (status != ER_OK && status != ER_NOT_IMPLEMENTED) {
+        QCC_LogError(status, ("IpNameServiceImpl::OpenLiveInterface(): SetReusePort() failed"));
+        qcc::Close(sockFd);
+        return;
+    }
+
+    //
+    // If the MULTICAST flag is set, we are going to try and multicast out
+    // over the interface in question.  If the MULTICAST flag is not set,
+    // then we want to fall back to IPv4 subnet directed broadcast, so we
+    // optionally do all of the multicast games and take the interface live
+    // even if it doesn't support multicast.
+    //
+    if (entry.m_flags & qcc::IfConfigEntry::MULTICAST) {
+        //
+        // Restrict the scope of the sent muticast packets to the local subnet.
+        //
+        status = qcc::SetMulticastHops(sockFd, entry.m_family, 1);
+        if (status != ER_OK && status != ER_NOT_IMPLEMENTED) {
+            QCC_LogError(status, ("IpNameServiceImpl::OpenLiveInterface(): SetMulticastHops() failed"));
+            qcc::Close(sockFd);
+            return;
+        }
 
         //
-        // Always delete the event before closing the socket because the event
-        // is monitoring the socket state and therefore has a reference to the
-        // socket.  One the socket is closed the FD can be reused and our event
-        // can end up monitoring the wrong socket and interfere with the correct
-        // operation of other unrelated event/socket pairs.
+        // In order to control which interfaces get our multicast datagrams, it
+        // is necessary to do so via a socket option.  See the Long Sidebar above.
+        // Yes, you have to do it differently depending on whether or not you're
+        // using IPv4 or IPv6.
         //
-        delete m_liveInterfaces[i].m_event;
-        m_liveInterfaces[i].m_event = NULL;
+        status = qcc::SetMulticastInterface(sockFd, entry.m_family, entry.m_name);
+        if (status != ER_OK && status != ER_NOT_IMPLEMENTED) {
+            QCC_LogError(status, ("IpNameServiceImpl::OpenLiveInterface(): SetMulticastInterface() failed"));
+            qcc::Close(sockFd);
+            return;
+        }
+    }
 
-        qcc::Close(m_liveInterfaces[i].m_sockFd);
-        m_liveInterfaces[i].m_sockFd = -1;
+    //
+    // We are going to end up binding the socket to the interface specified
+    // by the IP address in the interface list, but with multicast, things
+    // are a little different.  Binding to INADDR_ANY is the correct thing
+    // to do.  The See the Long Sidebar above.
+    //
+    if (entry.m_family == qcc::QCC_AF_INET) {
+#ifndef QCC_OS_WINRT
+        status = qcc::Bind(sockFd, qcc::IPAddress("0.0.0.0"), MULTICAST_PORT);
+#else
+        status = qcc::Bind(sockFd, qcc::IPAddress(entry.m_addr), MULTICAST_PORT);
+#endif
+        if (status != ER_OK) {
+            QCC_LogError(status, ("IpNameServiceImpl::OpenLiveInterface(): bind(0.0.0.0) failed"));
+            qcc::Close(sockFd);
+            return;
+        }
+    } else if (entry.m_family == qcc::QCC_AF_INET6) {
+#ifndef QCC_OS_WINRT
+        status = qcc::Bind(sockFd, qcc::IPAddress("::"), MULTICAST_PORT);
+#else
+        status = qcc::Bind(sockFd, qcc::IPAddress(entry.m_addr), MULTICAST_PORT);
+#endif
+        if (status != ER_OK) {
+            QCC_LogError(status, ("IpNameServiceImpl::OpenLiveInterface(): bind(::) failed"));
+            qcc::Close(sockFd);
+            return;
+        }
     }
 
-    QCC_DbgPrintf(("IpNameServiceImpl::ClearLiveInterfaces(): Clear interfaces"));
-    m_liveInterfaces.clear();
+    //
+    // The IGMP join must be done after the bind for Windows XP.  Other
+    // OSes are fine with it, but XP balks.
+    //
+    if (entry.m_flags & qcc::IfConfigEntry::MULTICAST) {
+        //
+        // Arrange an IGMP join via the appropriate socket option (via the
+        // qcc abstraction layer). Android doesn't bother to compile its
+        // kernel with CONFIG_IP_MULTICAST set.  This doesn't mean that
+        // there is no multicast code in the Android kernel, it means there
+        // is no IGMP code in the kernel.  What this means to us is that
+        // even through we are doing an IP_ADD_MEMBERSHIP request, which is
+        // ultimately an IGMP operation, the request will filter through the
+        // IP code before being ignored and will do useful things in the
+        // kernel even though CONFIG_IP_MULTICAST was not set for the
+        // Android build -- i.e., we have to do it anyway.
+        //
+        if (entry.m_family == qcc::QCC_AF_INET) {
+#if 1
+            status = qcc::JoinMulticastGroup(sockFd, qcc::QCC_AF_INET, IPV4_ALLJOYN_MULTICAST_GROUP, entry.m_name);
+#endif
+        } else if (entry.m_family == qcc::QCC_AF_INET6) {
+            status = qcc::JoinMulticastGroup(sockFd, qcc::QCC_AF_INET6, IPV6_ALLJOYN_MULTICAST_GROUP, entry.m_name);
+        }
+        if (status != ER_OK) {
+            QCC_LogError(status, ("IpNameServiceImpl::OpenLiveInterface(): unable to join multicast group"));
+            qcc::Close(sockFd);
+            return;
+        }
+    }
 
-    QCC_DbgPrintf(("IpNameServiceImpl::ClearLiveInterfaces(): Done"));
+    //
+    // Now take the interface "live."
+    //
+    LiveInterface live;
+    live.m_interfaceName = entry.m_name;
+    live.m_interfaceAddr = entry.m_addr;
+    live.m_prefixlen = entry.m_prefixlen;
+    live.m_address = qcc::IPAddress(entry.m_addr);
+    live.m_flags = entry.m_flags;
+    live.m_mtu = entry.m_mtu;
+    live.m_index = entry.m_index;
+    live.m_sockFd = sockFd;
+    live.m_event = new qcc::Event(sockFd, qcc::Event::IO_READ, false);
+    m_liveInterfaces.push_back(live);
+    ++m_socketsOpened;
 }
 
 //
@@ -826,7 +1167,18 @@ void IpNameServiceImpl::LazyUpdateInterfaces(void)
     // IGMP packets every 30 seconds we take the conservative approach and tear
     // down all of our sockets and restart them every time through.
     //
-    ClearLiveInterfaces();
+    // The exception is when our interface monitor can tell us about interface
+    // and address changes as they happen (netlink on Linux and Android).  We
+    // then know that nothing has happened to an interface that is still up
+    // with the same address, and we only close the sockets of interfaces that
+    // have gone away and open sockets on interfaces that have appeared.  If
+    // the monitor has no event to give us, we don't know what we might have
+    // missed, so we keep to the conservative approach.
+    //
+    bool incremental = m_interfaceMonitor->GetEvent() != NULL;
+    if (incremental == false) {
+        ClearLiveInterfaces();
+    }
 
     //
     // If m_enable is false, we need to make sure that no packets are sent
@@ -837,20 +1189,21 @@ void IpNameServiceImpl::LazyUpdateInterfaces(void)
     //
     if (m_enabled == false) {
         QCC_DbgPrintf(("IpNameServiceImpl::LazyUpdateInterfaces(): Communication with the outside world is forbidden"));
+        ClearLiveInterfaces();
         return;
     }
 
     //
-    // Call IfConfig to get the list of interfaces currently configured in the
-    // system.  This also pulls out interface flags, addresses and MTU.  If we
-    // can't get the system interfaces, we give up for now and hope the error
-    // is transient.
+    // Ask the interface monitor for the list of interfaces currently
+    // configured in the system (normally this is just qcc::IfConfig).  This
+    // also pulls out interface flags, addresses and MTU.  If we can't get the
+    // system interfaces, we give up for now and hope the error is transient.
     //
-    QCC_DbgPrintf(("IpNameServiceImpl::LazyUpdateInterfaces(): IfConfig()"));
+    QCC_DbgPrintf(("IpNameServiceImpl::LazyUpdateInterfaces(): GetInterfaces()"));
     std::vector<qcc::IfConfigEntry> entries;
-    QStatus status = qcc::IfConfig(entries);
+    QStatus status = m_interfaceMonitor->GetInterfaces(entries);
     if (status != ER_OK) {
-        QCC_LogError(status, ("LazyUpdateInterfaces: IfConfig() failed"));
+        QCC_LogError(status, ("LazyUpdateInterfaces: GetInterfaces() failed"));
         return;
     }
 
@@ -863,281 +1216,54 @@ void IpNameServiceImpl::LazyUpdateInterfaces(void)
     // m_any mode that means match all real IfConfig entries, we need to walk
     // the real IfConfig entries.
     //
-    for (uint32_t i = 0; (m_state == IMPL_RUNNING || m_terminal) && (i < entries.size()); ++i) {
-        //
-        // We expect that every device in the system must have a name.
-        // It might be some crazy random GUID in Windows, but it will have
-        // a name.
-        //
-        assert(entries[i].m_name.size());
-        QCC_DbgPrintf(("IpNameServiceImpl::LazyUpdateInterfaces(): Checking out interface %s", entries[i].m_name.c_str()));
-
-        //
-        // We are never interested in interfaces that are not UP or are LOOPBACK
-        // interfaces.  We don't allow loopbacks since sending messages to the
-        // local host is handled by the MULTICAST_LOOP socket option which is
-        // enabled by default.
-        //
-        if ((entries[i].m_flags & qcc::IfConfigEntry::UP) == 0 ||
-            (entries[i].m_flags & qcc::IfConfigEntry::LOOPBACK) != 0) {
-            QCC_DbgPrintf(("IpNameServiceImpl::LazyUpdateInterfaces(): not UP or LOOPBACK"));
-            continue;
+    std::vector<qcc::IfConfigEntry> useEntries;
+    for (uint32_t i = 0; i < entries.size(); ++i) {
+        if (UseInterface(entries[i])) {
+            useEntries.push_back(entries[i]);
         }
+    }
 
-        //
-        // When initializing the name service, the user can decide whether or
-        // not she wants to advertise and listen over IPv4 or IPv6.  We need
-        // to check for that configuration here.  Since the rest of the code
-        // just works with the live interfaces irrespective of address family,
-        // this is the only place we need to do this check.
-        //
-        if ((m_enableIPv4 == false && entries[i].m_family == qcc::QCC_AF_INET) ||
-            (m_enableIPv6 == false && entries[i].m_family == qcc::QCC_AF_INET6)) {
-            QCC_DbgPrintf(("IpNameServiceImpl::LazyUpdateInterfaces(): family %d not enabled", entries[i].m_family));
-            continue;
-        }
-
-        //
-        // The current real interface entry is a candidate for use.  We need to
-        // decide if we are actually going to use it either based on the
-        // wildcard mode or the list of requestedInterfaces provided by our
-        // user.
-        //
-        bool useEntry = false;
-
-        if (m_any) {
-            QCC_DbgPrintf(("IpNameServiceImpl::LazyUpdateInterfaces(): Use because wildcard mode"));
-            useEntry = true;
-        } else {
-            for (uint32_t j = 0; j < m_requestedInterfaces.size(); ++j) {
-                //
-                // If the current real interface name matches the name in the
-                // requestedInterface list, we will try to use it.
-                //
-                if (m_requestedInterfaces[j].m_interfaceName.size() != 0 &&
-                    m_requestedInterfaces[j].m_interfaceName == entries[i].m_name) {
-                    QCC_DbgPrintf(("IpNameServiceImpl::LazyUpdateInterfaces(): Found matching requestedInterface name"));
-                    useEntry = true;
-                    break;
-                }
-
-                //
-                // If the current real interface IP Address matches the name in
-                // the requestedInterface list, we will try to use it.
-                //
-                if (m_requestedInterfaces[j].m_interfaceName.size() == 0 &&
-                    m_requestedInterfaces[j].m_interfaceAddr == qcc::IPAddress(entries[i].m_addr)) {
-                    QCC_DbgPrintf(("IpNameServiceImpl::LazyUpdateInterfaces(): Found matching requestedInterface address"));
-                    useEntry = true;
-                    break;
-                }
+    //
+    // Any live interface that still matches an entry we want to use keeps its
+    // socket.  We consider it the same interface if the name, address and
+    // index are unchanged and it has not gained or lost the ability to do
+    // multicast or broadcast, since those decide how the socket was set up.
+    // Anything else has gone away or changed underneath us and is closed.
+    //
+    const uint32_t SOCKET_FLAGS = qcc::IfConfigEntry::MULTICAST | qcc::IfConfigEntry::BROADCAST;
+
+    for (std::vector<LiveInterface>::iterator i = m_liveInterfaces.begin(); i != m_liveInterfaces.end();) {
+        bool keep = false;
+        for (std::vector<qcc::IfConfigEntry>::iterator j = useEntries.begin(); j != useEntries.end(); ++j) {
+            if (i->m_interfaceName == j->m_name &&
+                i->m_address == qcc::IPAddress(j->m_addr) &&
+                i->m_index == j->m_index &&
+                (i->m_flags & SOCKET_FLAGS) == (j->m_flags & SOCKET_FLAGS)) {
+                i->m_prefixlen = j->m_prefixlen;
+                i->m_mtu = j->m_mtu;
+                i->m_flags = j->m_flags;
+                useEntries.erase(j);
+                keep = true;
+                break;
             }
         }
 
-        //
-        // If we aren't configured to use this entry, or have no idea how to use
-        // this entry (not AF_INET or AF_INET6), try the next one.
-        //
-        if (useEntry == false || (entries[i].m_family != qcc::QCC_AF_INET && entries[i].m_family != qcc::QCC_AF_INET6)) {
-            QCC_DbgPrintf(("IpNameServiceImpl::LazyUpdateInterfaces(): Won't use this IfConfig entry"));
-            continue;
-        }
-
-        //
-        // If we fall through to here, we have decided that the host configured
-        // entries[i] interface describes an interface we want to use to send
-        // and receive our name service messages over.  We keep a list of "live"
-        // interfaces that reflect the interfaces we've previously made the
-        // decision to use, so we'll set up a socket and move it there.  We have
-        // to be careful about what kind of socket we are going to use for each
-        // entry (IPv4 or IPv6) and whether or not multicast is actually supported
-        // on the interface.
-        //
-        // This next condition may be a bit confusing, so we break it out a bit
-        // for clarity.  We can posibly use an interface if it supports either
-        // multicast or broadcast.  What we want to do is to detect the
-        // condition when we cannot use it, so we invert the logic.  That means
-        // !multicast && !broadcast.  Not being able to support broadcast is
-        // also true if we don't want to (i.e., m_broadcast is false).  This
-        // expression then looks like  !multicast && (!broadcast || !m_broadcast).
-        // broadcast really implies AF_INET since there is no broadcast in IPv6
-        // but we double-check this condition and come up with:
-        //
-        //   !multicast && (!broadcast || !m_broadcast || !AF_INET).
-        //
-        // To avoid a horribly complicated if statement, we make it look like
-        // the above explanation.  The resulting debug print is intimidating,
-        // but it says exactly the right thing for those in the know.
-        //
-        bool multicast = (entries[i].m_flags & qcc::IfConfigEntry::MULTICAST) != 0;
-        bool broadcast = (entries[i].m_flags & qcc::IfConfigEntry::BROADCAST) != 0;
-        bool af_inet = entries[i].m_family == qcc::QCC_AF_INET;
-
-        if (!multicast && (!broadcast || !m_broadcast || !af_inet)) {
-            QCC_DbgPrintf(("LazyUpdateInterfaces: !multicast && (!broadcast || !m_broadcast || !af_inet).  Ignoring"));
-            continue;
-        }
-
-        //
-        // We've decided the interface in question is interesting and we want to
-        // use it to send and receive name service messages.  Now we need to
-        // start the long process of convincing the network to do what we want.
-        // This is going to mostly be done by setting a series of socket
-        // options.  The small number of the ones we need are absracted in the
-        // qcc package.
-        //
-        qcc::SocketFd sockFd;
-
-        if (entries[i].m_family == qcc::QCC_AF_INET) {
-            QStatus status = qcc::Socket(qcc::QCC_AF_INET, qcc::QCC_SOCK_DGRAM, sockFd);
-            if (status != ER_OK) {
-                QCC_LogError(status, ("LazyUpdateInterfaces: qcc::Socket(AF_INET) failed: %d - %s",
-                                      qcc::GetLastError(), qcc::GetLastErrorString().c_str()));
-                continue;
-            }
-
-            //
-            // If we're going to send broadcasts, we have to ask for
-            // permission.
-            //
-            if (m_broadcast && entries[i].m_flags & qcc::IfConfigEntry::BROADCAST) {
-                status = qcc::SetBroadcast(sockFd, true);
-                if (status != ER_OK) {
-                    QCC_LogError(status, ("LazyUpdateInterfaces: enable broadcast failed"));
-                    continue;
-                }
-            }
-        } else if (entries[i].m_family == qcc::QCC_AF_INET6) {
-            QStatus status = qcc::Socket(qcc::QCC_AF_INET6, qcc::QCC_SOCK_DGRAM, sockFd);
-            if (status != ER_OK) {
-                QCC_LogError(status, ("LazyUpdateInterfaces: qcc::Socket(AF_INET6) failed: %d - %s",
-                                      qcc::GetLastError(), qcc::GetLastErrorString().c_str()));
-                continue;
-            }
+        if (keep) {
+            ++i;
         } else {
-            assert(!"IpNameServiceImpl::LazyUpdateInterfaces(): Unexpected value in m_family (not AF_INET or AF_INET6");
-            continue;
-        }
-
-        //
-        // We must be able to reuse the address/port combination so other
-        // AllJoyn daemon instances on the same host can listen in if desired.
-        // This will set the SO_REUSEPORT socket option if available or fall
-        // back onto SO_REUSEADDR if not.
-        //
-        status = qcc::SetReusePort(sockFd, true);
-        if (status != ER_OK && status != ER_NOT_IMPLEMENTED) {
-            QCC_LogError(status, ("IpNameServiceImpl::LazyUpdateInterfaces(): SetReusePort() failed"));
-            qcc::Close(sockFd);
-            continue;
-        }
-
-        //
-        // If the MULTICAST flag is set, we are going to try and multicast out
-        // over the interface in question.  If the MULTICAST flag is not set,
-        // then we want to fall back to IPv4 subnet directed broadcast, so we
-        // optionally do all of the multicast games and take the interface live
-        // even if it doesn't support multicast.
-        //
-        if (entries[i].m_flags & qcc::IfConfigEntry::MULTICAST) {
-            //
-            // Restrict the scope of the sent muticast packets to the local subnet.
-            //
-            status = qcc::SetMulticastHops(sockFd, entries[i].m_family, 1);
-            if (status != ER_OK && status != ER_NOT_IMPLEMENTED) {
-                QCC_LogError(status, ("IpNameServiceImpl::LazyUpdateInterfaces(): SetMulticastHops() failed"));
-                qcc::Close(sockFd);
-            }
-
-            //
-            // In order to control which interfaces get our multicast datagrams, it
-            // is necessary to do so via a socket option.  See the Long Sidebar above.
-            // Yes, you have to do it differently depending on whether or not you're
-            // using IPv4 or IPv6.
-            //
-            status = qcc::SetMulticastInterface(sockFd, entries[i].m_family, entries[i].m_name);
-            if (status != ER_OK && status != ER_NOT_IMPLEMENTED) {
-                QCC_LogError(status, ("IpNameServiceImpl::LazyUpdateInterfaces(): SetMulticastInterface() failed"));
-                qcc::Close(sockFd);
-                continue;
-            }
-        }
-
-        //
-        // We are going to end up binding the socket to the interface specified
-        // by the IP address in the interface list, but with multicast, things
-        // are a little different.  Binding to INADDR_ANY is the correct thing
-        // to do.  The See the Long Sidebar above.
-        //
-        if (entries[i].m_family == qcc::QCC_AF_INET) {
-#ifndef QCC_OS_WINRT
-            status = qcc::Bind(sockFd, qcc::IPAddress("0.0.0.0"), MULTICAST_PORT);
-#else
-            status = qcc::Bind(sockFd, qcc::IPAddress(entries[i].m_addr), MULTICAST_PORT);
-#endif
-            if (status != ER_OK) {
-                QCC_LogError(status, ("IpNameServiceImpl::LazyUpdateInterfaces(): bind(0.0.0.0) failed"));
-                qcc::Close(sockFd);
-                continue;
-            }
-        } else if (entries[i].m_family == qcc::QCC_AF_INET6) {
-#ifndef QCC_OS_WINRT
-            status = qcc::Bind(sockFd, qcc::IPAddress("::"), MULTICAST_PORT);
-#else
-            status = qcc::Bind(sockFd, qcc::IPAddress(entries[i].m_addr), MULTICAST_PORT);
-#endif
-            if (status != ER_OK) {
-                QCC_LogError(status, ("IpNameServiceImpl::LazyUpdateInterfaces(): bind(::) failed"));
-                qcc::Close(sockFd);
-                continue;
-            }
-        }
-
-        //
-        // The IGMP join must be done after the bind for Windows XP.  Other
-        // OSes are fine with it, but XP balks.
-        //
-        if (entries[i].m_flags & qcc::IfConfigEntry::MULTICAST) {
-            //
-            // Arrange an IGMP join via the appropriate socket option (via the
-            // qcc abstraction layer). Android doesn't bother to compile its
-            // kernel with CONFIG_IP_MULTICAST set.  This doesn't mean that
-            // there is no multicast code in the Android kernel, it means there
-            // is no IGMP code in the kernel.  What this means to us is that
-            // even through we are doing an IP_ADD_MEMBERSHIP request, which is
-            // ultimately an IGMP operation, the request will filter through the
-            // IP code before being ignored and will do useful things in the
-            // kernel even though CONFIG_IP_MULTICAST was not set for the
-            // Android build -- i.e., we have to do it anyway.
-            //
-            if (entries[i].m_family == qcc::QCC_AF_INET) {
-#if 1
-                status = qcc::JoinMulticastGroup(sockFd, qcc::QCC_AF_INET, IPV4_ALLJOYN_MULTICAST_GROUP, entries[i].m_name);
-#endif
-            } else if (entries[i].m_family == qcc::QCC_AF_INET6) {
-                status = qcc::JoinMulticastGroup(sockFd, qcc::QCC_AF_INET6, IPV6_ALLJOYN_MULTICAST_GROUP, entries[i].m_name);
-            }
-            if (status != ER_OK) {
-                QCC_LogError(status, ("IpNameServiceImpl::LazyUpdateInterfaces(): unable to join multicast group"));
-                qcc::Close(sockFd);
-                continue;
-            }
+            QCC_DbgPrintf(("IpNameServiceImpl::LazyUpdateInterfaces(): Interface %s (%s) has gone away",
+                           i->m_interfaceName.c_str(), i->m_address.ToString().c_str()));
+            CloseLiveInterface(*i);
+            i = m_liveInterfaces.erase(i);
         }
+    }
 
-        //
-        // Now take the interface "live."
-        //
-        LiveInterface live;
-        live.m_interfaceName = entries[i].m_name;
-        live.m_interfaceAddr = entries[i].m_addr;
-        live.m_prefixlen = entries[i].m_prefixlen;
-        live.m_address = qcc::IPAddress(entries[i].m_addr);
-        live.m_flags = entries[i].m_flags;
-        live.m_mtu = entries[i].m_mtu;
-        live.m_index = entries[i].m_index;
-        live.m_sockFd = sockFd;
-        live.m_event = new qcc::Event(sockFd, qcc::Event::IO_READ, false);
-        m_liveInterfaces.push_back(live);
+    //
+    // Whatever is left over are interfaces we want to use but aren't yet, so
+    // we'll set up a socket for each and move it to the live interfaces.
+    //
+    for (uint32_t i = 0; (m_state == IMPL_RUNNING || m_terminal) && (i < useEntries.size()); ++i) {
+        OpenLiveInterface(useEntries[i]);
     }
 }
 
@@ -1204,6 +1330,45 @@ QStatus IpNameServiceImpl::Locate(const qcc::String& wkn, LocatePolicy policy)
     //
     // Send a request to the network over our multicast channel, asking for
     // anyone who supports the specified well-known name.
+    //
+    // Version two daemons understand a list of the answers we already hold
+    // and the daemons that gave them will keep quiet.  We send the version
+    // two message first so that version two daemons hearing the down-version
+    // copies below can tell that they are copies.
+    //
+    {
+        WhoHas whoHas;
+        whoHas.SetVersion(2, 2);
+        whoHas.AddName(wkn);
+
+        Header header;
+        header.SetVersion(2, 2);
+        header.SetTimer(m_tDuration);
+
+        //
+        // The known answers are filled in again every time the request is
+        // retried, since we may have heard some answers in the meantime.
+        //
+        m_mutex.Lock();
+        AddKnownAnswers(whoHas);
+        header.AddQuestion(whoHas);
+        m_retry.push_back(header);
+        m_mutex.Unlock();
+
+        QueueProtocolMessage(header);
+    }
+
+    //
+    // If there are no down-version daemons around, we are done.
+    //
+    m_mutex.Lock();
+    bool legacy = LegacyPeersPresent();
+    m_mutex.Unlock();
+
+    if (legacy == false) {
+        return ER_OK;
+    }
+
     //
     // We are now at version one of the protocol.  There is no significant
     // difference between version zero and version one messages, but down-version
@@ -1341,22 +1506,27 @@ QStatus IpNameServiceImpl::AdvertiseName(TransportMask transportMask, vector<qcc
     //
     // Make a note to ourselves which services we are advertising so we can
     // respond to protocol questions in the future.  Only allow one entry per
-    // name.
+    // name, and only tell the world about the names that are new.
     //
+    vector<qcc::String> added;
     for (uint32_t i = 0; i < wkn.size(); ++i) {
         list<qcc::String>::iterator j = find(m_advertised.begin(), m_advertised.end(), wkn[i]);
         if (j == m_advertised.end()) {
             m_advertised.push_back(wkn[i]);
+            added.push_back(wkn[i]);
         } else {
-            //
-            // Nothing has changed, so don't bother.
-            //
             QCC_DbgPrintf(("IpNameServiceImpl::AdvertiseName(): Duplicate advertisement"));
-            m_mutex.Unlock();
-            return ER_OK;
         }
     }
 
+    //
+    // If nothing has changed, don't bother.
+    //
+    if (added.empty()) {
+        m_mutex.Unlock();
+        return ER_OK;
+    }
+
     //
     // Keep the list sorted so we can easily distinguish a change in
     // the content of the advertised names versus a change in the order of the
@@ -1364,6 +1534,11 @@ QStatus IpNameServiceImpl::AdvertiseName(TransportMask transportMask, vector<qcc
     //
     m_advertised.sort();
 
+    //
+    // The set of names we advertise has changed, so it has a new generation.
+    //
+    uint16_t generation = ++m_generation;
+
     //
     // If the advertisement retransmission timer is cleared, then set us
     // up to retransmit.  This has to be done with the mutex locked since
@@ -1373,8 +1548,67 @@ QStatus IpNameServiceImpl::AdvertiseName(TransportMask transportMask, vector<qcc
         m_timer = m_tDuration;
     }
 
+    bool legacy = LegacyPeersPresent();
+
     m_mutex.Unlock();
 
+    //
+    // Version two daemons remember our names, so we only need to tell them
+    // about the new ones.  The generation lets them check that they haven't
+    // missed an earlier change.
+    //
+    {
+        IsAt isAt;
+        isAt.SetVersion(2, 2);
+
+        //
+        // Version two provides endpoints just like version one.
+        //
+        if (m_reliableIPv4Port) {
+            isAt.SetReliableIPv4(m_reliableIPv4Address, m_reliableIPv4Port);
+        }
+        if (m_unreliableIPv4Port) {
+            isAt.SetUnreliableIPv4(m_unreliableIPv4Address, m_unreliableIPv4Port);
+        }
+        if (m_reliableIPv6Port) {
+            isAt.SetReliableIPv6(m_reliableIPv6Address, m_reliableIPv6Port);
+        }
+        if (m_unreliableIPv6Port) {
+            isAt.SetUnreliableIPv6(m_unreliableIPv6Address, m_unreliableIPv6Port);
+        }
+
+        isAt.SetGuid(m_guid);
+        isAt.SetGeneration(generation);
+        isAt.SetCompleteFlag(false);
+
+        for (uint32_t i = 0; i < added.size(); ++i) {
+            isAt.AddName(added[i]);
+        }
+
+        Header header;
+        header.SetVersion(2, 2);
+        header.SetTimer(m_tDuration);
+        header.AddAnswer(isAt);
+
+        //
+        // See the comment on the version zero message below for why we add
+        // twenty bytes here.
+        //
+        if (header.GetSerializedSize() + 20 <= NS_MESSAGE_MAX) {
+            QueueProtocolMessage(header);
+        } else {
+            QCC_LogError(ER_PACKET_TOO_LARGE, ("IpNameServiceImpl::AdvertiseName(): Resulting NS message too large"));
+            return ER_PACKET_TOO_LARGE;
+        }
+    }
+
+    //
+    // If there are no down-version daemons around, we are done.
+    //
+    if (legacy == false) {
+        return ER_OK;
+    }
+
     //
     // We are now at version one of the protocol.  There is a significant
     // difference between version zero and version one messages, so down-version
@@ -1425,11 +1659,11 @@ QStatus IpNameServiceImpl::AdvertiseName(TransportMask transportMask, vector<qcc
         isAt.SetPort(m_port);
 
         //
-        // Add the provided names to the is-at message that will be sent out on the
+        // Add the new names to the is-at message that will be sent out on the
         // network.
         //
-        for (uint32_t i = 0; i < wkn.size(); ++i) {
-            isAt.AddName(wkn[i]);
+        for (uint32_t i = 0; i < added.size(); ++i) {
+            isAt.AddName(added[i]);
         }
 
         //
@@ -1514,11 +1748,11 @@ QStatus IpNameServiceImpl::AdvertiseName(TransportMask transportMask, vector<qcc
         isAt.SetCompleteFlag(true);
 
         //
-        // Add the provided names to the is-at message that will be sent out on the
+        // Add the new names to the is-at message that will be sent out on the
         // network.
         //
-        for (uint32_t i = 0; i < wkn.size(); ++i) {
-            isAt.AddName(wkn[i]);
+        for (uint32_t i = 0; i < added.size(); ++i) {
+            isAt.AddName(added[i]);
         }
 
         //
@@ -1594,13 +1828,13 @@ QStatus IpNameServiceImpl::CancelAdvertiseName(TransportMask transportMask, vect
     //
     // Remove the given services from our list of services we are advertising.
     //
-    bool changed = false;
+    vector<qcc::String> removed;
 
     for (uint32_t i = 0; i < wkn.size(); ++i) {
         list<qcc::String>::iterator j = find(m_advertised.begin(), m_advertised.end(), wkn[i]);
         if (j != m_advertised.end()) {
             m_advertised.erase(j);
-            changed = true;
+            removed.push_back(wkn[i]);
         }
     }
 
@@ -1613,12 +1847,61 @@ QStatus IpNameServiceImpl::CancelAdvertiseName(TransportMask transportMask, vect
         m_timer = 0;
     }
 
+    //
+    // If we didn't actually make a change, just return.
+    //
+    if (removed.empty()) {
+        m_mutex.Unlock();
+        return ER_OK;
+    }
+
+    uint16_t generation = ++m_generation;
+    bool complete = m_advertised.empty();
+    bool legacy = LegacyPeersPresent();
+
     m_mutex.Unlock();
 
     //
-    // If we didn't actually make a change, just return.
+    // Tell version two daemons which names went away.  A zero timer makes
+    // this a withdrawal; the complete flag says that nothing is left.
+    //
+    {
+        IsAt isAt;
+        isAt.SetVersion(2, 2);
+
+        if (m_reliableIPv4Port) {
+            isAt.SetReliableIPv4(m_reliableIPv4Address, m_reliableIPv4Port);
+        }
+        if (m_unreliableIPv4Port) {
+            isAt.SetUnreliableIPv4(m_unreliableIPv4Address, m_unreliableIPv4Port);
+        }
+        if (m_reliableIPv6Port) {
+            isAt.SetReliableIPv6(m_reliableIPv6Address, m_reliableIPv6Port);
+        }
+        if (m_unreliableIPv6Port) {
+            isAt.SetUnreliableIPv6(m_unreliableIPv6Address, m_unreliableIPv6Port);
+        }
+
+        isAt.SetGuid(m_guid);
+        isAt.SetGeneration(generation);
+        isAt.SetCompleteFlag(complete);
+
+        for (uint32_t i = 0; i < removed.size(); ++i) {
+            isAt.AddName(removed[i]);
+        }
+
+        Header header;
+        header.SetVersion(2, 2);
+        header.SetTimer(0);
+        header.AddAnswer(isAt);
+
+        QueueProtocolMessage(header);
+    }
+
     //
-    if (changed == false) {
+    // If there are no down-version daemons around, we are done.
+    //
+    if (legacy == false) {
         return ER_OK;
     }
 
@@ -1670,8 +1953,8 @@ QStatus IpNameServiceImpl::CancelAdvertiseName(TransportMask transportMask, vect
         // Copy the names we are withdrawing the advertisement for into the
         // protocol message object.
         //
-        for (uint32_t i = 0; i < wkn.size(); ++i) {
-            isAt.AddName(wkn[i]);
+        for (uint32_t i = 0; i < removed.size(); ++i) {
+            isAt.AddName(removed[i]);
         }
 
         //
@@ -1679,9 +1962,7 @@ QStatus IpNameServiceImpl::CancelAdvertiseName(TransportMask transportMask, vect
         // withdrawing all of the advertisements.  If the complete flag is
         // not set, we have some advertisements remaining.
         //
-        if (m_advertised.size() == 0) {
-            isAt.SetCompleteFlag(true);
-        }
+        isAt.SetCompleteFlag(complete);
 
         //
         // The header ties the whole protocol message together.  We're at version
@@ -1745,8 +2026,8 @@ QStatus IpNameServiceImpl::CancelAdvertiseName(TransportMask transportMask, vect
         // Copy the names we are withdrawing the advertisement for into the
         // protocol message object.
         //
-        for (uint32_t i = 0; i < wkn.size(); ++i) {
-            isAt.AddName(wkn[i]);
+        for (uint32_t i = 0; i < removed.size(); ++i) {
+            isAt.AddName(removed[i]);
         }
 
         //
@@ -1754,9 +2035,7 @@ QStatus IpNameServiceImpl::CancelAdvertiseName(TransportMask transportMask, vect
         // withdrawing all of the advertisements.  If the complete flag is
         // not set, we have some advertisements remaining.
         //
-        if (m_advertised.size() == 0) {
-            isAt.SetCompleteFlag(true);
-        }
+        isAt.SetCompleteFlag(complete);
 
         //
         // The header ties the whole protocol message together.  We're at version
@@ -1926,7 +2205,11 @@ void IpNameServiceImpl::SendProtocolMessage(
         return;
     }
 
-    uint8_t* buffer = new uint8_t[size];
+    //
+    // The message is no bigger than NS_MESSAGE_MAX, so it is built on the
+    // stack rather than in a buffer allocated for each send.
+    //
+    uint8_t buffer[NS_MESSAGE_MAX];
     header.Serialize(buffer);
 
     //
@@ -2042,8 +2325,6 @@ void IpNameServiceImpl::SendProtocolMessage(
             }
         }
     }
-
-    delete [] buffer;
 }
 
 void IpNameServiceImpl::SendOutboundMessages(void)
@@ -2185,18 +2466,19 @@ void IpNameServiceImpl::SendOutboundMessages(void)
                     }
 
                     //
-                    // Check for version one in the header and if we have one of
-                    // those, do the version-one specific changes.
+                    // Check for version one or two in the header and if we have
+                    // one of those, do the version-one specific changes.  Version
+                    // two carries its endpoints the same way.
                     //
                     header.GetVersion(nsVersion, msgVersion);
-                    if (msgVersion == 1) {
-                        QCC_DbgPrintf(("IpNameServiceImpl::SendOutboundMessages(): Answer %d. gets version one", j));
+                    if (msgVersion == 1 || msgVersion == 2) {
+                        QCC_DbgPrintf(("IpNameServiceImpl::SendOutboundMessages(): Answer %d. gets version %d", j, msgVersion));
 
                         //
                         // We're modifying the answsers in-place so clear any
                         // state we might have added on the last iteration.
                         //
-                        isAt->SetVersion(1, 1);
+                        isAt->SetVersion(nsVersion, msgVersion);
 
                         //
                         // This is only valid until version 3.1 introduces new
@@ -2277,15 +2559,26 @@ void* IpNameServiceImpl::Run(void* arg)
     uint8_t* buffer = new uint8_t[bufsize];
 
     //
-    // Instantiate an event that fires after one second, and once per second
-    // thereafter.  Used to drive protocol maintenance functions, especially
-    // dealing with interface state changes.
+    // Protocol maintenance (retransmitting advertisements and retrying
+    // Locate requests) ticks once per second, but only while there is
+    // something to maintain.  An idle name service sleeps until a message
+    // arrives, a user request wakes it, the interface monitor reports a
+    // change, or it is time for a lazy update.
     //
     const uint32_t MS_PER_SEC = 1000;
-    qcc::Event timerEvent(MS_PER_SEC, MS_PER_SEC);
+    uint64_t tNow = qcc::GetTimestamp64();
+    uint64_t tLastLazyUpdate = tNow;
+    uint64_t tNextMaintenance = tNow + MS_PER_SEC;
 
-    qcc::Timespec tNow, tLastLazyUpdate;
-    GetTimeNow(&tLastLazyUpdate);
+    //
+    // Start listening for interface changes.  If the monitor can't deliver
+    // them, we fall back to tearing down and reopening our sockets on every
+    // lazy update.
+    //
+    QStatus status = m_interfaceMonitor->Start();
+    if (status != ER_OK) {
+        QCC_LogError(status, ("IpNameServiceImpl::Run(): Unable to monitor interface changes"));
+    }
 
     while (m_state == IMPL_RUNNING || m_terminal) {
         //
@@ -2304,7 +2597,7 @@ void* IpNameServiceImpl::Run(void* arg)
             break;
         }
 
-        GetTimeNow(&tNow);
+        tNow = qcc::GetTimestamp64();
         m_mutex.Lock();
 
         //
@@ -2317,12 +2610,14 @@ void* IpNameServiceImpl::Run(void* arg)
         if (m_doEnable) {
             m_enabled = true;
             m_doEnable = false;
+            m_forceLazyUpdate = true;
         }
 
         if (m_doDisable && m_outbound.empty()) {
             QCC_DbgPrintf(("IpNameServiceImpl::Run(): m_doDisable && m_outbound.empty() -> m_enabled = false"));
             m_enabled = false;
             m_doDisable = false;
+            m_forceLazyUpdate = true;
         }
 
         //
@@ -2352,7 +2647,9 @@ void* IpNameServiceImpl::Run(void* arg)
         // So there are three basic cases which cause us to rn the lazy updater:
         //
         //     1) If m_forceLazyUpdate is true, some major configuration change
-        //        has happened and we need to update no matter what.
+        //        has happened, or the interface monitor has told us that an
+        //        interface or address changed, and we need to update no matter
+        //        what.
         //
         //     2) If a message is found on the outbound queue, we need to do a
         //        lazy update if LAZY_UPDATE_MIN_INTERVAL has passed since the
@@ -2361,9 +2658,12 @@ void* IpNameServiceImpl::Run(void* arg)
         //     3) If LAZY_UPDATE_MAX_INTERVAL has elapsed since the last lazy
         //        update, we need to update.
         //
+        // With an interface monitor that delivers events, case 3 is only a
+        // safety net and finds nothing to do unless a notification was lost.
+        //
         if (m_forceLazyUpdate ||
-            (m_outbound.size() && tLastLazyUpdate + qcc::Timespec(LAZY_UPDATE_MIN_INTERVAL * MS_PER_SEC) < tNow) ||
-            (tLastLazyUpdate + qcc::Timespec(LAZY_UPDATE_MAX_INTERVAL * MS_PER_SEC) < tNow)) {
+            (m_outbound.size() && tLastLazyUpdate + LAZY_UPDATE_MIN_INTERVAL * MS_PER_SEC <= tNow) ||
+            (tLastLazyUpdate + LAZY_UPDATE_MAX_INTERVAL * MS_PER_SEC <= tNow)) {
 
             QCC_DbgPrintf(("IpNameServiceImpl::Run(): LazyUpdateInterfaces()"));
             LazyUpdateInterfaces();
@@ -2371,6 +2671,18 @@ void* IpNameServiceImpl::Run(void* arg)
             m_forceLazyUpdate = false;
         }
 
+        //
+        // Answers to WhoHas requests and requests to recover advertisements
+        // we lost track of are sent a little while after we decide to send
+        // them.  If their time has come, queue them up to go out now.
+        //
+        if (m_tAnswerDue && m_tAnswerDue <= tNow) {
+            SendScheduledAnswers();
+        }
+        if (m_tResyncDue && m_tResyncDue <= tNow) {
+            SendResync();
+        }
+
         SendOutboundMessages();
 
         //
@@ -2394,15 +2706,20 @@ void* IpNameServiceImpl::Run(void* arg)
 
         //
         // Now, worry about what to do next.  Create a set of events to wait on.
-        // We always wait on the stop event, the timer event and the event used
-        // to signal us when an outging message is queued or a forced wakeup for
-        // a lazy update is done.
+        // We always wait on the stop event and the event used to signal us
+        // when an outging message is queued or a forced wakeup for a lazy
+        // update is done.  If the interface monitor can tell us about
+        // interface changes, we wait on it as well.
         //
         vector<qcc::Event*> checkEvents, signaledEvents;
         checkEvents.push_back(&stopEvent);
-        checkEvents.push_back(&timerEvent);
         checkEvents.push_back(&m_wakeEvent);
 
+        qcc::Event* monitorEvent = m_interfaceMonitor->GetEvent();
+        if (monitorEvent) {
+            checkEvents.push_back(monitorEvent);
+        }
+
         //
         // We also need to wait on events from all of the sockets that
         // correspond to the "live" interfaces we need to listen for inbound
@@ -2415,9 +2732,36 @@ void* IpNameServiceImpl::Run(void* arg)
         }
 
         //
-        // We are going to go to sleep for possibly as long as a second, so
-        // we definitely need to release other (user) threads that might
-        // be waiting to talk to us.
+        // Work out how long we can sleep.  We have to wake up for the next
+        // scheduled lazy update, and once a second for protocol maintenance
+        // if we have advertisements to retransmit or Locate requests to retry.
+        // If there is nothing to maintain we keep pushing the next tick out so
+        // it happens a second after the maintenance becomes necessary.
+        //
+#if HAPPY_WANDERER
+        bool maintain = true;
+#else
+        bool maintain = m_timer || m_retry.size();
+#endif
+        if (maintain == false) {
+            tNextMaintenance = tNow + MS_PER_SEC;
+        }
+
+        uint64_t tWake = tLastLazyUpdate + LAZY_UPDATE_MAX_INTERVAL * MS_PER_SEC;
+        if (maintain && tNextMaintenance < tWake) {
+            tWake = tNextMaintenance;
+        }
+        if (m_tAnswerDue && m_tAnswerDue < tWake) {
+            tWake = m_tAnswerDue;
+        }
+        if (m_tResyncDue && m_tResyncDue < tWake) {
+            tWake = m_tResyncDue;
+        }
+        uint32_t waitMs = tWake > tNow ? static_cast<uint32_t>(tWake - tNow) : 0;
+
+        //
+        // We are going to go to sleep, so we definitely need to release other
+        // (user) threads that might be waiting to talk to us.
         //
         m_mutex.Unlock();
 
@@ -2425,12 +2769,25 @@ void* IpNameServiceImpl::Run(void* arg)
         // Wait for something to happen.  if we get an error, there's not
         // much we can do about it but bail.
         //
-        QStatus status = qcc::Event::Wait(checkEvents, signaledEvents);
+        status = qcc::Event::Wait(checkEvents, signaledEvents, waitMs);
         if (status != ER_OK && status != ER_TIMEOUT) {
             QCC_LogError(status, ("IpNameServiceImpl::Run(): Event::Wait(): Failed"));
             break;
         }
 
+        //
+        // If a maintenance tick is due, give us a chance to do any protocol
+        // maintenance, like retransmitting queued advertisements.
+        //
+        tNow = qcc::GetTimestamp64();
+        if (maintain && tNextMaintenance <= tNow) {
+            DoPeriodicMaintenance();
+            tNextMaintenance += MS_PER_SEC;
+            if (tNextMaintenance <= tNow) {
+                tNextMaintenance = tNow + MS_PER_SEC;
+            }
+        }
+
         //
         // Loop over the events for which we expect something has happened
         //
@@ -2468,15 +2825,7 @@ void* IpNameServiceImpl::Run(void* arg)
                 //
                 Retransmit(true);
                 m_terminal = true;
-                break;
-            } else if (*i == &timerEvent) {
-                // QCC_DbgPrintf(("IpNameServiceImpl::Run(): Timer event fired"));
-                //
-                // This is an event that fires every second to give us a chance
-                // to do any protocol maintenance, like retransmitting queued
-                // advertisements.
-                //
-                DoPeriodicMaintenance();
+                break;
             } else if (*i == &m_wakeEvent) {
                 QCC_DbgPrintf(("IpNameServiceImpl::Run(): Wake event fired"));
                 //
@@ -2487,6 +2836,18 @@ void* IpNameServiceImpl::Run(void* arg)
                 // it.
                 //
                 m_wakeEvent.ResetEvent();
+            } else if (*i == monitorEvent) {
+                QCC_DbgPrintf(("IpNameServiceImpl::Run(): Interface monitor event fired"));
+                //
+                // Something happened to the network interfaces.  Only bother
+                // with a lazy update if it was something that might change
+                // which sockets we want open.
+                //
+                if (m_interfaceMonitor->CheckForChanges()) {
+                    m_mutex.Lock();
+                    m_forceLazyUpdate = true;
+                    m_mutex.Unlock();
+                }
             } else {
                 QCC_DbgPrintf(("IpNameServiceImpl::Run(): Socket event fired"));
                 //
@@ -2534,6 +2895,8 @@ void* IpNameServiceImpl::Run(void* arg)
         }
     }
 
+    m_interfaceMonitor->Stop();
+
     delete [] buffer;
     return 0;
 }
@@ -2565,6 +2928,22 @@ void IpNameServiceImpl::Retry(void)
         }
 
         if (tick >= retryTick) {
+            //
+            // Version two requests carry the answers we already know about.
+            // We may have heard more of them since the last time, so bring
+            // the list up to date.
+            //
+            uint32_t nsVersion, msgVersion;
+            (*i).GetVersion(nsVersion, msgVersion);
+            if (msgVersion == 2) {
+                for (uint32_t j = 0; j < (*i).GetNumberQuestions(); ++j) {
+                    WhoHas* whoHas;
+                    (*i).GetQuestion(j, &whoHas);
+                    whoHas->ClearKnownAnswers();
+                    AddKnownAnswers(*whoHas);
+                }
+            }
+
             //
             // Send the message out over the multicast link (again).
             //
@@ -2598,6 +2977,99 @@ void IpNameServiceImpl::Retransmit(bool exiting)
     QCC_DbgPrintf(("IpNameServiceImpl::Retransmit(): Taking lock"));
     m_mutex.Lock();
 
+    //
+    // Version two daemons already know our names from the answers and deltas
+    // they have heard, so a periodic retransmission is just a refresh that
+    // keeps them alive.  When we are exiting we send out the whole list with a
+    // zero timer so everyone forgets about us.
+    //
+    RetransmitV2(exiting, exiting);
+
+    //
+    // Down-version daemons only understand the full list, so we keep sending
+    // it to them as long as we are hearing from them.
+    //
+    if (LegacyPeersPresent()) {
+        RetransmitLegacy(exiting);
+    }
+
+    QCC_DbgPrintf(("IpNameServiceImpl::Retransmit(): Giving lock"));
+    m_mutex.Unlock();
+}
+
+void IpNameServiceImpl::RetransmitV2(bool exiting, bool complete)
+{
+    QCC_DbgPrintf(("IpNameServiceImpl::RetransmitV2()"));
+
+    Header header;
+    header.SetVersion(2, 2);
+    header.SetTimer(exiting ? 0 : m_tDuration);
+
+    IsAt isAt;
+    isAt.SetVersion(2, 2);
+    isAt.SetCompleteFlag(false);
+
+    if (m_reliableIPv4Port) {
+        isAt.SetReliableIPv4(m_reliableIPv4Address, m_reliableIPv4Port);
+    }
+    if (m_unreliableIPv4Port) {
+        isAt.SetUnreliableIPv4(m_unreliableIPv4Address, m_unreliableIPv4Port);
+    }
+    if (m_reliableIPv6Port) {
+        isAt.SetReliableIPv6(m_reliableIPv6Address, m_reliableIPv6Port);
+    }
+    if (m_unreliableIPv6Port) {
+        isAt.SetUnreliableIPv6(m_unreliableIPv6Address, m_unreliableIPv6Port);
+    }
+
+    isAt.SetGuid(m_guid);
+    isAt.SetGeneration(m_generation);
+
+    //
+    // A refresh carries no names.  It tells everyone who has our names at the
+    // current generation to keep them for another timer period, and tells
+    // anyone who doesn't that they need to ask.
+    //
+    if (complete == false) {
+        header.AddAnswer(isAt);
+        QueueProtocolMessage(header);
+        return;
+    }
+
+    //
+    // The full list is split across as many messages as it takes, exactly as
+    // for the down-version messages.  Only a list that fits in one message can
+    // claim to be complete; the parts of a longer list are all sent at the
+    // current generation and are merged together by the receivers.
+    //
+    uint32_t nSent = 0;
+
+    for (list<qcc::String>::iterator i = m_advertised.begin(); i != m_advertised.end(); ++i) {
+        size_t currentSize = header.GetSerializedSize() + isAt.GetSerializedSize() + 20;
+
+        if (currentSize + 1 + (*i).size() > NS_MESSAGE_MAX) {
+            header.AddAnswer(isAt);
+            QueueProtocolMessage(header);
+            ++nSent;
+
+            header.Reset();
+            isAt.Reset();
+        }
+        isAt.AddName(*i);
+    }
+
+    if (nSent == 0) {
+        isAt.SetCompleteFlag(true);
+    }
+
+    header.AddAnswer(isAt);
+    QueueProtocolMessage(header);
+}
+
+void IpNameServiceImpl::RetransmitLegacy(bool exiting)
+{
+    QCC_DbgPrintf(("IpNameServiceImpl::RetransmitLegacy()"));
+
     //
     // We are now at version one of the protocol.  There is a significant
     // difference between version zero and version one messages, so down-version
@@ -2883,8 +3355,341 @@ void IpNameServiceImpl::Retransmit(bool exiting)
         header.AddAnswer(isAt);
         QueueProtocolMessage(header);
     }
+}
+
+bool IpNameServiceImpl::LegacyPeersPresent(void)
+{
+    return qcc::GetTimestamp64() < m_tLegacyUntil;
+}
+
+void IpNameServiceImpl::ScheduleAnswer(bool legacy)
+{
+    QCC_DbgPrintf(("IpNameServiceImpl::ScheduleAnswer(%s)", legacy ? "legacy" : "v2"));
+
+    //
+    // If an answer of the requested flavor is already on its way, the asker
+    // will hear it along with everyone else.
+    //
+    bool& pending = legacy ? m_answerLegacy : m_answerV2;
+    if (m_tAnswerDue && pending) {
+        ++m_numSuppressed;
+        return;
+    }
+
+    pending = true;
+    if (m_tAnswerDue) {
+        return;
+    }
+
+    //
+    // Wait a little while so that the answers of the daemons on the net are
+    // spread out and so that questions arriving in the meantime share our
+    // answer.  Never answer more often than once per ANSWER_HOLDOFF.
+    //
+    uint64_t tDue = qcc::GetTimestamp64() + ANSWER_DELAY_MIN + rand() % ANSWER_DELAY_RANGE;
+    if (m_tLastAnswer && tDue < m_tLastAnswer + ANSWER_HOLDOFF) {
+        tDue = m_tLastAnswer + ANSWER_HOLDOFF;
+    }
+    m_tAnswerDue = tDue;
+    m_wakeEvent.SetEvent();
+}
+
+void IpNameServiceImpl::SendScheduledAnswers(void)
+{
+    QCC_DbgPrintf(("IpNameServiceImpl::SendScheduledAnswers()"));
+
+    m_mutex.Lock();
+
+    if (m_answerV2) {
+        RetransmitV2(false, true);
+    }
+    if (m_answerLegacy) {
+        RetransmitLegacy(false);
+    }
+
+    ++m_numAnswered;
+    m_tLastAnswer = qcc::GetTimestamp64();
+    m_tAnswerDue = 0;
+    m_answerLegacy = false;
+    m_answerV2 = false;
+
+    m_mutex.Unlock();
+}
+
+//
+// A 32-bit FNV-1a hash of the names in a question.  A zero octet goes in after
+// each name so that, say, "ab" "c" and "a" "bc" hash differently.
+//
+static uint32_t HashNames(const WhoHasView& whoHas)
+{
+    uint32_t hash = 2166136261U;
+    for (uint32_t i = 0; i < whoHas.GetNumberNames(); ++i) {
+        StringRef name = whoHas.GetName(i);
+        for (size_t j = 0; j < name.GetSize(); ++j) {
+            hash = (hash ^ static_cast<uint8_t>(name.GetData()[j])) * 16777619U;
+        }
+        hash *= 16777619U;
+    }
+    return hash;
+}
+
+bool IpNameServiceImpl::IsCompatibilityCopy(const HeaderView& header, const qcc::IPAddress& address)
+{
+    //
+    // A version two daemon follows its answers with down-version copies as
+    // long as it thinks there are legacy daemons around.  We know it speaks
+    // version two if we have heard a version two answer from it.  Our own
+    // copies are looped back to us too.  The GUID is compared where it lies
+    // in the message so that dropping a copy costs no allocations.
+    //
+    for (uint32_t i = 0; i < header.GetNumberAnswers(); ++i) {
+        IsAtView isAt;
+        header.GetAnswer(i, isAt);
+        StringRef guid = isAt.GetGuid();
+        if (guid.Equals(m_guid)) {
+            return true;
+        }
+        for (map<qcc::String, PeerAdvertisements>::iterator j = m_peers.begin(); j != m_peers.end(); ++j) {
+            if (guid.Equals(j->first)) {
+                return true;
+            }
+        }
+    }
+
+    //
+    // Questions carry no GUID, so a down-version question is taken to be a
+    // copy if it asks for the same names as a version two question that came
+    // from the same place a moment ago.
+    //
+    uint64_t tNow = qcc::GetTimestamp64();
+
+    for (uint32_t i = 0; i < header.GetNumberQuestions(); ++i) {
+        WhoHasView whoHas;
+        header.GetQuestion(i, whoHas);
+        uint32_t hash = HashNames(whoHas);
+
+        for (uint32_t j = 0; j < RECENT_QUESTIONS; ++j) {
+            RecentQuestion& question = m_recentQuestions[j];
+            if (question.m_tReceived && question.m_tReceived + COMPATIBILITY_COPY_WINDOW > tNow &&
+                question.m_hash == hash && question.m_address == address) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+void IpNameServiceImpl::AddKnownAnswers(WhoHas& whoHas)
+{
+    //
+    // The known answers go at the end of the question, so they can have
+    // whatever space the header, the question and the count octet leave over.
+    //
+    size_t used = 4 + whoHas.GetSerializedSize() + 1;
+    if (used >= NS_MESSAGE_MAX) {
+        return;
+    }
+    size_t room = NS_MESSAGE_MAX - used;
+
+    uint64_t tNow = qcc::GetTimestamp64();
+
+    //
+    // Only list peers whose complete list we hold and whose advertisements
+    // are not about to run out.  A peer whose entry is over half way to
+    // expiring answers anyway, which refreshes everyone else too.
+    //
+    for (map<qcc::String, PeerAdvertisements>::iterator i = m_peers.begin(); i != m_peers.end(); ++i) {
+        PeerAdvertisements& peer = i->second;
+        if (peer.m_complete == false || peer.m_resync || (peer.m_tHalfLife && peer.m_tHalfLife <= tNow)) {
+            continue;
+        }
+
+        size_t size = 1 + i->first.size() + 2;
+        if (size > room || whoHas.GetNumberKnownAnswers() == 255) {
+            break;
+        }
+
+        whoHas.AddKnownAnswer(i->first, peer.m_generation);
+        room -= size;
+    }
+}
+
+bool IpNameServiceImpl::UpdatePeer(IsAt& isAt, uint32_t timer, vector<qcc::String>& wkn)
+{
+    m_mutex.Lock();
+
+    uint64_t tNow = qcc::GetTimestamp64();
+
+    //
+    // Forget about peers that have expired, once we can no longer hear any
+    // down-version copies of their messages.
+    //
+    for (map<qcc::String, PeerAdvertisements>::iterator i = m_peers.begin(); i != m_peers.end();) {
+        PeerAdvertisements& peer = i->second;
+        if (peer.m_tExpire && peer.m_tExpire <= tNow && peer.m_tHeard + LEGACY_HOLD * 1000 <= tNow) {
+            m_peers.erase(i++);
+        } else {
+            ++i;
+        }
+    }
+
+    qcc::String guid = isAt.GetGuid();
+    uint16_t generation = isAt.GetGeneration();
+
+    bool known = m_peers.find(guid) != m_peers.end();
+    PeerAdvertisements& peer = m_peers[guid];
+    peer.m_tHeard = tNow;
+
+    if (timer == DURATION_INFINITE) {
+        peer.m_tHalfLife = 0;
+        peer.m_tExpire = 0;
+    } else if (timer) {
+        peer.m_tHalfLife = tNow + timer * 500;
+        peer.m_tExpire = tNow + timer * 1000;
+    }
+
+    bool report = true;
+    vector<qcc::String> names;
+
+    if (isAt.GetCompleteFlag()) {
+        //
+        // A complete list replaces whatever we had.  A complete withdrawal
+        // means the peer has nothing left to advertise.
+        //
+        if (timer) {
+            peer.m_names = wkn;
+            peer.m_complete = true;
+        } else {
+            peer.m_names.clear();
+            peer.m_complete = false;
+            peer.m_tHalfLife = tNow;
+            peer.m_tExpire = tNow;
+        }
+        peer.m_generation = generation;
+        peer.m_resync = false;
+    } else if (wkn.empty()) {
+        //
+        // A refresh.  If we are up to date we report the names we hold so the
+        // callback sees the new timer.  If not, we have missed something and
+        // need to ask for the whole list.
+        //
+        if (timer == 0) {
+            report = false;
+        } else if (known && peer.m_generation == generation) {
+            wkn = peer.m_names;
+            report = wkn.empty() == false;
+        } else {
+            QCC_DbgPrintf(("IpNameServiceImpl::UpdatePeer(): Refresh of unknown generation %d from %s", generation, guid.c_str()));
+            peer.m_names.clear();
+            peer.m_generation = generation;
+            peer.m_complete = false;
+            peer.m_resync = true;
+            ScheduleResync();
+            report = false;
+        }
+    } else if (known == false || peer.m_generation == generation) {
+        //
+        // A part of a list too big for one message, or a delta from a peer we
+        // have never heard of.  Either way we know some, but maybe not all, of
+        // the peer's names.
+        //
+        if (timer) {
+            set_union(peer.m_names.begin(), peer.m_names.end(), wkn.begin(), wkn.end(), back_inserter(names));
+        } else {
+            set_difference(peer.m_names.begin(), peer.m_names.end(), wkn.begin(), wkn.end(), back_inserter(names));
+        }
+        peer.m_names.swap(names);
+        peer.m_generation = generation;
+        if (known == false) {
+            peer.m_complete = false;
+        }
+    } else if (generation == static_cast<uint16_t>(peer.m_generation + 1)) {
+        //
+        // The next delta.  Apply it to what we hold.
+        //
+        if (timer) {
+            set_union(peer.m_names.begin(), peer.m_names.end(), wkn.begin(), wkn.end(), back_inserter(names));
+        } else {
+            set_difference(peer.m_names.begin(), peer.m_names.end(), wkn.begin(), wkn.end(), back_inserter(names));
+        }
+        peer.m_names.swap(names);
+        peer.m_generation = generation;
+    } else {
+        //
+        // We missed at least one delta, so what we hold is out of date.  Keep
+        // what this delta tells us and ask for the rest.
+        //
+        QCC_DbgPrintf(("IpNameServiceImpl::UpdatePeer(): Generation %d from %s after %d", generation, guid.c_str(), peer.m_generation));
+        if (timer) {
+            peer.m_names = wkn;
+        } else {
+            peer.m_names.clear();
+        }
+        peer.m_generation = generation;
+        peer.m_complete = false;
+        peer.m_resync = true;
+        ScheduleResync();
+    }
+
+    m_mutex.Unlock();
+    return report;
+}
+
+void IpNameServiceImpl::ScheduleResync(void)
+{
+    if (m_tResyncDue) {
+        return;
+    }
+
+    uint64_t tDue = qcc::GetTimestamp64() + ANSWER_DELAY_MIN + rand() % ANSWER_DELAY_RANGE;
+    if (m_tLastResync && tDue < m_tLastResync + RESYNC_INTERVAL) {
+        tDue = m_tLastResync + RESYNC_INTERVAL;
+    }
+    m_tResyncDue = tDue;
+    m_wakeEvent.SetEvent();
+}
+
+void IpNameServiceImpl::SendResync(void)
+{
+    QCC_DbgPrintf(("IpNameServiceImpl::SendResync()"));
+
+    m_mutex.Lock();
+
+    m_tResyncDue = 0;
+
+    //
+    // A complete answer may have arrived while we were waiting, in which case
+    // there is nothing left to ask for.
+    //
+    bool needed = false;
+    for (map<qcc::String, PeerAdvertisements>::iterator i = m_peers.begin(); i != m_peers.end(); ++i) {
+        if (i->second.m_resync) {
+            i->second.m_resync = false;
+            needed = true;
+        }
+    }
+
+    if (needed) {
+        //
+        // Ask everyone for everything.  The peers we are up to date with are
+        // listed as known answers and stay quiet, so only the ones we lost
+        // track of answer.
+        //
+        WhoHas whoHas;
+        whoHas.SetVersion(2, 2);
+        whoHas.AddName("*");
+        AddKnownAnswers(whoHas);
+
+        Header header;
+        header.SetVersion(2, 2);
+        header.SetTimer(m_tDuration);
+        header.AddQuestion(whoHas);
+
+        QueueProtocolMessage(header);
+        m_tLastResync = qcc::GetTimestamp64();
+    }
 
-    QCC_DbgPrintf(("IpNameServiceImpl::Retransmit(): Giving lock"));
     m_mutex.Unlock();
 }
 
@@ -2917,7 +3722,7 @@ void IpNameServiceImpl::DoPeriodicMaintenance(void)
     m_mutex.Unlock();
 }
 
-void IpNameServiceImpl::HandleProtocolQuestion(WhoHas whoHas, qcc::IPAddress address)
+void IpNameServiceImpl::HandleProtocolQuestion(const WhoHasView& whoHas, qcc::IPAddress address)
 {
     QCC_DbgHLPrintf(("IpNameServiceImpl::HandleProtocolQuestion()"));
 
@@ -2936,13 +3741,13 @@ void IpNameServiceImpl::HandleProtocolQuestion(WhoHas whoHas, qcc::IPAddress add
     //
     bool respond = false;
     for (uint32_t i = 0; i < whoHas.GetNumberNames(); ++i) {
-        qcc::String wkn = whoHas.GetName(i);
+        StringRef wkn = whoHas.GetName(i);
 
         //
         // Zero length strings are unmatchable.  If you want to do a wildcard
         // match, you've got to send a wildcard character.
         //
-        if (wkn.size() == 0) {
+        if (wkn.GetSize() == 0) {
             continue;
         }
 
@@ -2955,9 +3760,9 @@ void IpNameServiceImpl::HandleProtocolQuestion(WhoHas whoHas, qcc::IPAddress add
             // The requested name comes in from the WhoHas message and we
             // allow wildcards there.
             //
-            if (IpNameServiceImplWildcardMatch((*j), wkn)) {
-                QCC_DbgHLPrintf(("IpNameServiceImpl::HandleProtocolQuestion(): request for %s does not match my %s",
-                                 wkn.c_str(), (*j).c_str()));
+            if (WildcardMatch((*j).c_str(), (*j).size(), wkn.GetData(), wkn.GetSize())) {
+                QCC_DbgHLPrintf(("IpNameServiceImpl::HandleProtocolQuestion(): request for %.*s does not match my %s",
+                                 static_cast<int>(wkn.GetSize()), wkn.GetData(), (*j).c_str()));
                 continue;
             } else {
                 respond = true;
@@ -2974,31 +3779,36 @@ void IpNameServiceImpl::HandleProtocolQuestion(WhoHas whoHas, qcc::IPAddress add
         }
     }
 
-    QCC_DbgHLPrintf(("IpNameServiceImpl::HandleProtocolQuestion(): Giving lock"));
-    m_mutex.Unlock();
+    //
+    // A version two asker may already hold our current advertisements, in
+    // which case there is nothing we could tell it.
+    //
+    uint32_t nsVersion, msgVersion;
+    whoHas.GetVersion(nsVersion, msgVersion);
+    if (respond && msgVersion == 2 && whoHas.IsKnownAnswer(m_guid, m_generation)) {
+        QCC_DbgHLPrintf(("IpNameServiceImpl::HandleProtocolQuestion(): Asker already knows our answer"));
+        ++m_numSuppressed;
+        respond = false;
+    }
 
     //
     // Since any response we send must include all of the advertisements we
     // are exporting; this just means to retransmit all of our advertisements.
+    // We don't do that right away; the answer goes out a little later and
+    // covers everyone who asks in the meantime.
     //
     if (respond) {
-        Retransmit(false);
+        ScheduleAnswer(msgVersion < 2);
     }
+
+    QCC_DbgHLPrintf(("IpNameServiceImpl::HandleProtocolQuestion(): Giving lock"));
+    m_mutex.Unlock();
 }
 
-void IpNameServiceImpl::HandleProtocolAnswer(IsAt isAt, uint32_t timer, qcc::IPAddress address)
+void IpNameServiceImpl::HandleProtocolAnswer(IsAt& isAt, uint32_t timer, qcc::IPAddress address)
 {
     QCC_DbgHLPrintf(("IpNameServiceImpl::HandleProtocolAnswer()"));
 
-    //
-    // If there are no callbacks we can't tell the user anything about what is
-    // going on the net, so it's pointless to go any further.
-    //
-    if (m_callback == 0) {
-        QCC_DbgPrintf(("IpNameServiceImpl::HandleProtocolAnswer(): No callback, so nothing to do"));
-        return;
-    }
-
     //
     // For version zero messages from version one transports, we need to
     // disregard the name service messages sent out in compatibility mode
@@ -3028,6 +3838,25 @@ void IpNameServiceImpl::HandleProtocolAnswer(IsAt isAt, uint32_t timer, qcc::IPA
     //
     sort(wkn.begin(), wkn.end());
 
+    //
+    // Version two answers may only describe changes, or just refresh the names
+    // we already know about.  We always keep track of them, even if there is
+    // nobody to tell, so our known-answer lists are right.
+    //
+    if (msgVersion == 2 && UpdatePeer(isAt, timer, wkn) == false) {
+        QCC_DbgPrintf(("IpNameServiceImpl::HandleProtocolAnswer(): Nothing to report"));
+        return;
+    }
+
+    //
+    // If there are no callbacks we can't tell the user anything about what is
+    // going on the net, so it's pointless to go any further.
+    //
+    if (m_callback == 0) {
+        QCC_DbgPrintf(("IpNameServiceImpl::HandleProtocolAnswer(): No callback, so nothing to do"));
+        return;
+    }
+
     qcc::String guid = isAt.GetGuid();
     QCC_DbgPrintf(("IpNameServiceImpl::HandleProtocolAnswer(): Got GUID %s", guid.c_str()));
 
@@ -3146,7 +3975,7 @@ void IpNameServiceImpl::HandleProtocolAnswer(IsAt isAt, uint32_t timer, qcc::IPA
                 (*m_callback)(busAddress, guid, wkn, timer);
             }
         }
-    } else if (msgVersion == 1) {
+    } else if (msgVersion == 1 || msgVersion == 2) {
         //
         // In the version one protocol, the maximum size static buffer for the
         // longest bus address we can generate corresponds to two fully occupied
@@ -3252,23 +4081,59 @@ void IpNameServiceImpl::HandleProtocolMessage(uint8_t const* buffer, uint32_t nb
     }
 #endif
 
-    Header header;
-    size_t bytesRead = header.Deserialize(buffer, nbytes);
+    //
+    // Most of what we hear needs no more than a look: questions about names
+    // we don't advertise or whose answer the asker already holds, our own
+    // messages, and the down-version copies of messages we have already
+    // heard.  So the message is checked where it lies in the receive buffer
+    // and only the answers we pass on are copied out into objects.
+    //
+    HeaderView header;
+    size_t bytesRead = header.Parse(buffer, nbytes);
     if (bytesRead != nbytes) {
-        QCC_DbgPrintf(("IpNameServiceImpl::HandleProtocolMessage(): Deserialize(): Error"));
+        QCC_DbgPrintf(("IpNameServiceImpl::HandleProtocolMessage(): Parse(): Error"));
         return;
     }
 
     //
-    // We only understand version zero and one messages.
+    // We only understand version zero, one and two messages.
     //
     uint32_t nsVersion, msgVersion;
     header.GetVersion(nsVersion, msgVersion);
-    if (msgVersion != 0 && msgVersion != 1) {
+    if (msgVersion > 2) {
         QCC_DbgPrintf(("IpNameServiceImpl::HandleProtocolMessage(): Unknown version: Error"));
         return;
     }
 
+    //
+    // Version two daemons send down-version copies of their messages while
+    // there are legacy daemons around.  We have already heard the version two
+    // original, so the copies are dropped.  Anything else down-version comes
+    // from a legacy daemon and means we have to keep talking to it in its own
+    // language.
+    //
+    m_mutex.Lock();
+    uint64_t tNow = qcc::GetTimestamp64();
+    if (msgVersion == 2) {
+        for (uint32_t i = 0; i < header.GetNumberQuestions(); ++i) {
+            WhoHasView whoHas;
+            header.GetQuestion(i, whoHas);
+
+            RecentQuestion& question = m_recentQuestions[m_nextRecentQuestion];
+            m_nextRecentQuestion = (m_nextRecentQuestion + 1) % RECENT_QUESTIONS;
+            question.m_address = address;
+            question.m_hash = HashNames(whoHas);
+            question.m_tReceived = tNow;
+        }
+    } else if (IsCompatibilityCopy(header, address)) {
+        QCC_DbgPrintf(("IpNameServiceImpl::HandleProtocolMessage(): Ignoring down-version copy"));
+        m_mutex.Unlock();
+        return;
+    } else {
+        m_tLegacyUntil = tNow + LEGACY_HOLD * 1000;
+    }
+    m_mutex.Unlock();
+
     //
     // If the received packet contains questions, see if we can answer them.
     // We have the underlying device in loopback mode so we can get receive
@@ -3276,28 +4141,38 @@ void IpNameServiceImpl::HandleProtocolMessage(uint8_t const* buffer, uint32_t nb
     // reply, but if we do have the requested names, we answer ourselves
     // to pass on this information to other interested bystanders.
     //
-    for (uint8_t i = 0; i < header.GetNumberQuestions(); ++i) {
-        HandleProtocolQuestion(header.GetQuestion(i), address);
+    for (uint32_t i = 0; i < header.GetNumberQuestions(); ++i) {
+        WhoHasView whoHas;
+        header.GetQuestion(i, whoHas);
+        HandleProtocolQuestion(whoHas, address);
     }
 
     //
     // If the received packet contains answers, see if they are answers to
     // questions we think are interesting.  Make sure we are not talking to
-    // ourselves unless we are told to for debugging purposes
-    //
-    for (uint8_t i = 0; i < header.GetNumberAnswers(); ++i) {
-        IsAt isAt = header.GetAnswer(i);
+    // ourselves unless we are told to for debugging purposes.  Version zero
+    // answers with the UDP flag set are the compatibility copies sent by
+    // version one daemons and are dropped in HandleProtocolAnswer(), so we
+    // don't bother copying them out.
+    //
+    for (uint32_t i = 0; i < header.GetNumberAnswers(); ++i) {
+        IsAtView answer;
+        header.GetAnswer(i, answer);
+        if (!m_loopback && answer.GetGuid().Equals(m_guid)) {
+            continue;
+        }
+        if (nsVersion == 0 && msgVersion == 0 && answer.GetUdpFlag()) {
+            QCC_DbgPrintf(("IpNameServiceImpl::HandleProtocolMessage(): Ignoring version zero message from version one peer"));
+            continue;
+        }
+
         //
         // The version isn't actually carried in the is-at message since that
-        // would be redundant, so we have to set it from the header version
-        // before passing it off.
+        // would be redundant; Copy() sets it from the header version.
         //
-        uint32_t nsVersion, msgVersion;
-        header.GetVersion(nsVersion, msgVersion);
-        isAt.SetVersion(nsVersion, msgVersion);
-        if (m_loopback || (isAt.GetGuid() != m_guid)) {
-            HandleProtocolAnswer(isAt, header.GetTimer(), address);
-        }
+        IsAt isAt;
+        answer.Copy(isAt);
+        HandleProtocolAnswer(isAt, header.GetTimer(), address);
     }
 }
 
@@ -3308,6 +4183,28 @@ QStatus IpNameServiceImpl::Start()
     assert(IsRunning() == false);
     QCC_DbgPrintf(("IpNameServiceImpl::Start(): Starting thread"));
     m_state = IMPL_RUNNING;
+    m_socketsOpened = 0;
+    m_socketsClosed = 0;
+
+    //
+    // Start our generation at a random value so that peers that remember us
+    // from a previous run do not mistake our names for the ones they hold.
+    // We don't know whether there are any down-version daemons around, so we
+    // assume there are until we have been quiet for a while.
+    //
+    m_generation = static_cast<uint16_t>(qcc::Rand32());
+    m_tLegacyUntil = qcc::GetTimestamp64() + LEGACY_HOLD * 1000;
+    m_tAnswerDue = 0;
+    m_answerLegacy = false;
+    m_answerV2 = false;
+    m_tResyncDue = 0;
+    m_peers.clear();
+    for (uint32_t i = 0; i < RECENT_QUESTIONS; ++i) {
+        m_recentQuestions[i].m_tReceived = 0;
+    }
+    m_nextRecentQuestion = 0;
+    m_numAnswered = 0;
+    m_numSuppressed = 0;
     QStatus status = Thread::Start(this);
     QCC_DbgPrintf(("IpNameServiceImpl::Start(): Started"));
     m_mutex.Unlock();
@@ -28,11 +28,13 @@
 
 #include <vector>
 #include <list>
+#include <map>
 
 #include <qcc/String.h>
 #include <qcc/Thread.h>
 #include <qcc/Mutex.h>
 #include <qcc/Socket.h>
+#include <qcc/IPAddress.h>
 
 #include <alljoyn/TransportMask.h>
 
@@ -40,6 +42,7 @@
 #include <Callback.h>
 
 #include "IpNsProtocol.h"
+#include "InterfaceMonitor.h"
 
 namespace ajn {
 
@@ -144,6 +147,47 @@ class IpNameServiceImpl : public qcc::Thread {
      */
     static const uint32_t DURATION_INFINITE = 255;
 
+    /**
+     * @brief The shortest time we wait before answering a WhoHas request.  We
+     * wait a random time between ANSWER_DELAY_MIN and ANSWER_DELAY_MIN +
+     * ANSWER_DELAY_RANGE so that daemons do not all answer at once, and so
+     * that requests arriving in the meantime are covered by a single answer.
+     * Units are milliseconds.
+     */
+    static const uint32_t ANSWER_DELAY_MIN = 20;
+
+    /**
+     * @brief The spread of the random delay before answering a WhoHas request.
+     * Units are milliseconds.
+     */
+    static const uint32_t ANSWER_DELAY_RANGE = 100;
+
+    /**
+     * @brief The minimum time between two complete answers.  Anyone who asked
+     * during that time heard the last answer.  Units are milliseconds.
+     */
+    static const uint32_t ANSWER_HOLDOFF = 1000;
+
+    /**
+     * @brief The minimum time between WhoHas requests sent to recover from a
+     * missed version two delta advertisement.  Units are milliseconds.
+     */
+    static const uint32_t RESYNC_INTERVAL = 1000;
+
+    /**
+     * @brief How long we keep sending version zero and one messages after we
+     * last heard from a daemon that only speaks those versions.  We assume
+     * there is one when we start.  Units are seconds.
+     */
+    static const uint32_t LEGACY_HOLD = DEFAULT_DURATION;
+
+    /**
+     * @brief How long after a version two WhoHas we treat an identical
+     * version zero or one WhoHas from the same address as its down-version
+     * copy.  Units are milliseconds.
+     */
+    static const uint32_t COMPATIBILITY_COPY_WINDOW = 2000;
+
     /**
      * @brief The maximum size of the payload of a name service message.
      *
@@ -216,6 +260,44 @@ class IpNameServiceImpl : public qcc::Thread {
      */
     QStatus Init(const qcc::String& guid, bool loopback = false);
 
+    /**
+     * @internal
+     * @brief Replace the source of network interface change notifications.
+     *
+     * By default the name service uses InterfaceMonitor::Create().  Test
+     * programs can provide their own monitor to script interface changes.
+     * Must be called before Start().
+     *
+     * @param monitor The new monitor.  The name service takes ownership.
+     *
+     * @return ER_OK if the monitor was replaced, ER_FAIL if the name service
+     *     has already been started.
+     */
+    QStatus SetInterfaceMonitor(InterfaceMonitor* monitor);
+
+    /**
+     * @internal
+     * @brief Get counts of the multicast sockets the name service has opened
+     * and closed while tracking interface changes.
+     *
+     * @param numLive   The number of interfaces currently in use.
+     * @param numOpened The number of sockets opened since Start().
+     * @param numClosed The number of sockets closed since Start().
+     */
+    void GetInterfaceStats(uint32_t& numLive, uint32_t& numOpened, uint32_t& numClosed);
+
+    /**
+     * @internal
+     * @brief Get counts of how the name service dealt with WhoHas requests
+     * that matched its advertisements.
+     *
+     * @param numAnswered   The number of complete answers sent since Start().
+     * @param numSuppressed The number of matching requests that did not cause
+     *     an answer of their own, either because the requester already knew the
+     *     answer or because the request was covered by a pending answer.
+     */
+    void GetAnswerStats(uint32_t& numAnswered, uint32_t& numSuppressed);
+
     /**
      * @brief Start any required name service threads.
      */
@@ -820,13 +902,13 @@ class IpNameServiceImpl : public qcc::Thread {
      * @internal
      * @brief Do something with a received protocol question.
      */
-    void HandleProtocolQuestion(WhoHas whoHas, qcc::IPAddress address);
+    void HandleProtocolQuestion(const WhoHasView& whoHas, qcc::IPAddress address);
 
     /**
      * @internal
      * @brief Do something with a received protocol answer.
      */
-    void HandleProtocolAnswer(IsAt isAt, uint32_t timer, qcc::IPAddress address);
+    void HandleProtocolAnswer(IsAt& isAt, uint32_t timer, qcc::IPAddress address);
 
     Callback<void, const qcc::String&, const qcc::String&, std::vector<qcc::String>&, uint8_t>* m_callback;
 
@@ -944,6 +1026,174 @@ class IpNameServiceImpl : public qcc::Thread {
      */
     void Retransmit(bool exiting);
 
+    /**
+     * @internal
+     * @brief Queue version zero and version one messages carrying the complete
+     * list of exported advertisements.
+     */
+    void RetransmitLegacy(bool exiting);
+
+    /**
+     * @internal
+     * @brief Queue version two messages carrying the complete list of
+     * exported advertisements if complete is true, or a refresh carrying only
+     * their generation if it is false.
+     */
+    void RetransmitV2(bool exiting, bool complete);
+
+    /**
+     * @internal
+     * @brief Arrange to answer a WhoHas request after a short random delay.
+     * Requests that arrive before the answer goes out share it.
+     */
+    void ScheduleAnswer(bool legacy);
+
+    /**
+     * @internal
+     * @brief Send the answers arranged by ScheduleAnswer().
+     */
+    void SendScheduledAnswers(void);
+
+    /**
+     * @internal
+     * @brief Returns true if we have recently heard from a daemon that only
+     * speaks versions zero and one of the protocol.
+     */
+    bool LegacyPeersPresent(void);
+
+    /**
+     * @internal
+     * @brief Returns true if a version zero or one message is the down-version
+     * copy of a message sent by a version two daemon.
+     */
+    bool IsCompatibilityCopy(const HeaderView& header, const qcc::IPAddress& address);
+
+    /**
+     * @internal
+     * @brief Fill in the known-answer list of a version two WhoHas with the
+     * peers whose advertisements we hold, as far as they fit in a message.
+     */
+    void AddKnownAnswers(WhoHas& whoHas);
+
+    /**
+     * @internal
+     * @brief Apply a version two IsAt to what we remember about its sender.
+     *
+     * @param isAt  The received answer.
+     * @param timer The timer from the message header.
+     * @param wkn   The names in the answer.  Replaced by the remembered names
+     *              if the answer is a refresh.
+     *
+     * @return true if wkn should be reported to the callback.
+     */
+    bool UpdatePeer(IsAt& isAt, uint32_t timer, std::vector<qcc::String>& wkn);
+
+    /**
+     * @internal
+     * @brief Arrange to send a WhoHas that recovers the advertisements of
+     * peers whose deltas we missed.
+     */
+    void ScheduleResync(void);
+
+    /**
+     * @internal
+     * @brief Send the WhoHas arranged by ScheduleResync() if it is still
+     * needed.
+     */
+    void SendResync(void);
+
+    /**
+     * @internal
+     * @brief What we remember about the advertisements of a version two peer.
+     */
+    class PeerAdvertisements {
+      public:
+        PeerAdvertisements() : m_generation(0), m_complete(false), m_resync(false), m_tHalfLife(0), m_tExpire(0), m_tHeard(0) { }
+
+        std::vector<qcc::String> m_names; /**< The sorted names we know the peer advertises */
+        uint16_t m_generation;  /**< The generation of the peer's names that m_names reflects */
+        bool m_complete;        /**< True if m_names is the peer's complete list */
+        bool m_resync;          /**< True if we missed a change and need to ask again */
+        uint64_t m_tHalfLife;   /**< When half of the advertisement lifetime is gone, zero if forever */
+        uint64_t m_tExpire;     /**< When the advertisements expire, zero if forever */
+        uint64_t m_tHeard;      /**< When we last heard from the peer */
+    };
+
+    /**
+     * @internal
+     * @brief Version two peers we have heard from, indexed by daemon GUID.
+     */
+    std::map<qcc::String, PeerAdvertisements> m_peers;
+
+    /**
+     * @internal
+     * @brief A recently received version two WhoHas, used to recognize the
+     * down-version copies that follow it.  Only a hash of the names is kept so
+     * that remembering a question allocates nothing.
+     */
+    class RecentQuestion {
+      public:
+        RecentQuestion() : m_hash(0), m_tReceived(0) { }
+
+        qcc::IPAddress m_address;   /**< The address the question came from */
+        uint32_t m_hash;            /**< A hash of the names asked about */
+        uint64_t m_tReceived;       /**< When the question arrived, or zero if the slot is empty */
+    };
+
+    /**
+     * @internal
+     * @brief The number of recent questions remembered.  Copies follow their
+     * original immediately, so only the last few questions matter; older ones
+     * are overwritten.
+     */
+    static const uint32_t RECENT_QUESTIONS = 16;
+
+    RecentQuestion m_recentQuestions[RECENT_QUESTIONS];
+    uint32_t m_nextRecentQuestion;
+
+    /**
+     * @internal
+     * @brief The generation of our advertised names.  Incremented whenever a
+     * name is advertised or withdrawn.
+     */
+    uint16_t m_generation;
+
+    /**
+     * @internal
+     * @brief Until when we send version zero and one messages.
+     */
+    uint64_t m_tLegacyUntil;
+
+    /**
+     * @internal
+     * @brief When the scheduled answers are due, zero if none are scheduled,
+     * and which versions they are for.
+     */
+    uint64_t m_tAnswerDue;
+    bool m_answerLegacy;
+    bool m_answerV2;
+
+    /**
+     * @internal
+     * @brief When we last sent a complete version two answer.
+     */
+    uint64_t m_tLastAnswer;
+
+    /**
+     * @internal
+     * @brief When the scheduled resync WhoHas is due, zero if none is
+     * scheduled, and when we last sent one.
+     */
+    uint64_t m_tResyncDue;
+    uint64_t m_tLastResync;
+
+    /**
+     * @internal
+     * @brief Answer statistics since Start().
+     */
+    uint32_t m_numAnswered;
+    uint32_t m_numSuppressed;
+
     /**
      * @internal
      * @brief Vector of name service messages reflecting recent locate
@@ -1034,6 +1284,22 @@ class IpNameServiceImpl : public qcc::Thread {
     qcc::SocketFd m_refSockFd;
 #endif
 
+    /**
+     * @internal
+     * @brief Source of network interface change notifications.  If it
+     * provides an event, interface sockets are only opened and closed as the
+     * corresponding interfaces change; otherwise they are all torn down and
+     * reopened on every lazy update.
+     */
+    InterfaceMonitor* m_interfaceMonitor;
+
+    /**
+     * @internal
+     * @brief The number of interface sockets opened and closed since Start().
+     */
+    uint32_t m_socketsOpened;
+    uint32_t m_socketsClosed;
+
     /**
      * @internal
      * @brief Tear down all live interfaces and remove them from the
@@ -1041,6 +1307,27 @@ class IpNameServiceImpl : public qcc::Thread {
      */
     void ClearLiveInterfaces(void);
 
+    /**
+     * @internal
+     * @brief Leave the multicast group and close the socket of a live
+     * interface.
+     */
+    void CloseLiveInterface(LiveInterface& live);
+
+    /**
+     * @internal
+     * @brief Decide whether an interface reported by the system is one we
+     * want to send and receive name service messages over.
+     */
+    bool UseInterface(const qcc::IfConfigEntry& entry);
+
+    /**
+     * @internal
+     * @brief Open and configure a socket for an interface reported by the
+     * system and add it to the live interfaces.
+     */
+    void OpenLiveInterface(const qcc::IfConfigEntry& entry);
+
     /**
      * @internal
      * @brief Make sure that we have socket open to talk and listen to as many
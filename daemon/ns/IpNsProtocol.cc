@@ -20,6 +20,7 @@
  ******************************************************************************/
 
 #include <assert.h>
+#include <string.h>
 #include <qcc/Debug.h>
 #include <qcc/SocketTypes.h>
 #include <qcc/IPAddress.h>
@@ -110,7 +111,7 @@ size_t StringData::Deserialize(uint8_t const* buffer, uint32_t bufsize)
 }
 
 IsAt::IsAt()
-    : m_version(0), m_flagG(false), m_flagC(false),
+    : m_version(0), m_transportMask(0), m_generation(0), m_flagG(false), m_flagC(false),
     m_flagT(false), m_flagU(false), m_flagS(false), m_flagF(false),
     m_flagR4(false), m_flagU4(false), m_flagR6(false), m_flagU6(false),
     m_port(0),
@@ -346,11 +347,13 @@ size_t IsAt::GetSerializedSize(void) const
         break;
 
     case 1:
+    case 2:
         //
         // We have one octet for type and flags, one octet for count and
-        // two octets for the transport mask.  Four octets to start.
+        // two octets for the transport mask.  Four octets to start.  Version
+        // two adds two octets of generation.
         //
-        size = 4;
+        size = (m_version & 0xf) == 2 ? 6 : 4;
 
         //
         // If the R4 bit is set, we are going to include an IPv4 address
@@ -530,6 +533,7 @@ size_t IsAt::Serialize(uint8_t* buffer) const
         break;
 
     case 1:
+    case 2:
         //
         // The first octet is type (M = 1) and flags.
         //
@@ -585,6 +589,17 @@ size_t IsAt::Serialize(uint8_t* buffer) const
         //
         p = &buffer[4];
 
+        //
+        // Version two messages carry the generation of the advertised names
+        // in the next two octets, again in network byte order.
+        //
+        if ((m_version & 0xf) == 2) {
+            *p++ = static_cast<uint8_t>(m_generation >> 8);
+            *p++ = static_cast<uint8_t>(m_generation);
+            QCC_DbgPrintf(("IsAt::Serialize(): Generation %d", m_generation));
+            size += 2;
+        }
+
         //
         // If the R4 bit is set, we need to include the reliable IPv4 address
         // and port.
@@ -847,11 +862,13 @@ size_t IsAt::Deserialize(uint8_t const* buffer, uint32_t bufsize)
         break;
 
     case 1:
+    case 2:
         //
         // If there's not enough room in the buffer to get the fixed part out then
-        // bail (one byte of type and flags, one byte of name count)
+        // bail (one byte of type and flags, one byte of name count, two bytes of
+        // transport mask and, in version two, two bytes of generation).
         //
-        if (bufsize < 2) {
+        if (bufsize < ((m_version & 0xf) == 2 ? 6U : 4U)) {
             QCC_DbgPrintf(("IsAt::Deserialize(): Insufficient bufsize %d", bufsize));
             return 0;
         }
@@ -912,6 +929,17 @@ size_t IsAt::Deserialize(uint8_t const* buffer, uint32_t bufsize)
         p = &buffer[4];
         bufsize -= 4;
 
+        //
+        // Version two messages carry the generation of the advertised names.
+        //
+        if ((m_version & 0xf) == 2) {
+            m_generation = (static_cast<uint16_t>(p[0]) << 8) | (static_cast<uint16_t>(p[1]) & 0xff);
+            QCC_DbgPrintf(("IsAt::Deserialize(): Generation %d", m_generation));
+            p += 2;
+            size += 2;
+            bufsize -= 2;
+        }
+
         //
         // If the R4 bit is set, we need to read off an IPv4 address and port;
         // and we'd better have enough buffer to read it out of.
@@ -1069,6 +1097,7 @@ WhoHas::~WhoHas()
 void WhoHas::Reset(void)
 {
     m_names.clear();
+    ClearKnownAnswers();
 }
 
 void WhoHas::AddName(qcc::String name)
@@ -1087,11 +1116,46 @@ qcc::String WhoHas::GetName(uint32_t index) const
     return m_names[index];
 }
 
+void WhoHas::AddKnownAnswer(const qcc::String& guid, uint16_t generation)
+{
+    m_knownGuids.push_back(guid);
+    m_knownGenerations.push_back(generation);
+}
+
+void WhoHas::ClearKnownAnswers(void)
+{
+    m_knownGuids.clear();
+    m_knownGenerations.clear();
+}
+
+uint32_t WhoHas::GetNumberKnownAnswers(void) const
+{
+    return m_knownGuids.size();
+}
+
+void WhoHas::GetKnownAnswer(uint32_t index, qcc::String& guid, uint16_t& generation) const
+{
+    assert(index < m_knownGuids.size());
+    guid = m_knownGuids[index];
+    generation = m_knownGenerations[index];
+}
+
+bool WhoHas::IsKnownAnswer(const qcc::String& guid, uint16_t generation) const
+{
+    for (uint32_t i = 0; i < m_knownGuids.size(); ++i) {
+        if (m_knownGenerations[i] == generation && m_knownGuids[i] == guid) {
+            return true;
+        }
+    }
+    return false;
+}
+
 size_t WhoHas::GetSerializedSize(void) const
 {
     //
     // Version zero and one are identical with the exeption of the definition
-    // of the flags, so the size is the same.
+    // of the flags, so the size is the same.  Version two adds the known-answer
+    // list at the end.
     //
     size_t size = 0;
 
@@ -1103,6 +1167,7 @@ size_t WhoHas::GetSerializedSize(void) const
     switch (m_version & 0xf) {
     case 0:
     case 1:
+    case 2:
         //
         // We have one octet for type and flags and one octet for count.
         // Two octets to start.
@@ -1118,6 +1183,20 @@ size_t WhoHas::GetSerializedSize(void) const
             s.Set(m_names[i]);
             size += s.GetSerializedSize();
         }
+
+        //
+        // If there are known answers in a version two message we have one
+        // octet of count followed by a GUID string and two octets of
+        // generation for each one.
+        //
+        if ((m_version & 0xf) == 2 && m_knownGuids.size()) {
+            size += 1;
+            for (uint32_t i = 0; i < m_knownGuids.size(); ++i) {
+                StringData s;
+                s.Set(m_knownGuids[i]);
+                size += s.GetSerializedSize() + 2;
+            }
+        }
         break;
 
     default:
@@ -1146,7 +1225,8 @@ size_t WhoHas::Serialize(uint8_t* buffer) const
     //
     // The only difference between version zero and one is that in version one
     // the flags are deprecated and revert to reserved.  So we just don't
-    // serialize them if we are writing a version one object.
+    // serialize them if we are writing a version one object.  Version two
+    // uses one of the reserved bits (K) to say there is a known-answer list.
     //
     // The message version is in the least significant nibble of the version.
     // We don't care about the peer name service protocol version which is
@@ -1171,6 +1251,12 @@ size_t WhoHas::Serialize(uint8_t* buffer) const
         }
     }
 
+    bool knownAnswers = (m_version & 0xf) == 2 && m_knownGuids.size();
+    if (knownAnswers) {
+        QCC_DbgPrintf(("WhoHas::Serialize(): K flag"));
+        typeAndFlags |= 0x20;
+    }
+
     buffer[0] = typeAndFlags;
     size += 1;
 
@@ -1200,6 +1286,30 @@ size_t WhoHas::Serialize(uint8_t* buffer) const
         p += stringSize;
     }
 
+    //
+    // The known-answer list follows the names as a count and then pairs of
+    // GUID string and generation.
+    //
+    if (knownAnswers) {
+        assert(m_knownGuids.size() < 256);
+        *p++ = static_cast<uint8_t>(m_knownGuids.size());
+        QCC_DbgPrintf(("WhoHas::Serialize(): KCount %d", m_knownGuids.size()));
+        size += 1;
+
+        for (uint32_t i = 0; i < m_knownGuids.size(); ++i) {
+            StringData stringData;
+            stringData.Set(m_knownGuids[i]);
+            QCC_DbgPrintf(("Whohas::Serialize(): known answer %s generation %d", m_knownGuids[i].c_str(), m_knownGenerations[i]));
+            size_t stringSize = stringData.Serialize(p);
+            size += stringSize;
+            p += stringSize;
+
+            *p++ = static_cast<uint8_t>(m_knownGenerations[i] >> 8);
+            *p++ = static_cast<uint8_t>(m_knownGenerations[i]);
+            size += 2;
+        }
+    }
+
     return size;
 }
 
@@ -1261,6 +1371,7 @@ size_t WhoHas::Deserialize(uint8_t const* buffer, uint32_t bufsize)
         break;
 
     case 1:
+    case 2:
         m_flagT = m_flagU = m_flagS = m_flagF = false;
         break;
 
@@ -1306,6 +1417,43 @@ size_t WhoHas::Deserialize(uint8_t const* buffer, uint32_t bufsize)
         bufsize -= stringSize;
     }
 
+    //
+    // If the K bit is set in a version two message, a known-answer list
+    // follows the names.
+    //
+    if ((m_version & 0xf) == 2 && (typeAndFlags & 0x20)) {
+        if (bufsize < 1) {
+            QCC_DbgPrintf(("WhoHas::Deserialize(): Insufficient bufsize %d", bufsize));
+            return 0;
+        }
+
+        uint8_t numberKnown = *p++;
+        QCC_DbgPrintf(("WhoHas::Deserialize(): KCount %d", numberKnown));
+        size += 1;
+        bufsize -= 1;
+
+        for (uint32_t i = 0; i < numberKnown; ++i) {
+            QCC_DbgPrintf(("WhoHas::Deserialize(): StringData::Deserialize() known answer %d", i));
+            StringData stringData;
+
+            size_t stringSize = stringData.Deserialize(p, bufsize);
+            if (stringSize == 0 || bufsize < stringSize + 2) {
+                QCC_DbgPrintf(("WhoHas::Deserialize(): Known answer:  Error"));
+                return 0;
+            }
+            p += stringSize;
+            size += stringSize;
+            bufsize -= stringSize;
+
+            uint16_t generation = (static_cast<uint16_t>(p[0]) << 8) | (static_cast<uint16_t>(p[1]) & 0xff);
+            p += 2;
+            size += 2;
+            bufsize -= 2;
+
+            AddKnownAnswer(stringData.Get(), generation);
+        }
+    }
+
     return size;
 }
 
@@ -1501,12 +1649,12 @@ size_t Header::Deserialize(uint8_t const* buffer, uint32_t bufsize)
     uint8_t nsVersion, msgVersion;
     nsVersion = buffer[0] >> 4;
     msgVersion = buffer[0] & 0xf;
-    if (nsVersion != 0 && nsVersion != 1) {
+    if (nsVersion > 2) {
         QCC_DbgPrintf(("Header::Deserialize(): Bad remote name service version %d", nsVersion));
         return 0;
     }
 
-    if (msgVersion != 0 && msgVersion != 1) {
+    if (msgVersion > 2) {
         QCC_DbgPrintf(("Header::Deserialize(): Bad message version %d", msgVersion));
         return 0;
     }
@@ -1589,4 +1737,315 @@ size_t Header::Deserialize(uint8_t const* buffer, uint32_t bufsize)
     return size;
 }
 
+bool StringRef::Equals(const qcc::String& other) const
+{
+    return other.size() == m_size && (m_size == 0 || memcmp(other.c_str(), m_data, m_size) == 0);
+}
+
+size_t StringRefList::Parse(uint8_t const* buffer, uint32_t bufsize, uint32_t count)
+{
+    m_begin = buffer;
+    m_count = 0;
+    m_index = 0;
+    m_cursor = NULL;
+
+    size_t size = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        if (bufsize < 1 || bufsize - 1 < buffer[size]) {
+            return 0;
+        }
+        uint32_t stringSize = 1 + buffer[size];
+        size += stringSize;
+        bufsize -= stringSize;
+    }
+
+    m_count = count;
+    return size;
+}
+
+StringRef StringRefList::Get(uint32_t index) const
+{
+    assert(index < m_count);
+
+    //
+    // Strings are usually asked for in order, so pick up where we left off
+    // unless we are asked to go backward.
+    //
+    if (m_cursor == NULL || index < m_index) {
+        m_index = 0;
+        m_cursor = m_begin;
+    }
+    while (m_index < index) {
+        m_cursor += 1 + m_cursor[0];
+        ++m_index;
+    }
+    return StringRef(m_cursor + 1, m_cursor[0]);
+}
+
+size_t IsAtView::Parse(uint8_t const* buffer, uint32_t bufsize, uint32_t nsVersion, uint32_t msgVersion)
+{
+    m_buffer = buffer;
+    m_size = 0;
+    m_version = nsVersion << 4 | msgVersion;
+    m_transportMask = 0;
+    m_generation = 0;
+    m_guid = StringRef();
+
+    //
+    // This follows IsAt::Deserialize() exactly; the two must accept the same
+    // messages.  See there for the layout.
+    //
+    uint32_t fixed = msgVersion == 2 ? 6 : 4;
+    if (msgVersion > 2 || bufsize < fixed) {
+        return 0;
+    }
+
+    m_typeAndFlags = buffer[0];
+    if ((m_typeAndFlags & 0xc0) != 1 << 6) {
+        return 0;
+    }
+
+    uint8_t numberNames = buffer[1];
+
+    size_t size = 4;
+    if (msgVersion == 0) {
+        //
+        // Port, then an optional IPv4 address (F) and IPv6 address (S).
+        //
+        if (m_typeAndFlags & 0x1) {
+            size += 4;
+        }
+        if (m_typeAndFlags & 0x2) {
+            size += 16;
+        }
+    } else {
+        m_transportMask = (static_cast<uint16_t>(buffer[2]) << 8) | buffer[3];
+        if (msgVersion == 2) {
+            m_generation = (static_cast<uint16_t>(buffer[4]) << 8) | buffer[5];
+            size += 2;
+        }
+
+        //
+        // Reliable and unreliable IPv4 and IPv6 endpoints (R4, U4, R6, U6).
+        //
+        if (m_typeAndFlags & 0x8) {
+            size += 6;
+        }
+        if (m_typeAndFlags & 0x4) {
+            size += 6;
+        }
+        if (m_typeAndFlags & 0x2) {
+            size += 18;
+        }
+        if (m_typeAndFlags & 0x1) {
+            size += 18;
+        }
+    }
+    if (bufsize < size) {
+        return 0;
+    }
+
+    if (m_typeAndFlags & 0x20) {
+        if (bufsize - size < 1 || bufsize - size - 1 < buffer[size]) {
+            return 0;
+        }
+        m_guid = StringRef(buffer + size + 1, buffer[size]);
+        size += 1 + buffer[size];
+    }
+
+    size_t namesSize = m_names.Parse(buffer + size, bufsize - size, numberNames);
+    if (namesSize == 0 && numberNames) {
+        return 0;
+    }
+    size += namesSize;
+
+    m_size = size;
+    return size;
+}
+
+void IsAtView::Copy(IsAt& isAt) const
+{
+    isAt.SetVersion(m_version >> 4, m_version & 0xf);
+
+    //
+    // The view has already checked the bytes, so this can't fail.
+    //
+    isAt.Deserialize(m_buffer, m_size);
+}
+
+size_t WhoHasView::Parse(uint8_t const* buffer, uint32_t bufsize, uint32_t nsVersion, uint32_t msgVersion)
+{
+    m_buffer = buffer;
+    m_size = 0;
+    m_version = nsVersion << 4 | msgVersion;
+    m_numberKnown = 0;
+    m_known = NULL;
+
+    //
+    // This follows WhoHas::Deserialize() exactly; the two must accept the
+    // same messages.
+    //
+    if (msgVersion > 2 || bufsize < 2) {
+        return 0;
+    }
+
+    m_typeAndFlags = buffer[0];
+    if ((m_typeAndFlags & 0xc0) != 2 << 6) {
+        return 0;
+    }
+
+    uint8_t numberNames = buffer[1];
+    size_t size = 2;
+
+    size_t namesSize = m_names.Parse(buffer + size, bufsize - size, numberNames);
+    if (namesSize == 0 && numberNames) {
+        return 0;
+    }
+    size += namesSize;
+
+    //
+    // A version two question may end in a list of known answers, each a GUID
+    // and a two octet generation.
+    //
+    if (msgVersion == 2 && (m_typeAndFlags & 0x20)) {
+        if (bufsize - size < 1) {
+            return 0;
+        }
+        m_numberKnown = buffer[size];
+        size += 1;
+        m_known = buffer + size;
+
+        for (uint32_t i = 0; i < m_numberKnown; ++i) {
+            if (bufsize - size < 1 || bufsize - size - 1 < static_cast<uint32_t>(buffer[size]) + 2) {
+                return 0;
+            }
+            size += 1 + buffer[size] + 2;
+        }
+    }
+
+    m_size = size;
+    return size;
+}
+
+bool WhoHasView::IsKnownAnswer(const qcc::String& guid, uint16_t generation) const
+{
+    uint8_t const* p = m_known;
+    for (uint32_t i = 0; i < m_numberKnown; ++i) {
+        StringRef known(p + 1, p[0]);
+        p += 1 + p[0];
+        uint16_t knownGeneration = (static_cast<uint16_t>(p[0]) << 8) | p[1];
+        p += 2;
+        if (knownGeneration == generation && known.Equals(guid)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void WhoHasView::Copy(WhoHas& whoHas) const
+{
+    whoHas.SetVersion(m_version >> 4, m_version & 0xf);
+
+    //
+    // The view has already checked the bytes, so this can't fail.
+    //
+    whoHas.Deserialize(m_buffer, m_size);
+}
+
+size_t HeaderView::Parse(uint8_t const* buffer, uint32_t bufsize)
+{
+    m_buffer = buffer;
+    m_end = buffer;
+    m_qIndex = m_aIndex = 0;
+    m_qCursor = m_aCursor = NULL;
+
+    //
+    // This follows Header::Deserialize() exactly; the two must accept the
+    // same messages.
+    //
+    if (bufsize < 4) {
+        return 0;
+    }
+
+    if ((buffer[0] >> 4) > 2 || (buffer[0] & 0xf) > 2) {
+        return 0;
+    }
+
+    m_version = buffer[0];
+    m_qCount = buffer[1];
+    m_aCount = buffer[2];
+    m_timer = buffer[3];
+
+    uint32_t nsVersion = m_version >> 4;
+    uint32_t msgVersion = m_version & 0xf;
+    size_t size = 4;
+
+    WhoHasView whoHas;
+    for (uint32_t i = 0; i < m_qCount; ++i) {
+        size_t qSize = whoHas.Parse(buffer + size, bufsize - size, nsVersion, msgVersion);
+        if (qSize == 0) {
+            return 0;
+        }
+        size += qSize;
+    }
+
+    m_answers = buffer + size;
+
+    IsAtView isAt;
+    for (uint32_t i = 0; i < m_aCount; ++i) {
+        size_t aSize = isAt.Parse(buffer + size, bufsize - size, nsVersion, msgVersion);
+        if (aSize == 0) {
+            return 0;
+        }
+        size += aSize;
+    }
+
+    m_end = buffer + size;
+    return size;
+}
+
+void HeaderView::GetQuestion(uint32_t index, WhoHasView& question) const
+{
+    assert(index < m_qCount);
+
+    uint32_t nsVersion = m_version >> 4;
+    uint32_t msgVersion = m_version & 0xf;
+
+    if (m_qCursor == NULL || index < m_qIndex) {
+        m_qIndex = 0;
+        m_qCursor = m_buffer + 4;
+    }
+    for (;;) {
+        size_t size = question.Parse(m_qCursor, m_end - m_qCursor, nsVersion, msgVersion);
+        assert(size);
+        if (m_qIndex == index) {
+            break;
+        }
+        m_qCursor += size;
+        ++m_qIndex;
+    }
+}
+
+void HeaderView::GetAnswer(uint32_t index, IsAtView& answer) const
+{
+    assert(index < m_aCount);
+
+    uint32_t nsVersion = m_version >> 4;
+    uint32_t msgVersion = m_version & 0xf;
+
+    if (m_aCursor == NULL || index < m_aIndex) {
+        m_aIndex = 0;
+        m_aCursor = m_answers;
+    }
+    for (;;) {
+        size_t size = answer.Parse(m_aCursor, m_end - m_aCursor, nsVersion, msgVersion);
+        assert(size);
+        if (m_aIndex == index) {
+            break;
+        }
+        m_aCursor += size;
+        ++m_aIndex;
+    }
+}
+
 } // namespace ajn
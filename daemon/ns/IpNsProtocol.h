@@ -229,6 +229,44 @@ namespace ajn {
  * @li @c TransportMask The bit mask of transport identifiers that indicates which
  *     AllJoyn transport is making the advertisement.
  *
+ * <b>Version 2</b>
+ *
+ * Version two of the protocol adds a generation number to the version one
+ * message so that daemons can stop repeating their whole list of names.  The
+ * generation identifies one state of the set of names advertised by the
+ * daemon and is incremented every time a name is added to or removed from
+ * that set.  Everything else is laid out as in version one:
+ *
+ * @verbatim
+ *      0                   1                   2                   3
+ *      0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+ *     +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ *     |R U R U C G| M |     Count     |         TransportMask         |
+ *     |4 4 6 6    |   |               |                               |
+ *     +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ *     |          Generation           |                               |
+ *     +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+                               |
+ *     |                                                               |
+ *     ~   Endpoints, GUID and StringData records as in version one    ~
+ *     |                                                               |
+ *     +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ * @endverbatim
+ *
+ * @li @c Generation The generation of the advertised set of names that this
+ *     message describes.
+ * @li @c C If '1' the StringData records are the complete set of names at
+ *     this generation and replace anything the receiver remembers.  If '0'
+ *     and the generation is one more than the one the receiver remembers, the
+ *     records are a delta: names added if the header timer is non-zero, or
+ *     withdrawn if it is zero.  If '0' and the generation is the one the
+ *     receiver remembers, the records continue a complete set that did not
+ *     fit in one message.
+ * @li @c Count If zero with the 'C' bit clear, the message is a refresh.  It
+ *     says that the set of names at the given generation is still advertised
+ *     for the time given by the header timer without repeating the names.  A
+ *     receiver that does not remember that generation asks again with a
+ *     WHO-HAS.
+ *
  * <b>WHO-HAS Message</b>
  *
  * The WHO-HAS message is a "question" message used to ask AllJoyn daemons if
@@ -289,6 +327,38 @@ namespace ajn {
  * @li @c Count The number of StringData items that follow.  Each StringData item
  *     describes one well-known bus name that the querying daemon is interested in.
  *
+ * <b>Version 2</b>
+ *
+ * Version two of the protocol lets the questioner list the answers it already
+ * has, so daemons whose answer is already known can stay quiet.  This is the
+ * known-answer list of multicast DNS.
+ *
+ * @verbatim
+ *      0                   1                   2                   3
+ *      0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+ *     +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ *     |R R R R R K| M |     Count     |                               |
+ *     +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+                               |
+ *     |                                                               |
+ *     ~              Variable Number of StringData Records            ~
+ *     |                                                               |
+ *     +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ *     |    KCount     |                                               |
+ *     +-+-+-+-+-+-+-+-+                                               |
+ *     |                                                               |
+ *     ~   KCount Daemon GUID StringData and Generation pairs present  ~
+ *     |                    if 'K' bit is set                          |
+ *     +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ * @endverbatim
+ *
+ * @li @c K If '1' indicates that a known-answer list follows the names.
+ * @li @c KCount The number of known answers that follow.  Each known answer
+ *     is the GUID of a daemon (as a StringData) followed by the two octet
+ *     generation of its advertised names that the questioner holds.  A daemon
+ *     that finds its GUID and current generation in the list does not answer.
+ *     Questioners only list answers which have at least half of their
+ *     lifetime remaining.
+ *
  * <b>Messages<b>
  *
  * A name service message consists of a header, followed by a variable
@@ -652,6 +722,25 @@ class IsAt : public ProtocolElement {
      */
     TransportMask GetTransportMask(TransportMask mask) { return m_transportMask; }
 
+    /**
+     * @internal
+     * @brief Set the generation of the advertised names that this answer
+     * describes.  Only present in version two messages.
+     *
+     * @param generation The generation of the sender's set of advertised names.
+     */
+    void SetGeneration(uint16_t generation) { m_generation = generation; }
+
+    /**
+     * @internal
+     * @brief Get the generation of the advertised names that this answer
+     * describes.
+     *
+     * @return The generation of the sender's set of advertised names, or zero
+     * if the message is not version two.
+     */
+    uint16_t GetGeneration(void) const { return m_generation; }
+
     /**
      * @internal
      * @brief Set the protocol flag indicating that the daemon generating
@@ -1235,7 +1324,8 @@ class IsAt : public ProtocolElement {
   private:
     uint8_t m_version;
 
-    TransportMask m_transportMask; /**< Version one only */
+    TransportMask m_transportMask; /**< Version one and two only */
+    uint16_t m_generation;         /**< Version two only */
 
     bool m_flagG;
     bool m_flagC;
@@ -1477,6 +1567,51 @@ class WhoHas : public ProtocolElement {
      */
     qcc::String GetName(uint32_t index) const;
 
+    /**
+     * @internal
+     * @brief Add an answer that the questioning daemon already holds to the
+     * known-answer list.  Only serialized in version two messages.
+     *
+     * @param guid The GUID of the daemon whose answer is known.
+     * @param generation The generation of that daemon's advertised names.
+     */
+    void AddKnownAnswer(const qcc::String& guid, uint16_t generation);
+
+    /**
+     * @internal
+     * @brief Remove all entries from the known-answer list.
+     */
+    void ClearKnownAnswers(void);
+
+    /**
+     * @internal
+     * @brief Get the number of entries in the known-answer list.
+     *
+     * @return The number of known answers.
+     */
+    uint32_t GetNumberKnownAnswers(void) const;
+
+    /**
+     * @internal
+     * @brief Get an entry from the known-answer list.
+     *
+     * @param index The index of the known answer to retrieve.
+     * @param guid Set to the GUID of the daemon whose answer is known.
+     * @param generation Set to the generation of that daemon's names.
+     */
+    void GetKnownAnswer(uint32_t index, qcc::String& guid, uint16_t& generation) const;
+
+    /**
+     * @internal
+     * @brief Find out whether a given answer is in the known-answer list.
+     *
+     * @param guid The GUID of the answering daemon.
+     * @param generation The current generation of its advertised names.
+     *
+     * @return True if the questioner already holds this answer.
+     */
+    bool IsKnownAnswer(const qcc::String& guid, uint16_t generation) const;
+
     /**
      * @internal
      * @brief Get the size of a buffer that will allow the question object and
@@ -1520,6 +1655,8 @@ class WhoHas : public ProtocolElement {
     bool m_flagS;
     bool m_flagF;
     std::vector<qcc::String> m_names;
+    std::vector<qcc::String> m_knownGuids;       /**< Version two only */
+    std::vector<uint16_t> m_knownGenerations;    /**< Version two only */
 };
 
 /**
@@ -1857,6 +1994,262 @@ class Header : public ProtocolElement {
     std::vector<IsAt> m_answers;
 };
 
+/**
+ * @internal
+ * @brief A string held in a received name service message.
+ *
+ * The string is referenced where it lies in the receive buffer rather than
+ * copied out, so it is only valid as long as that buffer is.  It is not NUL
+ * terminated.
+ */
+class StringRef {
+  public:
+    StringRef() : m_data(NULL), m_size(0) { }
+    StringRef(uint8_t const* data, size_t size) : m_data(reinterpret_cast<const char*>(data)), m_size(size) { }
+
+    /**
+     * @internal
+     * @brief Get the characters of the string.
+     */
+    const char* GetData(void) const { return m_data; }
+
+    /**
+     * @internal
+     * @brief Get the number of characters in the string.
+     */
+    size_t GetSize(void) const { return m_size; }
+
+    /**
+     * @internal
+     * @brief Compare the string with a qcc::String without copying either.
+     *
+     * @return true if the strings are identical.
+     */
+    bool Equals(const qcc::String& other) const;
+
+    /**
+     * @internal
+     * @brief Copy the string out of the message.
+     */
+    qcc::String ToString(void) const { return qcc::String(m_data, m_size); }
+
+  private:
+    const char* m_data;
+    size_t m_size;
+};
+
+/**
+ * @internal
+ * @brief A list of StringData laid end to end in a received name service
+ * message, such as the names in an IsAt or WhoHas.
+ *
+ * The list must have been validated when the message was parsed.  Walking
+ * the list in order is cheap since the position of the last string returned
+ * is remembered.
+ */
+class StringRefList {
+  public:
+    StringRefList() : m_begin(NULL), m_count(0), m_index(0), m_cursor(NULL) { }
+
+    /**
+     * @internal
+     * @brief Check that count StringData fit in the buffer and refer to them.
+     *
+     * @return The number of octets the strings occupy, or zero if they don't
+     *     fit.  An empty list occupies zero octets, so check count as well.
+     */
+    size_t Parse(uint8_t const* buffer, uint32_t bufsize, uint32_t count);
+
+    /**
+     * @internal
+     * @brief Get the number of strings in the list.
+     */
+    uint32_t GetNumber(void) const { return m_count; }
+
+    /**
+     * @internal
+     * @brief Get the string at the given index.
+     */
+    StringRef Get(uint32_t index) const;
+
+  private:
+    uint8_t const* m_begin;
+    uint32_t m_count;
+    mutable uint32_t m_index;
+    mutable uint8_t const* m_cursor;
+};
+
+/**
+ * @internal
+ * @brief A read-only view of an IsAt in a received name service message.
+ *
+ * Parsing checks the answer just as IsAt::Deserialize() does, but leaves the
+ * GUID, names and addresses in the receive buffer, so nothing is allocated.
+ * Code that needs to keep the answer can Copy() it into an IsAt.
+ */
+class IsAtView {
+  public:
+    IsAtView() : m_buffer(NULL), m_size(0), m_version(0), m_typeAndFlags(0), m_transportMask(0), m_generation(0) { }
+
+    /**
+     * @internal
+     * @brief Check an answer in the buffer and refer to it.
+     *
+     * @param buffer The buffer to read the answer from.
+     * @param bufsize The number of bytes available in the buffer.
+     * @param nsVersion The version of the sender's name service from the header.
+     * @param msgVersion The version of the message from the header.
+     *
+     * @return The number of octets in the answer, or zero if it is malformed.
+     */
+    size_t Parse(uint8_t const* buffer, uint32_t bufsize, uint32_t nsVersion, uint32_t msgVersion);
+
+    void GetVersion(uint32_t& nsVersion, uint32_t& msgVersion) const { nsVersion = m_version >> 4; msgVersion = m_version & 0xf; }
+    bool GetCompleteFlag(void) const { return (m_typeAndFlags & 0x10) != 0; }
+    bool GetGuidFlag(void) const { return (m_typeAndFlags & 0x20) != 0; }
+
+    /**
+     * @internal
+     * @brief Version zero only: the flags that say a TCP or UDP service is
+     * present.  A version one or two sender sets both in its down-version
+     * copies.
+     */
+    bool GetTcpFlag(void) const { return (m_version & 0xf) == 0 && (m_typeAndFlags & 0x8) != 0; }
+    bool GetUdpFlag(void) const { return (m_version & 0xf) == 0 && (m_typeAndFlags & 0x4) != 0; }
+
+    uint16_t GetTransportMask(void) const { return m_transportMask; }
+    uint16_t GetGeneration(void) const { return m_generation; }
+    StringRef GetGuid(void) const { return m_guid; }
+    uint32_t GetNumberNames(void) const { return m_names.GetNumber(); }
+    StringRef GetName(uint32_t index) const { return m_names.Get(index); }
+
+    /**
+     * @internal
+     * @brief Deserialize the answer into an IsAt object.
+     */
+    void Copy(IsAt& isAt) const;
+
+  private:
+    uint8_t const* m_buffer;
+    size_t m_size;
+    uint8_t m_version;
+    uint8_t m_typeAndFlags;
+    uint16_t m_transportMask;
+    uint16_t m_generation;
+    StringRef m_guid;
+    StringRefList m_names;
+};
+
+/**
+ * @internal
+ * @brief A read-only view of a WhoHas in a received name service message.
+ *
+ * Parsing checks the question just as WhoHas::Deserialize() does, but leaves
+ * the names and the known answers in the receive buffer.
+ */
+class WhoHasView {
+  public:
+    WhoHasView() : m_buffer(NULL), m_size(0), m_version(0), m_typeAndFlags(0), m_numberKnown(0), m_known(NULL) { }
+
+    /**
+     * @internal
+     * @brief Check a question in the buffer and refer to it.
+     *
+     * @return The number of octets in the question, or zero if it is
+     *     malformed.
+     */
+    size_t Parse(uint8_t const* buffer, uint32_t bufsize, uint32_t nsVersion, uint32_t msgVersion);
+
+    void GetVersion(uint32_t& nsVersion, uint32_t& msgVersion) const { nsVersion = m_version >> 4; msgVersion = m_version & 0xf; }
+    uint32_t GetNumberNames(void) const { return m_names.GetNumber(); }
+    StringRef GetName(uint32_t index) const { return m_names.Get(index); }
+    uint32_t GetNumberKnownAnswers(void) const { return m_numberKnown; }
+
+    /**
+     * @internal
+     * @brief Check whether the known-answer list holds the given daemon GUID
+     * at the given generation.
+     */
+    bool IsKnownAnswer(const qcc::String& guid, uint16_t generation) const;
+
+    /**
+     * @internal
+     * @brief Deserialize the question into a WhoHas object.
+     */
+    void Copy(WhoHas& whoHas) const;
+
+  private:
+    uint8_t const* m_buffer;
+    size_t m_size;
+    uint8_t m_version;
+    uint8_t m_typeAndFlags;
+    uint8_t m_numberKnown;
+    uint8_t const* m_known;
+    StringRefList m_names;
+};
+
+/**
+ * @internal
+ * @brief A read-only view of a received name service message.
+ *
+ * Parse() checks the whole message the way Header::Deserialize() does so
+ * that the questions and answers can then be looked at in place.  Most of
+ * the messages a daemon hears need nothing more than that, so this is how
+ * received messages are handled; objects are only built from the messages
+ * that carry something to keep.
+ */
+class HeaderView {
+  public:
+    HeaderView() : m_buffer(NULL), m_end(NULL), m_version(0), m_qCount(0), m_aCount(0), m_timer(0), m_answers(NULL),
+        m_qIndex(0), m_qCursor(NULL), m_aIndex(0), m_aCursor(NULL) { }
+
+    /**
+     * @internal
+     * @brief Check a received message and refer to it.
+     *
+     * @param buffer The buffer holding the message.  It must stay valid and
+     *     unchanged for as long as the view and anything obtained from it is
+     *     used.
+     * @param bufsize The number of bytes in the buffer.
+     *
+     * @return The number of octets in the message, or zero if it is
+     *     malformed.
+     */
+    size_t Parse(uint8_t const* buffer, uint32_t bufsize);
+
+    void GetVersion(uint32_t& nsVersion, uint32_t& msgVersion) const { nsVersion = m_version >> 4; msgVersion = m_version & 0xf; }
+    uint8_t GetTimer(void) const { return m_timer; }
+    uint32_t GetNumberQuestions(void) const { return m_qCount; }
+    uint32_t GetNumberAnswers(void) const { return m_aCount; }
+
+    /**
+     * @internal
+     * @brief Get a view of the question at the given index.  Walking the
+     * questions in order is cheap.
+     */
+    void GetQuestion(uint32_t index, WhoHasView& question) const;
+
+    /**
+     * @internal
+     * @brief Get a view of the answer at the given index.  Walking the
+     * answers in order is cheap.
+     */
+    void GetAnswer(uint32_t index, IsAtView& answer) const;
+
+  private:
+    uint8_t const* m_buffer;
+    uint8_t const* m_end;
+    uint8_t m_version;
+    uint8_t m_qCount;
+    uint8_t m_aCount;
+    uint8_t m_timer;
+    uint8_t const* m_answers;
+    mutable uint32_t m_qIndex;
+    mutable uint8_t const* m_qCursor;
+    mutable uint32_t m_aIndex;
+    mutable uint8_t const* m_aCursor;
+};
+
 } // namespace ajn
 
 #endif // _NS_PROTOCOL_H
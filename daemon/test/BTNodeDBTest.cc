@@ -0,0 +1,315 @@
+/**
+ * @file
+ * Consistency checks and lookup benchmarks for BTNodeDB.  No Bluetooth hardware is needed.
+ */
+
+/******************************************************************************
+ * Copyright 2012, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#include <qcc/platform.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include <qcc/String.h>
+#include <qcc/StringUtil.h>
+#include <qcc/Util.h>
+#include <qcc/time.h>
+
+#include "BDAddress.h"
+#include "BTBusAddress.h"
+#include "BTNodeDB.h"
+#include "BTNodeInfo.h"
+#include "TestCheck.h"
+
+#define QCC_MODULE "ALLJOYN_BTC"
+
+using namespace qcc;
+using namespace std;
+using namespace ajn;
+
+static BTBusAddress MakeAddr(size_t i, uint16_t psm = 0x1001)
+{
+    return BTBusAddress(BDAddress(static_cast<uint64_t>(0x001122000000ULL + i)), psm);
+}
+
+static String MakeName(size_t i)
+{
+    return ":node" + U32ToString(static_cast<uint32_t>(i)) + ".1";
+}
+
+static BTNodeInfo MakeNode(size_t i, uint64_t expireTime = numeric_limits<uint64_t>::max())
+{
+    BTNodeInfo node(MakeAddr(i), MakeName(i));
+    node->SetExpireTime(expireTime);
+    node->AddAdvertiseName("org.alljoyn.test.n" + U32ToString(static_cast<uint32_t>(i)));
+    return node;
+}
+
+/* Linear reference lookup by unique name with the same tie breaking as the DB (lowest bus address) */
+static BTNodeInfo ScanByName(const BTNodeDB& db, const String& name)
+{
+    for (BTNodeDB::const_iterator it = db.Begin(); it != db.End(); ++it) {
+        if ((*it)->GetUniqueName() == name) {
+            return *it;
+        }
+    }
+    return BTNodeInfo();
+}
+
+static void TestLookups()
+{
+    BTNodeDB db;
+    const size_t count = 64;
+    for (size_t i = 0; i < count; ++i) {
+        db.AddNode(MakeNode(i));
+    }
+    /* A second instance on the same device with a lower PSM */
+    BTNodeInfo lowPsm(MakeAddr(7, 0x1000), String(":lowpsm.1"));
+    db.AddNode(lowPsm);
+    CHECK(db.Size() == count + 1);
+
+    for (size_t i = 0; i < count; ++i) {
+        BTNodeInfo node = db.FindNode(MakeAddr(i));
+        CHECK(node->IsValid() && (node->GetBusAddress() == MakeAddr(i)));
+        CHECK(db.FindNode(MakeName(i))->GetBusAddress() == MakeAddr(i));
+    }
+    CHECK(db.FindNode(MakeAddr(7).addr)->GetBusAddress() == lowPsm->GetBusAddress());
+    CHECK(db.FindNode(MakeAddr(8).addr)->GetBusAddress() == MakeAddr(8));
+    CHECK(!db.FindNode(MakeAddr(count))->IsValid());
+    CHECK(!db.FindNode(MakeAddr(count).addr)->IsValid());
+    CHECK(!db.FindNode(String(":unknown.1"))->IsValid());
+    CHECK(!db.FindNode(String(""))->IsValid());
+
+    /* Renames through the DB are visible to name lookups */
+    BTNodeInfo node = db.FindNode(MakeAddr(3));
+    db.SetNodeUniqueName(node, ":renamed.1");
+    CHECK(!db.FindNode(MakeName(3))->IsValid());
+    CHECK(db.FindNode(String(":renamed.1"))->GetBusAddress() == MakeAddr(3));
+
+    /* A rename that bypasses the DB must not return a node under its old name */
+    node = db.FindNode(MakeAddr(4));
+    node->SetUniqueName(":bypass.1");
+    CHECK(!db.FindNode(MakeName(4))->IsValid());
+    db.RemoveNode(node);
+    db.AddNode(node);
+    CHECK(db.FindNode(String(":bypass.1"))->GetBusAddress() == MakeAddr(4));
+
+    /* Duplicate unique names resolve to the lowest bus address */
+    db.SetNodeUniqueName(db.FindNode(MakeAddr(20)), ":dup.1");
+    db.SetNodeUniqueName(db.FindNode(MakeAddr(10)), ":dup.1");
+    CHECK(db.FindNode(String(":dup.1"))->GetBusAddress() == MakeAddr(10));
+    db.RemoveNode(db.FindNode(MakeAddr(10)));
+    CHECK(db.FindNode(String(":dup.1"))->GetBusAddress() == MakeAddr(20));
+
+    /* Every remaining node must still agree with a linear scan */
+    for (BTNodeDB::const_iterator it = db.Begin(); it != db.End(); ++it) {
+        CHECK(db.FindNode((*it)->GetUniqueName()) == ScanByName(db, (*it)->GetUniqueName()));
+    }
+
+    db.Clear();
+    CHECK((db.Size() == 0) && !db.FindNode(MakeAddr(1))->IsValid() && !db.FindNode(MakeName(1))->IsValid());
+    CHECK(db.NextNodeExpiration() == numeric_limits<uint64_t>::max());
+}
+
+static void TestExpiration()
+{
+    BTNodeDB db(true);
+    Timespec now;
+    GetTimeNow(&now);
+    uint64_t base = now.GetAbsoluteMillis();
+
+    /* Odd nodes have already expired, even nodes expire in the future */
+    const size_t count = 32;
+    for (size_t i = 0; i < count; ++i) {
+        db.AddNode(MakeNode(i, (i & 1) ? (base - 1000 + i) : (base + 100000 + i)));
+    }
+    CHECK(db.NextNodeExpiration() == base - 1000 + 1);
+
+    /* Extending an expiration time behind the DB's back must not expire the node */
+    BTNodeInfo extended = db.FindNode(MakeAddr(1));
+    extended->SetExpireTime(base + 200000);
+
+    BTNodeDB expiredDB(true);
+    db.PopExpiredNodes(expiredDB);
+    CHECK(expiredDB.Size() == (count / 2) - 1);
+    CHECK(db.Size() == (count / 2) + 1);
+    CHECK(db.FindNode(MakeAddr(1))->IsValid());
+    CHECK(!db.FindNode(MakeAddr(3))->IsValid() && expiredDB.FindNode(MakeAddr(3))->IsValid());
+    CHECK(!db.FindNode(MakeName(3))->IsValid());
+    CHECK(db.NextNodeExpiration() == base + 100000);
+
+    db.RefreshExpiration(5000);
+    uint64_t next = db.NextNodeExpiration();
+    CHECK((next >= base + 5000) && (next < base + 100000));
+    db.RemoveExpiration();
+    CHECK(db.NextNodeExpiration() == numeric_limits<uint64_t>::max());
+
+    /* Connect node refreshes only touch the nodes behind that connect node */
+    BTNodeInfo connNode = db.FindNode(MakeAddr(0));
+    BTNodeInfo proxied = db.FindNode(MakeAddr(2));
+    db.RemoveNode(proxied);
+    proxied->SetConnectNode(connNode);
+    db.AddNode(proxied);
+    db.RefreshExpiration(connNode, 1000);
+    next = db.NextNodeExpiration();
+    CHECK((next >= base + 1000) && (next < base + 100000));
+    CHECK(db.FindNode(MakeAddr(4))->GetExpireTime() == numeric_limits<uint64_t>::max());
+}
+
+static void TestDiffUpdate()
+{
+    BTNodeDB oldDB(true);
+    BTNodeDB newDB(true);
+    const size_t count = 40;
+    for (size_t i = 0; i < count; ++i) {
+        oldDB.AddNode(MakeNode(i));
+        if ((i % 4) != 0) {
+            BTNodeInfo node = MakeNode(i);
+            if ((i % 4) == 1) {
+                node->AddAdvertiseName("org.alljoyn.test.extra");
+            }
+            newDB.AddNode(node);
+        }
+    }
+    for (size_t i = count; i < count + 5; ++i) {
+        newDB.AddNode(MakeNode(i));
+    }
+
+    BTNodeDB added, removed;
+    oldDB.Diff(newDB, &added, &removed);
+    CHECK(removed.Size() == count / 4);
+    CHECK(added.Size() == (count / 4) + 5);
+    CHECK(added.FindNode(MakeAddr(1))->FindAdvertiseName("org.alljoyn.test.extra") != added.FindNode(MakeAddr(1))->GetAdvertiseNamesEnd());
+
+    BTNodeDB nodeAdded, nodeRemoved;
+    oldDB.NodeDiff(newDB, &nodeAdded, &nodeRemoved);
+    CHECK(nodeAdded.Size() == 5);
+    CHECK(nodeRemoved.Size() == count / 4);
+
+    /* Applying the diff must make the DBs equivalent */
+    oldDB.UpdateDB(&added, &removed);
+    BTNodeDB added2, removed2;
+    oldDB.Diff(newDB, &added2, &removed2);
+    CHECK(added2.Size() == 0);
+    CHECK(removed2.Size() == 0);
+    CHECK(oldDB.Size() == newDB.Size());
+    for (size_t i = 0; i < count + 5; ++i) {
+        CHECK(oldDB.FindNode(MakeName(i))->IsValid() == ((i % 4) != 0 || (i >= count)));
+    }
+}
+
+static double TimeLookups(const BTNodeDB& db, const vector<BTBusAddress>& addrs, const vector<String>& names, uint32_t iterations)
+{
+    uint64_t start = GetTimestamp64();
+    size_t found = 0;
+    for (uint32_t n = 0; n < iterations; ++n) {
+        for (size_t i = 0; i < addrs.size(); ++i) {
+            found += db.FindNode(addrs[i])->IsValid() ? 1 : 0;
+            found += db.FindNode(names[i])->IsValid() ? 1 : 0;
+        }
+    }
+    uint64_t elapsed = GetTimestamp64() - start;
+    if (found != (2 * addrs.size() * iterations)) {
+        printf("lookup benchmark found %u of %u nodes\n", (unsigned int) found, (unsigned int) (2 * addrs.size() * iterations));
+        ++g_failures;
+    }
+    return (elapsed * 1000000.0) / (2.0 * addrs.size() * iterations);
+}
+
+static void Benchmark(uint32_t iterations)
+{
+    static const size_t sizes[] = { 16, 128, 1024, 8192 };
+    printf("%8s %14s %14s %14s\n", "nodes", "lookup ns", "diff us", "update us");
+    for (size_t s = 0; s < ArraySize(sizes); ++s) {
+        size_t count = sizes[s];
+        BTNodeDB db(true);
+        vector<BTBusAddress> addrs;
+        vector<String> names;
+        for (size_t i = 0; i < count; ++i) {
+            db.AddNode(MakeNode(i));
+            addrs.push_back(MakeAddr(i));
+            names.push_back(MakeName(i));
+        }
+        double lookupNs = TimeLookups(db, addrs, names, (iterations * 16) / count + 1);
+
+        /* A small change set against a large table */
+        BTNodeDB changed(true);
+        for (size_t i = 0; i < 8; ++i) {
+            BTNodeInfo node = MakeNode(i * (count / 8));
+            node->AddAdvertiseName("org.alljoyn.test.extra");
+            changed.AddNode(node);
+        }
+        uint32_t diffIterations = iterations;
+        uint64_t start = GetTimestamp64();
+        for (uint32_t n = 0; n < diffIterations; ++n) {
+            BTNodeDB removed;
+            changed.Diff(db, NULL, &removed);
+        }
+        double diffUs = ((GetTimestamp64() - start) * 1000.0) / diffIterations;
+
+        start = GetTimestamp64();
+        for (uint32_t n = 0; n < iterations; ++n) {
+            db.UpdateDB(&changed, NULL);
+        }
+        double updateUs = ((GetTimestamp64() - start) * 1000.0) / iterations;
+
+        printf("%8u %14.1f %14.1f %14.2f\n", (unsigned int) count, lookupNs, diffUs, updateUs);
+    }
+}
+
+static void usage(void)
+{
+    printf("Usage: btnodedbtest [-h] [-b] [-i <iterations>]\n\n");
+    printf("Options:\n");
+    printf("   -h                   - Print this help message\n");
+    printf("   -b                   - Run the benchmarks after the consistency checks\n");
+    printf("   -i <iterations>      - Benchmark iterations (default 1000)\n");
+    printf("\n");
+}
+
+int main(int argc, char** argv)
+{
+    bool bench = false;
+    uint32_t iterations = 1000;
+
+    /* Parse command line args */
+    for (int i = 1; i < argc; ++i) {
+        if (::strcmp("-h", argv[i]) == 0) {
+            usage();
+            exit(0);
+        } else if (::strcmp("-b", argv[i]) == 0) {
+            bench = true;
+        } else if ((::strcmp("-i", argv[i]) == 0) && ((i + 1) < argc)) {
+            iterations = StringToU32(argv[++i], 10, 1000);
+        } else {
+            printf("Unknown option %s\n", argv[i]);
+            usage();
+            exit(1);
+        }
+    }
+
+    TestLookups();
+    TestExpiration();
+    TestDiffUpdate();
+    if (bench && (g_failures == 0)) {
+        Benchmark(iterations);
+    }
+
+    return CheckResult();
+}
@@ -0,0 +1,135 @@
+/**
+ * @file
+ * Helpers shared by the daemon benchmark programs.
+ */
+
+/******************************************************************************
+ * Copyright 2012, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#ifndef _ALLJOYN_BENCHUTIL_H
+#define _ALLJOYN_BENCHUTIL_H
+
+#include <qcc/platform.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+#include <qcc/Util.h>
+#include <qcc/time.h>
+
+/** Time spent on each timed run in milliseconds */
+static uint32_t g_runMs = 250;
+
+/* Results are folded into g_sink so the compiler cannot discard the work */
+static volatile uint32_t g_sink = 0;
+
+/**
+ * Look up a percentile of a set of samples.
+ *
+ * @param sorted    The samples in ascending order.
+ * @param perMille  The percentile in thousandths, e.g. 990 for the 99th percentile.
+ *
+ * @return  The sample at the percentile, 0 if there are no samples.
+ */
+static inline uint32_t Percentile(const std::vector<uint32_t>& sorted, uint32_t perMille)
+{
+    if (sorted.empty()) {
+        return 0;
+    }
+    return sorted[std::min(static_cast<size_t>((sorted.size() * static_cast<uint64_t>(perMille)) / 1000), sorted.size() - 1)];
+}
+
+/**
+ * Run an operation over and over for g_runMs milliseconds.
+ *
+ * @param op         Called with no arguments, returns a value that is folded into g_sink.
+ * @param elapsedMs  Returns the time the operations took in milliseconds.
+ *
+ * @return  The number of times the operation was run.
+ */
+template <typename Op>
+static uint64_t RunTimed(Op op, uint64_t& elapsedMs)
+{
+    uint32_t sink = 0;
+    uint64_t ops = 0;
+    uint64_t start = qcc::GetTimestamp64();
+    do {
+        /* Check the clock every 256 operations to keep its cost out of the result */
+        for (int i = 0; i < 256; ++i) {
+            sink ^= op();
+        }
+        ops += 256;
+        elapsedMs = qcc::GetTimestamp64() - start;
+    } while (elapsedMs < g_runMs);
+    g_sink = g_sink ^ sink;
+    return ops;
+}
+
+/**
+ * Print a binary fuzz sample as hex octets.
+ */
+static inline void PrintSample(const std::vector<uint8_t>& sample)
+{
+    for (size_t i = 0; i < sample.size(); ++i) {
+        printf(" %02x", sample[i]);
+    }
+    printf("\n");
+}
+
+/**
+ * Print a text fuzz sample as is.
+ */
+static inline void PrintSample(const std::vector<char>& sample)
+{
+    printf(" %.*s\n", (int) sample.size(), sample.empty() ? "" : &sample[0]);
+}
+
+/**
+ * Check a parser against mutated copies of a corpus.  Each iteration takes a random sample from
+ * the corpus and mutates it one to four times.
+ *
+ * @param corpus      The samples to mutate.
+ * @param iterations  Number of mutated samples to check.
+ * @param what        What a sample is called in the output, e.g. "packet".
+ * @param mutate      Makes one random change to a sample.
+ * @param check       Returns false if the parsers disagree on the sample.  Sets accepted if the
+ *                    sample is still valid.  May fix up the sample before checking it.
+ *
+ * @return  true if every mutated sample passed the check.
+ */
+template <typename Sample>
+static bool Fuzz(const std::vector<Sample>& corpus, uint32_t iterations, const char* what,
+                 void (*mutate)(Sample& sample), bool (*check)(Sample& sample, bool& accepted))
+{
+    uint32_t valid = 0;
+    for (uint32_t i = 0; i < iterations; ++i) {
+        Sample sample = corpus[qcc::Rand32() % corpus.size()];
+        for (uint32_t n = 1 + qcc::Rand32() % 4; n; --n) {
+            mutate(sample);
+        }
+        bool accepted = false;
+        if (!check(sample, accepted)) {
+            printf("Fuzz iteration %u failed on a %u octet %s:", i, (unsigned int) sample.size(), what);
+            PrintSample(sample);
+            return false;
+        }
+        valid += accepted ? 1 : 0;
+    }
+    printf("Fuzzed %u %ss, %u still valid\n\n", iterations, what, valid);
+    return true;
+}
+
+#endif
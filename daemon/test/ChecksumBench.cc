@@ -0,0 +1,247 @@
+/**
+ * @file
+ * Microbenchmarks for the packet and STUN integrity checks
+ */
+
+/******************************************************************************
+ * Copyright 2012, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#include <qcc/platform.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <qcc/StringUtil.h>
+#include <qcc/Util.h>
+#include <alljoyn/version.h>
+
+#include "BenchUtil.h"
+#include "Crc32.h"
+#include "Packet.h"
+
+#define QCC_MODULE "PACKET"
+
+using namespace qcc;
+using namespace std;
+using namespace ajn;
+
+/* Byte at a time CRC-32 as previously used by the STUN FINGERPRINT attribute (baseline) */
+static uint32_t g_crc32Table[256];
+
+static void InitBytewiseTable()
+{
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t crc = i;
+        for (int j = 0; j < 8; ++j) {
+            crc = (crc & 1) ? ((crc >> 1) ^ 0xEDB88320U) : (crc >> 1);
+        }
+        g_crc32Table[i] = crc;
+    }
+}
+
+static uint32_t Crc32Bytewise(const uint8_t* buf, size_t len)
+{
+    uint32_t crc = 0xFFFFFFFF;
+    while (len--) {
+        crc = (crc >> 8) ^ g_crc32Table[(crc ^ *buf++) & 0xFF];
+    }
+    return ~crc;
+}
+
+/* Algorithms under test */
+static uint32_t RunCrc16(const uint8_t* buf, size_t len)
+{
+    uint16_t crc = 0;
+    CRC16_Compute(buf, len, &crc);
+    return crc;
+}
+
+static uint32_t RunCrc32Bytewise(const uint8_t* buf, size_t len)
+{
+    return Crc32Bytewise(buf, len);
+}
+
+static uint32_t RunCrc32Slice8(const uint8_t* buf, size_t len)
+{
+    return CRC32_Compute(buf, len);
+}
+
+static uint32_t RunCrc32cSlice8(const uint8_t* buf, size_t len)
+{
+    return CRC32C_ComputeSoftware(buf, len);
+}
+
+static uint32_t RunCrc32cHw(const uint8_t* buf, size_t len)
+{
+    return CRC32C_Compute(buf, len);
+}
+
+/* Marshal and verify a whole packet in each wire format */
+static Packet* g_packet = NULL;
+static uint8_t g_packetFormat = PACKET_FORMAT_CRC16;
+
+static uint32_t RunPacket(const uint8_t* buf, size_t len)
+{
+    g_packet->format = g_packetFormat;
+    g_packet->SetPayload(buf, len);
+    g_packet->Marshal();
+    PacketDest sender;
+    ::memset(&sender, 0, sizeof(sender));
+    return (g_packet->Unmarshal(sender, g_packet->GetWireSize()) == ER_OK) ? g_packet->seqNum : 0xFFFFFFFF;
+}
+
+struct Algorithm {
+    const char* name;
+    uint32_t (*run)(const uint8_t* buf, size_t len);
+    uint8_t packetFormat;
+};
+
+static const Algorithm g_algorithms[] = {
+    { "crc16",          RunCrc16,         0                    },
+    { "crc32-bytewise", RunCrc32Bytewise, 0                    },
+    { "crc32-slice8",   RunCrc32Slice8,   0                    },
+    { "crc32c-slice8",  RunCrc32cSlice8,  0                    },
+    { "crc32c-sse42",   RunCrc32cHw,      0                    },
+    { "packet-crc16",   RunPacket,        PACKET_FORMAT_CRC16  },
+    { "packet-crc32c",  RunPacket,        PACKET_FORMAT_CRC32C }
+};
+
+static const size_t NUM_ALGORITHMS = sizeof(g_algorithms) / sizeof(g_algorithms[0]);
+
+/* One timed operation: checksum len octets of buf */
+struct Checksum {
+    Checksum(const Algorithm& alg, const uint8_t* buf, size_t len) : alg(alg), buf(buf), len(len) { }
+    uint32_t operator()() const { return alg.run(buf, len); }
+    const Algorithm& alg;
+    const uint8_t* buf;
+    size_t len;
+};
+
+static const size_t g_sizes[] = { 64, 256, 1452, 16384 };
+
+static const size_t NUM_SIZES = sizeof(g_sizes) / sizeof(g_sizes[0]);
+
+/* Check the implementations against the standard check values and against each other */
+static bool SelfTest()
+{
+    const char* check = "123456789";
+    bool ok = true;
+    if (CRC32_Compute(check, 9) != 0xCBF43926) {
+        printf("CRC32_Compute check value mismatch\n");
+        ok = false;
+    }
+    if ((CRC32C_Compute(check, 9) != 0xE3069283) || (CRC32C_ComputeSoftware(check, 9) != 0xE3069283)) {
+        printf("CRC32C_Compute check value mismatch\n");
+        ok = false;
+    }
+
+    vector<uint8_t> buf(4096);
+    for (size_t i = 0; i < buf.size(); ++i) {
+        buf[i] = static_cast<uint8_t>(Rand32());
+    }
+    for (size_t off = 0; ok && (off < 8); ++off) {
+        for (size_t len = 0; ok && ((off + len) < buf.size()); len += 61) {
+            const uint8_t* p = &buf[off];
+            if (CRC32_Compute(p, len) != Crc32Bytewise(p, len)) {
+                printf("CRC32_Compute mismatch (offset=%u, len=%u)\n", (unsigned int) off, (unsigned int) len);
+                ok = false;
+            }
+            uint32_t crc = CRC32C_ComputeSoftware(p, len);
+            if ((CRC32C_Compute(p, len) != crc) || (CRC32C_Compute(p + len / 3, len - len / 3, CRC32C_Compute(p, len / 3)) != crc)) {
+                printf("CRC32C_Compute mismatch (offset=%u, len=%u)\n", (unsigned int) off, (unsigned int) len);
+                ok = false;
+            }
+        }
+    }
+    return ok;
+}
+
+static void usage(void)
+{
+    printf("Usage: checksumbench [-h] [-a <algorithm>] [-t <ms>]\n\n");
+    printf("Options:\n");
+    printf("   -h               - Print this help message\n");
+    printf("   -a <algorithm>   - Only run the named algorithm\n");
+    printf("   -t <ms>          - Time spent on each algorithm and size (default 250)\n");
+    printf("\n");
+    printf("Algorithms:\n");
+    for (size_t i = 0; i < NUM_ALGORITHMS; ++i) {
+        printf("   %s\n", g_algorithms[i].name);
+    }
+    printf("\n");
+}
+
+int main(int argc, char** argv)
+{
+    const char* algName = NULL;
+
+    printf("AllJoyn Library version: %s\n", ajn::GetVersion());
+    printf("AllJoyn Library build info: %s\n", ajn::GetBuildInfo());
+
+    /* Parse command line args */
+    for (int i = 1; i < argc; ++i) {
+        if (::strcmp("-h", argv[i]) == 0) {
+            usage();
+            exit(0);
+        } else if ((::strcmp("-a", argv[i]) == 0) && ((i + 1) < argc)) {
+            algName = argv[++i];
+        } else if ((::strcmp("-t", argv[i]) == 0) && ((i + 1) < argc)) {
+            g_runMs = StringToU32(argv[++i], 10, 250);
+        } else {
+            printf("Unknown option %s\n", argv[i]);
+            usage();
+            exit(1);
+        }
+    }
+
+    InitBytewiseTable();
+    if (!SelfTest()) {
+        return 1;
+    }
+    printf("CRC32C hardware acceleration: %s\n\n", CRC32C_IsHardwareAccelerated() ? "SSE4.2" : "none (slicing-by-8)");
+
+    /* Payloads are bounded by the largest size under test */
+    g_packet = new Packet(g_sizes[NUM_SIZES - 1] + Packet::maxOverhead);
+    vector<uint8_t> buf(g_sizes[NUM_SIZES - 1]);
+    for (size_t i = 0; i < buf.size(); ++i) {
+        buf[i] = static_cast<uint8_t>(Rand32());
+    }
+
+    printf("%-16s %8s %12s %10s\n", "algorithm", "size", "MB/s", "ns/op");
+    for (size_t a = 0; a < NUM_ALGORITHMS; ++a) {
+        const Algorithm& alg = g_algorithms[a];
+        if (algName && (::strcmp(algName, alg.name) != 0)) {
+            continue;
+        }
+        if ((alg.run == RunCrc32cHw) && !CRC32C_IsHardwareAccelerated()) {
+            printf("%-16s (not supported on this processor)\n", alg.name);
+            continue;
+        }
+        g_packetFormat = alg.packetFormat;
+        for (size_t s = 0; s < NUM_SIZES; ++s) {
+            size_t len = g_sizes[s];
+            uint64_t elapsed;
+            uint64_t ops = RunTimed(Checksum(alg, &buf[0], len), elapsed);
+            double mbps = (static_cast<double>(ops) * len) / (elapsed * 1000.0);
+            double nsPerOp = (elapsed * 1000000.0) / ops;
+            printf("%-16s %8u %12.1f %10.1f\n", alg.name, (unsigned int) len, mbps, nsPerOp);
+        }
+    }
+
+    delete g_packet;
+    return 0;
+}
@@ -0,0 +1,551 @@
+/**
+ * @file
+ * End-to-end throughput and latency benchmark of the daemon.  Starts a daemon in process (or uses
+ * an external one), connects a service and a number of clients to it over a unix or tcp loopback
+ * connection and runs a set of standard scenarios, reporting latency percentiles for each as
+ * comma separated values.
+ */
+
+/******************************************************************************
+ * Copyright 2012, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#include <qcc/platform.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <qcc/Debug.h>
+#include <qcc/Event.h>
+#include <qcc/Mutex.h>
+#include <qcc/String.h>
+#include <qcc/StringUtil.h>
+#include <qcc/Thread.h>
+#include <qcc/Util.h>
+
+#include <alljoyn/AuthListener.h>
+#include <alljoyn/BusAttachment.h>
+#include <alljoyn/BusObject.h>
+#include <alljoyn/DBusStd.h>
+#include <alljoyn/ProxyBusObject.h>
+#include <alljoyn/SessionPortListener.h>
+
+#include <Status.h>
+
+#include "BenchUtil.h"
+#include "Bus.h"
+#include "BusController.h"
+#include "DaemonConfig.h"
+#include "DaemonTransport.h"
+#include "MicroTimestamp.h"
+#include "TCPTransport.h"
+#include "Transport.h"
+#include "TransportList.h"
+
+#define QCC_MODULE "ALLJOYN"
+
+using namespace qcc;
+using namespace std;
+using namespace ajn;
+
+/*
+ * Configuration of the daemon started in process, with room for many clients and slow
+ * authentications.  All the clients connect from the loopback address, which the default of no
+ * per address connection limits allows.
+ */
+static const char daemonConfig[] =
+    "<busconfig>"
+    "  <type>alljoyn</type>"
+    "  <limit auth_timeout=\"20000\"/>"
+    "  <limit max_incomplete_connections=\"64\"/>"
+    "  <limit max_completed_connections=\"512\"/>"
+    "</busconfig>";
+
+namespace bench {
+const char* ServiceName = "org.alljoyn.bench";
+const char* ObjectPath = "/org/alljoyn/bench";
+const char* InterfaceName = "org.alljoyn.bench";
+const char* SecureInterfaceName = "org.alljoyn.bench.secure";
+const char* TickMatch = "type='signal',interface='org.alljoyn.bench',member='Tick'";
+const SessionPort Port = 42;
+const uint32_t SignalTimeout = 5000;
+}
+
+/*
+ * Latencies measured by a scenario in microseconds and the number of operations that failed.
+ */
+struct Samples {
+    Samples() : errors(0) { }
+
+    void Merge(const Samples& other)
+    {
+        latencies.insert(latencies.end(), other.latencies.begin(), other.latencies.end());
+        errors += other.errors;
+    }
+
+    vector<uint32_t> latencies;
+    uint32_t errors;
+};
+
+static QStatus CreateInterfaces(BusAttachment& bus)
+{
+    InterfaceDescription* intf = NULL;
+    QStatus status = bus.CreateInterface(bench::InterfaceName, intf);
+    if (status == ER_OK) {
+        intf->AddMethod("Echo", "ay", "ay", "in,out", 0);
+        intf->AddSignal("Tick", "t", "sent", 0);
+        intf->Activate();
+        status = bus.CreateInterface(bench::SecureInterfaceName, intf, true);
+    }
+    if (status == ER_OK) {
+        intf->AddMethod("Echo", "ay", "ay", "in,out", 0);
+        intf->Activate();
+    }
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Failed to create benchmark interfaces"));
+    }
+    return status;
+}
+
+/*
+ * The object of the service: echoes method calls on both interfaces and emits the ticks.
+ */
+class BenchObject : public BusObject {
+  public:
+    BenchObject(BusAttachment& bus) : BusObject(bus, bench::ObjectPath)
+    {
+        const InterfaceDescription* intf = bus.GetInterface(bench::InterfaceName);
+        const InterfaceDescription* secureIntf = bus.GetInterface(bench::SecureInterfaceName);
+        AddInterface(*intf);
+        AddInterface(*secureIntf);
+        tick = intf->GetMember("Tick");
+        const MethodEntry methodEntries[] = {
+            { intf->GetMember("Echo"), static_cast<MessageReceiver::MethodHandler>(&BenchObject::Echo) },
+            { secureIntf->GetMember("Echo"), static_cast<MessageReceiver::MethodHandler>(&BenchObject::Echo) }
+        };
+        QStatus status = AddMethodHandlers(methodEntries, ArraySize(methodEntries));
+        if (status != ER_OK) {
+            QCC_LogError(status, ("Failed to register method handlers"));
+        }
+    }
+
+    QStatus EmitTick(SessionId sessionId)
+    {
+        MsgArg arg("t", GetMicroTimestamp());
+        return Signal(NULL, sessionId, *tick, &arg, 1);
+    }
+
+  private:
+    void Echo(const InterfaceDescription::Member* member, Message& msg)
+    {
+        QStatus status = MethodReply(msg, msg->GetArg(0), 1);
+        if (status != ER_OK) {
+            QCC_LogError(status, ("Echo reply failed"));
+        }
+    }
+
+    const InterfaceDescription::Member* tick;
+};
+
+class BenchAuthListener : public AuthListener {
+    bool RequestCredentials(const char* authMechanism, const char* peerName, uint16_t authCount, const char* userName, uint16_t credMask, Credentials& creds)
+    {
+        if (credMask & AuthListener::CRED_PASSWORD) {
+            creds.SetPassword("135246");
+        }
+        return true;
+    }
+
+    void AuthenticationComplete(const char* authMechanism, const char* peerName, bool success)
+    {
+        if (!success) {
+            QCC_LogError(ER_AUTH_FAIL, ("Authentication with %s failed", peerName));
+        }
+    }
+};
+
+class SessionHost : public SessionPortListener {
+  public:
+    SessionHost() : sessionId(0) { }
+
+    bool AcceptSessionJoiner(SessionPort sessionPort, const char* joiner, const SessionOpts& opts) { return true; }
+
+    void SessionJoined(SessionPort sessionPort, SessionId id, const char* joiner) { sessionId = id; }
+
+    volatile SessionId sessionId;
+};
+
+/*
+ * Ticks received by all the clients.  The emitter waits for every client to receive a tick before
+ * emitting the next so the latencies do not include time spent in queues behind earlier ticks.
+ */
+struct FanOut {
+    FanOut() : expected(0), received(0) { }
+
+    Mutex lock;
+    Event done;
+    uint32_t expected;
+    uint32_t received;
+    Samples samples;
+};
+
+class TickReceiver : public MessageReceiver {
+  public:
+    TickReceiver(FanOut& fanOut) : fanOut(fanOut) { }
+
+    void Tick(const InterfaceDescription::Member* member, const char* srcPath, Message& msg)
+    {
+        uint64_t sent = msg->GetArg(0)->v_uint64;
+        uint32_t latency = static_cast<uint32_t>(GetMicroTimestamp() - sent);
+        fanOut.lock.Lock(MUTEX_CONTEXT);
+        fanOut.samples.latencies.push_back(latency);
+        if (++fanOut.received >= fanOut.expected) {
+            fanOut.done.SetEvent();
+        }
+        fanOut.lock.Unlock(MUTEX_CONTEXT);
+    }
+
+  private:
+    FanOut& fanOut;
+};
+
+/*
+ * Makes method calls to the service one after the other.
+ */
+class Caller : public Thread {
+  public:
+    Caller(BusAttachment& bus, const char* intfName, uint32_t count, size_t arraySize) :
+        Thread("Caller"), bus(bus), intfName(intfName), count(count), arraySize(arraySize) { }
+
+    const Samples& GetSamples() const { return samples; }
+
+  protected:
+    ThreadReturn STDCALL Run(void* arg)
+    {
+        ProxyBusObject proxy(bus, bench::ServiceName, bench::ObjectPath, 0);
+        const InterfaceDescription* intf = bus.GetInterface(intfName);
+        proxy.AddInterface(*intf);
+        const InterfaceDescription::Member* echo = intf->GetMember("Echo");
+
+        vector<uint8_t> payload(arraySize ? arraySize : 1, 0xA5);
+        MsgArg in("ay", arraySize, &payload[0]);
+        Message reply(bus);
+
+        /* The first call pays for authentication and introspection of the security setting */
+        if (proxy.MethodCall(*echo, &in, 1, reply) != ER_OK) {
+            ++samples.errors;
+        }
+        for (uint32_t i = 0; i < count; ++i) {
+            uint64_t start = GetMicroTimestamp();
+            QStatus status = proxy.MethodCall(*echo, &in, 1, reply);
+            if (status == ER_OK) {
+                samples.latencies.push_back(static_cast<uint32_t>(GetMicroTimestamp() - start));
+            } else {
+                ++samples.errors;
+            }
+        }
+        return 0;
+    }
+
+  private:
+    BusAttachment& bus;
+    const char* intfName;
+    uint32_t count;
+    size_t arraySize;
+    Samples samples;
+};
+
+struct Client {
+    Client() : bus(NULL), receiver(NULL), sessionId(0) { }
+
+    BusAttachment* bus;
+    TickReceiver* receiver;
+    SessionId sessionId;
+};
+
+static void Report(FILE* out, const char* scenario, const char* transport, size_t clients, Samples& samples, uint64_t elapsed, size_t payload)
+{
+    sort(samples.latencies.begin(), samples.latencies.end());
+    double perSec = elapsed ? (samples.latencies.size() * 1000000.0) / elapsed : 0.0;
+    fprintf(out, "%s,%s,%u,%u,%u,%u,%u,%u,%u,%u,%.0f,%u\n",
+            scenario, transport, static_cast<uint32_t>(clients),
+            static_cast<uint32_t>(samples.latencies.size()), samples.errors,
+            Percentile(samples.latencies, 500),
+            Percentile(samples.latencies, 900),
+            Percentile(samples.latencies, 990),
+            Percentile(samples.latencies, 999),
+            samples.latencies.empty() ? 0 : samples.latencies.back(),
+            perSec, static_cast<uint32_t>(payload));
+    fflush(out);
+}
+
+static void RunCalls(FILE* out, const char* scenario, const char* transport, vector<Client>& clients, const char* intfName, uint32_t count, size_t arraySize)
+{
+    vector<Caller*> callers;
+    for (size_t i = 0; i < clients.size(); ++i) {
+        callers.push_back(new Caller(*clients[i].bus, intfName, count, arraySize));
+    }
+    uint64_t start = GetMicroTimestamp();
+    for (size_t i = 0; i < callers.size(); ++i) {
+        callers[i]->Start();
+    }
+    Samples samples;
+    for (size_t i = 0; i < callers.size(); ++i) {
+        callers[i]->Join();
+        samples.Merge(callers[i]->GetSamples());
+        delete callers[i];
+    }
+    Report(out, scenario, transport, clients.size(), samples, GetMicroTimestamp() - start, arraySize);
+}
+
+static void RunTicks(FILE* out, const char* scenario, const char* transport, size_t clients, BenchObject& service, FanOut& fanOut, SessionId sessionId, uint32_t count)
+{
+    fanOut.lock.Lock(MUTEX_CONTEXT);
+    fanOut.samples = Samples();
+    fanOut.expected = 0;
+    fanOut.received = 0;
+    fanOut.lock.Unlock(MUTEX_CONTEXT);
+
+    uint64_t start = GetMicroTimestamp();
+    for (uint32_t i = 0; i < count; ++i) {
+        fanOut.lock.Lock(MUTEX_CONTEXT);
+        fanOut.expected += clients;
+        fanOut.done.ResetEvent();
+        fanOut.lock.Unlock(MUTEX_CONTEXT);
+        QStatus status = service.EmitTick(sessionId);
+        if (status == ER_OK) {
+            status = Event::Wait(fanOut.done, bench::SignalTimeout);
+        }
+        if (status != ER_OK) {
+            QCC_LogError(status, ("Tick %u not received by all clients", i));
+        }
+    }
+    uint64_t elapsed = GetMicroTimestamp() - start;
+
+    fanOut.lock.Lock(MUTEX_CONTEXT);
+    Samples samples = fanOut.samples;
+    samples.errors = fanOut.expected - min(fanOut.received, fanOut.expected);
+    fanOut.lock.Unlock(MUTEX_CONTEXT);
+    Report(out, scenario, transport, clients, samples, elapsed, sizeof(uint64_t));
+}
+
+static bool Selected(const String& scenarios, const char* scenario)
+{
+    return (scenarios == "all") || (("," + scenarios + ",").find(String(",") + scenario + ",") != String::npos);
+}
+
+static void usage(void)
+{
+    printf("Usage: daemonbench [-t unix|tcp] [-x <connect spec>] [-p <tcp port>] [-c <clients>] [-n <count>] [-a <array bytes>] [-s <scenarios>] [-o <file>]\n\n");
+    printf("Options:\n");
+    printf("   -t <transport>     = Loopback connection to the daemon started in process (default unix)\n");
+    printf("   -x <connect spec>  = Use the daemon at <connect spec> instead of starting one\n");
+    printf("   -p <tcp port>      = Port the daemon listens on with -t tcp (default 9966)\n");
+    printf("   -c <clients>       = Number of client bus attachments (default 4)\n");
+    printf("   -n <count>         = Calls per client or signals per scenario (default 1000)\n");
+    printf("   -a <array bytes>   = Size of the byte array in the array scenario (default 65536)\n");
+    printf("   -s <scenarios>     = Comma separated list of ping,signal,session,secure,array or all (default all)\n");
+    printf("   -o <file>          = Write the results to <file> instead of stdout\n");
+}
+
+int main(int argc, char** argv)
+{
+    QStatus status = ER_OK;
+    String transport("unix");
+    String connectSpec;
+    uint32_t port = 9966;
+    uint32_t numClients = 4;
+    uint32_t count = 1000;
+    size_t arraySize = 65536;
+    String scenarios("all");
+    const char* outFile = NULL;
+
+    for (int i = 1; i < argc; ++i) {
+        if ((0 == strcmp("-t", argv[i])) && (i + 1 < argc)) {
+            transport = argv[++i];
+        } else if ((0 == strcmp("-x", argv[i])) && (i + 1 < argc)) {
+            connectSpec = argv[++i];
+            transport = "external";
+        } else if ((0 == strcmp("-p", argv[i])) && (i + 1 < argc)) {
+            port = strtoul(argv[++i], NULL, 10);
+        } else if ((0 == strcmp("-c", argv[i])) && (i + 1 < argc)) {
+            numClients = strtoul(argv[++i], NULL, 10);
+        } else if ((0 == strcmp("-n", argv[i])) && (i + 1 < argc)) {
+            count = strtoul(argv[++i], NULL, 10);
+        } else if ((0 == strcmp("-a", argv[i])) && (i + 1 < argc)) {
+            arraySize = strtoul(argv[++i], NULL, 10);
+        } else if ((0 == strcmp("-s", argv[i])) && (i + 1 < argc)) {
+            scenarios = argv[++i];
+        } else if ((0 == strcmp("-o", argv[i])) && (i + 1 < argc)) {
+            outFile = argv[++i];
+        } else {
+            usage();
+            exit(1);
+        }
+    }
+    if (transport == "unix") {
+        connectSpec = "unix:abstract=daemonbench-" + U32ToString(GetPid());
+    } else if (transport == "tcp") {
+        connectSpec = "tcp:r4addr=127.0.0.1,r4port=" + U32ToString(port);
+    } else if (transport != "external") {
+        usage();
+        exit(1);
+    }
+    if (numClients == 0) {
+        numClients = 1;
+    }
+
+    FILE* out = outFile ? fopen(outFile, "w") : stdout;
+    if (!out) {
+        printf("Cannot create %s\n", outFile);
+        exit(1);
+    }
+
+    /*
+     * The daemon started in process only listens on the loopback connection the clients use.
+     */
+    Bus* daemonBus = NULL;
+    BusController* controller = NULL;
+    TransportFactoryContainer cntr;
+    if (transport != "external") {
+        DaemonConfig::Load(daemonConfig);
+        cntr.Add(new TransportFactory<DaemonTransport>(DaemonTransport::TransportName, true));
+        cntr.Add(new TransportFactory<TCPTransport>(TCPTransport::TransportName, false));
+        daemonBus = new Bus("daemonbench-daemon", cntr, connectSpec.c_str());
+        controller = new BusController(*daemonBus);
+        status = controller->Init(connectSpec);
+        if (status != ER_OK) {
+            QCC_LogError(status, ("Failed to start the daemon listening on %s", connectSpec.c_str()));
+            exit(1);
+        }
+    }
+
+    bool secure = Selected(scenarios, "secure");
+    BenchAuthListener authListener;
+    SessionOpts opts(SessionOpts::TRAFFIC_MESSAGES, true, SessionOpts::PROXIMITY_ANY, TRANSPORT_ANY);
+    SessionHost sessionHost;
+    SessionPort sessionPort = bench::Port;
+
+    BusAttachment service("daemonbench-service", true);
+    status = service.Start();
+    if (status == ER_OK) {
+        status = CreateInterfaces(service);
+    }
+    if ((status == ER_OK) && secure) {
+        status = service.EnablePeerSecurity("ALLJOYN_SRP_KEYX", &authListener);
+        service.ClearKeyStore();
+    }
+    BenchObject* serviceObj = NULL;
+    if (status == ER_OK) {
+        serviceObj = new BenchObject(service);
+        status = service.RegisterBusObject(*serviceObj);
+    }
+    if (status == ER_OK) {
+        status = service.Connect(connectSpec.c_str());
+    }
+    if (status == ER_OK) {
+        status = service.RequestName(bench::ServiceName, DBUS_NAME_FLAG_REPLACE_EXISTING | DBUS_NAME_FLAG_DO_NOT_QUEUE);
+    }
+    if (status == ER_OK) {
+        status = service.BindSessionPort(sessionPort, opts, sessionHost);
+    }
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Failed to set up the service"));
+        exit(1);
+    }
+
+    FanOut fanOut;
+    vector<Client> clients(numClients);
+    for (size_t i = 0; (status == ER_OK) && (i < clients.size()); ++i) {
+        Client& client = clients[i];
+        /* Each client has its own name so each has its own key store */
+        client.bus = new BusAttachment(("daemonbench-client-" + U32ToString(i)).c_str(), true);
+        client.receiver = new TickReceiver(fanOut);
+        status = client.bus->Start();
+        if (status == ER_OK) {
+            status = CreateInterfaces(*client.bus);
+        }
+        if ((status == ER_OK) && secure) {
+            status = client.bus->EnablePeerSecurity("ALLJOYN_SRP_KEYX", &authListener);
+            client.bus->ClearKeyStore();
+        }
+        if (status == ER_OK) {
+            status = client.bus->Connect(connectSpec.c_str());
+        }
+        if (status == ER_OK) {
+            const InterfaceDescription::Member* tick = client.bus->GetInterface(bench::InterfaceName)->GetMember("Tick");
+            status = client.bus->RegisterSignalHandler(client.receiver, static_cast<MessageReceiver::SignalHandler>(&TickReceiver::Tick), tick, NULL);
+        }
+        if (status == ER_OK) {
+            status = client.bus->AddMatch(bench::TickMatch);
+        }
+        if ((status == ER_OK) && Selected(scenarios, "session")) {
+            SessionOpts joinOpts(opts);
+            status = client.bus->JoinSession(bench::ServiceName, sessionPort, NULL, client.sessionId, joinOpts);
+        }
+        if (status != ER_OK) {
+            QCC_LogError(status, ("Failed to set up client %u", static_cast<uint32_t>(i)));
+        }
+    }
+
+    if (status == ER_OK) {
+        fprintf(out, "scenario,transport,clients,samples,errors,p50_us,p90_us,p99_us,p999_us,max_us,ops_per_sec,payload_bytes\n");
+        if (Selected(scenarios, "ping")) {
+            RunCalls(out, "ping", transport.c_str(), clients, bench::InterfaceName, count, 0);
+        }
+        if (Selected(scenarios, "signal")) {
+            RunTicks(out, "signal", transport.c_str(), clients.size(), *serviceObj, fanOut, 0, count);
+        }
+        if (Selected(scenarios, "session")) {
+            /* The session id is reported to the host after JoinSession returns to the joiner */
+            for (uint32_t wait = 0; (sessionHost.sessionId == 0) && (wait < bench::SignalTimeout); wait += 10) {
+                qcc::Sleep(10);
+            }
+            RunTicks(out, "session", transport.c_str(), clients.size(), *serviceObj, fanOut, sessionHost.sessionId, count);
+        }
+        if (secure) {
+            RunCalls(out, "secure", transport.c_str(), clients, bench::SecureInterfaceName, count, 0);
+        }
+        if (Selected(scenarios, "array")) {
+            RunCalls(out, "array", transport.c_str(), clients, bench::InterfaceName, count, arraySize);
+        }
+    }
+
+    for (size_t i = 0; i < clients.size(); ++i) {
+        if (clients[i].bus) {
+            clients[i].bus->Stop();
+            clients[i].bus->Join();
+            delete clients[i].bus;
+        }
+        delete clients[i].receiver;
+    }
+    service.UnregisterBusObject(*serviceObj);
+    service.Stop();
+    service.Join();
+    delete serviceObj;
+
+    if (daemonBus) {
+        daemonBus->StopListen(connectSpec.c_str());
+        delete controller;
+        delete daemonBus;
+        DaemonConfig::Release();
+    }
+    if (outFile) {
+        fclose(out);
+    }
+    return (status == ER_OK) ? 0 : 1;
+}
@@ -0,0 +1,499 @@
+/**
+ * @file
+ * Fuzz and throughput harness for the JSON readers used on Rendezvous Server
+ * responses.  Json::ArenaReader is checked against Json::Reader on mutated
+ * payloads and both are timed on a corpus of typical responses or on
+ * payloads recorded from a live server.
+ */
+
+/******************************************************************************
+ * Copyright 2012, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#include <qcc/platform.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <qcc/String.h>
+#include <qcc/StringUtil.h>
+#include <qcc/Util.h>
+#include <alljoyn/version.h>
+
+#include <JSON/json.h>
+
+#include "BenchUtil.h"
+
+#define QCC_MODULE "JSON"
+
+using namespace qcc;
+using namespace std;
+
+typedef vector<char> Payload;
+
+static void Append(Payload& payload, const String& str)
+{
+    payload.insert(payload.end(), str.begin(), str.end());
+}
+
+static String Quote(const String& str)
+{
+    return "\"" + str + "\"";
+}
+
+static String STUNInfo(uint32_t n, bool relay)
+{
+    String info = "{\"address\":" + Quote("10.0.0." + U32ToString(n % 250 + 1)) + ",\"port\":3478," +
+                  "\"acct\":" + Quote("1350000000:peer" + U32ToString(n)) + "," +
+                  "\"pwd\":\"c2VjcmV0X3R1cm5fcGFzc3dvcmRf\\/Kz9+w==\",\"expiryTime\":86400";
+    if (relay) {
+        info += ",\"relay\":{\"address\":" + Quote("10.0.1." + U32ToString(n % 250 + 1)) + ",\"port\":3479}";
+    }
+    return info + "}";
+}
+
+static String Candidates(uint32_t n, uint32_t count)
+{
+    static const char* types[] = { "host", "srflx", "relay" };
+    String candidates = "[";
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t type = i % 3;
+        if (i) {
+            candidates += ",";
+        }
+        candidates += "{\"type\":" + Quote(types[type]) + ",\"foundation\":" + Quote(U32ToString(1000 + i)) +
+                      ",\"componentID\":1,\"transport\":\"UDP\",\"priority\":" + U32ToString(2130706431 - i * 256) +
+                      ",\"address\":" + Quote("192.168." + U32ToString(n % 250) + "." + U32ToString(i + 2)) +
+                      ",\"port\":" + U32ToString(50000 + i);
+        if (type) {
+            candidates += ",\"raddress\":" + Quote("192.168." + U32ToString(n % 250) + ".2") + ",\"rport\":50000";
+        }
+        candidates += "}";
+    }
+    return candidates + "]";
+}
+
+static String PeerAddr(uint32_t n)
+{
+    return Quote("peer-" + U32ToString(n, 16, 8, '0') + "@rdvs.alljoyn.org");
+}
+
+/* Persistent connection response carrying matches, address candidates, revocations and ICE check requests */
+static Payload MessagesResponse(uint32_t matches, uint32_t candidates, uint32_t revoked)
+{
+    String msgs;
+    for (uint32_t i = 0; i < matches; ++i) {
+        msgs += String(msgs.empty() ? "" : ",") +
+                "{\"type\":\"match\",\"match\":{\"searchedService\":\"org.alljoyn.bus.samples.*\"," +
+                "\"service\":" + Quote("org.alljoyn.bus.samples.chat.instance" + U32ToString(i)) +
+                ",\"peerAddr\":" + PeerAddr(i) + ",\"STUNInfo\":" + STUNInfo(i, i & 1) + "}}";
+    }
+    if (candidates) {
+        msgs += String(msgs.empty() ? "" : ",") +
+                "{\"type\":\"addressCandidates\",\"addressCandidates\":{\"source\":" + PeerAddr(1) +
+                ",\"destination\":" + PeerAddr(2) + ",\"peerAddr\":" + PeerAddr(1) +
+                ",\"ice-ufrag\":\"aV9mcmFnXzE=\",\"ice-pwd\":\"aWNlX3Bhc3N3b3JkXzFfXzFfXzE=\"," +
+                "\"candidates\":" + Candidates(1, candidates) + ",\"STUNInfo\":" + STUNInfo(1, true) + "}}";
+        msgs += ",{\"type\":\"startICEChecks\",\"startICEChecks\":{\"peerAddr\":" + PeerAddr(2) + "}}";
+    }
+    if (revoked) {
+        String services;
+        for (uint32_t i = 0; i < revoked; ++i) {
+            services += String(services.empty() ? "" : ",") + Quote("org.alljoyn.bus.samples.chat.instance" + U32ToString(i));
+        }
+        msgs += String(msgs.empty() ? "" : ",") +
+                "{\"type\":\"matchRevoked\",\"matchRevoked\":{\"peerAddr\":" + PeerAddr(3) +
+                ",\"deleteAll\":false,\"services\":[" + services + "]}}";
+    }
+
+    Payload payload;
+    Append(payload, "{\"msgs\":[" + msgs + "]}");
+    return payload;
+}
+
+/* Responses a daemon typically gets from the Rendezvous Server, from the small on demand replies to busy message lists */
+static void BuildCorpus(vector<Payload>& corpus)
+{
+    Payload payload;
+
+    Append(payload, "{\"peerID\":\"0f3c1a5e8b2d4c7f9a6e1d3b5c7a9e2f\"}");
+    corpus.push_back(payload);
+
+    payload.clear();
+    Append(payload, "{\"message\":\"r=fyko+d2lbbFgONRv9qkxdawL3rfcNHYJY1ZVvWVs7j,s=QSXCR+Q6sek8bf92,i=4096\"}");
+    corpus.push_back(payload);
+
+    payload.clear();
+    Append(payload, "{\n    \"message\" : \"v=rmF9pqV8S7suAoZWja4dJRkFsKQ=\",\n    \"peerID\" : \"0f3c1a5e8b2d4c7f\",\n"
+           "    \"peerAddr\" : " + PeerAddr(0) + ",\n    \"daemonRegistrationRequired\" : true,\n"
+           "    \"sessionActive\" : false,\n    \"configData\" : { \"Tkeepalive\" : 600 }\n}\n");
+    corpus.push_back(payload);
+
+    payload.clear();
+    Append(payload, "{\"acct\":\"1350000000:peer0\",\"pwd\":\"dHVybl9wYXNzd29yZF9cdTAwZTk=\\u00e9\\u2603\\ud834\\udd1e\","
+           "\"expiryTime\":86400}");
+    corpus.push_back(payload);
+
+    corpus.push_back(MessagesResponse(1, 0, 0));
+    corpus.push_back(MessagesResponse(0, 12, 0));
+    corpus.push_back(MessagesResponse(0, 0, 20));
+    corpus.push_back(MessagesResponse(20, 0, 0));
+    corpus.push_back(MessagesResponse(100, 12, 50));
+}
+
+/* Captures are a sequence of HTTP response bodies, each preceded by its length as four octets in network byte order */
+static bool LoadCapture(const char* fileName, vector<Payload>& corpus)
+{
+    FILE* fp = fopen(fileName, "rb");
+    if (!fp) {
+        printf("Unable to open %s\n", fileName);
+        return false;
+    }
+    uint8_t len[4];
+    while (fread(len, 1, 4, fp) == 4) {
+        Payload payload((len[0] << 24) | (len[1] << 16) | (len[2] << 8) | len[3]);
+        if (payload.size() && (fread(&payload[0], 1, payload.size(), fp) != payload.size())) {
+            printf("Truncated capture %s\n", fileName);
+            fclose(fp);
+            return false;
+        }
+        corpus.push_back(payload);
+    }
+    fclose(fp);
+    return true;
+}
+
+static bool WriteCapture(const char* fileName, const vector<Payload>& corpus)
+{
+    FILE* fp = fopen(fileName, "wb");
+    if (!fp) {
+        printf("Unable to create %s\n", fileName);
+        return false;
+    }
+    for (size_t i = 0; i < corpus.size(); ++i) {
+        size_t size = corpus[i].size();
+        uint8_t len[4] = {
+            static_cast<uint8_t>(size >> 24), static_cast<uint8_t>(size >> 16),
+            static_cast<uint8_t>(size >> 8), static_cast<uint8_t>(size)
+        };
+        fwrite(len, 1, 4, fp);
+        fwrite(&corpus[i][0], 1, size, fp);
+    }
+    fclose(fp);
+    return true;
+}
+
+/* Check that a value read by Json::Reader and one read by Json::ArenaReader hold the same data */
+static bool Equal(const Json::Value& value, const Json::ArenaValue& arenaValue)
+{
+    if (value.type() != arenaValue.type()) {
+        return false;
+    }
+    switch (value.type()) {
+    case Json::nullValue:
+        return true;
+
+    case Json::intValue:
+        return value.asInt() == arenaValue.asInt();
+
+    case Json::uintValue:
+        return value.asUInt() == arenaValue.asUInt();
+
+    case Json::realValue:
+        return value.asDouble() == arenaValue.asDouble();
+
+    case Json::booleanValue:
+        return value.asBool() == arenaValue.asBool();
+
+    case Json::stringValue:
+        return strcmp(value.asCString(), arenaValue.asCString()) == 0;
+
+    case Json::arrayValue:
+        if (value.size() != arenaValue.size()) {
+            return false;
+        }
+        for (Json::UInt i = 0; i < value.size(); ++i) {
+            if (!Equal(value[i], arenaValue[i])) {
+                return false;
+            }
+        }
+        return true;
+
+    case Json::objectValue:
+    {
+        /* Json::Value keeps the last of repeated members, ArenaValue keeps them all but finds the last */
+        Json::Value::Members names = value.getMemberNames();
+        for (size_t i = 0; i < names.size(); ++i) {
+            if (!arenaValue.isMember(names[i].c_str()) || !Equal(value[names[i]], arenaValue[names[i].c_str()])) {
+                return false;
+            }
+        }
+        for (Json::UInt i = 0; i < arenaValue.size(); ++i) {
+            if (!value.isMember(arenaValue.member(i).name())) {
+                return false;
+            }
+        }
+        return names.size() <= arenaValue.size();
+    }
+    }
+    return false;
+}
+
+/* Check that both readers accept a payload and read the same values, or that ArenaReader rejects it */
+static bool Compare(const Payload& payload)
+{
+    Json::Reader reader;
+    Json::Value value;
+    string document(payload.begin(), payload.end());
+    bool valid = reader.parse(document, value);
+
+    Payload buf(payload);
+    Json::Arena arena;
+    Json::ArenaReader arenaReader;
+    const Json::ArenaValue* root;
+    char* begin = buf.empty() ? NULL : &buf[0];
+    if (!arenaReader.parse(begin, begin + buf.size(), arena, root)) {
+        return true;
+    }
+    if (!valid) {
+        printf("ArenaReader accepted a payload Reader rejected: %s\n", reader.getFormatedErrorMessages().c_str());
+        return false;
+    }
+    if (!Equal(value, *root)) {
+        printf("Readers disagree on the values\n");
+        return false;
+    }
+    return true;
+}
+
+static void Mutate(Payload& payload)
+{
+    static const char tokens[] = "{}[]:,\"\\ -0123456789.eEtrufalsn";
+
+    switch (Rand32() % 5) {
+    case 0:
+        if (payload.size()) {
+            payload[Rand32() % payload.size()] = tokens[Rand32() % (sizeof(tokens) - 1)];
+        }
+        break;
+
+    case 1:
+        if (payload.size()) {
+            payload[Rand32() % payload.size()] = static_cast<char>(Rand32());
+        }
+        break;
+
+    case 2:
+        payload.resize(payload.size() ? Rand32() % payload.size() : 0);
+        break;
+
+    case 3:
+        if (payload.size()) {
+            payload.erase(payload.begin() + Rand32() % payload.size());
+        }
+        break;
+
+    default:
+        payload.insert(payload.begin() + (payload.size() ? Rand32() % payload.size() : 0), tokens[Rand32() % (sizeof(tokens) - 1)]);
+        break;
+    }
+}
+
+static bool CheckMutated(Payload& payload, bool& accepted)
+{
+    if (!Compare(payload)) {
+        return false;
+    }
+    Payload buf(payload);
+    Json::Arena arena;
+    Json::ArenaReader arenaReader;
+    const Json::ArenaValue* root;
+    char* begin = buf.empty() ? NULL : &buf[0];
+    accepted = arenaReader.parse(begin, begin + buf.size(), arena, root);
+    return true;
+}
+
+/* Visit every value the way the Rendezvous Server response parsers do */
+static uint32_t Walk(const Json::Value& value)
+{
+    uint32_t sum = 1;
+    if (value.isString()) {
+        sum += strlen(value.asCString());
+    } else if (value.isArray()) {
+        for (Json::UInt i = 0; i < value.size(); ++i) {
+            sum += Walk(value[i]);
+        }
+    } else if (value.isObject()) {
+        Json::Value::Members names = value.getMemberNames();
+        for (size_t i = 0; i < names.size(); ++i) {
+            sum += Walk(value[names[i]]);
+        }
+    }
+    return sum;
+}
+
+static uint32_t Walk(const Json::ArenaValue& value)
+{
+    uint32_t sum = 1;
+    if (value.isString()) {
+        sum += strlen(value.asCString());
+    } else {
+        for (Json::UInt i = 0; i < value.size(); ++i) {
+            sum += Walk(value.member(i));
+        }
+    }
+    return sum;
+}
+
+/* What HttpConnection::ParseResponse() does with every payload, the old way and the new */
+static uint32_t RunReader(const Payload& payload, Payload&, Json::Arena&)
+{
+    Json::Reader reader;
+    Json::Value value;
+    string document(&payload[0], payload.size());
+    if (!reader.parse(document, value)) {
+        return 0;
+    }
+    return Walk(value);
+}
+
+static uint32_t RunArena(const Payload& payload, Payload& buf, Json::Arena& arena)
+{
+    static Json::ArenaReader reader;
+    const Json::ArenaValue* root;
+    /* The payload is parsed in place, so it is copied into the receive buffer first as it would be read from the socket */
+    memcpy(&buf[0], &payload[0], payload.size());
+    arena.clear();
+    if (!reader.parse(&buf[0], &buf[0] + payload.size(), arena, root)) {
+        return 0;
+    }
+    return Walk(*root);
+}
+
+struct Parser {
+    const char* name;
+    uint32_t (*run)(const Payload& payload, Payload& buf, Json::Arena& arena);
+};
+
+static const Parser g_parsers[] = {
+    { "reader", RunReader },
+    { "arena",  RunArena  }
+};
+
+static const size_t NUM_PARSERS = sizeof(g_parsers) / sizeof(g_parsers[0]);
+
+/* One timed operation: read a payload with a parser */
+struct RunParser {
+    RunParser(const Parser& parser, const Payload& payload, Payload& buf, Json::Arena& arena) :
+        parser(parser), payload(payload), buf(buf), arena(arena) { }
+    uint32_t operator()() const { return parser.run(payload, buf, arena); }
+    const Parser& parser;
+    const Payload& payload;
+    Payload& buf;
+    Json::Arena& arena;
+};
+
+static void usage(void)
+{
+    printf("Usage: jsonbench [-h] [-c <capture>] [-w <capture>] [-f <iterations>] [-t <ms>]\n\n");
+    printf("Options:\n");
+    printf("   -h               - Print this help message\n");
+    printf("   -c <capture>     - Use the payloads in a capture file instead of the built in ones\n");
+    printf("   -w <capture>     - Write the built in payloads to a capture file and exit\n");
+    printf("   -f <iterations>  - Number of mutated payloads to check (default 100000)\n");
+    printf("   -t <ms>          - Time spent on each parser and payload (default 250)\n");
+    printf("\n");
+    printf("A capture file holds HTTP response bodies, each preceded by its length in four\n");
+    printf("octets in network byte order.\n");
+    printf("\n");
+}
+
+int main(int argc, char** argv)
+{
+    const char* captureName = NULL;
+    const char* writeName = NULL;
+    uint32_t iterations = 100000;
+
+    printf("AllJoyn Library version: %s\n", ajn::GetVersion());
+    printf("AllJoyn Library build info: %s\n", ajn::GetBuildInfo());
+
+    /* Parse command line args */
+    for (int i = 1; i < argc; ++i) {
+        if (::strcmp("-h", argv[i]) == 0) {
+            usage();
+            exit(0);
+        } else if ((::strcmp("-c", argv[i]) == 0) && ((i + 1) < argc)) {
+            captureName = argv[++i];
+        } else if ((::strcmp("-w", argv[i]) == 0) && ((i + 1) < argc)) {
+            writeName = argv[++i];
+        } else if ((::strcmp("-f", argv[i]) == 0) && ((i + 1) < argc)) {
+            iterations = StringToU32(argv[++i], 10, 100000);
+        } else if ((::strcmp("-t", argv[i]) == 0) && ((i + 1) < argc)) {
+            g_runMs = StringToU32(argv[++i], 10, 250);
+        } else {
+            printf("Unknown option %s\n", argv[i]);
+            usage();
+            exit(1);
+        }
+    }
+
+    vector<Payload> corpus;
+    if (captureName) {
+        if (!LoadCapture(captureName, corpus)) {
+            return 1;
+        }
+    } else {
+        BuildCorpus(corpus);
+    }
+    if (writeName) {
+        return WriteCapture(writeName, corpus) ? 0 : 1;
+    }
+    if (corpus.empty()) {
+        printf("No payloads\n");
+        return 1;
+    }
+
+    /* Every payload must read the same way both ways before we bother timing anything */
+    for (size_t i = 0; i < corpus.size(); ++i) {
+        if (!Compare(corpus[i])) {
+            printf("Payload %u reads differently\n", (unsigned int) i);
+            return 1;
+        }
+    }
+    if (!Fuzz(corpus, iterations, "payload", Mutate, CheckMutated)) {
+        return 1;
+    }
+
+    printf("%-12s %8s %8s %12s %10s\n", "parser", "payload", "size", "payloads/s", "ns/op");
+    for (size_t p = 0; p < NUM_PARSERS; ++p) {
+        const Parser& parser = g_parsers[p];
+        for (size_t i = 0; i < corpus.size(); ++i) {
+            if (corpus[i].empty()) {
+                continue;
+            }
+            Payload buf(corpus[i].size());
+            Json::Arena arena;
+            uint64_t elapsed;
+            uint64_t ops = RunTimed(RunParser(parser, corpus[i], buf, arena), elapsed);
+            double pps = (static_cast<double>(ops) * 1000.0) / elapsed;
+            double nsPerOp = (elapsed * 1000000.0) / ops;
+            printf("%-12s %8u %8u %12.0f %10.1f\n", parser.name, (unsigned int) i, (unsigned int) corpus[i].size(), pps, nsPerOp);
+        }
+    }
+
+    return 0;
+}
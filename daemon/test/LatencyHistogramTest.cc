@@ -0,0 +1,167 @@
+/**
+ * @file
+ * Checks and recording cost of the latency histogram behind the router metrics.
+ */
+
+/******************************************************************************
+ * Copyright 2012, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#include <qcc/platform.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <qcc/Thread.h>
+#include <qcc/time.h>
+
+#include <Status.h>
+#include "LatencyHistogram.h"
+#include "TestCheck.h"
+
+#define QCC_MODULE "ALLJOYN"
+
+using namespace qcc;
+using namespace std;
+using namespace ajn;
+
+/*
+ * Records into a histogram as fast as it can, using its own address as the key like the router
+ * uses the address of the endpoint a message came from.
+ */
+class Recorder : public Thread {
+  public:
+    Recorder(LatencyHistogram& histogram, uint32_t count) : Thread("Recorder"), histogram(histogram), count(count) { }
+
+  protected:
+    ThreadReturn STDCALL Run(void* arg)
+    {
+        for (uint32_t i = 0; i < count; ++i) {
+            histogram.Record(this, GetMicroTimestamp());
+        }
+        return 0;
+    }
+
+  private:
+    LatencyHistogram& histogram;
+    uint32_t count;
+};
+
+static uint32_t Total(const LatencyHistogram& histogram)
+{
+    uint32_t counts[LatencyHistogram::NUM_BUCKETS];
+    histogram.GetCounts(counts);
+    uint32_t total = 0;
+    for (size_t i = 0; i < LatencyHistogram::NUM_BUCKETS; ++i) {
+        total += counts[i];
+    }
+    return total;
+}
+
+static void CheckBuckets()
+{
+    CHECK(LatencyHistogram::GetBucket(0) == 0);
+    CHECK(LatencyHistogram::GetBucket(1) == 1);
+    CHECK(LatencyHistogram::GetBucket(2) == 2);
+    CHECK(LatencyHistogram::GetBucket(3) == 2);
+    CHECK(LatencyHistogram::GetBucket(1023) == 10);
+    CHECK(LatencyHistogram::GetBucket(1024) == 11);
+    CHECK(LatencyHistogram::GetBucket(0xFFFFFFFFFFULL) == LatencyHistogram::NUM_BUCKETS - 1);
+
+    /* Every latency is below the limit of its bucket and at or above the limit of the one before */
+    for (uint64_t us = 0; us < 100000; us += 7) {
+        size_t b = LatencyHistogram::GetBucket(us);
+        CHECK(us < LatencyHistogram::GetBucketLimit(b));
+        CHECK((b == 0) || (us >= LatencyHistogram::GetBucketLimit(b - 1)));
+    }
+    CHECK(LatencyHistogram::GetBucketLimit(LatencyHistogram::NUM_BUCKETS - 1) == 0xFFFFFFFF);
+}
+
+static void CheckClock()
+{
+    uint64_t start = GetMicroTimestamp();
+    qcc::Sleep(20);
+    uint64_t elapsed = GetMicroTimestamp() - start;
+    CHECK(elapsed >= 19000);
+    CHECK(elapsed < 1000000);
+
+    LatencyHistogram histogram;
+    histogram.Record(&histogram, start);
+    uint32_t counts[LatencyHistogram::NUM_BUCKETS];
+    histogram.GetCounts(counts);
+    size_t b = LatencyHistogram::GetBucket(elapsed);
+    CHECK((counts[b] == 1) || ((b + 1 < LatencyHistogram::NUM_BUCKETS) && (counts[b + 1] == 1)));
+}
+
+/* Returns wall clock nanoseconds per Record() call across all the threads */
+static double RunRecorders(LatencyHistogram& histogram, size_t numThreads, uint32_t count)
+{
+    vector<Recorder*> recorders;
+    for (size_t i = 0; i < numThreads; ++i) {
+        recorders.push_back(new Recorder(histogram, count));
+    }
+    uint64_t start = GetMicroTimestamp();
+    for (size_t i = 0; i < numThreads; ++i) {
+        recorders[i]->Start();
+    }
+    for (size_t i = 0; i < numThreads; ++i) {
+        recorders[i]->Join();
+        delete recorders[i];
+    }
+    uint64_t elapsed = GetMicroTimestamp() - start;
+    return (elapsed * 1000.0) / (count * numThreads);
+}
+
+static void usage(void)
+{
+    printf("Usage: latencyhistogramtest [-t <threads>] [-n <records per thread>]\n");
+}
+
+int main(int argc, char** argv)
+{
+    size_t numThreads = 4;
+    uint32_t count = 1000000;
+
+    for (int i = 1; i < argc; ++i) {
+        if ((0 == strcmp("-t", argv[i])) && (i + 1 < argc)) {
+            numThreads = strtoul(argv[++i], NULL, 10);
+        } else if ((0 == strcmp("-n", argv[i])) && (i + 1 < argc)) {
+            count = strtoul(argv[++i], NULL, 10);
+        } else {
+            usage();
+            exit(1);
+        }
+    }
+
+    CheckBuckets();
+    CheckClock();
+
+    LatencyHistogram histogram;
+    CHECK(Total(histogram) == 0);
+
+    double single = RunRecorders(histogram, 1, count);
+    CHECK(Total(histogram) == count);
+    printf(" 1 thread         %6.1f ns per record\n", single);
+
+    histogram.Clear();
+    CHECK(Total(histogram) == 0);
+
+    double multi = RunRecorders(histogram, numThreads, count);
+    CHECK(Total(histogram) == count * numThreads);
+    printf("%2u threads        %6.1f ns per record\n", static_cast<uint32_t>(numThreads), multi);
+
+    return CheckResult();
+}
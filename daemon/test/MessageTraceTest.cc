@@ -0,0 +1,220 @@
+/**
+ * @file
+ * Checks and recording cost of the message trace rings.
+ */
+
+/******************************************************************************
+ * Copyright 2012, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#include <qcc/platform.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <qcc/Thread.h>
+
+#include <alljoyn/BusAttachment.h>
+#include <alljoyn/Message.h>
+
+#include <Status.h>
+#include "MessageTrace.h"
+#include "TestCheck.h"
+
+#define QCC_MODULE "ALLJOYN"
+
+using namespace qcc;
+using namespace std;
+using namespace ajn;
+
+/*
+ * Takes messages through every trace point the way an rx thread and the tx thread of the
+ * destination endpoint would, except that one thread plays both parts.
+ */
+class Tracer : public Thread {
+  public:
+    Tracer(BusAttachment& bus, uint32_t count) :
+        Thread("Tracer"), bus(bus), count(count), countdown(0), rxRing(NULL), txRing(NULL), elapsed(0) { }
+
+    ~Tracer()
+    {
+        MessageTrace::ReleaseRing(rxRing);
+        MessageTrace::ReleaseRing(txRing);
+    }
+
+    uint64_t GetElapsed() const { return elapsed; }
+
+  protected:
+    ThreadReturn STDCALL Run(void* arg)
+    {
+        uint64_t start = GetMicroTimestamp();
+        for (uint32_t i = 0; i < count; ++i) {
+            Message rx(bus);
+            MessageTrace::Sample(rx, countdown, rxRing, *this);
+            MessageTrace::Trace(rx, MessageTrace::ROUTED);
+            MessageTrace::Trace(rx, MessageTrace::TX_QUEUED);
+            MessageTrace::Trace(rx, MessageTrace::TX_DEQUEUED, txRing, *this);
+            MessageTrace::Trace(rx, MessageTrace::DELIVERED, txRing, *this);
+        }
+        elapsed = GetMicroTimestamp() - start;
+        return 0;
+    }
+
+  private:
+    BusAttachment& bus;
+    uint32_t count;
+    uint32_t countdown;
+    MessageTrace::Ring* rxRing;
+    MessageTrace::Ring* txRing;
+    uint64_t elapsed;
+};
+
+/*
+ * Runs a tracer to completion and returns nanoseconds per message, including the cost of creating
+ * the message so only the differences between runs are due to tracing.
+ */
+static double RunTracer(BusAttachment& bus, uint32_t count)
+{
+    Tracer tracer(bus, count);
+    tracer.Start();
+    tracer.Join();
+    return (tracer.GetElapsed() * 1000.0) / count;
+}
+
+static size_t CountTraced()
+{
+    vector<MessageTrace::Record> records;
+    MessageTrace::Collect(records);
+    return records.size();
+}
+
+static void CheckOff(BusAttachment& bus)
+{
+    MessageTrace::SetSampleInterval(0);
+    RunTracer(bus, 100);
+    CHECK(CountTraced() == 0);
+}
+
+static void CheckStages(BusAttachment& bus)
+{
+    MessageTrace::Clear();
+    MessageTrace::SetSampleInterval(4);
+    RunTracer(bus, 100);
+
+    vector<MessageTrace::Record> records;
+    MessageTrace::Collect(records);
+    CHECK(records.size() == 25 * 5);
+
+    /* Every traced message went through the stages in order */
+    for (size_t i = 0; i + 5 <= records.size(); i += 5) {
+        for (size_t s = 0; s < 5; ++s) {
+            const MessageTrace::Record& rec = records[i + s];
+            CHECK(rec.traceId == records[i].traceId);
+            CHECK(rec.stage == static_cast<MessageTrace::Stage>(s));
+            CHECK((s == 0) || (rec.timestamp >= records[i + s - 1].timestamp));
+            CHECK(rec.thread == "Tracer");
+        }
+        CHECK((i == 0) || (records[i].traceId > records[i - 5].traceId));
+    }
+}
+
+static void CheckWrap(BusAttachment& bus)
+{
+    MessageTrace::Clear();
+    MessageTrace::SetSampleInterval(1);
+    uint32_t count = MessageTrace::Ring::RING_SIZE * 3;
+    RunTracer(bus, count);
+
+    /* The rx ring keeps the last RING_SIZE of its events, the tx ring likewise */
+    vector<MessageTrace::Record> records;
+    MessageTrace::Collect(records);
+    CHECK(records.size() == 2 * MessageTrace::Ring::RING_SIZE);
+    size_t delivered = 0;
+    for (size_t i = 0; i < records.size(); ++i) {
+        if (records[i].stage == MessageTrace::DELIVERED) {
+            ++delivered;
+        }
+    }
+    CHECK(delivered == MessageTrace::Ring::RING_SIZE / 2);
+
+    MessageTrace::Clear();
+    CHECK(CountTraced() == 0);
+}
+
+static void CheckFile(BusAttachment& bus, const char* fileName)
+{
+    MessageTrace::Clear();
+    MessageTrace::SetSampleInterval(1);
+    RunTracer(bus, 10);
+    CHECK(MessageTrace::WriteFile(fileName) == ER_OK);
+
+    FILE* f = fopen(fileName, "r");
+    CHECK(f != NULL);
+    if (f) {
+        char line[256];
+        size_t lines = 0;
+        while (fgets(line, sizeof(line), f)) {
+            CHECK((lines > 0) || (strcmp(line, "trace_id,stage,timestamp_us,thread\n") == 0));
+            ++lines;
+        }
+        fclose(f);
+        CHECK(lines == 1 + 10 * 5);
+    }
+    remove(fileName);
+}
+
+static void usage(void)
+{
+    printf("Usage: messagetracetest [-n <messages>] [-f <trace file>]\n");
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t count = 1000000;
+    const char* fileName = "messagetracetest.csv";
+
+    for (int i = 1; i < argc; ++i) {
+        if ((0 == strcmp("-n", argv[i])) && (i + 1 < argc)) {
+            count = strtoul(argv[++i], NULL, 10);
+        } else if ((0 == strcmp("-f", argv[i])) && (i + 1 < argc)) {
+            fileName = argv[++i];
+        } else {
+            usage();
+            exit(1);
+        }
+    }
+
+    BusAttachment bus("messagetracetest");
+
+    CheckOff(bus);
+    CheckStages(bus);
+    CheckWrap(bus);
+    CheckFile(bus, fileName);
+
+    MessageTrace::SetSampleInterval(0);
+    double off = RunTracer(bus, count);
+    printf("tracing off       %6.1f ns per message\n", off);
+    MessageTrace::SetSampleInterval(100);
+    double sampled = RunTracer(bus, count);
+    printf("1 in 100 traced   %6.1f ns per message\n", sampled);
+    MessageTrace::SetSampleInterval(1);
+    double all = RunTracer(bus, count);
+    printf("all traced        %6.1f ns per message\n", all);
+    MessageTrace::SetSampleInterval(0);
+    MessageTrace::Clear();
+
+    return CheckResult();
+}
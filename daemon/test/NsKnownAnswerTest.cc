@@ -0,0 +1,220 @@
+/**
+ * @file
+ * Checks that version two of the IP name service protocol keeps quiet when
+ * the asker already knows the answer, sends only the changes when names are
+ * advertised and withdrawn, and refreshes the names it has already sent.
+ */
+
+/******************************************************************************
+ * Copyright 2012, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#include <qcc/platform.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <vector>
+
+#include <qcc/Debug.h>
+#include <qcc/GUID.h>
+#include <qcc/IfConfig.h>
+#include <qcc/Mutex.h>
+#include <qcc/String.h>
+#include <qcc/Thread.h>
+
+#include <Status.h>
+#include <Callback.h>
+#include <ns/IpNameServiceImpl.h>
+#include <DaemonConfig.h>
+#include "TestCheck.h"
+
+#define QCC_MODULE "IPNS"
+
+using namespace qcc;
+using namespace std;
+using namespace ajn;
+
+static const char config[] =
+    "<busconfig>"
+    "  <ip_name_service>"
+    "    <property disable_directed_broadcast=\"false\"/>"
+    "    <property enable_ipv4=\"true\"/>"
+    "    <property enable_ipv6=\"false\"/>"
+    "  </ip_name_service>"
+    "</busconfig>";
+
+/* Remembers the most recent callback about a given daemon */
+class Finder {
+  public:
+    Finder(const qcc::String& guid) : guid(guid), called(false), timer(0) { }
+
+    void Callback(const qcc::String& busAddr, const qcc::String& from, vector<qcc::String>& wkn, uint8_t t)
+    {
+        if (from != guid) {
+            return;
+        }
+        lock.Lock();
+        called = true;
+        names = wkn;
+        timer = t;
+        lock.Unlock();
+    }
+
+    void Reset()
+    {
+        lock.Lock();
+        called = false;
+        names.clear();
+        lock.Unlock();
+    }
+
+    /* Wait for a callback with exactly the given names and a zero or non-zero timer */
+    bool WaitFor(const char* const* expected, size_t count, bool withdrawn, uint32_t ms)
+    {
+        for (uint32_t i = 0; i < ms / 10; ++i) {
+            lock.Lock();
+            bool match = called && (names.size() == count) && ((timer == 0) == withdrawn);
+            for (size_t j = 0; match && j < count; ++j) {
+                match = names[j] == expected[j];
+            }
+            lock.Unlock();
+            if (match) {
+                return true;
+            }
+            qcc::Sleep(10);
+        }
+        lock.Lock();
+        printf("called=%d names=%u timer=%u\n", called, (unsigned int) names.size(), timer);
+        lock.Unlock();
+        return false;
+    }
+
+  private:
+    qcc::String guid;
+    Mutex lock;
+    bool called;
+    vector<qcc::String> names;
+    uint8_t timer;
+};
+
+static void Setup(IpNameServiceImpl& ns, const qcc::String& guid, const IfConfigEntry& real, uint16_t port)
+{
+    CHECK(ns.Init(guid, false) == ER_OK);
+    ns.SetCriticalParameters(6, 4, IpNameServiceImpl::QUESTION_TIME, IpNameServiceImpl::QUESTION_MODULUS,
+                             IpNameServiceImpl::NUMBER_RETRIES);
+    CHECK(ns.Start() == ER_OK);
+    CHECK(ns.OpenInterface(real.m_name) == ER_OK);
+    CHECK(ns.Enable(TRANSPORT_TCP, port, port, port, port) == ER_OK);
+}
+
+int main(int argc, char** argv)
+{
+    DaemonConfig::Load(config);
+
+    /* Find a real interface we can join the multicast group on */
+    vector<IfConfigEntry> entries;
+    QStatus status = IfConfig(entries);
+    if (status != ER_OK) {
+        QCC_LogError(status, ("IfConfig failed"));
+        return 1;
+    }
+
+    const IfConfigEntry* real = NULL;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        uint32_t flags = entries[i].m_flags;
+        if ((entries[i].m_family == QCC_AF_INET) && (flags & IfConfigEntry::UP) &&
+            (flags & IfConfigEntry::MULTICAST) && !(flags & IfConfigEntry::LOOPBACK)) {
+            real = &entries[i];
+            break;
+        }
+    }
+    if (!real) {
+        printf("No multicast capable IPv4 interface, skipping\n");
+        return 0;
+    }
+    printf("Using interface %s\n", real->m_name.c_str());
+
+    srand(time(0));
+    uint16_t port = static_cast<uint16_t>(1024 + (rand() % 60000));
+
+    /* Random names so other name services on the net can't interfere */
+    qcc::String prefix = "org.test.ka" + GUID128().ToShortString() + ".";
+    qcc::String one = prefix + "one";
+    qcc::String two = prefix + "two";
+    const char* const justOne[] = { one.c_str() };
+    const char* const justTwo[] = { two.c_str() };
+    const char* const both[] = { one.c_str(), two.c_str() };
+
+    qcc::String guidA = GUID128().ToString();
+    qcc::String guidB = GUID128().ToString();
+
+    IpNameServiceImpl advertiser;
+    IpNameServiceImpl locator;
+    Finder finder(guidA);
+
+    Setup(advertiser, guidA, *real, port);
+    locator.SetCallback(new CallbackImpl<Finder, void, const qcc::String&, const qcc::String&,
+                                         vector<qcc::String>&, uint8_t>(&finder, &Finder::Callback));
+    Setup(locator, guidB, *real, port + 1);
+
+    /* A new name goes out as a delta and is reported */
+    printf("Advertise\n");
+    CHECK(advertiser.AdvertiseName(TRANSPORT_TCP, one) == ER_OK);
+    CHECK(finder.WaitFor(justOne, 1, false, 2000));
+
+    /* The first locate gets a complete answer */
+    printf("Locate\n");
+    finder.Reset();
+    CHECK(locator.Locate(prefix + "*") == ER_OK);
+    CHECK(finder.WaitFor(justOne, 1, false, 2000));
+
+    /* Asking again lists the answer we have, so the advertiser keeps quiet */
+    printf("Locate again\n");
+    qcc::Sleep(IpNameServiceImpl::ANSWER_HOLDOFF);
+    uint32_t answered, suppressed;
+    advertiser.GetAnswerStats(answered, suppressed);
+    CHECK(answered >= 1);
+    CHECK(locator.Locate(prefix + "*") == ER_OK);
+    qcc::Sleep(500);
+    uint32_t numAnswered, numSuppressed;
+    advertiser.GetAnswerStats(numAnswered, numSuppressed);
+    CHECK(numAnswered == answered);
+    CHECK(numSuppressed > suppressed);
+
+    /* Another name only sends the change */
+    printf("Advertise another\n");
+    finder.Reset();
+    CHECK(advertiser.AdvertiseName(TRANSPORT_TCP, two) == ER_OK);
+    CHECK(finder.WaitFor(justTwo, 1, false, 2000));
+
+    /* The periodic refresh carries no names but the locator reports all it holds */
+    printf("Refresh\n");
+    finder.Reset();
+    CHECK(finder.WaitFor(both, 2, false, 5000));
+
+    /* A withdrawal is reported with a zero timer */
+    printf("Cancel\n");
+    finder.Reset();
+    CHECK(advertiser.CancelAdvertiseName(TRANSPORT_TCP, one) == ER_OK);
+    CHECK(finder.WaitFor(justOne, 1, true, 2000));
+
+    locator.SetCallback(NULL);
+    locator.Stop();
+    advertiser.Stop();
+    locator.Join();
+    advertiser.Join();
+
+    return CheckResult();
+}
@@ -0,0 +1,280 @@
+/**
+ * @file
+ * Checks that the IP name service only opens and closes the sockets of
+ * interfaces that change.  Interface changes are scripted through a test
+ * InterfaceMonitor so the host network is left alone.
+ */
+
+/******************************************************************************
+ * Copyright 2012, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#include <qcc/platform.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <vector>
+
+#include <qcc/Debug.h>
+#include <qcc/Event.h>
+#include <qcc/GUID.h>
+#include <qcc/IfConfig.h>
+#include <qcc/Mutex.h>
+#include <qcc/String.h>
+#include <qcc/StringUtil.h>
+#include <qcc/Thread.h>
+#include <qcc/time.h>
+
+#include <Status.h>
+#include <ns/InterfaceMonitor.h>
+#include <ns/IpNameServiceImpl.h>
+#include <DaemonConfig.h>
+#include "TestCheck.h"
+
+#define QCC_MODULE "IPNS"
+
+using namespace qcc;
+using namespace std;
+using namespace ajn;
+
+static const char config[] =
+    "<busconfig>"
+    "  <ip_name_service>"
+    "    <property disable_directed_broadcast=\"false\"/>"
+    "    <property enable_ipv4=\"true\"/>"
+    "    <property enable_ipv6=\"false\"/>"
+    "  </ip_name_service>"
+    "</busconfig>";
+
+/* An interface monitor whose interface list and change notifications are driven by the test */
+class ScriptedInterfaceMonitor : public InterfaceMonitor {
+  public:
+    ScriptedInterfaceMonitor(bool withEvent) : withEvent(withEvent), changed(false), numQueries(0) { }
+
+    QStatus Start() { return ER_OK; }
+    void Stop() { }
+    Event* GetEvent() { return withEvent ? &event : NULL; }
+
+    bool CheckForChanges()
+    {
+        lock.Lock();
+        event.ResetEvent();
+        bool ret = changed;
+        changed = false;
+        lock.Unlock();
+        return ret;
+    }
+
+    QStatus GetInterfaces(vector<IfConfigEntry>& entries)
+    {
+        lock.Lock();
+        entries = current;
+        ++numQueries;
+        lock.Unlock();
+        return ER_OK;
+    }
+
+    /* Replace the interface list and tell the name service about it */
+    void SetInterfaces(const vector<IfConfigEntry>& entries)
+    {
+        lock.Lock();
+        current = entries;
+        changed = true;
+        event.SetEvent();
+        lock.Unlock();
+    }
+
+    /* Signal the event without changing anything, as for an unrelated netlink message */
+    void Poke()
+    {
+        lock.Lock();
+        event.SetEvent();
+        lock.Unlock();
+    }
+
+    uint32_t GetNumQueries()
+    {
+        lock.Lock();
+        uint32_t ret = numQueries;
+        lock.Unlock();
+        return ret;
+    }
+
+  private:
+    bool withEvent;
+    Event event;
+    Mutex lock;
+    vector<IfConfigEntry> current;
+    bool changed;
+    uint32_t numQueries;
+};
+
+/*
+ * Each scripted entry describes the real multicast interface under a made up address.  The name
+ * service binds to INADDR_ANY and joins the group by interface name so every entry gets a working
+ * socket, while the addresses let the test tell the entries apart.
+ */
+static IfConfigEntry MakeEntry(const IfConfigEntry& real, uint32_t n)
+{
+    IfConfigEntry entry = real;
+    entry.m_addr = "10.254.0." + U32ToString(n);
+    entry.m_prefixlen = 24;
+    return entry;
+}
+
+static bool WaitForStats(IpNameServiceImpl& ns, uint32_t live, uint32_t opened, uint32_t closed)
+{
+    uint32_t numLive = 0, numOpened = 0, numClosed = 0;
+    for (uint32_t i = 0; i < 200; ++i) {
+        ns.GetInterfaceStats(numLive, numOpened, numClosed);
+        if ((numLive == live) && (numOpened == opened) && (numClosed == closed)) {
+            return true;
+        }
+        qcc::Sleep(10);
+    }
+    printf("live=%u opened=%u closed=%u (expected %u %u %u)\n", numLive, numOpened, numClosed, live, opened, closed);
+    return false;
+}
+
+static void CheckUnchanged(IpNameServiceImpl& ns, uint32_t live, uint32_t opened, uint32_t closed)
+{
+    qcc::Sleep(200);
+    uint32_t numLive, numOpened, numClosed;
+    ns.GetInterfaceStats(numLive, numOpened, numClosed);
+    CHECK((numLive == live) && (numOpened == opened) && (numClosed == closed));
+}
+
+static void TestEventDriven(const IfConfigEntry& real, uint16_t port)
+{
+    printf("Event driven monitor\n");
+
+    ScriptedInterfaceMonitor* monitor = new ScriptedInterfaceMonitor(true);
+    vector<IfConfigEntry> entries;
+    entries.push_back(MakeEntry(real, 1));
+    entries.push_back(MakeEntry(real, 2));
+    monitor->SetInterfaces(entries);
+
+    IpNameServiceImpl ns;
+    CHECK(ns.Init(GUID128().ToString(), true) == ER_OK);
+    CHECK(ns.SetInterfaceMonitor(monitor) == ER_OK);
+    CHECK(ns.Start() == ER_OK);
+    CHECK(ns.SetInterfaceMonitor(new ScriptedInterfaceMonitor(true)) == ER_FAIL);
+    CHECK(ns.OpenInterface(real.m_name) == ER_OK);
+    CHECK(ns.Enable(TRANSPORT_TCP, port, port, port, port) == ER_OK);
+
+    /* Both interfaces come up */
+    CHECK(WaitForStats(ns, 2, 2, 0));
+
+    /* A notification that changes nothing leaves every socket alone */
+    uint32_t queries = monitor->GetNumQueries();
+    monitor->SetInterfaces(entries);
+    qcc::Sleep(200);
+    CHECK(monitor->GetNumQueries() > queries);
+    CheckUnchanged(ns, 2, 2, 0);
+
+    /* An unrelated event does not even re-read the interfaces */
+    queries = monitor->GetNumQueries();
+    monitor->Poke();
+    CheckUnchanged(ns, 2, 2, 0);
+    CHECK(monitor->GetNumQueries() == queries);
+
+    /* An MTU change is picked up without touching the socket */
+    entries[0].m_mtu -= 8;
+    monitor->SetInterfaces(entries);
+    CheckUnchanged(ns, 2, 2, 0);
+
+    /* One interface goes away and another appears: one close, one open */
+    entries.erase(entries.begin() + 1);
+    entries.push_back(MakeEntry(real, 3));
+    monitor->SetInterfaces(entries);
+    CHECK(WaitForStats(ns, 2, 3, 1));
+
+    /* An interface going down closes only its socket */
+    entries[1].m_flags &= ~IfConfigEntry::UP;
+    monitor->SetInterfaces(entries);
+    CHECK(WaitForStats(ns, 1, 3, 2));
+
+    /* Disabling closes everything and enabling brings it all back */
+    CHECK(ns.Enable(TRANSPORT_TCP, 0, 0, 0, 0) == ER_OK);
+    CHECK(WaitForStats(ns, 0, 3, 3));
+    CHECK(ns.Enable(TRANSPORT_TCP, port, port, port, port) == ER_OK);
+    CHECK(WaitForStats(ns, 1, 4, 3));
+
+    ns.Stop();
+    ns.Join();
+}
+
+static void TestPolling(const IfConfigEntry& real, uint16_t port)
+{
+    printf("Polling monitor\n");
+
+    ScriptedInterfaceMonitor* monitor = new ScriptedInterfaceMonitor(false);
+    vector<IfConfigEntry> entries;
+    entries.push_back(MakeEntry(real, 1));
+    entries.push_back(MakeEntry(real, 2));
+    monitor->SetInterfaces(entries);
+
+    IpNameServiceImpl ns;
+    CHECK(ns.Init(GUID128().ToString(), true) == ER_OK);
+    CHECK(ns.SetInterfaceMonitor(monitor) == ER_OK);
+    CHECK(ns.Start() == ER_OK);
+    CHECK(ns.OpenInterface(real.m_name) == ER_OK);
+    CHECK(ns.Enable(TRANSPORT_TCP, port, port, port, port) == ER_OK);
+    CHECK(WaitForStats(ns, 2, 2, 0));
+
+    /* Without notifications a forced lazy update has to rebuild every socket */
+    CHECK(ns.Enable(TRANSPORT_TCP, port, port, port, port) == ER_OK);
+    CHECK(WaitForStats(ns, 2, 4, 2));
+
+    ns.Stop();
+    ns.Join();
+}
+
+int main(int argc, char** argv)
+{
+    DaemonConfig::Load(config);
+
+    /* Find a real interface we can join the multicast group on */
+    vector<IfConfigEntry> entries;
+    QStatus status = IfConfig(entries);
+    if (status != ER_OK) {
+        QCC_LogError(status, ("IfConfig failed"));
+        return 1;
+    }
+
+    const IfConfigEntry* real = NULL;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        uint32_t flags = entries[i].m_flags;
+        if ((entries[i].m_family == QCC_AF_INET) && (flags & IfConfigEntry::UP) &&
+            (flags & IfConfigEntry::MULTICAST) && !(flags & IfConfigEntry::LOOPBACK)) {
+            real = &entries[i];
+            break;
+        }
+    }
+    if (!real) {
+        printf("No multicast capable IPv4 interface, skipping\n");
+        return 0;
+    }
+    printf("Using interface %s\n", real->m_name.c_str());
+
+    srand(time(0));
+    uint16_t port = static_cast<uint16_t>(1024 + (rand() % 60000));
+
+    TestEventDriven(*real, port);
+    TestPolling(*real, port);
+
+    return CheckResult();
+}
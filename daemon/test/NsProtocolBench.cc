@@ -0,0 +1,402 @@
+/**
+ * @file
+ * Fuzz and throughput harness for the IP name service message parsers.  The
+ * in-place HeaderView parser is checked against Header::Deserialize() on
+ * mutated packets and both are timed on a corpus of typical messages or on
+ * packets captured from a live network.
+ */
+
+/******************************************************************************
+ * Copyright 2012, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#include <qcc/platform.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <qcc/String.h>
+#include <qcc/StringUtil.h>
+#include <qcc/Util.h>
+#include <alljoyn/version.h>
+
+#include <ns/IpNsProtocol.h>
+#include <ns/IpNameServiceImpl.h>
+
+#include "BenchUtil.h"
+
+#define QCC_MODULE "IPNS"
+
+using namespace qcc;
+using namespace std;
+using namespace ajn;
+
+typedef vector<uint8_t> Packet;
+
+static const char* g_guids[] = {
+    "0f3c1a5e8b2d4c7f9a6e1d3b5c7a9e2f", "1e2d3c4b5a69788796a5b4c3d2e1f001", "2a4c6e8f1b3d5f7092a4b6c8d0e2f416",
+    "3b5d7f91a3c5e7092b4d6f81a3c5e709", "4c6e80a2c4e60820c4e6082a4c6e8a0c", "5d7f91b3d5f7193bd5f7193b5d7f9b1d",
+    "6e80a2c4e6082a4ce6082a4c6e80ac2e", "7f91b3d5f7193b5df7193b5d7f91bd3f"
+};
+
+static const size_t NUM_GUIDS = sizeof(g_guids) / sizeof(g_guids[0]);
+
+static void AddEndpoints(IsAt& isAt)
+{
+    isAt.SetReliableIPv4("192.168.1.20", 9955);
+    isAt.SetUnreliableIPv4("192.168.1.20", 9955);
+    isAt.SetReliableIPv6("fe80::21b:21ff:fe3c:4d5e", 9955);
+}
+
+static Packet Serialize(Header& header)
+{
+    Packet packet(header.GetSerializedSize());
+    header.Serialize(&packet[0]);
+    return packet;
+}
+
+/* Messages a daemon typically hears: questions with their down-version copies, deltas, refreshes and full lists */
+static void BuildCorpus(vector<Packet>& corpus)
+{
+    for (uint32_t v = 0; v <= 2; ++v) {
+        WhoHas whoHas;
+        whoHas.SetVersion(v, v);
+        whoHas.AddName("org.alljoyn.About.*");
+        if (v == 2) {
+            for (size_t i = 0; i < NUM_GUIDS; ++i) {
+                whoHas.AddKnownAnswer(g_guids[i], static_cast<uint16_t>(i * 7));
+            }
+        }
+        Header header;
+        header.SetVersion(v, v);
+        header.SetTimer(IpNameServiceImpl::DEFAULT_DURATION);
+        header.AddQuestion(whoHas);
+        corpus.push_back(Serialize(header));
+    }
+
+    for (uint32_t v = 0; v <= 2; ++v) {
+        for (uint32_t n = 0; n <= 20; n += (n ? 19 : 1)) {
+            IsAt isAt;
+            isAt.SetVersion(v, v);
+            isAt.SetGuid(g_guids[n % NUM_GUIDS]);
+            if (v == 0) {
+                isAt.SetTcpFlag(true);
+                isAt.SetUdpFlag(true);
+                isAt.SetPort(9955);
+                isAt.SetIPv4("192.168.1.20");
+            } else {
+                isAt.SetTransportMask(TRANSPORT_TCP);
+                AddEndpoints(isAt);
+            }
+            isAt.SetGeneration(static_cast<uint16_t>(0x1234 + n));
+            isAt.SetCompleteFlag(n == 20);
+            for (uint32_t i = 0; i < n; ++i) {
+                isAt.AddName("org.alljoyn.sample.service" + U32ToString(i) + ".instance");
+            }
+            if (v < 2 && n == 0) {
+                continue;
+            }
+            Header header;
+            header.SetVersion(v, v);
+            header.SetTimer(IpNameServiceImpl::DEFAULT_DURATION);
+            header.AddAnswer(isAt);
+            corpus.push_back(Serialize(header));
+        }
+    }
+}
+
+/* Captures are a sequence of UDP payloads, each preceded by its length as two octets in network byte order */
+static bool LoadCapture(const char* fileName, vector<Packet>& corpus)
+{
+    FILE* fp = fopen(fileName, "rb");
+    if (!fp) {
+        printf("Unable to open %s\n", fileName);
+        return false;
+    }
+    uint8_t len[2];
+    while (fread(len, 1, 2, fp) == 2) {
+        Packet packet((len[0] << 8) | len[1]);
+        if (packet.size() && (fread(&packet[0], 1, packet.size(), fp) != packet.size())) {
+            printf("Truncated capture %s\n", fileName);
+            fclose(fp);
+            return false;
+        }
+        corpus.push_back(packet);
+    }
+    fclose(fp);
+    return true;
+}
+
+static bool WriteCapture(const char* fileName, const vector<Packet>& corpus)
+{
+    FILE* fp = fopen(fileName, "wb");
+    if (!fp) {
+        printf("Unable to create %s\n", fileName);
+        return false;
+    }
+    for (size_t i = 0; i < corpus.size(); ++i) {
+        uint8_t len[2] = { static_cast<uint8_t>(corpus[i].size() >> 8), static_cast<uint8_t>(corpus[i].size()) };
+        fwrite(len, 1, 2, fp);
+        fwrite(&corpus[i][0], 1, corpus[i].size(), fp);
+    }
+    fclose(fp);
+    return true;
+}
+
+/* Check that the view and the objects agree on whether a packet is valid and on everything in it */
+static bool Compare(const uint8_t* buf, size_t len)
+{
+    Header header;
+    HeaderView view;
+    size_t size = header.Deserialize(buf, len);
+    if (view.Parse(buf, len) != size) {
+        printf("Parse() and Deserialize() disagree on the size (%u)\n", (unsigned int) size);
+        return false;
+    }
+    if (size == 0) {
+        return true;
+    }
+
+    uint32_t nsVersion, msgVersion, viewNsVersion, viewMsgVersion;
+    header.GetVersion(nsVersion, msgVersion);
+    view.GetVersion(viewNsVersion, viewMsgVersion);
+    if ((nsVersion != viewNsVersion) || (msgVersion != viewMsgVersion) || (header.GetTimer() != view.GetTimer()) ||
+        (header.GetNumberQuestions() != view.GetNumberQuestions()) || (header.GetNumberAnswers() != view.GetNumberAnswers())) {
+        printf("Header fields differ\n");
+        return false;
+    }
+
+    for (uint32_t i = 0; i < view.GetNumberQuestions(); ++i) {
+        WhoHas* whoHas;
+        header.GetQuestion(i, &whoHas);
+        WhoHasView question;
+        view.GetQuestion(i, question);
+        if ((whoHas->GetNumberNames() != question.GetNumberNames()) ||
+            (whoHas->GetNumberKnownAnswers() != question.GetNumberKnownAnswers())) {
+            printf("Question %u counts differ\n", i);
+            return false;
+        }
+        for (uint32_t j = 0; j < question.GetNumberNames(); ++j) {
+            if (!question.GetName(j).Equals(whoHas->GetName(j))) {
+                printf("Question %u name %u differs\n", i, j);
+                return false;
+            }
+        }
+        for (uint32_t j = 0; j < whoHas->GetNumberKnownAnswers(); ++j) {
+            qcc::String guid;
+            uint16_t generation;
+            whoHas->GetKnownAnswer(j, guid, generation);
+            if (!question.IsKnownAnswer(guid, generation)) {
+                printf("Question %u known answer %u missing\n", i, j);
+                return false;
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < view.GetNumberAnswers(); ++i) {
+        IsAt* isAt;
+        header.GetAnswer(i, &isAt);
+        IsAtView answer;
+        view.GetAnswer(i, answer);
+        if ((isAt->GetNumberNames() != answer.GetNumberNames()) || (isAt->GetCompleteFlag() != answer.GetCompleteFlag()) ||
+            (isAt->GetGeneration() != answer.GetGeneration()) || (isAt->GetTransportMask(0) != answer.GetTransportMask()) ||
+            (isAt->GetGuidFlag() && !answer.GetGuid().Equals(isAt->GetGuid()))) {
+            printf("Answer %u fields differ\n", i);
+            return false;
+        }
+        for (uint32_t j = 0; j < answer.GetNumberNames(); ++j) {
+            if (!answer.GetName(j).Equals(isAt->GetName(j))) {
+                printf("Answer %u name %u differs\n", i, j);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static void Mutate(Packet& packet)
+{
+    switch (Rand32() % 4) {
+    case 0:
+        if (packet.size()) {
+            packet[Rand32() % packet.size()] ^= static_cast<uint8_t>(1 << (Rand32() % 8));
+        }
+        break;
+
+    case 1:
+        if (packet.size()) {
+            packet[Rand32() % packet.size()] = static_cast<uint8_t>(Rand32());
+        }
+        break;
+
+    case 2:
+        packet.resize(packet.size() ? Rand32() % packet.size() : 0);
+        break;
+
+    default:
+        packet.push_back(static_cast<uint8_t>(Rand32()));
+        break;
+    }
+}
+
+static bool CheckMutated(Packet& packet, bool& accepted)
+{
+    const uint8_t* buf = packet.size() ? &packet[0] : NULL;
+    if (!Compare(buf, packet.size())) {
+        return false;
+    }
+    HeaderView view;
+    accepted = view.Parse(buf, packet.size()) ? true : false;
+    return true;
+}
+
+/* What the name service does with every packet it hears, the old way and the new */
+static uint32_t RunDeserialize(const Packet& packet)
+{
+    Header header;
+    uint32_t sum = header.Deserialize(&packet[0], packet.size());
+    for (uint32_t i = 0; i < header.GetNumberAnswers(); ++i) {
+        IsAt* isAt;
+        header.GetAnswer(i, &isAt);
+        for (uint32_t j = 0; j < isAt->GetNumberNames(); ++j) {
+            sum += isAt->GetName(j).size();
+        }
+    }
+    return sum;
+}
+
+static uint32_t RunView(const Packet& packet)
+{
+    HeaderView view;
+    uint32_t sum = view.Parse(&packet[0], packet.size());
+    for (uint32_t i = 0; i < view.GetNumberAnswers(); ++i) {
+        IsAtView isAt;
+        view.GetAnswer(i, isAt);
+        for (uint32_t j = 0; j < isAt.GetNumberNames(); ++j) {
+            sum += isAt.GetName(j).GetSize();
+        }
+    }
+    return sum;
+}
+
+struct Parser {
+    const char* name;
+    uint32_t (*run)(const Packet& packet);
+};
+
+static const Parser g_parsers[] = {
+    { "deserialize", RunDeserialize },
+    { "view",        RunView        }
+};
+
+static const size_t NUM_PARSERS = sizeof(g_parsers) / sizeof(g_parsers[0]);
+
+/* One timed operation: parse a packet with a parser */
+struct RunParser {
+    RunParser(const Parser& parser, const Packet& packet) : parser(parser), packet(packet) { }
+    uint32_t operator()() const { return parser.run(packet); }
+    const Parser& parser;
+    const Packet& packet;
+};
+
+static void usage(void)
+{
+    printf("Usage: nsprotocolbench [-h] [-c <capture>] [-w <capture>] [-f <iterations>] [-t <ms>]\n\n");
+    printf("Options:\n");
+    printf("   -h               - Print this help message\n");
+    printf("   -c <capture>     - Use the packets in a capture file instead of the built in ones\n");
+    printf("   -w <capture>     - Write the built in packets to a capture file and exit\n");
+    printf("   -f <iterations>  - Number of mutated packets to check (default 100000)\n");
+    printf("   -t <ms>          - Time spent on each parser and packet (default 250)\n");
+    printf("\n");
+    printf("A capture file holds UDP payloads, each preceded by its length in two octets\n");
+    printf("in network byte order.\n");
+    printf("\n");
+}
+
+int main(int argc, char** argv)
+{
+    const char* captureName = NULL;
+    const char* writeName = NULL;
+    uint32_t iterations = 100000;
+
+    printf("AllJoyn Library version: %s\n", ajn::GetVersion());
+    printf("AllJoyn Library build info: %s\n", ajn::GetBuildInfo());
+
+    /* Parse command line args */
+    for (int i = 1; i < argc; ++i) {
+        if (::strcmp("-h", argv[i]) == 0) {
+            usage();
+            exit(0);
+        } else if ((::strcmp("-c", argv[i]) == 0) && ((i + 1) < argc)) {
+            captureName = argv[++i];
+        } else if ((::strcmp("-w", argv[i]) == 0) && ((i + 1) < argc)) {
+            writeName = argv[++i];
+        } else if ((::strcmp("-f", argv[i]) == 0) && ((i + 1) < argc)) {
+            iterations = StringToU32(argv[++i], 10, 100000);
+        } else if ((::strcmp("-t", argv[i]) == 0) && ((i + 1) < argc)) {
+            g_runMs = StringToU32(argv[++i], 10, 250);
+        } else {
+            printf("Unknown option %s\n", argv[i]);
+            usage();
+            exit(1);
+        }
+    }
+
+    vector<Packet> corpus;
+    if (captureName) {
+        if (!LoadCapture(captureName, corpus)) {
+            return 1;
+        }
+    } else {
+        BuildCorpus(corpus);
+    }
+    if (writeName) {
+        return WriteCapture(writeName, corpus) ? 0 : 1;
+    }
+    if (corpus.empty()) {
+        printf("No packets\n");
+        return 1;
+    }
+
+    /* Every packet must parse the same way both ways before we bother timing anything */
+    for (size_t i = 0; i < corpus.size(); ++i) {
+        if (!Compare(corpus[i].size() ? &corpus[i][0] : NULL, corpus[i].size())) {
+            printf("Packet %u parses differently\n", (unsigned int) i);
+            return 1;
+        }
+    }
+    if (!Fuzz(corpus, iterations, "packet", Mutate, CheckMutated)) {
+        return 1;
+    }
+
+    printf("%-12s %8s %8s %12s %10s\n", "parser", "packet", "size", "packets/s", "ns/op");
+    for (size_t p = 0; p < NUM_PARSERS; ++p) {
+        const Parser& parser = g_parsers[p];
+        for (size_t i = 0; i < corpus.size(); ++i) {
+            if (corpus[i].empty()) {
+                continue;
+            }
+            uint64_t elapsed;
+            uint64_t ops = RunTimed(RunParser(parser, corpus[i]), elapsed);
+            double pps = (static_cast<double>(ops) * 1000.0) / elapsed;
+            double nsPerOp = (elapsed * 1000000.0) / ops;
+            printf("%-12s %8u %8u %12.0f %10.1f\n", parser.name, (unsigned int) i, (unsigned int) corpus[i].size(), pps, nsPerOp);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,359 @@
+/**
+ * @file
+ * PacketEngine benchmark over simulated lossy links
+ */
+
+/******************************************************************************
+ * Copyright 2012, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#include <qcc/platform.h>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include <qcc/Debug.h>
+#include <qcc/Event.h>
+#include <qcc/Mutex.h>
+#include <qcc/String.h>
+#include <qcc/StringUtil.h>
+#include <qcc/Thread.h>
+#include <qcc/time.h>
+#include <alljoyn/version.h>
+
+#include "BenchUtil.h"
+#include "PacketEngine.h"
+#include "SimPacketStream.h"
+
+#define QCC_MODULE "PACKET"
+
+using namespace qcc;
+using namespace std;
+using namespace ajn;
+
+/*
+ * Link profiles. Both directions of a link use the same profile so acks are impaired as well.
+ *
+ *   name, latency, jitter, loss, reorder, reorder delay, dup, bandwidth (kbps), queue (bytes)
+ */
+static const SimLinkProfile g_profiles[] = {
+    { "ideal",     0,   0,  0.0,   0.0,  0,  0.0,  0,      0          },
+    { "lan",       1,   0,  0.0,   0.0,  0,  0.0,  100000, 256 * 1024 },
+    { "wifi",      5,   3,  0.01,  0.01, 5,  0.0,  20000,  64 * 1024  },
+    { "lossy",     20,  2,  0.05,  0.0,  0,  0.0,  10000,  64 * 1024  },
+    { "congested", 30,  5,  0.0,   0.0,  0,  0.0,  2000,   32 * 1024  },
+    { "reorder",   20,  10, 0.01,  0.05, 15, 0.02, 10000,  64 * 1024  },
+    { "satellite", 300, 10, 0.005, 0.0,  0,  0.0,  5000,   256 * 1024 }
+};
+
+static const size_t NUM_PROFILES = sizeof(g_profiles) / sizeof(g_profiles[0]);
+
+static uint64_t g_seed = 1;
+static size_t g_totalBytes = 1024 * 1024;
+static size_t g_msgSize = 1024;
+static uint32_t g_runTimeout = 60000;
+
+/* Result of a single transfer */
+struct BenchResult {
+    QStatus status;
+    size_t bytes;
+    uint64_t elapsedMs;
+    SimLinkStats tx;
+    vector<uint32_t> latencies;
+};
+
+/**
+ * Accepts the benchmark channel on the receiving side and signals connect completion on the
+ * sending side.
+ */
+class BenchListener : public PacketEngineListener {
+  public:
+    BenchListener() : connectStatus(ER_TIMEOUT) { }
+
+    void PacketEngineConnectCB(PacketEngine& engine, QStatus status, const PacketEngineStream* stream, const PacketDest& dest, void* context)
+    {
+        lock.Lock();
+        connectStatus = status;
+        if (status == ER_OK) {
+            this->stream = *stream;
+        }
+        lock.Unlock();
+        connected.SetEvent();
+    }
+
+    bool PacketEngineAcceptCB(PacketEngine& engine, const PacketEngineStream& stream, const PacketDest& dest)
+    {
+        lock.Lock();
+        connectStatus = ER_OK;
+        this->stream = stream;
+        lock.Unlock();
+        connected.SetEvent();
+        return true;
+    }
+
+    void PacketEngineDisconnectCB(PacketEngine& engine, const PacketEngineStream& stream, const PacketDest& dest)
+    {
+    }
+
+    QStatus WaitForStream(PacketEngineStream& stream, uint32_t timeout)
+    {
+        QStatus status = Event::Wait(connected, timeout);
+        lock.Lock();
+        if (status == ER_OK) {
+            status = connectStatus;
+            stream = this->stream;
+        }
+        lock.Unlock();
+        return status;
+    }
+
+  private:
+    Mutex lock;
+    Event connected;
+    QStatus connectStatus;
+    PacketEngineStream stream;
+};
+
+/**
+ * Pulls fixed size messages from a stream and records the one way latency of each message. The
+ * first 8 bytes of each message hold the timestamp at which the message was pushed.
+ */
+class Receiver : public Thread {
+  public:
+    Receiver(BenchListener& listener, size_t numMsgs, vector<uint32_t>& latencies) :
+        Thread("PacketBench-rx"), listener(listener), numMsgs(numMsgs), latencies(latencies), status(ER_OK), doneTs(0) { }
+
+    QStatus GetStatus() const { return status; }
+    uint64_t GetDoneTs() const { return doneTs; }
+
+  protected:
+    ThreadReturn STDCALL Run(void* arg)
+    {
+        PacketEngineStream stream;
+        status = listener.WaitForStream(stream, g_runTimeout);
+        vector<uint8_t> buf(g_msgSize);
+        uint64_t deadline = GetTimestamp64() + g_runTimeout;
+        size_t offset = 0;
+        while ((status == ER_OK) && (latencies.size() < numMsgs) && !IsStopping()) {
+            size_t actual = 0;
+            status = stream.PullBytes(&buf[offset], g_msgSize - offset, actual, 1000);
+            if (status == ER_TIMEOUT) {
+                status = (GetTimestamp64() < deadline) ? ER_OK : ER_TIMEOUT;
+                continue;
+            }
+            offset += actual;
+            if ((status == ER_OK) && (offset == g_msgSize)) {
+                uint64_t sendTs;
+                ::memcpy(&sendTs, &buf[0], sizeof(sendTs));
+                latencies.push_back(static_cast<uint32_t>(GetTimestamp64() - sendTs));
+                offset = 0;
+            }
+        }
+        doneTs = GetTimestamp64();
+        return 0;
+    }
+
+  private:
+    BenchListener& listener;
+    size_t numMsgs;
+    vector<uint32_t>& latencies;
+    QStatus status;
+    uint64_t doneTs;
+};
+
+static QStatus Transfer(PacketEngineStream& stream, size_t numMsgs)
+{
+    vector<uint8_t> msg(g_msgSize);
+    for (size_t i = sizeof(uint64_t); i < g_msgSize; ++i) {
+        msg[i] = 'A' + (i % 52);
+    }
+    QStatus status = ER_OK;
+    for (size_t i = 0; (status == ER_OK) && (i < numMsgs); ++i) {
+        uint64_t now = GetTimestamp64();
+        ::memcpy(&msg[0], &now, sizeof(now));
+        size_t sent = 0;
+        status = stream.PushBytes(&msg[0], g_msgSize, sent);
+        if ((status == ER_OK) && (sent != g_msgSize)) {
+            status = ER_FAIL;
+        }
+    }
+    return status;
+}
+
+static BenchResult RunOne(const SimLinkProfile& profile, CongestionControl::Type cc)
+{
+    BenchResult result;
+    size_t numMsgs = g_totalBytes / g_msgSize;
+    result.status = ER_OK;
+    result.bytes = numMsgs * g_msgSize;
+    result.elapsedMs = 0;
+
+    SimPacketStream streamA("10.0.0.1", 9955, profile, g_seed);
+    SimPacketStream streamB("10.0.0.2", 9955, profile, g_seed + 1);
+    SimPacketStream::Connect(streamA, streamB);
+
+    PacketEngine engineA("bench-a");
+    PacketEngine engineB("bench-b");
+    engineA.SetCongestionControl(cc);
+    engineB.SetCongestionControl(cc);
+    BenchListener listenerA, listenerB;
+
+    streamA.Start();
+    streamB.Start();
+    engineA.AddPacketStream(streamA, listenerA);
+    engineB.AddPacketStream(streamB, listenerB);
+    engineA.Start(streamA.GetSinkMTU());
+    engineB.Start(streamB.GetSinkMTU());
+
+    Receiver receiver(listenerB, numMsgs, result.latencies);
+    receiver.Start();
+
+    PacketEngineStream stream;
+    uint64_t startTs = GetTimestamp64();
+    result.status = engineA.Connect(streamB.GetLocalDest(), streamA, listenerA, NULL);
+    if (result.status == ER_OK) {
+        result.status = listenerA.WaitForStream(stream, g_runTimeout);
+    }
+    if (result.status == ER_OK) {
+        stream.SetSendTimeout(g_runTimeout);
+        startTs = GetTimestamp64();
+        result.status = Transfer(stream, numMsgs);
+    }
+    if (result.status != ER_OK) {
+        receiver.Stop();
+    }
+    receiver.Join();
+    if (result.status == ER_OK) {
+        result.status = receiver.GetStatus();
+    }
+    result.elapsedMs = receiver.GetDoneTs() - startTs;
+    result.tx = streamA.GetStats();
+
+    if (result.status == ER_OK) {
+        engineA.Disconnect(stream);
+    }
+    engineA.Stop();
+    engineB.Stop();
+    engineA.Join();
+    engineB.Join();
+    streamA.Stop();
+    streamB.Stop();
+    return result;
+}
+
+static void Report(const SimLinkProfile& profile, CongestionControl::Type cc, BenchResult& r)
+{
+    const char* ccName = (cc == CongestionControl::DELAY) ? "delay" : "cubic";
+    if (r.status != ER_OK) {
+        printf("%-10s %-6s  FAILED: %s (%u of %u msgs)\n", profile.name, ccName, QCC_StatusText(r.status),
+               (unsigned int) r.latencies.size(), (unsigned int) (r.bytes / g_msgSize));
+        return;
+    }
+    sort(r.latencies.begin(), r.latencies.end());
+    double goodputKbps = r.elapsedMs ? (r.bytes * 8.0 / r.elapsedMs) : 0.0;
+    double retransmitPct = r.tx.dataPackets ? (100.0 * r.tx.dataRetransmits / r.tx.dataPackets) : 0.0;
+    printf("%-10s %-6s %10.0f %7.2f%% %8u %8u %8u %8u %8u\n",
+           profile.name, ccName, goodputKbps, retransmitPct,
+           Percentile(r.latencies, 500), Percentile(r.latencies, 900), Percentile(r.latencies, 990),
+           Percentile(r.latencies, 999), r.latencies.empty() ? 0 : r.latencies.back());
+}
+
+static void usage(void)
+{
+    printf("Usage: packetbench [-h] [-s <seed>] [-n <bytes>] [-m <msg_size>] [-p <profile>] [-c <cc>] [-t <ms>]\n\n");
+    printf("Options:\n");
+    printf("   -h            - Print this help message\n");
+    printf("   -s <seed>     - Seed for the link impairments (default 1)\n");
+    printf("   -n <bytes>    - Number of bytes to transfer per run (default 1048576)\n");
+    printf("   -m <size>     - Message size in bytes (default 1024)\n");
+    printf("   -p <profile>  - Only run the named link profile\n");
+    printf("   -c <cc>       - Only run the named congestion control algorithm (cubic or delay)\n");
+    printf("   -t <ms>       - Give up on a run after this many ms (default 60000)\n");
+    printf("\n");
+    printf("Profiles:\n");
+    for (size_t i = 0; i < NUM_PROFILES; ++i) {
+        const SimLinkProfile& p = g_profiles[i];
+        printf("   %-10s latency=%ums jitter=%ums loss=%.1f%% reorder=%.1f%% dup=%.1f%% rate=%ukbps queue=%uB\n",
+               p.name, p.latencyMs, p.jitterMs, p.lossRate * 100.0, p.reorderRate * 100.0, p.dupRate * 100.0,
+               p.bandwidthKbps, p.queueBytes);
+    }
+    printf("\n");
+}
+
+int main(int argc, char** argv)
+{
+    const char* profileName = NULL;
+    const char* ccName = NULL;
+
+    printf("AllJoyn Library version: %s\n", ajn::GetVersion());
+    printf("AllJoyn Library build info: %s\n", ajn::GetBuildInfo());
+
+    /* Parse command line args */
+    for (int i = 1; i < argc; ++i) {
+        if (::strcmp("-h", argv[i]) == 0) {
+            usage();
+            exit(0);
+        } else if ((::strcmp("-s", argv[i]) == 0) && ((i + 1) < argc)) {
+            g_seed = StringToU64(argv[++i], 10, 1);
+        } else if ((::strcmp("-n", argv[i]) == 0) && ((i + 1) < argc)) {
+            g_totalBytes = StringToU32(argv[++i], 10, 0);
+        } else if ((::strcmp("-m", argv[i]) == 0) && ((i + 1) < argc)) {
+            g_msgSize = StringToU32(argv[++i], 10, 0);
+        } else if ((::strcmp("-p", argv[i]) == 0) && ((i + 1) < argc)) {
+            profileName = argv[++i];
+        } else if ((::strcmp("-c", argv[i]) == 0) && ((i + 1) < argc)) {
+            ccName = argv[++i];
+        } else if ((::strcmp("-t", argv[i]) == 0) && ((i + 1) < argc)) {
+            g_runTimeout = StringToU32(argv[++i], 10, 0);
+        } else {
+            printf("Unknown option %s\n", argv[i]);
+            usage();
+            exit(1);
+        }
+    }
+    if ((g_msgSize < sizeof(uint64_t)) || (g_totalBytes < g_msgSize) || (g_runTimeout == 0)) {
+        printf("Invalid message size, byte count or timeout\n");
+        usage();
+        exit(1);
+    }
+
+    printf("\nseed=%llu bytes=%u msg_size=%u\n\n", (unsigned long long) g_seed, (unsigned int) g_totalBytes, (unsigned int) g_msgSize);
+    printf("%-10s %-6s %10s %8s %8s %8s %8s %8s %8s\n", "profile", "cc", "kbps", "retx", "p50ms", "p90ms", "p99ms", "p999ms", "maxms");
+
+    int ret = 0;
+    bool ranAny = false;
+    for (size_t i = 0; i < NUM_PROFILES; ++i) {
+        if (profileName && (::strcmp(profileName, g_profiles[i].name) != 0)) {
+            continue;
+        }
+        for (int c = 0; c < 2; ++c) {
+            CongestionControl::Type cc = (c == 0) ? CongestionControl::CUBIC : CongestionControl::DELAY;
+            if (ccName && (::strcmp(ccName, (cc == CongestionControl::DELAY) ? "delay" : "cubic") != 0)) {
+                continue;
+            }
+            BenchResult r = RunOne(g_profiles[i], cc);
+            Report(g_profiles[i], cc, r);
+            ranAny = true;
+            if (r.status != ER_OK) {
+                ret = 1;
+            }
+        }
+    }
+    if (!ranAny) {
+        printf("No matching profile or congestion control algorithm\n");
+        ret = 1;
+    }
+    return ret;
+}
@@ -0,0 +1,334 @@
+/**
+ * @file
+ * Checks PacketEngine channel lookups while other channels are opened and closed.
+ */
+
+/******************************************************************************
+ * Copyright 2012, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#include <qcc/platform.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <vector>
+
+#include <qcc/Debug.h>
+#include <qcc/Event.h>
+#include <qcc/Mutex.h>
+#include <qcc/StringUtil.h>
+#include <qcc/Thread.h>
+#include <qcc/atomic.h>
+#include <qcc/time.h>
+
+#include <Status.h>
+
+#include "PacketEngine.h"
+#include "SimPacketStream.h"
+#include "TestCheck.h"
+
+#define QCC_MODULE "PACKET"
+
+using namespace qcc;
+using namespace std;
+using namespace ajn;
+
+static const SimLinkProfile g_ideal = { "ideal", 0, 0, 0.0, 0.0, 0, 0.0, 0, 0 };
+
+static const uint32_t Timeout = 10000;
+
+/* Size of the messages pushed over the long lived channels */
+static const size_t MsgSize = 64;
+
+/**
+ * Hands the result of a Connect to the caller that is waiting for it.
+ */
+struct PendingConnect {
+    Event done;
+    QStatus status;
+    PacketEngineStream stream;
+};
+
+class ChurnListener : public PacketEngineListener {
+  public:
+    ChurnListener() : keepAccepted(false), numDisconnected(0) { }
+
+    void PacketEngineConnectCB(PacketEngine& engine, QStatus status, const PacketEngineStream* stream, const PacketDest& dest, void* context)
+    {
+        PendingConnect* pending = static_cast<PendingConnect*>(context);
+        pending->status = status;
+        if (status == ER_OK) {
+            pending->stream = *stream;
+        }
+        pending->done.SetEvent();
+    }
+
+    bool PacketEngineAcceptCB(PacketEngine& engine, const PacketEngineStream& stream, const PacketDest& dest)
+    {
+        lock.Lock();
+        if (keepAccepted) {
+            accepted.push_back(stream);
+            acceptEvent.SetEvent();
+        }
+        lock.Unlock();
+        return true;
+    }
+
+    void PacketEngineDisconnectCB(PacketEngine& engine, const PacketEngineStream& stream, const PacketDest& dest)
+    {
+        IncrementAndFetch(&numDisconnected);
+    }
+
+    /* Accepted streams are only kept while the long lived channels are set up */
+    void KeepAccepted(bool keep)
+    {
+        lock.Lock();
+        keepAccepted = keep;
+        lock.Unlock();
+    }
+
+    QStatus PopAccepted(PacketEngineStream& stream)
+    {
+        uint64_t deadline = GetTimestamp64() + Timeout;
+        lock.Lock();
+        while (accepted.empty() && (GetTimestamp64() < deadline)) {
+            acceptEvent.ResetEvent();
+            lock.Unlock();
+            Event::Wait(acceptEvent, 100);
+            lock.Lock();
+        }
+        QStatus status = accepted.empty() ? ER_TIMEOUT : ER_OK;
+        if (status == ER_OK) {
+            stream = accepted.front();
+            accepted.pop_front();
+        }
+        lock.Unlock();
+        return status;
+    }
+
+    int32_t GetNumDisconnected() const { return numDisconnected; }
+
+  private:
+    Mutex lock;
+    Event acceptEvent;
+    bool keepAccepted;
+    deque<PacketEngineStream> accepted;
+    volatile int32_t numDisconnected;
+};
+
+static QStatus Open(PacketEngine& engine, SimPacketStream& local, SimPacketStream& remote, ChurnListener& listener, PacketEngineStream& stream)
+{
+    PendingConnect* pending = new PendingConnect;
+    QStatus status = engine.Connect(remote.GetLocalDest(), local, listener, pending);
+    if (status == ER_OK) {
+        status = Event::Wait(pending->done, Timeout);
+        if (status == ER_OK) {
+            status = pending->status;
+            stream = pending->stream;
+        } else {
+            /* The connect callback may still come so the pending connect is leaked */
+            return status;
+        }
+    }
+    delete pending;
+    return status;
+}
+
+/*
+ * Pushes numbered messages over a long lived channel. Every packet and ack of the channel is
+ * looked up in the channel table of the receiving engine.
+ */
+class Pusher : public Thread {
+  public:
+    Pusher(PacketEngineStream& stream, uint32_t count) : Thread("Pusher"), stream(stream), count(count), status(ER_OK) { }
+
+    QStatus GetStatus() const { return status; }
+
+  protected:
+    ThreadReturn STDCALL Run(void* arg)
+    {
+        uint8_t msg[MsgSize];
+        ::memset(msg, 0, sizeof(msg));
+        stream.SetSendTimeout(Timeout);
+        for (uint32_t i = 0; (status == ER_OK) && (i < count); ++i) {
+            ::memcpy(msg, &i, sizeof(i));
+            size_t sent = 0;
+            status = stream.PushBytes(msg, sizeof(msg), sent);
+            if ((status == ER_OK) && (sent != sizeof(msg))) {
+                status = ER_FAIL;
+            }
+        }
+        return 0;
+    }
+
+  private:
+    PacketEngineStream& stream;
+    uint32_t count;
+    QStatus status;
+};
+
+class Puller : public Thread {
+  public:
+    Puller(PacketEngineStream& stream, uint32_t count) : Thread("Puller"), stream(stream), count(count), received(0), status(ER_OK) { }
+
+    uint32_t GetReceived() const { return received; }
+    QStatus GetStatus() const { return status; }
+
+  protected:
+    ThreadReturn STDCALL Run(void* arg)
+    {
+        uint8_t msg[MsgSize];
+        size_t offset = 0;
+        while ((status == ER_OK) && (received < count)) {
+            size_t actual = 0;
+            status = stream.PullBytes(msg + offset, sizeof(msg) - offset, actual, Timeout);
+            offset += actual;
+            if ((status == ER_OK) && (offset == sizeof(msg))) {
+                uint32_t seq;
+                ::memcpy(&seq, msg, sizeof(seq));
+                if (seq != received) {
+                    status = ER_FAIL;
+                }
+                ++received;
+                offset = 0;
+            }
+        }
+        return 0;
+    }
+
+  private:
+    PacketEngineStream& stream;
+    uint32_t count;
+    uint32_t received;
+    QStatus status;
+};
+
+static void usage(void)
+{
+    printf("Usage: packetchurntest [-s <streams>] [-n <count>] [-r <rounds>] [-b <batch>]\n\n");
+    printf("Options:\n");
+    printf("   -s <streams>  = Long lived channels carrying traffic (default 4)\n");
+    printf("   -n <count>    = Messages pushed over each long lived channel (default 20000)\n");
+    printf("   -r <rounds>   = Times a batch of channels is opened and closed (default 20)\n");
+    printf("   -b <batch>    = Channels opened at once, enough to grow the channel table (default 100)\n");
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t numStreams = 4;
+    uint32_t count = 20000;
+    uint32_t rounds = 20;
+    uint32_t batch = 100;
+
+    for (int i = 1; i < argc; ++i) {
+        if ((0 == strcmp("-s", argv[i])) && (i + 1 < argc)) {
+            numStreams = StringToU32(argv[++i], 10, 0);
+        } else if ((0 == strcmp("-n", argv[i])) && (i + 1 < argc)) {
+            count = StringToU32(argv[++i], 10, 0);
+        } else if ((0 == strcmp("-r", argv[i])) && (i + 1 < argc)) {
+            rounds = StringToU32(argv[++i], 10, 0);
+        } else if ((0 == strcmp("-b", argv[i])) && (i + 1 < argc)) {
+            batch = StringToU32(argv[++i], 10, 0);
+        } else {
+            usage();
+            exit(1);
+        }
+    }
+
+    SimPacketStream streamA("10.0.0.1", 9955, g_ideal, 1);
+    SimPacketStream streamB("10.0.0.2", 9955, g_ideal, 2);
+    SimPacketStream::Connect(streamA, streamB);
+
+    PacketEngine engineA("churn-a");
+    PacketEngine engineB("churn-b");
+    ChurnListener listenerA, listenerB;
+    streamA.Start();
+    streamB.Start();
+    engineA.AddPacketStream(streamA, listenerA);
+    engineB.AddPacketStream(streamB, listenerB);
+    engineA.Start(streamA.GetSinkMTU());
+    engineB.Start(streamB.GetSinkMTU());
+
+    /* Long lived channels, the accepting side is paired up in the order the channels are opened */
+    vector<PacketEngineStream> txStreams(numStreams);
+    vector<PacketEngineStream> rxStreams(numStreams);
+    listenerB.KeepAccepted(true);
+    for (uint32_t i = 0; i < numStreams; ++i) {
+        CHECK(Open(engineA, streamA, streamB, listenerA, txStreams[i]) == ER_OK);
+        CHECK(listenerB.PopAccepted(rxStreams[i]) == ER_OK);
+    }
+    listenerB.KeepAccepted(false);
+
+    vector<Pusher*> pushers;
+    vector<Puller*> pullers;
+    for (uint32_t i = 0; i < numStreams; ++i) {
+        pullers.push_back(new Puller(rxStreams[i], count));
+        pushers.push_back(new Pusher(txStreams[i], count));
+        pullers.back()->Start();
+        pushers.back()->Start();
+    }
+
+    /* Grow the channel tables and release channels while the traffic is looked up */
+    uint64_t maxOpen = 0;
+    uint64_t start = GetTimestamp64();
+    for (uint32_t r = 0; r < rounds; ++r) {
+        vector<PacketEngineStream> churn(batch);
+        for (uint32_t i = 0; i < batch; ++i) {
+            uint64_t ts = GetTimestamp64();
+            CHECK(Open(engineA, streamA, streamB, listenerA, churn[i]) == ER_OK);
+            maxOpen = max(maxOpen, GetTimestamp64() - ts);
+        }
+        for (uint32_t i = 0; i < batch; ++i) {
+            engineA.Disconnect(churn[i]);
+        }
+    }
+    uint64_t elapsed = GetTimestamp64() - start;
+
+    for (uint32_t i = 0; i < numStreams; ++i) {
+        pushers[i]->Join();
+        pullers[i]->Join();
+        CHECK(pushers[i]->GetStatus() == ER_OK);
+        CHECK(pullers[i]->GetStatus() == ER_OK);
+        CHECK(pullers[i]->GetReceived() == count);
+        delete pushers[i];
+        delete pullers[i];
+    }
+
+    /* Every churned channel must have been released on both sides */
+    int32_t expected = static_cast<int32_t>(rounds * batch);
+    uint64_t deadline = GetTimestamp64() + Timeout;
+    while (((listenerA.GetNumDisconnected() < expected) || (listenerB.GetNumDisconnected() < expected)) && (GetTimestamp64() < deadline)) {
+        qcc::Sleep(10);
+    }
+    CHECK(listenerA.GetNumDisconnected() == expected);
+    CHECK(listenerB.GetNumDisconnected() == expected);
+
+    printf("%u channels opened and closed in %u ms, slowest open %u ms\n", rounds * batch,
+           static_cast<uint32_t>(elapsed), static_cast<uint32_t>(maxOpen));
+
+    for (uint32_t i = 0; i < numStreams; ++i) {
+        engineA.Disconnect(txStreams[i]);
+    }
+    engineA.Stop();
+    engineB.Stop();
+    engineA.Join();
+    engineB.Join();
+    streamA.Stop();
+    streamB.Stop();
+
+    return CheckResult();
+}
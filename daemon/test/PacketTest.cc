@@ -48,6 +48,7 @@ static const char* g_ifaceName = "eth0";
 static uint16_t g_port = 9911;
 static uint32_t g_sendTtl = 0;
 static uint32_t g_recvTimeout = 1;
+static CongestionControl::Type g_congestionControl = CongestionControl::CUBIC;
 
 
 class PacketEngineController : public PacketEngineListener {
@@ -71,6 +72,8 @@ class PacketEngineController : public PacketEngineListener {
 
     void Disconnect(uint32_t connNum);
 
+    void SetCongestionControl(CongestionControl::Type type) { engine.SetCongestionControl(type); }
+
     void PacketEngineConnectCB(PacketEngine& engine, QStatus status, const PacketEngineStream* stream, const PacketDest& dest, void* context);
 
     bool PacketEngineAcceptCB(PacketEngine& engine, const PacketEngineStream& stream, const PacketDest& dest);
@@ -305,6 +308,7 @@ static void usage(void)
     printf("   -h            - Print this help message\n");
     printf("   -i <iface>    - Set the network interface\n");
     printf("   -p <port>     - Set the network port\n");
+    printf("   -c <cc>       - Set the congestion control algorithm (cubic or delay)\n");
     printf("\n");
 }
 
@@ -428,6 +432,17 @@ int main(int argc, char** argv)
             g_ifaceName = argv[++i];
         } else if (::strcmp("-p", argv[i]) == 0) {
             g_port = static_cast<uint16_t>(StringToU32(argv[++i], 10, 0));
+        } else if ((::strcmp("-c", argv[i]) == 0) && ((i + 1) < argc)) {
+            ++i;
+            if (::strcmp("cubic", argv[i]) == 0) {
+                g_congestionControl = CongestionControl::CUBIC;
+            } else if (::strcmp("delay", argv[i]) == 0) {
+                g_congestionControl = CongestionControl::DELAY;
+            } else {
+                printf("Unknown congestion control %s\n", argv[i]);
+                usage();
+                exit(1);
+            }
         } else {
             status = ER_FAIL;
             printf("Unknown option %s\n", argv[i]);
@@ -438,6 +453,7 @@ int main(int argc, char** argv)
 
     /* Create PacketEngine controller */
     PacketEngineController controller(g_ifaceName, g_port);
+    controller.SetCongestionControl(g_congestionControl);
     status = controller.Start();
     if (status != ER_OK) {
         QCC_LogError(status, ("PacketController::Start failed"));
@@ -0,0 +1,328 @@
+/**
+ * @file
+ * Checks and decision cost of the daemon policy engine.
+ */
+
+/******************************************************************************
+ * Copyright 2012, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#include <qcc/platform.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <qcc/FileStream.h>
+#include <qcc/String.h>
+#include <qcc/StringUtil.h>
+#include <qcc/Thread.h>
+
+#include <alljoyn/Message.h>
+
+#include <Status.h>
+
+#include "DaemonConfig.h"
+#include "MicroTimestamp.h"
+#include "PolicyEngine.h"
+#include "TestCheck.h"
+
+#define QCC_MODULE "ALLJOYN"
+
+using namespace qcc;
+using namespace std;
+using namespace ajn;
+
+static const char checkConfig[] =
+    "<busconfig>"
+    "  <policy context=\"default\">"
+    "    <allow send_interface=\"*\"/>"
+    "    <allow receive_interface=\"*\"/>"
+    "    <allow own=\"*\"/>"
+    "    <deny send_destination=\"org.test.Dest\" send_member=\"Forbidden\"/>"
+    "    <deny send_destination=\"org.test.Dest\" send_interface=\"org.test.Private\"/>"
+    "    <deny receive_sender=\"org.test.Noisy\" receive_type=\"signal\"/>"
+    "    <deny send_path=\"/secret\"/>"
+    "  </policy>"
+    "  <policy context=\"mandatory\">"
+    "    <allow send_destination=\"org.test.Dest\" send_interface=\"org.test.Override\" send_member=\"Forbidden\"/>"
+    "  </policy>"
+    "  <policy user=\"root\">"
+    "    <deny send_interface=\"*\"/>"
+    "  </policy>"
+    "</busconfig>";
+
+static QStatus Compile(PolicyEngine& policy, const char* xml)
+{
+    DaemonConfig* config = DaemonConfig::Load(xml);
+    if (!config) {
+        return ER_BUS_BAD_XML;
+    }
+    return policy.Compile(config->GetElements("policy"));
+}
+
+static bool Call(PolicyEngine& policy, const char* sender, const char* dest, const char* iface, const char* member, const char* path = "/")
+{
+    return policy.OKToDeliver(MESSAGE_METHOD_CALL, sender, dest, iface, member, path, NULL);
+}
+
+static bool Signal(PolicyEngine& policy, const char* sender, const char* dest, const char* iface, const char* member)
+{
+    return policy.OKToDeliver(MESSAGE_SIGNAL, sender, dest, iface, member, "/", NULL);
+}
+
+static void CheckRules(bool cache)
+{
+    PolicyEngine policy;
+    policy.EnableCache(cache);
+    CHECK(Compile(policy, checkConfig) == ER_OK);
+    CHECK(policy.IsEnabled());
+
+    /* Rules for a name do not apply until a connection owns it */
+    CHECK(Call(policy, ":1.1", ":1.2", "org.test.Public", "Forbidden"));
+    String dest(":1.2");
+    policy.NameOwnerChanged("org.test.Dest", NULL, &dest);
+    CHECK(!Call(policy, ":1.1", ":1.2", "org.test.Public", "Forbidden"));
+    CHECK(Call(policy, ":1.1", ":1.2", "org.test.Public", "Allowed"));
+    CHECK(!Call(policy, ":1.1", ":1.2", "org.test.Private", "Allowed"));
+    CHECK(Call(policy, ":1.1", ":1.3", "org.test.Private", "Forbidden"));
+
+    /* The mandatory rule overrides the later default deny */
+    CHECK(Call(policy, ":1.1", ":1.2", "org.test.Override", "Forbidden"));
+
+    /* Rules on the object path make the path part of the cache key */
+    CHECK(Call(policy, ":1.1", ":1.3", "org.test.Public", "Get", "/open"));
+    CHECK(!Call(policy, ":1.1", ":1.3", "org.test.Public", "Get", "/secret"));
+    CHECK(Call(policy, ":1.1", ":1.3", "org.test.Public", "Get", "/open"));
+
+    /* Receive rules match the names of the sender and the message type */
+    String noisy(":1.5");
+    policy.NameOwnerChanged("org.test.Noisy", NULL, &noisy);
+    CHECK(!Signal(policy, ":1.5", ":1.1", "org.test.Public", "Changed"));
+    CHECK(Call(policy, ":1.5", ":1.1", "org.test.Public", "Changed"));
+    CHECK(Signal(policy, ":1.1", ":1.5", "org.test.Public", "Changed"));
+
+    /* Replies and errors are not checked */
+    CHECK(policy.OKToDeliver(MESSAGE_METHOD_RET, ":1.1", ":1.2", NULL, NULL, NULL, NULL));
+    CHECK(policy.OKToDeliver(MESSAGE_ERROR, ":1.1", ":1.2", NULL, NULL, NULL, "org.test.Error"));
+
+    /* The rules follow the name when it changes owner */
+    String newDest(":1.4");
+    policy.NameOwnerChanged("org.test.Dest", &dest, &newDest);
+    CHECK(Call(policy, ":1.1", ":1.2", "org.test.Public", "Forbidden"));
+    CHECK(!Call(policy, ":1.1", ":1.4", "org.test.Public", "Forbidden"));
+    policy.NameOwnerChanged("org.test.Dest", &newDest, NULL);
+    policy.NameOwnerChanged(":1.4", &newDest, NULL);
+    CHECK(Call(policy, ":1.1", ":1.4", "org.test.Public", "Forbidden"));
+
+    uint32_t hits;
+    uint32_t misses;
+    policy.GetCacheStats(hits, misses);
+    CHECK(cache ? (hits > 0) : (hits == 0));
+}
+
+static void CheckDefaults()
+{
+    PolicyEngine policy;
+
+    /* Without send rules method calls are denied but signals are not */
+    CHECK(Compile(policy, "<busconfig><policy context=\"default\"><allow receive_interface=\"*\"/></policy></busconfig>") == ER_OK);
+    CHECK(!Call(policy, ":1.1", ":1.2", "org.test.Public", "Get"));
+    CHECK(Signal(policy, ":1.1", ":1.2", "org.test.Public", "Changed"));
+
+    /* Without receive rules the same default applies, method calls are not received but signals are */
+    CHECK(Compile(policy, "<busconfig><policy context=\"default\"><allow send_interface=\"*\"/></policy></busconfig>") == ER_OK);
+    CHECK(!Call(policy, ":1.1", ":1.2", "org.test.Public", "Get"));
+    CHECK(Signal(policy, ":1.1", ":1.2", "org.test.Public", "Changed"));
+
+    /* Rules that allow everything in both directions leave the policy off */
+    CHECK(Compile(policy, "<busconfig><policy context=\"default\"><allow send_interface=\"*\"/><allow receive_interface=\"*\"/>"
+                  "<allow own=\"*\"/><allow send_requested_reply=\"true\"/></policy></busconfig>") == ER_OK);
+    CHECK(!policy.IsEnabled());
+    CHECK(Call(policy, ":1.1", ":1.2", "org.test.Public", "Get"));
+    CHECK(Compile(policy, "<busconfig><policy context=\"default\"><allow send_interface=\"*\"/><allow receive_interface=\"*\"/>"
+                  "<deny send_member=\"Get\"/></policy></busconfig>") == ER_OK);
+    CHECK(policy.IsEnabled());
+    CHECK(!Call(policy, ":1.1", ":1.2", "org.test.Public", "Get"));
+    CHECK(Compile(policy, "<busconfig><policy context=\"default\"><allow send_interface=\"*\"/><allow receive_interface=\"org.test.Public\"/>"
+                  "</policy></busconfig>") == ER_OK);
+    CHECK(policy.IsEnabled());
+
+    /* A configuration without message rules turns the policy off */
+    CHECK(Compile(policy, "<busconfig><policy context=\"default\"><allow own=\"*\"/></policy></busconfig>") == ER_OK);
+    CHECK(!policy.IsEnabled());
+
+    CHECK(Compile(policy, "<busconfig><policy context=\"bogus\"><allow send_interface=\"*\"/></policy></busconfig>") == ER_BUS_BAD_XML);
+    CHECK(Compile(policy, "<busconfig><policy context=\"default\"><allow send_member=\"a\" receive_member=\"b\"/></policy></busconfig>") == ER_BUS_BAD_XML);
+    CHECK(Compile(policy, "<busconfig><policy context=\"default\"><allow send_color=\"red\"/></policy></busconfig>") == ER_BUS_BAD_XML);
+    CHECK(Compile(policy, "<busconfig><policy context=\"default\"><permit send_interface=\"*\"/></policy></busconfig>") == ER_BUS_BAD_XML);
+}
+
+/*
+ * Makes decisions that do not depend on the names being changed by the main thread while the
+ * changes invalidate the cache under it.
+ */
+class Decider : public Thread {
+  public:
+    Decider(PolicyEngine& policy, uint32_t count) : Thread("Decider"), policy(policy), count(count), wrong(0) { }
+
+    uint32_t GetWrong() const { return wrong; }
+
+  protected:
+    ThreadReturn STDCALL Run(void* arg)
+    {
+        for (uint32_t i = 0; i < count; ++i) {
+            String member = "Member" + U32ToString(i % 500);
+            if (!Call(policy, ":1.1", ":1.3", "org.test.Public", member.c_str())) {
+                ++wrong;
+            }
+            if (Call(policy, ":1.1", ":1.2", "org.test.Public", "Forbidden")) {
+                ++wrong;
+            }
+        }
+        return 0;
+    }
+
+  private:
+    PolicyEngine& policy;
+    uint32_t count;
+    uint32_t wrong;
+};
+
+static void CheckConcurrentDecisions()
+{
+    PolicyEngine policy;
+    CHECK(Compile(policy, checkConfig) == ER_OK);
+    String dest(":1.2");
+    policy.NameOwnerChanged("org.test.Dest", NULL, &dest);
+
+    vector<Decider*> deciders;
+    for (size_t i = 0; i < 4; ++i) {
+        deciders.push_back(new Decider(policy, 100000));
+        deciders.back()->Start();
+    }
+    String noisy[2] = { ":1.5", ":1.6" };
+    for (uint32_t i = 0; i < 10000; ++i) {
+        policy.NameOwnerChanged("org.test.Noisy", (i > 0) ? &noisy[(i - 1) & 1] : NULL, &noisy[i & 1]);
+    }
+    for (size_t i = 0; i < deciders.size(); ++i) {
+        deciders[i]->Join();
+        CHECK(deciders[i]->GetWrong() == 0);
+        delete deciders[i];
+    }
+}
+
+struct Decision {
+    AllJoynMessageType type;
+    const char* sender;
+    const char* destination;
+    String interface;
+    String member;
+};
+
+/*
+ * Makes the same decisions over and over and returns nanoseconds per decision.
+ */
+static double RunDecisions(PolicyEngine& policy, const vector<Decision>& decisions, uint32_t count, uint32_t& allowed)
+{
+    allowed = 0;
+    uint64_t start = GetMicroTimestamp();
+    for (uint32_t i = 0; i < count; ++i) {
+        const Decision& d = decisions[i % decisions.size()];
+        if (policy.OKToDeliver(d.type, d.sender, d.destination, d.interface.c_str(), d.member.c_str(), "/org/caf/AllJoynTest", NULL)) {
+            ++allowed;
+        }
+    }
+    return ((GetMicroTimestamp() - start) * 1000.0) / count;
+}
+
+static void usage(void)
+{
+    printf("Usage: policybench [-c <config file>] [-n <decisions>]\n");
+}
+
+int main(int argc, char** argv)
+{
+    const char* configFile = "daemon/test/conf/policyperftest.conf";
+    uint32_t count = 1000000;
+
+    for (int i = 1; i < argc; ++i) {
+        if ((0 == strcmp("-c", argv[i])) && (i + 1 < argc)) {
+            configFile = argv[++i];
+        } else if ((0 == strcmp("-n", argv[i])) && (i + 1 < argc)) {
+            count = strtoul(argv[++i], NULL, 10);
+        } else {
+            usage();
+            exit(1);
+        }
+    }
+
+    CheckRules(true);
+    CheckRules(false);
+    CheckDefaults();
+    CheckConcurrentDecisions();
+
+    FileSource fs(configFile);
+    DaemonConfig* config = fs.IsValid() ? DaemonConfig::Load(fs) : NULL;
+    if (!config) {
+        printf("Cannot load %s\n", configFile);
+        exit(1);
+    }
+    PolicyEngine policy;
+    CHECK(policy.Compile(config->GetElements("policy")) == ER_OK);
+
+    String source(":1.1");
+    String destination(":1.2");
+    policy.NameOwnerChanged("org.caf.AllJoynTest.Source", NULL, &source);
+    policy.NameOwnerChanged("org.caf.AllJoynTest.Destination", NULL, &destination);
+
+    /* Method calls to every member the rules mention and the signals coming back */
+    vector<Decision> decisions;
+    for (uint32_t m = 0; m < 100; ++m) {
+        Decision d;
+        d.interface = "org.caf.AllJoynTest";
+        d.type = MESSAGE_METHOD_CALL;
+        d.sender = source.c_str();
+        d.destination = destination.c_str();
+        d.member = "MessageSink" + U32ToString(m, 10, 2, '0');
+        decisions.push_back(d);
+        d.type = MESSAGE_SIGNAL;
+        d.sender = destination.c_str();
+        d.destination = source.c_str();
+        d.member = "SignalSource" + U32ToString(m, 10, 2, '0');
+        decisions.push_back(d);
+    }
+
+    uint32_t allowed;
+    uint32_t hits;
+    uint32_t misses;
+    policy.EnableCache(false);
+    double uncached = RunDecisions(policy, decisions, count, allowed);
+    CHECK(allowed == count);
+    printf("rules only        %6.1f ns per decision\n", uncached);
+
+    policy.EnableCache(true);
+    uint32_t baseHits;
+    uint32_t baseMisses;
+    policy.GetCacheStats(baseHits, baseMisses);
+    double cached = RunDecisions(policy, decisions, count, allowed);
+    CHECK(allowed == count);
+    policy.GetCacheStats(hits, misses);
+    printf("cached            %6.1f ns per decision (%u hits, %u misses)\n", cached, hits - baseHits, misses - baseMisses);
+
+    DaemonConfig::Release();
+
+    return CheckResult();
+}
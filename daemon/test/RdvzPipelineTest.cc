@@ -0,0 +1,362 @@
+/**
+ * @file
+ * Checks HTTP keep-alive and request pipelining on the Rendezvous Server
+ * connection against a local stand-in server, and compares the time it takes
+ * to get a burst of messages answered with and without pipelining.
+ */
+
+/******************************************************************************
+ * Copyright 2012, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#include <qcc/platform.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <vector>
+
+#include <qcc/Debug.h>
+#include <qcc/Event.h>
+#include <qcc/IPAddress.h>
+#include <qcc/Mutex.h>
+#include <qcc/Socket.h>
+#include <qcc/String.h>
+#include <qcc/StringUtil.h>
+#include <qcc/Thread.h>
+#include <qcc/time.h>
+
+#include <Status.h>
+#include <NetworkInterface.h>
+#include <ice/HttpConnection.h>
+#include <ice/RendezvousServerConnection.h>
+#include "TestCheck.h"
+
+#define QCC_MODULE "RENDEZVOUS_SERVER_CONNECTION"
+
+using namespace qcc;
+using namespace std;
+using namespace ajn;
+
+static const char responseBody[] = "{\"peerId\":\"peer-1\",\"peerAddr\":\"peer-1@rdvs.alljoyn.org\"}";
+
+/*
+ * A stand-in for the Rendezvous Server.  Each request is answered a fixed
+ * delay after it has been received, as if the server was that far away, so
+ * requests that are pipelined are answered together while requests sent one
+ * at a time each take the full delay.  Requests are answered in the order
+ * they were received.
+ */
+class StandInServer : public Thread {
+  public:
+    StandInServer(uint32_t delayMs) :
+        Thread("StandInServer"), listenFd(-1), port(0), delayMs(delayMs), closeAfter(0),
+        numConnections(0), numRequests(0), maxOutstanding(0) { }
+
+    ~StandInServer()
+    {
+        Stop();
+        Join();
+        if (listenFd != -1) {
+            qcc::Close(listenFd);
+        }
+    }
+
+    QStatus Listen()
+    {
+        QStatus status = qcc::Socket(QCC_AF_INET, QCC_SOCK_STREAM, listenFd);
+        if (status == ER_OK) {
+            status = qcc::Bind(listenFd, IPAddress("127.0.0.1"), 0);
+        }
+        if (status == ER_OK) {
+            status = qcc::Listen(listenFd, 4);
+        }
+        if (status == ER_OK) {
+            status = qcc::SetBlocking(listenFd, false);
+        }
+        if (status == ER_OK) {
+            IPAddress addr;
+            status = qcc::GetLocalAddress(listenFd, addr, port);
+        }
+        return status;
+    }
+
+    uint16_t GetPort() { return port; }
+
+    /* Answer the n'th request on each connection with "Connection: close" and close the connection (0 for never) */
+    void SetCloseAfter(uint32_t n) { closeAfter = n; }
+
+    uint32_t GetNumConnections() { lock.Lock(); uint32_t n = numConnections; lock.Unlock(); return n; }
+    uint32_t GetNumRequests() { lock.Lock(); uint32_t n = numRequests; lock.Unlock(); return n; }
+    uint32_t GetMaxOutstanding() { lock.Lock(); uint32_t n = maxOutstanding; lock.Unlock(); return n; }
+    void ResetMaxOutstanding() { lock.Lock(); maxOutstanding = 0; lock.Unlock(); }
+
+  protected:
+    ThreadReturn STDCALL Run(void* arg)
+    {
+        Event listenEvent(listenFd, Event::IO_READ, false);
+        while (!IsStopping()) {
+            vector<Event*> checkEvents, signaledEvents;
+            checkEvents.push_back(&GetStopEvent());
+            checkEvents.push_back(&listenEvent);
+            Event::Wait(checkEvents, signaledEvents, Event::WAIT_FOREVER);
+            if (IsStopping()) {
+                break;
+            }
+
+            IPAddress addr;
+            uint16_t remotePort;
+            SocketFd fd;
+            if (qcc::Accept(listenFd, addr, remotePort, fd) == ER_OK) {
+                lock.Lock();
+                ++numConnections;
+                lock.Unlock();
+                qcc::SetBlocking(fd, false);
+                Serve(fd);
+                qcc::Close(fd);
+            }
+        }
+        return 0;
+    }
+
+  private:
+    /* Serve one connection until the client closes it, the server is stopped or closeAfter is reached */
+    void Serve(SocketFd fd)
+    {
+        Event readEvent(fd, Event::IO_READ, false);
+        String input;
+        deque<uint64_t> due;
+        uint32_t served = 0;
+        bool open = true;
+
+        while (open && !IsStopping()) {
+            uint32_t timeout = Event::WAIT_FOREVER;
+            if (!due.empty()) {
+                uint64_t now = GetTimestamp64();
+                timeout = (due.front() > now) ? static_cast<uint32_t>(due.front() - now) : 0;
+            }
+
+            vector<Event*> checkEvents, signaledEvents;
+            checkEvents.push_back(&GetStopEvent());
+            checkEvents.push_back(&readEvent);
+            Event::Wait(checkEvents, signaledEvents, timeout);
+
+            /* Take in everything that has arrived and time stamp each complete request */
+            char buf[1024];
+            size_t received;
+            QStatus status = qcc::Recv(fd, buf, sizeof(buf), received);
+            while ((status == ER_OK) && (received > 0)) {
+                input.append(buf, received);
+                status = qcc::Recv(fd, buf, sizeof(buf), received);
+            }
+            if (((status == ER_OK) && (received == 0)) || ((status != ER_OK) && (status != ER_WOULDBLOCK))) {
+                open = false;
+            }
+            size_t length;
+            while ((length = RequestLength(input)) != 0) {
+                input.erase(0, length);
+                due.push_back(GetTimestamp64() + delayMs);
+                lock.Lock();
+                ++numRequests;
+                if (due.size() > maxOutstanding) {
+                    maxOutstanding = due.size();
+                }
+                lock.Unlock();
+            }
+
+            /* Answer the requests whose time has come */
+            while (open && !due.empty() && (due.front() <= GetTimestamp64())) {
+                due.pop_front();
+                ++served;
+                bool close = (closeAfter != 0) && (served == closeAfter);
+                String response = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n";
+                response += "Content-Length: " + U32ToString(sizeof(responseBody) - 1) + "\r\n";
+                if (close) {
+                    response += "Connection: close\r\n";
+                }
+                response += "\r\n";
+                response += responseBody;
+                size_t sent;
+                if ((qcc::Send(fd, response.data(), response.size(), sent) != ER_OK) || (sent != response.size())) {
+                    open = false;
+                }
+                if (close) {
+                    open = false;
+                }
+            }
+        }
+    }
+
+    /* Length of the complete request at the front of input or 0 */
+    static size_t RequestLength(const String& input)
+    {
+        size_t end = input.find("\r\n\r\n");
+        if (end == String::npos) {
+            return 0;
+        }
+        size_t contentLength = 0;
+        size_t pos = input.find("Content-Length: ");
+        if ((pos != String::npos) && (pos < end)) {
+            contentLength = StringToU32(input.substr(pos + 16, input.find("\r\n", pos) - pos - 16), 10, 0);
+        }
+        if (input.size() < end + 4 + contentLength) {
+            return 0;
+        }
+        return end + 4 + contentLength;
+    }
+
+    SocketFd listenFd;
+    uint16_t port;
+    uint32_t delayMs;
+    uint32_t closeAfter;
+    Mutex lock;
+    uint32_t numConnections;
+    uint32_t numRequests;
+    uint32_t maxOutstanding;
+};
+
+static QStatus Send(RendezvousServerConnection& conn, uint32_t n)
+{
+    String payload = "{\"addressCandidates\":{\"peerAddr\":\"peer-" + U32ToString(n) + "@rdvs.alljoyn.org\"}}";
+    return conn.SendMessage(false, HttpConnection::METHOD_POST, "/peers/peer-1/candidates", true, payload);
+}
+
+static QStatus Fetch(RendezvousServerConnection& conn)
+{
+    QStatus status = Event::Wait(conn.GetOnDemandSourceEvent(), 5000);
+    if (status == ER_OK) {
+        HttpConnection::HTTPResponse response;
+        status = conn.FetchResponse(true, response);
+        if ((status == ER_OK) && (!response.payloadPresent || ((*response.payload)["peerId"] != "peer-1"))) {
+            status = ER_FAIL;
+        }
+    }
+    return status;
+}
+
+/* Send n messages, each after the response to the previous one, and return the elapsed time */
+static uint64_t RunLockstep(RendezvousServerConnection& conn, uint32_t n)
+{
+    uint64_t start = GetTimestamp64();
+    for (uint32_t i = 0; i < n; ++i) {
+        CHECK(Send(conn, i) == ER_OK);
+        CHECK(Fetch(conn) == ER_OK);
+    }
+    return GetTimestamp64() - start;
+}
+
+/* Send n messages, keeping as many outstanding as the connection allows, and return the elapsed time */
+static uint64_t RunPipelined(RendezvousServerConnection& conn, uint32_t n)
+{
+    uint64_t start = GetTimestamp64();
+    uint32_t sent = 0;
+    uint32_t received = 0;
+    while (received < n) {
+        while ((sent < n) && conn.CanPipelineOnDemandMessage()) {
+            CHECK(Send(conn, sent) == ER_OK);
+            ++sent;
+        }
+        QStatus status = Fetch(conn);
+        CHECK(status == ER_OK);
+        if (status != ER_OK) {
+            break;
+        }
+        ++received;
+    }
+    return GetTimestamp64() - start;
+}
+
+static void usage()
+{
+    printf("Usage: rdvzpipelinetest [-n <messages>] [-d <ms>]\n\n");
+    printf("Options:\n");
+    printf("   -h        = Print this help message\n");
+    printf("   -n <num>  = Number of messages in a burst (default 32)\n");
+    printf("   -d <ms>   = Delay before the stand-in server answers a request (default 20)\n");
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t numMessages = 32;
+    uint32_t delayMs = 20;
+
+    for (int i = 1; i < argc; ++i) {
+        if ((0 == strcmp("-n", argv[i])) && (i + 1 < argc)) {
+            numMessages = strtoul(argv[++i], NULL, 10);
+        } else if ((0 == strcmp("-d", argv[i])) && (i + 1 < argc)) {
+            delayMs = strtoul(argv[++i], NULL, 10);
+        } else {
+            usage();
+            exit(1);
+        }
+    }
+
+    StandInServer server(delayMs);
+    if (server.Listen() != ER_OK) {
+        printf("Unable to listen on the loopback interface\n");
+        return 1;
+    }
+    server.Start();
+
+    RendezvousServerConnection conn("127.0.0.1", false, true);
+    conn.SetRendezvousServerPort(server.GetPort());
+
+    /* The connection insists on a live (non loopback) interface even though the stand-in server is local */
+    QStatus status = conn.Connect(NetworkInterface::ANY, RendezvousServerConnection::ON_DEMAND_CONNECTION);
+    if (status != ER_OK) {
+        printf("No network interface is up, skipping (%s)\n", QCC_StatusText(status));
+        return 0;
+    }
+    CHECK(conn.IsOnDemandConnUp());
+
+    printf("Burst of %u messages, %u ms to the server\n", numMessages, delayMs);
+
+    uint64_t lockstep = RunLockstep(conn, numMessages);
+    CHECK(server.GetMaxOutstanding() == 1);
+    printf("   one at a time   %6u ms\n", static_cast<uint32_t>(lockstep));
+
+    server.ResetMaxOutstanding();
+    uint64_t pipelined = RunPipelined(conn, numMessages);
+    uint32_t depth = server.GetMaxOutstanding();
+    printf("   pipelined       %6u ms (up to %u outstanding)\n", static_cast<uint32_t>(pipelined), depth);
+    CHECK(depth > 1);
+    CHECK(pipelined * 2 < lockstep);
+
+    /* Everything went over the one kept-alive connection */
+    CHECK(server.GetNumConnections() == 1);
+    CHECK(server.GetNumRequests() == 2 * numMessages);
+
+    /* A connection the server closes is cleaned up after the response and can be set up on its own again */
+    printf("Server closing the connection\n");
+    conn.Disconnect();
+    server.SetCloseAfter(2);
+    CHECK(conn.Connect(NetworkInterface::ANY, RendezvousServerConnection::ON_DEMAND_CONNECTION) == ER_OK);
+    CHECK(Send(conn, 0) == ER_OK);
+    CHECK(Fetch(conn) == ER_OK);
+    CHECK(conn.IsOnDemandConnUp());
+    CHECK(Send(conn, 1) == ER_OK);
+    CHECK(Fetch(conn) == ER_OK);
+    CHECK(!conn.IsOnDemandConnUp());
+    CHECK(!conn.CanPipelineOnDemandMessage());
+    CHECK(conn.Connect(NetworkInterface::ANY, RendezvousServerConnection::ON_DEMAND_CONNECTION) == ER_OK);
+    CHECK(conn.IsOnDemandConnUp());
+    CHECK(Send(conn, 2) == ER_OK);
+    CHECK(Fetch(conn) == ER_OK);
+    CHECK(server.GetNumConnections() == 3);
+
+    conn.Disconnect();
+
+    return CheckResult();
+}
@@ -0,0 +1,263 @@
+/**
+ * @file
+ * SimPacketStream is an in-process PacketStream that simulates an impaired network link.
+ */
+
+/******************************************************************************
+ * Copyright 2012, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#include <qcc/platform.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include <qcc/Debug.h>
+#include <qcc/IPAddress.h>
+#include <qcc/StringUtil.h>
+#include <qcc/time.h>
+
+#include "SimPacketStream.h"
+
+#define QCC_MODULE "PACKET"
+
+using namespace std;
+using namespace qcc;
+
+namespace ajn {
+
+SimPacketStream::SimPacketStream(const qcc::String& addr, uint16_t port, const SimLinkProfile& profile, uint64_t seed, size_t mtu) :
+    profile(profile),
+    rngState(seed ? seed : 0x9E3779B97F4A7C15ULL),
+    mtu(mtu),
+    localDest(ajn::GetPacketDest(addr, port)),
+    peer(NULL),
+    txFreeMs(0.0),
+    txLastDeliverTs(0),
+    txProbe(mtu),
+    deliveryThread(*this)
+{
+    ::memset(&stats, 0, sizeof(stats));
+}
+
+SimPacketStream::~SimPacketStream()
+{
+    Stop();
+}
+
+void SimPacketStream::Connect(SimPacketStream& a, SimPacketStream& b)
+{
+    a.peer = &b;
+    b.peer = &a;
+}
+
+QStatus SimPacketStream::Start()
+{
+    return deliveryThread.Start();
+}
+
+QStatus SimPacketStream::Stop()
+{
+    deliveryThread.Stop();
+    deliveryThread.Join();
+    return ER_OK;
+}
+
+SimLinkStats SimPacketStream::GetStats() const
+{
+    txLock.Lock();
+    SimLinkStats ret = stats;
+    txLock.Unlock();
+    return ret;
+}
+
+double SimPacketStream::NextRandom()
+{
+    /* xorshift64* */
+    rngState ^= rngState >> 12;
+    rngState ^= rngState << 25;
+    rngState ^= rngState >> 27;
+    uint64_t r = rngState * 2685821657736338717ULL;
+    return static_cast<double>(r >> 11) / 9007199254740992.0;
+}
+
+void SimPacketStream::CountDataPacket(const void* buf, size_t numBytes)
+{
+    ::memcpy(txProbe.buffer, buf, numBytes);
+    if ((txProbe.Unmarshal(localDest, numBytes) == ER_OK) && !(txProbe.flags & PACKET_FLAG_CONTROL)) {
+        stats.dataPackets++;
+        map<uint32_t, uint16_t>::iterator it = txHighSeq.find(txProbe.chanId);
+        if (it == txHighSeq.end()) {
+            txHighSeq[txProbe.chanId] = txProbe.seqNum;
+        } else if (static_cast<int16_t>(txProbe.seqNum - it->second) > 0) {
+            it->second = txProbe.seqNum;
+        } else {
+            stats.dataRetransmits++;
+        }
+    }
+}
+
+QStatus SimPacketStream::PushPacketBytes(const void* buf, size_t numBytes, PacketDest& dest)
+{
+    if (numBytes > mtu) {
+        return ER_PACKET_TOO_LARGE;
+    }
+    if (!peer) {
+        return ER_FAIL;
+    }
+
+    txLock.Lock();
+    uint64_t now = GetTimestamp64();
+    stats.packets++;
+    stats.bytes += numBytes;
+    CountDataPacket(buf, numBytes);
+
+    /*
+     * Draw every random value up front so that the sequence consumed per packet does not depend
+     * on the outcome of earlier decisions.
+     */
+    double lossDraw = NextRandom();
+    double jitterDraw = NextRandom();
+    double reorderDraw = NextRandom();
+    double dupDraw = NextRandom();
+
+    /* Serialize the packet onto the link */
+    double nowMs = static_cast<double>(now);
+    double startMs = (std::max)(txFreeMs, nowMs);
+    bool queueDrop = false;
+    if (profile.bandwidthKbps) {
+        double backlogBytes = (startMs - nowMs) * profile.bandwidthKbps / 8.0;
+        if (profile.queueBytes && ((backlogBytes + numBytes) > profile.queueBytes)) {
+            queueDrop = true;
+        } else {
+            txFreeMs = startMs + (numBytes * 8.0) / profile.bandwidthKbps;
+        }
+    } else {
+        txFreeMs = startMs;
+    }
+
+    if (queueDrop) {
+        stats.queueDrops++;
+    } else if (lossDraw < profile.lossRate) {
+        stats.lost++;
+    } else {
+        int64_t delay = static_cast<int64_t>(profile.latencyMs);
+        if (profile.jitterMs) {
+            delay += static_cast<int64_t>(jitterDraw * (2 * profile.jitterMs + 1)) - profile.jitterMs;
+        }
+        uint64_t deliverTs = static_cast<uint64_t>(txFreeMs) + static_cast<uint64_t>((std::max)(delay, (int64_t)0));
+        if (reorderDraw < profile.reorderRate) {
+            /* Held back packets are overtaken by the packets that follow them */
+            deliverTs += profile.reorderDelayMs;
+            stats.reordered++;
+        } else {
+            /* Jitter alone does not reorder packets */
+            deliverTs = (std::max)(deliverTs, txLastDeliverTs);
+            txLastDeliverTs = deliverTs;
+        }
+        peer->Deliver(buf, numBytes, localDest, deliverTs);
+        if (dupDraw < profile.dupRate) {
+            peer->Deliver(buf, numBytes, localDest, deliverTs + 1);
+            stats.duplicated++;
+        }
+    }
+    txLock.Unlock();
+    return ER_OK;
+}
+
+void SimPacketStream::Deliver(const void* buf, size_t numBytes, const PacketDest& sender, uint64_t deliverTs)
+{
+    rxLock.Lock();
+    multimap<uint64_t, Datagram>::iterator it = inFlight.insert(pair<uint64_t, Datagram>(deliverTs, Datagram()));
+    it->second.bytes.assign(static_cast<const uint8_t*>(buf), static_cast<const uint8_t*>(buf) + numBytes);
+    it->second.sender = sender;
+    if (it == inFlight.begin()) {
+        wakeEvent.SetEvent();
+    }
+    rxLock.Unlock();
+}
+
+QStatus SimPacketStream::PullPacketBytes(void* buf, size_t reqBytes, size_t& actualBytes, PacketDest& sender, uint32_t timeout)
+{
+    QStatus status = ER_OK;
+    rxLock.Lock();
+    while (arrived.empty()) {
+        sourceEvent.ResetEvent();
+        rxLock.Unlock();
+        status = Event::Wait(sourceEvent, timeout);
+        rxLock.Lock();
+        if (status != ER_OK) {
+            break;
+        }
+    }
+    if (status == ER_OK) {
+        Datagram& dg = arrived.front();
+        actualBytes = (std::min)(reqBytes, dg.bytes.size());
+        ::memcpy(buf, &dg.bytes[0], actualBytes);
+        sender = dg.sender;
+        arrived.pop_front();
+        if (arrived.empty()) {
+            sourceEvent.ResetEvent();
+        }
+    }
+    rxLock.Unlock();
+    return status;
+}
+
+String SimPacketStream::ToString(const PacketDest& dest) const
+{
+    IPAddress ipAddr(dest.ip, dest.addrSize);
+    String ret = ipAddr.ToString();
+    ret += " (";
+    ret += U32ToString(dest.port);
+    ret += ")";
+    return ret;
+}
+
+qcc::ThreadReturn STDCALL SimPacketStream::DeliveryThread::Run(void* arg)
+{
+    vector<Event*> checkEvents, sigEvents;
+    checkEvents.push_back(&GetStopEvent());
+    checkEvents.push_back(&stream.wakeEvent);
+
+    while (!IsStopping()) {
+        uint32_t waitMs = Event::WAIT_FOREVER;
+        stream.rxLock.Lock();
+        stream.wakeEvent.ResetEvent();
+        uint64_t now = GetTimestamp64();
+        while (!stream.inFlight.empty() && (stream.inFlight.begin()->first <= now)) {
+            stream.arrived.push_back(Datagram());
+            stream.arrived.back().bytes.swap(stream.inFlight.begin()->second.bytes);
+            stream.arrived.back().sender = stream.inFlight.begin()->second.sender;
+            stream.inFlight.erase(stream.inFlight.begin());
+        }
+        if (!stream.arrived.empty()) {
+            stream.sourceEvent.SetEvent();
+        }
+        if (!stream.inFlight.empty()) {
+            waitMs = static_cast<uint32_t>(stream.inFlight.begin()->first - now);
+        }
+        stream.rxLock.Unlock();
+
+        sigEvents.clear();
+        QStatus status = Event::Wait(checkEvents, sigEvents, waitMs);
+        if ((status != ER_OK) && (status != ER_TIMEOUT)) {
+            break;
+        }
+    }
+    return (qcc::ThreadReturn) 0;
+}
+
+}
@@ -0,0 +1,239 @@
+/**
+ * @file
+ * SimPacketStream is an in-process PacketStream that simulates an impaired network link.
+ */
+
+/******************************************************************************
+ * Copyright 2012, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#ifndef _ALLJOYN_SIMPACKETSTREAM_H
+#define _ALLJOYN_SIMPACKETSTREAM_H
+
+#include <qcc/platform.h>
+
+#include <deque>
+#include <map>
+#include <vector>
+
+#include <qcc/String.h>
+#include <qcc/Mutex.h>
+#include <qcc/Event.h>
+#include <qcc/Thread.h>
+#include <Status.h>
+
+#include "Packet.h"
+#include "PacketStream.h"
+
+namespace ajn {
+
+/**
+ * Impairments applied to packets pushed into a SimPacketStream.
+ */
+struct SimLinkProfile {
+    const char* name;        /**< Profile name used in reports */
+    uint32_t latencyMs;      /**< One way propagation delay */
+    uint32_t jitterMs;       /**< Propagation delay varies uniformly in [latencyMs - jitterMs, latencyMs + jitterMs] */
+    double lossRate;         /**< Probability that a packet is dropped */
+    double reorderRate;      /**< Probability that a packet is held back and overtaken by later packets */
+    uint32_t reorderDelayMs; /**< Extra delay of a reordered packet */
+    double dupRate;          /**< Probability that a packet is delivered twice */
+    uint32_t bandwidthKbps;  /**< Link rate or 0 for unlimited */
+    uint32_t queueBytes;     /**< Bytes the link can queue before tail dropping or 0 for unlimited */
+};
+
+/**
+ * Counters describing the traffic pushed into one side of a simulated link.
+ */
+struct SimLinkStats {
+    uint64_t packets;          /**< Packets pushed */
+    uint64_t bytes;            /**< Bytes pushed */
+    uint64_t dataPackets;      /**< PacketEngine data packets pushed */
+    uint64_t dataRetransmits;  /**< Data packets whose seqNum was not newer than one already pushed */
+    uint64_t lost;             /**< Packets dropped by lossRate */
+    uint64_t queueDrops;       /**< Packets dropped because the link queue was full */
+    uint64_t duplicated;       /**< Packets delivered twice */
+    uint64_t reordered;        /**< Packets held back by reorderRate */
+};
+
+/**
+ * SimPacketStream is one end of a simulated point-to-point link. Packets pushed into a stream are
+ * delayed, dropped, duplicated and reordered according to the stream's SimLinkProfile and are then
+ * made available to be pulled from the peer stream.
+ *
+ * All impairment decisions are made from a seeded pseudo random sequence at the time a packet is
+ * pushed, so the Nth packet pushed into a stream always receives the same treatment for a given
+ * seed and profile regardless of thread timing.
+ */
+class SimPacketStream : public PacketStream {
+  public:
+
+    /**
+     * Constructor
+     *
+     * @param addr     Address this stream reports as the sender of its packets.
+     * @param port     Port this stream reports as the sender of its packets.
+     * @param profile  Impairments applied to packets pushed into this stream.
+     * @param seed     Seed for the impairment decisions.
+     * @param mtu      MTU of the simulated link.
+     */
+    SimPacketStream(const qcc::String& addr, uint16_t port, const SimLinkProfile& profile, uint64_t seed, size_t mtu = 1472);
+
+    /** Destructor */
+    ~SimPacketStream();
+
+    /**
+     * Connect two streams so that packets pushed into one are pulled from the other.
+     */
+    static void Connect(SimPacketStream& a, SimPacketStream& b);
+
+    /**
+     * Start the PacketStream.
+     */
+    QStatus Start();
+
+    /**
+     * Stop the PacketStream.
+     */
+    QStatus Stop();
+
+    /**
+     * Get the PacketDest that packets sent to this stream should use.
+     */
+    const PacketDest& GetLocalDest() const { return localDest; }
+
+    /**
+     * Get the traffic counters for packets pushed into this stream.
+     */
+    SimLinkStats GetStats() const;
+
+    /**
+     * Pull bytes from the source.
+     * The source is exhausted when ER_NONE is returned.
+     *
+     * @param buf          Buffer to store pulled bytes
+     * @param reqBytes     Number of bytes requested to be pulled from source.
+     * @param actualBytes  Actual number of bytes retrieved from source.
+     * @param sender       Source type specific representation of the sender of the packet.
+     * @param timeout      Time to wait to pull the requested bytes.
+     * @return   ER_OK if successful. ER_NONE if source is exhausted. Otherwise an error.
+     */
+    QStatus PullPacketBytes(void* buf, size_t reqBytes, size_t& actualBytes, PacketDest& sender,
+                            uint32_t timeout = qcc::Event::WAIT_FOREVER);
+
+    /**
+     * Get the Event indicating that data is available when signaled.
+     *
+     * @return Event that is signaled when data is available.
+     */
+    qcc::Event& GetSourceEvent() { return sourceEvent; }
+
+    /**
+     * Get the mtu size for this PacketSource.
+     *
+     * @return MTU of PacketSource
+     */
+    size_t GetSourceMTU() { return mtu; }
+
+    /**
+     * Push zero or more bytes into the sink.
+     *
+     * @param buf          Buffer to store pulled bytes
+     * @param numBytes     Number of bytes from buf to send to sink. (Must be less that or equal to MTU of PacketSink.)
+     * @param dest         Destination for packet bytes.
+     * @return   ER_OK if successful.
+     */
+    QStatus PushPacketBytes(const void* buf, size_t numBytes, PacketDest& dest);
+
+    /**
+     * Get the Event that indicates when data can be pushed to sink.
+     *
+     * @return Event that is signaled when sink can accept more bytes.
+     */
+    qcc::Event& GetSinkEvent() { return qcc::Event::alwaysSet; }
+
+    /**
+     * Get the mtu size for this PacketSink.
+     *
+     * @return MTU of PacketSink
+     */
+    size_t GetSinkMTU() { return mtu; }
+
+    /**
+     * Human readable version of packetDest.
+     *
+     * @param dest   PacketDest to convert to string.
+     * @return Human readable string form of PacketDest.
+     */
+    qcc::String ToString(const PacketDest& dest) const;
+
+  private:
+
+    /* A packet traveling over the link */
+    struct Datagram {
+        std::vector<uint8_t> bytes;
+        PacketDest sender;
+    };
+
+    /* Moves packets from inFlight to arrived when their delivery time is reached */
+    class DeliveryThread : public qcc::Thread {
+      public:
+        DeliveryThread(SimPacketStream& stream) : qcc::Thread("SimPacketStream"), stream(stream) { }
+
+      protected:
+        qcc::ThreadReturn STDCALL Run(void* arg);
+
+      private:
+        SimPacketStream& stream;
+    };
+
+    /* Accept a packet from the peer for delivery at deliverTs */
+    void Deliver(const void* buf, size_t numBytes, const PacketDest& sender, uint64_t deliverTs);
+
+    /* Next value of the impairment sequence in [0, 1) */
+    double NextRandom();
+
+    /* Classify a pushed packet for the retransmit counters */
+    void CountDataPacket(const void* buf, size_t numBytes);
+
+    SimLinkProfile profile;
+    uint64_t rngState;
+    size_t mtu;
+    PacketDest localDest;
+    SimPacketStream* peer;
+
+    mutable qcc::Mutex txLock;                 /**< Protects the transmit side state below */
+    double txFreeMs;                           /**< Time at which the link finishes sending queued bytes */
+    uint64_t txLastDeliverTs;                  /**< Delivery time of the last in-order packet */
+    std::map<uint32_t, uint16_t> txHighSeq;    /**< Highest data seqNum pushed on each channel */
+    Packet txProbe;                            /**< Used to parse the header of pushed packets */
+    SimLinkStats stats;
+
+    qcc::Mutex rxLock;                         /**< Protects inFlight and arrived */
+    std::multimap<uint64_t, Datagram> inFlight;
+    std::deque<Datagram> arrived;
+    qcc::Event sourceEvent;
+    qcc::Event wakeEvent;
+    DeliveryThread deliveryThread;
+
+    /* Private copy constructor */
+    SimPacketStream(const SimPacketStream&);
+
+    /* Private assignment operator */
+    SimPacketStream& operator=(const SimPacketStream&);
+};
+
+}  /* namespace */
+
+#endif
@@ -0,0 +1,693 @@
+/**
+ * @file
+ * Checks the STUN message view and builder against StunMessage and times
+ * parsing and rendering the messages ICE and TURN send most often
+ */
+
+/******************************************************************************
+ * Copyright 2012, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#include <qcc/platform.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <qcc/IPAddress.h>
+#include <qcc/String.h>
+#include <qcc/StringUtil.h>
+#include <qcc/Util.h>
+#include <alljoyn/version.h>
+
+#include <StunAttribute.h>
+#include <StunMessage.h>
+#include <StunMessageBuilder.h>
+#include <StunMessageView.h>
+#include <StunTransactionID.h>
+
+#include "BenchUtil.h"
+
+#define QCC_MODULE "STUN_MESSAGE"
+
+using namespace qcc;
+using namespace std;
+using namespace ajn;
+
+typedef vector<uint8_t> Packet;
+
+static const uint8_t g_key[] = "bench-hmac-key";
+static const size_t KEY_LEN = sizeof(g_key) - 1;
+static const qcc::String g_username("RFRAG:LFRAG");
+
+static const size_t MAX_MSG_SIZE = 1500;
+
+/* REQUESTED-TRANSPORT protocol number for UDP */
+static const uint8_t TRANSPORT_UDP = 17;
+
+/* Render a StunMessage the way Stun::SendStunMessage does */
+static Packet Render(const StunMessage& msg)
+{
+    Packet rendered(msg.RenderSize());
+    uint8_t* pos = &rendered[0];
+    size_t size = rendered.size();
+    ScatterGatherList sg;
+    if (msg.RenderBinary(pos, size, sg) != ER_OK) {
+        return Packet();
+    }
+    Packet packet(sg.DataSize());
+    sg.CopyToBuffer(&packet[0], packet.size());
+    return packet;
+}
+
+static Packet Payload(size_t len)
+{
+    Packet payload(len);
+    for (size_t i = 0; i < len; ++i) {
+        payload[i] = static_cast<uint8_t>(i * 7);
+    }
+    return payload;
+}
+
+/* The messages each side of an ICE session exchanges, rendered with StunMessage */
+static void BuildCorpus(vector<Packet>& corpus)
+{
+    IPAddress v4("192.168.1.20");
+    IPAddress v6("fe80::1234:5678:9abc:def0");
+
+    /* Connectivity check */
+    StunMessage check(STUN_MSG_REQUEST_CLASS, STUN_MSG_BINDING_METHOD, g_key, KEY_LEN);
+    check.AddAttribute(new StunAttributeUsername(g_username));
+    check.AddAttribute(new StunAttributePriority(0x6e0001ff));
+    check.AddAttribute(new StunAttributeIceControlling(0x0123456789abcdefULL));
+    check.AddAttribute(new StunAttributeUseCandidate());
+    check.AddAttribute(new StunAttributeRequestedTransport(TRANSPORT_UDP));
+    check.AddAttribute(new StunAttributeMessageIntegrity(check));
+    check.AddAttribute(new StunAttributeFingerprint(check));
+    corpus.push_back(Render(check));
+
+    /* Its response */
+    StunTransactionID tid;
+    check.GetTransactionID(tid);
+    StunMessage response(STUN_MSG_RESPONSE_CLASS, STUN_MSG_BINDING_METHOD, g_key, KEY_LEN, tid);
+    response.AddAttribute(new StunAttributeXorMappedAddress(response, v4, 49152));
+    response.AddAttribute(new StunAttributeMessageIntegrity(response));
+    response.AddAttribute(new StunAttributeFingerprint(response));
+    corpus.push_back(Render(response));
+
+    /* NAT keep-alive */
+    StunMessage keepAlive(STUN_MSG_INDICATION_CLASS, STUN_MSG_BINDING_METHOD, g_key, KEY_LEN);
+    corpus.push_back(Render(keepAlive));
+
+    /* Relayed data going out and coming in, small and MTU sized */
+    const size_t sizes[] = { 61, 1200 };
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+        Packet payload = Payload(sizes[i]);
+        ScatterGatherList sg;
+        sg.AddBuffer(&payload[0], payload.size());
+        sg.SetDataSize(payload.size());
+
+        StunMessage send(STUN_MSG_INDICATION_CLASS, STUN_MSG_SEND_METHOD, g_key, KEY_LEN);
+        send.AddAttribute(new StunAttributeUsername(g_username));
+        send.AddAttribute(new StunAttributeXorPeerAddress(send, (i == 0) ? v4 : v6, 50000));
+        send.AddAttribute(new StunAttributeAllocatedXorServerReflexiveAddress(send, v4, 50001));
+        send.AddAttribute(new StunAttributeData(sg));
+        send.AddAttribute(new StunAttributeMessageIntegrity(send));
+        send.AddAttribute(new StunAttributeFingerprint(send));
+        corpus.push_back(Render(send));
+
+        StunMessage data(STUN_MSG_INDICATION_CLASS, STUN_MSG_DATA_METHOD, g_key, KEY_LEN);
+        data.AddAttribute(new StunAttributeXorPeerAddress(data, (i == 0) ? v4 : v6, 50000));
+        data.AddAttribute(new StunAttributeData(sg));
+        data.AddAttribute(new StunAttributeFingerprint(data));
+        corpus.push_back(Render(data));
+    }
+
+    /* TURN refresh and its response */
+    StunMessage refresh(STUN_MSG_REQUEST_CLASS, STUN_MSG_REFRESH_METHOD, g_key, KEY_LEN);
+    refresh.AddAttribute(new StunAttributeUsername(g_username));
+    refresh.AddAttribute(new StunAttributeSoftware(String("AllJoyn ") + String(GetVersion())));
+    refresh.AddAttribute(new StunAttributeLifetime(300));
+    refresh.AddAttribute(new StunAttributeRequestedTransport(TRANSPORT_UDP));
+    refresh.AddAttribute(new StunAttributeMessageIntegrity(refresh));
+    refresh.AddAttribute(new StunAttributeFingerprint(refresh));
+    corpus.push_back(Render(refresh));
+
+    refresh.GetTransactionID(tid);
+    StunMessage refreshed(STUN_MSG_RESPONSE_CLASS, STUN_MSG_REFRESH_METHOD, g_key, KEY_LEN, tid);
+    refreshed.AddAttribute(new StunAttributeLifetime(600));
+    refreshed.AddAttribute(new StunAttributeFingerprint(refreshed));
+    corpus.push_back(Render(refreshed));
+
+    /* Role conflict */
+    check.GetTransactionID(tid);
+    StunMessage error(STUN_MSG_ERROR_CLASS, STUN_MSG_BINDING_METHOD, g_key, KEY_LEN, tid);
+    error.AddAttribute(new StunAttributeErrorCode(STUN_ERR_CODE_ROLE_CONFLICT, "Role Conflict"));
+    error.AddAttribute(new StunAttributeFingerprint(error));
+    corpus.push_back(Render(error));
+}
+
+static bool LoadCapture(const char* fileName, vector<Packet>& corpus)
+{
+    FILE* fp = fopen(fileName, "rb");
+    if (!fp) {
+        printf("Unable to open %s\n", fileName);
+        return false;
+    }
+    uint8_t len[2];
+    while (fread(len, 1, 2, fp) == 2) {
+        Packet packet((len[0] << 8) | len[1]);
+        if (packet.size() && (fread(&packet[0], 1, packet.size(), fp) != packet.size())) {
+            printf("Truncated capture %s\n", fileName);
+            fclose(fp);
+            return false;
+        }
+        corpus.push_back(packet);
+    }
+    fclose(fp);
+    return true;
+}
+
+static bool WriteCapture(const char* fileName, const vector<Packet>& corpus)
+{
+    FILE* fp = fopen(fileName, "wb");
+    if (!fp) {
+        printf("Unable to create %s\n", fileName);
+        return false;
+    }
+    for (size_t i = 0; i < corpus.size(); ++i) {
+        uint8_t len[2] = { static_cast<uint8_t>(corpus[i].size() >> 8), static_cast<uint8_t>(corpus[i].size()) };
+        fwrite(len, 1, 2, fp);
+        fwrite(&corpus[i][0], 1, corpus[i].size(), fp);
+    }
+    fclose(fp);
+    return true;
+}
+
+/* The attribute types StunMessage::Parse keeps; it skips the rest */
+static bool IsKnown(StunAttrType type)
+{
+    switch (type) {
+    case STUN_ATTR_MAPPED_ADDRESS:
+    case STUN_ATTR_USERNAME:
+    case STUN_ATTR_MESSAGE_INTEGRITY:
+    case STUN_ATTR_ERROR_CODE:
+    case STUN_ATTR_UNKNOWN_ATTRIBUTES:
+    case STUN_ATTR_XOR_MAPPED_ADDRESS:
+    case STUN_ATTR_SOFTWARE:
+    case STUN_ATTR_ALTERNATE_SERVER:
+    case STUN_ATTR_FINGERPRINT:
+    case STUN_ATTR_PRIORITY:
+    case STUN_ATTR_USE_CANDIDATE:
+    case STUN_ATTR_ICE_CHECK_FLAG:
+    case STUN_ATTR_ICE_CONTROLLED:
+    case STUN_ATTR_ICE_CONTROLLING:
+    case STUN_ATTR_CHANNEL_NUMBER:
+    case STUN_ATTR_LIFETIME:
+    case STUN_ATTR_XOR_PEER_ADDRESS:
+    case STUN_ATTR_ALLOCATED_XOR_SERVER_REFLEXIVE_ADDRESS:
+    case STUN_ATTR_DATA:
+    case STUN_ATTR_XOR_RELAYED_ADDRESS:
+    case STUN_ATTR_EVEN_PORT:
+    case STUN_ATTR_REQUESTED_TRANSPORT:
+    case STUN_ATTR_DONT_FRAGMENT:
+    case STUN_ATTR_RESERVATION_TOKEN:
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+/* Compare one attribute as parsed by StunMessage with the view's copy */
+static bool CompareAttribute(const StunAttribute* attr, const StunMessageView& view, size_t index)
+{
+    StunAttrType type = attr->GetType();
+    const uint8_t* value;
+    uint16_t len;
+    uint32_t u32;
+    uint64_t u64;
+    IPAddress addr;
+    uint16_t port;
+
+    if (view.GetAttributeType(index) != type) {
+        return false;
+    }
+
+    /* The view looks attributes up by type, so only the first of each type can be compared */
+    for (size_t i = 0; i < index; ++i) {
+        if (view.GetAttributeType(i) == type) {
+            return true;
+        }
+    }
+
+    switch (type) {
+    case STUN_ATTR_USERNAME:
+    {
+        qcc::String username;
+        static_cast<const StunAttributeUsername*>(attr)->GetUsername(username);
+        view.Find(type, value, len);
+        return username == qcc::String(reinterpret_cast<const char*>(value), len);
+    }
+
+    case STUN_ATTR_DATA:
+    {
+        const ScatterGatherList& data = static_cast<const StunAttributeData*>(attr)->GetData();
+        view.Find(type, value, len);
+        return (data.DataSize() == len) && ((len == 0) || (::memcmp(data.Begin()->buf, value, len) == 0));
+    }
+
+    case STUN_ATTR_PRIORITY:
+        return view.GetUint32(type, u32) && (u32 == static_cast<const StunAttributePriority*>(attr)->GetPriority());
+
+    case STUN_ATTR_LIFETIME:
+        return view.GetUint32(type, u32) && (u32 == static_cast<const StunAttributeLifetime*>(attr)->GetLifetime());
+
+    case STUN_ATTR_ICE_CONTROLLING:
+        return view.GetUint64(type, u64) && (u64 == static_cast<const StunAttributeIceControlling*>(attr)->GetValue());
+
+    case STUN_ATTR_ICE_CONTROLLED:
+        return view.GetUint64(type, u64) && (u64 == static_cast<const StunAttributeIceControlled*>(attr)->GetValue());
+
+    case STUN_ATTR_XOR_MAPPED_ADDRESS:
+    case STUN_ATTR_XOR_PEER_ADDRESS:
+    case STUN_ATTR_XOR_RELAYED_ADDRESS:
+    case STUN_ATTR_ALLOCATED_XOR_SERVER_REFLEXIVE_ADDRESS:
+    {
+        IPAddress attrAddr;
+        uint16_t attrPort;
+        static_cast<const StunAttributeXorMappedAddress*>(attr)->GetAddress(attrAddr, attrPort);
+        return view.GetAddress(type, addr, port) && (addr == attrAddr) && (port == attrPort);
+    }
+
+    default:
+        return true;
+    }
+}
+
+/*
+ * Every message the view accepts must also be accepted by StunMessage and
+ * give the same attributes.  StunMessage::Parse is only run on what the view
+ * accepts since it trusts the sizes of fixed length attributes.
+ */
+static bool Compare(const uint8_t* buf, size_t len, bool* accepted = NULL)
+{
+    StunMessageView view;
+    if ((len < StunMessage::MIN_MSG_SIZE) || !StunMessage::IsStunMessage(buf, len) || (view.Parse(buf, len) != ER_OK)) {
+        if (accepted) {
+            *accepted = false;
+        }
+        return true;
+    }
+    if (accepted) {
+        *accepted = true;
+    }
+
+    StunMessage msg("", g_key, KEY_LEN);
+    const uint8_t* pos = buf;
+    size_t size = len;
+    QStatus status = msg.Parse(pos, size);
+    if (status != ER_OK) {
+        printf("StunMessage::Parse() rejects a message the view accepts: %s\n", QCC_StatusText(status));
+        return false;
+    }
+    if ((len - size) != view.Size()) {
+        printf("Parse() sizes differ (%u != %u)\n", (unsigned int) (len - size), (unsigned int) view.Size());
+        return false;
+    }
+
+    StunTransactionID tid, viewTid;
+    msg.GetTransactionID(tid);
+    view.GetTransactionID(viewTid);
+    if ((msg.GetTypeClass() != view.GetTypeClass()) || (msg.GetTypeMethod() != view.GetTypeMethod()) || (tid != viewTid)) {
+        printf("Header fields differ\n");
+        return false;
+    }
+
+    /* The view ignores what follows MESSAGE-INTEGRITY apart from FINGERPRINT */
+    size_t index = 0;
+    bool sawIntegrity = false;
+    for (StunMessage::const_iterator it = msg.Begin(); it != msg.End(); ++it) {
+        StunAttrType type = (*it)->GetType();
+        if (sawIntegrity && (type != STUN_ATTR_FINGERPRINT)) {
+            continue;
+        }
+        while ((index < view.GetNumAttributes()) && !IsKnown(view.GetAttributeType(index))) {
+            ++index;
+        }
+        if ((index == view.GetNumAttributes()) || !CompareAttribute(*it, view, index)) {
+            printf("Attribute %04x differs\n", type);
+            return false;
+        }
+        sawIntegrity = sawIntegrity || (type == STUN_ATTR_MESSAGE_INTEGRITY);
+        ++index;
+    }
+    while ((index < view.GetNumAttributes()) && !IsKnown(view.GetAttributeType(index))) {
+        ++index;
+    }
+    if (index != view.GetNumAttributes()) {
+        printf("View has extra attributes\n");
+        return false;
+    }
+    return true;
+}
+
+/* Build the corpus requests and indications again with the builder; the octets must match */
+static bool CheckBuilder(const vector<Packet>& corpus)
+{
+    uint8_t buf[MAX_MSG_SIZE];
+    bool ok = true;
+
+    for (size_t i = 0; i < corpus.size(); ++i) {
+        StunMessageView view;
+        if ((corpus[i].size() < StunMessage::MIN_MSG_SIZE) || (view.Parse(&corpus[i][0], corpus[i].size()) != ER_OK)) {
+            continue;
+        }
+
+        StunTransactionID tid;
+        view.GetTransactionID(tid);
+        StunMessageBuilder msg(buf, sizeof(buf), view.GetTypeClass(), view.GetTypeMethod(), tid);
+        QStatus status = ER_OK;
+        for (size_t a = 0; (status == ER_OK) && (a < view.GetNumAttributes()); ++a) {
+            StunAttrType type = view.GetAttributeType(a);
+            const uint8_t* value;
+            uint16_t len;
+            IPAddress addr;
+            uint16_t port;
+
+            switch (type) {
+            case STUN_ATTR_MESSAGE_INTEGRITY:
+                status = msg.AddMessageIntegrity(g_key, KEY_LEN);
+                break;
+
+            case STUN_ATTR_FINGERPRINT:
+                status = msg.AddFingerprint();
+                break;
+
+            case STUN_ATTR_XOR_MAPPED_ADDRESS:
+            case STUN_ATTR_XOR_PEER_ADDRESS:
+            case STUN_ATTR_XOR_RELAYED_ADDRESS:
+            case STUN_ATTR_ALLOCATED_XOR_SERVER_REFLEXIVE_ADDRESS:
+                view.GetAddress(type, addr, port);
+                status = msg.AddXorAddress(type, addr, port);
+                break;
+
+            default:
+                view.Find(type, value, len);
+                status = msg.AddAttribute(type, value, len);
+                break;
+            }
+        }
+        if ((status != ER_OK) || (msg.Size() != corpus[i].size()) || (::memcmp(buf, &corpus[i][0], msg.Size()) != 0)) {
+            printf("Builder output differs from StunMessage for message %u\n", (unsigned int) i);
+            ok = false;
+        }
+        if (view.HasMessageIntegrity() && (view.CheckMessageIntegrity(g_key, KEY_LEN) != ER_OK)) {
+            printf("MESSAGE-INTEGRITY of message %u does not verify\n", (unsigned int) i);
+            ok = false;
+        }
+        if (view.HasMessageIntegrity() && (view.CheckMessageIntegrity(g_key, KEY_LEN - 1) == ER_OK)) {
+            printf("MESSAGE-INTEGRITY of message %u verifies with the wrong key\n", (unsigned int) i);
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+static void Mutate(Packet& packet)
+{
+    switch (Rand32() % 5) {
+    case 0:
+        if (packet.size()) {
+            packet[Rand32() % packet.size()] ^= static_cast<uint8_t>(1 << (Rand32() % 8));
+        }
+        break;
+
+    case 1:
+        if (packet.size()) {
+            packet[Rand32() % packet.size()] = static_cast<uint8_t>(Rand32());
+        }
+        break;
+
+    case 2:
+        packet.resize(packet.size() ? Rand32() % packet.size() : 0);
+        break;
+
+    case 3:
+        /* Attribute lengths are the interesting target; the fingerprint is fixed up below */
+        if (packet.size() > StunMessage::MIN_MSG_SIZE + 4) {
+            size_t at = StunMessage::MIN_MSG_SIZE + ((Rand32() % (packet.size() - StunMessage::MIN_MSG_SIZE - 4)) & ~3);
+            packet[at + 3] = static_cast<uint8_t>(Rand32());
+        }
+        break;
+
+    default:
+        packet.push_back(static_cast<uint8_t>(Rand32()));
+        break;
+    }
+}
+
+/* Recompute a trailing FINGERPRINT so mutations get past the CRC check */
+static void FixFingerprint(Packet& packet)
+{
+    size_t size = packet.size();
+    if ((size >= StunMessage::MIN_MSG_SIZE + 8) &&
+        (packet[size - 8] == (STUN_ATTR_FINGERPRINT >> 8)) && (packet[size - 7] == (STUN_ATTR_FINGERPRINT & 0xff))) {
+        uint32_t crc = StunAttributeFingerprint::ComputeCRC(&packet[0], size - 8) ^ StunAttributeFingerprint::MAGIC_XOR;
+        packet[size - 4] = static_cast<uint8_t>(crc >> 24);
+        packet[size - 3] = static_cast<uint8_t>(crc >> 16);
+        packet[size - 2] = static_cast<uint8_t>(crc >> 8);
+        packet[size - 1] = static_cast<uint8_t>(crc);
+    }
+}
+
+/* Check a mutated packet, half of the time with a valid fingerprint */
+static bool CheckMutated(Packet& packet, bool& accepted)
+{
+    if (Rand32() & 1) {
+        FixFingerprint(packet);
+    }
+    return Compare(packet.size() ? &packet[0] : NULL, packet.size(), &accepted);
+}
+
+/* What the TURN receive path does with every packet, the old way and the new */
+static uint32_t RunParse(const Packet& packet)
+{
+    uint8_t* dummyHmac = new uint8_t[KEY_LEN];
+    StunMessage msg("", dummyHmac, KEY_LEN);
+    const uint8_t* buf = &packet[0];
+    size_t size = packet.size();
+    uint32_t sum = 0;
+    if (msg.Parse(buf, size) == ER_OK) {
+        for (StunMessage::const_iterator it = msg.Begin(); it != msg.End(); ++it) {
+            if ((*it)->GetType() == STUN_ATTR_DATA) {
+                sum += reinterpret_cast<StunAttributeData*>(*it)->GetData().DataSize();
+            }
+        }
+    }
+    delete [] dummyHmac;
+    return sum;
+}
+
+static uint32_t RunView(const Packet& packet)
+{
+    StunMessageView view;
+    const uint8_t* data;
+    uint16_t len = 0;
+    if (view.Parse(&packet[0], packet.size()) == ER_OK) {
+        view.Find(STUN_ATTR_DATA, data, len);
+    }
+    return len;
+}
+
+/* What the TURN send path does with every packet, the old way and the new */
+static uint8_t g_txBuf[MAX_MSG_SIZE];
+
+static uint32_t RunRender(const Packet& payload)
+{
+    ScatterGatherList sg;
+    sg.AddBuffer(&payload[0], payload.size());
+    sg.SetDataSize(payload.size());
+
+    StunMessage msg(STUN_MSG_INDICATION_CLASS, STUN_MSG_SEND_METHOD, g_key, KEY_LEN);
+    msg.AddAttribute(new StunAttributeUsername(g_username));
+    msg.AddAttribute(new StunAttributeXorPeerAddress(msg, IPAddress("192.168.1.20"), 50000));
+    msg.AddAttribute(new StunAttributeAllocatedXorServerReflexiveAddress(msg, IPAddress("192.168.1.20"), 50001));
+    msg.AddAttribute(new StunAttributeData(sg));
+    msg.AddAttribute(new StunAttributeMessageIntegrity(msg));
+    msg.AddAttribute(new StunAttributeFingerprint(msg));
+
+    uint8_t* pos = g_txBuf;
+    size_t size = msg.RenderSize();
+    ScatterGatherList msgSG;
+    msg.RenderBinary(pos, size, msgSG);
+    return msgSG.DataSize();
+}
+
+static uint32_t RunBuild(const Packet& payload)
+{
+    StunMessageBuilder msg(g_txBuf, sizeof(g_txBuf), STUN_MSG_INDICATION_CLASS, STUN_MSG_SEND_METHOD);
+    msg.AddString(STUN_ATTR_USERNAME, g_username);
+    msg.AddXorAddress(STUN_ATTR_XOR_PEER_ADDRESS, IPAddress("192.168.1.20"), 50000);
+    msg.AddXorAddress(STUN_ATTR_ALLOCATED_XOR_SERVER_REFLEXIVE_ADDRESS, IPAddress("192.168.1.20"), 50001);
+    msg.AddAttribute(STUN_ATTR_DATA, &payload[0], payload.size());
+    msg.AddMessageIntegrity(g_key, KEY_LEN);
+    msg.AddFingerprint();
+    return msg.Size();
+}
+
+struct Test {
+    const char* name;
+    uint32_t (*run)(const Packet& packet);
+    bool render;
+};
+
+static const Test g_tests[] = {
+    { "parse",  RunParse,  false },
+    { "view",   RunView,   false },
+    { "render", RunRender, true  },
+    { "build",  RunBuild,  true  }
+};
+
+static const size_t NUM_TESTS = sizeof(g_tests) / sizeof(g_tests[0]);
+
+static const size_t g_payloadSizes[] = { 61, 576, 1200 };
+
+static const size_t NUM_PAYLOAD_SIZES = sizeof(g_payloadSizes) / sizeof(g_payloadSizes[0]);
+
+/* One timed operation: run a test on a packet */
+struct RunTest {
+    RunTest(const Test& test, const Packet& packet) : test(test), packet(packet) { }
+    uint32_t operator()() const { return test.run(packet); }
+    const Test& test;
+    const Packet& packet;
+};
+
+static uint64_t Time(const Test& test, const Packet& packet, double& nsPerOp)
+{
+    uint64_t elapsed;
+    uint64_t ops = RunTimed(RunTest(test, packet), elapsed);
+    nsPerOp = (elapsed * 1000000.0) / ops;
+    return (ops * 1000) / elapsed;
+}
+
+static void usage(void)
+{
+    printf("Usage: stunbench [-h] [-c <capture>] [-w <capture>] [-f <iterations>] [-t <ms>]\n\n");
+    printf("Options:\n");
+    printf("   -h               - Print this help message\n");
+    printf("   -c <capture>     - Use the packets in a capture file instead of the built in ones\n");
+    printf("   -w <capture>     - Write the built in packets to a capture file and exit\n");
+    printf("   -f <iterations>  - Number of mutated packets to check (default 100000)\n");
+    printf("   -t <ms>          - Time spent on each test and packet (default 250)\n");
+    printf("\n");
+    printf("A capture file holds UDP payloads, each preceded by its length in two octets\n");
+    printf("in network byte order.\n");
+    printf("\n");
+}
+
+int main(int argc, char** argv)
+{
+    const char* captureName = NULL;
+    const char* writeName = NULL;
+    uint32_t iterations = 100000;
+
+    printf("AllJoyn Library version: %s\n", ajn::GetVersion());
+    printf("AllJoyn Library build info: %s\n", ajn::GetBuildInfo());
+
+    /* Parse command line args */
+    for (int i = 1; i < argc; ++i) {
+        if (::strcmp("-h", argv[i]) == 0) {
+            usage();
+            exit(0);
+        } else if ((::strcmp("-c", argv[i]) == 0) && ((i + 1) < argc)) {
+            captureName = argv[++i];
+        } else if ((::strcmp("-w", argv[i]) == 0) && ((i + 1) < argc)) {
+            writeName = argv[++i];
+        } else if ((::strcmp("-f", argv[i]) == 0) && ((i + 1) < argc)) {
+            iterations = StringToU32(argv[++i], 10, 100000);
+        } else if ((::strcmp("-t", argv[i]) == 0) && ((i + 1) < argc)) {
+            g_runMs = StringToU32(argv[++i], 10, 250);
+        } else {
+            printf("Unknown option %s\n", argv[i]);
+            usage();
+            exit(1);
+        }
+    }
+
+    vector<Packet> corpus;
+    if (captureName) {
+        if (!LoadCapture(captureName, corpus)) {
+            return 1;
+        }
+    } else {
+        BuildCorpus(corpus);
+    }
+    if (writeName) {
+        return WriteCapture(writeName, corpus) ? 0 : 1;
+    }
+    if (corpus.empty()) {
+        printf("No packets\n");
+        return 1;
+    }
+
+    /* Every packet must parse the same way both ways before we bother timing anything */
+    for (size_t i = 0; i < corpus.size(); ++i) {
+        bool accepted;
+        if (!Compare(corpus[i].size() ? &corpus[i][0] : NULL, corpus[i].size(), &accepted)) {
+            printf("Packet %u parses differently\n", (unsigned int) i);
+            return 1;
+        }
+        if (!accepted && !captureName) {
+            printf("Packet %u is not accepted by the view\n", (unsigned int) i);
+            return 1;
+        }
+    }
+    if (!CheckBuilder(corpus) || !Fuzz(corpus, iterations, "packet", Mutate, CheckMutated)) {
+        return 1;
+    }
+
+    printf("%-8s %8s %8s %12s %10s\n", "test", "packet", "size", "packets/s", "ns/op");
+    for (size_t t = 0; t < NUM_TESTS; ++t) {
+        const Test& test = g_tests[t];
+        if (test.render) {
+            continue;
+        }
+        for (size_t i = 0; i < corpus.size(); ++i) {
+            if (corpus[i].size() < StunMessage::MIN_MSG_SIZE) {
+                continue;
+            }
+            double nsPerOp;
+            uint64_t pps = Time(test, corpus[i], nsPerOp);
+            printf("%-8s %8u %8u %12u %10.1f\n", test.name, (unsigned int) i, (unsigned int) corpus[i].size(),
+                   (unsigned int) pps, nsPerOp);
+        }
+    }
+    printf("\n%-8s %8s %12s %10s\n", "test", "payload", "packets/s", "ns/op");
+    for (size_t t = 0; t < NUM_TESTS; ++t) {
+        const Test& test = g_tests[t];
+        if (!test.render) {
+            continue;
+        }
+        for (size_t s = 0; s < NUM_PAYLOAD_SIZES; ++s) {
+            Packet payload = Payload(g_payloadSizes[s]);
+            double nsPerOp;
+            uint64_t pps = Time(test, payload, nsPerOp);
+            printf("%-8s %8u %12u %10.1f\n", test.name, (unsigned int) payload.size(), (unsigned int) pps, nsPerOp);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,269 @@
+/**
+ * @file
+ * Rate at which the TCP transport of a daemon accepts and authenticates a storm of incoming
+ * connections.
+ */
+
+/******************************************************************************
+ * Copyright 2012, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#include <qcc/platform.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <qcc/Debug.h>
+#include <qcc/IPAddress.h>
+#include <qcc/Socket.h>
+#include <qcc/SocketStream.h>
+#include <qcc/String.h>
+#include <qcc/StringUtil.h>
+#include <qcc/Thread.h>
+#include <qcc/Util.h>
+
+#include <Status.h>
+
+#include "BenchUtil.h"
+#include "Bus.h"
+#include "BusController.h"
+#include "DaemonConfig.h"
+#include "DaemonTransport.h"
+#include "MicroTimestamp.h"
+#include "TCPTransport.h"
+#include "Transport.h"
+#include "TransportList.h"
+
+#define QCC_MODULE "ALLJOYN"
+
+using namespace qcc;
+using namespace std;
+using namespace ajn;
+
+/* Time allowed for the daemon to answer a connection */
+static const uint32_t ReplyTimeout = 10000;
+
+/*
+ * Opens connections to the daemon one after the other.  In the connect mode a connection sends
+ * the first byte the protocol requires and an AUTH without a mechanism, which the daemon rejects
+ * as soon as an authentication worker has read it.  In the sasl mode it runs the ANONYMOUS
+ * authentication up to the OK of the daemon.  Either way a connection is only counted once the
+ * daemon has answered it, so the rate is that of the daemon and not of the listen backlog.
+ */
+class Stormer : public Thread {
+  public:
+    Stormer(const IPAddress& addr, uint16_t port, uint32_t count, bool sasl) :
+        Thread("Stormer"), addr(addr), port(port), count(count), sasl(sasl), errors(0) { }
+
+    const vector<uint32_t>& GetLatencies() const { return latencies; }
+    uint32_t GetErrors() const { return errors; }
+
+  protected:
+    ThreadReturn STDCALL Run(void* arg)
+    {
+        static const char saslHello[] = "\0AUTH ANONYMOUS\r\n";
+        static const char connectHello[] = "\0AUTH\r\n";
+        const char* hello = sasl ? saslHello : connectHello;
+        size_t helloLen = sasl ? (sizeof(saslHello) - 1) : (sizeof(connectHello) - 1);
+        const char* expected = sasl ? "OK" : "REJECTED";
+
+        for (uint32_t i = 0; i < count; ++i) {
+            uint64_t start = GetMicroTimestamp();
+            SocketFd sockFd;
+            QStatus status = Socket(QCC_AF_INET, QCC_SOCK_STREAM, sockFd);
+            if (status != ER_OK) {
+                ++errors;
+                continue;
+            }
+            SocketStream stream(sockFd);
+            status = qcc::Connect(sockFd, addr, port);
+            if (status == ER_OK) {
+                size_t sent;
+                status = stream.PushBytes(hello, helloLen, sent);
+            }
+            if (status == ER_OK) {
+                /* The daemon answers with a single line, OK followed by its GUID or REJECTED followed by its mechanisms */
+                char reply[128];
+                size_t got = 0;
+                while ((status == ER_OK) && (got < sizeof(reply)) && ((got < 2) || (reply[got - 1] != '\n'))) {
+                    size_t n;
+                    status = stream.PullBytes(reply + got, sizeof(reply) - got, n, ReplyTimeout);
+                    if ((status == ER_OK) && (n == 0)) {
+                        status = ER_SOCK_OTHER_END_CLOSED;
+                    }
+                    got += n;
+                }
+                if ((status == ER_OK) && ((got < strlen(expected)) || (strncmp(reply, expected, strlen(expected)) != 0))) {
+                    status = ER_AUTH_FAIL;
+                }
+            }
+            if (status == ER_OK) {
+                latencies.push_back(static_cast<uint32_t>(GetMicroTimestamp() - start));
+            } else {
+                ++errors;
+            }
+            stream.Close();
+        }
+        return 0;
+    }
+
+  private:
+    IPAddress addr;
+    uint16_t port;
+    uint32_t count;
+    bool sasl;
+    vector<uint32_t> latencies;
+    uint32_t errors;
+};
+
+static void usage(void)
+{
+    printf("Usage: tcpstormbench [-p <tcp port>] [-c <clients>] [-n <count>] [-m connect|sasl] [-i <idle>] [-r <rate>] [-a <per address>] [-w <threads>]\n\n");
+    printf("Options:\n");
+    printf("   -p <tcp port>      = Port the daemon listens on (default 9967)\n");
+    printf("   -c <clients>       = Number of threads opening connections at once (default 16)\n");
+    printf("   -n <count>         = Connections opened by each thread (default 500)\n");
+    printf("   -m <mode>          = Wait for the first answer of the daemon or authenticate (default sasl)\n");
+    printf("   -i <idle>          = Connections held open without sending anything (default 0)\n");
+    printf("   -r <rate>          = Connections per second allowed from one address, 0 for no limit (default 0)\n");
+    printf("   -a <per address>   = Connections authenticating at once from one address, 0 for no limit (default 0)\n");
+    printf("   -w <threads>       = Authentication workers started with the transport (default 2)\n");
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t port = 9967;
+    uint32_t numClients = 16;
+    uint32_t count = 500;
+    String mode("sasl");
+    uint32_t numIdle = 0;
+    uint32_t rate = 0;
+    uint32_t perAddr = 0;
+    uint32_t workers = 2;
+
+    for (int i = 1; i < argc; ++i) {
+        if ((0 == strcmp("-p", argv[i])) && (i + 1 < argc)) {
+            port = strtoul(argv[++i], NULL, 10);
+        } else if ((0 == strcmp("-c", argv[i])) && (i + 1 < argc)) {
+            numClients = strtoul(argv[++i], NULL, 10);
+        } else if ((0 == strcmp("-n", argv[i])) && (i + 1 < argc)) {
+            count = strtoul(argv[++i], NULL, 10);
+        } else if ((0 == strcmp("-m", argv[i])) && (i + 1 < argc)) {
+            mode = argv[++i];
+        } else if ((0 == strcmp("-i", argv[i])) && (i + 1 < argc)) {
+            numIdle = strtoul(argv[++i], NULL, 10);
+        } else if ((0 == strcmp("-r", argv[i])) && (i + 1 < argc)) {
+            rate = strtoul(argv[++i], NULL, 10);
+        } else if ((0 == strcmp("-a", argv[i])) && (i + 1 < argc)) {
+            perAddr = strtoul(argv[++i], NULL, 10);
+        } else if ((0 == strcmp("-w", argv[i])) && (i + 1 < argc)) {
+            workers = strtoul(argv[++i], NULL, 10);
+        } else {
+            usage();
+            exit(1);
+        }
+    }
+    if ((mode != "connect") && (mode != "sasl")) {
+        usage();
+        exit(1);
+    }
+    if (numClients == 0) {
+        numClients = 1;
+    }
+
+    /*
+     * The idle connections and every storming thread may be authenticating at once.  Nothing is
+     * ever completed so the completed connections only need the default room.  Every connection
+     * comes from the loopback address, so the limits on one address are off unless asked for.
+     */
+    String config = "<busconfig>"
+                    "  <type>alljoyn</type>"
+                    "  <limit auth_timeout=\"20000\"/>"
+                    "  <limit max_incomplete_connections=\"" + U32ToString(numIdle + numClients + 16) + "\"/>"
+                    "  <limit max_completed_connections=\"" + U32ToString(numIdle + numClients + 64) + "\"/>"
+                    "  <limit max_connection_rate=\"" + U32ToString(rate) + "\"/>"
+                    "  <limit max_incomplete_connections_per_address=\"" + U32ToString(perAddr) + "\"/>"
+                    "  <limit auth_threads=\"" + U32ToString(workers) + "\"/>"
+                    "</busconfig>";
+    DaemonConfig::Load(config.c_str());
+
+    String listenSpec = "tcp:r4addr=127.0.0.1,r4port=" + U32ToString(port);
+    TransportFactoryContainer cntr;
+    cntr.Add(new TransportFactory<DaemonTransport>(DaemonTransport::TransportName, true));
+    cntr.Add(new TransportFactory<TCPTransport>(TCPTransport::TransportName, false));
+    Bus* daemonBus = new Bus("tcpstormbench-daemon", cntr, listenSpec.c_str());
+    BusController* controller = new BusController(*daemonBus);
+    QStatus status = controller->Init(listenSpec);
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Failed to start the daemon listening on %s", listenSpec.c_str()));
+        exit(1);
+    }
+
+    IPAddress addr("127.0.0.1");
+
+    /* Connections that never send their first byte must not hold up anyone else */
+    vector<SocketFd> idle;
+    for (uint32_t i = 0; i < numIdle; ++i) {
+        SocketFd sockFd;
+        if (Socket(QCC_AF_INET, QCC_SOCK_STREAM, sockFd) == ER_OK) {
+            if (qcc::Connect(sockFd, addr, port) == ER_OK) {
+                idle.push_back(sockFd);
+            } else {
+                qcc::Close(sockFd);
+            }
+        }
+    }
+
+    vector<Stormer*> stormers;
+    for (uint32_t i = 0; i < numClients; ++i) {
+        stormers.push_back(new Stormer(addr, port, count, mode == "sasl"));
+    }
+    uint64_t start = GetMicroTimestamp();
+    for (size_t i = 0; i < stormers.size(); ++i) {
+        stormers[i]->Start();
+    }
+    vector<uint32_t> latencies;
+    uint32_t errors = 0;
+    for (size_t i = 0; i < stormers.size(); ++i) {
+        stormers[i]->Join();
+        latencies.insert(latencies.end(), stormers[i]->GetLatencies().begin(), stormers[i]->GetLatencies().end());
+        errors += stormers[i]->GetErrors();
+        delete stormers[i];
+    }
+    uint64_t elapsed = GetMicroTimestamp() - start;
+
+    sort(latencies.begin(), latencies.end());
+    printf("mode,clients,idle,connections,errors,accepts_per_sec,p50_us,p90_us,p99_us,max_us\n");
+    printf("%s,%u,%u,%u,%u,%.0f,%u,%u,%u,%u\n",
+           mode.c_str(), numClients, static_cast<uint32_t>(idle.size()),
+           static_cast<uint32_t>(latencies.size()), errors,
+           elapsed ? (latencies.size() * 1000000.0) / elapsed : 0.0,
+           Percentile(latencies, 500),
+           Percentile(latencies, 900),
+           Percentile(latencies, 990),
+           latencies.empty() ? 0 : latencies.back());
+
+    for (size_t i = 0; i < idle.size(); ++i) {
+        qcc::Close(idle[i]);
+    }
+
+    daemonBus->StopListen(listenSpec.c_str());
+    delete controller;
+    delete daemonBus;
+    DaemonConfig::Release();
+    return ((errors == 0) || (rate != 0) || (perAddr != 0)) ? 0 : 1;
+}
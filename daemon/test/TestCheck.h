@@ -0,0 +1,57 @@
+/**
+ * @file
+ * Check macro and result reporting shared by the daemon test programs.
+ */
+
+/******************************************************************************
+ * Copyright 2012, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#ifndef _ALLJOYN_TESTCHECK_H
+#define _ALLJOYN_TESTCHECK_H
+
+#include <qcc/platform.h>
+
+#include <cstdio>
+
+/** Number of checks that have failed so far */
+static size_t g_failures = 0;
+
+/**
+ * Report a failed check and keep going so a single run shows every failure.
+ */
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, # cond); \
+            ++g_failures; \
+        } \
+    } while (0)
+
+/**
+ * Print the outcome of the checks.
+ *
+ * @return  The exit status of the test program, 0 if every check passed.
+ */
+static inline int CheckResult()
+{
+    if (g_failures) {
+        printf("%u checks FAILED\n", static_cast<uint32_t>(g_failures));
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
+
+#endif
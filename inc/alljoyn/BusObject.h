@@ -38,6 +38,7 @@ namespace ajn {
 /** @internal Forward references */
 class BusAttachment;
 class MethodTable;
+class TypedBody;
 /// @endcond
 
 /**
@@ -126,6 +127,17 @@ class BusObject : public MessageReceiver {
      */
     QStatus MethodReply(const Message& msg, const MsgArg* args = NULL, size_t numArgs = 0);
 
+    /**
+     * Reply to a method call with compile-time typed arguments (see TypedArgs.h).
+     *
+     * @param msg      The method call message
+     * @param args     The typed reply arguments
+     * @return
+     *      - #ER_OK if successful
+     *      - An error status otherwise
+     */
+    QStatus MethodReply(const Message& msg, const TypedBody& args);
+
     /**
      * Reply to a method call with an error message.
      *
@@ -152,6 +152,8 @@ class HeaderFields {
  */
 class _Message;
 class BusAttachment;
+class TypedBody;
+class TypedReader;
 
 /**
  * Message is a reference counted (managed) version of _Message
@@ -275,6 +277,19 @@ class _Message {
      */
     QStatus GetArgs(const char* signature, ...);
 
+    /**
+     * Get a reader for unmarshaling the message body directly into typed values without going
+     * through MsgArgs. Applications normally call TypedUnpack() (see TypedArgs.h) rather than
+     * calling this method directly.
+     *
+     * @param[out] reader  Returns a reader positioned at the start of the message body.
+     *
+     * @return
+     *      - #ER_OK if successful
+     *      - #ER_BUS_MESSAGE_DECRYPTION_FAILED if the message body has not been decrypted.
+     */
+    QStatus GetBodyReader(TypedReader& reader) const;
+
     /**
      * Accessor function to get serial number for the message. Usually only important for
      * #MESSAGE_METHOD_CALL for matching up the reply to the call.
@@ -532,6 +547,18 @@ class _Message {
      */
     QStatus ReplyMsg(const Message& call, const MsgArg* args, size_t numArgs);
 
+    /**
+     * @internal
+     * Generate a method reply message from a method call with a typed message body.
+     *
+     * @param call        The call message - can be this message.
+     * @param body        The typed arguments for the reply
+     * @return
+     *      - #ER_OK if successful
+     *      - An error status otherwise
+     */
+    QStatus ReplyMsg(const Message& call, const TypedBody& body);
+
     /**
      * @internal
      * Generate an error message from a method call.
@@ -604,6 +631,31 @@ class _Message {
                     size_t numArgs,
                     uint8_t flags);
 
+    /**
+     * @internal
+     * Compose a method call message with a typed message body
+     *
+     * @param signature   The signature (checked against the body)
+     * @param destination The destination for this message
+     * @param sessionId   The sessionId to use for this method call or 0 for any
+     * @param objPath     The object the method call is being sent to
+     * @param iface       The interface for the method (can be NULL)
+     * @param methodName  The name of the method to call
+     * @param body        The typed method call arguments
+     * @param flags       A logical OR of the AllJoyn flags
+     * @return
+     *      - #ER_OK if successful
+     *      - An error status otherwise
+     */
+    QStatus CallMsg(const qcc::String& signature,
+                    const qcc::String& destination,
+                    SessionId sessionId,
+                    const qcc::String& objPath,
+                    const qcc::String& iface,
+                    const qcc::String& methodName,
+                    const TypedBody& body,
+                    uint8_t flags);
+
     /**
      * @internal
      * Compose a signal message
@@ -687,6 +739,20 @@ class _Message {
      */
     QStatus ReMarshal(const char* senderName = NULL);
 
+    /**
+     * @internal
+     * Replace the sender name of a received message without copying the body. The header is
+     * marshaled again into a block of its own which Deliver() sends ahead of the body, leaving
+     * the body where it was received. An encrypted message or a message with a time to live is
+     * marshaled again into a single buffer instead.
+     *
+     * @param senderName  The sender name to put in the message.
+     * @return
+     *      - #ER_OK if successful
+     *      - An error status otherwise
+     */
+    QStatus RewriteSender(const char* senderName);
+
     /**
      * @internal
      * Sets the serial number to the next available value for the bus attachment for this message.
@@ -786,6 +852,9 @@ class _Message {
     uint8_t* bufPos;             ///< Pointer to the position in buffer.
     uint8_t* bodyPtr;            ///< Pointer to start of message body.
 
+    uint8_t* _hdrBuf;            ///< Header block that replaces the header in msgBuf after RewriteSender(), otherwise NULL.
+    size_t hdrBufLen;            ///< Length of the header block including the padding before the body.
+
     uint16_t ttl;                ///< Time to live
     uint32_t timestamp;          ///< Timestamp (local time) for messages with a ttl (time to live).
 
@@ -837,9 +906,24 @@ class _Message {
                            const MsgArg* args,
                            uint8_t numArgs,
                            uint8_t flags,
-                           SessionId sessionId);
+                           SessionId sessionId,
+                           const TypedBody* typedBody = NULL);
+
+    QStatus BuildCallMsg(const qcc::String& signature,
+                         const qcc::String& destination,
+                         SessionId sessionId,
+                         const qcc::String& objPath,
+                         const qcc::String& iface,
+                         const qcc::String& methodName,
+                         const MsgArg* args,
+                         size_t numArgs,
+                         const TypedBody* typedBody,
+                         uint8_t flags);
+
+    QStatus BuildReplyMsg(const Message& call, const MsgArg* args, size_t numArgs, const TypedBody* typedBody);
 
     QStatus MarshalArgs(const MsgArg* arg, size_t numArgs);
+    QStatus GrowMsgBuf(size_t needed);
     void MarshalHeaderFields();
     size_t ComputeHeaderLen();
 
@@ -24,6 +24,7 @@
  ******************************************************************************/
 
 #include <qcc/platform.h>
+#include <vector>
 #include <qcc/String.h>
 #include <alljoyn/InterfaceDescription.h>
 #include <alljoyn/MessageReceiver.h>
@@ -41,6 +42,8 @@ namespace ajn {
 
 /** @internal Forward references */
 class BusAttachment;
+class SyncReplyContext;
+class TypedBody;
 
 /**
  * Each %ProxyBusObject instance represents a single DBus/AllJoyn object registered
@@ -555,6 +558,28 @@ class ProxyBusObject : public MessageReceiver {
                        uint32_t timeout = DefaultCallTimeout,
                        uint8_t flags = 0) const;
 
+    /**
+     * Make a synchronous method call from this object with compile-time typed arguments. The
+     * arguments are marshaled directly into the message without building MsgArgs, see
+     * TypedArgs.h. The reply can be unmarshaled directly into typed values with TypedUnpack().
+     *
+     * @param method       Method being invoked.
+     * @param args         The typed arguments for the method call
+     * @param replyMsg     The reply message received for the method call
+     * @param timeout      Timeout specified in milliseconds to wait for a reply
+     * @param flags        Logical OR of the message flags for this method call. The same flags as
+     *                     for the MsgArg version of MethodCall() apply.
+     *
+     * @return
+     *      - #ER_OK if the method call succeeded and the reply message type is #MESSAGE_METHOD_RET
+     *      - #ER_BUS_REPLY_IS_ERROR_MESSAGE if the reply message type is #MESSAGE_ERROR
+     */
+    QStatus MethodCall(const InterfaceDescription::Member& method,
+                       const TypedBody& args,
+                       Message& replyMsg,
+                       uint32_t timeout = DefaultCallTimeout,
+                       uint8_t flags = 0) const;
+
     /**
      * Make a synchronous method call from this object
      *
@@ -581,6 +606,35 @@ class ProxyBusObject : public MessageReceiver {
                        uint32_t timeout = DefaultCallTimeout,
                        uint8_t flags = 0) const;
 
+    /**
+     * Make a batch of synchronous calls to the same method from this object. All of the method
+     * calls are sent before waiting and the caller blocks once until every reply has been
+     * received or the timeout expires. This is much cheaper than making the same calls one at a
+     * time with MethodCall() because the calls are pipelined and share a single wait.
+     *
+     * @param method       Method being invoked.
+     * @param argsList     Array of numCalls argument lists, one per call (can be NULL if the method takes no arguments)
+     * @param numArgsList  Array of numCalls argument counts, one per call (can be NULL if the method takes no arguments)
+     * @param numCalls     The number of method calls to make
+     * @param replyMsgs    Returns the numCalls reply messages in the same order as the calls. Calls
+     *                     that did not complete get an internally generated error reply.
+     * @param timeout      Timeout specified in milliseconds to wait for all of the replies
+     * @param flags        Logical OR of the message flags for the method calls. The same flags as
+     *                     for MethodCall() apply except #ALLJOYN_FLAG_NO_REPLY_EXPECTED which is not allowed.
+     *
+     * @return
+     *      - #ER_OK if all of the method calls succeeded and all of the reply messages are type #MESSAGE_METHOD_RET
+     *      - #ER_BUS_REPLY_IS_ERROR_MESSAGE if any of the reply messages is type #MESSAGE_ERROR
+     *      - An error status otherwise
+     */
+    QStatus MethodCallBatch(const InterfaceDescription::Member& method,
+                            const MsgArg* const* argsList,
+                            const size_t* numArgsList,
+                            size_t numCalls,
+                            std::vector<Message>& replyMsgs,
+                            uint32_t timeout = DefaultCallTimeout,
+                            uint8_t flags = 0) const;
+
     /**
      * Make a fire-and-forget method call from this object. The caller will not be able to tell if
      * the method call was successful or not. This is equivalent to calling MethodCall() with
@@ -791,6 +845,28 @@ class ProxyBusObject : public MessageReceiver {
      */
     void SyncReplyHandler(Message& msg, void* context);
 
+    /**
+     * @internal
+     * Send the method calls held in a synchronous reply context and wait for the replies.
+     *
+     * @param method   Method being invoked.
+     * @param ctxt     Context holding the method call messages and receiving the replies.
+     * @param timeout  Timeout specified in milliseconds to wait for the replies.
+     */
+    QStatus SyncMethodCalls(const InterfaceDescription::Member& method, SyncReplyContext* ctxt, uint32_t timeout) const;
+
+    /**
+     * @internal
+     * Synchronous method call with either MsgArg or typed arguments.
+     */
+    QStatus MethodCall(const InterfaceDescription::Member& method,
+                       const MsgArg* args,
+                       size_t numArgs,
+                       const TypedBody* typedArgs,
+                       Message& replyMsg,
+                       uint32_t timeout,
+                       uint8_t flags) const;
+
     /**
      * @internal
      * Introspection method_reply handler. (Internal use only)
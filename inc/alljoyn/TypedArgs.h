@@ -0,0 +1,847 @@
+#ifndef _ALLJOYN_TYPEDARGS_H
+#define _ALLJOYN_TYPEDARGS_H
+/**
+ * @file
+ * This file defines a compile-time typed alternative to MsgArg for marshaling and unmarshaling
+ * message arguments. The signature is derived from the C++ types of the values and the values are
+ * written directly into the message buffer (or read directly from it) without building a tree of
+ * MsgArgs and without interpreting a signature string at runtime.
+ *
+ * The following C++ types are supported:
+ *
+ *  - uint8_t ('y'), bool ('b'), int16_t ('n'), uint16_t ('q'), int32_t ('i'), uint32_t ('u'),
+ *    int64_t ('x'), uint64_t ('t'), double ('d')
+ *  - qcc::String ('s') and TypedObjectPath ('o')
+ *  - std::vector<T> ('aT')
+ *  - std::map<K, V> ('a{KV}')
+ *  - std::pair<A, B> ('(AB)')
+ *  - Any user defined struct that has a TypedStruct specialization ('(...)'), for example:
+ *
+ * @code
+ *  struct Point { int32_t x; int32_t y; qcc::String label; };
+ *
+ *  namespace ajn {
+ *  template <> struct TypedStruct<Point> {
+ *      template <typename V> static void Members(V& v, Point& p) { v(p.x); v(p.y); v(p.label); }
+ *  };
+ *  }
+ *
+ *  std::vector<Point> points;
+ *  status = proxy.MethodCall(*member, TypedArgs<uint32_t, std::vector<Point> >(count, points), reply);
+ *  ...
+ *  status = TypedUnpack(reply, count, points);
+ * @endcode
+ */
+
+/******************************************************************************
+ * Copyright 2012, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#ifndef __cplusplus
+#error Only include TypedArgs.h in C++ code.
+#endif
+
+#include <qcc/platform.h>
+#include <qcc/String.h>
+#include <string.h>
+#include <map>
+#include <vector>
+#include <utility>
+#include <alljoyn/Message.h>
+#include <Status.h>
+
+namespace ajn {
+
+/**
+ * Writes typed values into a buffer in the AllJoyn wire format. A writer that is constructed
+ * without a buffer only counts bytes, this allows the same code to compute the marshaled size
+ * and to do the marshaling.
+ */
+class TypedWriter {
+  public:
+
+    /**
+     * Construct a writer that only computes the size of the marshaled data.
+     */
+    TypedWriter() : buf(NULL), pos(0), endianSwap(false), status(ER_OK) { }
+
+    /**
+     * Construct a writer that marshals into a buffer. The buffer must be 8 byte aligned and large
+     * enough for the size computed by a sizing writer.
+     *
+     * @param buf         The buffer to marshal into.
+     * @param endianSwap  True if values are to be byte swapped.
+     */
+    TypedWriter(uint8_t* buf, bool endianSwap) : buf(buf), pos(0), endianSwap(endianSwap), status(ER_OK) { }
+
+    /**
+     * Get the number of bytes written (or that would have been written) so far.
+     */
+    size_t GetSize() const { return pos; }
+
+    /**
+     * Get the status of the writer. Marshaling can only fail if an array is too big.
+     */
+    QStatus GetStatus() const { return status; }
+
+    /**
+     * Zero pad to an alignment boundary.
+     *
+     * @param alignment  Alignment, must be 1, 2, 4, or 8.
+     */
+    void Pad(size_t alignment)
+    {
+        size_t pad = (alignment - (pos & (alignment - 1))) & (alignment - 1);
+        if (buf) {
+            memset(buf + pos, 0, pad);
+        }
+        pos += pad;
+    }
+
+    /**
+     * Write a scalar value aligned on its natural boundary.
+     */
+    template <typename T>
+    void PutScalar(T val)
+    {
+        Pad(sizeof(T));
+        if (buf) {
+            if (endianSwap) {
+                const uint8_t* p = reinterpret_cast<const uint8_t*>(&val) + sizeof(T);
+                for (size_t i = 0; i < sizeof(T); ++i) {
+                    buf[pos + i] = *(--p);
+                }
+            } else {
+                memcpy(buf + pos, &val, sizeof(T));
+            }
+        }
+        pos += sizeof(T);
+    }
+
+    /**
+     * Write raw bytes without any alignment.
+     */
+    void PutBytes(const void* data, size_t len)
+    {
+        if (buf && len) {
+            memcpy(buf + pos, data, len);
+        }
+        pos += len;
+    }
+
+    /**
+     * Write a string type with a 32 bit length prefix and a nul terminator.
+     */
+    void PutString(const char* str, size_t len)
+    {
+        PutScalar(static_cast<uint32_t>(len));
+        PutBytes(str, len);
+        PutBytes("", 1);
+    }
+
+    /**
+     * Reserve space for an array length and pad to the element alignment.
+     *
+     * @param elemAlignment  Alignment of the array elements.
+     *
+     * @return  The position of the length which must be passed to EndArray().
+     */
+    size_t BeginArray(size_t elemAlignment)
+    {
+        PutScalar(static_cast<uint32_t>(0));
+        size_t lenPos = pos - 4;
+        Pad(elemAlignment);
+        return lenPos;
+    }
+
+    /**
+     * Patch in the length of an array after the elements have been written.
+     *
+     * @param lenPos     The position returned by BeginArray().
+     * @param elemStart  The position of the first array element.
+     */
+    void EndArray(size_t lenPos, size_t elemStart)
+    {
+        size_t len = pos - elemStart;
+        if (len > ALLJOYN_MAX_ARRAY_LEN) {
+            status = ER_BUS_BAD_LENGTH;
+        }
+        if (buf) {
+            size_t tmpPos = pos;
+            pos = lenPos;
+            PutScalar(static_cast<uint32_t>(len));
+            pos = tmpPos;
+        }
+    }
+
+  private:
+    uint8_t* buf;
+    size_t pos;
+    bool endianSwap;
+    QStatus status;
+};
+
+/**
+ * Reads typed values from a buffer in the AllJoyn wire format. All reads are bounds checked, the
+ * first failure is recorded and all subsequent reads fail.
+ */
+class TypedReader {
+  public:
+
+    /**
+     * Default constructor creates a reader for an empty buffer.
+     */
+    TypedReader() : buf(NULL), len(0), pos(0), endianSwap(false), status(ER_OK) { }
+
+    /**
+     * Construct a reader.
+     *
+     * @param buf         The buffer to unmarshal from. Must be 8 byte aligned.
+     * @param len         The length of the data in the buffer.
+     * @param endianSwap  True if values are to be byte swapped.
+     */
+    TypedReader(const uint8_t* buf, size_t len, bool endianSwap) : buf(buf), len(len), pos(0), endianSwap(endianSwap), status(ER_OK) { }
+
+    /**
+     * Get the current read position.
+     */
+    size_t GetPos() const { return pos; }
+
+    /**
+     * Get the number of bytes that have not been read yet.
+     */
+    size_t GetRemaining() const { return len - pos; }
+
+    /**
+     * Get the status of the reader.
+     */
+    QStatus GetStatus() const { return status; }
+
+    /**
+     * Record a failure.
+     *
+     * @return  Always returns false.
+     */
+    bool Fail(QStatus failure)
+    {
+        if (status == ER_OK) {
+            status = failure;
+        }
+        return false;
+    }
+
+    /**
+     * Skip padding up to an alignment boundary.
+     */
+    bool Align(size_t alignment)
+    {
+        size_t pad = (alignment - (pos & (alignment - 1))) & (alignment - 1);
+        if ((status != ER_OK) || (pad > (len - pos))) {
+            return Fail(ER_BUS_BAD_LENGTH);
+        }
+        pos += pad;
+        return true;
+    }
+
+    /**
+     * Read a scalar value aligned on its natural boundary.
+     */
+    template <typename T>
+    bool GetScalar(T& val)
+    {
+        if (!Align(sizeof(T)) || (sizeof(T) > (len - pos))) {
+            return Fail(ER_BUS_BAD_LENGTH);
+        }
+        if (endianSwap) {
+            uint8_t* p = reinterpret_cast<uint8_t*>(&val) + sizeof(T);
+            for (size_t i = 0; i < sizeof(T); ++i) {
+                *(--p) = buf[pos + i];
+            }
+        } else {
+            memcpy(&val, buf + pos, sizeof(T));
+        }
+        pos += sizeof(T);
+        return true;
+    }
+
+    /**
+     * Get a pointer to raw bytes in the buffer without any alignment.
+     */
+    bool GetBytes(const uint8_t*& data, size_t numBytes)
+    {
+        if ((status != ER_OK) || (numBytes > (len - pos))) {
+            return Fail(ER_BUS_BAD_LENGTH);
+        }
+        data = buf + pos;
+        pos += numBytes;
+        return true;
+    }
+
+    /**
+     * Read a string type with a 32 bit length prefix and a nul terminator.
+     */
+    bool GetString(const char*& str, size_t& strLen)
+    {
+        uint32_t l;
+        const uint8_t* data;
+        if (!GetScalar(l) || (l >= (len - pos)) || !GetBytes(data, l + 1)) {
+            return Fail(ER_BUS_BAD_LENGTH);
+        }
+        if (data[l] != 0) {
+            return Fail(ER_BUS_NOT_NUL_TERMINATED);
+        }
+        str = reinterpret_cast<const char*>(data);
+        strLen = l;
+        return true;
+    }
+
+    /**
+     * Read an array length and skip the padding before the first element.
+     *
+     * @param elemAlignment  Alignment of the array elements.
+     * @param[out] end       Returns the position of the end of the array.
+     */
+    bool BeginArray(size_t elemAlignment, size_t& end)
+    {
+        uint32_t l;
+        if (!GetScalar(l) || (l > ALLJOYN_MAX_ARRAY_LEN) || !Align(elemAlignment) || (l > (len - pos))) {
+            return Fail(ER_BUS_BAD_LENGTH);
+        }
+        end = pos + l;
+        return true;
+    }
+
+  private:
+    const uint8_t* buf;
+    size_t len;
+    size_t pos;
+    bool endianSwap;
+    QStatus status;
+};
+
+/**
+ * Wrapper for an object path so it can be distinguished from a string.
+ */
+struct TypedObjectPath {
+    TypedObjectPath() { }
+    TypedObjectPath(const qcc::String& path) : path(path) { }
+    qcc::String path;
+};
+
+/**
+ * Specialize this template to make a user defined struct marshalable. The specialization must
+ * have a static template member function Members() that calls the visitor on each member of the
+ * struct in order, see the example at the top of this file.
+ */
+template <typename T> struct TypedStruct;
+
+/**
+ * Type traits for marshaling a C++ type. The primary template handles user defined structs, all
+ * other supported types are handled by specializations.
+ */
+template <typename T> struct TypedArg;
+
+/**
+ * @internal
+ * Type traits shared by all of the scalar types.
+ */
+template <typename T, char TypeCode>
+struct TypedScalarArg {
+    static const size_t Alignment = sizeof(T);
+    static void AppendSignature(qcc::String& sig) { sig += TypeCode; }
+    static void Marshal(TypedWriter& writer, const T& val) { writer.PutScalar(val); }
+    static bool Unmarshal(TypedReader& reader, T& val) { return reader.GetScalar(val); }
+};
+
+/// @cond ALLJOYN_DEV
+template <> struct TypedArg<uint8_t> : public TypedScalarArg<uint8_t, 'y'> { };
+template <> struct TypedArg<int16_t> : public TypedScalarArg<int16_t, 'n'> { };
+template <> struct TypedArg<uint16_t> : public TypedScalarArg<uint16_t, 'q'> { };
+template <> struct TypedArg<int32_t> : public TypedScalarArg<int32_t, 'i'> { };
+template <> struct TypedArg<uint32_t> : public TypedScalarArg<uint32_t, 'u'> { };
+template <> struct TypedArg<int64_t> : public TypedScalarArg<int64_t, 'x'> { };
+template <> struct TypedArg<uint64_t> : public TypedScalarArg<uint64_t, 't'> { };
+template <> struct TypedArg<double> : public TypedScalarArg<double, 'd'> { };
+
+template <> struct TypedArg<bool> {
+    static const size_t Alignment = 4;
+    static void AppendSignature(qcc::String& sig) { sig += 'b'; }
+    static void Marshal(TypedWriter& writer, const bool& val) { writer.PutScalar(static_cast<uint32_t>(val ? 1 : 0)); }
+    static bool Unmarshal(TypedReader& reader, bool& val)
+    {
+        uint32_t b;
+        if (!reader.GetScalar(b)) {
+            return false;
+        }
+        if (b > 1) {
+            return reader.Fail(ER_BUS_BAD_VALUE);
+        }
+        val = (b == 1);
+        return true;
+    }
+};
+
+template <> struct TypedArg<qcc::String> {
+    static const size_t Alignment = 4;
+    static void AppendSignature(qcc::String& sig) { sig += 's'; }
+    static void Marshal(TypedWriter& writer, const qcc::String& val) { writer.PutString(val.c_str(), val.size()); }
+    static bool Unmarshal(TypedReader& reader, qcc::String& val)
+    {
+        const char* str;
+        size_t len;
+        if (!reader.GetString(str, len)) {
+            return false;
+        }
+        val.clear();
+        val.append(str, len);
+        return true;
+    }
+};
+
+template <> struct TypedArg<TypedObjectPath> {
+    static const size_t Alignment = 4;
+    static void AppendSignature(qcc::String& sig) { sig += 'o'; }
+    static void Marshal(TypedWriter& writer, const TypedObjectPath& val) { TypedArg<qcc::String>::Marshal(writer, val.path); }
+    static bool Unmarshal(TypedReader& reader, TypedObjectPath& val) { return TypedArg<qcc::String>::Unmarshal(reader, val.path); }
+};
+
+template <typename T> struct TypedArg<std::vector<T> > {
+    static const size_t Alignment = 4;
+    static void AppendSignature(qcc::String& sig)
+    {
+        sig += 'a';
+        TypedArg<T>::AppendSignature(sig);
+    }
+    static void Marshal(TypedWriter& writer, const std::vector<T>& val)
+    {
+        size_t lenPos = writer.BeginArray(TypedArg<T>::Alignment);
+        size_t elemStart = writer.GetSize();
+        for (typename std::vector<T>::const_iterator it = val.begin(); it != val.end(); ++it) {
+            TypedArg<T>::Marshal(writer, *it);
+        }
+        writer.EndArray(lenPos, elemStart);
+    }
+    static bool Unmarshal(TypedReader& reader, std::vector<T>& val)
+    {
+        size_t end;
+        val.clear();
+        if (!reader.BeginArray(TypedArg<T>::Alignment, end)) {
+            return false;
+        }
+        while (reader.GetPos() < end) {
+            val.push_back(T());
+            if (!TypedArg<T>::Unmarshal(reader, val.back())) {
+                return false;
+            }
+        }
+        return (reader.GetPos() == end) ? true : reader.Fail(ER_BUS_BAD_LENGTH);
+    }
+};
+
+/*
+ * Byte arrays are copied as a single block.
+ */
+template <> struct TypedArg<std::vector<uint8_t> > {
+    static const size_t Alignment = 4;
+    static void AppendSignature(qcc::String& sig) { sig += "ay"; }
+    static void Marshal(TypedWriter& writer, const std::vector<uint8_t>& val)
+    {
+        size_t lenPos = writer.BeginArray(1);
+        size_t elemStart = writer.GetSize();
+        if (!val.empty()) {
+            writer.PutBytes(&val[0], val.size());
+        }
+        writer.EndArray(lenPos, elemStart);
+    }
+    static bool Unmarshal(TypedReader& reader, std::vector<uint8_t>& val)
+    {
+        size_t end;
+        const uint8_t* data;
+        if (!reader.BeginArray(1, end)) {
+            return false;
+        }
+        size_t numBytes = end - reader.GetPos();
+        if (!reader.GetBytes(data, numBytes)) {
+            return false;
+        }
+        val.assign(data, data + numBytes);
+        return true;
+    }
+};
+
+/*
+ * Elements of a std::vector<bool> are packed bits that can't be referenced so they are unmarshaled
+ * one at a time into a bool.
+ */
+template <> struct TypedArg<std::vector<bool> > {
+    static const size_t Alignment = 4;
+    static void AppendSignature(qcc::String& sig) { sig += "ab"; }
+    static void Marshal(TypedWriter& writer, const std::vector<bool>& val)
+    {
+        size_t lenPos = writer.BeginArray(TypedArg<bool>::Alignment);
+        size_t elemStart = writer.GetSize();
+        for (std::vector<bool>::const_iterator it = val.begin(); it != val.end(); ++it) {
+            TypedArg<bool>::Marshal(writer, *it);
+        }
+        writer.EndArray(lenPos, elemStart);
+    }
+    static bool Unmarshal(TypedReader& reader, std::vector<bool>& val)
+    {
+        size_t end;
+        val.clear();
+        if (!reader.BeginArray(TypedArg<bool>::Alignment, end)) {
+            return false;
+        }
+        while (reader.GetPos() < end) {
+            bool b;
+            if (!TypedArg<bool>::Unmarshal(reader, b)) {
+                return false;
+            }
+            val.push_back(b);
+        }
+        return (reader.GetPos() == end) ? true : reader.Fail(ER_BUS_BAD_LENGTH);
+    }
+};
+
+template <typename K, typename V> struct TypedArg<std::map<K, V> > {
+    static const size_t Alignment = 4;
+    static void AppendSignature(qcc::String& sig)
+    {
+        sig += "a{";
+        TypedArg<K>::AppendSignature(sig);
+        TypedArg<V>::AppendSignature(sig);
+        sig += '}';
+    }
+    static void Marshal(TypedWriter& writer, const std::map<K, V>& val)
+    {
+        size_t lenPos = writer.BeginArray(8);
+        size_t elemStart = writer.GetSize();
+        for (typename std::map<K, V>::const_iterator it = val.begin(); it != val.end(); ++it) {
+            writer.Pad(8);
+            TypedArg<K>::Marshal(writer, it->first);
+            TypedArg<V>::Marshal(writer, it->second);
+        }
+        writer.EndArray(lenPos, elemStart);
+    }
+    static bool Unmarshal(TypedReader& reader, std::map<K, V>& val)
+    {
+        size_t end;
+        val.clear();
+        if (!reader.BeginArray(8, end)) {
+            return false;
+        }
+        while (reader.GetPos() < end) {
+            K key;
+            if (!reader.Align(8) || !TypedArg<K>::Unmarshal(reader, key) || !TypedArg<V>::Unmarshal(reader, val[key])) {
+                return false;
+            }
+        }
+        return (reader.GetPos() == end) ? true : reader.Fail(ER_BUS_BAD_LENGTH);
+    }
+};
+
+template <typename A, typename B> struct TypedArg<std::pair<A, B> > {
+    static const size_t Alignment = 8;
+    static void AppendSignature(qcc::String& sig)
+    {
+        sig += '(';
+        TypedArg<A>::AppendSignature(sig);
+        TypedArg<B>::AppendSignature(sig);
+        sig += ')';
+    }
+    static void Marshal(TypedWriter& writer, const std::pair<A, B>& val)
+    {
+        writer.Pad(8);
+        TypedArg<A>::Marshal(writer, val.first);
+        TypedArg<B>::Marshal(writer, val.second);
+    }
+    static bool Unmarshal(TypedReader& reader, std::pair<A, B>& val)
+    {
+        return reader.Align(8) && TypedArg<A>::Unmarshal(reader, val.first) && TypedArg<B>::Unmarshal(reader, val.second);
+    }
+};
+
+/**
+ * Visitors used to walk the members of user defined structs.
+ */
+class TypedSignatureVisitor {
+  public:
+    TypedSignatureVisitor(qcc::String& sig) : sig(sig) { }
+    template <typename M> void operator()(M&) { TypedArg<M>::AppendSignature(sig); }
+  private:
+    qcc::String& sig;
+};
+
+class TypedMarshalVisitor {
+  public:
+    TypedMarshalVisitor(TypedWriter& writer) : writer(writer) { }
+    template <typename M> void operator()(M& member) { TypedArg<M>::Marshal(writer, member); }
+  private:
+    TypedWriter& writer;
+};
+
+class TypedUnmarshalVisitor {
+  public:
+    TypedUnmarshalVisitor(TypedReader& reader) : reader(reader), ok(true) { }
+    template <typename M> void operator()(M& member) { ok = ok && TypedArg<M>::Unmarshal(reader, member); }
+    bool Ok() const { return ok; }
+  private:
+    TypedReader& reader;
+    bool ok;
+};
+
+template <typename T> struct TypedArg {
+    static const size_t Alignment = 8;
+    static void AppendSignature(qcc::String& sig)
+    {
+        T tmp;
+        TypedSignatureVisitor visitor(sig);
+        sig += '(';
+        TypedStruct<T>::Members(visitor, tmp);
+        sig += ')';
+    }
+    static void Marshal(TypedWriter& writer, const T& val)
+    {
+        TypedMarshalVisitor visitor(writer);
+        writer.Pad(8);
+        TypedStruct<T>::Members(visitor, const_cast<T&>(val));
+    }
+    static bool Unmarshal(TypedReader& reader, T& val)
+    {
+        TypedUnmarshalVisitor visitor(reader);
+        if (!reader.Align(8)) {
+            return false;
+        }
+        TypedStruct<T>::Members(visitor, val);
+        return visitor.Ok();
+    }
+};
+
+/**
+ * Placeholder for unused arguments in TypedArgs.
+ */
+struct TypedNone { };
+
+template <> struct TypedArg<TypedNone> {
+    static const size_t Alignment = 1;
+    static void AppendSignature(qcc::String&) { }
+    static void Marshal(TypedWriter&, const TypedNone&) { }
+    static bool Unmarshal(TypedReader&, TypedNone&) { return true; }
+};
+/// @endcond
+
+/**
+ * Returns the signature for up to four argument types. The signature is only computed once.
+ *
+ * A function-local static is not initialized safely by C++03 when several threads call Get() for
+ * the first time at once, so the signature is built by a static object while the program or
+ * library is being loaded instead, before any other thread can get here.
+ */
+template <typename A, typename B = TypedNone, typename C = TypedNone, typename D = TypedNone>
+struct TypedSignature {
+    static const qcc::String& Get()
+    {
+        /* Using the startup object here is what instantiates it */
+        (void)&startup;
+        if (!sig) {
+            sig = new qcc::String(Make());
+        }
+        return *sig;
+    }
+  private:
+    struct Startup {
+        Startup() { Get(); }
+    };
+
+    static qcc::String Make()
+    {
+        qcc::String sig;
+        TypedArg<A>::AppendSignature(sig);
+        TypedArg<B>::AppendSignature(sig);
+        TypedArg<C>::AppendSignature(sig);
+        TypedArg<D>::AppendSignature(sig);
+        return sig;
+    }
+
+    static const qcc::String* sig;
+    static const Startup startup;
+};
+
+/// @cond ALLJOYN_DEV
+template <typename A, typename B, typename C, typename D>
+const qcc::String* TypedSignature<A, B, C, D>::sig = NULL;
+
+template <typename A, typename B, typename C, typename D>
+const typename TypedSignature<A, B, C, D>::Startup TypedSignature<A, B, C, D>::startup;
+/// @endcond
+
+/**
+ * Abstract interface for a message body that marshals itself. This is the type accepted by the
+ * message composition functions.
+ */
+class TypedBody {
+  public:
+    /** Destructor */
+    virtual ~TypedBody() { }
+
+    /**
+     * Get the signature of the message body.
+     */
+    virtual const qcc::String& GetSignature() const = 0;
+
+    /**
+     * Marshal (or size) the message body.
+     *
+     * @param writer  The writer to marshal the message body with.
+     */
+    virtual void Marshal(TypedWriter& writer) const = 0;
+};
+
+/**
+ * A message body of up to four typed arguments. The values are held by reference so the
+ * TypedArgs instance must not outlive them.
+ */
+template <typename A, typename B = TypedNone, typename C = TypedNone, typename D = TypedNone>
+class TypedArgs : public TypedBody {
+  public:
+    TypedArgs(const A& a) : a(a), b(None()), c(None()), d(None()) { }
+    TypedArgs(const A& a, const B& b) : a(a), b(b), c(None()), d(None()) { }
+    TypedArgs(const A& a, const B& b, const C& c) : a(a), b(b), c(c), d(None()) { }
+    TypedArgs(const A& a, const B& b, const C& c, const D& d) : a(a), b(b), c(c), d(d) { }
+
+    const qcc::String& GetSignature() const { return TypedSignature<A, B, C, D>::Get(); }
+
+    void Marshal(TypedWriter& writer) const
+    {
+        TypedArg<A>::Marshal(writer, a);
+        TypedArg<B>::Marshal(writer, b);
+        TypedArg<C>::Marshal(writer, c);
+        TypedArg<D>::Marshal(writer, d);
+    }
+
+  private:
+    static const TypedNone& None()
+    {
+        static const TypedNone none = TypedNone();
+        return none;
+    }
+
+    const A& a;
+    const B& b;
+    const C& c;
+    const D& d;
+};
+
+/// @cond ALLJOYN_DEV
+/**
+ * @internal
+ * Check the message signature and set up a reader for the message body.
+ */
+inline QStatus TypedUnpackBegin(Message& msg, const qcc::String& signature, TypedReader& reader)
+{
+    if (signature != msg->GetSignature()) {
+        return ER_BUS_SIGNATURE_MISMATCH;
+    }
+    return msg->GetBodyReader(reader);
+}
+
+/**
+ * @internal
+ * Check that the entire message body was consumed.
+ */
+inline QStatus TypedUnpackEnd(TypedReader& reader)
+{
+    if ((reader.GetStatus() == ER_OK) && (reader.GetRemaining() != 0)) {
+        reader.Fail(ER_BUS_BAD_LENGTH);
+    }
+    return reader.GetStatus();
+}
+/// @endcond
+
+/**
+ * Unmarshal the body of a received message directly into typed values. The message signature
+ * must exactly match the signature derived from the types.
+ *
+ * @param msg  The message to unmarshal.
+ * @param a    Returns the first argument.
+ *
+ * @return
+ *      - #ER_OK if the message body was unmarshaled.
+ *      - #ER_BUS_SIGNATURE_MISMATCH if the message signature does not match the types.
+ *      - An error status otherwise
+ */
+template <typename A>
+QStatus TypedUnpack(Message& msg, A& a)
+{
+    TypedReader reader;
+    QStatus status = TypedUnpackBegin(msg, TypedSignature<A>::Get(), reader);
+    if (status == ER_OK) {
+        TypedArg<A>::Unmarshal(reader, a);
+        status = TypedUnpackEnd(reader);
+    }
+    return status;
+}
+
+/**
+ * Unmarshal the body of a received message directly into typed values.
+ * @see TypedUnpack(Message&, A&)
+ */
+template <typename A, typename B>
+QStatus TypedUnpack(Message& msg, A& a, B& b)
+{
+    TypedReader reader;
+    QStatus status = TypedUnpackBegin(msg, TypedSignature<A, B>::Get(), reader);
+    if (status == ER_OK) {
+        TypedArg<A>::Unmarshal(reader, a) && TypedArg<B>::Unmarshal(reader, b);
+        status = TypedUnpackEnd(reader);
+    }
+    return status;
+}
+
+/**
+ * Unmarshal the body of a received message directly into typed values.
+ * @see TypedUnpack(Message&, A&)
+ */
+template <typename A, typename B, typename C>
+QStatus TypedUnpack(Message& msg, A& a, B& b, C& c)
+{
+    TypedReader reader;
+    QStatus status = TypedUnpackBegin(msg, TypedSignature<A, B, C>::Get(), reader);
+    if (status == ER_OK) {
+        TypedArg<A>::Unmarshal(reader, a) && TypedArg<B>::Unmarshal(reader, b) && TypedArg<C>::Unmarshal(reader, c);
+        status = TypedUnpackEnd(reader);
+    }
+    return status;
+}
+
+/**
+ * Unmarshal the body of a received message directly into typed values.
+ * @see TypedUnpack(Message&, A&)
+ */
+template <typename A, typename B, typename C, typename D>
+QStatus TypedUnpack(Message& msg, A& a, B& b, C& c, D& d)
+{
+    TypedReader reader;
+    QStatus status = TypedUnpackBegin(msg, TypedSignature<A, B, C, D>::Get(), reader);
+    if (status == ER_OK) {
+        TypedArg<A>::Unmarshal(reader, a) && TypedArg<B>::Unmarshal(reader, b) && TypedArg<C>::Unmarshal(reader, c) && TypedArg<D>::Unmarshal(reader, d);
+        status = TypedUnpackEnd(reader);
+    }
+    return status;
+}
+
+}
+
+#endif
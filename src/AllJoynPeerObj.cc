@@ -109,6 +109,7 @@ AllJoynPeerObj::AllJoynPeerObj(BusAttachment& bus) :
             AddMethodHandler(ifc->GetMember("AuthChallenge"), static_cast<MessageReceiver::MethodHandler>(&AllJoynPeerObj::AuthChallenge));
             AddMethodHandler(ifc->GetMember("ExchangeGuids"), static_cast<MessageReceiver::MethodHandler>(&AllJoynPeerObj::ExchangeGuids));
             AddMethodHandler(ifc->GetMember("GenSessionKey"), static_cast<MessageReceiver::MethodHandler>(&AllJoynPeerObj::GenSessionKey));
+            AddMethodHandler(ifc->GetMember("ResumeSession"), static_cast<MessageReceiver::MethodHandler>(&AllJoynPeerObj::ResumeSession));
             AddMethodHandler(ifc->GetMember("ExchangeGroupKeys"), static_cast<MessageReceiver::MethodHandler>(&AllJoynPeerObj::ExchangeGroupKeys));
         }
     }
@@ -480,6 +481,44 @@ void AllJoynPeerObj::GenSessionKey(const InterfaceDescription::Member* member, M
     }
 }
 
+void AllJoynPeerObj::ResumeSession(const InterfaceDescription::Member* member, Message& msg)
+{
+    QStatus status;
+    qcc::GUID128 remotePeerGuid(msg->GetArg(0)->v_string.str);
+    uint32_t version = msg->GetArg(1)->v_uint32;
+    qcc::GUID128 localPeerGuid(msg->GetArg(2)->v_string.str);
+    qcc::String localGuidStr = bus.GetInternal().GetKeyStore().GetGuid();
+    /*
+     * Check that target GUID is our GUID, the remote peer may be using a ticket for a bus name that
+     * is now owned by a different peer.
+     */
+    if (localGuidStr.empty() || (localGuidStr != localPeerGuid.ToString())) {
+        MethodReply(msg, ER_BUS_NO_PEER_GUID);
+    } else if (version != PEER_AUTH_VERSION) {
+        MethodReply(msg, ER_BUS_PEER_AUTH_VERSION_MISMATCH);
+    } else {
+        PeerState peerState = bus.GetInternal().GetPeerStateTable()->GetPeerState(msg->GetSender());
+        QCC_DbgHLPrintf(("ResumeSession Remote %s", remotePeerGuid.ToString().c_str()));
+        /*
+         * This is ExchangeGuids and GenSessionKey rolled into one.
+         */
+        peerState->SetGuid(remotePeerGuid);
+        qcc::String nonce = RandHexString(NONCE_LEN);
+        qcc::String verifier;
+        status = KeyGen(peerState, msg->GetArg(3)->v_string.str + nonce, verifier, KeyBlob::RESPONDER);
+        if (status == ER_OK) {
+            MsgArg replyArgs[4];
+            replyArgs[0].Set("s", localGuidStr.c_str());
+            replyArgs[1].Set("u", PEER_AUTH_VERSION);
+            replyArgs[2].Set("s", nonce.c_str());
+            replyArgs[3].Set("s", verifier.c_str());
+            MethodReply(msg, replyArgs, ArraySize(replyArgs));
+        } else {
+            MethodReply(msg, status);
+        }
+    }
+}
+
 void AllJoynPeerObj::AuthAdvance(Message& msg)
 {
     QStatus status = ER_OK;
@@ -602,6 +641,21 @@ void AllJoynPeerObj::ForceAuthentication(const qcc::String& busName)
 #define AUTH_TIMEOUT      120000
 #define DEFAULT_TIMEOUT   10000
 
+/*
+ * Clear an authentication event from a peer state and release the threads waiting on it. Must be
+ * called with the lock held.
+ */
+static void ReleaseAuthWaiters(PeerState& peerState, qcc::Event& authEvent)
+{
+    if (peerState->GetAuthEvent() == &authEvent) {
+        peerState->SetAuthEvent(NULL);
+    }
+    while (authEvent.GetNumBlockedThreads() > 0) {
+        authEvent.SetEvent();
+        qcc::Sleep(10);
+    }
+}
+
 QStatus AllJoynPeerObj::AuthenticatePeer(AllJoynMessageType msgType, const qcc::String& busName, bool wait)
 {
     QStatus status;
@@ -647,17 +701,104 @@ QStatus AllJoynPeerObj::AuthenticatePeer(AllJoynMessageType msgType, const qcc::
     ProxyBusObject remotePeerObj(bus, busName.c_str(), org::alljoyn::Bus::Peer::ObjectPath, 0);
     remotePeerObj.AddInterface(*ifc);
 
+    KeyStore& keyStore = bus.GetInternal().GetKeyStore();
+    qcc::String localGuidStr = keyStore.GetGuid();
+    Message replyMsg(bus);
+    qcc::String localNonce;
+    qcc::String remoteNonce;
+    qcc::String remoteVerifier;
+    /*
+     * Other threads authenticating the same peer will block on this event until the authentication completes.
+     */
+    qcc::Event authEvent;
+    PeerState resumeState;
+    bool resumeClaimed = false;
+    /*
+     * If we have authenticated this peer before and still have the master secret we try to resume
+     * the secure session. The ResumeSession method call exchanges GUIDs and generates a new session
+     * key in a single round trip. If the peer doesn't support session resumption, is no longer the
+     * peer we authenticated or has lost the master secret we fall back to ExchangeGuids.
+     */
+    if (msgType == MESSAGE_METHOD_CALL) {
+        qcc::String ticketGuidStr;
+        lock.Lock(MUTEX_CONTEXT);
+        std::map<qcc::String, qcc::GUID128>::iterator iter = resumptionTickets.find(busName);
+        if (iter != resumptionTickets.end()) {
+            if (keyStore.HasKey(iter->second)) {
+                ticketGuidStr = iter->second.ToString();
+            } else {
+                resumptionTickets.erase(iter);
+            }
+        }
+        lock.Unlock(MUTEX_CONTEXT);
+        /*
+         * The remote peer installs the new session key as soon as it handles ResumeSession so we
+         * must not resume with a peer that is already secure or is being authenticated on another
+         * thread. The ticket may be for a well-known name so we get the unique name first and claim
+         * the authentication of that peer before resuming.
+         */
+        qcc::String uniqueName;
+        if (!ticketGuidStr.empty()) {
+            if (busName[0] == ':') {
+                uniqueName = busName;
+            } else {
+                Message ownerReply(bus);
+                MsgArg arg("s", busName.c_str());
+                if (bus.GetDBusProxyObj().MethodCall(org::freedesktop::DBus::InterfaceName, "GetNameOwner", &arg, 1, ownerReply) == ER_OK) {
+                    uniqueName = ownerReply->GetArg(0)->v_string.str;
+                }
+            }
+        }
+        if (!uniqueName.empty() && (uniqueName != bus.GetUniqueName())) {
+            resumeState = peerStateTable->GetPeerState(uniqueName, busName);
+            if (resumeState->IsSecure()) {
+                return ER_OK;
+            }
+            lock.Lock(MUTEX_CONTEXT);
+            if (resumeState->GetAuthEvent()) {
+                if (wait) {
+                    Event::Wait(*resumeState->GetAuthEvent(), lock);
+                    return resumeState->IsSecure() ? ER_OK : ER_AUTH_FAIL;
+                } else {
+                    lock.Unlock(MUTEX_CONTEXT);
+                    return ER_WOULDBLOCK;
+                }
+            }
+            resumeState->SetAuthEvent(&authEvent);
+            resumeClaimed = true;
+            lock.Unlock(MUTEX_CONTEXT);
+
+            ProxyBusObject resumePeerObj(bus, uniqueName.c_str(), org::alljoyn::Bus::Peer::ObjectPath, 0);
+            resumePeerObj.AddInterface(*ifc);
+            localNonce = RandHexString(NONCE_LEN);
+            MsgArg args[4];
+            args[0].Set("s", localGuidStr.c_str());
+            args[1].Set("u", PEER_AUTH_VERSION);
+            args[2].Set("s", ticketGuidStr.c_str());
+            args[3].Set("s", localNonce.c_str());
+            status = resumePeerObj.MethodCall(*(ifc->GetMember("ResumeSession")), args, ArraySize(args), replyMsg, DEFAULT_TIMEOUT);
+            if (status == ER_OK) {
+                remoteNonce = replyMsg->GetArg(2)->v_string.str;
+                remoteVerifier = replyMsg->GetArg(3)->v_string.str;
+            } else {
+                QCC_DbgHLPrintf(("ResumeSession with %s failed %s", busName.c_str(), QCC_StatusText(status)));
+                lock.Lock(MUTEX_CONTEXT);
+                resumptionTickets.erase(busName);
+                lock.Unlock(MUTEX_CONTEXT);
+            }
+        }
+    }
     /*
      * Exchange GUIDs with the peer, this will get us the GUID of the remote peer and also the
      * unique bus name from which we can determine if we have already have a session key, a
      * master secret or if we have to start an authentication conversation.
      */
-    qcc::String localGuidStr = bus.GetInternal().GetKeyStore().GetGuid();
-    MsgArg args[2];
-    args[0].Set("s", localGuidStr.c_str());
-    args[1].Set("u", PEER_AUTH_VERSION);
-    Message replyMsg(bus);
-    status = remotePeerObj.MethodCall(*(ifc->GetMember("ExchangeGuids")), args, ArraySize(args), replyMsg, DEFAULT_TIMEOUT);
+    if (remoteVerifier.empty()) {
+        MsgArg args[2];
+        args[0].Set("s", localGuidStr.c_str());
+        args[1].Set("u", PEER_AUTH_VERSION);
+        status = remotePeerObj.MethodCall(*(ifc->GetMember("ExchangeGuids")), args, ArraySize(args), replyMsg, DEFAULT_TIMEOUT);
+    }
     if (status != ER_OK) {
         /*
          * ER_BUS_REPLY_IS_ERROR_MESSAGE has a specific meaning in the public API and should not be
@@ -671,6 +812,11 @@ QStatus AllJoynPeerObj::AuthenticatePeer(AllJoynMessageType msgType, const qcc::
             }
         }
         QCC_LogError(status, ("ExchangeGuids failed"));
+        if (resumeClaimed) {
+            lock.Lock(MUTEX_CONTEXT);
+            ReleaseAuthWaiters(resumeState, authEvent);
+            lock.Unlock(MUTEX_CONTEXT);
+        }
         return status;
     }
     const qcc::String sender = replyMsg->GetSender();
@@ -684,6 +830,11 @@ QStatus AllJoynPeerObj::AuthenticatePeer(AllJoynMessageType msgType, const qcc::
     if (version != PEER_AUTH_VERSION) {
         status = ER_BUS_PEER_AUTH_VERSION_MISMATCH;
         QCC_LogError(status, ("ExchangeGuids expected %u got %u", PEER_AUTH_VERSION, version));
+        if (resumeClaimed) {
+            lock.Lock(MUTEX_CONTEXT);
+            ReleaseAuthWaiters(resumeState, authEvent);
+            lock.Unlock(MUTEX_CONTEXT);
+        }
         return status;
     }
 
@@ -699,14 +850,23 @@ QStatus AllJoynPeerObj::AuthenticatePeer(AllJoynMessageType msgType, const qcc::
      * We can now return if the peer is authenticated.
      */
     if (peerState->IsSecure()) {
+        if (resumeClaimed) {
+            lock.Lock(MUTEX_CONTEXT);
+            ReleaseAuthWaiters(resumeState, authEvent);
+            lock.Unlock(MUTEX_CONTEXT);
+        }
         return ER_OK;
     }
     /*
      * Check again if the peer is being authenticated on another thread. We need to do this because
-     * the check above may have used a well-known-namme and now we know the unique name.
+     * the check above may have used a well-known-namme and now we know the unique name. If we
+     * claimed the authentication before resuming the event is our own.
      */
     lock.Lock(MUTEX_CONTEXT);
-    if (peerState->GetAuthEvent()) {
+    if (peerState->GetAuthEvent() && (peerState->GetAuthEvent() != &authEvent)) {
+        if (resumeClaimed) {
+            ReleaseAuthWaiters(resumeState, authEvent);
+        }
         if (wait) {
             Event::Wait(*peerState->GetAuthEvent(), lock);
             return peerState->IsSecure() ? ER_OK : ER_AUTH_FAIL;
@@ -736,6 +896,9 @@ QStatus AllJoynPeerObj::AuthenticatePeer(AllJoynMessageType msgType, const qcc::
         peerState->isLocalPeer = true;
         /* Set rights on the local peer - treat as mutual authentication */
         SetRights(peerState, true, false);
+        if (resumeClaimed) {
+            ReleaseAuthWaiters(resumeState, authEvent);
+        }
         /* We are still holding the lock */
         lock.Unlock(MUTEX_CONTEXT);
         return ER_OK;
@@ -750,14 +913,9 @@ QStatus AllJoynPeerObj::AuthenticatePeer(AllJoynMessageType msgType, const qcc::
         lock.Unlock(MUTEX_CONTEXT);
         return ER_BUS_DESTINATION_NOT_AUTHENTICATED;
     }
-    /*
-     * Other threads authenticating the same peer will block on this event until the authentication completes.
-     */
-    qcc::Event authEvent;
     peerState->SetAuthEvent(&authEvent);
     lock.Unlock(MUTEX_CONTEXT);
 
-    KeyStore& keyStore = bus.GetInternal().GetKeyStore();
     bool firstPass = true;
     do {
         /*
@@ -780,30 +938,39 @@ QStatus AllJoynPeerObj::AuthenticatePeer(AllJoynMessageType msgType, const qcc::
                 status = ER_AUTH_FAIL;
             }
         }
-        if (status == ER_OK) {
+        /*
+         * If the session was resumed the remote peer has already generated its half of the session
+         * key so we don't need to send a GenSessionKey message.
+         */
+        if ((status == ER_OK) && remoteVerifier.empty()) {
             /*
              * Generate a random string - this is the local half of the seed string.
              */
-            qcc::String nonce = RandHexString(NONCE_LEN);
+            localNonce = RandHexString(NONCE_LEN);
             /*
              * Send GenSessionKey message to remote peer.
              */
             MsgArg args[3];
             args[0].Set("s", localGuidStr.c_str());
             args[1].Set("s", remoteGuidStr.c_str());
-            args[2].Set("s", nonce.c_str());
+            args[2].Set("s", localNonce.c_str());
             status = remotePeerObj.MethodCall(*(ifc->GetMember("GenSessionKey")), args, ArraySize(args), replyMsg, DEFAULT_TIMEOUT);
             if (status == ER_OK) {
-                qcc::String verifier;
-                /*
-                 * The response completes the seed string so we can generate the session key.
-                 */
-                status = KeyGen(peerState, nonce + replyMsg->GetArg(0)->v_string.str, verifier, KeyBlob::INITIATOR);
-                if ((status == ER_OK) && (verifier != replyMsg->GetArg(1)->v_string.str)) {
-                    status = ER_AUTH_FAIL;
-                }
+                remoteNonce = replyMsg->GetArg(0)->v_string.str;
+                remoteVerifier = replyMsg->GetArg(1)->v_string.str;
+            }
+        }
+        if (status == ER_OK) {
+            qcc::String verifier;
+            /*
+             * The response completes the seed string so we can generate the session key.
+             */
+            status = KeyGen(peerState, localNonce + remoteNonce, verifier, KeyBlob::INITIATOR);
+            if ((status == ER_OK) && (verifier != remoteVerifier)) {
+                status = ER_AUTH_FAIL;
             }
         }
+        remoteVerifier.clear();
         if ((status == ER_OK) || !firstPass) {
             break;
         }
@@ -874,6 +1041,19 @@ QStatus AllJoynPeerObj::AuthenticatePeer(AllJoynMessageType msgType, const qcc::
      * Report the authentication completion to allow application to clear UI etc.
      */
     peerAuthListener.AuthenticationComplete(mech.c_str(), sender.c_str(), status == ER_OK);
+    /*
+     * Keep a resumption ticket for the names we used to reach the peer so if we need to
+     * authenticate again (e.g. after reconnecting to the bus) we can resume the session.
+     */
+    lock.Lock(MUTEX_CONTEXT);
+    if (status == ER_OK) {
+        resumptionTickets[busName] = remotePeerGuid;
+        resumptionTickets[sender] = remotePeerGuid;
+    } else {
+        resumptionTickets.erase(busName);
+        resumptionTickets.erase(sender);
+    }
+    lock.Unlock(MUTEX_CONTEXT);
     /*
      * ER_BUS_REPLY_IS_ERROR_MESSAGE has a specific meaning in the public API an should not be
      * propogated to the caller from this context.
@@ -885,11 +1065,10 @@ QStatus AllJoynPeerObj::AuthenticatePeer(AllJoynMessageType msgType, const qcc::
      * Release any other threads waiting on the result of this authentication.
      */
     lock.Lock(MUTEX_CONTEXT);
-    peerState->SetAuthEvent(NULL);
-    while (authEvent.GetNumBlockedThreads() > 0) {
-        authEvent.SetEvent();
-        qcc::Sleep(10);
+    if (resumeClaimed) {
+        ReleaseAuthWaiters(resumeState, authEvent);
     }
+    ReleaseAuthWaiters(peerState, authEvent);
     lock.Unlock(MUTEX_CONTEXT);
     return status;
 }
@@ -1054,6 +1233,12 @@ void AllJoynPeerObj::NameOwnerChanged(const char* busName, const char* previousO
         lock.Lock(MUTEX_CONTEXT);
         delete conversations[busName];
         conversations.erase(busName);
+        /*
+         * Unique names are never reused so a resumption ticket for a unique name is no longer useful.
+         */
+        if (busName[0] == ':') {
+            resumptionTickets.erase(busName);
+        }
         lock.Unlock(MUTEX_CONTEXT);
     }
 }
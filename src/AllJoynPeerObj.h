@@ -249,6 +249,14 @@ class AllJoynPeerObj : public BusObject, public BusListener, public qcc::AlarmLi
      */
     void GenSessionKey(const InterfaceDescription::Member* member, Message& msg);
 
+    /**
+     * ResumeSession method call handler
+     *
+     * @param member  The member that was called
+     * @param msg     The method call message
+     */
+    void ResumeSession(const InterfaceDescription::Member* member, Message& msg);
+
     /**
      * ExchangeGroupKeys method call handler
      *
@@ -359,6 +367,13 @@ class AllJoynPeerObj : public BusObject, public BusListener, public qcc::AlarmLi
      */
     std::map<qcc::String, SASLEngine*> conversations;
 
+    /**
+     * Resumption tickets: the GUIDs of remote peers we have previously authenticated indexed by
+     * the bus names used to reach them. A ticket lets us try to re-establish a session key with
+     * a single ResumeSession method call.
+     */
+    std::map<qcc::String, qcc::GUID128> resumptionTickets;
+
     /** Short term lock to protect the peer object. */
     qcc::Mutex lock;
 
@@ -141,6 +141,7 @@ QStatus org::alljoyn::CreateInterfaces(BusAttachment& bus)
         }
         ifc->AddMethod("ExchangeGuids",     "su",  "su", "localGuid,localVersion,remoteGuid,remoteVersion");
         ifc->AddMethod("GenSessionKey",     "sss", "ss", "localGuid,remoteGuid,localNonce,remoteNonce,verifier");
+        ifc->AddMethod("ResumeSession",     "suss", "suss", "localGuid,localVersion,remoteGuid,localNonce,remoteGuid,remoteVersion,remoteNonce,verifier");
         ifc->AddMethod("ExchangeGroupKeys", "ay",  "ay", "localKeyMatter,remoteKeyMatter");
         ifc->AddMethod("AuthChallenge",     "s",   "s",  "challenge,response");
         ifc->AddProperty("Mechanisms",  "s", PROP_ACCESS_READ);
@@ -506,6 +506,22 @@ QStatus BusObject::MethodReply(const Message& msg, const MsgArg* args, size_t nu
     return status;
 }
 
+QStatus BusObject::MethodReply(const Message& msg, const TypedBody& args)
+{
+    QStatus status;
+
+    if (msg->GetType() != MESSAGE_METHOD_CALL) {
+        status = ER_BUS_NO_CALL_FOR_REPLY;
+    } else {
+        Message reply(bus);
+        status = reply->ReplyMsg(msg, args);
+        if (status == ER_OK) {
+            status = bus.GetInternal().GetRouter().PushMessage(reply, bus.GetInternal().GetLocalEndpoint());
+        }
+    }
+    return status;
+}
+
 QStatus BusObject::MethodReply(const Message& msg, const char* errorName, const char* errorMessage)
 {
     QStatus status;
@@ -20,7 +20,9 @@
  *    limitations under the License.
  ******************************************************************************/
 
+#include <algorithm>
 #include <map>
+#include <stdio.h>
 
 #include <qcc/platform.h>
 #include <qcc/Debug.h>
@@ -59,6 +61,28 @@ static const uint16_t LowStoreVersion = 0x0102;
  */
 static const uint16_t KeyStoreVersion = 0x0103;
 
+/*
+ * Sanity check on the length of the encrypted keys
+ */
+static const size_t MaxKeyStoreLen = 16 * 1024 * 1024;
+
+/*
+ * Journal record entry types
+ */
+static const uint8_t JournalAdd = 1;
+static const uint8_t JournalDel = 2;
+
+/*
+ * Journal records are encrypted with the key store key so the nonce must be distinct from the
+ * nonce used for the full key store which is just the revision number.
+ */
+static const uint32_t JournalNonceTag = 0x4C4E524A;
+
+/*
+ * The default key store is compacted (rewritten in full) when the journal gets this long.
+ */
+static const size_t MaxJournalLen = 256 * 1024;
+
 
 QStatus KeyStoreListener::PutKeys(KeyStore& keyStore, const qcc::String& source, const qcc::String& password)
 {
@@ -76,6 +100,14 @@ QStatus KeyStoreListener::GetKeys(KeyStore& keyStore, qcc::String& sink)
     return status;
 }
 
+/*
+ * The default key store listener keeps the key store in two files. The key store file holds a
+ * full copy of the key store and the journal file holds records for keys that have been added,
+ * changed or deleted since the key store file was written. Storing a change only appends a record
+ * to the journal, the key store file is only rewritten when the journal gets too long. A crash
+ * while appending can only leave a partial record at the end of the journal, loading keeps the
+ * records before it and the next store rewrites the key store file in full.
+ */
 class DefaultKeyStoreListener : public KeyStoreListener {
 
   public:
@@ -86,6 +118,8 @@ class DefaultKeyStoreListener : public KeyStoreListener {
         } else {
             fileName = GetHomeDir() + "/.alljoyn_keystore/" + application;
         }
+        journalName = fileName + ".journal";
+        journalLen = 0;
     }
 
     QStatus LoadRequest(KeyStore& keyStore) {
@@ -98,6 +132,7 @@ class DefaultKeyStoreListener : public KeyStoreListener {
                 status = keyStore.Pull(source, fileName);
                 if (status == ER_OK) {
                     QCC_DbgHLPrintf(("Read key store from %s", fileName.c_str()));
+                    status = LoadJournal(keyStore);
                 }
                 source.Unlock();
                 return status;
@@ -112,6 +147,9 @@ class DefaultKeyStoreListener : public KeyStoreListener {
                 return status;
             }
         }
+        /* Discard any journal left over from a previous key store */
+        journalLen = 0;
+        WriteFile(journalName, NULL, 0);
         /* Load the empty keystore */
         {
             FileSource source(fileName);
@@ -133,12 +171,41 @@ class DefaultKeyStoreListener : public KeyStoreListener {
 
     QStatus StoreRequest(KeyStore& keyStore) {
         QStatus status;
+        if (!keyStore.IsCompactionRequired() && (journalLen < MaxJournalLen)) {
+            StringSink record;
+            status = keyStore.PushJournal(record);
+            if ((status == ER_OK) && !record.GetString().empty()) {
+                const qcc::String& rec = record.GetString();
+                /*
+                 * An empty journal is written through a private file sink so a journal that went
+                 * missing is not recreated with the default file permissions.
+                 */
+                if (journalLen == 0) {
+                    status = WriteFile(journalName, rec.data(), rec.size());
+                } else {
+                    status = AppendFile(journalName, rec.data(), rec.size());
+                }
+                if (status == ER_OK) {
+                    journalLen += rec.size();
+                    QCC_DbgHLPrintf(("Wrote key store journal record to %s", journalName.c_str()));
+                } else {
+                    /* Don't append after what may be a partial record, rewrite in full next time */
+                    journalLen = MaxJournalLen;
+                }
+            }
+            return status;
+        }
         FileSink sink(fileName, FileSink::PRIVATE);
         if (sink.IsValid()) {
             sink.Lock(true);
             status = keyStore.Push(sink);
             if (status == ER_OK) {
                 QCC_DbgHLPrintf(("Wrote key store to %s", fileName.c_str()));
+                /*
+                 * The journal records are now in the key store file.
+                 */
+                journalLen = 0;
+                status = WriteFile(journalName, NULL, 0);
             }
             sink.Unlock();
         } else {
@@ -150,8 +217,73 @@ class DefaultKeyStoreListener : public KeyStoreListener {
 
   private:
 
+    QStatus LoadJournal(KeyStore& keyStore) {
+        QStatus status = ER_OK;
+        qcc::String journal;
+        journalLen = 0;
+        FileSource source(journalName);
+        if (source.IsValid()) {
+            uint8_t buf[1024];
+            size_t pulled;
+            while (source.PullBytes(buf, sizeof(buf), pulled) == ER_OK) {
+                journal.append(reinterpret_cast<const char*>(buf), pulled);
+            }
+            journalLen = journal.size();
+            if (!journal.empty()) {
+                StringSource records(journal);
+                status = keyStore.PullJournal(records);
+                if (status == ER_OK) {
+                    QCC_DbgHLPrintf(("Read key store journal from %s", journalName.c_str()));
+                }
+            }
+        }
+        return status;
+    }
+
+    QStatus WriteFile(const qcc::String& name, const char* data, size_t len) {
+        QStatus status = ER_OK;
+        FileSink sink(name, FileSink::PRIVATE);
+        if (sink.IsValid()) {
+            size_t pushed;
+            if (len) {
+                sink.Lock(true);
+                status = sink.PushBytes(data, len, pushed);
+                sink.Unlock();
+            }
+        } else {
+            status = ER_BUS_WRITE_ERROR;
+        }
+        if (status != ER_OK) {
+            QCC_LogError(status, ("Cannot write %s", name.c_str()));
+        }
+        return status;
+    }
+
+    QStatus AppendFile(const qcc::String& name, const char* data, size_t len) {
+        QStatus status = ER_OK;
+        /* qcc::FileSink always truncates the file so append through stdio */
+        FILE* file = fopen(name.c_str(), "ab");
+        if (file) {
+            if ((fwrite(data, 1, len, file) != len) || (fflush(file) != 0)) {
+                status = ER_BUS_WRITE_ERROR;
+            }
+            fclose(file);
+        } else {
+            status = ER_BUS_WRITE_ERROR;
+        }
+        if (status != ER_OK) {
+            QCC_LogError(status, ("Cannot append to %s", name.c_str()));
+        }
+        return status;
+    }
+
     qcc::String fileName;
 
+    qcc::String journalName;
+
+    /* Length of the journal file */
+    size_t journalLen;
+
 };
 
 KeyStore::KeyStore(const qcc::String& application) :
@@ -163,24 +295,16 @@ KeyStore::KeyStore(const qcc::String& application) :
     thisGuid(),
     keyStoreKey(NULL),
     shared(false),
-    stored(NULL),
+    compact(false),
+    storePending(false),
     loaded(NULL)
 {
 }
 
 KeyStore::~KeyStore()
 {
-    /* Unblock thread that might be waiting for a store to complete */
-    lock.Lock(MUTEX_CONTEXT);
-    if (stored) {
-        stored->SetEvent();
-        lock.Unlock(MUTEX_CONTEXT);
-        while (stored) {
-            qcc::Sleep(1);
-        }
-        lock.Lock(MUTEX_CONTEXT);
-    }
     /* Unblock thread that might be waiting for a load to complete */
+    lock.Lock(MUTEX_CONTEXT);
     if (loaded) {
         loaded->SetEvent();
         lock.Unlock(MUTEX_CONTEXT);
@@ -262,18 +386,18 @@ QStatus KeyStore::Store()
             status = Reload();
             lock.Lock(MUTEX_CONTEXT);
         }
-        if (status == ER_OK) {
-            stored = new Event();
+        /*
+         * We don't wait for the listener to push the keys. While a store request is in progress
+         * there is no need for another request because the listener will push the current keys.
+         * The request is over when the listener returns, an application listener that never calls
+         * back must not block later store requests.
+         */
+        if ((status == ER_OK) && !storePending) {
+            storePending = true;
             lock.Unlock(MUTEX_CONTEXT);
             status = listener->StoreRequest(*this);
-            if (status == ER_OK) {
-                status = Event::Wait(*stored);
-            }
             lock.Lock(MUTEX_CONTEXT);
-            delete stored;
-            stored = NULL;
-            /* Done tracking deletions */
-            deletions.clear();
+            storePending = false;
         }
         lock.Unlock(MUTEX_CONTEXT);
     }
@@ -285,6 +409,7 @@ QStatus KeyStore::Load()
     QStatus status;
     lock.Lock(MUTEX_CONTEXT);
     keys->clear();
+    expirations.clear();
     storeState = UNAVAILABLE;
     loaded = new Event();
     lock.Unlock(MUTEX_CONTEXT);
@@ -299,17 +424,56 @@ QStatus KeyStore::Load()
     return status;
 }
 
+static uint64_t ExpirationMillis(const KeyBlob& key)
+{
+    Timespec expiration;
+    key.GetExpiration(expiration);
+    return expiration.GetAbsoluteMillis();
+}
+
+void KeyStore::IndexExpiration(const qcc::GUID128& guid, const KeyBlob& key)
+{
+    uint64_t expiration = ExpirationMillis(key);
+    /* Keys that never expire are not indexed */
+    if (expiration) {
+        expirations.insert(ExpiryIndex::value_type(expiration, guid));
+    }
+}
+
+void KeyStore::RebuildExpirations()
+{
+    expirations.clear();
+    for (KeyMap::iterator it = keys->begin(); it != keys->end(); ++it) {
+        IndexExpiration(it->first, it->second.key);
+    }
+}
+
 size_t KeyStore::EraseExpiredKeys()
 {
     size_t count = 0;
-    KeyMap::iterator it = keys->begin();
-    while (it != keys->end()) {
-        KeyMap::iterator current = it++;
-        if (current->second.key.HasExpired()) {
+    Timespec now;
+    GetTimeNow(&now);
+    /*
+     * Discard stale index entries if there are a lot of them.
+     */
+    if (expirations.size() > (2 * keys->size() + 16)) {
+        RebuildExpirations();
+    }
+    ExpiryIndex::iterator it = expirations.begin();
+    while ((it != expirations.end()) && (it->first <= now.GetAbsoluteMillis())) {
+        KeyMap::iterator current = keys->find(it->second);
+        /*
+         * The index entry is stale if the key has been deleted or its expiration has changed.
+         */
+        if ((current != keys->end()) && (ExpirationMillis(current->second.key) == it->first)) {
+            if (!current->second.key.HasExpired()) {
+                break;
+            }
             QCC_DbgPrintf(("Deleting expired key for GUID %s", current->first.ToString().c_str()));
             keys->erase(current);
             ++count;
         }
+        expirations.erase(it++);
     }
     return count;
 }
@@ -355,6 +519,8 @@ QStatus KeyStore::Pull(Source& source, const qcc::String& password)
         keys->clear();
         storeState = MODIFIED;
         revision = 0;
+        /* The key store GUID only gets written by a full store */
+        compact = true;
         status = ER_OK;
         goto ExitPull;
     }
@@ -368,7 +534,7 @@ QStatus KeyStore::Pull(Source& source, const qcc::String& password)
         goto ExitPull;
     }
     /* Sanity check on the length */
-    if (len > 64000) {
+    if (len > MaxKeyStoreLen) {
         status = ER_BUS_CORRUPT_KEYSTORE;
         goto ExitPull;
     }
@@ -417,6 +583,9 @@ QStatus KeyStore::Pull(Source& source, const qcc::String& password)
                             }
                         }
                     }
+                    if (status == ER_OK) {
+                        IndexExpiration(guid, keyRec.key);
+                    }
                     QCC_DbgPrintf(("KeyStore::Pull rev:%d GUID %s %s", rev, QCC_StatusText(status), guid.ToString().c_str()));
                 }
             }
@@ -440,6 +609,7 @@ ExitPull:
     if (status != ER_OK) {
         keys->clear();
         storeState = MODIFIED;
+        compact = true;
     }
     if (loaded) {
         loaded->SetEvent();
@@ -455,11 +625,14 @@ QStatus KeyStore::Clear()
     }
     lock.Lock(MUTEX_CONTEXT);
     keys->clear();
+    expirations.clear();
     storeState = MODIFIED;
     revision = 0;
     deletions.clear();
+    updates.clear();
+    compact = true;
     lock.Unlock(MUTEX_CONTEXT);
-    listener->StoreRequest(*this);
+    Store();
     return ER_OK;
 }
 
@@ -483,6 +656,7 @@ QStatus KeyStore::Reload()
     lock.Lock(MUTEX_CONTEXT);
     QStatus status;
     uint32_t currentRevision = revision;
+    bool modified = (storeState == MODIFIED);
     KeyMap* currentKeys = keys;
     keys = new KeyMap();
 
@@ -502,12 +676,20 @@ QStatus KeyStore::Reload()
         /*
          * Handle deletions
          */
-        std::set<qcc::GUID128>::iterator itDel;
-        for (itDel = deletions.begin(); itDel != deletions.end(); ++itDel) {
+        std::set<qcc::GUID128>::iterator itDel = deletions.begin();
+        while (itDel != deletions.end()) {
             it = keys->find(*itDel);
-            if ((it != keys->end()) && (it->second.revision <= currentRevision)) {
-                QCC_DbgPrintf(("KeyStore::Reload deleting %s", itDel->ToString().c_str()));
-                keys->erase(*itDel);
+            if ((it != keys->end()) && (it->second.revision > currentRevision)) {
+                /*
+                 * The key was added back after we deleted it so we must not journal the deletion.
+                 */
+                deletions.erase(itDel++);
+            } else {
+                if (it != keys->end()) {
+                    QCC_DbgPrintf(("KeyStore::Reload deleting %s", itDel->ToString().c_str()));
+                    keys->erase(it);
+                }
+                ++itDel;
             }
         }
         /*
@@ -521,6 +703,7 @@ QStatus KeyStore::Reload()
                      * In case of a merge conflict go with the key that is currently stored
                      */
                     QCC_DbgPrintf(("KeyStore::Reload merge conflict rev:%d %s", it->second.revision, it->first.ToString().c_str()));
+                    updates.erase(it->first);
                 } else {
                     (*keys)[it->first] = it->second;
                     QCC_DbgPrintf(("KeyStore::Reload merging %s", it->first.ToString().c_str()));
@@ -528,7 +711,14 @@ QStatus KeyStore::Reload()
             }
         }
         delete currentKeys;
+        RebuildExpirations();
         EraseExpiredKeys();
+        /*
+         * Our own changes still need to be stored.
+         */
+        if (!updates.empty() || !deletions.empty()) {
+            storeState = MODIFIED;
+        }
     } else {
         /*
          * Restore state
@@ -537,6 +727,10 @@ QStatus KeyStore::Reload()
         keys = currentKeys;
         delete goner;
         revision = currentRevision;
+        RebuildExpirations();
+        if (modified) {
+            storeState = MODIFIED;
+        }
     }
 
     lock.Unlock(MUTEX_CONTEXT);
@@ -613,12 +807,180 @@ QStatus KeyStore::Push(Sink& sink)
         goto ExitPush;
     }
     storeState = LOADED;
+    /* Done tracking changes */
+    deletions.clear();
+    updates.clear();
+    compact = false;
 
 ExitPush:
 
-    if (stored) {
-        stored->SetEvent();
+    storePending = false;
+    lock.Unlock(MUTEX_CONTEXT);
+    return status;
+}
+
+QStatus KeyStore::PullJournal(Source& source)
+{
+    QCC_DbgPrintf(("KeyStore::PullJournal"));
+
+    if (storeState == UNAVAILABLE) {
+        return ER_BUS_KEYSTORE_NOT_LOADED;
+    }
+
+    lock.Lock(MUTEX_CONTEXT);
+
+    QStatus status = ER_OK;
+    uint32_t baseRevision = revision;
+    uint8_t guidBuf[qcc::GUID128::SIZE];
+    size_t pulled;
+
+    while (status == ER_OK) {
+        uint32_t rev;
+        uint32_t len;
+        status = source.PullBytes(&rev, sizeof(rev), pulled);
+        if (status == ER_OK) {
+            status = source.PullBytes(&len, sizeof(len), pulled);
+        }
+        if (status != ER_OK) {
+            break;
+        }
+        if (len > MaxKeyStoreLen) {
+            status = ER_BUS_CORRUPT_KEYSTORE;
+            break;
+        }
+        uint8_t* data = new uint8_t[len];
+        status = source.PullBytes(data, len, pulled);
+        if ((status == ER_OK) && (pulled != len)) {
+            status = ER_BUS_CORRUPT_KEYSTORE;
+        }
+        /*
+         * Records written before the key store was last stored in full are already in the key store.
+         */
+        if ((status == ER_OK) && (rev > baseRevision)) {
+            uint32_t nonceBuf[2] = { rev, JournalNonceTag };
+            KeyBlob nonce((uint8_t*)nonceBuf, sizeof(nonceBuf), KeyBlob::GENERIC);
+            Crypto_AES aes(*keyStoreKey, Crypto_AES::CCM);
+            size_t dataLen = len;
+            status = aes.Decrypt_CCM(data, data, dataLen, nonce, NULL, 0, 16);
+            StringSource strSource(data, dataLen);
+            while (status == ER_OK) {
+                uint8_t op;
+                status = strSource.PullBytes(&op, sizeof(op), pulled);
+                if (status == ER_OK) {
+                    status = strSource.PullBytes(guidBuf, qcc::GUID128::SIZE, pulled);
+                }
+                if (status != ER_OK) {
+                    break;
+                }
+                qcc::GUID128 guid;
+                guid.SetBytes(guidBuf);
+                if (op == JournalDel) {
+                    QCC_DbgPrintf(("KeyStore::PullJournal rev:%d delete GUID %s", rev, guid.ToString().c_str()));
+                    keys->erase(guid);
+                } else if (op == JournalAdd) {
+                    KeyRecord keyRec;
+                    status = strSource.PullBytes(&keyRec.revision, sizeof(keyRec.revision), pulled);
+                    if (status == ER_OK) {
+                        status = keyRec.key.Load(strSource);
+                    }
+                    if (status == ER_OK) {
+                        status = strSource.PullBytes(&keyRec.accessRights, sizeof(keyRec.accessRights), pulled);
+                    }
+                    if (status == ER_OK) {
+                        QCC_DbgPrintf(("KeyStore::PullJournal rev:%d GUID %s", keyRec.revision, guid.ToString().c_str()));
+                        (*keys)[guid] = keyRec;
+                        IndexExpiration(guid, keyRec.key);
+                    }
+                } else {
+                    status = ER_BUS_CORRUPT_KEYSTORE;
+                }
+            }
+            if (status == ER_NONE) {
+                status = ER_OK;
+                revision = (std::max)(revision, rev);
+            }
+        }
+        delete [] data;
+    }
+    if (status == ER_NONE) {
+        status = ER_OK;
+    }
+    if (status != ER_OK) {
+        /*
+         * Keep the keys from the records we could read and rewrite the key store in full on the
+         * next store to get rid of the bad journal record.
+         */
+        QCC_LogError(status, ("Ignoring corrupt key store journal"));
+        status = ER_OK;
+        compact = true;
+        storeState = MODIFIED;
+    }
+    EraseExpiredKeys();
+    lock.Unlock(MUTEX_CONTEXT);
+    return status;
+}
+
+QStatus KeyStore::PushJournal(Sink& sink)
+{
+    size_t pushed;
+    QStatus status = ER_OK;
+
+    lock.Lock(MUTEX_CONTEXT);
+
+    /*
+     * Pack the changes into an intermediate string sink.
+     */
+    StringSink strSink;
+    std::set<qcc::GUID128>::iterator it;
+    for (it = deletions.begin(); it != deletions.end(); ++it) {
+        strSink.PushBytes(&JournalDel, sizeof(JournalDel), pushed);
+        strSink.PushBytes(it->GetBytes(), qcc::GUID128::SIZE, pushed);
+    }
+    for (it = updates.begin(); it != updates.end(); ++it) {
+        KeyMap::iterator key = keys->find(*it);
+        if (key != keys->end()) {
+            strSink.PushBytes(&JournalAdd, sizeof(JournalAdd), pushed);
+            strSink.PushBytes(it->GetBytes(), qcc::GUID128::SIZE, pushed);
+            strSink.PushBytes(&key->second.revision, sizeof(key->second.revision), pushed);
+            key->second.key.Store(strSink);
+            strSink.PushBytes(&key->second.accessRights, sizeof(key->second.accessRights), pushed);
+        }
+    }
+    size_t len = strSink.GetString().size();
+    if (len > 0) {
+        QCC_DbgHLPrintf(("KeyStore::PushJournal (revision %d)", revision + 1));
+        /*
+         * The record is the revision number, the length of the encrypted changes and the encrypted
+         * changes.
+         */
+        uint32_t rev = revision + 1;
+        uint32_t nonceBuf[2] = { rev, JournalNonceTag };
+        KeyBlob nonce((uint8_t*)nonceBuf, sizeof(nonceBuf), KeyBlob::GENERIC);
+        uint8_t* data = new uint8_t[len + 16];
+        Crypto_AES aes(*keyStoreKey, Crypto_AES::CCM);
+        status = aes.Encrypt_CCM(strSink.GetString().data(), data, len, nonce, NULL, 0, 16);
+        if (status == ER_OK) {
+            uint32_t recLen = static_cast<uint32_t>(len);
+            status = sink.PushBytes(&rev, sizeof(rev), pushed);
+            if (status == ER_OK) {
+                status = sink.PushBytes(&recLen, sizeof(recLen), pushed);
+            }
+            if (status == ER_OK) {
+                status = sink.PushBytes(data, len, pushed);
+            }
+        }
+        delete [] data;
+        if (status == ER_OK) {
+            revision = rev;
+        }
+    }
+    if (status == ER_OK) {
+        storeState = LOADED;
+        /* Done tracking changes */
+        deletions.clear();
+        updates.clear();
     }
+    storePending = false;
     lock.Unlock(MUTEX_CONTEXT);
     return status;
 }
@@ -668,8 +1030,10 @@ QStatus KeyStore::AddKey(const qcc::GUID128& guid, const KeyBlob& key, const uin
     keyRec.key = key;
     QCC_DbgPrintf(("AccessRights %1x%1x%1x%1x", accessRights[0], accessRights[1], accessRights[2], accessRights[3]));
     memcpy(&keyRec.accessRights, accessRights, sizeof(uint8_t) * 4);
+    IndexExpiration(guid, key);
     storeState = MODIFIED;
     deletions.erase(guid);
+    updates.insert(guid);
     lock.Unlock(MUTEX_CONTEXT);
     return ER_OK;
 }
@@ -684,8 +1048,9 @@ QStatus KeyStore::DelKey(const qcc::GUID128& guid)
     keys->erase(guid);
     storeState = MODIFIED;
     deletions.insert(guid);
+    updates.erase(guid);
     lock.Unlock(MUTEX_CONTEXT);
-    listener->StoreRequest(*this);
+    Store();
     return ER_OK;
 }
 
@@ -699,13 +1064,15 @@ QStatus KeyStore::SetKeyExpiration(const qcc::GUID128& guid, const Timespec& exp
     QCC_DbgPrintf(("KeyStore::SetExpiration %s", guid.ToString().c_str()));
     if (keys->count(guid) != 0) {
         (*keys)[guid].key.SetExpiration(expiration);
+        IndexExpiration(guid, (*keys)[guid].key);
         storeState = MODIFIED;
+        updates.insert(guid);
     } else {
         status = ER_BUS_KEY_UNAVAILABLE;
     }
     lock.Unlock(MUTEX_CONTEXT);
     if (status == ER_OK) {
-        listener->StoreRequest(*this);
+        Store();
     }
     return status;
 }
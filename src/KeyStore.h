@@ -256,6 +256,39 @@ class KeyStore {
      */
     QStatus Push(qcc::Sink& sink);
 
+    /**
+     * Pull journal records into the key store from a source. Journal records are applied on top of
+     * the keys pulled by the most recent call to Pull(). Records that are older than the keys
+     * already loaded are ignored.
+     *
+     * @param source    The source to read the journal records from.
+     *
+     * @return
+     *      - ER_OK if successful
+     *      - An error status otherwise
+     */
+    QStatus PullJournal(qcc::Source& source);
+
+    /**
+     * Push a journal record with the keys that have been added, changed or deleted since the last
+     * call to Push() or PushJournal() into a sink.
+     *
+     * @param sink The sink to write the journal record to.
+     * @return
+     *      - ER_OK if successful
+     *      - An error status otherwise
+     */
+    QStatus PushJournal(qcc::Sink& sink);
+
+    /**
+     * Indicates if the key store must be stored in full by calling Push() rather than by
+     * appending a journal record, for example because the key store was cleared or a journal
+     * record could not be read.
+     *
+     * @return  Returns true if the next store must be a full store.
+     */
+    bool IsCompactionRequired() { return compact; }
+
     /**
      * Indicates if this is a shared key store.
      *
@@ -285,6 +318,16 @@ class KeyStore {
      */
     size_t EraseExpiredKeys();
 
+    /**
+     * Internal function to add a key to the expiry index
+     */
+    void IndexExpiration(const qcc::GUID128& guid, const qcc::KeyBlob& key);
+
+    /**
+     * Internal function to rebuild the expiry index from the key map
+     */
+    void RebuildExpirations();
+
     /**
      * Internal Load function
      */
@@ -331,6 +374,22 @@ class KeyStore {
      */
     std::set<qcc::GUID128> deletions;
 
+    /**
+     * GUID for keys that have been added or changed since the keys were last pushed
+     */
+    std::set<qcc::GUID128> updates;
+
+    /**
+     * Type for the expiry index
+     */
+    typedef std::multimap<uint64_t, qcc::GUID128> ExpiryIndex;
+
+    /**
+     * Key expiration times (absolute milliseconds) in time order. Entries for keys that have since
+     * been changed or deleted are discarded when they reach the front of the index.
+     */
+    ExpiryIndex expirations;
+
     /**
      * Default listener for handling load/store requests
      */
@@ -367,9 +426,14 @@ class KeyStore {
     bool shared;
 
     /**
-     * Event for synchronizing store requests
+     * Indicates the next store must be a full store rather than a journal record
+     */
+    bool compact;
+
+    /**
+     * Indicates the listener is handling a store request
      */
-    qcc::Event* stored;
+    bool storePending;
 
     /**
      * Event for synchronizing load requests
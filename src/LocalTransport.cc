@@ -150,7 +150,7 @@ LocalEndpoint::~LocalEndpoint()
      * Delete any stale reply contexts
      */
     replyMapLock.Lock(MUTEX_CONTEXT);
-    for (map<uint32_t, ReplyContext*>::iterator iter = replyMap.begin(); iter != replyMap.end(); ++iter) {
+    for (ReplyMap::iterator iter = replyMap.begin(); iter != replyMap.end(); ++iter) {
         QCC_DbgHLPrintf(("LocalEndpoint~LocalEndpoint deleting reply handler for serial %u", iter->second->serial));
         delete iter->second;
     }
@@ -605,7 +605,7 @@ LocalEndpoint::ReplyContext* LocalEndpoint::RemoveReplyHandler(uint32_t serial)
 {
     QCC_DbgPrintf(("LocalEndpoint::RemoveReplyHandler for serial=%u", serial));
     ReplyContext* rc = NULL;
-    map<uint32_t, ReplyContext*>::iterator iter = replyMap.find(serial);
+    ReplyMap::iterator iter = replyMap.find(serial);
     if (iter != replyMap.end()) {
         rc = iter->second;
         replyMap.erase(iter);
@@ -619,7 +619,7 @@ bool LocalEndpoint::PauseReplyHandlerTimeout(Message& methodCallMsg)
     bool paused = false;
     if (methodCallMsg->GetType() == MESSAGE_METHOD_CALL) {
         replyMapLock.Lock();
-        map<uint32_t, ReplyContext*>::iterator iter = replyMap.find(methodCallMsg->GetCallSerial());
+        ReplyMap::iterator iter = replyMap.find(methodCallMsg->GetCallSerial());
         if (iter != replyMap.end()) {
             ReplyContext*rc = iter->second;
             paused = rc->ep->GetBus().GetInternal().GetTimer().RemoveAlarm(rc->alarm);
@@ -634,7 +634,7 @@ bool LocalEndpoint::ResumeReplyHandlerTimeout(Message& methodCallMsg)
     bool resumed = false;
     if (methodCallMsg->GetType() == MESSAGE_METHOD_CALL) {
         replyMapLock.Lock();
-        map<uint32_t, ReplyContext*>::iterator iter = replyMap.find(methodCallMsg->GetCallSerial());
+        ReplyMap::iterator iter = replyMap.find(methodCallMsg->GetCallSerial());
         if (iter != replyMap.end()) {
             ReplyContext*rc = iter->second;
             QStatus status = rc->ep->GetBus().GetInternal().GetTimer().AddAlarm(rc->alarm);
@@ -695,7 +695,7 @@ QStatus LocalEndpoint::UnregisterAllHandlers(MessageReceiver* receiver)
      * Remove any reply handlers for this receiver
      */
     replyMapLock.Lock(MUTEX_CONTEXT);
-    for (map<uint32_t, ReplyContext*>::iterator iter = replyMap.begin(); iter != replyMap.end();) {
+    for (ReplyMap::iterator iter = replyMap.begin(); iter != replyMap.end();) {
         ReplyContext* rc = iter->second;
         if (rc->receiver == receiver) {
             replyMap.erase(iter);
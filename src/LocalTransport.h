@@ -439,9 +439,10 @@ class LocalEndpoint : public BusEndpoint, public qcc::AlarmListener, public Mess
     STL_NAMESPACE_PREFIX::unordered_map<const char*, BusObject*, Hash, PathEq> localObjects;
 
     /**
-     * List of contexts for method call replies.
+     * Contexts for method call replies hashed by the serial number of the method call.
      */
-    std::map<uint32_t, ReplyContext*> replyMap;
+    typedef STL_NAMESPACE_PREFIX::unordered_map<uint32_t, ReplyContext*> ReplyMap;
+    ReplyMap replyMap;
 
     bool running;                      /**< Is the local endpoint up and running */
     MethodTable methodTable;           /**< Hash table of BusObject methods */
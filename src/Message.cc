@@ -36,8 +36,11 @@
 
 #include <alljoyn/Message.h>
 #include <alljoyn/BusAttachment.h>
+#include <alljoyn/TypedArgs.h>
 
 #include "BusInternal.h"
+#include "MessageBufferPool.h"
+#include "MessageTrace.h"
 #include "BusUtil.h"
 
 #define QCC_MODULE "ALLJOYN"
@@ -300,6 +303,22 @@ QStatus _Message::GetArgs(const char* signature, ...)
     return status;
 }
 
+QStatus _Message::GetBodyReader(TypedReader& reader) const
+{
+    /*
+     * Encrypted message bodies are decrypted in place when the args are unmarshaled.
+     */
+    if ((msgHeader.flags & ALLJOYN_FLAG_ENCRYPTED) && (msgHeader.bodyLen > 0) && !msgArgs) {
+        return ER_BUS_MESSAGE_DECRYPTION_FAILED;
+    }
+    if (bodyPtr && (msgHeader.bodyLen > 0)) {
+        reader = TypedReader(bodyPtr, msgHeader.bodyLen, endianSwap);
+    } else {
+        reader = TypedReader();
+    }
+    return ER_OK;
+}
+
 _Message::_Message(BusAttachment& bus) :
     bus(&bus),
     endianSwap(false),
@@ -307,6 +326,8 @@ _Message::_Message(BusAttachment& bus) :
     msgBuf(NULL),
     msgArgs(NULL),
     numMsgArgs(0),
+    _hdrBuf(NULL),
+    hdrBufLen(0),
     ttl(0),
     handles(NULL),
     numHandles(0),
@@ -318,7 +339,9 @@ _Message::_Message(BusAttachment& bus) :
 
 _Message::~_Message(void)
 {
-    delete [] _msgBuf;
+    MessageTrace::Destroyed(*this);
+    MessageBufferPool::Free(_msgBuf);
+    MessageBufferPool::Free(_hdrBuf);
     delete [] msgArgs;
     while (numHandles) {
         qcc::Close(handles[--numHandles]);
@@ -332,6 +355,8 @@ _Message::_Message(const _Message& other) :
     msgHeader(other.msgHeader),
     numMsgArgs(other.numMsgArgs),
     bufSize(other.bufSize),
+    _hdrBuf(NULL),
+    hdrBufLen(other.hdrBufLen),
     ttl(other.ttl),
     timestamp(other.timestamp),
     replySignature(other.replySignature),
@@ -341,17 +366,18 @@ _Message::_Message(const _Message& other) :
     encrypt(other.encrypt),
     hdrFields(other.hdrFields)
 {
+    MessageTrace::Copied(other, *this);
     if (bufSize > 0) {
         assert(other.msgBuf != NULL);
-        _msgBuf = new uint8_t[bufSize + 7];
-        msgBuf = (uint64_t*)((uintptr_t)(_msgBuf + 7) & ~7);
+        _msgBuf = MessageBufferPool::Alloc(bufSize);
+        msgBuf = (uint64_t*)_msgBuf; /* Pool buffers are aligned to an 8 byte boundary */
         bufEOD = ((uint8_t*)msgBuf) + (other.bufEOD - ((uint8_t*)other.msgBuf));
         bufPos = ((uint8_t*)msgBuf) + (other.bufPos - ((uint8_t*)other.msgBuf));
         bodyPtr = ((uint8_t*)msgBuf) + (other.bodyPtr - ((uint8_t*)other.msgBuf));
         /*
          * Copy in buffer and zero fill the pad at the end of the data
          */
-        ::memcpy(msgBuf, other.msgBuf, bufSize);
+        ::memcpy(msgBuf, other.msgBuf, bufEOD - (uint8_t*)msgBuf);
         ::memset(bufEOD, 0, (uint8_t*)msgBuf + bufSize - bufEOD);
     } else {
         assert(other.msgBuf == NULL);
@@ -361,6 +387,10 @@ _Message::_Message(const _Message& other) :
         bufPos = NULL;
         bodyPtr = NULL;
     }
+    if (other._hdrBuf) {
+        _hdrBuf = MessageBufferPool::Alloc(hdrBufLen);
+        ::memcpy(_hdrBuf, other._hdrBuf, hdrBufLen);
+    }
     if (numMsgArgs > 0) {
         msgArgs =  new MsgArg[numMsgArgs];
         for (size_t i = 0; i < numMsgArgs; ++i) {
@@ -407,8 +437,8 @@ QStatus _Message::ReMarshal(const char* senderName)
      * message reducing the places where we need to check for bufEOD when unmarshaling the body.
      */
     bufSize = sizeof(msgHeader) + ((((msgHeader.headerLen + 7) & ~7) + msgHeader.bodyLen + 7) & ~7) + 8;
-    _msgBuf = new uint8_t[bufSize + 7];
-    msgBuf = (uint64_t*)((uintptr_t)(_msgBuf + 7) & ~7); /* Align to 8 byte boundary */
+    _msgBuf = MessageBufferPool::Alloc(bufSize);
+    msgBuf = (uint64_t*)_msgBuf; /* Pool buffers are aligned to an 8 byte boundary */
     bufPos = (uint8_t*)msgBuf;
     memcpy(bufPos, &msgHeader, sizeof(msgHeader));
     bufPos += sizeof(msgHeader);
@@ -440,7 +470,68 @@ QStatus _Message::ReMarshal(const char* senderName)
      */
     assert((size_t)(bufEOD - (uint8_t*)msgBuf) < bufSize);
     memset(bufEOD, 0, (uint8_t*)msgBuf + bufSize - bufEOD);
-    delete [] _savBuf;
+    MessageBufferPool::Free(_savBuf);
+    /*
+     * The header is back in the message buffer so any separate header block is stale
+     */
+    MessageBufferPool::Free(_hdrBuf);
+    _hdrBuf = NULL;
+    hdrBufLen = 0;
+    return ER_OK;
+}
+
+QStatus _Message::RewriteSender(const char* senderName)
+{
+    /*
+     * Decryption authenticates the header and body together so they must be contiguous. A message
+     * with a TTL is also kept contiguous because sinks such as packet engine streams expire each
+     * push on its own, and the header must not expire while the body is still delivered. The
+     * message is folded here because once it is routed it may be queued on several endpoints.
+     */
+    if ((msgHeader.flags & ALLJOYN_FLAG_ENCRYPTED) || (hdrFields.field[ALLJOYN_HDR_FIELD_TIME_TO_LIVE].typeId != ALLJOYN_INVALID)) {
+        return ReMarshal(senderName);
+    }
+
+    hdrFields.field[ALLJOYN_HDR_FIELD_SENDER].Set("s", senderName);
+
+    /*
+     * The body stays where it is in the message buffer. The header is marshaled into a block of
+     * its own by pointing the marshaling state at the block for the duration.
+     */
+    uint8_t* _savBuf = _msgBuf;
+    size_t savSize = bufSize;
+    uint8_t* savEOD = bufEOD;
+    uint8_t* savBody = bodyPtr;
+
+    size_t hdrLen = ComputeHeaderLen();
+    _msgBuf = MessageBufferPool::Alloc(hdrLen + 8);
+    msgBuf = (uint64_t*)_msgBuf; /* Pool buffers are aligned to an 8 byte boundary */
+    bufSize = MessageBufferPool::Capacity(_msgBuf);
+    bufPos = (uint8_t*)msgBuf;
+    memcpy(bufPos, &msgHeader, sizeof(msgHeader));
+    bufPos += sizeof(msgHeader);
+    if (endianSwap) {
+        MessageHeader* hdr = (MessageHeader*)msgBuf;
+        hdr->bodyLen = EndianSwap32(hdr->bodyLen);
+        hdr->serialNum = EndianSwap32(hdr->serialNum);
+        hdr->headerLen = EndianSwap32(hdr->headerLen);
+    }
+    MarshalHeaderFields();
+    assert((size_t)(bufPos - (uint8_t*)msgBuf) == hdrLen);
+
+    /*
+     * A previous rewrite is replaced by this one
+     */
+    MessageBufferPool::Free(_hdrBuf);
+    _hdrBuf = _msgBuf;
+    hdrBufLen = bufPos - _hdrBuf;
+
+    _msgBuf = _savBuf;
+    msgBuf = (uint64_t*)_msgBuf;
+    bufSize = savSize;
+    bufEOD = savEOD;
+    bodyPtr = savBody;
+    bufPos = bufEOD;
     return ER_OK;
 }
 
@@ -0,0 +1,155 @@
+/**
+ * @file
+ * Implementation of the message buffer pool.
+ */
+
+/******************************************************************************
+ * Copyright 2012, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#include <qcc/platform.h>
+
+#include <assert.h>
+
+#include <qcc/Mutex.h>
+#include <qcc/Debug.h>
+
+#include "MessageBufferPool.h"
+
+#define QCC_MODULE "ALLJOYN"
+
+using namespace qcc;
+
+namespace ajn {
+
+/*
+ * Smallest size class is 256 bytes, largest is 256K which covers the largest legal message.
+ */
+static const size_t MIN_CLASS_SHIFT = 8;
+static const size_t NUM_CLASSES = 11;
+
+/*
+ * Maximum number of bytes kept on the free list for each size class. At least one buffer is
+ * always kept.
+ */
+static const size_t MAX_FREE_BYTES_PER_CLASS = 128 * 1024;
+
+/*
+ * Each buffer is preceded by a 64 bit word that holds the capacity of the buffer. While a buffer
+ * is on a free list the first word of the buffer holds the free list link.
+ */
+struct FreeBuf {
+    FreeBuf* next;
+};
+
+class BufferPool {
+  public:
+
+    BufferPool() : active(true)
+    {
+        for (size_t i = 0; i < NUM_CLASSES; ++i) {
+            freeList[i] = NULL;
+            numFree[i] = 0;
+        }
+    }
+
+    ~BufferPool()
+    {
+        /*
+         * Messages that are destroyed after the pool (e.g. static messages) are freed directly.
+         */
+        active = false;
+        for (size_t i = 0; i < NUM_CLASSES; ++i) {
+            while (freeList[i]) {
+                FreeBuf* fb = freeList[i];
+                freeList[i] = fb->next;
+                delete [] (reinterpret_cast<uint64_t*>(fb) - 1);
+            }
+        }
+    }
+
+    volatile bool active;
+    Mutex lock[NUM_CLASSES];
+    FreeBuf* freeList[NUM_CLASSES];
+    size_t numFree[NUM_CLASSES];
+};
+
+static BufferPool pool;
+
+static inline size_t SizeClass(size_t size)
+{
+    size_t c = 0;
+    while ((c < NUM_CLASSES) && (size > ((size_t)1 << (MIN_CLASS_SHIFT + c)))) {
+        ++c;
+    }
+    return c;
+}
+
+static inline size_t MaxFree(size_t c)
+{
+    size_t n = MAX_FREE_BYTES_PER_CLASS >> (MIN_CLASS_SHIFT + c);
+    return n ? n : 1;
+}
+
+uint8_t* MessageBufferPool::Alloc(size_t size)
+{
+    size_t c = SizeClass(size);
+    if ((c < NUM_CLASSES) && pool.active) {
+        pool.lock[c].Lock(MUTEX_CONTEXT);
+        FreeBuf* fb = pool.freeList[c];
+        if (fb) {
+            pool.freeList[c] = fb->next;
+            --pool.numFree[c];
+        }
+        pool.lock[c].Unlock(MUTEX_CONTEXT);
+        if (fb) {
+            return reinterpret_cast<uint8_t*>(fb);
+        }
+        size = (size_t)1 << (MIN_CLASS_SHIFT + c);
+    } else {
+        size = (size + 7) & ~7;
+    }
+    uint64_t* block = new uint64_t[1 + size / 8];
+    block[0] = size;
+    return reinterpret_cast<uint8_t*>(block + 1);
+}
+
+void MessageBufferPool::Free(uint8_t* buf)
+{
+    if (buf) {
+        uint64_t* block = reinterpret_cast<uint64_t*>(buf) - 1;
+        size_t c = SizeClass((size_t)block[0]);
+        if ((c < NUM_CLASSES) && (block[0] == ((uint64_t)1 << (MIN_CLASS_SHIFT + c))) && pool.active) {
+            pool.lock[c].Lock(MUTEX_CONTEXT);
+            if (pool.numFree[c] < MaxFree(c)) {
+                FreeBuf* fb = reinterpret_cast<FreeBuf*>(buf);
+                fb->next = pool.freeList[c];
+                pool.freeList[c] = fb;
+                ++pool.numFree[c];
+                block = NULL;
+            }
+            pool.lock[c].Unlock(MUTEX_CONTEXT);
+        }
+        delete [] block;
+    }
+}
+
+size_t MessageBufferPool::Capacity(const uint8_t* buf)
+{
+    assert(buf);
+    return (size_t)(reinterpret_cast<const uint64_t*>(buf) - 1)[0];
+}
+
+}
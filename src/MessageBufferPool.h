@@ -0,0 +1,72 @@
+/**
+ * @file
+ * Pool of recycled message buffers
+ */
+
+/******************************************************************************
+ * Copyright 2012, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#ifndef _ALLJOYN_MESSAGEBUFFERPOOL_H
+#define _ALLJOYN_MESSAGEBUFFERPOOL_H
+
+#ifndef __cplusplus
+#error Only include MessageBufferPool.h in C++ code.
+#endif
+
+#include <qcc/platform.h>
+
+namespace ajn {
+
+/**
+ * Message buffers are allocated and freed for every message that is marshaled or unmarshaled.
+ * This class recycles those buffers. Buffers are rounded up to a power of two size class and
+ * freed buffers are kept on a per size class free list up to a fixed number of bytes per class.
+ * Buffers that are too large for any size class are allocated and freed directly.
+ *
+ * All buffers returned are aligned on an 8 byte boundary.
+ */
+class MessageBufferPool {
+  public:
+
+    /**
+     * Allocate a buffer.
+     *
+     * @param size  The minimum size of the buffer.
+     *
+     * @return  A buffer of at least size bytes.
+     */
+    static uint8_t* Alloc(size_t size);
+
+    /**
+     * Return a buffer to the pool.
+     *
+     * @param buf  A buffer previously allocated by Alloc() or NULL.
+     */
+    static void Free(uint8_t* buf);
+
+    /**
+     * Get the actual usable size of a buffer. This may be larger than the size requested when the
+     * buffer was allocated.
+     *
+     * @param buf  A buffer previously allocated by Alloc().
+     *
+     * @return  The usable size of the buffer.
+     */
+    static size_t Capacity(const uint8_t* buf);
+};
+
+}
+
+#endif
@@ -0,0 +1,272 @@
+/**
+ * @file
+ * Sampled tracing of messages as they pass through the endpoints and the router.
+ */
+
+/******************************************************************************
+ * Copyright 2012, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#include <qcc/platform.h>
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#include <qcc/Debug.h>
+#include <qcc/FileStream.h>
+#include <qcc/Mutex.h>
+#include <qcc/StringUtil.h>
+
+#include "MessageTrace.h"
+
+#define QCC_MODULE "ALLJOYN"
+
+using namespace qcc;
+using namespace std;
+
+namespace ajn {
+
+/*
+ * Rings are only allocated for threads that record an event and are reused after the thread exits
+ * so there are never more rings than threads that have been active at once.
+ */
+static const size_t MAX_RINGS = 256;
+
+/*
+ * Sampled messages normally live only until they are delivered.  The limit guards against messages
+ * that are held on to, which would otherwise make every trace point slower.
+ */
+static const size_t MAX_TRACED = 4096;
+
+volatile uint32_t MessageTrace::sampleInterval = 0;
+volatile int32_t MessageTrace::lastTraceId = 0;
+volatile int32_t MessageTrace::numTraced = 0;
+
+class RingRegistry {
+  public:
+    ~RingRegistry()
+    {
+        for (size_t i = 0; i < rings.size(); ++i) {
+            delete rings[i];
+        }
+    }
+
+    Mutex lock;
+    vector<MessageTraceRing*> rings;
+
+    struct Traced {
+        uint32_t traceId;
+        MessageTraceRing* ring;
+    };
+
+    Mutex tracedLock;
+    map<const _Message*, Traced> traced;
+};
+
+static RingRegistry registry;
+
+static bool RecordLess(const MessageTrace::Record& a, const MessageTrace::Record& b)
+{
+    if (a.traceId != b.traceId) {
+        return a.traceId < b.traceId;
+    }
+    /* Consecutive stages are often recorded within the same microsecond */
+    if (a.timestamp != b.timestamp) {
+        return a.timestamp < b.timestamp;
+    }
+    return a.stage < b.stage;
+}
+
+MessageTrace::Ring* MessageTrace::AcquireRing(qcc::Thread& thread)
+{
+    Ring* ring = NULL;
+    registry.lock.Lock(MUTEX_CONTEXT);
+    for (size_t i = 0; i < registry.rings.size(); ++i) {
+        if (!registry.rings[i]->inUse) {
+            ring = registry.rings[i];
+            /* Events left by the previous owner would be attributed to the new one */
+            ring->cleared = ring->head;
+            break;
+        }
+    }
+    if (!ring && (registry.rings.size() < MAX_RINGS)) {
+        ring = new Ring();
+        registry.rings.push_back(ring);
+    }
+    if (ring) {
+        ring->name = thread.GetName();
+        ring->owner = &thread;
+        ring->inUse = true;
+    } else {
+        QCC_DbgPrintf(("No trace ring available for %s", thread.GetName()));
+    }
+    registry.lock.Unlock(MUTEX_CONTEXT);
+    return ring;
+}
+
+void MessageTrace::ReleaseRing(Ring*& ring)
+{
+    if (ring) {
+        registry.lock.Lock(MUTEX_CONTEXT);
+        ring->owner = NULL;
+        ring->inUse = false;
+        registry.lock.Unlock(MUTEX_CONTEXT);
+        ring = NULL;
+    }
+}
+
+void MessageTrace::Collect(vector<Record>& records)
+{
+    registry.lock.Lock(MUTEX_CONTEXT);
+    for (size_t i = 0; i < registry.rings.size(); ++i) {
+        const Ring* ring = registry.rings[i];
+        uint32_t head = static_cast<uint32_t>(ring->head);
+        uint32_t first = static_cast<uint32_t>(ring->cleared);
+        if ((head - first) > Ring::RING_SIZE) {
+            first = head - Ring::RING_SIZE;
+        }
+        vector<Ring::Event> events(ring->events, ring->events + Ring::RING_SIZE);
+        /* Skip events that the owner may have overwritten while they were copied */
+        uint32_t after = static_cast<uint32_t>(ring->head);
+        if ((after - first) > Ring::RING_SIZE) {
+            first = after - Ring::RING_SIZE;
+            if ((head - first) > Ring::RING_SIZE) {
+                continue;
+            }
+        }
+        for (uint32_t n = first; n != head; ++n) {
+            const Ring::Event& ev = events[n & (Ring::RING_SIZE - 1)];
+            Record rec;
+            rec.traceId = ev.traceId;
+            rec.stage = static_cast<Stage>(ev.stage);
+            rec.timestamp = ev.timestamp;
+            rec.thread = ring->name;
+            records.push_back(rec);
+        }
+    }
+    registry.lock.Unlock(MUTEX_CONTEXT);
+    sort(records.begin(), records.end(), RecordLess);
+}
+
+bool MessageTrace::Add(const _Message& msg, uint32_t traceId, Ring* ring)
+{
+    bool added = false;
+    registry.tracedLock.Lock(MUTEX_CONTEXT);
+    if (registry.traced.size() < MAX_TRACED) {
+        RingRegistry::Traced& t = registry.traced[&msg];
+        t.traceId = traceId;
+        t.ring = ring;
+        numTraced = registry.traced.size();
+        added = true;
+    }
+    registry.tracedLock.Unlock(MUTEX_CONTEXT);
+    return added;
+}
+
+bool MessageTrace::Find(const _Message& msg, uint32_t& traceId, Ring*& ring)
+{
+    bool found = false;
+    registry.tracedLock.Lock(MUTEX_CONTEXT);
+    map<const _Message*, RingRegistry::Traced>::const_iterator it = registry.traced.find(&msg);
+    if (it != registry.traced.end()) {
+        traceId = it->second.traceId;
+        ring = it->second.ring;
+        found = true;
+    }
+    registry.tracedLock.Unlock(MUTEX_CONTEXT);
+    return found;
+}
+
+void MessageTrace::Track(const _Message& from, const _Message& to)
+{
+    uint32_t traceId;
+    Ring* ring;
+    if (Find(from, traceId, ring)) {
+        /* The copy is not on the path of the rx thread that sampled the original */
+        Add(to, traceId, NULL);
+    }
+}
+
+void MessageTrace::Forget(const _Message& msg)
+{
+    registry.tracedLock.Lock(MUTEX_CONTEXT);
+    registry.traced.erase(&msg);
+    numTraced = registry.traced.size();
+    registry.tracedLock.Unlock(MUTEX_CONTEXT);
+}
+
+void MessageTrace::Clear()
+{
+    registry.lock.Lock(MUTEX_CONTEXT);
+    for (size_t i = 0; i < registry.rings.size(); ++i) {
+        registry.rings[i]->cleared = registry.rings[i]->head;
+    }
+    registry.lock.Unlock(MUTEX_CONTEXT);
+}
+
+QStatus MessageTrace::WriteFile(const char* fileName)
+{
+    QStatus status = ER_OK;
+    FileSink sink(fileName, FileSink::PRIVATE);
+    if (!sink.IsValid()) {
+        status = ER_BUS_WRITE_ERROR;
+        QCC_LogError(status, ("Cannot create trace file %s", fileName));
+        return status;
+    }
+
+    vector<Record> records;
+    Collect(records);
+
+    qcc::String out("trace_id,stage,timestamp_us,thread\n");
+    for (vector<Record>::const_iterator it = records.begin(); it != records.end(); ++it) {
+        out += U32ToString(it->traceId) + "," + StageText(it->stage) + "," + U64ToString(it->timestamp) + "," + it->thread + "\n";
+    }
+
+    size_t pushed;
+    status = sink.PushBytes(out.data(), out.size(), pushed);
+    if ((status == ER_OK) && (pushed != out.size())) {
+        status = ER_BUS_WRITE_ERROR;
+    }
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Failed to write trace file %s", fileName));
+    }
+    return status;
+}
+
+const char* MessageTrace::StageText(Stage stage)
+{
+    switch (stage) {
+    case UNMARSHALED:
+        return "unmarshaled";
+
+    case ROUTED:
+        return "routed";
+
+    case TX_QUEUED:
+        return "tx_queued";
+
+    case TX_DEQUEUED:
+        return "tx_dequeued";
+
+    case DELIVERED:
+        return "delivered";
+
+    default:
+        return "unknown";
+    }
+}
+
+}
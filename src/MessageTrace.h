@@ -0,0 +1,334 @@
+/**
+ * @file
+ * Sampled tracing of messages as they pass through the endpoints and the router.
+ */
+
+/******************************************************************************
+ * Copyright 2012, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#ifndef _ALLJOYN_MESSAGETRACE_H
+#define _ALLJOYN_MESSAGETRACE_H
+
+#ifndef __cplusplus
+#error Only include MessageTrace.h in C++ code.
+#endif
+
+#include <qcc/platform.h>
+
+#include <vector>
+
+#include <qcc/String.h>
+#include <qcc/Thread.h>
+#include <qcc/atomic.h>
+
+#include <alljoyn/Message.h>
+
+#include <Status.h>
+
+#include "MicroTimestamp.h"
+
+namespace ajn {
+
+class MessageTraceRing;
+
+/**
+ * Message tracing records a timestamp for a sample of the messages received by remote endpoints at
+ * each of these points:
+ *
+ * - UNMARSHALED: the rx thread has unmarshaled the message (the message is sampled here).
+ * - ROUTED: the router has picked a destination endpoint for the message.
+ * - TX_QUEUED: the message has been put on the transmit queue of the destination endpoint.
+ * - TX_DEQUEUED: the tx thread of the destination endpoint has taken the message off the queue.
+ * - DELIVERED: the tx thread has written the message to the transport.
+ *
+ * The first three happen on the rx thread that received the message and the last two on the tx
+ * thread of each destination.  Each of these threads records into a ring of its own so recording
+ * takes no lock.  A message sent to several destinations has a ROUTED, TX_QUEUED, TX_DEQUEUED and
+ * DELIVERED event for each one.  Events are matched up by the trace id given to the message when
+ * it was sampled.
+ *
+ * The trace id of a sampled message is kept in a table owned by MessageTrace rather than in the
+ * message itself.  Tracing is off until a sample interval is set.  While it is off and no sampled
+ * message is still alive the cost is a test of the interval for each message received and a test
+ * of the number of traced messages at each of the other points and when a message is destroyed.
+ */
+class MessageTrace {
+  public:
+
+    /**
+     * Points in the path of a message where events are recorded.
+     */
+    typedef enum {
+        UNMARSHALED = 0,
+        ROUTED = 1,
+        TX_QUEUED = 2,
+        TX_DEQUEUED = 3,
+        DELIVERED = 4
+    } Stage;
+
+    /**
+     * An event collected from the trace rings.
+     */
+    struct Record {
+        uint32_t traceId;       /**< Id of the traced message */
+        Stage stage;            /**< Point the message reached */
+        uint64_t timestamp;     /**< Time the message reached the point, see GetMicroTimestamp() */
+        qcc::String thread;     /**< Name of the thread that recorded the event */
+    };
+
+    /**
+     * Ring of the most recent events recorded by one thread.
+     */
+    typedef MessageTraceRing Ring;
+
+    /**
+     * Set how often received messages are traced.
+     *
+     * @param interval  One in every interval messages received by each endpoint is traced.  0
+     *                  turns tracing off.
+     */
+    static void SetSampleInterval(uint32_t interval) { sampleInterval = interval; }
+
+    /**
+     * Get how often received messages are traced.
+     *
+     * @return  The sample interval, 0 if tracing is off.
+     */
+    static uint32_t GetSampleInterval() { return sampleInterval; }
+
+    /**
+     * Called by an rx thread when a message has been unmarshaled.  Decides whether the message is
+     * traced and if it is records the UNMARSHALED event.
+     *
+     * @param msg         The message.
+     * @param countdown   Number of messages received by the thread since one was traced.
+     * @param ring        Ring of the calling thread, allocated on first use.
+     * @param thread      The calling thread.
+     */
+    static void Sample(Message& msg, uint32_t& countdown, Ring*& ring, qcc::Thread& thread);
+
+    /**
+     * Record an event for a traced message on the rx thread that sampled it.  Nothing is recorded
+     * if the message is not traced or the calling thread is not the one that sampled it.
+     *
+     * @param msg     The message.
+     * @param stage   Point the message has reached.
+     */
+    static void Trace(const Message& msg, Stage stage);
+
+    /**
+     * Record an event for a traced message on a tx thread.
+     *
+     * @param msg     The message.
+     * @param stage   Point the message has reached.
+     * @param ring    Ring of the calling thread, allocated on first use.
+     * @param thread  The calling thread.
+     */
+    static void Trace(const Message& msg, Stage stage, Ring*& ring, qcc::Thread& thread);
+
+    /**
+     * Called when a message is copied so the copy is traced under the same trace id.  Events for
+     * the copy are only recorded by tx threads.
+     *
+     * @param from   The message that was copied.
+     * @param to     The copy.
+     */
+    static void Copied(const _Message& from, const _Message& to)
+    {
+        if (numTraced) {
+            Track(from, to);
+        }
+    }
+
+    /**
+     * Called when a message is destroyed so its trace id is forgotten.
+     *
+     * @param msg   The message.
+     */
+    static void Destroyed(const _Message& msg)
+    {
+        if (numTraced) {
+            Forget(msg);
+        }
+    }
+
+    /**
+     * Give up a ring when the thread that owns it exits.  The events in the ring can still be
+     * collected until the ring is handed to another thread.
+     *
+     * @param ring   The ring or NULL.  Set to NULL on return.
+     */
+    static void ReleaseRing(Ring*& ring);
+
+    /**
+     * Collect the events in all the rings.
+     *
+     * @param[out] records   The events sorted by trace id and time.
+     */
+    static void Collect(std::vector<Record>& records);
+
+    /**
+     * Discard all the events recorded so far.
+     */
+    static void Clear();
+
+    /**
+     * Write the events in all the rings to a file as comma separated values, one event per line.
+     *
+     * @param fileName   Name of the file to write.
+     *
+     * @return  ER_OK if the file was written.
+     */
+    static QStatus WriteFile(const char* fileName);
+
+    /**
+     * Get the name of a stage.
+     *
+     * @param stage   The stage.
+     *
+     * @return  The name.
+     */
+    static const char* StageText(Stage stage);
+
+  private:
+
+    static Ring* AcquireRing(qcc::Thread& thread);
+
+    /**
+     * Give a message a trace id.
+     *
+     * @param msg       The message.
+     * @param traceId   The trace id.
+     * @param ring      Ring of the rx thread that sampled the message or NULL.
+     *
+     * @return  false if too many traced messages are alive to trace another one.
+     */
+    static bool Add(const _Message& msg, uint32_t traceId, Ring* ring);
+
+    /**
+     * Look up the trace id of a message.
+     *
+     * @param msg           The message.
+     * @param[out] traceId  The trace id.
+     * @param[out] ring     Ring of the rx thread that sampled the message or NULL.
+     *
+     * @return  true if the message is traced.
+     */
+    static bool Find(const _Message& msg, uint32_t& traceId, Ring*& ring);
+
+    static void Track(const _Message& from, const _Message& to);
+
+    static void Forget(const _Message& msg);
+
+    static uint32_t NextTraceId()
+    {
+        uint32_t id;
+        do {
+            id = static_cast<uint32_t>(qcc::IncrementAndFetch(&lastTraceId));
+        } while (id == 0);
+        return id;
+    }
+
+    static volatile uint32_t sampleInterval;   /**< One in this many messages is traced, 0 for none */
+    static volatile int32_t lastTraceId;       /**< Most recently assigned trace id */
+    static volatile int32_t numTraced;         /**< Number of traced messages that are alive */
+};
+
+/**
+ * Ring of the most recent events recorded by one thread.
+ */
+class MessageTraceRing {
+    friend class MessageTrace;
+
+  public:
+
+    static const uint32_t RING_SIZE = 1024;   /**< Number of events kept, a power of two */
+
+    /**
+     * Record an event.  Must only be called by the thread that owns the ring.
+     *
+     * @param traceId   Trace id of the message.
+     * @param stage     Point the message has reached.
+     */
+    void Record(uint32_t traceId, MessageTrace::Stage stage)
+    {
+        Event& ev = events[static_cast<uint32_t>(head) & (RING_SIZE - 1)];
+        ev.traceId = traceId;
+        ev.stage = stage;
+        ev.timestamp = GetMicroTimestamp();
+        /* The atomic increment orders the event before the new head for readers */
+        qcc::IncrementAndFetch(&head);
+    }
+
+  private:
+
+    struct Event {
+        uint32_t traceId;
+        uint32_t stage;
+        uint64_t timestamp;
+    };
+
+    MessageTraceRing() : head(0), cleared(0), owner(NULL), inUse(false) { }
+
+    Event events[RING_SIZE];    /**< Events, the most recent is at head - 1 */
+    volatile int32_t head;      /**< Number of events ever recorded in the ring */
+    int32_t cleared;            /**< Value of head when the ring was last cleared */
+    qcc::String name;           /**< Name of the thread the ring belongs (or belonged) to */
+    qcc::Thread* owner;         /**< Thread the ring belongs to */
+    bool inUse;                 /**< False if the ring can be handed to another thread */
+};
+
+inline void MessageTrace::Sample(Message& msg, uint32_t& countdown, Ring*& ring, qcc::Thread& thread)
+{
+    if (sampleInterval && (++countdown >= sampleInterval)) {
+        countdown = 0;
+        if (!ring) {
+            ring = AcquireRing(thread);
+        }
+        if (ring) {
+            uint32_t traceId = NextTraceId();
+            if (Add(*msg, traceId, ring)) {
+                ring->Record(traceId, UNMARSHALED);
+            }
+        }
+    }
+}
+
+inline void MessageTrace::Trace(const Message& msg, Stage stage)
+{
+    uint32_t traceId;
+    Ring* sampler;
+    if (numTraced && Find(*msg, traceId, sampler) && sampler && (sampler->owner == qcc::Thread::GetThread())) {
+        sampler->Record(traceId, stage);
+    }
+}
+
+inline void MessageTrace::Trace(const Message& msg, Stage stage, Ring*& ring, qcc::Thread& thread)
+{
+    uint32_t traceId;
+    Ring* sampler;
+    if (numTraced && Find(*msg, traceId, sampler)) {
+        if (!ring) {
+            ring = AcquireRing(thread);
+        }
+        if (ring) {
+            ring->Record(traceId, stage);
+        }
+    }
+}
+
+}
+
+#endif
@@ -22,6 +22,8 @@
 
 #include <qcc/platform.h>
 
+#include <algorithm>
+
 #include <qcc/String.h>
 #include <qcc/StringUtil.h>
 #include <qcc/Debug.h>
@@ -33,8 +35,10 @@
 #include <alljoyn/AllJoynStd.h>
 #include <alljoyn/Message.h>
 #include <alljoyn/MsgArg.h>
+#include <alljoyn/TypedArgs.h>
 
 #include "LocalTransport.h"
+#include "MessageBufferPool.h"
 #include "PeerState.h"
 #include "KeyStore.h"
 #include "CompressionRules.h"
@@ -102,6 +106,61 @@ namespace ajn {
  */
 #define ROUNDUP8(n)  (((n) + 7) & ~7)
 
+/*
+ * Largest buffer that will be allocated for marshaling a message. This allows some slack over the
+ * maximum packet length because the space reserved for each arg is an upper bound.
+ */
+#define MAX_MARSHAL_BUF_LEN  (ALLJOYN_MAX_PACKET_LEN + 1024)
+
+/*
+ * Upper bound on the number of bytes MarshalArgs() writes for an arg, including alignment padding
+ * but not including any nested args.
+ */
+static inline size_t MarshalSizeBound(const MsgArg* arg)
+{
+    size_t elemSize;
+
+    switch (arg->typeId) {
+    case ALLJOYN_SIGNATURE:
+        return 8 + 2 + (arg->v_signature.sig ? arg->v_signature.len : 0);
+
+    case ALLJOYN_OBJECT_PATH:
+    case ALLJOYN_STRING:
+        return 8 + 4 + 1 + (arg->v_string.str ? arg->v_string.len : 0);
+
+    case ALLJOYN_VARIANT:
+        return 8 + 2 + 256;
+
+    case ALLJOYN_BYTE_ARRAY:
+        elemSize = 1;
+        break;
+
+    case ALLJOYN_INT16_ARRAY:
+    case ALLJOYN_UINT16_ARRAY:
+        elemSize = 2;
+        break;
+
+    case ALLJOYN_BOOLEAN_ARRAY:
+    case ALLJOYN_INT32_ARRAY:
+    case ALLJOYN_UINT32_ARRAY:
+        elemSize = 4;
+        break;
+
+    case ALLJOYN_DOUBLE_ARRAY:
+    case ALLJOYN_UINT64_ARRAY:
+    case ALLJOYN_INT64_ARRAY:
+        elemSize = 8;
+        break;
+
+    default:
+        return 16;
+    }
+    if (arg->v_scalarArray.numElements > MAX_MARSHAL_BUF_LEN) {
+        return 16 + MAX_MARSHAL_BUF_LEN;
+    }
+    return 16 + elemSize * arg->v_scalarArray.numElements;
+}
+
 static inline QStatus CheckedArraySize(size_t sz, uint32_t& len)
 {
     if (sz > ALLJOYN_MAX_ARRAY_LEN) {
@@ -125,6 +184,16 @@ QStatus _Message::MarshalArgs(const MsgArg* arg, size_t numArgs)
             status = ER_BUS_BAD_VALUE;
             break;
         }
+        /*
+         * Make sure there is room in the buffer for this arg
+         */
+        size_t bound = MarshalSizeBound(arg);
+        if (bound > (size_t)(((uint8_t*)msgBuf + bufSize) - bufPos)) {
+            status = GrowMsgBuf(bound);
+            if (status != ER_OK) {
+                break;
+            }
+        }
         /*
          * Align on boundary for type as specified in the wire protocol
          */
@@ -164,24 +233,25 @@ QStatus _Message::MarshalArgs(const MsgArg* arg, size_t numArgs)
                     }
                 }
                 if (status == ER_OK) {
-                    uint8_t* lenPos = bufPos;
+                    /* The buffer can move while the elements are marshaled so remember offsets */
+                    size_t lenOffset = bufPos - (uint8_t*)msgBuf;
                     bufPos += 4;
                     /* Length does not include padding for first element, so pad to 8 byte boundary if required. */
                     if (alignment == 8) {
                         MarshalPad(8);
                     }
-                    uint8_t* elemPos = bufPos;
+                    size_t elemOffset = bufPos - (uint8_t*)msgBuf;
                     status = MarshalArgs(arg->v_array.elements, arg->v_array.numElements);
                     if (status != ER_OK) {
                         break;
                     }
-                    status = CheckedArraySize(bufPos - elemPos, len);
+                    status = CheckedArraySize(bufPos - ((uint8_t*)msgBuf + elemOffset), len);
                     if (status != ER_OK) {
                         break;
                     }
                     /* Patch in length */
                     uint8_t* tmpPos = bufPos;
-                    bufPos = lenPos;
+                    bufPos = (uint8_t*)msgBuf + lenOffset;
                     if (endianSwap) {
                         MarshalReversed(&len, 4);
                     } else {
@@ -448,6 +518,57 @@ QStatus _Message::MarshalArgs(const MsgArg* arg, size_t numArgs)
     return status;
 }
 
+/*
+ * Move the message to a larger buffer. Any pointers into the current buffer are relocated.
+ */
+QStatus _Message::GrowMsgBuf(size_t needed)
+{
+    uint8_t* oldBuf = (uint8_t*)msgBuf;
+    uint8_t* oldEnd = oldBuf + bufSize;
+    size_t used = bufPos - oldBuf;
+
+    if ((used + needed) > MAX_MARSHAL_BUF_LEN) {
+        QStatus status = ER_BUS_BAD_BODY_LEN;
+        QCC_LogError(status, ("Message size exceeds maximum size"));
+        return status;
+    }
+    size_t newSize = (std::min)((std::max)(2 * bufSize, used + needed), (size_t)MAX_MARSHAL_BUF_LEN);
+    uint8_t* newBuf = MessageBufferPool::Alloc(newSize);
+    memcpy(newBuf, oldBuf, used);
+    /*
+     * Header fields that have already been marshaled point into the buffer.
+     */
+    for (uint32_t fieldId = ALLJOYN_HDR_FIELD_PATH; fieldId < ArraySize(hdrFields.field); fieldId++) {
+        MsgArg* field = &hdrFields.field[fieldId];
+        switch (field->typeId) {
+        case ALLJOYN_SIGNATURE:
+            if (((uint8_t*)field->v_signature.sig >= oldBuf) && ((uint8_t*)field->v_signature.sig < oldEnd)) {
+                field->v_signature.sig = (char*)newBuf + ((uint8_t*)field->v_signature.sig - oldBuf);
+            }
+            break;
+
+        case ALLJOYN_OBJECT_PATH:
+        case ALLJOYN_STRING:
+            if (((uint8_t*)field->v_string.str >= oldBuf) && ((uint8_t*)field->v_string.str < oldEnd)) {
+                field->v_string.str = (char*)newBuf + ((uint8_t*)field->v_string.str - oldBuf);
+            }
+            break;
+
+        default:
+            break;
+        }
+    }
+    if ((bodyPtr >= oldBuf) && (bodyPtr < oldEnd)) {
+        bodyPtr = newBuf + (bodyPtr - oldBuf);
+    }
+    MessageBufferPool::Free(_msgBuf);
+    _msgBuf = newBuf;
+    msgBuf = (uint64_t*)_msgBuf;
+    bufSize = MessageBufferPool::Capacity(_msgBuf);
+    bufPos = newBuf + used;
+    return ER_OK;
+}
+
 QStatus _Message::Deliver(RemoteEndpoint& endpoint)
 {
     QStatus status = ER_OK;
@@ -490,6 +611,15 @@ QStatus _Message::Deliver(RemoteEndpoint& endpoint)
             return ER_OK;
         }
     }
+    /*
+     * If the header was rewritten it is sent from its own block followed by the body from the
+     * message buffer. The endpoint's transmit thread is the only writer to the sink so the two
+     * parts go out back to back.
+     */
+    if (_hdrBuf) {
+        buf = _hdrBuf;
+        len = hdrBufLen;
+    }
     /*
      * Push the message to the endpoint sink (only push handles in the first chunk)
      */
@@ -506,7 +636,16 @@ QStatus _Message::Deliver(RemoteEndpoint& endpoint)
     while ((status == ER_OK) && (pushed != len)) {
         len -= pushed;
         buf += pushed;
-        status = sink.PushBytes(buf, len, pushed);
+        status = sink.PushBytes(buf, len, pushed, ttl);
+    }
+    if ((status == ER_OK) && _hdrBuf) {
+        buf = bodyPtr;
+        len = bufEOD - bodyPtr;
+        while ((status == ER_OK) && (len > 0)) {
+            status = sink.PushBytes(buf, len, pushed, ttl);
+            len -= pushed;
+            buf += pushed;
+        }
     }
     if (status == ER_OK) {
         QCC_DbgHLPrintf(("Deliver message %s to %s", Description().c_str(), endpoint.GetUniqueName().c_str()));
@@ -704,13 +843,27 @@ QStatus _Message::MarshalMessage(const qcc::String& expectedSignature,
                                  const MsgArg* args,
                                  uint8_t numArgs,
                                  uint8_t flags,
-                                 uint32_t sessionId)
+                                 uint32_t sessionId,
+                                 const TypedBody* typedBody)
 {
     char signature[256];
     QStatus status = ER_OK;
-    size_t argsLen = (numArgs == 0) ? 0 : SignatureUtils::GetSize(args, numArgs);
+    size_t argsLen = 0;
     size_t hdrLen = 0;
 
+    /*
+     * A typed body computes its own size without building any MsgArgs. MsgArgs are marshaled in a
+     * single pass growing the buffer as needed.
+     */
+    if (typedBody) {
+        TypedWriter sizer;
+        typedBody->Marshal(sizer);
+        if (sizer.GetStatus() != ER_OK) {
+            return sizer.GetStatus();
+        }
+        argsLen = sizer.GetSize();
+    }
+
     if (!bus->IsStarted()) {
         return ER_BUS_BUS_NOT_STARTED;
     }
@@ -728,7 +881,8 @@ QStatus _Message::MarshalMessage(const qcc::String& expectedSignature,
     msgHeader.majorVersion = ALLJOYN_MAJOR_PROTOCOL_VERSION;
     /*
      * Encryption will typically make the body length slightly larger because the encryption
-     * algorithm appends a MAC block to the end of the encrypted data.
+     * algorithm appends a MAC block to the end of the encrypted data. For MsgArgs the body length
+     * is patched into the header after the body has been marshaled.
      */
     if (encrypt) {
         msgHeader.bodyLen = static_cast<uint32_t>(argsLen + ajn::Crypto::MACLength);
@@ -740,6 +894,7 @@ QStatus _Message::MarshalMessage(const qcc::String& expectedSignature,
      * marshaling may point into the old message.
      */
     uint8_t* _oldMsgBuf = _msgBuf;
+    uint8_t* _oldHdrBuf = _hdrBuf;
     /*
      * Clear out stale message data
      */
@@ -748,6 +903,8 @@ QStatus _Message::MarshalMessage(const qcc::String& expectedSignature,
     bufEOD = NULL;
     msgBuf = NULL;
     _msgBuf = NULL;
+    _hdrBuf = NULL;
+    hdrBufLen = 0;
     /*
      * There should be a mapping for every field type
      */
@@ -779,7 +936,19 @@ QStatus _Message::MarshalMessage(const qcc::String& expectedSignature,
      * If there are arguments build the signature
      */
     hdrFields.field[ALLJOYN_HDR_FIELD_SIGNATURE].Clear();
-    if (numArgs > 0) {
+    if (typedBody) {
+        const qcc::String& typedSig = typedBody->GetSignature();
+        if (typedSig.size() >= sizeof(signature)) {
+            status = ER_BUS_BAD_SIGNATURE;
+            goto ExitMarshalMessage;
+        }
+        memcpy(signature, typedSig.c_str(), typedSig.size() + 1);
+        if (!typedSig.empty()) {
+            hdrFields.field[ALLJOYN_HDR_FIELD_SIGNATURE].typeId = ALLJOYN_SIGNATURE;
+            hdrFields.field[ALLJOYN_HDR_FIELD_SIGNATURE].v_signature.sig = signature;
+            hdrFields.field[ALLJOYN_HDR_FIELD_SIGNATURE].v_signature.len = (uint8_t)typedSig.size();
+        }
+    } else if (numArgs > 0) {
         size_t sigLen = 0;
         status = SignatureUtils::MakeSignature(args, numArgs, signature, sigLen);
         if (status != ER_OK) {
@@ -829,11 +998,12 @@ QStatus _Message::MarshalMessage(const qcc::String& expectedSignature,
         goto ExitMarshalMessage;
     }
     /*
-     * Allocate buffer for entire message.
+     * Allocate buffer for the message. When marshaling MsgArgs this is only the initial size, the
+     * buffer grows as the body is marshaled.
      */
-    bufSize = (hdrLen + msgHeader.bodyLen + 7);
-    _msgBuf = new uint8_t[bufSize + 7];
-    msgBuf = (uint64_t*)((uintptr_t)(_msgBuf + 7) & ~7); /* Align to 8 byte boundary */
+    _msgBuf = MessageBufferPool::Alloc(hdrLen + msgHeader.bodyLen + 8);
+    msgBuf = (uint64_t*)_msgBuf; /* Pool buffers are aligned to an 8 byte boundary */
+    bufSize = MessageBufferPool::Capacity(_msgBuf);
     /*
      * Initialize the buffer and copy in the message header
      */
@@ -863,7 +1033,7 @@ QStatus _Message::MarshalMessage(const qcc::String& expectedSignature,
      */
     MarshalHeaderFields();
     assert((bufPos - (uint8_t*)msgBuf) == static_cast<ptrdiff_t>(hdrLen));
-    if (msgHeader.bodyLen == 0) {
+    if (!encrypt && (typedBody ? (argsLen == 0) : (numArgs == 0))) {
         bufEOD = bufPos;
         bodyPtr = NULL;
         goto ExitMarshalMessage;
@@ -872,10 +1042,40 @@ QStatus _Message::MarshalMessage(const qcc::String& expectedSignature,
      * Marshal the message body
      */
     bodyPtr = bufPos;
-    status = MarshalArgs(args, numArgs);
+    if (typedBody) {
+        TypedWriter writer(bufPos, endianSwap);
+        typedBody->Marshal(writer);
+        bufPos += writer.GetSize();
+        status = writer.GetStatus();
+    } else {
+        status = MarshalArgs(args, numArgs);
+    }
     if (status != ER_OK) {
         goto ExitMarshalMessage;
     }
+    /*
+     * Now we know the body length check the total packet size and patch the body length into the
+     * marshaled header.
+     */
+    if (!typedBody) {
+        argsLen = bufPos - bodyPtr;
+        if ((hdrLen + argsLen) > ALLJOYN_MAX_PACKET_LEN) {
+            status = ER_BUS_BAD_BODY_LEN;
+            QCC_LogError(status, ("Message size %d exceeds maximum size", hdrLen + argsLen));
+            goto ExitMarshalMessage;
+        }
+        msgHeader.bodyLen = static_cast<uint32_t>(encrypt ? (argsLen + ajn::Crypto::MACLength) : argsLen);
+        ((MessageHeader*)msgBuf)->bodyLen = endianSwap ? EndianSwap32(msgHeader.bodyLen) : msgHeader.bodyLen;
+        /*
+         * Make sure there is room for the MAC that is appended when the message is encrypted.
+         */
+        if ((size_t)(((uint8_t*)msgBuf + bufSize) - bufPos) < (msgHeader.bodyLen - argsLen + 8)) {
+            status = GrowMsgBuf(msgHeader.bodyLen - argsLen + 8);
+            if (status != ER_OK) {
+                goto ExitMarshalMessage;
+            }
+        }
+    }
     /*
      * If there handles to be marshalled we need to patch up the message header to add the
      * ALLJOYN_HDR_FIELD_HANDLES field. Since handles are rare it is more efficient to do a
@@ -889,7 +1089,7 @@ QStatus _Message::MarshalMessage(const qcc::String& expectedSignature,
         }
     }
     /*
-     * Assert that our two different body size computations agree
+     * Assert that the marshaled body size agrees with the computed body size
      */
     assert((bufPos - bodyPtr) == (ptrdiff_t)argsLen);
     bufEOD = bodyPtr + msgHeader.bodyLen;
@@ -903,14 +1103,15 @@ ExitMarshalMessage:
     /*
      * Don't need the old message buffer any more
      */
-    delete [] _oldMsgBuf;
+    MessageBufferPool::Free(_oldMsgBuf);
+    MessageBufferPool::Free(_oldHdrBuf);
 
     if (status == ER_OK) {
         QCC_DbgHLPrintf(("MarshalMessage: %d+%d %s %s", hdrLen, msgHeader.bodyLen, Description().c_str(), encrypt ? " (encrypted)" : ""));
     } else {
         QCC_LogError(status, ("MarshalMessage: %s", Description().c_str()));
         msgBuf = NULL;
-        delete [] _msgBuf;
+        MessageBufferPool::Free(_msgBuf);
         _msgBuf = NULL;
         bodyPtr = NULL;
         bufPos = NULL;
@@ -1006,6 +1207,32 @@ QStatus _Message::CallMsg(const qcc::String& signature,
                           const MsgArg* args,
                           size_t numArgs,
                           uint8_t flags)
+{
+    return BuildCallMsg(signature, destination, sessionId, objPath, iface, methodName, args, numArgs, NULL, flags);
+}
+
+QStatus _Message::CallMsg(const qcc::String& signature,
+                          const qcc::String& destination,
+                          SessionId sessionId,
+                          const qcc::String& objPath,
+                          const qcc::String& iface,
+                          const qcc::String& methodName,
+                          const TypedBody& body,
+                          uint8_t flags)
+{
+    return BuildCallMsg(signature, destination, sessionId, objPath, iface, methodName, NULL, 0, &body, flags);
+}
+
+QStatus _Message::BuildCallMsg(const qcc::String& signature,
+                               const qcc::String& destination,
+                               SessionId sessionId,
+                               const qcc::String& objPath,
+                               const qcc::String& iface,
+                               const qcc::String& methodName,
+                               const MsgArg* args,
+                               size_t numArgs,
+                               const TypedBody* typedBody,
+                               uint8_t flags)
 {
     QStatus status;
 
@@ -1057,7 +1284,7 @@ QStatus _Message::CallMsg(const qcc::String& signature,
     /*
      * Build method call message
      */
-    status = MarshalMessage(signature, destination, MESSAGE_METHOD_CALL, args, numArgs, flags, sessionId);
+    status = MarshalMessage(signature, destination, MESSAGE_METHOD_CALL, args, numArgs, flags, sessionId, typedBody);
 
 ExitCallMsg:
     return status;
@@ -1140,6 +1367,16 @@ ExitSignalMsg:
 
 
 QStatus _Message::ReplyMsg(const Message& call, const MsgArg* args, size_t numArgs)
+{
+    return BuildReplyMsg(call, args, numArgs, NULL);
+}
+
+QStatus _Message::ReplyMsg(const Message& call, const TypedBody& body)
+{
+    return BuildReplyMsg(call, NULL, 0, &body);
+}
+
+QStatus _Message::BuildReplyMsg(const Message& call, const MsgArg* args, size_t numArgs, const TypedBody* typedBody)
 {
     QStatus status;
     SessionId sessionId = call->GetSessionId();
@@ -1165,7 +1402,7 @@ QStatus _Message::ReplyMsg(const Message& call, const MsgArg* args, size_t numAr
      * Build method return message (encrypted if the method call was encrypted)
      */
     status = MarshalMessage(call->replySignature, destination, MESSAGE_METHOD_RET, args,
-                            numArgs, call->msgHeader.flags & ALLJOYN_FLAG_ENCRYPTED, sessionId);
+                            numArgs, call->msgHeader.flags & ALLJOYN_FLAG_ENCRYPTED, sessionId, typedBody);
 
     return status;
 }
@@ -1341,6 +1578,9 @@ void _Message::SetSerialNumber()
     if (msgBuf) {
         ((MessageHeader*)msgBuf)->serialNum = endianSwap ? EndianSwap32(msgHeader.serialNum) : msgHeader.serialNum;
     }
+    if (_hdrBuf) {
+        ((MessageHeader*)_hdrBuf)->serialNum = endianSwap ? EndianSwap32(msgHeader.serialNum) : msgHeader.serialNum;
+    }
 }
 
 }
@@ -42,6 +42,7 @@
 #include "AllJoynPeerObj.h"
 #include "SignatureUtils.h"
 #include "BusInternal.h"
+#include "MessageBufferPool.h"
 
 #define QCC_MODULE "ALLJOYN"
 
@@ -584,9 +585,18 @@ QStatus _Message::UnmarshalArgs(const qcc::String& expectedSignature, const char
     }
 
     if (msgHeader.flags & ALLJOYN_FLAG_ENCRYPTED) {
+        /*
+         * RewriteSender() leaves an encrypted message contiguous so it can be authenticated
+         */
+        assert(!_hdrBuf);
         bool broadcast = (hdrFields.field[ALLJOYN_HDR_FIELD_DESTINATION].typeId == ALLJOYN_INVALID);
         size_t hdrLen = bodyPtr - (uint8_t*)msgBuf;
-        PeerState peerState = bus->GetInternal().GetPeerStateTable()->GetPeerState(GetSender());
+        /*
+         * A sender we hold no peer state for has no keys so the lookup is not allowed to create
+         * an entry; the empty peer state we get instead fails to provide a key below.
+         */
+        PeerState peerState;
+        bus->GetInternal().GetPeerStateTable()->FindPeerState(GetSender(), peerState);
         KeyBlob key;
         status = peerState->GetKey(key, broadcast ? PEER_GROUP_KEY : PEER_SESSION_KEY);
         if (status != ER_OK) {
@@ -890,8 +900,11 @@ QStatus _Message::Unmarshal(RemoteEndpoint& endpoint, bool checkSender, bool ped
      * Clear out any stale message state
      */
     msgBuf = NULL;
-    delete [] _msgBuf;
+    MessageBufferPool::Free(_msgBuf);
     _msgBuf = NULL;
+    MessageBufferPool::Free(_hdrBuf);
+    _hdrBuf = NULL;
+    hdrBufLen = 0;
     ClearHeader();
     /*
      * Read the message header
@@ -961,8 +974,8 @@ QStatus _Message::Unmarshal(RemoteEndpoint& endpoint, bool checkSender, bool ped
      * message reducing the places where we need to check for bufEOD when unmarshaling the body.
      */
     bufSize = sizeof(msgHeader) + ((pktSize + 7) & ~7) + sizeof(uint64_t);
-    _msgBuf = new uint8_t[bufSize + 7];
-    msgBuf = (uint64_t*)((uintptr_t)(_msgBuf + 7) & ~7); /* Align to 8 byte boundary */
+    _msgBuf = MessageBufferPool::Alloc(bufSize);
+    msgBuf = (uint64_t*)_msgBuf; /* Pool buffers are aligned to an 8 byte boundary */
     /*
      * Copy header into the buffer
      */
@@ -1109,11 +1122,11 @@ QStatus _Message::Unmarshal(RemoteEndpoint& endpoint, bool checkSender, bool ped
          */
         if ((senderField->typeId == ALLJOYN_INVALID) || (rcvEndpointName != senderField->v_string.str)) {
             QCC_DbgHLPrintf(("Replacing missing or bad sender field %s by %s", senderField->ToString().c_str(), rcvEndpointName.c_str()));
-            status = ReMarshal(rcvEndpointName.c_str());
+            status = RewriteSender(rcvEndpointName.c_str());
         }
     }
     if (senderField->typeId != ALLJOYN_INVALID) {
-        PeerState peerState = bus->GetInternal().GetPeerStateTable()->GetPeerState(senderField->v_string.str);
+        PeerState peerState = endpoint.GetPeerState(senderField->v_string.str);
         bool unreliable = hdrFields.field[ALLJOYN_HDR_FIELD_TIME_TO_LIVE].typeId != ALLJOYN_INVALID;
         bool secure = (msgHeader.flags & ALLJOYN_FLAG_ENCRYPTED) != 0;
         /*
@@ -1208,8 +1221,11 @@ ExitUnmarshal:
          * There was an unrecoverable failure while unmarshaling the message, cleanup before we return.
          */
         msgBuf = NULL;
-        delete [] _msgBuf;
+        MessageBufferPool::Free(_msgBuf);
         _msgBuf = NULL;
+        MessageBufferPool::Free(_hdrBuf);
+        _hdrBuf = NULL;
+        hdrBufLen = 0;
         ClearHeader();
         if ((status != ER_SOCK_OTHER_END_CLOSED) && (status != ER_STOPPING_THREAD)) {
             QCC_LogError(status, ("Failed to unmarshal message received on %s", endpoint.GetUniqueName().c_str()));
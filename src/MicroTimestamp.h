@@ -0,0 +1,42 @@
+/**
+ * @file
+ * Monotonic clock with microsecond resolution shared by the metrics and message traces.
+ */
+
+/******************************************************************************
+ * Copyright 2012, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#ifndef _ALLJOYN_MICROTIMESTAMP_H
+#define _ALLJOYN_MICROTIMESTAMP_H
+
+#ifndef __cplusplus
+#error Only include MicroTimestamp.h in C++ code.
+#endif
+
+#include <qcc/platform.h>
+
+namespace ajn {
+
+/**
+ * Get a monotonic timestamp with microsecond resolution.  Unlike qcc::GetTimestamp64() the clock
+ * does not jump when the wall clock is changed.
+ *
+ * @return  Microseconds since an arbitrary point in time.
+ */
+uint64_t GetMicroTimestamp();
+
+}
+
+#endif
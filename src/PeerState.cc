@@ -24,6 +24,7 @@
 #include <algorithm>
 #include <limits>
 
+#include <qcc/atomic.h>
 #include <qcc/Debug.h>
 #include <qcc/Crypto.h>
 #include <qcc/time.h>
@@ -86,46 +87,131 @@ bool _PeerState::IsValidSerial(uint32_t serial, bool secure, bool unreliable)
 
 }
 
-PeerStateTable::PeerStateTable()
+PeerStateTable::PeerStateTable() : generation(0)
 {
     Clear();
 }
 
 PeerState PeerStateTable::GetPeerState(const qcc::String& busName)
 {
-    lock.Lock(MUTEX_CONTEXT);
-    QCC_DbgHLPrintf(("PeerStateTable::GetPeerState() %s state for %s", peerMap.count(busName) ? "got" : "no", busName.c_str()));
-    PeerState result = peerMap[busName];
-    lock.Unlock(MUTEX_CONTEXT);
+    Shard& shard = GetShard(busName);
+    PeerState result;
+    shard.lock.Lock(MUTEX_CONTEXT);
+    STL_NAMESPACE_PREFIX::unordered_map<qcc::String, PeerState, Hash, Equal>::iterator iter = shard.peerMap.find(busName);
+    if (iter == shard.peerMap.end()) {
+        QCC_DbgHLPrintf(("PeerStateTable::GetPeerState() no state stored for %s", busName.c_str()));
+        /* Keep the serial number window of a sender that is becoming a known peer */
+        result = TakeSenderState(shard, busName);
+        shard.peerMap[busName] = result;
+        IncrementAndFetch(&generation);
+    } else {
+        QCC_DbgHLPrintf(("PeerStateTable::GetPeerState() got state for %s", busName.c_str()));
+        result = iter->second;
+    }
+    shard.lock.Unlock(MUTEX_CONTEXT);
+    return result;
+}
+
+bool PeerStateTable::FindPeerState(const qcc::String& busName, PeerState& peerState)
+{
+    Shard& shard = GetShard(busName);
+    shard.lock.Lock(MUTEX_CONTEXT);
+    STL_NAMESPACE_PREFIX::unordered_map<qcc::String, PeerState, Hash, Equal>::iterator iter = shard.peerMap.find(busName);
+    bool found = (iter != shard.peerMap.end());
+    if (found) {
+        peerState = iter->second;
+    }
+    shard.lock.Unlock(MUTEX_CONTEXT);
+    return found;
+}
 
+PeerState PeerStateTable::GetSenderState(const qcc::String& sender)
+{
+    Shard& shard = GetShard(sender);
+    PeerState result;
+    shard.lock.Lock(MUTEX_CONTEXT);
+    STL_NAMESPACE_PREFIX::unordered_map<qcc::String, PeerState, Hash, Equal>::iterator iter = shard.peerMap.find(sender);
+    if (iter != shard.peerMap.end()) {
+        result = iter->second;
+    } else {
+        STL_NAMESPACE_PREFIX::unordered_map<qcc::String, SenderState, Hash, Equal>::iterator sit = shard.senderMap.find(sender);
+        if (sit != shard.senderMap.end()) {
+            result = sit->second.peerState;
+            shard.senderLru.splice(shard.senderLru.begin(), shard.senderLru, sit->second.lru);
+        } else {
+            /*
+             * Only the least recently used sender is dropped so a flood of new names cannot
+             * reopen the serial number windows of the senders that are active.
+             */
+            if (shard.senderMap.size() >= MAX_SENDERS_PER_SHARD) {
+                QCC_DbgHLPrintf(("PeerStateTable::GetSenderState() dropping state for %s", shard.senderLru.back().c_str()));
+                shard.senderMap.erase(shard.senderLru.back());
+                shard.senderLru.pop_back();
+            }
+            shard.senderLru.push_front(sender);
+            SenderState& state = shard.senderMap[sender];
+            state.peerState = result;
+            state.lru = shard.senderLru.begin();
+            IncrementAndFetch(&generation);
+        }
+    }
+    shard.lock.Unlock(MUTEX_CONTEXT);
     return result;
 }
 
+PeerState PeerStateTable::TakeSenderState(Shard& shard, const qcc::String& busName)
+{
+    PeerState result;
+    STL_NAMESPACE_PREFIX::unordered_map<qcc::String, SenderState, Hash, Equal>::iterator sit = shard.senderMap.find(busName);
+    if (sit != shard.senderMap.end()) {
+        result = sit->second.peerState;
+        shard.senderLru.erase(sit->second.lru);
+        shard.senderMap.erase(sit);
+    }
+    return result;
+}
+
+void PeerStateTable::SetPeerState(const qcc::String& busName, const PeerState& peerState)
+{
+    Shard& shard = GetShard(busName);
+    shard.lock.Lock(MUTEX_CONTEXT);
+    TakeSenderState(shard, busName);
+    shard.peerMap[busName] = peerState;
+    shard.lock.Unlock(MUTEX_CONTEXT);
+}
+
 PeerState PeerStateTable::GetPeerState(const qcc::String& uniqueName, const qcc::String& aliasName)
 {
     assert(uniqueName[0] == ':');
     PeerState result;
-    lock.Lock(MUTEX_CONTEXT);
-    std::map<const qcc::String, PeerState>::iterator iter = peerMap.find(uniqueName);
-    if (iter == peerMap.end()) {
-        QCC_DbgHLPrintf(("PeerStateTable::GetPeerState() no state stored for %s aka %s", uniqueName.c_str(), aliasName.c_str()));
-        result = peerMap[aliasName];
-        peerMap[uniqueName] = result;
-    } else {
+    if (FindPeerState(uniqueName, result)) {
         QCC_DbgHLPrintf(("PeerStateTable::GetPeerState() got state for %s aka %s", uniqueName.c_str(), aliasName.c_str()));
-        result = iter->second;
-        peerMap[aliasName] = result;
+    } else {
+        QCC_DbgHLPrintf(("PeerStateTable::GetPeerState() no state stored for %s aka %s", uniqueName.c_str(), aliasName.c_str()));
+        if (!FindPeerState(aliasName, result)) {
+            result = GetPeerState(uniqueName);
+        }
+        SetPeerState(uniqueName, result);
     }
-    lock.Unlock(MUTEX_CONTEXT);
+    SetPeerState(aliasName, result);
+    IncrementAndFetch(&generation);
     return result;
 }
 
 void PeerStateTable::DelPeerState(const qcc::String& busName)
 {
-    lock.Lock(MUTEX_CONTEXT);
-    QCC_DbgHLPrintf(("PeerStateTable::DelPeerState() %s for %s", peerMap.count(busName) ? "remove state" : "no state to remove", busName.c_str()));
-    peerMap.erase(busName);
-    lock.Unlock(MUTEX_CONTEXT);
+    Shard& shard = GetShard(busName);
+    shard.lock.Lock(MUTEX_CONTEXT);
+    QCC_DbgHLPrintf(("PeerStateTable::DelPeerState() %s for %s", shard.peerMap.count(busName) ? "remove state" : "no state to remove", busName.c_str()));
+    bool erased = shard.peerMap.erase(busName) > 0;
+    if (shard.senderMap.count(busName)) {
+        TakeSenderState(shard, busName);
+        erased = true;
+    }
+    if (erased) {
+        IncrementAndFetch(&generation);
+    }
+    shard.lock.Unlock(MUTEX_CONTEXT);
 }
 
 void PeerStateTable::GetGroupKey(qcc::KeyBlob& key)
@@ -144,22 +230,38 @@ void PeerStateTable::GetGroupKey(qcc::KeyBlob& key)
 void PeerStateTable::Clear()
 {
     qcc::KeyBlob key;
-    lock.Lock(MUTEX_CONTEXT);
-    peerMap.clear();
+    /*
+     * Take all the shard locks so nobody sees a partly cleared table.
+     */
+    for (size_t i = 0; i < NUM_SHARDS; ++i) {
+        shards[i].lock.Lock(MUTEX_CONTEXT);
+    }
+    for (size_t i = 0; i < NUM_SHARDS; ++i) {
+        shards[i].peerMap.clear();
+        shards[i].senderMap.clear();
+        shards[i].senderLru.clear();
+    }
     PeerState nullPeer;
     QCC_DbgHLPrintf(("Allocating group key"));
     key.Rand(Crypto_AES::AES128_SIZE, KeyBlob::AES);
     key.SetTag("GroupKey", KeyBlob::NO_ROLE);
     nullPeer->SetKey(key, PEER_SESSION_KEY);
-    peerMap[""] = nullPeer;
-    lock.Unlock(MUTEX_CONTEXT);
+    GetShard("").peerMap[""] = nullPeer;
+    IncrementAndFetch(&generation);
+    for (size_t i = NUM_SHARDS; i > 0; --i) {
+        shards[i - 1].lock.Unlock(MUTEX_CONTEXT);
+    }
 }
 
 PeerStateTable::~PeerStateTable()
 {
-    lock.Lock(MUTEX_CONTEXT);
-    peerMap.clear();
-    lock.Unlock(MUTEX_CONTEXT);
+    for (size_t i = 0; i < NUM_SHARDS; ++i) {
+        shards[i].lock.Lock(MUTEX_CONTEXT);
+        shards[i].peerMap.clear();
+        shards[i].senderMap.clear();
+        shards[i].senderLru.clear();
+        shards[i].lock.Unlock(MUTEX_CONTEXT);
+    }
 }
 
 }
@@ -27,12 +27,14 @@
 
 #include <qcc/platform.h>
 
+#include <list>
 #include <map>
 #include <limits>
 #include <assert.h>
 
 #include <alljoyn/Message.h>
 
+#include <qcc/atomic.h>
 #include <qcc/String.h>
 #include <qcc/GUID.h>
 #include <qcc/KeyBlob.h>
@@ -40,6 +42,7 @@
 #include <qcc/Mutex.h>
 #include <qcc/Event.h>
 #include <qcc/time.h>
+#include <qcc/STLContainer.h>
 
 #include <Status.h>
 
@@ -311,6 +314,14 @@ class _PeerState {
 
 /**
  * This class is a container for managing state information about remote peers.
+ *
+ * The table is split into shards, each with its own lock, so that lookups for different peers
+ * don't contend.  Every change to the set of peers bumps a generation number so that holders of
+ * a cached PeerState (see RemoteEndpoint::GetPeerState()) can cheaply tell when to look again.
+ *
+ * Senders of messages that are not known peers get peer state too, to check their serial numbers
+ * and timestamps, but it is kept apart from the known peers and bounded by a least recently used
+ * list.
  */
 class PeerStateTable {
 
@@ -322,7 +333,9 @@ class PeerStateTable {
     PeerStateTable();
 
     /**
-     * Get the peer state for given a bus name.
+     * Get the peer state for given a bus name, creating an entry if there isn't one.  Only use
+     * this where the state must be kept, for example to store keys; use FindPeerState() for
+     * lookups.
      *
      * @param busName   The bus name for a remote connection
      *
@@ -330,6 +343,29 @@ class PeerStateTable {
      */
     PeerState GetPeerState(const qcc::String& busName);
 
+    /**
+     * Look up the peer state for a bus name without creating an entry for an unknown peer.
+     *
+     * @param busName    The bus name for a remote connection
+     * @param peerState  [out] Returns the peer state if the peer is known.
+     *
+     * @return  Returns true if the peer is known.
+     */
+    bool FindPeerState(const qcc::String& busName, PeerState& peerState);
+
+    /**
+     * Get the peer state used to check the serial numbers and timestamps of messages from a
+     * sender.  A sender that is not a known peer gets peer state that FindPeerState() and
+     * IsKnownPeer() don't see.  When a shard holds too many of these the least recently used one
+     * is dropped.  The same peer state is returned whichever endpoint the message came in on so
+     * a message replayed over a redundant link is still caught.
+     *
+     * @param sender   Unique name of the sender.
+     *
+     * @return  The peer state for the sender.
+     */
+    PeerState GetSenderState(const qcc::String& sender);
+
     /**
      * Fnd out if the bus name is for a known peer.
      *
@@ -338,9 +374,10 @@ class PeerStateTable {
      * @return  Returns true if the peer is known.
      */
     bool IsKnownPeer(const qcc::String& busName) {
-        lock.Lock(MUTEX_CONTEXT);
-        bool known = peerMap.count(busName) > 0;
-        lock.Unlock(MUTEX_CONTEXT);
+        Shard& shard = GetShard(busName);
+        shard.lock.Lock(MUTEX_CONTEXT);
+        bool known = shard.peerMap.count(busName) > 0;
+        shard.lock.Unlock(MUTEX_CONTEXT);
         return known;
     }
 
@@ -363,7 +400,12 @@ class PeerStateTable {
      * @return  Returns true if the two bus names are known to refer to the same peer.
      */
     bool IsAlias(const qcc::String& name1, const qcc::String& name2) {
-        return (name1 == name2) || (GetPeerState(name1).iden(GetPeerState(name2)));
+        if (name1 == name2) {
+            return true;
+        }
+        PeerState peer1;
+        PeerState peer2;
+        return FindPeerState(name1, peer1) && FindPeerState(name2, peer2) && peer1.iden(peer2);
     }
 
     /**
@@ -386,6 +428,15 @@ class PeerStateTable {
      */
     void Clear();
 
+    /**
+     * Get the generation of the table.  This changes whenever an entry is added, removed or
+     * aliased, so a PeerState obtained from the table is still the right one for its bus name as
+     * long as the generation is unchanged.
+     *
+     * @return  The current generation.
+     */
+    uint32_t GetGeneration() const { return static_cast<uint32_t>(generation); }
+
     /**
      * Destructor
      */
@@ -393,15 +444,75 @@ class PeerStateTable {
 
   private:
 
+    struct Hash {
+        inline size_t operator()(const qcc::String& s) const {
+            return qcc::hash_string(s.c_str());
+        }
+    };
+
+    struct Equal {
+        inline bool operator()(const qcc::String& s1, const qcc::String& s2) const {
+            return s1 == s2;
+        }
+    };
+
+    /**
+     * Peer state of a sender that is not a known peer and its place in the shard's LRU list.
+     */
+    struct SenderState {
+        PeerState peerState;
+        std::list<qcc::String>::iterator lru;
+    };
+
+    /**
+     * One shard of the table: the peers whose bus names hash to it and the lock protecting them.
+     */
+    struct Shard {
+        qcc::Mutex lock;
+        STL_NAMESPACE_PREFIX::unordered_map<qcc::String, PeerState, Hash, Equal> peerMap;
+        STL_NAMESPACE_PREFIX::unordered_map<qcc::String, SenderState, Hash, Equal> senderMap;
+        std::list<qcc::String> senderLru;   /**< Keys of senderMap, most recently used first */
+    };
+
+    /**
+     * Number of shards.  Must be a power of two.
+     */
+    static const size_t NUM_SHARDS = 16;
+
+    /**
+     * Maximum number of senders that are not known peers kept in each shard.
+     */
+    static const size_t MAX_SENDERS_PER_SHARD = 64;
+
+    /**
+     * Make a bus name refer to a peer state, replacing any sender state for the name.  The
+     * caller is responsible for bumping the generation.
+     */
+    void SetPeerState(const qcc::String& busName, const PeerState& peerState);
+
+    /**
+     * Remove the sender state for a bus name. Must be called with the shard lock held.
+     *
+     * @return  The sender state if there was one, otherwise a new peer state.
+     */
+    PeerState TakeSenderState(Shard& shard, const qcc::String& busName);
+
+    /**
+     * Get the shard that holds a given bus name.
+     */
+    Shard& GetShard(const qcc::String& busName) {
+        return shards[Hash()(busName) & (NUM_SHARDS - 1)];
+    }
+
     /**
-     * Mapping table from bus names to peer state.
+     * Mapping tables from bus names to peer state.
      */
-    std::map<const qcc::String, PeerState> peerMap;
+    Shard shards[NUM_SHARDS];
 
     /**
-     * Mutex to protect the peer table
+     * Generation number, atomically incremented whenever the set of peers changes.
      */
-    qcc::Mutex lock;
+    volatile int32_t generation;
 
 };
 
@@ -34,6 +34,7 @@
 #include <qcc/Event.h>
 #include <qcc/Mutex.h>
 #include <qcc/ManagedObj.h>
+#include <qcc/atomic.h>
 
 #include <alljoyn/BusAttachment.h>
 #include <alljoyn/DBusStd.h>
@@ -697,15 +698,145 @@ QStatus ProxyBusObject::MethodCallAsync(const char* ifaceName,
 }
 
 /**
- * Internal context structure used between synchronous method_call and method_return
+ * Internal context structure used between synchronous method_call and method_return. A single
+ * context (and a single event) is shared by all of the method calls issued by one synchronous
+ * call so a batch of N calls costs one allocation and one wait rather than N of each. The context
+ * is reference counted so it can outlive the caller if a reply handler is still running when the
+ * caller gives up waiting.
  */
 class SyncReplyContext {
   public:
-    SyncReplyContext(BusAttachment& bus) : replyMsg(bus) { }
-    Message replyMsg;
+
+    /**
+     * One slot per method call. A pointer to the slot is the context passed to the reply handler.
+     */
+    struct Slot {
+        Slot(SyncReplyContext* ctx, Message& callMsg) : ctx(ctx), callMsg(&callMsg), replyMsg(callMsg), done(0) { }
+        SyncReplyContext* ctx;
+        Message* callMsg;         /**< Owned by the caller and only valid while the caller is waiting */
+        Message replyMsg;         /**< Only valid once done is non-zero */
+        volatile int32_t done;
+    };
+
+    SyncReplyContext(Message* callMsgs, size_t numCalls) : refs(1), outstanding(1)
+    {
+        slots.reserve(numCalls);
+        for (size_t i = 0; i < numCalls; ++i) {
+            slots.push_back(Slot(this, callMsgs[i]));
+        }
+    }
+
+    void AddRef() { IncrementAndFetch(&refs); }
+
+    void Release()
+    {
+        if (DecrementAndFetch(&refs) == 0) {
+            delete this;
+        }
+    }
+
+    /**
+     * Decrement the count of outstanding replies. Returns true when the count reaches zero.
+     */
+    bool Complete() { return DecrementAndFetch(&outstanding) == 0; }
+
+    vector<Slot> slots;
+    volatile int32_t refs;
+    volatile int32_t outstanding;
     Event event;
+
+  private:
+    SyncReplyContext(const SyncReplyContext& other);
+    SyncReplyContext& operator=(const SyncReplyContext& other);
 };
 
+QStatus ProxyBusObject::SyncMethodCalls(const InterfaceDescription::Member& method, SyncReplyContext* ctxt, uint32_t timeout) const
+{
+    QStatus status = ER_OK;
+    LocalEndpoint& localEndpoint = bus->GetInternal().GetLocalEndpoint();
+    size_t issued = 0;
+
+    /*
+     * Synchronous calls are really asynchronous calls that block waiting for a builtin
+     * reply handler to be called. The outstanding count starts at one so replies that arrive
+     * while later calls in the batch are still being sent cannot signal completion early.
+     */
+    while ((status == ER_OK) && (issued < ctxt->slots.size())) {
+        SyncReplyContext::Slot& slot = ctxt->slots[issued];
+        ctxt->AddRef();
+        IncrementAndFetch(&ctxt->outstanding);
+        status = localEndpoint.RegisterReplyHandler(const_cast<MessageReceiver*>(static_cast<const MessageReceiver* const>(this)),
+                                                    static_cast<MessageReceiver::ReplyHandler>(&ProxyBusObject::SyncReplyHandler),
+                                                    method,
+                                                    *slot.callMsg,
+                                                    &slot,
+                                                    timeout);
+        if (status == ER_OK) {
+            if (b2bEp) {
+                status = b2bEp->PushMessage(*slot.callMsg);
+            } else {
+                status = bus->GetInternal().GetRouter().PushMessage(*slot.callMsg, localEndpoint);
+            }
+            if ((status != ER_OK) && !localEndpoint.UnregisterReplyHandler(*slot.callMsg)) {
+                /* The reply handler has already been called so this call is accounted for */
+                ++issued;
+                continue;
+            }
+        }
+        if (status != ER_OK) {
+            ctxt->Complete();
+            ctxt->Release();
+        } else {
+            ++issued;
+        }
+    }
+
+    /*
+     * Drop the count held on behalf of the sender and wait if any replies are still outstanding.
+     */
+    if (!ctxt->Complete()) {
+        Thread* thisThread = Thread::GetThread();
+        QStatus waitStatus = ER_OK;
+        lock->Lock(MUTEX_CONTEXT);
+        if (!isExiting) {
+            components->waitingThreads.push_back(thisThread);
+            lock->Unlock(MUTEX_CONTEXT);
+            waitStatus = Event::Wait(ctxt->event, timeout);
+            lock->Lock(MUTEX_CONTEXT);
+
+            std::vector<Thread*>::iterator it = std::find(components->waitingThreads.begin(), components->waitingThreads.end(), thisThread);
+            if (it != components->waitingThreads.end()) {
+                components->waitingThreads.erase(it);
+            }
+        } else {
+            waitStatus = ER_BUS_STOPPING;
+        }
+        lock->Unlock(MUTEX_CONTEXT);
+
+        if ((waitStatus == ER_ALERTED_THREAD) && (SYNC_METHOD_ALERTCODE_ABORT == thisThread->GetAlertCode())) {
+            /*
+             * We can't touch anything in this case since the external thread that was waiting
+             * can't know whether this object still exists.
+             */
+            return ER_BUS_METHOD_CALL_ABORTED;
+        }
+        if (waitStatus != ER_OK) {
+            /*
+             * Withdraw any calls that have not been answered. If the handler was deregistered
+             * we are responsible for the reference the handler would have released.
+             */
+            for (size_t i = 0; i < issued; ++i) {
+                if (localEndpoint.UnregisterReplyHandler(*ctxt->slots[i].callMsg)) {
+                    ctxt->Release();
+                }
+            }
+            if (status == ER_OK) {
+                status = waitStatus;
+            }
+        }
+    }
+    return status;
+}
 
 QStatus ProxyBusObject::MethodCall(const InterfaceDescription::Member& method,
                                    const MsgArg* args,
@@ -713,6 +844,26 @@ QStatus ProxyBusObject::MethodCall(const InterfaceDescription::Member& method,
                                    Message& replyMsg,
                                    uint32_t timeout,
                                    uint8_t flags) const
+{
+    return MethodCall(method, args, numArgs, NULL, replyMsg, timeout, flags);
+}
+
+QStatus ProxyBusObject::MethodCall(const InterfaceDescription::Member& method,
+                                   const TypedBody& args,
+                                   Message& replyMsg,
+                                   uint32_t timeout,
+                                   uint8_t flags) const
+{
+    return MethodCall(method, NULL, 0, &args, replyMsg, timeout, flags);
+}
+
+QStatus ProxyBusObject::MethodCall(const InterfaceDescription::Member& method,
+                                   const MsgArg* args,
+                                   size_t numArgs,
+                                   const TypedBody* typedArgs,
+                                   Message& replyMsg,
+                                   uint32_t timeout,
+                                   uint8_t flags) const
 {
     QStatus status;
     Message msg(*bus);
@@ -742,7 +893,11 @@ QStatus ProxyBusObject::MethodCall(const InterfaceDescription::Member& method,
         status = ER_BUS_SECURITY_NOT_ENABLED;
         goto MethodCallExit;
     }
-    status = msg->CallMsg(method.signature, serviceName, sessionId, path, method.iface->GetName(), method.name, args, numArgs, flags);
+    if (typedArgs) {
+        status = msg->CallMsg(method.signature, serviceName, sessionId, path, method.iface->GetName(), method.name, *typedArgs, flags);
+    } else {
+        status = msg->CallMsg(method.signature, serviceName, sessionId, path, method.iface->GetName(), method.name, args, numArgs, flags);
+    }
     if (status != ER_OK) {
         goto MethodCallExit;
     }
@@ -756,59 +911,13 @@ QStatus ProxyBusObject::MethodCall(const InterfaceDescription::Member& method,
             status = bus->GetInternal().GetRouter().PushMessage(msg, localEndpoint);
         }
     } else {
-        ManagedObj<SyncReplyContext> ctxt(*bus);
-        /*
-         * Synchronous calls are really asynchronous calls that block waiting for a builtin
-         * reply handler to be called.
-         */
-        ManagedObj<SyncReplyContext>* heapCtx = new ManagedObj<SyncReplyContext>(ctxt);
-        status = localEndpoint.RegisterReplyHandler(const_cast<MessageReceiver*>(static_cast<const MessageReceiver* const>(this)),
-                                                    static_cast<MessageReceiver::ReplyHandler>(&ProxyBusObject::SyncReplyHandler),
-                                                    method,
-                                                    msg,
-                                                    heapCtx,
-                                                    timeout);
-        if (status == ER_OK) {
-            if (b2bEp) {
-                status = b2bEp->PushMessage(msg);
-            } else {
-                status = bus->GetInternal().GetRouter().PushMessage(msg, localEndpoint);
-            }
-        } else {
-            delete heapCtx;
-            heapCtx = NULL;
-        }
-
-        Thread* thisThread = Thread::GetThread();
+        SyncReplyContext* ctxt = new SyncReplyContext(&msg, 1);
+        status = SyncMethodCalls(method, ctxt, timeout);
         if (status == ER_OK) {
-            lock->Lock(MUTEX_CONTEXT);
-            if (!isExiting) {
-                components->waitingThreads.push_back(thisThread);
-                lock->Unlock(MUTEX_CONTEXT);
-                status = Event::Wait(ctxt->event, timeout);
-                lock->Lock(MUTEX_CONTEXT);
-
-                std::vector<Thread*>::iterator it = std::find(components->waitingThreads.begin(), components->waitingThreads.end(), thisThread);
-                if (it != components->waitingThreads.end()) {
-                    components->waitingThreads.erase(it);
-                }
-            }
-            lock->Unlock(MUTEX_CONTEXT);
+            replyMsg = ctxt->slots[0].replyMsg;
         }
-
-        if (status == ER_OK) {
-            replyMsg = ctxt->replyMsg;
-        } else if ((status == ER_ALERTED_THREAD) && (SYNC_METHOD_ALERTCODE_ABORT == thisThread->GetAlertCode())) {
-            /*
-             * We can't touch anything in this case since the external thread that was waiting
-             * can't know whether this object still exists.
-             */
-            status = ER_BUS_METHOD_CALL_ABORTED;
-        } else if (localEndpoint.UnregisterReplyHandler(msg)) {
-            /*
-             * The handler was deregistered so we need to delete the context here.
-             */
-            delete heapCtx;
+        if (status != ER_BUS_METHOD_CALL_ABORTED) {
+            ctxt->Release();
         }
     }
 
@@ -826,6 +935,82 @@ MethodCallExit:
     return status;
 }
 
+QStatus ProxyBusObject::MethodCallBatch(const InterfaceDescription::Member& method,
+                                        const MsgArg* const* argsList,
+                                        const size_t* numArgsList,
+                                        size_t numCalls,
+                                        std::vector<Message>& replyMsgs,
+                                        uint32_t timeout,
+                                        uint8_t flags) const
+{
+    QStatus status = ER_OK;
+    LocalEndpoint& localEndpoint = bus->GetInternal().GetLocalEndpoint();
+    SyncReplyContext* ctxt = NULL;
+    std::vector<Message> callMsgs;
+
+    replyMsgs.clear();
+    for (size_t i = 0; i < numCalls; ++i) {
+        replyMsgs.push_back(Message(*bus));
+    }
+    if (numCalls == 0) {
+        return ER_OK;
+    }
+    if (localEndpoint.GetDispatcher().ThreadHoldsLock()) {
+        status = ER_BUS_BLOCKING_CALL_NOT_ALLOWED;
+    } else if (flags & ALLJOYN_FLAG_NO_REPLY_EXPECTED) {
+        status = ER_BAD_ARG_7;
+    } else if (!ImplementsInterface(method.iface->GetName())) {
+        status = ER_BUS_OBJECT_NO_SUCH_INTERFACE;
+        QCC_LogError(status, ("Object %s does not implement %s", path.c_str(), method.iface->GetName()));
+    } else {
+        if (method.iface->IsSecure()) {
+            flags |= ALLJOYN_FLAG_ENCRYPTED;
+        }
+        if ((flags & ALLJOYN_FLAG_ENCRYPTED) && !bus->IsPeerSecurityEnabled()) {
+            status = ER_BUS_SECURITY_NOT_ENABLED;
+        }
+    }
+    if (status == ER_OK) {
+        for (size_t i = 0; (status == ER_OK) && (i < numCalls); ++i) {
+            callMsgs.push_back(Message(*bus));
+            status = callMsgs[i]->CallMsg(method.signature, serviceName, sessionId, path, method.iface->GetName(), method.name,
+                                          argsList ? argsList[i] : NULL, numArgsList ? numArgsList[i] : 0, flags);
+        }
+        if (status == ER_OK) {
+            ctxt = new SyncReplyContext(&callMsgs[0], numCalls);
+            status = SyncMethodCalls(method, ctxt, timeout);
+            if (status == ER_BUS_METHOD_CALL_ABORTED) {
+                /*
+                 * The thread that aborted the call can't know whether this object, the
+                 * context or the caller's replies still exist so we can't touch any of them.
+                 */
+                return status;
+            }
+        }
+    }
+    /*
+     * Collect the replies that arrived, calls that did not complete get an error reply.
+     */
+    QStatus callStatus = status;
+    for (size_t i = 0; i < numCalls; ++i) {
+        if (ctxt && ctxt->slots[i].done) {
+            replyMsgs[i] = ctxt->slots[i].replyMsg;
+            if ((status == ER_OK) && (replyMsgs[i]->GetType() == MESSAGE_ERROR)) {
+                status = ER_BUS_REPLY_IS_ERROR_MESSAGE;
+            }
+        } else {
+            replyMsgs[i]->ErrorMsg((callStatus == ER_OK) ? ER_FAIL : callStatus, 0);
+            if (status == ER_OK) {
+                status = ER_BUS_REPLY_IS_ERROR_MESSAGE;
+            }
+        }
+    }
+    if (ctxt) {
+        ctxt->Release();
+    }
+    return status;
+}
+
 QStatus ProxyBusObject::MethodCall(const char* ifaceName,
                                    const char* methodName,
                                    const MsgArg* args,
@@ -850,17 +1035,21 @@ QStatus ProxyBusObject::MethodCall(const char* ifaceName,
 
 void ProxyBusObject::SyncReplyHandler(Message& msg, void* context)
 {
-    ManagedObj<SyncReplyContext>* ctx = reinterpret_cast<ManagedObj<SyncReplyContext>*> (context);
+    SyncReplyContext::Slot* slot = reinterpret_cast<SyncReplyContext::Slot*>(context);
+    SyncReplyContext* ctx = slot->ctx;
 
     /* Set the reply message */
-    (*ctx)->replyMsg = msg;
-
-    /* Wake up sync method_call thread */
-    QStatus status = (*ctx)->event.SetEvent();
-    if (ER_OK != status) {
-        QCC_LogError(status, ("SetEvent failed"));
+    slot->replyMsg = msg;
+    IncrementAndFetch(&slot->done);
+
+    /* Wake up sync method_call thread when the last reply arrives */
+    if (ctx->Complete()) {
+        QStatus status = ctx->event.SetEvent();
+        if (ER_OK != status) {
+            QCC_LogError(status, ("SetEvent failed"));
+        }
     }
-    delete ctx;
+    ctx->Release();
 }
 
 QStatus ProxyBusObject::SecureConnection(bool forceAuth)
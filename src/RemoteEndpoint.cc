@@ -20,6 +20,7 @@
 #include <qcc/platform.h>
 
 #include <assert.h>
+#include <string.h>
 
 #include <qcc/Debug.h>
 #include <qcc/String.h>
@@ -38,9 +39,7 @@
 #include "AllJoynPeerObj.h"
 #include "BusInternal.h"
 
-#ifndef NDEBUG
 #include <qcc/time.h>
-#endif
 
 #define QCC_MODULE "ALLJOYN"
 
@@ -71,6 +70,10 @@ RemoteEndpoint::RemoteEndpoint(BusAttachment& bus,
     rxThread(bus, (qcc::String(incoming ? "rx-srv-" : "rx-cli-") + threadName + "-" + U32ToString(threadCount)).c_str(), incoming),
     txThread(bus, (qcc::String(incoming ? "tx-srv-" : "tx-cli-") + threadName + "-" + U32ToString(threadCount)).c_str(), txQueue, txWaitQueue, txQueueLock),
     connSpec(connectSpec),
+    transportName(threadName),
+    rxTraceCountdown(0),
+    rxTraceRing(NULL),
+    txTraceRing(NULL),
     incoming(incoming),
     processId(-1),
     alljoynVersion(0),
@@ -81,7 +84,8 @@ RemoteEndpoint::RemoteEndpoint(BusAttachment& bus,
     maxIdleProbes(0),
     idleTimeout(0),
     probeTimeout(0),
-    started(false)
+    started(false),
+    lastGeneration(0)
 {
     ++threadCount;
 }
@@ -313,6 +317,13 @@ void* RemoteEndpoint::RxThread::Run(void* arg)
             switch (status) {
             case ER_OK :
                 ep->idleTimeoutCount = 0;
+#ifndef NDEBUG
+                ep->rxStatsLock.Lock(MUTEX_CONTEXT);
+                ep->stats.rxMsgs++;
+                ep->stats.rxBytes += WireSize(msg);
+                ep->rxStatsLock.Unlock(MUTEX_CONTEXT);
+#endif
+                MessageTrace::Sample(msg, ep->rxTraceCountdown, ep->rxTraceRing, *this);
                 bool isAck;
                 if (ep->IsProbeMsg(msg, isAck)) {
                     QCC_DbgPrintf(("%s: Received %s\n", ep->GetUniqueName().c_str(), isAck ? "ProbeAck" : "ProbeReq"));
@@ -418,6 +429,9 @@ void* RemoteEndpoint::RxThread::Run(void* arg)
         ep->disconnectStatus = (status == ER_STOPPING_THREAD) ? ER_OK : status;
     }
 
+    /* Hand the trace ring to another thread, the events in it can still be collected */
+    MessageTrace::ReleaseRing(ep->rxTraceRing);
+
     /* Inform transport of endpoint exit */
     return (void*) status;
 }
@@ -440,6 +454,7 @@ void* RemoteEndpoint::TxThread::Run(void* arg)
 
                 /* Get next message */
                 Message msg = queue.back();
+                MessageTrace::Trace(msg, MessageTrace::TX_DEQUEUED, ep->txTraceRing, *this);
 
                 /* Alert next thread on wait queue */
                 if (0 < waitQueue.size()) {
@@ -454,6 +469,10 @@ void* RemoteEndpoint::TxThread::Run(void* arg)
 
                 /* Deliver message */
                 status = msg->Deliver(*ep);
+                bool delivered = (status == ER_OK);
+                if (delivered) {
+                    MessageTrace::Trace(msg, MessageTrace::DELIVERED, ep->txTraceRing, *this);
+                }
                 /* Report authorization failure as a security violation */
                 if (status == ER_BUS_NOT_AUTHORIZED) {
                     bus.GetInternal().GetLocalEndpoint().GetPeerObj()->HandleSecurityViolation(msg, status);
@@ -465,6 +484,13 @@ void* RemoteEndpoint::TxThread::Run(void* arg)
                 }
                 queueLock.Lock(MUTEX_CONTEXT);
                 queue.pop_back();
+#ifndef NDEBUG
+                /* Updated under the queue lock so GetStats() never sees half of a 64 bit counter */
+                if (delivered) {
+                    ep->stats.txMsgs++;
+                    ep->stats.txBytes += WireSize(msg);
+                }
+#endif
             }
             queueLock.Unlock(MUTEX_CONTEXT);
         }
@@ -486,6 +512,9 @@ void* RemoteEndpoint::TxThread::Run(void* arg)
         ep->disconnectStatus = (status == ER_STOPPING_THREAD) ? ER_OK : status;
     }
 
+    /* Hand the trace ring to another thread, the events in it can still be collected */
+    MessageTrace::ReleaseRing(ep->txTraceRing);
+
     /* Inform transport of endpoint exit */
     return (void*) status;
 }
@@ -513,6 +542,10 @@ QStatus RemoteEndpoint::PushMessage(Message& msg)
     if (MAX_TX_QUEUE_SIZE > count) {
         txQueue.push_front(msg);
     } else {
+#ifndef NDEBUG
+        uint32_t blockStart = GetTimestamp();
+        stats.txBlocked++;
+#endif
         while (true) {
             /* Remove a queue entry whose TTLs is expired if possible */
             deque<Message>::iterator it = txQueue.begin();
@@ -521,6 +554,9 @@ QStatus RemoteEndpoint::PushMessage(Message& msg)
                 uint32_t expMs;
                 if ((*it)->IsExpired(&expMs)) {
                     txQueue.erase(it);
+#ifndef NDEBUG
+                    stats.drops++;
+#endif
                     break;
                 } else {
                     ++it;
@@ -561,11 +597,26 @@ QStatus RemoteEndpoint::PushMessage(Message& msg)
                 }
 
                 if ((ER_OK != status) && (ER_ALERTED_THREAD != status) && (ER_TIMEOUT != status)) {
+#ifndef NDEBUG
+                    stats.drops++;
+#endif
                     break;
                 }
 
             }
         }
+#ifndef NDEBUG
+        stats.txBlockedMs += GetTimestamp() - blockStart;
+#endif
+    }
+#ifndef NDEBUG
+    if (txQueue.size() > stats.txQueueMax) {
+        stats.txQueueMax = txQueue.size();
+    }
+#endif
+    /* Recorded before the tx thread can take the message off the queue */
+    if (status == ER_OK) {
+        MessageTrace::Trace(msg, MessageTrace::TX_QUEUED);
     }
     txQueueLock.Unlock(MUTEX_CONTEXT);
 
@@ -590,6 +641,57 @@ QStatus RemoteEndpoint::PushMessage(Message& msg)
     return status;
 }
 
+#ifndef NDEBUG
+void RemoteEndpoint::Stats::Add(const Stats& other)
+{
+    rxMsgs += other.rxMsgs;
+    rxBytes += other.rxBytes;
+    txMsgs += other.txMsgs;
+    txBytes += other.txBytes;
+    txQueueDepth += other.txQueueDepth;
+    txQueueMax = (std::max)(txQueueMax, other.txQueueMax);
+    txBlocked += other.txBlocked;
+    txBlockedMs += other.txBlockedMs;
+    drops += other.drops;
+}
+
+void RemoteEndpoint::GetStats(Stats& snapshot)
+{
+    txQueueLock.Lock(MUTEX_CONTEXT);
+    snapshot = stats;
+    snapshot.txQueueDepth = txQueue.size();
+    txQueueLock.Unlock(MUTEX_CONTEXT);
+    rxStatsLock.Lock(MUTEX_CONTEXT);
+    snapshot.rxMsgs = stats.rxMsgs;
+    snapshot.rxBytes = stats.rxBytes;
+    rxStatsLock.Unlock(MUTEX_CONTEXT);
+}
+
+size_t RemoteEndpoint::WireSize(const Message& msg)
+{
+    if (msg->_hdrBuf) {
+        return msg->hdrBufLen + (msg->bufEOD - msg->bodyPtr);
+    } else {
+        return msg->bufEOD - reinterpret_cast<const uint8_t*>(msg->msgBuf);
+    }
+}
+#endif
+
+PeerState RemoteEndpoint::GetPeerState(const char* sender)
+{
+    PeerStateTable* peerStateTable = bus.GetInternal().GetPeerStateTable();
+    /*
+     * Read the generation before the lookup so a change made during the lookup is seen next time.
+     */
+    uint32_t generation = peerStateTable->GetGeneration();
+    if ((generation != lastGeneration) || (lastSender != sender)) {
+        lastPeerState = peerStateTable->GetSenderState(sender);
+        lastSender = sender;
+        lastGeneration = generation;
+    }
+    return lastPeerState;
+}
+
 void RemoteEndpoint::IncrementRef()
 {
     int refs = IncrementAndFetch(&refCount);
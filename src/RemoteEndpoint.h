@@ -34,6 +34,8 @@
 
 #include "BusEndpoint.h"
 #include "EndpointAuth.h"
+#include "MessageTrace.h"
+#include "PeerState.h"
 
 #include <Status.h>
 
@@ -195,6 +197,21 @@ class RemoteEndpoint : public BusEndpoint, public qcc::ThreadListener {
      */
     const qcc::String& GetRemoteName() const { return auth.GetRemoteName(); }
 
+    /**
+     * Get the peer state for the sender of a message received on this endpoint.  The endpoint
+     * keeps the peer state of the most recent sender so the peer state table is only consulted
+     * when the sender or the table changes.  The peer state comes from
+     * PeerStateTable::GetSenderState() so it is shared with every other endpoint the sender's
+     * messages arrive on.
+     *
+     * Only called from the receive side of the endpoint, which is single threaded.
+     *
+     * @param sender   Unique name of the sender.
+     *
+     * @return  The peer state for the sender.
+     */
+    PeerState GetPeerState(const char* sender);
+
     /**
      * Get the protocol version used by the remote end of this endpoint.
      *
@@ -242,6 +259,46 @@ class RemoteEndpoint : public BusEndpoint, public qcc::ThreadListener {
      */
     const qcc::String& GetConnectSpec() const { return connSpec; }
 
+    /**
+     * Get the name of the transport this endpoint belongs to.
+     *
+     * @return The transport name given to the constructor (e.g. "tcp").
+     */
+    const qcc::String& GetTransportName() const { return transportName; }
+
+#ifndef NDEBUG
+    /**
+     * Traffic counters for an endpoint.  Like the debug object that reports them they only exist
+     * in debug builds.
+     */
+    struct Stats {
+        uint64_t rxMsgs;          /**< Messages received */
+        uint64_t rxBytes;         /**< Bytes received */
+        uint64_t txMsgs;          /**< Messages delivered */
+        uint64_t txBytes;         /**< Bytes delivered */
+        uint32_t txQueueDepth;    /**< Messages currently in the transmit queue */
+        uint32_t txQueueMax;      /**< Largest number of messages seen in the transmit queue */
+        uint32_t txBlocked;       /**< Number of times a sender waited for room in the transmit queue */
+        uint64_t txBlockedMs;     /**< Total time senders spent waiting for room in the transmit queue */
+        uint32_t drops;           /**< Messages discarded because their TTL expired in a full queue or a sender gave up waiting */
+
+        Stats() : rxMsgs(0), rxBytes(0), txMsgs(0), txBytes(0), txQueueDepth(0), txQueueMax(0), txBlocked(0), txBlockedMs(0), drops(0) { }
+
+        /**
+         * Add the counters of another endpoint to these counters.
+         */
+        void Add(const Stats& other);
+    };
+
+    /**
+     * Get a snapshot of the traffic counters for this endpoint.  The counters are read under the
+     * locks they are written under so a 64 bit counter is never seen half updated.
+     *
+     * @param[out] stats  The counters.
+     */
+    void GetStats(Stats& stats);
+#endif
+
     /**
      * Return the user id of the endpoint.
      *
@@ -426,6 +483,15 @@ class RemoteEndpoint : public BusEndpoint, public qcc::ThreadListener {
      */
     void ThreadExit(qcc::Thread* thread);
 
+#ifndef NDEBUG
+    /**
+     * Number of bytes a message occupies on the wire.
+     *
+     * @param msg   A marshaled or unmarshaled message.
+     */
+    static size_t WireSize(const Message& msg);
+#endif
+
     BusAttachment& bus;                      /**< Message bus associated with this endpoint */
     qcc::Stream* stream;                     /**< Stream for this endpoint or NULL if uninitialized */
     EndpointAuth auth;                       /**< Endpoint AllJoynAuthentication */
@@ -441,6 +507,14 @@ class RemoteEndpoint : public BusEndpoint, public qcc::ThreadListener {
     EndpointListener* listener;              /**< Listener for thread exit notifications */
 
     qcc::String connSpec;                    /**< Connection specification for out-going connections */
+    qcc::String transportName;               /**< Name of the transport that created this endpoint */
+#ifndef NDEBUG
+    Stats stats;                             /**< Traffic counters, see GetStats() */
+    qcc::Mutex rxStatsLock;                  /**< Lock that protects the receive counters, the transmit counters are protected by txQueueLock */
+#endif
+    uint32_t rxTraceCountdown;               /**< Messages received since one was sampled for tracing */
+    MessageTrace::Ring* rxTraceRing;         /**< Trace ring of the rx thread */
+    MessageTrace::Ring* txTraceRing;         /**< Trace ring of the tx thread */
     bool incoming;                           /**< Indicates if connection is incoming (true) or outgoing (false) */
 
     Features features;                       /**< Requested and negotiated features of this endpoint */
@@ -455,6 +529,10 @@ class RemoteEndpoint : public BusEndpoint, public qcc::ThreadListener {
     uint32_t idleTimeout;                    /**< RX idle seconds before sending probe */
     uint32_t probeTimeout;                   /**< Probe timeout in seconds */
     bool started;                            /**< Is this EP started? */
+
+    qcc::String lastSender;                  /**< The most recent sender, usually the only one */
+    PeerState lastPeerState;                 /**< Peer state of lastSender */
+    uint32_t lastGeneration;                 /**< Peer state table generation lastPeerState was checked against */
 };
 
 }
@@ -0,0 +1,303 @@
+/**
+ * @file
+ *
+ * This file compares the performance of MsgArg based marshaling with compile-time typed
+ * marshaling (TypedArgs).
+ */
+
+/******************************************************************************
+ * Copyright 2012, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#include <qcc/platform.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include <qcc/Debug.h>
+#include <qcc/Pipe.h>
+#include <qcc/String.h>
+#include <qcc/StringUtil.h>
+#include <qcc/Util.h>
+#include <qcc/time.h>
+
+#include <alljoyn/BusAttachment.h>
+#include <alljoyn/Message.h>
+#include <alljoyn/TypedArgs.h>
+#include <alljoyn/version.h>
+
+#include <Status.h>
+
+/* Private files included for unit testing */
+#include <RemoteEndpoint.h>
+
+#define QCC_MODULE "ALLJOYN"
+
+using namespace qcc;
+using namespace std;
+using namespace ajn;
+
+struct Sample {
+    int32_t x;
+    int32_t y;
+    qcc::String label;
+};
+
+namespace ajn {
+template <> struct TypedStruct<Sample> {
+    template <typename V> static void Members(V& v, Sample& s) { v(s.x); v(s.y); v(s.label); }
+};
+}
+
+static BusAttachment* gBus;
+
+class MyMessage : public _Message {
+  public:
+
+    MyMessage() : _Message(*gBus) { };
+
+    QStatus MethodCall(const MsgArg* argList, size_t numArgs)
+    {
+        qcc::String sig = MsgArg::Signature(argList, numArgs);
+        return CallMsg(sig, "desti.nation", 0, "/foo/bar", "foo.bar", "test", argList, numArgs, 0);
+    }
+
+    QStatus MethodCall(const TypedBody& body)
+    {
+        return CallMsg(body.GetSignature(), "desti.nation", 0, "/foo/bar", "foo.bar", "test", body, 0);
+    }
+
+    QStatus UnmarshalBody() { return UnmarshalArgs("*"); }
+
+    template <typename A, typename B>
+    QStatus UnpackBody(A& a, B& b)
+    {
+        if (TypedSignature<A, B>::Get() != GetSignature()) {
+            return ER_BUS_SIGNATURE_MISMATCH;
+        }
+        TypedReader reader;
+        QStatus status = GetBodyReader(reader);
+        if (status == ER_OK) {
+            TypedArg<A>::Unmarshal(reader, a) && TypedArg<B>::Unmarshal(reader, b);
+            status = TypedUnpackEnd(reader);
+        }
+        return status;
+    }
+
+    QStatus Unmarshal(RemoteEndpoint& ep) { return _Message::Unmarshal(ep, true); }
+
+    QStatus Deliver(RemoteEndpoint& ep) { return _Message::Deliver(ep); }
+};
+
+static void usage(void)
+{
+    printf("Usage: typedmarshal [-n <iterations>] [-s <elements>]\n\n");
+    printf("Options:\n");
+    printf("   -h              = Print this help message\n");
+    printf("   -n <iterations> = Number of messages to marshal and unmarshal (default 10000)\n");
+    printf("   -s <elements>   = Number of array elements per message (default 16)\n");
+}
+
+static void Report(const char* what, uint32_t iterations, uint32_t startTime)
+{
+    uint32_t elapsed = GetTimestamp() - startTime;
+    printf("%-28s %8u msgs in %6u ms", what, iterations, elapsed);
+    if (elapsed) {
+        printf(" (%u msgs/sec)", static_cast<uint32_t>((static_cast<uint64_t>(iterations) * 1000) / elapsed));
+    }
+    printf("\n");
+}
+
+static QStatus MarshalMsgArg(const vector<Sample>& samples, uint32_t iterations, Pipe* stream)
+{
+    QStatus status = ER_OK;
+    RemoteEndpoint ep(*gBus, false, "", stream, "dummy", false);
+    uint32_t startTime = GetTimestamp();
+
+    for (uint32_t i = 0; (status == ER_OK) && (i < iterations); ++i) {
+        MyMessage msg;
+        MsgArg* elems = new MsgArg[samples.size()];
+        for (size_t j = 0; j < samples.size(); ++j) {
+            elems[j].Set("(iis)", samples[j].x, samples[j].y, samples[j].label.c_str());
+        }
+        MsgArg args[2];
+        args[0].Set("u", i);
+        args[1].Set("a(iis)", samples.size(), elems);
+        status = msg.MethodCall(args, ArraySize(args));
+        if ((status == ER_OK) && stream) {
+            status = msg.Deliver(ep);
+        }
+        delete [] elems;
+    }
+    if (!stream) {
+        Report("MsgArg marshal:", iterations, startTime);
+    }
+    return status;
+}
+
+static QStatus MarshalTyped(const vector<Sample>& samples, uint32_t iterations, Pipe* stream)
+{
+    QStatus status = ER_OK;
+    RemoteEndpoint ep(*gBus, false, "", stream, "dummy", false);
+    uint32_t startTime = GetTimestamp();
+
+    for (uint32_t i = 0; (status == ER_OK) && (i < iterations); ++i) {
+        MyMessage msg;
+        status = msg.MethodCall(TypedArgs<uint32_t, vector<Sample> >(i, samples));
+        if ((status == ER_OK) && stream) {
+            status = msg.Deliver(ep);
+        }
+    }
+    if (!stream) {
+        Report("TypedArgs marshal:", iterations, startTime);
+    }
+    return status;
+}
+
+static QStatus UnmarshalMsgArg(size_t numSamples, uint32_t iterations, Pipe& stream)
+{
+    QStatus status = ER_OK;
+    RemoteEndpoint ep(*gBus, false, "", &stream, "dummy", false);
+    uint32_t startTime = GetTimestamp();
+
+    for (uint32_t i = 0; (status == ER_OK) && (i < iterations); ++i) {
+        MyMessage msg;
+        status = msg.Unmarshal(ep);
+        if (status == ER_OK) {
+            status = msg.UnmarshalBody();
+        }
+        if (status == ER_OK) {
+            size_t numArgs;
+            const MsgArg* args;
+            uint32_t seq;
+            size_t numElems;
+            MsgArg* elems;
+            msg.GetArgs(numArgs, args);
+            status = MsgArg::Get(args, numArgs, "ua(iis)", &seq, &numElems, &elems);
+            for (size_t j = 0; (status == ER_OK) && (j < numElems); ++j) {
+                Sample s;
+                char* label;
+                status = elems[j].Get("(iis)", &s.x, &s.y, &label);
+                s.label = label;
+            }
+            if ((status == ER_OK) && ((seq != i) || (numElems != numSamples))) {
+                status = ER_FAIL;
+            }
+        }
+    }
+    Report("MsgArg unmarshal:", iterations, startTime);
+    return status;
+}
+
+static QStatus UnmarshalTyped(size_t numSamples, uint32_t iterations, Pipe& stream)
+{
+    QStatus status = ER_OK;
+    RemoteEndpoint ep(*gBus, false, "", &stream, "dummy", false);
+    uint32_t startTime = GetTimestamp();
+
+    for (uint32_t i = 0; (status == ER_OK) && (i < iterations); ++i) {
+        MyMessage msg;
+        status = msg.Unmarshal(ep);
+        if (status == ER_OK) {
+            /* Same as TypedUnpack() but without wrapping the message in a managed object */
+            uint32_t seq;
+            vector<Sample> samples;
+            status = msg.UnpackBody(seq, samples);
+            if ((status == ER_OK) && ((seq != i) || (samples.size() != numSamples))) {
+                status = ER_FAIL;
+            }
+        }
+    }
+    Report("TypedArgs unmarshal:", iterations, startTime);
+    return status;
+}
+
+int main(int argc, char** argv)
+{
+    QStatus status = ER_OK;
+    uint32_t iterations = 10000;
+    size_t numSamples = 16;
+
+    printf("AllJoyn Library version: %s\n", ajn::GetVersion());
+    printf("AllJoyn Library build info: %s\n", ajn::GetBuildInfo());
+
+    /* Parse command line args */
+    for (int i = 1; i < argc; ++i) {
+        if (0 == strcmp("-n", argv[i])) {
+            ++i;
+            if (i == argc) {
+                printf("option %s requires a parameter\n", argv[i - 1]);
+                usage();
+                exit(1);
+            }
+            iterations = StringToU32(argv[i], 10, iterations);
+        } else if (0 == strcmp("-s", argv[i])) {
+            ++i;
+            if (i == argc) {
+                printf("option %s requires a parameter\n", argv[i - 1]);
+                usage();
+                exit(1);
+            }
+            numSamples = StringToU32(argv[i], 10, numSamples);
+        } else if (0 == strcmp("-h", argv[i])) {
+            usage();
+            exit(0);
+        } else {
+            usage();
+            exit(1);
+        }
+    }
+
+    gBus = new BusAttachment("typedmarshal");
+    gBus->Start();
+
+    vector<Sample> samples(numSamples);
+    for (size_t j = 0; j < numSamples; ++j) {
+        samples[j].x = static_cast<int32_t>(j);
+        samples[j].y = -static_cast<int32_t>(j);
+        samples[j].label = "sample-" + U32ToString(static_cast<uint32_t>(j));
+    }
+
+    /* Marshal only */
+    status = MarshalMsgArg(samples, iterations, NULL);
+    if (status == ER_OK) {
+        status = MarshalTyped(samples, iterations, NULL);
+    }
+    /* Unmarshal messages previously delivered into a pipe */
+    if (status == ER_OK) {
+        Pipe stream;
+        status = MarshalMsgArg(samples, iterations, &stream);
+        if (status == ER_OK) {
+            status = UnmarshalMsgArg(numSamples, iterations, stream);
+        }
+    }
+    if (status == ER_OK) {
+        Pipe stream;
+        status = MarshalTyped(samples, iterations, &stream);
+        if (status == ER_OK) {
+            status = UnmarshalTyped(numSamples, iterations, stream);
+        }
+    }
+
+    delete gBus;
+
+    if (status == ER_OK) {
+        printf("\nPASSED\n");
+    } else {
+        printf("\nFAILED %s\n", QCC_StatusText(status));
+    }
+    return (int) status;
+}
@@ -31,6 +31,7 @@
 #include <qcc/KeyBlob.h>
 #include <qcc/Pipe.h>
 #include <qcc/StringUtil.h>
+#include <qcc/Thread.h>
 #include <qcc/Util.h>
 #include <qcc/GUID.h>
 #include <qcc/time.h>
@@ -229,3 +230,83 @@ TEST(KeyStoreTest, keystore_store_load_merge) {
     DeleteFile("keystore_test");
 }
 
+
+static qcc::String ReadKeyStoreFile(const qcc::String& fileName)
+{
+    qcc::String contents;
+    FileSource source(fileName);
+    uint8_t buf[1024];
+    size_t pulled;
+    while (source.IsValid() && (source.PullBytes(buf, sizeof(buf), pulled) == ER_OK)) {
+        contents.append(reinterpret_cast<const char*>(buf), pulled);
+    }
+    return contents;
+}
+
+TEST(KeyStoreTest, keystore_journal) {
+    const qcc::String fileName = GetHomeDir() + "/.alljoyn_keystore/keystore_test";
+    const size_t numKeys = 100;
+    qcc::GUID128 guids[numKeys];
+    qcc::GUID128 expiring;
+    QStatus status = ER_OK;
+    KeyBlob key;
+
+    /*
+     * Each store appends a journal record
+     */
+    {
+        KeyStore keyStore("keystore_test");
+        keyStore.Init(NULL, false);
+        keyStore.Clear();
+
+        /* Clearing the key store rewrites the key store file in full */
+        qcc::String compacted = ReadKeyStoreFile(fileName);
+        ASSERT_FALSE(compacted.empty());
+
+        for (size_t i = 0; i < numKeys; ++i) {
+            key.Rand(Crypto_AES::AES128_SIZE, KeyBlob::AES);
+            keyStore.AddKey(guids[i], key);
+            status = keyStore.Store();
+            ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status) << " Failed to store keystore";
+        }
+        /* Delete a key */
+        status = keyStore.DelKey(guids[0]);
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status) << " Failed to delete key";
+
+        /* The changes only went to the journal, the key store file was not rewritten */
+        ASSERT_TRUE(ReadKeyStoreFile(fileName) == compacted) << " Key store file was rewritten between compactions";
+        ASSERT_FALSE(ReadKeyStoreFile(fileName + ".journal").empty());
+
+        /* Add a key that expires */
+        key.Rand(Crypto_AES::AES128_SIZE, KeyBlob::AES);
+        key.SetExpiration(qcc::Timespec(1, qcc::TIME_RELATIVE));
+        keyStore.AddKey(expiring, key);
+        qcc::Sleep(10);
+        status = keyStore.Store();
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status) << " Failed to store keystore";
+
+        status = keyStore.GetKey(expiring, key);
+        ASSERT_EQ(ER_BUS_KEY_UNAVAILABLE, status) << "  Actual Status: " << QCC_StatusText(status) << " Expired key was not erased";
+    }
+
+    /*
+     * Loading replays the journal
+     */
+    {
+        KeyStore keyStore("keystore_test");
+        keyStore.Init(NULL, false);
+
+        status = keyStore.GetKey(guids[0], key);
+        ASSERT_EQ(ER_BUS_KEY_UNAVAILABLE, status) << "  Actual Status: " << QCC_StatusText(status) << " guids[0] was not deleted";
+
+        for (size_t i = 1; i < numKeys; ++i) {
+            status = keyStore.GetKey(guids[i], key);
+            ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status) << " Failed to load guids[" << i << "]";
+        }
+
+        status = keyStore.GetKey(expiring, key);
+        ASSERT_EQ(ER_BUS_KEY_UNAVAILABLE, status) << "  Actual Status: " << QCC_StatusText(status) << " Expired key was loaded";
+    }
+    DeleteFile(fileName);
+    DeleteFile(fileName + ".journal");
+}
@@ -123,6 +123,11 @@ class MyMessage : public _Message {
         return _Message::Unmarshal(ep, pedantic);
     }
 
+    QStatus UnmarshalKeepSender(RemoteEndpoint& ep)
+    {
+        return _Message::Unmarshal(ep, false);
+    }
+
     QStatus Deliver(RemoteEndpoint& ep)
     {
         return _Message::Deliver(ep);
@@ -287,6 +292,68 @@ TEST(MarshalTest, TestMsgUnpack) {
     delete bus;
 }
 
+TEST(MarshalTest, RewriteSender) {
+    QStatus status = ER_OK;
+
+    BusAttachment* bus = new BusAttachment("TestRewriteSender", false);
+    bus->Start();
+
+    TestPipe stream;
+    RemoteEndpoint ep(*bus, false, "", &stream, "dummy", false);
+
+    uint8_t data[20000];
+    for (size_t i = 0; i < sizeof(data); ++i) {
+        data[i] = (uint8_t)(i * 7);
+    }
+    MsgArg arg("ay", sizeof(data), data);
+
+    MyMessage msg(*bus);
+    status = msg.Signal(":1.99", "/foo/bar", "foo.bar", "test", &arg, 1);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    status = msg.Deliver(ep);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    status = msg.UnmarshalKeepSender(ep);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+
+    /*
+     * Rewrite the sender twice, the second time with a longer name, and forward the message
+     */
+    status = msg.RewriteSender(":1.2");
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    status = msg.RewriteSender(":88.88888888");
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    EXPECT_STREQ(":88.88888888", msg.GetSender());
+    status = msg.Deliver(ep);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+
+    MyMessage fwd(*bus);
+    status = fwd.UnmarshalKeepSender(ep);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    EXPECT_STREQ(":88.88888888", fwd.GetSender());
+    EXPECT_STREQ(":1.99", fwd.GetDestination());
+    status = fwd.UnmarshalBody();
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+
+    uint8_t* got;
+    size_t len;
+    status = fwd.GetArgs("ay", &len, &got);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    ASSERT_EQ(sizeof(data), len);
+    EXPECT_EQ(0, memcmp(data, got, len));
+
+    /*
+     * The rewritten message can still be unpacked where it is
+     */
+    status = msg.UnmarshalBody();
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    status = msg.GetArgs("ay", &len, &got);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    ASSERT_EQ(sizeof(data), len);
+    EXPECT_EQ(0, memcmp(data, got, len));
+
+    delete bus;
+}
+
 /*--------------------------FUZZING TEST CODE---------------------------------*/
 static bool fuzzing = false;
 static bool nobig = false;
@@ -1380,6 +1447,37 @@ TEST(MarshalTest, noFuzzing) {
     fuzzingBus->Join();
     fuzzingBus = NULL;
 }
+/*
+ * Messages are marshaled in a single pass into a buffer that starts small and is grown as needed so
+ * make sure array lengths are patched correctly when the buffer moves while marshaling an array.
+ */
+TEST(MarshalTest, GrowBuffer) {
+    fuzzingBus = new BusAttachment("TestMsgUnPack", false);
+    fuzzingBus->Start();
+    fuzzing = false;
+    quiet = true;
+
+    const size_t numElems = 200;
+    int32_t ints[16];
+    for (size_t i = 0; i < ArraySize(ints); ++i) {
+        ints[i] = static_cast<int32_t>(i * 1000);
+    }
+    MsgArg* elems = new MsgArg[numElems];
+    for (size_t i = 0; i < numElems; ++i) {
+        elems[i].Set("(sai)", "a string that takes up a reasonable amount of space", ArraySize(ints), ints);
+    }
+    MsgArg args[2];
+    args[0].Set("a(sai)", numElems, elems);
+    args[1].Set("s", "trailing argument after the array");
+    QStatus status = TestMarshal(args, ArraySize(args));
+    EXPECT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status) << errString.c_str();
+    delete [] elems;
+
+    fuzzingBus->Stop();
+    fuzzingBus->Join();
+    fuzzingBus = NULL;
+}
+
 TEST(MarshalTest, fuzzing) {
     printf("The Fuzzing tests are meant to run thousands of times.\n");
     printf("To run this test multiple times add commandline option:\n");
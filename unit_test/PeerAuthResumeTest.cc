@@ -0,0 +1,239 @@
+/**
+ * @file
+ *
+ * This file tests resumption of secure sessions between peers
+ */
+
+/******************************************************************************
+ * Copyright 2012, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#include <qcc/platform.h>
+
+#include <cstring>
+
+#include <qcc/atomic.h>
+#include <qcc/String.h>
+#include <qcc/Thread.h>
+#include <qcc/Util.h>
+
+#include <alljoyn/AuthListener.h>
+#include <alljoyn/BusAttachment.h>
+#include <alljoyn/BusObject.h>
+#include <alljoyn/DBusStd.h>
+#include <alljoyn/InterfaceDescription.h>
+#include <alljoyn/ProxyBusObject.h>
+
+#include <Status.h>
+
+#include <gtest/gtest.h>
+#include "ajTestCommon.h"
+
+using namespace qcc;
+using namespace ajn;
+
+/*constants*/
+static const char* SERVICE_NAME = "org.alljoyn.test.PeerAuthResumeTest";
+static const char* INTERFACE_NAME = "org.alljoyn.test.PeerAuthResumeTest";
+static const char* OBJECT_PATH = "/org/alljoyn/test/PeerAuthResumeTest";
+
+class PeerAuthResumeTest : public testing::Test {
+  public:
+    PeerAuthResumeTest() :
+        service("PeerAuthResumeTestService", false),
+        client("PeerAuthResumeTestClient", false),
+        serviceObj(service) { }
+
+    /* Counts the number of times credentials are requested, i.e. the number of SASL conversations */
+    class CountingAuthListener : public AuthListener {
+      public:
+        CountingAuthListener() : requests(0) { }
+        bool RequestCredentials(const char* authMechanism, const char* authPeer, uint16_t authCount, const char* userId, uint16_t credMask, Credentials& creds) {
+            IncrementAndFetch(&requests);
+            creds.SetPassword("123456");
+            return true;
+        }
+        volatile int32_t requests;
+    };
+
+    class EchoObject : public BusObject {
+      public:
+        EchoObject(BusAttachment& bus) : BusObject(bus, OBJECT_PATH) { }
+        QStatus Init() {
+            const InterfaceDescription* intf = bus.GetInterface(INTERFACE_NAME);
+            QStatus status = AddInterface(*intf);
+            if (status == ER_OK) {
+                status = AddMethodHandler(intf->GetMember("echo"), static_cast<MessageReceiver::MethodHandler>(&EchoObject::Echo));
+            }
+            return status;
+        }
+        void Echo(const InterfaceDescription::Member* member, Message& msg) {
+            MsgArg arg(*(msg->GetArg(0)));
+            MethodReply(msg, &arg, 1);
+        }
+    };
+
+    /* Calls the secure echo method on the service from a thread of its own */
+    class Caller : public Thread {
+      public:
+        Caller(BusAttachment& bus) : Thread("Caller"), bus(bus), status(ER_FAIL) { }
+        ThreadReturn STDCALL Run(void* arg) {
+            status = Echo(bus);
+            return 0;
+        }
+        BusAttachment& bus;
+        QStatus status;
+    };
+
+    static QStatus Echo(BusAttachment& bus) {
+        ProxyBusObject proxy(bus, SERVICE_NAME, OBJECT_PATH, 0);
+        proxy.AddInterface(*bus.GetInterface(INTERFACE_NAME));
+        Message reply(bus);
+        MsgArg arg("s", "resume");
+        QStatus status = proxy.MethodCall(INTERFACE_NAME, "echo", &arg, 1, reply);
+        if ((status == ER_OK) && (strcmp(reply->GetArg(0)->v_string.str, "resume") != 0)) {
+            status = ER_FAIL;
+        }
+        return status;
+    }
+
+    static QStatus CreateInterface(BusAttachment& bus) {
+        InterfaceDescription* intf = NULL;
+        QStatus status = bus.CreateInterface(INTERFACE_NAME, intf, true);
+        if (status == ER_OK) {
+            intf->AddMethod("echo", "s", "s", "inStr,outStr");
+            intf->Activate();
+        }
+        return status;
+    }
+
+    virtual void SetUp() {
+        ASSERT_EQ(ER_OK, CreateInterface(service));
+        ASSERT_EQ(ER_OK, serviceObj.Init());
+        ASSERT_EQ(ER_OK, service.RegisterBusObject(serviceObj));
+        ASSERT_EQ(ER_OK, service.Start());
+        ASSERT_EQ(ER_OK, service.Connect(getConnectArg().c_str()));
+        ASSERT_EQ(ER_OK, service.EnablePeerSecurity("ALLJOYN_SRP_KEYX", &serviceListener, "/.alljoyn_keystore/peer_auth_resume_service.ks"));
+        service.ClearKeyStore();
+        ASSERT_EQ(ER_OK, service.RequestName(SERVICE_NAME, DBUS_NAME_FLAG_REPLACE_EXISTING | DBUS_NAME_FLAG_DO_NOT_QUEUE));
+
+        ASSERT_EQ(ER_OK, CreateInterface(client));
+        ASSERT_EQ(ER_OK, client.Start());
+        ASSERT_EQ(ER_OK, client.Connect(getConnectArg().c_str()));
+        ASSERT_EQ(ER_OK, client.EnablePeerSecurity("ALLJOYN_SRP_KEYX", &clientListener, "/.alljoyn_keystore/peer_auth_resume_client.ks"));
+        client.ClearKeyStore();
+    }
+
+    virtual void TearDown() {
+        client.ClearKeyStore();
+        client.Disconnect(getConnectArg().c_str());
+        client.Stop();
+        client.Join();
+        service.ClearKeyStore();
+        service.Disconnect(getConnectArg().c_str());
+        service.Stop();
+        service.Join();
+    }
+
+    /*
+     * Reconnecting the client discards the secure session with the service but keeps the master
+     * secret and the resumption ticket for the service name.
+     */
+    void ReconnectClient() {
+        ASSERT_EQ(ER_OK, client.Disconnect(getConnectArg().c_str()));
+        ASSERT_EQ(ER_OK, client.Stop());
+        ASSERT_EQ(ER_OK, client.Join());
+        ASSERT_EQ(ER_OK, client.Start());
+        ASSERT_EQ(ER_OK, client.Connect(getConnectArg().c_str()));
+    }
+
+    BusAttachment service;
+    BusAttachment client;
+    EchoObject serviceObj;
+    CountingAuthListener serviceListener;
+    CountingAuthListener clientListener;
+};
+
+TEST_F(PeerAuthResumeTest, resume_without_authentication) {
+    QStatus status = Echo(client);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    EXPECT_EQ(1, clientListener.requests);
+    EXPECT_EQ(1, serviceListener.requests);
+
+    ReconnectClient();
+
+    /* The session is resumed from the master secret so neither side asks for credentials again */
+    status = Echo(client);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    EXPECT_EQ(1, clientListener.requests);
+    EXPECT_EQ(1, serviceListener.requests);
+
+    /* The resumed session keys must agree on both sides for further calls */
+    for (int i = 0; i < 10; ++i) {
+        status = Echo(client);
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    }
+}
+
+TEST_F(PeerAuthResumeTest, fallback_to_exchange_guids) {
+    QStatus status = Echo(client);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+
+    /* The service forgets the master secret so it cannot resume and the peers authenticate again */
+    service.ClearKeyStore();
+    ReconnectClient();
+
+    status = Echo(client);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    EXPECT_EQ(2, clientListener.requests);
+    EXPECT_EQ(2, serviceListener.requests);
+
+    status = Echo(client);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+}
+
+TEST_F(PeerAuthResumeTest, concurrent_authentication) {
+    /* Two threads securing the same peer must share one authentication */
+    Caller first(client);
+    Caller second(client);
+    first.Start();
+    second.Start();
+    first.Join();
+    second.Join();
+    EXPECT_EQ(ER_OK, first.status) << "  Actual Status: " << QCC_StatusText(first.status);
+    EXPECT_EQ(ER_OK, second.status) << "  Actual Status: " << QCC_StatusText(second.status);
+    EXPECT_EQ(1, clientListener.requests);
+    EXPECT_EQ(1, serviceListener.requests);
+
+    ReconnectClient();
+
+    /*
+     * One thread resumes the session while the other one waits for it. If both resumed the
+     * service would end up with a different session key than the client.
+     */
+    Caller third(client);
+    Caller fourth(client);
+    third.Start();
+    fourth.Start();
+    third.Join();
+    fourth.Join();
+    EXPECT_EQ(ER_OK, third.status) << "  Actual Status: " << QCC_StatusText(third.status);
+    EXPECT_EQ(ER_OK, fourth.status) << "  Actual Status: " << QCC_StatusText(fourth.status);
+    EXPECT_EQ(1, clientListener.requests);
+    EXPECT_EQ(1, serviceListener.requests);
+
+    QStatus status = Echo(client);
+    EXPECT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+}
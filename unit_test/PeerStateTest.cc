@@ -0,0 +1,170 @@
+/**
+ * @file
+ *
+ * This file tests the peer state table
+ */
+
+/******************************************************************************
+ * Copyright 2012, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#include <qcc/platform.h>
+
+#include <qcc/String.h>
+#include <qcc/StringUtil.h>
+
+#include <qcc/Pipe.h>
+
+#include <alljoyn/BusAttachment.h>
+
+#include <Status.h>
+
+/* Private files included for unit testing */
+#include <BusInternal.h>
+#include <PeerState.h>
+#include <RemoteEndpoint.h>
+
+#include <gtest/gtest.h>
+
+using namespace qcc;
+using namespace ajn;
+
+TEST(PeerStateTest, find_does_not_create) {
+    PeerStateTable table;
+    PeerState peerState;
+
+    EXPECT_FALSE(table.FindPeerState(":1.1", peerState));
+    EXPECT_FALSE(table.IsKnownPeer(":1.1"));
+
+    /* Asking whether two unknown names are aliases must not create them either */
+    EXPECT_FALSE(table.IsAlias(":1.1", "org.alljoyn.test"));
+    EXPECT_FALSE(table.IsKnownPeer(":1.1"));
+    EXPECT_FALSE(table.IsKnownPeer("org.alljoyn.test"));
+}
+
+TEST(PeerStateTest, get_creates_and_find_returns_same_state) {
+    PeerStateTable table;
+    uint32_t generation = table.GetGeneration();
+
+    PeerState created = table.GetPeerState(":1.1");
+    EXPECT_NE(generation, table.GetGeneration());
+    EXPECT_TRUE(table.IsKnownPeer(":1.1"));
+
+    PeerState found;
+    EXPECT_TRUE(table.FindPeerState(":1.1", found));
+    EXPECT_TRUE(found.iden(created));
+
+    /* Getting a known peer changes nothing */
+    generation = table.GetGeneration();
+    EXPECT_TRUE(table.GetPeerState(":1.1").iden(created));
+    EXPECT_EQ(generation, table.GetGeneration());
+}
+
+TEST(PeerStateTest, alias_and_delete) {
+    PeerStateTable table;
+
+    PeerState peerState = table.GetPeerState(":1.1", "org.alljoyn.test");
+    EXPECT_TRUE(table.IsAlias(":1.1", "org.alljoyn.test"));
+    EXPECT_TRUE(table.GetPeerState("org.alljoyn.test").iden(peerState));
+
+    /* Deleting a name tells cached holders to look again */
+    uint32_t generation = table.GetGeneration();
+    table.DelPeerState(":1.1");
+    EXPECT_NE(generation, table.GetGeneration());
+    EXPECT_FALSE(table.IsKnownPeer(":1.1"));
+    EXPECT_FALSE(table.IsAlias(":1.1", "org.alljoyn.test"));
+
+    /* Deleting an unknown name does not */
+    generation = table.GetGeneration();
+    table.DelPeerState(":1.1");
+    EXPECT_EQ(generation, table.GetGeneration());
+}
+
+TEST(PeerStateTest, many_peers) {
+    PeerStateTable table;
+
+    for (uint32_t i = 0; i < 1000; ++i) {
+        table.GetPeerState(":1." + U32ToString(i));
+    }
+    for (uint32_t i = 0; i < 1000; i += 2) {
+        table.DelPeerState(":1." + U32ToString(i));
+    }
+    for (uint32_t i = 0; i < 1000; ++i) {
+        EXPECT_EQ((i & 1) != 0, table.IsKnownPeer(":1." + U32ToString(i)));
+    }
+
+    /* Clear only leaves the group key holder */
+    table.Clear();
+    EXPECT_FALSE(table.IsKnownPeer(":1.1"));
+    EXPECT_TRUE(table.IsKnownPeer(""));
+}
+
+TEST(PeerStateTest, sender_state_is_not_a_known_peer) {
+    PeerStateTable table;
+
+    PeerState sender = table.GetSenderState(":1.1");
+    EXPECT_TRUE(table.GetSenderState(":1.1").iden(sender));
+    EXPECT_FALSE(table.IsKnownPeer(":1.1"));
+
+    /* A sender becoming a known peer keeps its serial number window */
+    EXPECT_TRUE(sender->IsValidSerial(10, false, false));
+    PeerState known = table.GetPeerState(":1.1");
+    EXPECT_TRUE(known.iden(sender));
+    EXPECT_TRUE(table.GetSenderState(":1.1").iden(known));
+    EXPECT_FALSE(known->IsValidSerial(10, false, false));
+
+    /* Deleting the name drops the sender state too */
+    PeerState other = table.GetSenderState(":1.2");
+    uint32_t generation = table.GetGeneration();
+    table.DelPeerState(":1.2");
+    EXPECT_NE(generation, table.GetGeneration());
+    EXPECT_FALSE(table.GetSenderState(":1.2").iden(other));
+}
+
+TEST(PeerStateTest, sender_flood_evicts_least_recently_used) {
+    PeerStateTable table;
+
+    PeerState active = table.GetSenderState(":1.1");
+    PeerState idle = table.GetSenderState(":1.2");
+    EXPECT_TRUE(active->IsValidSerial(10, false, false));
+    EXPECT_TRUE(idle->IsValidSerial(10, false, false));
+
+    /* Flood the table with new senders while :1.1 keeps sending */
+    for (uint32_t i = 0; i < 10000; ++i) {
+        table.GetSenderState(":2." + U32ToString(i));
+        EXPECT_TRUE(table.GetSenderState(":1.1").iden(active));
+    }
+
+    /* The active sender still rejects a replay, the idle one was dropped */
+    EXPECT_FALSE(table.GetSenderState(":1.1")->IsValidSerial(10, false, false));
+    EXPECT_FALSE(table.GetSenderState(":1.2").iden(idle));
+}
+
+TEST(PeerStateTest, replay_across_two_endpoints) {
+    BusAttachment bus("PeerStateTest", false);
+    qcc::Pipe stream1;
+    qcc::Pipe stream2;
+    RemoteEndpoint ep1(bus, true, "", &stream1, "test", false);
+    RemoteEndpoint ep2(bus, true, "", &stream2, "test", false);
+
+    /* A sender reached over two bus-to-bus links has a single serial number window */
+    EXPECT_TRUE(ep1.GetPeerState(":1.1")->IsValidSerial(10, false, false));
+    EXPECT_FALSE(ep2.GetPeerState(":1.1")->IsValidSerial(10, false, false));
+    EXPECT_TRUE(ep2.GetPeerState(":1.1")->IsValidSerial(11, false, false));
+    EXPECT_FALSE(ep1.GetPeerState(":1.1")->IsValidSerial(11, false, false));
+
+    /* Receiving messages does not make the sender a known peer */
+    EXPECT_FALSE(bus.GetInternal().GetPeerStateTable()->IsKnownPeer(":1.1"));
+}
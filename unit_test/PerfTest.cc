@@ -305,6 +305,43 @@ TEST_F(PerfTest, MethodCallTest_SimpleCall) {
 
 }
 
+/* Test for a batch of pipelined synchronous method calls */
+
+TEST_F(PerfTest, MethodCallTest_Batch) {
+    ClientSetup testclient(ajn::getConnectArg().c_str());
+    BusAttachment* test_msgBus = testclient.getClientMsgBus();
+
+    ProxyBusObject remoteObj(*test_msgBus, testclient.getClientWellknownName(), testclient.getClientObjectPath(), 0);
+    QStatus status = remoteObj.IntrospectRemoteObject();
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+
+    const InterfaceDescription* intf = remoteObj.GetInterface(testclient.getClientInterfaceName());
+    ASSERT_TRUE(intf != NULL);
+    const InterfaceDescription::Member* ping = intf->GetMember("my_ping");
+    ASSERT_TRUE(ping != NULL);
+
+    const size_t numCalls = 16;
+    MsgArg pingArgs[numCalls];
+    const MsgArg* argsList[numCalls];
+    size_t numArgsList[numCalls];
+    char pingStr[numCalls][16];
+    for (size_t i = 0; i < numCalls; ++i) {
+        snprintf(pingStr[i], sizeof(pingStr[i]), "Ping %u", static_cast<unsigned int>(i));
+        pingArgs[i].Set("s", pingStr[i]);
+        argsList[i] = &pingArgs[i];
+        numArgsList[i] = 1;
+    }
+
+    std::vector<Message> replies;
+    status = remoteObj.MethodCallBatch(*ping, argsList, numArgsList, numCalls, replies, 5000);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    ASSERT_EQ(numCalls, replies.size());
+    for (size_t i = 0; i < numCalls; ++i) {
+        EXPECT_EQ(MESSAGE_METHOD_RET, replies[i]->GetType());
+        EXPECT_STREQ(pingStr[i], replies[i]->GetArg(0)->v_string.str);
+    }
+}
+
 TEST_F(PerfTest, MethodCallTest_EmptyParameters) {
     ClientSetup testclient(ajn::getConnectArg().c_str());
 